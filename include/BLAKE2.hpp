@@ -15,6 +15,11 @@
 #include <array>
 #include <memory>
 
+#if defined (__unix__) || defined (__APPLE__)
+#   include <sys/uio.h>
+#   define BLAKE2_HAVE_IOVEC    1
+#endif
+
 namespace BLAKE2 {
 
     const size_t        BLOCK_SIZE = 128 ;      // Messages are processed per BLOCK_SIZE unit.
@@ -133,6 +138,15 @@ namespace BLAKE2 {
             return *this ;
         }
 
+        uint_fast8_t    GetInnerLength () const {
+            return p_ [OFF_INNER_LENGTH] ;
+        }
+
+        self_t &        SetInnerLength (uint8_t value) {
+            p_ [OFF_INNER_LENGTH] = value ;
+            return *this ;
+        }
+
         const void *    GetSalt () const {
             return &p_ [OFF_SALT] ;
         }
@@ -236,9 +250,10 @@ namespace BLAKE2 {
     private:
         enum {
             BIT_FINALIZED = 0,
-            BIT_LAST_NODE = 1
+            BIT_LAST_NODE = 1,
+            BIT_KEYED     = 2
         } ;
-        static const size_t     BUFFER_SIZE = 2 * BLOCK_SIZE ;
+        static const size_t     BUFFER_SIZE = BLOCK_SIZE ;
     private:
         hash_t      h_ ;
         uint64_t    t0_ ;
@@ -252,10 +267,8 @@ namespace BLAKE2 {
          *             :    128bytes    :
          *             |                |
          *             +----------------+
-         *             |                |
-         *             :    128bytes    :
-         *             |                |
-         *             +----------------+
+         * Full blocks are compressed straight from the input, only the bytes
+         * straddling the blocks are staged here.
          * Note: Due to last block compression scheme, we must hold the last message.
          */
     public:
@@ -273,6 +286,33 @@ namespace BLAKE2 {
 
         Generator & Update (const void *data, size_t size) ;
 
+#ifdef BLAKE2_HAVE_IOVEC
+        /**
+         * Hashes the fragments IOV [0] ... IOV [COUNT - 1] in order.
+         * Blocks within a fragment are compressed in place, only the bytes straddling
+         * the fragment boundaries are staged.
+         */
+        Generator & Update (const struct iovec *iov, size_t count) ;
+#endif
+
+        /**
+         * Copies SIZE bytes from SRC to DST and hashes them in one pass.
+         *
+         * SRC is copied and hashed in small chunks, so every cache line is read from memory
+         * once.  Large copies use non-temporal stores, DST is neither read for ownership
+         * nor kept in the cache.  SRC and DST must not overlap.
+         */
+        Generator & CopyAndUpdate (void *dst, const void *src, size_t size) ;
+
+        /**
+         * Marks this generator as the last node of its level (tree hashing).
+         * Must be called before `Finalize`.
+         */
+        Generator & SetLastNode () {
+            flags_ |= (1u << BIT_LAST_NODE) ;
+            return *this ;
+        }
+
         Digest  Finalize () ;
     private:
         bool    IsFinalized () const {
@@ -282,6 +322,10 @@ namespace BLAKE2 {
         bool    IsLastNode () const {
             return (flags_ & (1u << BIT_LAST_NODE)) != 0 ;
         }
+
+        bool    IsKeyed () const {
+            return (flags_ & (1u << BIT_KEYED)) != 0 ;
+        }
     } ;
 
     void    InitializeChain (hash_t &chain) ;
@@ -318,6 +362,39 @@ namespace BLAKE2 {
      * @return Computed digest.
      */
     Digest  Apply (const parameter_block_t &param, const void *key, size_t key_length, const void *data, size_t data_length) ;
+
+#ifdef BLAKE2_HAVE_IOVEC
+    /**
+     * Computes the digest of the fragments IOV [0] ... IOV [COUNT - 1].
+     *
+     * @param param Generation parameters
+     * @param key Key to apply
+     * @param key_length Key length
+     * @param iov Fragments
+     * @param count # of fragments
+     *
+     * @return Computed digest.
+     */
+    Digest  Apply ( const parameter_block_t &param
+                  , const void *key, size_t key_length
+                  , const struct iovec *iov, size_t count) ;
+#endif
+
+    /**
+     * Copies DATA to DST and computes its digest in one pass (see `Generator::CopyAndUpdate`).
+     *
+     * @param param Generation parameters
+     * @param key Key to apply
+     * @param key_length Key length
+     * @param dst Destination (DATA_LENGTH bytes, must not overlap DATA)
+     * @param data Data to copy and compute digest
+     * @param data_length Data length
+     *
+     * @return Computed digest.
+     */
+    Digest  CopyAndApply ( const parameter_block_t &param
+                         , const void *key, size_t key_length
+                         , void *dst, const void *data, size_t data_length) ;
 }
 
 inline bool operator == (const BLAKE2::Digest &a, const BLAKE2::Digest &b) {
@@ -0,0 +1,117 @@
+/*
+ * Adaptive.hpp: Picks the sequential, parallel (BLAKE2bp) or tree mode from the input size and the machine.
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#pragma once
+#ifndef adaptive_hpp__3e8b1c6f9a2d4e7b8f5c0a4d6b9e2c15
+#define adaptive_hpp__3e8b1c6f9a2d4e7b8f5c0a4d6b9e2c15    1
+
+#include "BLAKE2.hpp"
+
+namespace BLAKE2 {
+
+    class Executor ;
+
+    /**
+     * Hashes with the mode expected to finish first on this machine.
+     *
+     * The modes are costed from a `Profile` (concurrency of the executor, per-thread
+     * throughput and the overhead of dispatching the jobs):
+     *
+     *     SEQUENTIAL   size / throughput
+     *     PARALLEL     size / (throughput * min (4, concurrency)) + dispatch
+     *     TREE         the busiest thread's leaves / throughput + dispatch + the root
+     *
+     * The tree has depth 2, unlimited fanout, inner length 64 and a power of 2 leaf
+     * length giving every thread a few leaves.  Ties go to the simpler mode, so small
+     * inputs never pay for the threads.
+     *
+     * A digest depends on the mode, the `Result` records the mode and the parameter
+     * block actually used, `Verify` recomputes from them.
+     */
+    class AdaptiveHasher {
+    public:
+        static const uint64_t   DEFAULT_MEASURE_NS = 200000 ;   // Timing budget of `Measure`.
+        static const uint32_t   MIN_LEAF_LENGTH = 64 * 1024 ;
+        static const uint32_t   MAX_LEAF_LENGTH = 1u << 31 ;
+        static const size_t     LEAVES_PER_THREAD = 4 ;
+
+        enum class Mode : uint8_t {
+            SEQUENTIAL  = 0,    // `Apply`
+            PARALLEL    = 1,    // `ApplyParallel`
+            TREE        = 2,    // `ApplyTree`
+        } ;
+
+        struct Profile {
+            size_t      concurrency ;       // # of jobs run at once.
+            double      bytes_per_ns ;      // Per-thread throughput.
+            double      dispatch_ns ;       // Cost of a round of jobs on the executor.
+        } ;
+
+        struct Plan {
+            Mode                mode ;
+            parameter_block_t   param ;     // Passed to the mode's function.
+            double              estimated_ns ;
+        } ;
+
+        struct Result {
+            Mode                mode ;
+            parameter_block_t   param ;
+            Digest              digest ;
+        } ;
+    private:
+        Profile     profile_ ;
+        Executor *  executor_ ;
+    public:
+        /**
+         * Creates a hasher running on EXECUTOR (nullptr: DefaultExecutor ()).
+         * The profile of DefaultExecutor () is measured once per process.
+         */
+        explicit AdaptiveHasher (Executor *executor = nullptr) ;
+
+        /** Creates a hasher deciding from PROFILE.  */
+        AdaptiveHasher (const Profile &profile, Executor *executor = nullptr) ;
+
+        const Profile &     GetProfile () const {
+            return profile_ ;
+        }
+
+        Plan    Choose (size_t size) const ;
+
+        /**
+         * Chooses the mode for SIZE bytes.
+         *
+         * @param param Generation parameters (digest length, salt and personalization), the tree parameters are overwritten
+         * @param key_length Key length (recorded in the parameter block)
+         * @param size Input size
+         */
+        Plan    Choose (const parameter_block_t &param, size_t key_length, size_t size) const ;
+
+        Result  Hash (const void *data, size_t size) const ;
+
+        Result  Hash ( const parameter_block_t &param
+                     , const void *key, size_t key_length
+                     , const void *data, size_t size) const ;
+
+        /** Measures the profile of EXECUTOR within about BUDGET_NS.  */
+        static Profile  Measure (Executor &executor, uint64_t budget_ns = DEFAULT_MEASURE_NS) ;
+
+        /** Hashes DATA in MODE with PARAM (as recorded in a `Result`).  */
+        static Digest   Rehash ( Mode mode, const parameter_block_t &param
+                               , const void *key, size_t key_length
+                               , const void *data, size_t size
+                               , Executor *executor = nullptr) ;
+
+        /** true if DATA hashes to RESULT.  */
+        static bool     Verify ( const Result &result
+                               , const void *key, size_t key_length
+                               , const void *data, size_t size
+                               , Executor *executor = nullptr) ;
+    } ;
+}
+
+#endif  /* adaptive_hpp__3e8b1c6f9a2d4e7b8f5c0a4d6b9e2c15 */
+/*
+ * [END OF FILE]
+ */
@@ -0,0 +1,131 @@
+/*
+ * Argon2.hpp: Argon2 password hashing (RFC 9106).
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#pragma once
+#ifndef argon2_hpp__5a9d2e7c1f4b4c8e9d6a3b0f2e8c7d14
+#define argon2_hpp__5a9d2e7c1f4b4c8e9d6a3b0f2e8c7d14    1
+
+#include <memory>
+#include <vector>
+#include "BLAKE2.hpp"
+
+namespace BLAKE2 {
+
+    class Executor ;
+
+    /**
+     * Argon2d, Argon2i and Argon2id (version 0x13).
+     *
+     * Lanes are filled concurrently by the executor, one job per lane and slice.
+     * The memory is kept between calls and reused, an instance must not be used
+     * by several threads at once.
+     *
+     * Invalid costs are reported with std::invalid_argument.
+     */
+    class Argon2 {
+    public:
+        using self_t = Argon2 ;
+
+        enum class Type : uint32_t {
+            D  = 0,
+            I  = 1,
+            ID = 2
+        } ;
+
+        static const uint32_t   VERSION = 0x13 ;
+        static const size_t     MEMORY_BLOCK_SIZE = 1024 ;  // # of bytes in a memory block.
+        static const size_t     MIN_SALT_LENGTH = 8 ;
+        static const size_t     MIN_TAG_LENGTH = 4 ;
+    private:
+        class Arena ;
+    private:
+        Type                    type_ ;
+        uint32_t                iterations_ ;
+        uint32_t                memory_cost_ ;  // In KiB.
+        uint32_t                lanes_ ;
+        std::vector<uint8_t>    secret_ ;
+        std::vector<uint8_t>    associated_data_ ;
+        Executor *              executor_ ;
+        std::unique_ptr<Arena>  arena_ ;
+    public:
+        /**
+         * Creates with the RFC 9106 second recommended option (t = 3, m = 64 MiB, p = 4).
+         */
+        explicit Argon2 (Type type = Type::ID) ;
+
+        ~Argon2 () ;
+
+        Argon2 (const Argon2 &) = delete ;
+
+        Argon2 &    operator = (const Argon2 &) = delete ;
+
+        Type        GetType () const { return type_ ; }
+        self_t &    SetType (Type value) {
+            type_ = value ;
+            return *this ;
+        }
+
+        uint32_t    GetIterations () const { return iterations_ ; }
+        self_t &    SetIterations (uint32_t value) {
+            iterations_ = value ;
+            return *this ;
+        }
+
+        /** Memory size in KiB.  */
+        uint32_t    GetMemoryCost () const { return memory_cost_ ; }
+        self_t &    SetMemoryCost (uint32_t value) {
+            memory_cost_ = value ;
+            return *this ;
+        }
+
+        uint32_t    GetLanes () const { return lanes_ ; }
+        self_t &    SetLanes (uint32_t value) {
+            lanes_ = value ;
+            return *this ;
+        }
+
+        self_t &    SetSecret (const void *data, size_t length) ;
+
+        self_t &    SetAssociatedData (const void *data, size_t length) ;
+
+        /**
+         * Sets the executor running the lanes (nullptr: DefaultExecutor () when lanes > 1).
+         */
+        self_t &    SetExecutor (Executor *executor) {
+            executor_ = executor ;
+            return *this ;
+        }
+
+        /**
+         * Computes the tag.
+         *
+         * @param password The password
+         * @param password_length Password length
+         * @param salt The salt
+         * @param salt_length Salt length (at least MIN_SALT_LENGTH)
+         * @param tag Receives the tag
+         * @param tag_length Tag length (at least MIN_TAG_LENGTH)
+         */
+        void    Hash ( const void *password, size_t password_length
+                     , const void *salt, size_t salt_length
+                     , void *tag, size_t tag_length) ;
+
+        std::vector<uint8_t>    Hash ( const void *password, size_t password_length
+                                     , const void *salt, size_t salt_length
+                                     , size_t tag_length = 32) ;
+
+        /**
+         * Recomputes the tag and compares it in constant time.
+         */
+        bool    Verify ( const void *password, size_t password_length
+                       , const void *salt, size_t salt_length
+                       , const void *tag, size_t tag_length) ;
+    } ;
+}
+
+#endif  /* argon2_hpp__5a9d2e7c1f4b4c8e9d6a3b0f2e8c7d14 */
+/*
+ * [END OF FILE]
+ */
@@ -0,0 +1,177 @@
+/*
+ * Async.hpp: Incremental hashing in bounded slices.
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#pragma once
+#ifndef async_hpp__9a3e51c07d8b4c2f8e6d1b7a0c4f2e93
+#define async_hpp__9a3e51c07d8b4c2f8e6d1b7a0c4f2e93    1
+
+#include <deque>
+#include <functional>
+#include <utility>
+#include "BLAKE2.hpp"
+
+#if defined (__cpp_impl_coroutine) && defined (__has_include)
+#   if __has_include (<coroutine>)
+#       include <coroutine>
+#       define BLAKE2_HAVE_COROUTINE    1
+#   endif
+#endif
+
+namespace BLAKE2 {
+
+    const size_t    DEFAULT_SLICE_SIZE = 64 * 1024 ;   // Default # of bytes hashed per step.
+
+    /**
+     * Generator which hashes large updates in bounded slices.
+     *
+     * Updates are queued (not copied) and consumed SLICE_SIZE bytes per step.
+     * Between steps, the control goes back to the scheduler, so an event loop
+     * keeps serving other requests while a large payload is hashed.
+     *
+     * Queued data and the generator itself must stay alive until the completion is called.
+     * One `Update` or `Finalize` runs at a time, the next one may be started from the completion.
+     */
+    class AsyncGenerator {
+    public:
+        using task_t = std::function<void ()> ;
+        /** Posts a task to the event loop (or to a worker pool).  */
+        using scheduler_t = std::function<void (task_t &&)> ;
+        using completion_t = std::function<void ()> ;
+        using digest_callback_t = std::function<void (const Digest &)> ;
+    private:
+        struct Fragment {
+            const uint8_t * data ;
+            size_t          size ;
+        } ;
+    private:
+        Generator               gen_ ;
+        size_t                  slice_size_ ;
+        std::deque<Fragment>    pending_ ;
+        bool                    driving_ = false ;
+    public:
+        explicit AsyncGenerator (const parameter_block_t &param, size_t slice_size = DEFAULT_SLICE_SIZE)
+                : AsyncGenerator { param, nullptr, 0, slice_size } {
+            /* NO-OP */
+        }
+
+        AsyncGenerator ( const parameter_block_t &param
+                       , const void *key, size_t key_len
+                       , size_t slice_size = DEFAULT_SLICE_SIZE)
+                : gen_ { param, key, key_len }
+                , slice_size_ { slice_size == 0 ? DEFAULT_SLICE_SIZE : slice_size } {
+            /* NO-OP */
+        }
+
+        AsyncGenerator (const AsyncGenerator &) = delete ;
+
+        AsyncGenerator &    operator = (const AsyncGenerator &) = delete ;
+
+        /**
+         * Queues DATA without hashing it.
+         */
+        AsyncGenerator &    Enqueue (const void *data, size_t size) ;
+
+        /**
+         * Hashes at most one slice of the queued data.
+         *
+         * @return true if queued data remains
+         */
+        bool    Step () ;
+
+        bool    IsIdle () const {
+            return pending_.empty () ;
+        }
+
+        /** # of queued bytes.  */
+        size_t  GetPendingSize () const ;
+
+        /**
+         * Hashes DATA one slice per scheduled task, then schedules DONE.
+         *
+         * @throw std::logic_error Another `Update` or `Finalize` is running
+         */
+        void    Update (const void *data, size_t size, scheduler_t scheduler, completion_t done) ;
+
+        /**
+         * Hashes the queued data one slice per scheduled task, then calls DONE with the digest.
+         *
+         * @throw std::logic_error Another `Update` or `Finalize` is running
+         */
+        void    Finalize (scheduler_t scheduler, digest_callback_t done) ;
+
+#ifdef BLAKE2_HAVE_COROUTINE
+        class UpdateAwaiter {
+        private:
+            AsyncGenerator &    gen_ ;
+            const void *        data_ ;
+            size_t              size_ ;
+            scheduler_t         scheduler_ ;
+        public:
+            UpdateAwaiter (AsyncGenerator &gen, const void *data, size_t size, scheduler_t scheduler)
+                    : gen_ { gen }, data_ { data }, size_ { size }, scheduler_ { std::move (scheduler) } {
+                /* NO-OP */
+            }
+
+            bool    await_ready () const noexcept {
+                return size_ == 0 ;
+            }
+
+            void    await_suspend (std::coroutine_handle<> h) {
+                gen_.Update (data_, size_, scheduler_, [h] { h.resume () ; }) ;
+            }
+
+            void    await_resume () const noexcept {
+                /* NO-OP */
+            }
+        } ;
+
+        class FinalizeAwaiter {
+        private:
+            AsyncGenerator &    gen_ ;
+            scheduler_t         scheduler_ ;
+            Digest              result_ ;
+        public:
+            FinalizeAwaiter (AsyncGenerator &gen, scheduler_t scheduler)
+                    : gen_ { gen }, scheduler_ { std::move (scheduler) } {
+                /* NO-OP */
+            }
+
+            bool    await_ready () const noexcept {
+                return false ;
+            }
+
+            void    await_suspend (std::coroutine_handle<> h) {
+                gen_.Finalize (scheduler_, [this, h](const Digest &d) {
+                    result_ = d ;
+                    h.resume () ;
+                }) ;
+            }
+
+            Digest  await_resume () const noexcept {
+                return result_ ;
+            }
+        } ;
+
+        /** `co_await gen.UpdateAsync (data, size, scheduler) ;`  */
+        UpdateAwaiter   UpdateAsync (const void *data, size_t size, scheduler_t scheduler) {
+            return UpdateAwaiter { *this, data, size, std::move (scheduler) } ;
+        }
+
+        /** `Digest D = co_await gen.FinalizeAsync (scheduler) ;`  */
+        FinalizeAwaiter FinalizeAsync (scheduler_t scheduler) {
+            return FinalizeAwaiter { *this, std::move (scheduler) } ;
+        }
+#endif  /* BLAKE2_HAVE_COROUTINE */
+    private:
+        void    Start () ;
+
+        void    Drive (scheduler_t scheduler, completion_t done) ;
+    } ;
+}
+
+#endif  /* async_hpp__9a3e51c07d8b4c2f8e6d1b7a0c4f2e93 */
+/*
+ * [END OF FILE]
+ */
@@ -0,0 +1,79 @@
+/*
+ * Batch.hpp: Multi-buffer hashing of independent messages.
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#pragma once
+#ifndef batch_hpp__b7c2e4a91f3d4e5a8b6c0d2e1f9a7b35
+#define batch_hpp__b7c2e4a91f3d4e5a8b6c0d2e1f9a7b35    1
+
+#include "BLAKE2.hpp"
+
+namespace BLAKE2 {
+
+    /**
+     * Computes digests of COUNT messages at once.
+     *
+     * Messages are interleaved into the lanes of the multi-buffer kernel,
+     * so hashing many short messages costs far less than calling `Apply` for each.
+     *
+     * @param param Generation parameters (shared by all messages)
+     * @param key Key to apply
+     * @param key_length Key length
+     * @param count # of messages
+     * @param data Messages
+     * @param data_length Message lengths
+     * @param digests Computed digests (COUNT elements)
+     */
+    void    ApplyBatch ( const parameter_block_t &param
+                       , const void *key, size_t key_length
+                       , size_t count
+                       , const void * const *data, const size_t *data_length
+                       , Digest *digests) ;
+
+    /**
+     * Computes digests of COUNT messages at once, message I is hashed with PARAMS [I].
+     */
+    void    ApplyBatch ( const parameter_block_t *params
+                       , const void *key, size_t key_length
+                       , size_t count
+                       , const void * const *data, const size_t *data_length
+                       , Digest *digests) ;
+
+    /**
+     * Copies COUNT messages and computes their digests at once.
+     *
+     * Each lane copies a 4 KiB slice of its message right before hashing it,
+     * so the data is read from memory only once.
+     *
+     * @param param Generation parameters (shared by all messages)
+     * @param key Key to apply
+     * @param key_length Key length
+     * @param count # of messages
+     * @param dst Copy destinations (must not overlap the messages)
+     * @param data Messages
+     * @param data_length Message lengths
+     * @param digests Computed digests (COUNT elements)
+     */
+    void    CopyAndApplyBatch ( const parameter_block_t &param
+                              , const void *key, size_t key_length
+                              , size_t count
+                              , void * const *dst
+                              , const void * const *data, const size_t *data_length
+                              , Digest *digests) ;
+
+    /**
+     * Copies COUNT messages and computes their digests at once, message I is hashed with PARAMS [I].
+     */
+    void    CopyAndApplyBatch ( const parameter_block_t *params
+                              , const void *key, size_t key_length
+                              , size_t count
+                              , void * const *dst
+                              , const void * const *data, const size_t *data_length
+                              , Digest *digests) ;
+}
+
+#endif  /* batch_hpp__b7c2e4a91f3d4e5a8b6c0d2e1f9a7b35 */
+/*
+ * [END OF FILE]
+ */
@@ -0,0 +1,105 @@
+/*
+ * BlobStore.hpp: Content-addressed blob store keyed by BLAKE2 digests.
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#pragma once
+#ifndef blobstore_hpp__e4b19c7a3d2f4c0b8a5e6d9f1c3b7a24
+#define blobstore_hpp__e4b19c7a3d2f4c0b8a5e6d9f1c3b7a24    1
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "BLAKE2.hpp"
+
+namespace BLAKE2 {
+
+    /**
+     * Content-addressed store (POSIX only).
+     *
+     * Layout:
+     *     ROOT/STORE                  Store header (# of shards)
+     *     ROOT/XX/index               mmap'd open addressing table: truncated digest --> (pack, offset, length)
+     *     ROOT/XX/pack-NNNNNN         Append only pack files
+     * The shard XX is chosen by the first digest byte, every shard has its own lock.
+     * Blobs are keyed by their BLAKE2b-512 digest (`Apply (nullptr, 0, data, size)`),
+     * the index keeps the first KEY_LENGTH bytes.
+     *
+     * I/O errors are reported with std::system_error.
+     */
+    class BlobStore {
+    public:
+        static const size_t     KEY_LENGTH = 32 ;
+        static const size_t     DEFAULT_SHARD_COUNT = 16 ;
+        static const uint64_t   DEFAULT_MAX_PACK_SIZE = 256uLL * 1024 * 1024 ;
+
+        /** Thrown when the stored data does not match its digest.  */
+        class CorruptionError : public std::runtime_error {
+        public:
+            explicit CorruptionError (const std::string &msg) : std::runtime_error { msg } {
+                /* NO-OP */
+            }
+        } ;
+    private:
+        struct Shard ;
+    private:
+        std::string                         root_ ;
+        uint64_t                            max_pack_size_ ;
+        std::vector<std::unique_ptr<Shard>> shards_ ;
+    public:
+        /**
+         * Opens (or creates) the store at ROOT.
+         *
+         * @param root The store directory
+         * @param shard_count # of shards for a new store (an existing store keeps its own)
+         * @param max_pack_size A new pack is started beyond this size
+         */
+        explicit BlobStore ( const std::string &root
+                           , size_t shard_count = DEFAULT_SHARD_COUNT
+                           , uint64_t max_pack_size = DEFAULT_MAX_PACK_SIZE) ;
+
+        ~BlobStore () ;
+
+        BlobStore (const BlobStore &) = delete ;
+
+        BlobStore &     operator = (const BlobStore &) = delete ;
+
+        /**
+         * Stores DATA unless the same content is already stored.
+         *
+         * @param data Data to store
+         * @param size Data size
+         * @param inserted Set to false if the blob was already stored
+         *
+         * @return The digest of DATA
+         */
+        Digest  Put (const void *data, size_t size, bool *inserted = nullptr) ;
+
+        bool    Contains (const Digest &digest) const ;
+
+        /**
+         * Reads and verifies a blob.
+         *
+         * @param digest The blob digest
+         * @param data Receives the blob
+         *
+         * @return false if the blob is not stored
+         * @throw CorruptionError The stored data does not hash to DIGEST
+         */
+        bool    Get (const Digest &digest, std::vector<uint8_t> &data) const ;
+
+        /** # of stored blobs.  */
+        size_t  GetCount () const ;
+
+        /** Flushes packs and indices to the storage.  */
+        void    Sync () ;
+    private:
+        Shard &     SelectShard (const Digest &digest) const ;
+    } ;
+}
+
+#endif  /* blobstore_hpp__e4b19c7a3d2f4c0b8a5e6d9f1c3b7a24 */
+/*
+ * [END OF FILE]
+ */
@@ -0,0 +1,99 @@
+/*
+ * Chunker.hpp: Content-defined chunking with BLAKE2 fingerprints.
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#pragma once
+#ifndef chunker_hpp__61d0c8e2a7f34b9e9a1c5d3b8e2f4a70
+#define chunker_hpp__61d0c8e2a7f34b9e9a1c5d3b8e2f4a70  1
+
+#include <functional>
+#include <memory>
+#include <vector>
+#include "BLAKE2.hpp"
+
+namespace BLAKE2 {
+
+    /**
+     * FastCDC style content-defined chunker.
+     *
+     * Boundaries are found with the gear rolling hash and normalized chunking
+     * (a stricter mask below the average size, a looser one above it).
+     * Chunks lying in a single `Update` buffer are fingerprinted together with
+     * `ApplyBatch` right after the scan, chunks straddling buffers are hashed
+     * incrementally, so every byte is read from memory about once.
+     *
+     * The fingerprint length follows the digest length of the parameter,
+     * only the first GetDigestLength () bytes of `Chunk::digest` are meaningful.
+     */
+    class Chunker {
+    public:
+        struct Chunk {
+            uint64_t    offset ;    // Offset in the stream.
+            size_t      length ;
+            Digest      digest ;
+        } ;
+        using callback_t = std::function<void (const Chunk &)> ;
+
+        static const size_t     DEFAULT_MIN_SIZE = 2 * 1024 ;
+        static const size_t     DEFAULT_AVERAGE_SIZE = 8 * 1024 ;
+        static const size_t     DEFAULT_MAX_SIZE = 64 * 1024 ;
+    private:
+        struct Span {
+            uint64_t        offset ;
+            const uint8_t * data ;
+            size_t          length ;
+        } ;
+    private:
+        Parameter               param_ ;
+        callback_t              callback_ ;
+        size_t                  min_size_ ;
+        size_t                  avg_size_ ;
+        size_t                  max_size_ ;
+        uint64_t                mask_small_ ;   // Used below the average size.
+        uint64_t                mask_large_ ;   // Used above the average size.
+        uint64_t                fp_ ;           // Gear hash.
+        uint64_t                offset_ ;       // Stream offset of the current chunk.
+        size_t                  size_ ;         // # of bytes in the current chunk.
+        std::unique_ptr<Generator>  carry_ ;    // Current chunk started in an earlier buffer.
+        std::vector<Span>       spans_ ;
+    public:
+        /**
+         * @param param Parameter for the fingerprints
+         * @param callback Called for each chunk, in the stream order
+         * @param min_size Minimal chunk size
+         * @param avg_size Expected chunk size (rounded to a power of 2)
+         * @param max_size Maximal chunk size
+         */
+        Chunker ( const parameter_block_t &param
+                , callback_t callback
+                , size_t min_size = DEFAULT_MIN_SIZE
+                , size_t avg_size = DEFAULT_AVERAGE_SIZE
+                , size_t max_size = DEFAULT_MAX_SIZE) ;
+
+        Chunker (const Chunker &) = delete ;
+
+        Chunker &   operator = (const Chunker &) = delete ;
+
+        Chunker &   Update (const void *data, size_t size) ;
+
+        /**
+         * Emits the last chunk.
+         */
+        void    Finish () ;
+    private:
+        /**
+         * Scans for the end of the current chunk.
+         *
+         * @return # of bytes consumed, SIZE if no boundary was found
+         */
+        size_t  FindBoundary (const uint8_t *p, size_t size, bool &found) ;
+
+        void    Flush () ;
+    } ;
+}
+
+#endif  /* chunker_hpp__61d0c8e2a7f34b9e9a1c5d3b8e2f4a70 */
+/*
+ * [END OF FILE]
+ */
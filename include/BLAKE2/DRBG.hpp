@@ -0,0 +1,109 @@
+/*
+ * DRBG.hpp: Deterministic random bit generator in counter mode.
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#pragma once
+#ifndef drbg_hpp__9b3e6f1d4a2c4d7e8f5a0c6b2d9e1f37
+#define drbg_hpp__9b3e6f1d4a2c4d7e8f5a0c6b2d9e1f37  1
+
+#include <limits>
+#include "BLAKE2.hpp"
+
+namespace BLAKE2 {
+
+    class Executor ;
+
+    /**
+     * Counter mode DRBG.
+     *
+     * The output block J (OUTPUT_BLOCK_SIZE bytes) is the keyed BLAKE2b-512 of a
+     * single message block holding J (little-endian 64bits, zero padded):
+     *
+     *     Apply (param, seed, seed_length, counter_block (J), BLOCK_SIZE)
+     *
+     * Salt and personalization of the parameter separate the streams.
+     * Blocks are independent, so they are computed 4 at a time on the multi-buffer
+     * kernel, by several threads, and any position is reachable in constant time.
+     *
+     * Satisfies UniformRandomBitGenerator.
+     */
+    class DRBG {
+    public:
+        using result_type = uint64_t ;
+
+        static const size_t     OUTPUT_BLOCK_SIZE = 64 ;
+    private:
+        hash_t      keyed_ ;            // Chaining value after the key block.
+        uint64_t    t0_ ;               // Counter value for the output block.
+        uint64_t    position_ ;         // # of bytes consumed.
+        uint64_t    cached_block_ ;     // Block index in cache_.
+        uint8_t     cache_ [OUTPUT_BLOCK_SIZE] ;
+    public:
+        DRBG (const void *seed, size_t seed_length) ;
+
+        /**
+         * @param param Generation parameters (salt and personalization), the digest length is forced to 64
+         * @param seed Seed, used as the key (up to 64 bytes)
+         * @param seed_length Seed length
+         */
+        DRBG (const parameter_block_t &param, const void *seed, size_t seed_length) ;
+
+        /**
+         * Fills BUFFER with the next SIZE bytes of the stream, on the calling thread.
+         */
+        void    Fill (void *buffer, size_t size) ;
+
+        /**
+         * Fills BUFFER, with the whole blocks computed by EXECUTOR
+         * (nullptr: DefaultExecutor () for large outputs).
+         * The output does not depend on the executor.
+         */
+        void    Fill (void *buffer, size_t size, Executor *executor) ;
+
+        /** Stream position in bytes.  */
+        uint64_t    GetPosition () const {
+            return position_ ;
+        }
+
+        /** Moves to the absolute POSITION (in bytes).  */
+        DRBG &  Seek (uint64_t position) {
+            position_ = position ;
+            return *this ;
+        }
+
+        /** Skips COUNT bytes.  */
+        DRBG &  Jump (uint64_t count) {
+            position_ += count ;
+            return *this ;
+        }
+
+        result_type     operator () () {
+            uint8_t tmp [sizeof (result_type)] ;
+            Fill (tmp, sizeof (tmp)) ;
+            result_type result = 0 ;
+            for (size_t i = sizeof (tmp) ; 0 < i ; --i) {
+                result = (result << 8) | tmp [i - 1] ;
+            }
+            return result ;
+        }
+
+        static constexpr result_type    min () {
+            return std::numeric_limits<result_type>::min () ;
+        }
+
+        static constexpr result_type    max () {
+            return std::numeric_limits<result_type>::max () ;
+        }
+    private:
+        /**
+         * Writes the output blocks FIRST ... FIRST + COUNT - 1 to OUTPUT.
+         */
+        void    Generate (uint64_t first, size_t count, uint8_t *output) const ;
+    } ;
+}
+
+#endif  /* drbg_hpp__9b3e6f1d4a2c4d7e8f5a0c6b2d9e1f37 */
+/*
+ * [END OF FILE]
+ */
@@ -0,0 +1,116 @@
+/*
+ * Delta.hpp: rsync style delta transfer (rolling weak checksum + truncated BLAKE2 signatures).
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#pragma once
+#ifndef delta_hpp__1c7e4b9a2d6f4e8b8a3c5d0e9f2b6a71
+#define delta_hpp__1c7e4b9a2d6f4e8b8a3c5d0e9f2b6a71    1
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "BLAKE2.hpp"
+
+namespace BLAKE2 {
+
+    class Executor ;
+
+    /**
+     * Delta transfer between a basis (held by the receiver) and a target (held by the sender).
+     *
+     *   1. The receiver sends the `Signature` of the basis: a rolling weak checksum and
+     *      a truncated BLAKE2b (the digest length of the parameter) per block.
+     *   2. The sender scans the target with the rolling checksum, strong hashes are only
+     *      computed on weak matches, and makes a `Patch` of block copies and literals.
+     *   3. The receiver applies the patch on the basis, the result is checked against
+     *      the digest of the target recorded in the patch.
+     */
+    class DeltaSync {
+    public:
+        static const uint32_t   DEFAULT_BLOCK_SIZE = 2048 ;
+        static const uint32_t   DEFAULT_STRONG_LENGTH = 16 ;
+
+        /** Thrown when a patched result does not match the target.  */
+        class MismatchError : public std::runtime_error {
+        public:
+            explicit MismatchError (const std::string &msg) : std::runtime_error { msg } {
+                /* NO-OP */
+            }
+        } ;
+
+        struct Signature {
+            parameter_block_t       param ;             // Parameter of the strong hashes.
+            uint32_t                block_size ;
+            uint32_t                strong_length ;
+            uint64_t                basis_length ;
+            std::vector<uint32_t>   weak ;              // Weak checksum per block.
+            std::vector<uint8_t>    strong ;            // STRONG_LENGTH bytes per block.
+        } ;
+
+        struct Op {
+            enum class Kind : uint8_t {
+                COPY    = 0,    // Copies LENGTH bytes at OFFSET of the basis.
+                LITERAL = 1,    // Copies LENGTH bytes at OFFSET of the literals.
+            } ;
+            Kind        kind ;
+            uint64_t    offset ;
+            uint64_t    length ;
+        } ;
+
+        struct Patch {
+            uint64_t                target_length ;
+            Digest                  target_digest ;     // Apply (nullptr, 0, target).
+            std::vector<Op>         ops ;
+            std::vector<uint8_t>    literals ;
+        } ;
+    public:
+        /** rsync's rolling checksum of DATA.  */
+        static uint32_t     WeakChecksum (const void *data, size_t size) ;
+
+        static Signature    MakeSignature ( const void *data, size_t size
+                                          , uint32_t block_size = DEFAULT_BLOCK_SIZE
+                                          , uint32_t strong_length = DEFAULT_STRONG_LENGTH) ;
+
+        /**
+         * Computes the signature of the basis DATA.
+         *
+         * Blocks are hashed on the multi-buffer kernel, split into jobs run by EXECUTOR
+         * (nullptr: DefaultExecutor () for large inputs), so a memory mapped file is
+         * signed at the storage speed.
+         *
+         * @param param Generation parameters (a key or a salt hides the basis), the digest length is forced to STRONG_LENGTH
+         * @param data Basis
+         * @param size Basis size
+         * @param block_size Block size
+         * @param strong_length # of bytes of the strong hash (4 ... 64)
+         * @param executor Runs the jobs
+         *
+         * @throw std::invalid_argument BLOCK_SIZE or STRONG_LENGTH is out of range
+         */
+        static Signature    MakeSignature ( const parameter_block_t &param
+                                          , const void *data, size_t size
+                                          , uint32_t block_size, uint32_t strong_length
+                                          , Executor *executor = nullptr) ;
+
+        /**
+         * Makes a patch turning the basis of SIGNATURE into the target DATA.
+         *
+         * @throw std::invalid_argument SIGNATURE is malformed (block size, strong length or # of blocks)
+         */
+        static Patch    MakePatch (const Signature &signature, const void *data, size_t size) ;
+
+        /**
+         * Applies PATCH to BASIS.
+         *
+         * @throw std::invalid_argument PATCH refers outside of BASIS or of its literals
+         * @throw MismatchError The result does not match the target
+         */
+        static std::vector<uint8_t>     ApplyPatch (const void *basis, size_t basis_size, const Patch &patch) ;
+    } ;
+}
+
+#endif  /* delta_hpp__1c7e4b9a2d6f4e8b8a3c5d0e9f2b6a71 */
+/*
+ * [END OF FILE]
+ */
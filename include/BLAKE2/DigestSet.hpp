@@ -0,0 +1,96 @@
+/*
+ * DigestSet.hpp: Immutable set of truncated digests.
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#pragma once
+#ifndef digestset_hpp__7c2e9a4f1b6d4e3a8d0c5f7b9e2a6c41
+#define digestset_hpp__7c2e9a4f1b6d4e3a8d0c5f7b9e2a6c41    1
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include "BLAKE2.hpp"
+
+namespace BLAKE2 {
+
+    /**
+     * Immutable membership set keyed by the first KEY_LENGTH bytes of the digests.
+     *
+     * Keys are sorted and bucketed by their leading bits, a lookup reads one bucket
+     * offset and scans a few keys (with SIMD compares when available).
+     * The in-memory image and the file have the same layout, `Open` maps the file
+     * without copying (POSIX).
+     *
+     *     +0      Header (64 bytes): "BLAKE2DS", version, key length, # of keys, bucket bits
+     *     +64     Bucket offsets ((1 << bucket bits) + 1 little-endian 64bits)
+     *     +N      Keys (aligned to 64 bytes), in the ascending byte order
+     *
+     * I/O errors are reported with std::system_error.
+     */
+    class DigestSet {
+    public:
+        static const size_t     KEY_LENGTH = 16 ;
+
+        /** Thrown when the file is not a digest set.  */
+        class FormatError : public std::runtime_error {
+        public:
+            explicit FormatError (const std::string &msg) : std::runtime_error { msg } {
+                /* NO-OP */
+            }
+        } ;
+    private:
+        class Image ;
+    private:
+        std::unique_ptr<Image>  image_ ;
+        const uint8_t *         offsets_ ;
+        const uint8_t *         keys_ ;
+        uint64_t                count_ ;
+        uint32_t                bucket_bits_ ;
+    public:
+        /** Creates an empty set.  */
+        DigestSet () ;
+
+        /**
+         * Builds the set from COUNT digests (duplicates are allowed).
+         */
+        DigestSet (const Digest *digests, size_t count) ;
+
+        DigestSet (DigestSet &&src) ;
+
+        DigestSet &     operator = (DigestSet &&src) ;
+
+        ~DigestSet () ;
+
+        /**
+         * Maps a set saved with `Save`.
+         *
+         * @throw FormatError PATH is not a digest set
+         */
+        static DigestSet    Open (const std::string &path) ;
+
+        void    Save (const std::string &path) const ;
+
+        /** # of distinct keys.  */
+        uint64_t    GetCount () const {
+            return count_ ;
+        }
+
+        bool    Contains (const Digest &digest) const ;
+
+        /**
+         * Bulk membership query, RESULT [I] receives Contains (digests [I]).
+         * Buckets of the following digests are prefetched while scanning.
+         */
+        void    Contains (const Digest *digests, size_t count, bool *result) const ;
+    private:
+        void    Attach (std::unique_ptr<Image> &&image) ;
+
+        uint64_t    BucketOf (const uint8_t *key) const ;
+    } ;
+}
+
+#endif  /* digestset_hpp__7c2e9a4f1b6d4e3a8d0c5f7b9e2a6c41 */
+/*
+ * [END OF FILE]
+ */
@@ -0,0 +1,126 @@
+/*
+ * DirectoryHasher.hpp: Incremental directory tree hashing with a persistent stat cache.
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#pragma once
+#ifndef directoryhasher_hpp__3a8d5e1f7c2b4d9e9f6a0c4b8e2d7f15
+#define directoryhasher_hpp__3a8d5e1f7c2b4d9e9f6a0c4b8e2d7f15    1
+
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include "BLAKE2.hpp"
+
+namespace BLAKE2 {
+
+    class Executor ;
+
+    /**
+     * Digest of a directory tree (POSIX only).
+     *
+     * Nodes are hashed with the tree parameters (fanout 0, max depth 255, inner length 64):
+     *   - A regular file (or a symbolic link target) is a leaf at node depth 0.
+     *   - A directory is a node at node depth 1 over its entries sorted by name,
+     *     an entry is `kind (1 byte) | name length (little-endian 64bits) | name | digest`
+     *     where the kind tells regular files, executables, directories and symbolic links apart.
+     *   - The root directory is marked as the last node.
+     * Other file types (devices, sockets, ...) are skipped.
+     *
+     * Directories are scanned and files are hashed in parallel by the executor.
+     * The digest of a file is cached on its relative path and reused while its
+     * (device, inode, size, mtime, ctime) are unchanged, so an unchanged tree costs
+     * only the `stat` calls.  Files modified within RACY_WINDOW_NS of a run are not
+     * cached, since a later write in the same timestamp tick would go unnoticed.
+     *
+     * I/O errors are reported with std::system_error.
+     */
+    class DirectoryHasher {
+    public:
+        static const int64_t    RACY_WINDOW_NS = 2000000000 ;
+
+        /** Thrown when the cache file is not a cache of this class.  */
+        class FormatError : public std::runtime_error {
+        public:
+            explicit FormatError (const std::string &msg) : std::runtime_error { msg } {
+                /* NO-OP */
+            }
+        } ;
+
+        struct Statistics {
+            uint64_t    directories ;       // # of directories scanned.
+            uint64_t    files ;             // # of regular files.
+            uint64_t    hashed_files ;      // # of files read (the rest came from the cache).
+            uint64_t    hashed_bytes ;
+        } ;
+    private:
+        struct CacheEntry {
+            uint64_t    device ;
+            uint64_t    inode ;
+            uint64_t    size ;
+            int64_t     mtime_ns ;
+            int64_t     ctime_ns ;
+            Digest      digest ;
+        } ;
+
+        struct Walk ;
+    private:
+        parameter_block_t   param_ ;
+        std::string         cache_path_ ;
+        Executor *          executor_ ;
+        std::unordered_map<std::string, CacheEntry>     cache_ ;
+        Statistics          stats_ ;
+    public:
+        /**
+         * Creates a hasher, the cache at CACHE_PATH is loaded if exists.
+         *
+         * @param cache_path The cache file (empty: the cache lives in memory only)
+         */
+        explicit DirectoryHasher (const std::string &cache_path = std::string {}) ;
+
+        /**
+         * Creates a hasher.
+         *
+         * @param param Generation parameters (salt and personalization), the tree parameters are overwritten
+         * @param cache_path The cache file (empty: the cache lives in memory only)
+         * @param executor Runs the scans and the file hashes (nullptr: DefaultExecutor ())
+         *
+         * @throw FormatError CACHE_PATH is not a cache file
+         */
+        DirectoryHasher (const parameter_block_t &param, const std::string &cache_path, Executor *executor = nullptr) ;
+
+        DirectoryHasher (const DirectoryHasher &) = delete ;
+
+        DirectoryHasher &   operator = (const DirectoryHasher &) = delete ;
+
+        /**
+         * Computes the digest of the tree under ROOT.
+         * The cache is replaced with the files of this tree (call `Save` to persist it).
+         *
+         * @param root The root directory
+         */
+        Digest  Hash (const std::string &root) ;
+
+        /**
+         * Writes the cache to the cache file (atomically replaced).
+         */
+        void    Save () const ;
+
+        /** Statistics of the last `Hash`.  */
+        const Statistics &  GetStatistics () const {
+            return stats_ ;
+        }
+
+        /** # of cached files.  */
+        size_t  GetCacheSize () const {
+            return cache_.size () ;
+        }
+    private:
+        void    Load () ;
+    } ;
+}
+
+#endif  /* directoryhasher_hpp__3a8d5e1f7c2b4d9e9f6a0c4b8e2d7f15 */
+/*
+ * [END OF FILE]
+ */
@@ -0,0 +1,147 @@
+/*
+ * Encoding.hpp: Hex and base64 conversion of digests.
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#pragma once
+#ifndef encoding_hpp__4d8a1f6e3c2b4e7a9b0d5c8f1e6a3b29
+#define encoding_hpp__4d8a1f6e3c2b4e7a9b0d5c8f1e6a3b29  1
+
+#include <string>
+#include <vector>
+#include "BLAKE2.hpp"
+
+namespace BLAKE2 {
+
+    /*
+     * Conversions write into caller supplied buffers and never allocate.
+     * Hex is emitted in lower case and accepted in either case.
+     * Base64 uses the standard alphabet (RFC 4648) with '=' padding.
+     * SSSE3, AVX2 or NEON is used when the CPU has it (see `CodecKernel`).
+     */
+
+    /** # of characters for SIZE bytes in hex.  */
+    constexpr size_t    HexLength (size_t size) {
+        return 2 * size ;
+    }
+
+    /** # of characters for SIZE bytes in base64 (padded).  */
+    constexpr size_t    Base64Length (size_t size) {
+        return 4 * ((size + 2) / 3) ;
+    }
+
+    /**
+     * Encodes DATA in hex.
+     *
+     * @param data Data to encode
+     * @param size Data size
+     * @param output Receives HexLength (size) characters (not NUL terminated)
+     *
+     * @return # of characters written
+     */
+    size_t  EncodeHex (const void *data, size_t size, char *output) ;
+
+    /**
+     * Decodes hex.
+     *
+     * @param input Hex characters
+     * @param length # of characters (must be even)
+     * @param output Receives length / 2 bytes
+     *
+     * @return false if INPUT is malformed (OUTPUT is undefined)
+     */
+    bool    DecodeHex (const char *input, size_t length, void *output) ;
+
+    /**
+     * Encodes DATA in base64.
+     *
+     * @param data Data to encode
+     * @param size Data size
+     * @param output Receives Base64Length (size) characters (not NUL terminated)
+     *
+     * @return # of characters written
+     */
+    size_t  EncodeBase64 (const void *data, size_t size, char *output) ;
+
+    /**
+     * Decodes padded base64.
+     *
+     * @param input Base64 characters
+     * @param length # of characters (must be a multiple of 4)
+     * @param output Receives the decoded bytes (at most 3 * length / 4)
+     * @param output_length Receives # of decoded bytes
+     *
+     * @return false if INPUT is malformed (OUTPUT is undefined)
+     */
+    bool    DecodeBase64 (const char *input, size_t length, void *output, size_t *output_length) ;
+
+    /**
+     * Encodes the first LENGTH bytes of DIGEST in hex.
+     */
+    inline size_t   EncodeHex (const Digest &digest, char *output, size_t length = Digest::SIZE) {
+        return EncodeHex (digest.data (), (length < Digest::SIZE ? length : Digest::SIZE), output) ;
+    }
+
+    /**
+     * Decodes a (possibly truncated) digest, the remaining bytes are set to 0.
+     */
+    bool    DecodeHex (const char *input, size_t length, Digest &digest) ;
+
+    inline size_t   EncodeBase64 (const Digest &digest, char *output, size_t length = Digest::SIZE) {
+        return EncodeBase64 (digest.data (), (length < Digest::SIZE ? length : Digest::SIZE), output) ;
+    }
+
+    /**
+     * Decodes a (possibly truncated) digest, the remaining bytes are set to 0.
+     */
+    bool    DecodeBase64 (const char *input, size_t length, Digest &digest) ;
+
+    /**
+     * Encodes COUNT digests, the digest I is written at OUTPUT + I * STRIDE.
+     *
+     * @param digests Digests to encode
+     * @param count # of digests
+     * @param output Output buffer
+     * @param stride Distance between records (at least HexLength (length))
+     * @param length # of bytes to encode per digest
+     */
+    void    EncodeHex (const Digest *digests, size_t count, char *output, size_t stride, size_t length = Digest::SIZE) ;
+
+    /**
+     * Decodes COUNT digests of LENGTH characters, the digest I is read from INPUT + I * STRIDE.
+     *
+     * @return false if any of them is malformed
+     */
+    bool    DecodeHex (const char *input, size_t stride, size_t length, size_t count, Digest *digests) ;
+
+    void    EncodeBase64 (const Digest *digests, size_t count, char *output, size_t stride, size_t length = Digest::SIZE) ;
+
+    bool    DecodeBase64 (const char *input, size_t stride, size_t length, size_t count, Digest *digests) ;
+
+    /**
+     * SIMD kernels of the conversions compiled into the library.
+     *
+     * The most preferred kernel the CPU supports runs until another one is selected.
+     * Every kernel gives the same results, "generic" is the plain C++ one.
+     */
+    class CodecKernel {
+    public:
+        /** Names of the compiled kernels (in the order of preference).  */
+        static std::vector<std::string>     GetNames () ;
+
+        /** Name of the kernel running the conversions.  */
+        static std::string  GetActiveName () ;
+
+        /**
+         * Routes the conversions to kernel NAME.
+         *
+         * @return false (nothing changed) if NAME is unknown or unsupported
+         */
+        static bool     Select (const std::string &name) ;
+    } ;
+}
+
+#endif  /* encoding_hpp__4d8a1f6e3c2b4e7a9b0d5c8f1e6a3b29 */
+/*
+ * [END OF FILE]
+ */
@@ -0,0 +1,239 @@
+/*
+ * Filter.hpp: Approximate membership filters driven by a single digest per key.
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#pragma once
+#ifndef filter_hpp__5e1b8d3a7c4f4b2e9a6d0f3c8b1e7a52
+#define filter_hpp__5e1b8d3a7c4f4b2e9a6d0f3c8b1e7a52    1
+
+#include <vector>
+#include "BLAKE2.hpp"
+
+namespace BLAKE2 {
+
+    /**
+     * Keyed BLAKE2b-512 of a filter key.
+     *
+     * The chaining value after the key block is computed once, so a key up to
+     * BLOCK_SIZE bytes costs a single compression and yields 8 independent words,
+     * enough for every probe position of the filters below.
+     * The result equals the digest words of
+     * `Apply (Parameter (param).SetDigestLength (64), key, key_length, data, size)`.
+     */
+    class FilterHash {
+    private:
+        hash_t      keyed_ ;        // Chaining value after the key block.
+        hash_t      empty_ ;        // Hash of the empty message.
+        bool        has_key_ ;
+    public:
+        FilterHash (const void *key, size_t key_length) ;
+
+        /**
+         * @param param Generation parameters (salt and personalization), the digest length is forced to 64
+         * @param key Key to apply
+         * @param key_length Key length
+         */
+        FilterHash (const parameter_block_t &param, const void *key, size_t key_length) ;
+
+        void    Apply (const void *data, size_t size, hash_t &result) const ;
+
+        /**
+         * Hashes COUNT keys, keys up to BLOCK_SIZE bytes are compressed 4 at a time
+         * on the multi-buffer kernel.
+         */
+        void    Apply (size_t count, const void * const *data, const size_t *size, hash_t *result) const ;
+    } ;
+
+    /**
+     * Classic Bloom filter, probe I is taken from the digest word I.
+     */
+    class BloomFilter {
+    public:
+        static const uint32_t   MAX_HASHES = 8 ;
+    private:
+        FilterHash              hash_ ;
+        std::vector<uint64_t>   words_ ;
+        uint64_t                bits_ ;
+        uint32_t                hashes_ ;
+    public:
+        BloomFilter (uint64_t bits, uint32_t hashes, const void *key, size_t key_length) ;
+
+        /**
+         * @param bits # of bits in the filter
+         * @param hashes # of probes per key (1 ... MAX_HASHES)
+         * @param param Generation parameters of the key hash
+         * @param key Key of the key hash (use a secret one against adversarial inputs)
+         * @param key_length Key length
+         *
+         * @throw std::invalid_argument BITS or HASHES is out of range
+         */
+        BloomFilter (uint64_t bits, uint32_t hashes, const parameter_block_t &param, const void *key, size_t key_length) ;
+
+        uint64_t    GetBitCount () const {
+            return bits_ ;
+        }
+
+        uint32_t    GetHashCount () const {
+            return hashes_ ;
+        }
+
+        void    Clear () ;
+
+        void    Insert (const void *data, size_t size) ;
+
+        void    Insert (size_t count, const void * const *data, const size_t *size) ;
+
+        bool    Contains (const void *data, size_t size) const ;
+
+        /** RESULT [I] receives Contains (data [I], size [I]).  */
+        void    Contains (size_t count, const void * const *data, const size_t *size, bool *result) const ;
+    private:
+        void    InsertHash (const hash_t &h) ;
+
+        bool    ContainsHash (const hash_t &h) const ;
+
+        void    PrefetchHash (const hash_t &h) const ;
+    } ;
+
+    /**
+     * Bloom filter with all probes of a key in one 64 bytes block (a cache line).
+     *
+     * The block is chosen by the digest word 0, the probes are 9bits fields of the
+     * remaining words.
+     * Not copyable since the blocks are kept aligned in the storage.
+     */
+    class BlockedBloomFilter {
+    public:
+        static const uint32_t   MAX_HASHES = 16 ;
+        static const size_t     BLOCK_BITS = 512 ;
+    private:
+        FilterHash              hash_ ;
+        std::vector<uint64_t>   storage_ ;
+        size_t                  base_ ;         // Index of the first aligned word in storage_.
+        uint64_t                blocks_ ;
+        uint32_t                hashes_ ;
+    public:
+        BlockedBloomFilter (uint64_t bits, uint32_t hashes, const void *key, size_t key_length) ;
+
+        /**
+         * @param bits # of bits in the filter (rounded up to a multiple of BLOCK_BITS)
+         * @param hashes # of probes per key (1 ... MAX_HASHES)
+         *
+         * @throw std::invalid_argument BITS or HASHES is out of range
+         */
+        BlockedBloomFilter (uint64_t bits, uint32_t hashes, const parameter_block_t &param, const void *key, size_t key_length) ;
+
+        BlockedBloomFilter (const BlockedBloomFilter &) = delete ;
+        BlockedBloomFilter (BlockedBloomFilter &&) = default ;
+
+        BlockedBloomFilter &    operator = (const BlockedBloomFilter &) = delete ;
+        BlockedBloomFilter &    operator = (BlockedBloomFilter &&) = default ;
+
+        uint64_t    GetBitCount () const {
+            return blocks_ * BLOCK_BITS ;
+        }
+
+        uint32_t    GetHashCount () const {
+            return hashes_ ;
+        }
+
+        void    Clear () ;
+
+        void    Insert (const void *data, size_t size) ;
+
+        void    Insert (size_t count, const void * const *data, const size_t *size) ;
+
+        bool    Contains (const void *data, size_t size) const ;
+
+        void    Contains (size_t count, const void * const *data, const size_t *size, bool *result) const ;
+    private:
+        uint64_t *          BlockOf (const hash_t &h) ;
+        const uint64_t *    BlockOf (const hash_t &h) const ;
+
+        void    InsertHash (const hash_t &h) ;
+
+        bool    ContainsHash (const hash_t &h) const ;
+
+        void    PrefetchHash (const hash_t &h) const ;
+    } ;
+
+    /**
+     * Cuckoo filter with 16bits fingerprints and 4 slots per bucket.
+     *
+     * The bucket and the fingerprint come from the digest words 0 and 1,
+     * the alternate bucket is derived from the fingerprint (partial-key cuckoo hashing)
+     * so keys can be removed.
+     */
+    class CuckooFilter {
+    public:
+        static const size_t     SLOTS_PER_BUCKET = 4 ;
+        static const size_t     MAX_KICKS = 500 ;
+    private:
+        FilterHash              hash_ ;
+        std::vector<uint16_t>   slots_ ;
+        uint64_t                mask_ ;         // # of buckets - 1.
+        uint64_t                count_ ;
+        uint64_t                victim_index_ ;
+        uint16_t                victim_ ;       // Fingerprint evicted by a failed insertion (0: none).
+    public:
+        CuckooFilter (uint64_t capacity, const void *key, size_t key_length) ;
+
+        /**
+         * @param capacity Expected # of keys (the # of buckets is a power of 2 holding them at 95% load)
+         *
+         * @throw std::invalid_argument CAPACITY is 0
+         */
+        CuckooFilter (uint64_t capacity, const parameter_block_t &param, const void *key, size_t key_length) ;
+
+        /** # of keys in the filter.  */
+        uint64_t    GetCount () const {
+            return count_ ;
+        }
+
+        uint64_t    GetBucketCount () const {
+            return mask_ + 1 ;
+        }
+
+        void    Clear () ;
+
+        /**
+         * @return false if the filter is full (the key is not inserted)
+         */
+        bool    Insert (const void *data, size_t size) ;
+
+        /**
+         * @return # of inserted keys (insertion stops when the filter becomes full)
+         */
+        size_t  Insert (size_t count, const void * const *data, const size_t *size) ;
+
+        bool    Contains (const void *data, size_t size) const ;
+
+        void    Contains (size_t count, const void * const *data, const size_t *size, bool *result) const ;
+
+        /**
+         * Removes a key inserted before (removing other keys may drop an unrelated one).
+         *
+         * @return false if not found
+         */
+        bool    Remove (const void *data, size_t size) ;
+    private:
+        bool    InsertHash (const hash_t &h) ;
+
+        bool    ContainsHash (const hash_t &h) const ;
+
+        void    PrefetchHash (const hash_t &h) const ;
+
+        bool    InsertFingerprint (uint64_t index, uint16_t fp) ;
+
+        /** Kicks fingerprints around until FP finds a slot, keeps the last evicted one as the victim.  */
+        void    Relocate (uint64_t index, uint16_t fp, uint64_t seed) ;
+
+        uint64_t    Alternate (uint64_t index, uint16_t fp) const ;
+    } ;
+}
+
+#endif  /* filter_hpp__5e1b8d3a7c4f4b2e9a6d0f3c8b1e7a52 */
+/*
+ * [END OF FILE]
+ */
@@ -0,0 +1,69 @@
+/*
+ * Kernel.hpp: Self-test and selection of the `Compress` kernels.
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#pragma once
+#ifndef kernel_hpp__7a2e5c9b1f4d4a8e8c3b6d0f9e1a4b72
+#define kernel_hpp__7a2e5c9b1f4d4a8e8c3b6d0f9e1a4b72    1
+
+#include <string>
+#include <vector>
+#include "BLAKE2.hpp"
+
+namespace BLAKE2 {
+
+    /**
+     * `Compress` kernels compiled into the library.
+     *
+     * `Compress` runs the most preferred kernel the CPU supports until another one
+     * is selected.  Being supported does not mean being the fastest (e.g. the AVX2
+     * gather kernel is slower than the scalar one on some cores), `AutoTune` measures.
+     */
+    class Kernel {
+    public:
+        static const uint64_t   DEFAULT_TUNING_NS = 20000 ;     // Timing budget per kernel.
+
+        struct Result {
+            std::string     name ;
+            bool            supported ;         // Runs on this CPU.
+            bool            passed ;            // Matches the known answers.
+            double          ns_per_block ;      // 0 unless timed.
+        } ;
+    public:
+        /** Names of the compiled kernels.  */
+        static std::vector<std::string>     GetNames () ;
+
+        /** Name of the kernel running `Compress`.  */
+        static std::string  GetActiveName () ;
+
+        /**
+         * Checks kernel NAME against the known answers (and against the generic
+         * kernel for the counter and the finalization flags).
+         *
+         * @return false if NAME is unknown, unsupported or wrong
+         */
+        static bool     SelfTest (const std::string &name) ;
+
+        /**
+         * Routes `Compress` to kernel NAME once it passes `SelfTest`.
+         *
+         * @return false (nothing changed) if NAME is not usable
+         */
+        static bool     Select (const std::string &name) ;
+
+        /**
+         * Opt-in startup routine: self-tests the supported kernels, times the passing
+         * ones for about BUDGET_NS each and selects the fastest.
+         * Runs once per process, later calls return the cached results.
+         *
+         * @return Results per kernel
+         */
+        static const std::vector<Result> &  AutoTune (uint64_t budget_ns = DEFAULT_TUNING_NS) ;
+    } ;
+}
+
+#endif  /* kernel_hpp__7a2e5c9b1f4d4a8e8c3b6d0f9e1a4b72 */
+/*
+ * [END OF FILE]
+ */
@@ -0,0 +1,173 @@
+/*
+ * MMR.hpp: Merkle mountain range (append only authenticated log).
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#pragma once
+#ifndef mmr_hpp__3b9e6c2d8f1a4e5b9c7d0a4f2e8b6d13
+#define mmr_hpp__3b9e6c2d8f1a4e5b9c7d0a4f2e8b6d13    1
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "BLAKE2.hpp"
+
+namespace BLAKE2 {
+
+    /**
+     * Merkle mountain range over BLAKE2b-512.
+     *
+     * Nodes are numbered in the append order (post-order of the perfect trees), a leaf
+     * never moves so the range of N leaves is a prefix of any larger one.
+     * Every node is domain separated by the tree parameters (fanout 2, inner length 64):
+     *
+     *     leaf    Apply (P.SetNodeDepth (0).SetNodeOffset (position), data)
+     *     inner   Apply (P.SetNodeDepth (height).SetNodeOffset (position), left || right)
+     *     root    Apply (P.SetNodeDepth (ROOT_DEPTH).SetNodeOffset (# of leaves) + last node, peaks)
+     *
+     * so an inner node costs a single compression.
+     * Appends are O(1) amortized, `Append` with several leaves hashes them on the
+     * multi-buffer kernel.
+     *
+     * `Open` keeps the nodes in a memory mapped file (POSIX only),
+     * I/O errors are reported with std::system_error.
+     */
+    class MerkleMountainRange {
+    public:
+        static const uint8_t    ROOT_DEPTH = 255 ;
+
+        /** Thrown when the file is not a range made with the same parameters.  */
+        class FormatError : public std::runtime_error {
+        public:
+            explicit FormatError (const std::string &msg) : std::runtime_error { msg } {
+                /* NO-OP */
+            }
+        } ;
+
+        /** Proves that a leaf is included in the range of LEAF_COUNT leaves.  */
+        struct InclusionProof {
+            uint64_t                leaf_index ;
+            uint64_t                leaf_count ;
+            std::vector<Digest>     path ;          // Siblings from the leaf up to its peak.
+            std::vector<Digest>     peaks ;         // All the peaks, left to right.
+        } ;
+
+        /** Proves that the range of OLD_LEAF_COUNT leaves is a prefix of the range of NEW_LEAF_COUNT leaves.  */
+        struct ConsistencyProof {
+            uint64_t                old_leaf_count ;
+            uint64_t                new_leaf_count ;
+            std::vector<Digest>     old_peaks ;
+            std::vector<Digest>     path ;          // Siblings from every old peak up to its new peak, concatenated.
+            std::vector<Digest>     new_peaks ;
+        } ;
+    private:
+        class Store ;
+    private:
+        parameter_block_t       param_ ;
+        std::unique_ptr<Store>  store_ ;
+        uint64_t                leaf_count_ ;
+    public:
+        MerkleMountainRange () ;
+
+        /**
+         * @param param Generation parameters (salt and personalization), the tree parameters are overwritten
+         */
+        explicit MerkleMountainRange (const parameter_block_t &param) ;
+
+        MerkleMountainRange (MerkleMountainRange &&src) ;
+
+        MerkleMountainRange &   operator = (MerkleMountainRange &&src) ;
+
+        ~MerkleMountainRange () ;
+
+        /**
+         * Opens (or creates) a range kept in PATH.
+         *
+         * @throw FormatError PATH is not a range or was made with another parameter
+         */
+        static MerkleMountainRange  Open (const std::string &path) ;
+
+        static MerkleMountainRange  Open (const std::string &path, const parameter_block_t &param) ;
+
+        uint64_t    GetLeafCount () const {
+            return leaf_count_ ;
+        }
+
+        /** # of nodes (leaves included).  */
+        uint64_t    GetNodeCount () const ;
+
+        /**
+         * Appends a leaf.
+         *
+         * @return Index of the leaf
+         */
+        uint64_t    Append (const void *data, size_t size) ;
+
+        /**
+         * Appends COUNT leaves.
+         *
+         * @return Index of the first leaf
+         */
+        uint64_t    Append (size_t count, const void * const *data, const size_t *size) ;
+
+        /** Node at POSITION (in the append order).  */
+        Digest  GetNode (uint64_t position) const ;
+
+        Digest  GetLeaf (uint64_t leaf_index) const ;
+
+        Digest  GetRoot () const {
+            return GetRoot (leaf_count_) ;
+        }
+
+        /** Root of the range when it had LEAF_COUNT leaves.  */
+        Digest  GetRoot (uint64_t leaf_count) const ;
+
+        /**
+         * Flushes the nodes to the file (NO-OP for a range in memory).
+         */
+        void    Sync () ;
+
+        InclusionProof  ProveInclusion (uint64_t leaf_index) const {
+            return ProveInclusion (leaf_index, leaf_count_) ;
+        }
+
+        /**
+         * @throw std::out_of_range LEAF_INDEX or LEAF_COUNT is out of range
+         */
+        InclusionProof  ProveInclusion (uint64_t leaf_index, uint64_t leaf_count) const ;
+
+        ConsistencyProof    ProveConsistency (uint64_t old_leaf_count) const {
+            return ProveConsistency (old_leaf_count, leaf_count_) ;
+        }
+
+        /**
+         * @throw std::out_of_range OLD_LEAF_COUNT or NEW_LEAF_COUNT is out of range
+         */
+        ConsistencyProof    ProveConsistency (uint64_t old_leaf_count, uint64_t new_leaf_count) const ;
+
+        /**
+         * Checks that DATA is the leaf PROOF.leaf_index of the range whose root is ROOT.
+         */
+        static bool     VerifyInclusion ( const parameter_block_t &param
+                                        , const Digest &root
+                                        , const void *data, size_t size
+                                        , const InclusionProof &proof) ;
+
+        static bool     VerifyConsistency ( const parameter_block_t &param
+                                          , const Digest &old_root
+                                          , const Digest &new_root
+                                          , const ConsistencyProof &proof) ;
+    private:
+        MerkleMountainRange (const parameter_block_t &param, std::unique_ptr<Store> &&store) ;
+
+        void    Merge () ;
+
+        std::vector<Digest>     GetPeaks (uint64_t leaf_count) const ;
+    } ;
+}
+
+#endif  /* mmr_hpp__3b9e6c2d8f1a4e5b9c7d0a4f2e8b6d13 */
+/*
+ * [END OF FILE]
+ */
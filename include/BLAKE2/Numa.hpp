@@ -0,0 +1,116 @@
+/*
+ * Numa.hpp: NUMA aware tree hashing of large memory regions.
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#pragma once
+#ifndef numa_hpp__2b7e4f9c1a6d4c3e9e8a5f0b7d2c6e91
+#define numa_hpp__2b7e4f9c1a6d4c3e9e8a5f0b7d2c6e91    1
+
+#include <memory>
+#include <vector>
+#include "BLAKE2.hpp"
+
+namespace BLAKE2 {
+
+    class Executor ;
+
+    /**
+     * NUMA nodes having CPUs this process may run on.
+     *
+     * Read from /sys/devices/system/node on Linux, elsewhere the machine is a single node.
+     */
+    class NumaTopology {
+    public:
+        static const int    UNKNOWN_NODE = -1 ;
+
+        struct Node {
+            int                 id ;
+            std::vector<int>    cpus ;
+        } ;
+    private:
+        std::vector<Node>   nodes_ ;
+    public:
+        /** Topology of this machine (read once).  */
+        static const NumaTopology &     System () ;
+
+        /**
+         * @throw std::invalid_argument NODES is empty or a node has no CPU
+         */
+        explicit NumaTopology (const std::vector<Node> &nodes) ;
+
+        size_t  GetNodeCount () const {
+            return nodes_.size () ;
+        }
+
+        const Node &    GetNode (size_t index) const {
+            return nodes_ [index] ;
+        }
+
+        /** Index of the node ID, GetNodeCount () if none.  */
+        size_t  FindNode (int id) const ;
+
+        /**
+         * Queries the nodes holding PAGES with move_pages (2) (get_mempolicy (2) if it is not permitted).
+         *
+         * @param pages Addresses within the pages
+         * @param count # of pages
+         * @param nodes Receives the node ids (UNKNOWN_NODE if the page is not present or the query fails)
+         */
+        static void     QueryPageNodes (const void * const *pages, size_t count, int *nodes) ;
+    } ;
+
+    /**
+     * A thread pool per NUMA node, pinned to the CPUs of the node.
+     */
+    class NumaThreadPools {
+    private:
+        NumaTopology                            topology_ ;
+        std::vector<std::unique_ptr<Executor>>  executors_ ;
+    public:
+        explicit NumaThreadPools (const NumaTopology &topology = NumaTopology::System ()) ;
+
+        ~NumaThreadPools () ;
+
+        NumaThreadPools (const NumaThreadPools &) = delete ;
+
+        NumaThreadPools &   operator = (const NumaThreadPools &) = delete ;
+
+        const NumaTopology &    GetTopology () const {
+            return topology_ ;
+        }
+
+        /**
+         * Executor of the node INDEX.  The thread calling `Run` joins the jobs,
+         * `ApplyTreeNuma` calls it from a thread pinned to the node.
+         */
+        Executor &  GetExecutor (size_t index) {
+            return *executors_ [index] ;
+        }
+    } ;
+
+    /**
+     * Computes the same digest as `ApplyTree`, hashing every leaf on the node holding
+     * its first page and every inner node on the node of its first child, so the
+     * leaves are read from the local memory and node local subtrees are combined
+     * before the root (hashed on the calling thread).
+     *
+     * @param param Generation parameters (the tree shape as `ApplyTree`)
+     * @param key Key to apply
+     * @param key_length Key length
+     * @param data Data to compute digest
+     * @param data_length Data length
+     * @param pools Thread pools of the nodes (nullptr: pools over NumaTopology::System (), created on the first use)
+     *
+     * @return Computed digest
+     */
+    Digest  ApplyTreeNuma ( const parameter_block_t &param
+                          , const void *key, size_t key_length
+                          , const void *data, size_t data_length
+                          , NumaThreadPools *pools = nullptr) ;
+}
+
+#endif  /* numa_hpp__2b7e4f9c1a6d4c3e9e8a5f0b7d2c6e91 */
+/*
+ * [END OF FILE]
+ */
@@ -0,0 +1,82 @@
+/*
+ * Parallel.hpp: Parallel (BLAKE2bp) and tree hashing modes.
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#pragma once
+#ifndef parallel_hpp__5c1e7a9d2b4f4e8a8d6c3b2a1f0e9d8c
+#define parallel_hpp__5c1e7a9d2b4f4e8a8d6c3b2a1f0e9d8c  1
+
+#include "BLAKE2.hpp"
+#include "BLAKE2/ThreadPool.hpp"
+
+namespace BLAKE2 {
+
+    const size_t    PARALLELISM_DEGREE = 4 ;    // # of leaves in BLAKE2bp.
+
+    /**
+     * Computes the BLAKE2bp digest.
+     *
+     * @param key Key to apply
+     * @param key_length Key length
+     * @param data Data to compute digest
+     * @param data_length Data length
+     * @param executor Executor for the leaves (nullptr: DefaultExecutor () for large inputs)
+     *
+     * @return Computed digest
+     */
+    Digest  ApplyParallel ( const void *key, size_t key_length
+                          , const void *data, size_t data_length
+                          , Executor *executor = nullptr) ;
+
+    /**
+     * Computes the BLAKE2bp digest.
+     *
+     * Only the digest length, salt and personalization of PARAM are used,
+     * the tree parameters are fixed by BLAKE2bp.
+     *
+     * @param param Generation parameters
+     * @param key Key to apply
+     * @param key_length Key length
+     * @param data Data to compute digest
+     * @param data_length Data length
+     * @param executor Executor for the leaves (nullptr: DefaultExecutor () for large inputs)
+     *
+     * @return Computed digest
+     */
+    Digest  ApplyParallel ( const parameter_block_t &param
+                          , const void *key, size_t key_length
+                          , const void *data, size_t data_length
+                          , Executor *executor = nullptr) ;
+
+    /**
+     * Computes the digest in the BLAKE2 tree hashing mode.
+     *
+     * The tree shape is taken from PARAM:
+     *   - Leaf length: # of bytes per leaf (0: whole input in one leaf)
+     *   - Fanout: # of children per inner node (0: unlimited)
+     *   - Depth: Maximal depth, the node at the maximal depth absorbs all of the lower level
+     *            (1: plain sequential mode)
+     *   - Inner length: # of bytes of the inner digests (0: 64)
+     * A level consisting of a single node is the root.
+     * The key is applied to the leaves.
+     *
+     * @param param Generation parameters
+     * @param key Key to apply
+     * @param key_length Key length
+     * @param data Data to compute digest
+     * @param data_length Data length
+     * @param executor Executor for the nodes (nullptr: DefaultExecutor () for large inputs)
+     *
+     * @return Computed digest
+     */
+    Digest  ApplyTree ( const parameter_block_t &param
+                      , const void *key, size_t key_length
+                      , const void *data, size_t data_length
+                      , Executor *executor = nullptr) ;
+}
+
+#endif  /* parallel_hpp__5c1e7a9d2b4f4e8a8d6c3b2a1f0e9d8c */
+/*
+ * [END OF FILE]
+ */
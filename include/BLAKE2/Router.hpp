@@ -0,0 +1,149 @@
+/*
+ * Router.hpp: Rendezvous and jump consistent hashing.
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#pragma once
+#ifndef router_hpp__8a4d2f7c1e6b4c9a9d3e5b0f7c2a8e16
+#define router_hpp__8a4d2f7c1e6b4c9a9d3e5b0f7c2a8e16    1
+
+#include <string>
+#include <vector>
+#include "BLAKE2.hpp"
+#include "BLAKE2/Filter.hpp"
+
+namespace BLAKE2 {
+
+    /**
+     * Highest random weight (rendezvous) router.
+     *
+     * The score of a node for a key is
+     * `Apply (Parameter (param).SetDigestLength (8), node_name, key).GetUInt64 (0)`.
+     * The chaining value after the node name (used as the key block) is kept per node,
+     * so scoring all the nodes costs one compression per node for keys up to BLOCK_SIZE
+     * bytes, 4 nodes at a time on the multi-buffer kernel.
+     * Use the salt of the parameter to separate deployments.
+     *
+     * Weighted nodes are ranked by `weight / -log (score / 2^64)`, so a node receives a
+     * share of the keys proportional to its weight.
+     */
+    class RendezvousRouter {
+    public:
+        static const size_t     NO_NODE = ~static_cast<size_t> (0) ;
+        static const size_t     MAX_NAME_LENGTH = 64 ;
+    private:
+        parameter_block_t           param_ ;
+        std::vector<std::string>    names_ ;
+        std::vector<double>         weights_ ;
+        std::vector<hash_t>         chains_ ;       // Chaining values after the node names.
+        std::vector<uint64_t>       empty_scores_ ; // Scores for the empty key.
+        bool                        weighted_ ;     // false if all the weights are equal.
+    public:
+        RendezvousRouter () ;
+
+        /**
+         * @param param Generation parameters (salt and personalization), the digest length is forced to 8
+         */
+        explicit RendezvousRouter (const parameter_block_t &param) ;
+
+        /**
+         * Adds a node.
+         *
+         * @param name Node name (1 ... MAX_NAME_LENGTH bytes, unique)
+         * @param weight Relative capacity of the node (positive)
+         *
+         * @return Index of the node
+         *
+         * @throw std::invalid_argument NAME or WEIGHT is not acceptable
+         */
+        size_t  AddNode (const std::string &name, double weight = 1.0) ;
+
+        /**
+         * Removes a node, nodes after it move down by one index.
+         * Keys of the other nodes stay where they are.
+         *
+         * @return false if NAME is not found
+         */
+        bool    RemoveNode (const std::string &name) ;
+
+        size_t  GetNodeCount () const {
+            return names_.size () ;
+        }
+
+        const std::string &     GetNodeName (size_t index) const {
+            return names_ [index] ;
+        }
+
+        /**
+         * @return Index of the node for KEY (NO_NODE if there are no nodes)
+         */
+        size_t  Route (const void *key, size_t size) const ;
+
+        /**
+         * Ranks the nodes for KEY (for replica placement).
+         *
+         * @param key Key to route
+         * @param size Key size
+         * @param count # of nodes to rank (at most GetNodeCount ())
+         * @param result Receives COUNT node indices, best first
+         */
+        void    Rank (const void *key, size_t size, size_t count, size_t *result) const ;
+
+        /**
+         * Computes the raw scores (before weighting) of all the nodes for KEY.
+         *
+         * @param scores Receives GetNodeCount () scores
+         */
+        void    Score (const void *key, size_t size, uint64_t *scores) const ;
+    private:
+        void    UpdateWeighted () ;
+
+        double  Weigh (size_t index, uint64_t score) const ;
+    } ;
+
+    /**
+     * Jump consistent hash (Lamping and Veach) over a keyed digest of the key.
+     *
+     * Needs no per node state but buckets can only be added or removed at the end.
+     */
+    class JumpRouter {
+    private:
+        FilterHash  hash_ ;
+        uint32_t    buckets_ ;
+    public:
+        JumpRouter (uint32_t buckets, const void *key, size_t key_length) ;
+
+        /**
+         * @param buckets # of buckets (positive)
+         * @param param Generation parameters of the key hash
+         * @param key Key of the key hash
+         * @param key_length Key length
+         *
+         * @throw std::invalid_argument BUCKETS is 0
+         */
+        JumpRouter (uint32_t buckets, const parameter_block_t &param, const void *key, size_t key_length) ;
+
+        uint32_t    GetBucketCount () const {
+            return buckets_ ;
+        }
+
+        JumpRouter &    SetBucketCount (uint32_t buckets) ;
+
+        uint32_t    Route (const void *data, size_t size) const ;
+
+        /**
+         * Routes COUNT keys, the keys are hashed on the multi-buffer kernel.
+         */
+        void    Route (size_t count, const void * const *data, const size_t *size, uint32_t *result) const ;
+
+        /**
+         * Maps KEY to [0, BUCKETS), only 1 / BUCKETS of the keys move when a bucket is added.
+         */
+        static uint32_t     Jump (uint64_t key, uint32_t buckets) ;
+    } ;
+}
+
+#endif  /* router_hpp__8a4d2f7c1e6b4c9a9d3e5b0f7c2a8e16 */
+/*
+ * [END OF FILE]
+ */
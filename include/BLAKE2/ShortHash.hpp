@@ -0,0 +1,98 @@
+/*
+ * ShortHash.hpp: Keyed 64bits hash for hash tables.
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#pragma once
+#ifndef shorthash_hpp__2c7f9e1a4b6d4d3e8f0a5c9b1e7d3a68
+#define shorthash_hpp__2c7f9e1a4b6d4d3e8f0a5c9b1e7d3a68    1
+
+#include <string>
+#include <type_traits>
+#include "BLAKE2.hpp"
+
+namespace BLAKE2 {
+
+    /**
+     * Keyed BLAKE2b with 8 bytes digest, as a HashDoS resistant hash for hash tables.
+     *
+     * The chaining value after the key block is computed once, so hashing a message
+     * up to BLOCK_SIZE bytes costs a single compression.
+     * The result equals the first 8 digest bytes (little-endian) of
+     * `Apply (Parameter ().SetDigestLength (8), key, key_length, data, size)`.
+     */
+    class ShortHash {
+    public:
+        static const size_t     DIGEST_LENGTH = 8 ;
+    private:
+        hash_t      keyed_ ;        // Chaining value after the key block.
+        uint64_t    empty_ ;        // Hash of the empty message.
+        bool        has_key_ ;
+    public:
+        /**
+         * Uses a random key, shared by the process.
+         */
+        ShortHash () ;
+
+        ShortHash (const void *key, size_t key_length) ;
+
+        /**
+         * @param param Generation parameters (salt and personalization), the digest length is forced to 8
+         * @param key Key to apply
+         * @param key_length Key length
+         */
+        ShortHash (const parameter_block_t &param, const void *key, size_t key_length) ;
+
+        uint64_t    Apply (const void *data, size_t size) const ;
+
+        uint64_t    operator () (const void *data, size_t size) const {
+            return Apply (data, size) ;
+        }
+    } ;
+
+    /**
+     * std::hash compatible functor for strings and trivially copyable keys.
+     *
+     * Trivially copyable keys are hashed by their object representation,
+     * so they must not have padding bytes.
+     */
+    template <typename T_, typename Enable_ = void>
+        class ShortHasher ;
+
+    template <typename T_>
+        class ShortHasher<T_, typename std::enable_if<std::is_trivially_copyable<T_>::value>::type> {
+        private:
+            ShortHash   hash_ ;
+        public:
+            ShortHasher () = default ;
+
+            explicit ShortHasher (const ShortHash &hash) : hash_ { hash } {
+                /* NO-OP */
+            }
+
+            size_t  operator () (const T_ &key) const {
+                return static_cast<size_t> (hash_.Apply (&key, sizeof (key))) ;
+            }
+        } ;
+
+    template <typename C_, typename Traits_, typename Alloc_>
+        class ShortHasher<std::basic_string<C_, Traits_, Alloc_>, void> {
+        private:
+            ShortHash   hash_ ;
+        public:
+            ShortHasher () = default ;
+
+            explicit ShortHasher (const ShortHash &hash) : hash_ { hash } {
+                /* NO-OP */
+            }
+
+            size_t  operator () (const std::basic_string<C_, Traits_, Alloc_> &key) const {
+                return static_cast<size_t> (hash_.Apply (key.data (), key.size () * sizeof (C_))) ;
+            }
+        } ;
+}
+
+#endif  /* shorthash_hpp__2c7f9e1a4b6d4d3e8f0a5c9b1e7d3a68 */
+/*
+ * [END OF FILE]
+ */
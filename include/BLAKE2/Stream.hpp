@@ -0,0 +1,123 @@
+/*
+ * Stream.hpp: std::streambuf adapters hashing the data passing through them.
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#pragma once
+#ifndef stream_hpp__5b0e8c3d9a1f4b7e8d2c6f4a0e9b3d17
+#define stream_hpp__5b0e8c3d9a1f4b7e8d2c6f4a0e9b3d17    1
+
+#include <streambuf>
+#include <vector>
+#include "BLAKE2.hpp"
+
+namespace BLAKE2 {
+
+    const size_t    DEFAULT_STREAM_BUFFER_SIZE = 64 * 1024 ;
+
+    /**
+     * Output buffer which hashes everything written through it.
+     *
+     * The put area is hashed and forwarded to the sink when it is flushed,
+     * writes larger than the buffer are hashed and forwarded without being copied.
+     *
+     *     HashOutputBuffer    buf { file.rdbuf (), Parameter ().GetParameterBlock () } ;
+     *     std::ostream        out { &buf } ;
+     *     out << archive ;
+     *     auto    digest = buf.Finalize () ;
+     */
+    class HashOutputBuffer : public std::streambuf {
+    private:
+        Generator           gen_ ;
+        std::streambuf *    sink_ ;
+        std::vector<char>   buffer_ ;
+        bool                finalized_ ;
+    public:
+        /**
+         * @param sink Receives the written data (nullptr: only hashed)
+         * @param param Generation parameters
+         * @param buffer_size Size of the put area
+         */
+        HashOutputBuffer ( std::streambuf *sink
+                         , const parameter_block_t &param
+                         , size_t buffer_size = DEFAULT_STREAM_BUFFER_SIZE)
+                : HashOutputBuffer { sink, param, nullptr, 0, buffer_size } {
+            /* NO-OP */
+        }
+
+        HashOutputBuffer ( std::streambuf *sink
+                         , const parameter_block_t &param
+                         , const void *key, size_t key_len
+                         , size_t buffer_size = DEFAULT_STREAM_BUFFER_SIZE) ;
+
+        /** Pending data is forwarded to the sink.  */
+        ~HashOutputBuffer () override ;
+
+        /**
+         * Flushes the pending data and computes the digest of everything written.
+         * Nothing can be written afterward.
+         */
+        Digest  Finalize () ;
+    protected:
+        int_type    overflow (int_type ch) override ;
+
+        int     sync () override ;
+
+        std::streamsize     xsputn (const char *s, std::streamsize n) override ;
+    private:
+        /** Hashes and forwards the put area.  */
+        bool    Flush () ;
+
+        /** Hashes and forwards DATA, returns # of bytes accepted by the sink.  */
+        std::streamsize     Forward (const char *data, std::streamsize size) ;
+    } ;
+
+    /**
+     * Input buffer which hashes everything read through it.
+     *
+     * The source is read into the get area, the bytes are hashed once they are consumed
+     * (bytes buffered but not read yet are not a part of the digest), reads larger
+     * than the buffer go straight from the source to the caller.
+     */
+    class HashInputBuffer : public std::streambuf {
+    private:
+        Generator           gen_ ;
+        std::streambuf *    source_ ;
+        std::vector<char>   buffer_ ;
+    public:
+        /**
+         * @param source Supplies the data
+         * @param param Generation parameters
+         * @param buffer_size Size of the get area
+         */
+        HashInputBuffer ( std::streambuf *source
+                        , const parameter_block_t &param
+                        , size_t buffer_size = DEFAULT_STREAM_BUFFER_SIZE)
+                : HashInputBuffer { source, param, nullptr, 0, buffer_size } {
+            /* NO-OP */
+        }
+
+        HashInputBuffer ( std::streambuf *source
+                        , const parameter_block_t &param
+                        , const void *key, size_t key_len
+                        , size_t buffer_size = DEFAULT_STREAM_BUFFER_SIZE) ;
+
+        /**
+         * Computes the digest of everything consumed so far.
+         * Nothing can be read afterward.
+         */
+        Digest  Finalize () ;
+    protected:
+        int_type    underflow () override ;
+
+        std::streamsize     xsgetn (char *s, std::streamsize n) override ;
+    private:
+        /** Hashes the consumed part of the get area and empties it.  */
+        void    Consume () ;
+    } ;
+}
+
+#endif  /* stream_hpp__5b0e8c3d9a1f4b7e8d2c6f4a0e9b3d17 */
+/*
+ * [END OF FILE]
+ */
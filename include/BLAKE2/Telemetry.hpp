@@ -0,0 +1,92 @@
+/*
+ * Telemetry.hpp: Per-thread counters of the hashing entry points.
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#pragma once
+#ifndef telemetry_hpp__8e4a1c7d2b9f4e3a9c6d0f5b2a8e7c14
+#define telemetry_hpp__8e4a1c7d2b9f4e3a9c6d0f5b2a8e7c14    1
+
+#include <array>
+#include <string>
+#include "BLAKE2.hpp"
+
+namespace BLAKE2 {
+
+    /**
+     * Hashing telemetry.
+     *
+     * Compiled in with the USE_TELEMETRY build option and collected while enabled
+     * at runtime (disabled by default), a disabled entry point costs one relaxed load.
+     * Every thread counts in its own slots, a snapshot sums the slots of the live
+     * threads and of the exited ones.
+     *
+     * Entry points:
+     *   - APPLY:       `Apply` (one call and one message per digest)
+     *   - GENERATOR:   `Generator::Update` calls, the message is recorded by `Finalize`
+     *   - BATCH:       `ApplyBatch` (one call, COUNT messages)
+     */
+    class Telemetry {
+    public:
+        enum class EntryPoint : uint8_t {
+            APPLY     = 0,
+            GENERATOR = 1,
+            BATCH     = 2,
+        } ;
+        static const size_t     ENTRY_POINT_COUNT = 3 ;
+        static const size_t     HISTOGRAM_BINS = 65 ;
+
+        struct Counters {
+            uint64_t    calls ;
+            uint64_t    bytes ;
+            uint64_t    blocks ;                // # of `Compress` runs.
+            uint64_t    finalizations ;         // # of digests.
+            /** sizes [0]: # of empty messages, sizes [I]: # of messages of [2^(I - 1), 2^I) bytes.  */
+            std::array<uint64_t, HISTOGRAM_BINS>    sizes ;
+        } ;
+
+        struct Snapshot {
+            std::array<Counters, ENTRY_POINT_COUNT>     entries ;
+
+            const Counters &    operator [] (EntryPoint ep) const {
+                return entries [static_cast<size_t> (ep)] ;
+            }
+        } ;
+    public:
+        /** true if compiled in.  */
+        static bool     IsAvailable () ;
+
+        static bool     IsEnabled () ;
+
+        /** Starts (or stops) counting, no-op unless available.  */
+        static void     SetEnabled (bool enable) ;
+
+        /** Counts since the last `Reset`.  */
+        static Snapshot     GetSnapshot () ;
+
+        static void     Reset () ;
+
+        static const char *     GetEntryPointName (EntryPoint ep) ;
+
+        /** Kernel running `Compress`.  */
+        static const char *     GetKernelName () ;
+
+        /** Kernel running the multi-buffer lanes (`ApplyBatch`).  */
+        static const char *     GetBatchKernelName () ;
+
+        /**
+         * Exports SNAPSHOT (and the kernels) as a JSON object:
+         *
+         *     { "kernel": "...", "batch_kernel": "...",
+         *       "apply": { "calls": N, "bytes": N, "blocks": N, "finalizations": N, "sizes": [ N, ... ] }, ... }
+         *
+         * Trailing empty histogram bins are omitted.
+         */
+        static std::string  ToJSON (const Snapshot &snapshot) ;
+    } ;
+}
+
+#endif  /* telemetry_hpp__8e4a1c7d2b9f4e3a9c6d0f5b2a8e7c14 */
+/*
+ * [END OF FILE]
+ */
@@ -0,0 +1,131 @@
+/*
+ * ThreadPool.hpp: Executors for the parallel hashing modes.
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#pragma once
+#ifndef threadpool_hpp__0d6b3f2e8c6a4f1e9b7a2c5d4e3f1a0b
+#define threadpool_hpp__0d6b3f2e8c6a4f1e9b7a2c5d4e3f1a0b    1
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace BLAKE2 {
+
+    /**
+     * Runs batches of independent jobs.
+     *
+     * Implement this to plug your own thread pool into the parallel hashing modes.
+     */
+    class Executor {
+    public:
+        using job_t = std::function<void (size_t)> ;
+    public:
+        virtual ~Executor () = default ;
+
+        /** # of jobs that can make progress simultaneously.  */
+        virtual size_t  GetConcurrency () const = 0 ;
+
+        /**
+         * Runs job (0) ... job (count - 1) and returns when all of them are completed.
+         * Jobs may run concurrently and in any order.
+         * The first exception thrown by a job is rethrown after all jobs are completed.
+         *
+         * @param count # of jobs
+         * @param job The job
+         */
+        virtual void    Run (size_t count, const job_t &job) = 0 ;
+    } ;
+
+    /**
+     * Runs every job on the calling thread.
+     */
+    class SequentialExecutor : public Executor {
+    public:
+        size_t  GetConcurrency () const override {
+            return 1 ;
+        }
+
+        void    Run (size_t count, const job_t &job) override {
+            for (size_t i = 0 ; i < count ; ++i) {
+                job (i) ;
+            }
+        }
+    } ;
+
+    /**
+     * Adapts a caller supplied "run this task somewhere" hook into an executor.
+     *
+     * At most (concurrency - 1) tasks are submitted per batch, the calling thread
+     * works on the batch too.
+     */
+    class FunctionExecutor : public Executor {
+    public:
+        using task_t = std::function<void ()> ;
+        using submit_t = std::function<void (task_t &&)> ;
+    private:
+        submit_t    submit_ ;
+        size_t      concurrency_ ;
+    public:
+        FunctionExecutor (submit_t submit, size_t concurrency)
+                : submit_ { std::move (submit) }
+                , concurrency_ { concurrency == 0 ? 1 : concurrency } {
+            /* NO-OP */
+        }
+
+        size_t  GetConcurrency () const override {
+            return concurrency_ ;
+        }
+
+        void    Run (size_t count, const job_t &job) override ;
+    } ;
+
+    /**
+     * Work-stealing thread pool.
+     *
+     * Every worker owns a deque of job ranges.  A worker splits ranges from the back
+     * of its own deque and idle workers steal from the front of the others.
+     */
+    class ThreadPool : public Executor {
+    private:
+        struct Impl ;
+        std::unique_ptr<Impl>   impl_ ;
+    public:
+        /**
+         * Creates a pool.
+         *
+         * @param thread_count # of worker threads (0: std::thread::hardware_concurrency ())
+         */
+        explicit ThreadPool (size_t thread_count = 0) ;
+
+        /**
+         * Creates a pool with pinned workers.
+         *
+         * @param thread_count # of worker threads (0: std::thread::hardware_concurrency ())
+         * @param affinity CPUs to pin on, worker i runs on affinity [i % affinity.size ()]
+         */
+        ThreadPool (size_t thread_count, const std::vector<int> &affinity) ;
+
+        ~ThreadPool () override ;
+
+        ThreadPool (const ThreadPool &) = delete ;
+
+        ThreadPool &    operator = (const ThreadPool &) = delete ;
+
+        size_t  GetConcurrency () const override ;
+
+        void    Run (size_t count, const job_t &job) override ;
+    } ;
+
+    /**
+     * The process wide pool used when no executor is supplied.
+     */
+    Executor &  DefaultExecutor () ;
+}
+
+#endif  /* threadpool_hpp__0d6b3f2e8c6a4f1e9b7a2c5d4e3f1a0b */
+/*
+ * [END OF FILE]
+ */
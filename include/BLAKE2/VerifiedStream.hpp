@@ -0,0 +1,135 @@
+/*
+ * VerifiedStream.hpp: Encoding verified while streaming (chaining values interleaved with the data).
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#pragma once
+#ifndef verifiedstream_hpp__6f2c9a4e1d7b4a3c8e5f0b9d2c6a7e48
+#define verifiedstream_hpp__6f2c9a4e1d7b4a3c8e5f0b9d2c6a7e48    1
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "BLAKE2.hpp"
+
+namespace BLAKE2 {
+
+    /**
+     * Binary hash tree over CHUNK_SIZE bytes chunks with the tree parameters
+     * (fanout 2, leaf length CHUNK_SIZE, inner length 64).
+     *
+     * A subtree of more than one chunk has the largest power of 2 chunks that is
+     * less than its own on the left.  A node of height H whose first chunk is C is
+     * hashed with `SetNodeDepth (H).SetNodeOffset (C >> H)`, the root is marked as the
+     * last node, so the root digest also binds the content length.
+     *
+     * The encoding is the content length (little-endian 64bits) followed by the tree in
+     * pre-order, a parent node is the chaining values of its children (128 bytes) and
+     * a leaf is the chunk itself:
+     *
+     *     length | L || R | L' || R' | chunk 0 | chunk 1 | ...
+     *
+     * so every chunk is verified as soon as it arrives.
+     * A slice keeps only the nodes on the path to a byte range.
+     */
+    class VerifiedStream {
+    public:
+        static const size_t     CHUNK_SIZE = 8192 ;
+        static const size_t     HEADER_SIZE = 8 ;
+        static const size_t     PARENT_SIZE = 2 * Digest::SIZE ;
+
+        /** Thrown when an encoding does not match the expected root.  */
+        class VerificationError : public std::runtime_error {
+        public:
+            explicit VerificationError (const std::string &msg) : std::runtime_error { msg } {
+                /* NO-OP */
+            }
+        } ;
+    public:
+        /** # of bytes of the encoding of SIZE bytes.  */
+        static uint64_t     EncodedLength (uint64_t size) ;
+
+        /** Root digest of DATA.  */
+        static Digest   Hash (const parameter_block_t &param, const void *data, size_t size) ;
+
+        /**
+         * Encodes DATA, chunks are hashed on the multi-buffer kernel.
+         *
+         * @param param Generation parameters (salt and personalization), the tree parameters are overwritten
+         * @param data Data to encode
+         * @param size Data size
+         * @param encoded Receives the encoding
+         *
+         * @return Root digest
+         */
+        static Digest   Encode (const parameter_block_t &param, const void *data, size_t size, std::vector<uint8_t> &encoded) ;
+
+        /**
+         * Extracts the nodes needed to verify [OFFSET, OFFSET + LENGTH) of the content
+         * (at least one chunk is kept, so the length is always verified).
+         *
+         * @throw std::invalid_argument ENCODED is truncated
+         */
+        static std::vector<uint8_t>     ExtractSlice (const void *encoded, size_t encoded_length, uint64_t offset, uint64_t length) ;
+    } ;
+
+    /**
+     * Incremental decoder of `VerifiedStream` encodings (or slices of them).
+     */
+    class VerifiedDecoder {
+    private:
+        struct Frame {
+            Digest      expected ;
+            uint64_t    begin ;         // Content offset of the subtree.
+            uint64_t    length ;        // Content length of the subtree.
+            bool        is_root ;
+        } ;
+    private:
+        parameter_block_t       param_ ;
+        Digest                  root_ ;
+        uint64_t                slice_begin_ ;
+        uint64_t                slice_end_ ;
+        uint64_t                content_length_ ;
+        bool                    has_header_ ;
+        std::vector<Frame>      stack_ ;
+        std::vector<uint8_t>    pending_ ;      // Partially received node.
+    public:
+        /**
+         * Decodes a whole encoding.
+         */
+        VerifiedDecoder (const parameter_block_t &param, const Digest &root) ;
+
+        /**
+         * Decodes a slice for [OFFSET, OFFSET + LENGTH).
+         */
+        VerifiedDecoder (const parameter_block_t &param, const Digest &root, uint64_t offset, uint64_t length) ;
+
+        /**
+         * Consumes the next SIZE bytes of the encoding,
+         * the verified content (within the slice) is appended to OUTPUT.
+         *
+         * @throw VerificationError A node does not match (nothing of it is appended)
+         */
+        void    Update (const void *data, size_t size, std::vector<uint8_t> &output) ;
+
+        /** true once all the nodes are verified.  */
+        bool    IsComplete () const {
+            return has_header_ && stack_.empty () ;
+        }
+
+        /** Content length (valid after the header is received).  */
+        uint64_t    GetContentLength () const {
+            return content_length_ ;
+        }
+    private:
+        /** Drops the frames outside of the slice, returns # of bytes needed by the top frame.  */
+        size_t  Next () ;
+
+        void    Consume (const uint8_t *node, std::vector<uint8_t> &output) ;
+    } ;
+}
+
+#endif  /* verifiedstream_hpp__6f2c9a4e1d7b4a3c8e5f0b9d2c6a7e48 */
+/*
+ * [END OF FILE]
+ */
@@ -0,0 +1,177 @@
+/*
+ * Adaptive.cpp: Picks the sequential, parallel (BLAKE2bp) or tree mode from the input size and the machine.
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <vector>
+#include "BLAKE2/Adaptive.hpp"
+#include "BLAKE2/Parallel.hpp"
+#include "BLAKE2/ThreadPool.hpp"
+
+#ifdef HAVE_CONFIG_H
+#   include "config.h"
+#endif
+
+namespace BLAKE2 {
+
+    namespace {
+        const size_t    MAX_KEY_LENGTH = 64 ;
+        const size_t    PROBE_LENGTH = 64 * 1024 ;  // # of bytes hashed per timing round.
+
+        using clock = std::chrono::steady_clock ;
+
+        double  elapsed_ns (clock::time_point t) {
+            return static_cast<double> (std::chrono::duration_cast<std::chrono::nanoseconds> (clock::now () - t).count ()) ;
+        }
+
+        /** Smallest power of 2 >= V, clamped into [MIN_LEAF_LENGTH, MAX_LEAF_LENGTH].  */
+        uint32_t    leaf_length_for (uint64_t v) {
+            uint64_t    L = AdaptiveHasher::MIN_LEAF_LENGTH ;
+            while (L < v && L < AdaptiveHasher::MAX_LEAF_LENGTH) {
+                L <<= 1 ;
+            }
+            return static_cast<uint32_t> (L) ;
+        }
+    }
+
+    const uint64_t  AdaptiveHasher::DEFAULT_MEASURE_NS ;
+    const uint32_t  AdaptiveHasher::MIN_LEAF_LENGTH ;
+    const uint32_t  AdaptiveHasher::MAX_LEAF_LENGTH ;
+    const size_t    AdaptiveHasher::LEAVES_PER_THREAD ;
+
+    AdaptiveHasher::AdaptiveHasher (Executor *executor) : executor_ { executor } {
+        if (executor == nullptr) {
+            static const Profile    default_profile { Measure (DefaultExecutor ()) } ;
+            profile_ = default_profile ;
+        }
+        else {
+            profile_ = Measure (*executor) ;
+        }
+    }
+
+    AdaptiveHasher::AdaptiveHasher (const Profile &profile, Executor *executor)
+            : profile_ (profile)
+            , executor_ { executor } {
+        profile_.concurrency = std::max<size_t> (1, profile_.concurrency) ;
+        profile_.bytes_per_ns = std::max (profile_.bytes_per_ns, std::numeric_limits<double>::min ()) ;
+        profile_.dispatch_ns = std::max (profile_.dispatch_ns, 0.0) ;
+    }
+
+    AdaptiveHasher::Plan    AdaptiveHasher::Choose (size_t size) const {
+        return Choose (Parameter ().GetParameterBlock (), 0, size) ;
+    }
+
+    AdaptiveHasher::Plan    AdaptiveHasher::Choose (const parameter_block_t &param, size_t key_length, size_t size) const {
+        const double    n = static_cast<double> (size) ;
+        const double    bpn = profile_.bytes_per_ns ;
+        const size_t    cores = profile_.concurrency ;
+
+        Parameter   P { param } ;
+        P.SetKeyLength (static_cast<uint8_t> (std::min (key_length, MAX_KEY_LENGTH)))
+         .SetNodeOffset (0)
+         .SetNodeDepth (0) ;
+
+        Plan    plan { Mode::SEQUENTIAL, {}, n / bpn } ;
+        P.SetFanoutCount (1).SetDepth (1).SetLeafLength (0).SetInnerLength (0) ;
+        P.CopyTo (plan.param) ;
+        if (cores < 2) {
+            return plan ;
+        }
+        {
+            const double    t = n / (bpn * std::min (PARALLELISM_DEGREE, cores)) + profile_.dispatch_ns ;
+            if (t < plan.estimated_ns) {
+                // As ApplyParallel () sets them.
+                P.SetFanoutCount (PARALLELISM_DEGREE).SetDepth (2).SetLeafLength (0).SetInnerLength (P.GetDigestLength ()) ;
+                plan = { Mode::PARALLEL, {}, t } ;
+                P.CopyTo (plan.param) ;
+            }
+        }
+        {
+            const uint32_t  L = leaf_length_for ((static_cast<uint64_t> (size) + cores * LEAVES_PER_THREAD - 1) / (cores * LEAVES_PER_THREAD)) ;
+            const uint64_t  leaves = (static_cast<uint64_t> (size) + L - 1) / L ;
+            if (1 < leaves) {
+                const double    rounds = static_cast<double> ((leaves + cores - 1) / cores) ;
+                const double    t = rounds * L / bpn + profile_.dispatch_ns + static_cast<double> (leaves * Digest::SIZE) / bpn ;
+                if (t < plan.estimated_ns) {
+                    P.SetFanoutCount (0).SetDepth (2).SetLeafLength (L).SetInnerLength (Digest::SIZE) ;
+                    plan = { Mode::TREE, {}, t } ;
+                    P.CopyTo (plan.param) ;
+                }
+            }
+        }
+        return plan ;
+    }
+
+    AdaptiveHasher::Result  AdaptiveHasher::Hash (const void *data, size_t size) const {
+        return Hash (Parameter ().GetParameterBlock (), nullptr, 0, data, size) ;
+    }
+
+    AdaptiveHasher::Result  AdaptiveHasher::Hash ( const parameter_block_t &param
+                                                 , const void *key, size_t key_length
+                                                 , const void *data, size_t size) const {
+        const size_t    k_len = (key == nullptr) ? 0 : key_length ;
+        const Plan      plan { Choose (param, k_len, size) } ;
+        Executor &      exec = (executor_ != nullptr) ? *executor_ : DefaultExecutor () ;
+        return { plan.mode, plan.param, Rehash (plan.mode, plan.param, key, k_len, data, size, &exec) } ;
+    }
+
+    AdaptiveHasher::Profile     AdaptiveHasher::Measure (Executor &executor, uint64_t budget_ns) {
+        Profile     result { std::max<size_t> (1, executor.GetConcurrency ()), 0.0, 0.0 } ;
+        std::vector<uint8_t>    probe (PROBE_LENGTH) ;
+        for (size_t i = 0 ; i < probe.size () ; ++i) {
+            probe [i] = static_cast<uint8_t> (i * 131 + 7) ;
+        }
+        // Half of the budget for each, the best round wins.
+        const double    half = static_cast<double> (budget_ns) / 2 ;
+        double  best = std::numeric_limits<double>::max () ;
+        Apply (nullptr, 0, probe.data (), probe.size ()) ;     // Warms up.
+        for (auto const start = clock::now () ; elapsed_ns (start) < half ;) {
+            const auto  t = clock::now () ;
+            Digest      D { Apply (nullptr, 0, probe.data (), probe.size ()) } ;
+            best = std::min (best, elapsed_ns (t)) ;
+            probe [0] = D.data () [0] ;
+        }
+        result.bytes_per_ns = static_cast<double> (PROBE_LENGTH) / std::max (best, 1.0) ;
+
+        best = std::numeric_limits<double>::max () ;
+        if (1 < result.concurrency) {
+            const auto  noop = [](size_t) { /* NO-OP */ } ;
+            executor.Run (result.concurrency, noop) ;
+            for (auto const start = clock::now () ; elapsed_ns (start) < half ;) {
+                const auto  t = clock::now () ;
+                executor.Run (result.concurrency, noop) ;
+                best = std::min (best, elapsed_ns (t)) ;
+            }
+            result.dispatch_ns = best ;
+        }
+        return result ;
+    }
+
+    Digest  AdaptiveHasher::Rehash ( Mode mode, const parameter_block_t &param
+                                   , const void *key, size_t key_length
+                                   , const void *data, size_t size
+                                   , Executor *executor) {
+        switch (mode) {
+        case Mode::PARALLEL:
+            return ApplyParallel (param, key, key_length, data, size, executor) ;
+        case Mode::TREE:
+            return ApplyTree (param, key, key_length, data, size, executor) ;
+        case Mode::SEQUENTIAL:
+        default:
+            return Apply (param, key, key_length, data, size) ;
+        }
+    }
+
+    bool    AdaptiveHasher::Verify ( const Result &result
+                                   , const void *key, size_t key_length
+                                   , const void *data, size_t size
+                                   , Executor *executor) {
+        return Digest::IsEqual (Rehash (result.mode, result.param, key, key_length, data, size, executor), result.digest) ;
+    }
+}       /* end of [namespace BLAKE2] */
+/*
+ * [END OF FILE]
+ */
@@ -0,0 +1,627 @@
+/*
+ * Argon2.cpp: Argon2 password hashing (RFC 9106).
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#include <cassert>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <stdexcept>
+#include "BLAKE2/Argon2.hpp"
+#include "BLAKE2/ThreadPool.hpp"
+#include "Support.h"
+
+#ifdef HAVE_CONFIG_H
+#   include "config.h"
+#endif
+
+#if defined (TARGET_HAVE_AVX2) && defined (TARGET_IS_LITTLE_ENDIAN)
+#   include "RoundAVX2.h"
+#   define USE_AVX2_BLAMKA  1
+#endif
+
+#ifdef _WIN32
+#   include <malloc.h>
+#else
+#   include <sys/mman.h>
+#endif
+
+namespace BLAKE2 {
+
+    namespace {
+        const uint32_t  SYNC_POINTS = 4 ;                   // # of slices in a pass.
+        const size_t    QWORDS_IN_BLOCK = Argon2::MEMORY_BLOCK_SIZE / 8 ;
+        const size_t    ADDRESSES_IN_BLOCK = QWORDS_IN_BLOCK ;
+        const size_t    PREHASH_DIGEST_LENGTH = 64 ;
+        const size_t    HUGE_PAGE_SIZE = 2 * 1024 * 1024 ;
+
+        struct alignas (64) Block {
+            uint64_t    v [QWORDS_IN_BLOCK] ;
+        } ;
+
+        void    load_block (Block &dst, const uint8_t *src) {
+            for (size_t i = 0 ; i < QWORDS_IN_BLOCK ; ++i) {
+                dst.v [i] = load64le (src + 8 * i) ;
+            }
+        }
+
+        void    store_block (uint8_t *dst, const Block &src) {
+            for (size_t i = 0 ; i < QWORDS_IN_BLOCK ; ++i) {
+                store64le (dst + 8 * i, src.v [i]) ;
+            }
+        }
+
+        void    update32 (Generator &g, uint32_t value) {
+            uint8_t tmp [4] ;
+            store32le (tmp, value) ;
+            g.Update (tmp, sizeof (tmp)) ;
+        }
+
+        /** memset which is not removed as a dead store.  */
+        void    wipe (void *p, size_t size) {
+#if defined (__GNUC__)
+            memset (p, 0, size) ;
+            __asm__ __volatile__ ("" : : "r" (p) : "memory") ;
+#else
+            auto volatile *     q = static_cast<volatile uint8_t *> (p) ;
+            for (size_t i = 0 ; i < size ; ++i) {
+                q [i] = 0 ;
+            }
+#endif
+        }
+
+        /** Wipes the registered regions on the scope exit, also on exceptions.  */
+        class Wiper {
+        private:
+            struct Region {
+                void *  data ;
+                size_t  size ;
+            } ;
+            Region  regions_ [8] ;
+            size_t  count_ = 0 ;
+        public:
+            Wiper () = default ;
+
+            Wiper (const Wiper &) = delete ;
+
+            Wiper &     operator = (const Wiper &) = delete ;
+
+            ~Wiper () {
+                for (size_t i = 0 ; i < count_ ; ++i) {
+                    wipe (regions_ [i].data, regions_ [i].size) ;
+                }
+            }
+
+            void    Add (void *data, size_t size) {
+                assert (count_ < sizeof (regions_) / sizeof (regions_ [0])) ;
+                regions_ [count_++] = { data, size } ;
+            }
+        } ;
+
+        /**
+         * The variable length hash function H'.
+         */
+        void    hash_long (void *output, size_t output_length, const void *input, size_t input_length) {
+            auto *  out = static_cast<uint8_t *> (output) ;
+
+            if (output_length <= Digest::SIZE) {
+                Generator   g { Parameter ().SetDigestLength (static_cast<uint8_t> (output_length)).GetParameterBlock () } ;
+                update32 (g, static_cast<uint32_t> (output_length)) ;
+                g.Update (input, input_length) ;
+                auto    V = g.Finalize () ;
+                memcpy (out, V.data (), output_length) ;
+                return ;
+            }
+            const size_t    half = Digest::SIZE / 2 ;
+            const size_t    r = (output_length + half - 1) / half - 2 ;
+
+            Generator   g { Parameter ().GetParameterBlock () } ;
+            update32 (g, static_cast<uint32_t> (output_length)) ;
+            g.Update (input, input_length) ;
+            auto    V = g.Finalize () ;
+            memcpy (out, V.data (), half) ;
+            out += half ;
+            for (size_t i = 1 ; i < r ; ++i) {
+                V = Apply (Parameter ().GetParameterBlock (), nullptr, 0, V.data (), V.size ()) ;
+                memcpy (out, V.data (), half) ;
+                out += half ;
+            }
+            const size_t    last = output_length - half * r ;
+            V = Apply ( Parameter ().SetDigestLength (static_cast<uint8_t> (last)).GetParameterBlock ()
+                      , nullptr, 0, V.data (), V.size ()) ;
+            memcpy (out, V.data (), last) ;
+        }
+
+#ifdef USE_AVX2_BLAMKA
+        using namespace AVX2 ;
+
+        /** x + y + 2 * lo32 (x) * lo32 (y) for every lane.  */
+        TARGET_AVX2 inline __m256i  fBlaMka (__m256i x, __m256i y) {
+            __m256i z = _mm256_mul_epu32 (x, y) ;
+            return _mm256_add_epi64 (_mm256_add_epi64 (x, y), _mm256_add_epi64 (z, z)) ;
+        }
+
+        TARGET_AVX2 inline void     blamka_half (__m256i &a, __m256i &b, __m256i &c, __m256i &d) {
+            a = fBlaMka (a, b) ;
+            d = rotr32 (_mm256_xor_si256 (d, a)) ;
+            c = fBlaMka (c, d) ;
+            b = rotr24 (_mm256_xor_si256 (b, c)) ;
+            a = fBlaMka (a, b) ;
+            d = rotr16 (_mm256_xor_si256 (d, a)) ;
+            c = fBlaMka (c, d) ;
+            b = rotr63 (_mm256_xor_si256 (b, c)) ;
+        }
+
+        /**
+         * The permutation P on 16 words held in A (v0 ... v3), B (v4 ... v7), C and D.
+         * Same shape as the BLAKE2b round, diagonals are made with lane rotations.
+         */
+        TARGET_AVX2 inline void     blamka_round (__m256i &a, __m256i &b, __m256i &c, __m256i &d) {
+            blamka_half (a, b, c, d) ;
+            b = rotate_lanes1 (b) ;
+            c = rotate_lanes2 (c) ;
+            d = rotate_lanes3 (d) ;
+            blamka_half (a, b, c, d) ;
+            b = rotate_lanes3 (b) ;
+            c = rotate_lanes2 (c) ;
+            d = rotate_lanes1 (d) ;
+        }
+
+        /** `compress_block` on the 256bits registers (a row in 4 of them).  */
+        TARGET_AVX2 void    compress_block_avx2 (const Block &prev, const Block &ref, Block &next, bool with_xor) {
+            __m256i R [32] ;
+            __m256i T [32] ;
+            auto const *    p = reinterpret_cast<const __m256i *> (prev.v) ;
+            auto const *    q = reinterpret_cast<const __m256i *> (ref.v) ;
+            auto *          n = reinterpret_cast<__m256i *> (next.v) ;
+
+            for (size_t i = 0 ; i < 32 ; ++i) {
+                R [i] = _mm256_xor_si256 (_mm256_load_si256 (p + i), _mm256_load_si256 (q + i)) ;
+            }
+            if (with_xor) {
+                for (size_t i = 0 ; i < 32 ; ++i) {
+                    T [i] = _mm256_xor_si256 (R [i], _mm256_load_si256 (n + i)) ;
+                }
+            }
+            else {
+                for (size_t i = 0 ; i < 32 ; ++i) {
+                    T [i] = R [i] ;
+                }
+            }
+            // Rows: words 16 i ... 16 i + 15.
+            for (size_t i = 0 ; i < 8 ; ++i) {
+                blamka_round (R [4 * i + 0], R [4 * i + 1], R [4 * i + 2], R [4 * i + 3]) ;
+            }
+            // Columns: word pairs (16 i + 2 j, 16 i + 2 j + 1), columns 2 c and 2 c + 1 share R [4 i + c].
+            for (size_t c = 0 ; c < 4 ; ++c) {
+                __m256i lo [4] ;
+                __m256i hi [4] ;
+                for (size_t k = 0 ; k < 4 ; ++k) {
+                    __m256i x = R [4 * (2 * k + 0) + c] ;
+                    __m256i y = R [4 * (2 * k + 1) + c] ;
+                    lo [k] = _mm256_permute2x128_si256 (x, y, 0x20) ;
+                    hi [k] = _mm256_permute2x128_si256 (x, y, 0x31) ;
+                }
+                blamka_round (lo [0], lo [1], lo [2], lo [3]) ;
+                blamka_round (hi [0], hi [1], hi [2], hi [3]) ;
+                for (size_t k = 0 ; k < 4 ; ++k) {
+                    R [4 * (2 * k + 0) + c] = _mm256_permute2x128_si256 (lo [k], hi [k], 0x20) ;
+                    R [4 * (2 * k + 1) + c] = _mm256_permute2x128_si256 (lo [k], hi [k], 0x31) ;
+                }
+            }
+            for (size_t i = 0 ; i < 32 ; ++i) {
+                _mm256_store_si256 (n + i, _mm256_xor_si256 (T [i], R [i])) ;
+            }
+        }
+#endif  /* USE_AVX2_BLAMKA */
+
+        inline uint64_t rotr (uint64_t value, int cnt) {
+            return (value >> cnt) | (value << (64 - cnt)) ;
+        }
+
+        inline uint64_t fBlaMka (uint64_t x, uint64_t y) {
+            const uint64_t  m = 0xFFFFFFFFu ;
+            return x + y + 2 * ((x & m) * (y & m)) ;
+        }
+
+#define GB(A_, B_, C_, D_)      do {    \
+        (A_) = fBlaMka ((A_), (B_)) ;   \
+        (D_) = rotr ((D_) ^ (A_), 32) ; \
+        (C_) = fBlaMka ((C_), (D_)) ;   \
+        (B_) = rotr ((B_) ^ (C_), 24) ; \
+        (A_) = fBlaMka ((A_), (B_)) ;   \
+        (D_) = rotr ((D_) ^ (A_), 16) ; \
+        (C_) = fBlaMka ((C_), (D_)) ;   \
+        (B_) = rotr ((B_) ^ (C_), 63) ; \
+    } while (0)
+
+        /**
+         * The permutation P on v [x [0]] ... v [x [15]].
+         */
+        inline void     blamka_round (uint64_t *v, const size_t x [16]) {
+            GB (v [x [ 0]], v [x [ 4]], v [x [ 8]], v [x [12]]) ;
+            GB (v [x [ 1]], v [x [ 5]], v [x [ 9]], v [x [13]]) ;
+            GB (v [x [ 2]], v [x [ 6]], v [x [10]], v [x [14]]) ;
+            GB (v [x [ 3]], v [x [ 7]], v [x [11]], v [x [15]]) ;
+            GB (v [x [ 0]], v [x [ 5]], v [x [10]], v [x [15]]) ;
+            GB (v [x [ 1]], v [x [ 6]], v [x [11]], v [x [12]]) ;
+            GB (v [x [ 2]], v [x [ 7]], v [x [ 8]], v [x [13]]) ;
+            GB (v [x [ 3]], v [x [ 4]], v [x [ 9]], v [x [14]]) ;
+        }
+#undef  GB
+
+        /** `compress_block` in plain C++.  */
+        void    compress_block_generic (const Block &prev, const Block &ref, Block &next, bool with_xor) {
+            Block   R ;
+            Block   T ;
+            for (size_t i = 0 ; i < QWORDS_IN_BLOCK ; ++i) {
+                R.v [i] = prev.v [i] ^ ref.v [i] ;
+                T.v [i] = with_xor ? (R.v [i] ^ next.v [i]) : R.v [i] ;
+            }
+            for (size_t i = 0 ; i < 8 ; ++i) {
+                size_t  x [16] ;
+                for (size_t k = 0 ; k < 16 ; ++k) {
+                    x [k] = 16 * i + k ;
+                }
+                blamka_round (R.v, x) ;
+            }
+            for (size_t i = 0 ; i < 8 ; ++i) {
+                size_t  x [16] ;
+                for (size_t k = 0 ; k < 8 ; ++k) {
+                    x [2 * k + 0] = 16 * k + 2 * i + 0 ;
+                    x [2 * k + 1] = 16 * k + 2 * i + 1 ;
+                }
+                blamka_round (R.v, x) ;
+            }
+            for (size_t i = 0 ; i < QWORDS_IN_BLOCK ; ++i) {
+                next.v [i] = T.v [i] ^ R.v [i] ;
+            }
+        }
+
+        /**
+         * The compression function G, NEXT = G (PREV, REF) (^ NEXT when WITH_XOR).
+         */
+        void    compress_block (const Block &prev, const Block &ref, Block &next, bool with_xor) {
+#ifdef USE_AVX2_BLAMKA
+            static const bool   has_avx2 = __builtin_cpu_supports ("avx2") ;
+            if (has_avx2) {
+                compress_block_avx2 (prev, ref, next, with_xor) ;
+                return ;
+            }
+#endif
+            compress_block_generic (prev, ref, next, with_xor) ;
+        }
+
+        /**
+         * Shape of the memory for a single hash.
+         */
+        struct Instance {
+            Block *         memory ;
+            Argon2::Type    type ;
+            uint32_t        passes ;
+            uint32_t        lanes ;
+            uint32_t        memory_blocks ;
+            uint32_t        lane_length ;
+            uint32_t        segment_length ;
+
+            /**
+             * Maps the pseudo random value to the reference block index in the lane.
+             */
+            uint32_t    IndexAlpha (uint32_t pass, uint32_t slice, uint32_t index, uint32_t pseudo_rand, bool same_lane) const {
+                uint32_t    area ;
+                if (pass == 0) {
+                    if (slice == 0) {
+                        area = index - 1 ;
+                    }
+                    else if (same_lane) {
+                        area = slice * segment_length + index - 1 ;
+                    }
+                    else {
+                        area = slice * segment_length + (index == 0 ? static_cast<uint32_t> (-1) : 0) ;
+                    }
+                }
+                else {
+                    if (same_lane) {
+                        area = lane_length - segment_length + index - 1 ;
+                    }
+                    else {
+                        area = lane_length - segment_length + (index == 0 ? static_cast<uint32_t> (-1) : 0) ;
+                    }
+                }
+                uint64_t    rel = pseudo_rand ;
+                rel = (rel * rel) >> 32 ;
+                rel = area - 1 - ((area * rel) >> 32) ;
+                uint32_t    start = 0 ;
+                if (pass != 0 && slice != SYNC_POINTS - 1) {
+                    start = (slice + 1) * segment_length ;
+                }
+                return static_cast<uint32_t> ((start + rel) % lane_length) ;
+            }
+
+            void    FillSegment (uint32_t pass, uint32_t slice, uint32_t lane) const {
+                const bool  independent = (type == Argon2::Type::I)
+                                       || (type == Argon2::Type::ID && pass == 0 && slice < SYNC_POINTS / 2) ;
+                static const Block  zero {} ;
+                Block   input {} ;
+                Block   address ;
+
+                auto next_addresses = [&input, &address] {
+                    ++input.v [6] ;
+                    compress_block (zero, input, address, false) ;
+                    compress_block (zero, address, address, false) ;
+                } ;
+                if (independent) {
+                    input.v [0] = pass ;
+                    input.v [1] = lane ;
+                    input.v [2] = slice ;
+                    input.v [3] = memory_blocks ;
+                    input.v [4] = passes ;
+                    input.v [5] = static_cast<uint32_t> (type) ;
+                }
+                uint32_t    start = 0 ;
+                if (pass == 0 && slice == 0) {
+                    start = 2 ;     // B [i][0] and B [i][1] are made from H0.
+                    if (independent) {
+                        next_addresses () ;
+                    }
+                }
+                uint32_t    cur = lane * lane_length + slice * segment_length + start ;
+                uint32_t    prev = (cur % lane_length == 0) ? cur + lane_length - 1 : cur - 1 ;
+
+                for (uint32_t i = start ; i < segment_length ; ++i, ++cur, ++prev) {
+                    if (cur % lane_length == 1) {
+                        prev = cur - 1 ;
+                    }
+                    uint64_t    pseudo_rand ;
+                    if (independent) {
+                        if (i % ADDRESSES_IN_BLOCK == 0) {
+                            next_addresses () ;
+                        }
+                        pseudo_rand = address.v [i % ADDRESSES_IN_BLOCK] ;
+                    }
+                    else {
+                        pseudo_rand = memory [prev].v [0] ;
+                    }
+                    uint32_t    ref_lane = static_cast<uint32_t> ((pseudo_rand >> 32) % lanes) ;
+                    if (pass == 0 && slice == 0) {
+                        ref_lane = lane ;
+                    }
+                    uint32_t    ref_index = IndexAlpha ( pass, slice, i
+                                                       , static_cast<uint32_t> (pseudo_rand)
+                                                       , ref_lane == lane) ;
+                    compress_block ( memory [prev]
+                                   , memory [static_cast<size_t> (ref_lane) * lane_length + ref_index]
+                                   , memory [cur]
+                                   , pass != 0) ;
+                }
+            }
+        } ;
+    }
+
+    /**
+     * Block memory kept between hashes.
+     *
+     * Large arenas are 2 MiB aligned and advised for transparent huge pages,
+     * a random access over the whole arena would thrash the TLB otherwise.
+     */
+    class Argon2::Arena {
+    private:
+        void *  base_ ;
+        size_t  size_ ;
+    public:
+        Arena () : base_ { nullptr }, size_ { 0 } {
+            /* NO-OP */
+        }
+
+        ~Arena () {
+            Release () ;
+        }
+
+        void *  Reserve (size_t size) {
+            if (size <= size_) {
+                return base_ ;
+            }
+            Release () ;
+#ifdef _WIN32
+            base_ = _aligned_malloc (size, HUGE_PAGE_SIZE) ;
+            if (base_ == nullptr) {
+                throw std::bad_alloc {} ;
+            }
+            size_ = size ;
+#else
+            size_t  length = (size + 4095) & ~size_t { 4095 } ;
+            if (HUGE_PAGE_SIZE <= size) {
+                length = (size + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1) ;
+                // Over-allocates and trims for the alignment.
+                void *  p = mmap (nullptr, length + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0) ;
+                if (p == MAP_FAILED) {
+                    throw std::bad_alloc {} ;
+                }
+                auto    addr = reinterpret_cast<uintptr_t> (p) ;
+                auto    aligned = (addr + HUGE_PAGE_SIZE - 1) & ~uintptr_t { HUGE_PAGE_SIZE - 1 } ;
+                if (addr < aligned) {
+                    munmap (p, aligned - addr) ;
+                }
+                munmap (reinterpret_cast<void *> (aligned + length), HUGE_PAGE_SIZE - (aligned - addr)) ;
+                base_ = reinterpret_cast<void *> (aligned) ;
+#   ifdef MADV_HUGEPAGE
+                madvise (base_, length, MADV_HUGEPAGE) ;
+#   endif
+            }
+            else {
+                void *  p = mmap (nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0) ;
+                if (p == MAP_FAILED) {
+                    throw std::bad_alloc {} ;
+                }
+                base_ = p ;
+            }
+            size_ = length ;
+#endif
+            return base_ ;
+        }
+
+        void    Release () {
+            if (base_ == nullptr) {
+                return ;
+            }
+#ifdef _WIN32
+            _aligned_free (base_) ;
+#else
+            munmap (base_, size_) ;
+#endif
+            base_ = nullptr ;
+            size_ = 0 ;
+        }
+    } ;
+
+    const uint32_t  Argon2::VERSION ;
+    const size_t    Argon2::MEMORY_BLOCK_SIZE ;
+    const size_t    Argon2::MIN_SALT_LENGTH ;
+    const size_t    Argon2::MIN_TAG_LENGTH ;
+
+    Argon2::Argon2 (Type type)
+            : type_ { type }
+            , iterations_ { 3 }
+            , memory_cost_ { 64 * 1024 }
+            , lanes_ { 4 }
+            , executor_ { nullptr }
+            , arena_ { std::make_unique<Arena> () } {
+        /* NO-OP */
+    }
+
+    Argon2::~Argon2 () = default ;
+
+    Argon2 &    Argon2::SetSecret (const void *data, size_t length) {
+        auto const *    p = static_cast<const uint8_t *> (data) ;
+        secret_.assign (p, p + length) ;
+        return *this ;
+    }
+
+    Argon2 &    Argon2::SetAssociatedData (const void *data, size_t length) {
+        auto const *    p = static_cast<const uint8_t *> (data) ;
+        associated_data_.assign (p, p + length) ;
+        return *this ;
+    }
+
+    void    Argon2::Hash ( const void *password, size_t password_length
+                         , const void *salt, size_t salt_length
+                         , void *tag, size_t tag_length) {
+        const size_t    max_length = std::numeric_limits<uint32_t>::max () ;
+        if (lanes_ < 1 || 0xFFFFFFu < lanes_) {
+            throw std::invalid_argument { "Argon2: lanes out of range" } ;
+        }
+        if (iterations_ < 1) {
+            throw std::invalid_argument { "Argon2: iterations out of range" } ;
+        }
+        if (memory_cost_ < 2 * SYNC_POINTS * lanes_) {
+            throw std::invalid_argument { "Argon2: memory cost too small" } ;
+        }
+        if (salt_length < MIN_SALT_LENGTH || max_length < salt_length) {
+            throw std::invalid_argument { "Argon2: salt length out of range" } ;
+        }
+        if (tag_length < MIN_TAG_LENGTH || max_length < tag_length) {
+            throw std::invalid_argument { "Argon2: tag length out of range" } ;
+        }
+        if (max_length < password_length) {
+            throw std::invalid_argument { "Argon2: password too long" } ;
+        }
+        Instance    I ;
+        I.type = type_ ;
+        I.passes = iterations_ ;
+        I.lanes = lanes_ ;
+        I.segment_length = memory_cost_ / (SYNC_POINTS * lanes_) ;
+        I.lane_length = I.segment_length * SYNC_POINTS ;
+        I.memory_blocks = I.lane_length * lanes_ ;
+        if (std::numeric_limits<size_t>::max () / MEMORY_BLOCK_SIZE < I.memory_blocks) {
+            throw std::invalid_argument { "Argon2: memory cost too large" } ;
+        }
+        const size_t    memory_size = static_cast<size_t> (I.memory_blocks) * MEMORY_BLOCK_SIZE ;
+        I.memory = static_cast<Block *> (arena_->Reserve (memory_size)) ;
+
+        // The memory outlives this call, do not leave password derived data behind.
+        Digest      H0 ;
+        uint8_t     seed [PREHASH_DIGEST_LENGTH + 8] ;
+        uint8_t     bytes [MEMORY_BLOCK_SIZE] ;
+        Block       C ;
+        Wiper       wiper ;
+        wiper.Add (I.memory, memory_size) ;
+        wiper.Add (&H0, sizeof (H0)) ;
+        wiper.Add (seed, sizeof (seed)) ;
+        wiper.Add (bytes, sizeof (bytes)) ;
+        wiper.Add (&C, sizeof (C)) ;
+
+        // H0
+        {
+            Generator   g { Parameter ().GetParameterBlock () } ;
+            update32 (g, lanes_) ;
+            update32 (g, static_cast<uint32_t> (tag_length)) ;
+            update32 (g, memory_cost_) ;
+            update32 (g, iterations_) ;
+            update32 (g, VERSION) ;
+            update32 (g, static_cast<uint32_t> (type_)) ;
+            update32 (g, static_cast<uint32_t> (password_length)) ;
+            g.Update (password, password_length) ;
+            update32 (g, static_cast<uint32_t> (salt_length)) ;
+            g.Update (salt, salt_length) ;
+            update32 (g, static_cast<uint32_t> (secret_.size ())) ;
+            g.Update (secret_.data (), secret_.size ()) ;
+            update32 (g, static_cast<uint32_t> (associated_data_.size ())) ;
+            g.Update (associated_data_.data (), associated_data_.size ()) ;
+            H0 = g.Finalize () ;
+            memcpy (seed, H0.data (), PREHASH_DIGEST_LENGTH) ;
+        }
+        for (uint32_t l = 0 ; l < lanes_ ; ++l) {
+            for (uint32_t j = 0 ; j < 2 ; ++j) {
+                store32le (&seed [PREHASH_DIGEST_LENGTH + 0], j) ;
+                store32le (&seed [PREHASH_DIGEST_LENGTH + 4], l) ;
+                hash_long (bytes, sizeof (bytes), seed, sizeof (seed)) ;
+                load_block (I.memory [static_cast<size_t> (l) * I.lane_length + j], bytes) ;
+            }
+        }
+
+        static SequentialExecutor   sequential ;
+        Executor &  executor = (executor_ != nullptr) ? *executor_ : (1 < lanes_ ? DefaultExecutor () : sequential) ;
+        for (uint32_t pass = 0 ; pass < I.passes ; ++pass) {
+            for (uint32_t slice = 0 ; slice < SYNC_POINTS ; ++slice) {
+                // Segments of a slice never reference each other.
+                executor.Run (lanes_, [&I, pass, slice](size_t lane) {
+                    I.FillSegment (pass, slice, static_cast<uint32_t> (lane)) ;
+                }) ;
+            }
+        }
+
+        C = I.memory [I.lane_length - 1] ;
+        for (uint32_t l = 1 ; l < lanes_ ; ++l) {
+            const Block &   B = I.memory [static_cast<size_t> (l) * I.lane_length + I.lane_length - 1] ;
+            for (size_t i = 0 ; i < QWORDS_IN_BLOCK ; ++i) {
+                C.v [i] ^= B.v [i] ;
+            }
+        }
+        store_block (bytes, C) ;
+        hash_long (tag, tag_length, bytes, sizeof (bytes)) ;
+    }
+
+    std::vector<uint8_t>    Argon2::Hash ( const void *password, size_t password_length
+                                         , const void *salt, size_t salt_length
+                                         , size_t tag_length) {
+        std::vector<uint8_t>    result (tag_length) ;
+        Hash (password, password_length, salt, salt_length, result.data (), result.size ()) ;
+        return result ;
+    }
+
+    bool    Argon2::Verify ( const void *password, size_t password_length
+                           , const void *salt, size_t salt_length
+                           , const void *tag, size_t tag_length) {
+        auto    actual = Hash (password, password_length, salt, salt_length, tag_length) ;
+        auto const *    expected = static_cast<const uint8_t *> (tag) ;
+        uint8_t     diff = 0 ;
+        for (size_t i = 0 ; i < tag_length ; ++i) {
+            diff |= static_cast<uint8_t> (actual [i] ^ expected [i]) ;
+        }
+        return diff == 0 ;
+    }
+}       /* end of [namespace BLAKE2] */
+/*
+ * [END OF FILE]
+ */
@@ -0,0 +1,83 @@
+/*
+ * Async.cpp: Incremental hashing in bounded slices.
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#include <algorithm>
+#include <stdexcept>
+#include "BLAKE2/Async.hpp"
+
+#ifdef HAVE_CONFIG_H
+#   include "config.h"
+#endif
+
+namespace BLAKE2 {
+
+    AsyncGenerator &    AsyncGenerator::Enqueue (const void *data, size_t size) {
+        if (0 < size) {
+            pending_.push_back (Fragment { static_cast<const uint8_t *> (data), size }) ;
+        }
+        return *this ;
+    }
+
+    bool    AsyncGenerator::Step () {
+        size_t  budget = slice_size_ ;
+        while (0 < budget && ! pending_.empty ()) {
+            auto &  F = pending_.front () ;
+            size_t  n = std::min (budget, F.size) ;
+            gen_.Update (F.data, n) ;
+            F.data += n ;
+            F.size -= n ;
+            budget -= n ;
+            if (F.size == 0) {
+                pending_.pop_front () ;
+            }
+        }
+        return ! pending_.empty () ;
+    }
+
+    size_t  AsyncGenerator::GetPendingSize () const {
+        size_t  result = 0 ;
+        for (auto const &F : pending_) {
+            result += F.size ;
+        }
+        return result ;
+    }
+
+    void    AsyncGenerator::Update (const void *data, size_t size, scheduler_t scheduler, completion_t done) {
+        Start () ;
+        Enqueue (data, size) ;
+        Drive (std::move (scheduler), std::move (done)) ;
+    }
+
+    void    AsyncGenerator::Finalize (scheduler_t scheduler, digest_callback_t done) {
+        Start () ;
+        Drive (std::move (scheduler), [this, done] {
+            done (gen_.Finalize ()) ;
+        }) ;
+    }
+
+    void    AsyncGenerator::Start () {
+        // Two drives would step the same queue, a Finalize could overtake an Update.
+        if (driving_) {
+            throw std::logic_error { "AsyncGenerator: already driven" } ;
+        }
+        driving_ = true ;
+    }
+
+    void    AsyncGenerator::Drive (scheduler_t scheduler, completion_t done) {
+        auto    sched = scheduler ;
+        sched ([this, scheduler, done] () {
+            if (Step ()) {
+                Drive (scheduler, done) ;
+            }
+            else {
+                driving_ = false ;      // DONE may start the next one.
+                done () ;
+            }
+        }) ;
+    }
+}       /* end of [namespace BLAKE2] */
+/*
+ * [END OF FILE]
+ */
@@ -4,9 +4,13 @@
  * Copyright (c) 2015-2016 Masashi Fujita
  */
 #include <algorithm>
+#include <atomic>
 #include <new>
 #include <type_traits>
 #include "BLAKE2.hpp"
+#include "Kernel.h"
+#include "Probes.h"
+#include "Telemetry.h"
 
 #ifdef HAVE_CONFIG_H
 #   include "config.h"
@@ -16,15 +20,60 @@
 #   include <immintrin.h>
 #endif
 
+#ifdef TARGET_HAVE_AVX2
+    // Only the AVX2 kernel is compiled for AVX2, the library stays runnable everywhere.
+#   define TARGET_AVX2  __attribute__ ((target ("avx2")))
+#endif
+
+#if defined (__SSE2__)
+#   include <emmintrin.h>
+#   define USE_STREAMING_STORE  1
+#endif
+
 namespace {
     const size_t    MAX_KEY_LENGTH = 64 ;
+    const size_t    COPY_CHUNK_SIZE = 4096 ;                // Hashed while the chunk is in L1.
+    const size_t    NON_TEMPORAL_THRESHOLD = 256 * 1024 ;   // Larger copies would not stay in the cache anyway.
+
+    /**
+     * memcpy with non-temporal stores.  Call `stream_fence` after the last copy.
+     */
+    void    stream_copy (uint8_t *dst, const uint8_t *src, size_t size) {
+#ifdef USE_STREAMING_STORE
+        size_t  head = (16 - (reinterpret_cast<uintptr_t> (dst) & 15)) & 15 ;
+        if (size < head) {
+            head = size ;
+        }
+        memcpy (dst, src, head) ;
+        dst += head ;
+        src += head ;
+        size -= head ;
+        for ( ; 64 <= size ; size -= 64, src += 64, dst += 64) {
+            __m128i v0 = _mm_loadu_si128 (reinterpret_cast<const __m128i *> (src +  0)) ;
+            __m128i v1 = _mm_loadu_si128 (reinterpret_cast<const __m128i *> (src + 16)) ;
+            __m128i v2 = _mm_loadu_si128 (reinterpret_cast<const __m128i *> (src + 32)) ;
+            __m128i v3 = _mm_loadu_si128 (reinterpret_cast<const __m128i *> (src + 48)) ;
+            _mm_stream_si128 (reinterpret_cast<__m128i *> (dst +  0), v0) ;
+            _mm_stream_si128 (reinterpret_cast<__m128i *> (dst + 16), v1) ;
+            _mm_stream_si128 (reinterpret_cast<__m128i *> (dst + 32), v2) ;
+            _mm_stream_si128 (reinterpret_cast<__m128i *> (dst + 48), v3) ;
+        }
+#endif
+        memcpy (dst, src, size) ;
+    }
+
+    void    stream_fence () {
+#ifdef USE_STREAMING_STORE
+        _mm_sfence () ;
+#endif
+    }
 
 #ifdef TARGET_HAVE_AVX2
     constexpr __m128i    to__m128i (int v0, int v1, int v2, int v3) noexcept {
         return (__m128i)(__v4si){ v0, v1, v2, v3 } ;
     }
 
-    const __m128i    sigma [12][4] = {
+    const __m128i    sigma_avx2 [12][4] = {
         { to__m128i ( 0,  2,  4,  6), to__m128i ( 1,  3,  5,  7), to__m128i ( 8, 10, 12, 14), to__m128i ( 9, 11, 13, 15) },
         { to__m128i (14,  4,  9, 13), to__m128i (10,  8, 15,  6), to__m128i ( 1,  0, 11,  5), to__m128i (12,  2,  7,  3) },
         { to__m128i (11, 12,  5, 15), to__m128i ( 8,  0,  2, 13), to__m128i (10,  3,  7,  9), to__m128i (14,  6,  1,  4) },
@@ -38,7 +87,7 @@ namespace {
         { to__m128i ( 0,  2,  4,  6), to__m128i ( 1,  3,  5,  7), to__m128i ( 8, 10, 12, 14), to__m128i ( 9, 11, 13, 15) },
         { to__m128i (14,  4,  9, 13), to__m128i (10,  8, 15,  6), to__m128i ( 1,  0, 11,  5), to__m128i (12,  2,  7,  3) }
     } ;
-#else
+#endif
     const uint8_t    sigma [12][16] = {
         {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 } ,
         { 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 } ,
@@ -54,7 +103,6 @@ namespace {
         {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 } ,        // Same as sigma [0]
         { 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 }
     } ;
-#endif
     const uint64_t  IV0 = 0x6a09e667f3bcc908ULL ;
     const uint64_t  IV1 = 0xbb67ae8584caa73bULL ;
     const uint64_t  IV2 = 0x3c6ef372fe94f82bULL ;
@@ -173,23 +221,23 @@ namespace BLAKE2 {
                     | ((v3 & 3) << 6));
         }
 
-        inline __m256i  rotr32 (__m256i x) {
+        TARGET_AVX2 inline __m256i  rotr32 (__m256i x) {
             return _mm256_shuffle_epi32 (x, maskgen (1, 0, 3, 2));
         }
 
-        inline __m256i  rotr24 (__m256i x) {
+        TARGET_AVX2 inline __m256i  rotr24 (__m256i x) {
             return _mm256_or_si256 (_mm256_srli_epi64 (x, 24), _mm256_slli_epi64 (x, 64 - 24));
         }
 
-        inline __m256i  rotr16 (__m256i x) {
+        TARGET_AVX2 inline __m256i  rotr16 (__m256i x) {
             return _mm256_or_si256 (_mm256_srli_epi64 (x, 16), _mm256_slli_epi64 (x, 64 - 16));
         }
 
-        inline __m256i  rotr63 (__m256i x) {
+        TARGET_AVX2 inline __m256i  rotr63 (__m256i x) {
             return _mm256_or_si256 (_mm256_srli_epi64 (x, 63), _mm256_slli_epi64 (x, 64 - 63));
         }
 
-        inline __m256i  ror256x64 (__m256i x, int count) {
+        TARGET_AVX2 inline __m256i  ror256x64 (__m256i x, int count) {
             switch (count & 3) {
             case 3: return _mm256_permute4x64_epi64 (x, maskgen (3, 0, 1, 2));
             case 2: return _mm256_permute4x64_epi64 (x, maskgen (2, 3, 0, 1));
@@ -202,7 +250,7 @@ namespace BLAKE2 {
             return x;
         }
 
-        inline __m256i  rol256x64 (__m256i x, int count) {
+        TARGET_AVX2 inline __m256i  rol256x64 (__m256i x, int count) {
             switch (count & 3) {
             case 3: return _mm256_permute4x64_epi64 (x, maskgen (1, 2, 3, 0));
             case 2: return _mm256_permute4x64_epi64 (x, maskgen (2, 3, 0, 1));
@@ -214,14 +262,40 @@ namespace BLAKE2 {
             assert (false);
             return x;
         }
+
+        TARGET_AVX2 inline void     round_avx2 (const uint64_t *m, __m256i &r0, __m256i &r1, __m256i &r2, __m256i &r3, int r) {
+            r0 = _mm256_add_epi64 (r0, _mm256_add_epi64 (r1, _mm256_i32gather_epi64 ((const long long *)m, sigma_avx2 [r][0], 8))) ;
+            r3 = rotr32 (_mm256_xor_si256 (r3, r0)) ;
+            r2 = _mm256_add_epi64 (r2, r3) ;
+            r1 = rotr24 (_mm256_xor_si256 (r1, r2)) ;
+            r0 = _mm256_add_epi64 (r0, _mm256_add_epi64 (r1, _mm256_i32gather_epi64 ((const long long *)m, sigma_avx2 [r][1], 8))) ;
+            r3 = rotr16 (_mm256_xor_si256 (r3, r0)) ;
+            r2 = _mm256_add_epi64 (r2, r3) ;
+            r1 = rotr63 (_mm256_xor_si256 (r1, r2)) ;
+            r1 = ror256x64 (r1, 1) ;
+            r2 = ror256x64 (r2, 2) ;
+            r3 = ror256x64 (r3, 3) ;
+            r0 = _mm256_add_epi64 (r0, _mm256_add_epi64 (r1, _mm256_i32gather_epi64 ((const long long *)m, sigma_avx2 [r][2], 8))) ;
+            r3 = rotr32 (_mm256_xor_si256 (r3, r0)) ;
+            r2 = _mm256_add_epi64 (r2, r3) ;
+            r1 = rotr24 (_mm256_xor_si256 (r1, r2)) ;
+            r0 = _mm256_add_epi64 (r0, _mm256_add_epi64 (r1, _mm256_i32gather_epi64 ((const long long *)m, sigma_avx2 [r][3], 8))) ;
+            r3 = rotr16 (_mm256_xor_si256 (r3, r0)) ;
+            r2 = _mm256_add_epi64 (r2, r3) ;
+            r1 = rotr63 (_mm256_xor_si256 (r1, r2)) ;
+            r1 = rol256x64 (r1, 1) ;
+            r2 = rol256x64 (r2, 2) ;
+            r3 = rol256x64 (r3, 3) ;
+        }
     }
 
-    void    Compress ( hash_t &     chain
-                     , const void * message
-                     , uint64_t     t0
-                     , uint64_t     t1
-                     , uint64_t     f0
-                     , uint64_t     f1) {
+    TARGET_AVX2
+    static void     compress_avx2 ( hash_t &     chain
+                                  , const void * message
+                                  , uint64_t     t0
+                                  , uint64_t     t1
+                                  , uint64_t     f0
+                                  , uint64_t     f1) {
         auto    msg = static_cast<const uint8_t *> (message) ;
 
         uint64_t        m [16] ;
@@ -251,64 +325,40 @@ namespace BLAKE2 {
         __m256i r2 = _mm256_setr_epi64x (IV0, IV1, IV2, IV3) ;
         __m256i r3 = _mm256_xor_si256 (_mm256_setr_epi64x (IV4, IV5, IV6, IV7), _mm256_setr_epi64x (t0, t1, f0, f1)) ;
 
-        auto round = [&m, &r0, &r1, &r2, &r3](int r) {
-            r0 = _mm256_add_epi64 (r0, _mm256_add_epi64 (r1, _mm256_i32gather_epi64 ((const int64_t *)m, sigma [r][0], 8))) ;
-            r3 = rotr32 (_mm256_xor_si256 (r3, r0)) ;
-            r2 = _mm256_add_epi64 (r2, r3) ;
-            r1 = rotr24 (_mm256_xor_si256 (r1, r2)) ;
-            r0 = _mm256_add_epi64 (r0, _mm256_add_epi64 (r1, _mm256_i32gather_epi64 ((const int64_t *)m, sigma [r][1], 8))) ;
-            r3 = rotr16 (_mm256_xor_si256 (r3, r0)) ;
-            r2 = _mm256_add_epi64 (r2, r3) ;
-            r1 = rotr63 (_mm256_xor_si256 (r1, r2)) ;
-            r1 = ror256x64 (r1, 1) ;
-            r2 = ror256x64 (r2, 2) ;
-            r3 = ror256x64 (r3, 3) ;
-            r0 = _mm256_add_epi64 (r0, _mm256_add_epi64 (r1, _mm256_i32gather_epi64 ((const int64_t *)m, sigma [r][2], 8))) ;
-            r3 = rotr32 (_mm256_xor_si256 (r3, r0)) ;
-            r2 = _mm256_add_epi64 (r2, r3) ;
-            r1 = rotr24 (_mm256_xor_si256 (r1, r2)) ;
-            r0 = _mm256_add_epi64 (r0, _mm256_add_epi64 (r1, _mm256_i32gather_epi64 ((const int64_t *)m, sigma [r][3], 8))) ;
-            r3 = rotr16 (_mm256_xor_si256 (r3, r0)) ;
-            r2 = _mm256_add_epi64 (r2, r3) ;
-            r1 = rotr63 (_mm256_xor_si256 (r1, r2)) ;
-            r1 = rol256x64 (r1, 1) ;
-            r2 = rol256x64 (r2, 2) ;
-            r3 = rol256x64 (r3, 3) ;
-        } ;
 
         if (false) {
             // Manual unroll cause bad code (writing temporal values onto stack!)
-            round ( 0) ;
-            round ( 1) ;
-            round ( 2) ;
-            round ( 3) ;
-            round ( 4) ;
-            round ( 5) ;
-            round ( 6) ;
-            round ( 7) ;
-            round ( 8) ;
-            round ( 9) ;
-            round (10) ;
-            round (11) ;
+            round_avx2 (m, r0, r1, r2, r3,  0) ;
+            round_avx2 (m, r0, r1, r2, r3,  1) ;
+            round_avx2 (m, r0, r1, r2, r3,  2) ;
+            round_avx2 (m, r0, r1, r2, r3,  3) ;
+            round_avx2 (m, r0, r1, r2, r3,  4) ;
+            round_avx2 (m, r0, r1, r2, r3,  5) ;
+            round_avx2 (m, r0, r1, r2, r3,  6) ;
+            round_avx2 (m, r0, r1, r2, r3,  7) ;
+            round_avx2 (m, r0, r1, r2, r3,  8) ;
+            round_avx2 (m, r0, r1, r2, r3,  9) ;
+            round_avx2 (m, r0, r1, r2, r3, 10) ;
+            round_avx2 (m, r0, r1, r2, r3, 11) ;
         }
         else {
 
             for (int_fast32_t i = 0 ; i < 12 ; i += 1) {
-                round (i) ;
+                round_avx2 (m, r0, r1, r2, r3, static_cast<int> (i)) ;
             }
         }
 
         _mm256_storeu_si256 ((__m256i *)(&chain [0]), _mm256_xor_si256 (o0, _mm256_xor_si256 (r0, r2))) ;
         _mm256_storeu_si256 ((__m256i *)(&chain [4]), _mm256_xor_si256 (o1, _mm256_xor_si256 (r1, r3))) ;
     }
-#else
-
-    void Compress ( hash_t &    chain
-                  , const void *message
-                  , uint64_t    t0
-                  , uint64_t    t1
-                  , uint64_t    f0
-                  , uint64_t    f1) {
+#endif  /* TARGET_HAVE_AVX2 */
+
+    static void     compress_generic ( hash_t &    chain
+                                     , const void *message
+                                     , uint64_t    t0
+                                     , uint64_t    t1
+                                     , uint64_t    f0
+                                     , uint64_t    f1) {
         const uint8_t * msg = static_cast<const uint8_t *> (message) ;
 
         uint64_t        m [16] ;
@@ -393,7 +443,123 @@ namespace BLAKE2 {
         chain [6] ^= v06 ^ v14 ;
         chain [7] ^= v07 ^ v15 ;
     }
-#endif  /* not TARGET_HAVE_AVX */
+
+    namespace {
+#ifdef TARGET_HAVE_AVX2
+        bool    has_avx2 () {
+            return __builtin_cpu_supports ("avx2") ;
+        }
+#endif
+
+        bool    always () {
+            return true ;
+        }
+
+        /**
+         * In the order of preference (the faster first), the first supported one is the default.
+         * The AVX2 gather kernel is slower than the scalar one on the cores measured so far,
+         * `Kernel::AutoTune` selects it where it wins.
+         */
+        const CompressKernel    compress_kernels [] = {
+            { "generic", compress_generic, always },
+#ifdef TARGET_HAVE_AVX2
+            { "avx2",    compress_avx2,    has_avx2 },
+#endif
+        } ;
+        const size_t    COMPRESS_KERNEL_COUNT = sizeof (compress_kernels) / sizeof (compress_kernels [0]) ;
+        const size_t    NO_KERNEL = ~static_cast<size_t> (0) ;
+
+        void    compress_first_use (hash_t &, const void *, uint64_t, uint64_t, uint64_t, uint64_t) ;
+
+        // Constant initialized, so `Compress` works during the static initialization.
+        std::atomic<compress_t>     active_compress { compress_first_use } ;
+        std::atomic<size_t>         active_kernel { NO_KERNEL } ;
+
+        /** The active kernel, the default one is chosen on the first use (unless selected before).  */
+        size_t  resolve_kernel () {
+            size_t  idx = active_kernel.load (std::memory_order_relaxed) ;
+            if (idx != NO_KERNEL) {
+                return idx ;
+            }
+            size_t  preferred = 0 ;
+            while (! compress_kernels [preferred].is_supported ()) {
+                ++preferred ;       // The generic kernel is always supported.
+            }
+            if (! active_kernel.compare_exchange_strong (idx, preferred, std::memory_order_relaxed)) {
+                return idx ;        // Selected meanwhile.
+            }
+            compress_t  expected = compress_first_use ;
+            active_compress.compare_exchange_strong (expected, compress_kernels [preferred].compress, std::memory_order_relaxed) ;
+            return preferred ;
+        }
+
+        void    compress_first_use ( hash_t &     chain
+                                   , const void * message
+                                   , uint64_t     t0
+                                   , uint64_t     t1
+                                   , uint64_t     f0
+                                   , uint64_t     f1) {
+            compress_kernels [resolve_kernel ()].compress (chain, message, t0, t1, f0, f1) ;
+        }
+    }
+
+    void    Compress ( hash_t &     chain
+                     , const void * message
+                     , uint64_t     t0
+                     , uint64_t     t1
+                     , uint64_t     f0
+                     , uint64_t     f1) {
+        active_compress.load (std::memory_order_relaxed) (chain, message, t0, t1, f0, f1) ;
+    }
+
+    size_t  compress_kernel_count () {
+        return COMPRESS_KERNEL_COUNT ;
+    }
+
+    const CompressKernel &  compress_kernel (size_t idx) {
+        return compress_kernels [idx] ;
+    }
+
+    size_t  active_compress_kernel () {
+        return resolve_kernel () ;
+    }
+
+    void    select_compress_kernel (size_t idx) {
+        active_kernel.store (idx, std::memory_order_relaxed) ;
+        active_compress.store (compress_kernels [idx].compress, std::memory_order_relaxed) ;
+        PROBE1 (kernel__select, compress_kernels [idx].name) ;
+    }
+
+    namespace {
+        /** Fires apply__entry, and apply__return on every way out.  */
+        struct ApplyProbe {
+            const void *    data ;
+            size_t          size ;
+
+            ApplyProbe (const void *p, size_t n) : data { p }, size { n } {
+                PROBE2 (apply__entry, data, size) ;
+            }
+
+            ~ApplyProbe () {
+                PROBE2 (apply__return, data, size) ;
+            }
+        } ;
+
+        /** Announces the kernel once the library is loaded.  */
+        struct KernelProbe {
+            KernelProbe () {
+                PROBE1 (kernel__select, compress_kernel_name ()) ;
+            }
+        } ;
+    }
+
+    const char *    compress_kernel_name () {
+        return compress_kernels [active_compress_kernel ()].name ;
+    }
+
+    namespace {
+        const KernelProbe   kernel_probe ;
+    }
 
     void        InitializeChain (hash_t &chain) {
         chain [0] = IV0 ;
@@ -425,6 +591,7 @@ namespace BLAKE2 {
             , flags_ (0) {
         buffer_ = std::make_unique<std::remove_reference<decltype (*buffer_)>::type> () ;
         InitializeChain (h_, param) ;
+        PROBE2 (generator__init, this, 0) ;
     }
 
     Generator::Generator (const parameter_block_t &param, const void *key, size_t key_len)
@@ -449,31 +616,82 @@ namespace BLAKE2 {
             buf.fill (0) ;
             memcpy (&buf [0], key, k_len) ;
             used_ = BLOCK_SIZE ;
+            flags_ |= (1u << BIT_KEYED) ;
         }
+        PROBE2 (generator__init, this, IsKeyed () ? 1 : 0) ;
     }
 
     Generator & Generator::Update (const void *data, size_t size) {
-        if (0 < size) {
-            auto       &buf = *buffer_;
-            auto const *src = static_cast<const uint8_t *> (data);
-
-            while (true) {
-                size_t  remain = BUFFER_SIZE - used_ ;
-
-                if (size <= remain) {
-                    memcpy (&buf [used_], src, size) ;
-                    used_ += static_cast<int32_t> (size) ;
-                    break ;
-                }
-                // 0 < (size - remain)
-                memcpy (&buf [used_], src, remain) ;
-                inc_counter (t0_, t1_, BLOCK_SIZE) ;
-                Compress (h_, &buf [0], t0_, t1_, 0, 0) ;
-                memcpy (&buf [0], &buf [BLOCK_SIZE], BLOCK_SIZE) ;
-                used_ = BLOCK_SIZE ;
-                src += remain ;
-                size -= remain ;
+        PROBE2 (update__entry, this, size) ;
+        if (size == 0) {
+            PROBE2 (update__return, this, size) ;
+            return *this ;
+        }
+        auto       &buf = *buffer_;
+        auto const *src = static_cast<const uint8_t *> (data);
+        size_t      remain = size ;
+        TELEMETRY (telemetry_record (Telemetry::EntryPoint::GENERATOR, 1, size, (used_ + size - 1) / BLOCK_SIZE, 0)) ;
+
+        if (0 < used_) {
+            // Completes the staged block.
+            size_t  fill = BLOCK_SIZE - static_cast<size_t> (used_) ;
+            if (remain < fill) {
+                fill = remain ;
+            }
+            memcpy (&buf [used_], src, fill) ;
+            used_ += static_cast<int32_t> (fill) ;
+            src += fill ;
+            remain -= fill ;
+            if (remain == 0) {
+                PROBE2 (update__return, this, size) ;
+                return *this ;          // Might be the last block.
+            }
+            inc_counter (t0_, t1_, BLOCK_SIZE) ;
+            Compress (h_, &buf [0], t0_, t1_, 0, 0) ;
+            used_ = 0 ;
+        }
+        // Compresses straight from the input, the last block is always staged.
+        while (BLOCK_SIZE < remain) {
+            inc_counter (t0_, t1_, BLOCK_SIZE) ;
+            Compress (h_, src, t0_, t1_, 0, 0) ;
+            src += BLOCK_SIZE ;
+            remain -= BLOCK_SIZE ;
+        }
+        memcpy (&buf [0], src, remain) ;
+        used_ = static_cast<int32_t> (remain) ;
+        PROBE2 (update__return, this, size) ;
+        return *this ;
+    }
+
+#ifdef BLAKE2_HAVE_IOVEC
+    Generator & Generator::Update (const struct iovec *iov, size_t count) {
+        for (size_t i = 0 ; i < count ; ++i) {
+            Update (iov [i].iov_base, iov [i].iov_len) ;
+        }
+        return *this ;
+    }
+#endif
+
+    Generator & Generator::CopyAndUpdate (void *dst, const void *src, size_t size) {
+        auto *          d = static_cast<uint8_t *> (dst) ;
+        auto const *    s = static_cast<const uint8_t *> (src) ;
+        const bool      non_temporal = NON_TEMPORAL_THRESHOLD <= size ;
+        while (0 < size) {
+            const size_t    n = (size < COPY_CHUNK_SIZE) ? size : COPY_CHUNK_SIZE ;
+            if (non_temporal) {
+                stream_copy (d, s, n) ;
+            }
+            else {
+                memcpy (d, s, n) ;
             }
+            // Hashes the source, the destination lines may already be evicted.
+            Update (s, n) ;
+            d += n ;
+            s += n ;
+            size -= n ;
+        }
+        if (non_temporal) {
+            stream_fence () ;
         }
         return *this ;
     }
@@ -482,16 +700,15 @@ namespace BLAKE2 {
 
     Digest      Generator::Finalize () {
         auto &  buf = *buffer_ ;
-        if (BLOCK_SIZE < static_cast<size_t> (used_)) {
-            inc_counter (t0_, t1_, BLOCK_SIZE) ;
-            Compress (h_, &buf [0], t0_, t1_, 0, 0) ;
-            used_ -= BLOCK_SIZE ;
-            memcpy (&buf [0], &buf [BLOCK_SIZE], used_) ;
-        }
         inc_counter (t0_, t1_, used_) ;
         memset (&buf [used_], 0, BUFFER_SIZE - used_) ;      // 0 padding.
-        Compress (h_, &buf [0], t0_, t1_, ~0uLL, 0) ;
+        Compress (h_, &buf [0], t0_, t1_, ~0uLL, IsLastNode () ? ~0uLL : 0) ;
         flags_ |= (1u << BIT_FINALIZED) ;
+        TELEMETRY ({
+            telemetry_record (Telemetry::EntryPoint::GENERATOR, 0, 0, 1, 1) ;
+            telemetry_record_size (Telemetry::EntryPoint::GENERATOR, t0_ - (IsKeyed () ? BLOCK_SIZE : 0)) ;
+        }) ;
+        PROBE2 (finalize, this, t0_ - (IsKeyed () ? BLOCK_SIZE : 0)) ;
         return Digest { h_ } ;
     }
 
@@ -511,8 +728,14 @@ namespace BLAKE2 {
         size_t        cnt_blocks = (data_length + BLOCK_SIZE - 1) / BLOCK_SIZE;
         size_t        sz         = 0;
         auto const *src = static_cast<const uint8_t *> (data);
-
-        if (key == nullptr || key_length == 0) {
+        const bool  keyed = (key != nullptr && 0 < key_length) ;
+        ApplyProbe  probe { data, data_length } ;
+
+        TELEMETRY ({
+            telemetry_record (Telemetry::EntryPoint::APPLY, 1, data_length, keyed ? 1 + cnt_blocks : std::max<size_t> (1, cnt_blocks), 1) ;
+            telemetry_record_size (Telemetry::EntryPoint::APPLY, data_length) ;
+        }) ;
+        if (! keyed) {
             InitializeChain (H, param) ;
             if (cnt_blocks == 0) {
                 memset (buffer, 0, sizeof (buffer)) ;
@@ -555,6 +778,20 @@ namespace BLAKE2 {
         return Digest (H [0], H [1], H [2], H [3], H [4], H [5], H [6], H [7]) ;
     }
 
+#ifdef BLAKE2_HAVE_IOVEC
+    Digest      Apply ( const parameter_block_t &param
+                      , const void *key, size_t key_length
+                      , const struct iovec *iov, size_t count) {
+        return Generator { param, key, key_length }.Update (iov, count).Finalize () ;
+    }
+#endif
+
+    Digest      CopyAndApply ( const parameter_block_t &param
+                             , const void *key, size_t key_length
+                             , void *dst, const void *data, size_t data_length) {
+        return Generator { param, key, key_length }.CopyAndUpdate (dst, data, data_length).Finalize () ;
+    }
+
     Digest::Digest ( uint64_t h0, uint64_t h1, uint64_t h2, uint64_t h3
                    , uint64_t h4, uint64_t h5, uint64_t h6, uint64_t h7) {
         store64 (&h_ [8 * 0], h0) ;
@@ -0,0 +1,202 @@
+/*
+ * Batch.cpp: Multi-buffer hashing of independent messages.
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#include <algorithm>
+#include <numeric>
+#include <vector>
+#include "BLAKE2/Batch.hpp"
+#include "MultiBuffer.h"
+#include "Telemetry.h"
+
+#ifdef HAVE_CONFIG_H
+#   include "config.h"
+#endif
+
+namespace BLAKE2 {
+
+    namespace {
+        const size_t    MAX_KEY_LENGTH = 64 ;
+        const size_t    COPY_SLICE_SIZE = 4096 ;    // Copied just before its blocks are hashed.
+
+        inline void inc_counter (uint64_t &t0, uint64_t &t1, size_t v) {
+            t0 += v ;
+            if (t0 < v) {
+                ++t1 ;
+            }
+        }
+
+        inline size_t   count_blocks (size_t data_length, bool keyed) {
+            size_t  cnt = (data_length + BLOCK_SIZE - 1) / BLOCK_SIZE + (keyed ? 1 : 0) ;
+            return std::max<size_t> (1, cnt) ;
+        }
+
+        struct Lane {
+            hash_t          h ;
+            uint64_t        t0 ;
+            uint64_t        t1 ;
+            const uint8_t * src ;
+            uint8_t *       dst ;                   // nullptr unless copying.
+            size_t          length ;
+            size_t          cnt_blocks ;
+            uint8_t         last [BLOCK_SIZE] ;     // Zero padded last block.
+        } ;
+
+        void    apply_batch ( const parameter_block_t *params, size_t param_stride
+                            , const void *key, size_t key_length
+                            , size_t count
+                            , void * const *dst
+                            , const void * const *data, const size_t *data_length
+                            , Digest *digests) {
+            size_t  k_len = (key == nullptr) ? 0 : std::min (key_length, MAX_KEY_LENGTH) ;
+            uint8_t key_block [BLOCK_SIZE] ;
+            memset (key_block, 0, sizeof (key_block)) ;
+            if (0 < k_len) {
+                memcpy (key_block, key, k_len) ;
+            }
+            TELEMETRY ({
+                uint64_t    bytes = 0 ;
+                uint64_t    blocks = 0 ;
+                for (size_t i = 0 ; i < count ; ++i) {
+                    bytes += data_length [i] ;
+                    blocks += count_blocks (data_length [i], 0 < k_len) ;
+                    telemetry_record_size (Telemetry::EntryPoint::BATCH, data_length [i]) ;
+                }
+                telemetry_record (Telemetry::EntryPoint::BATCH, 1, bytes, blocks, count) ;
+            }) ;
+            // Messages of similar length share a group, so that lanes finish together.
+            std::vector<size_t> order (count) ;
+            std::iota (order.begin (), order.end (), 0) ;
+            if (MULTIBUFFER_LANES < count) {
+                std::stable_sort (order.begin (), order.end (), [data_length](size_t a, size_t b) {
+                    return data_length [b] < data_length [a] ;
+                }) ;
+            }
+            static const uint8_t    zero_block [BLOCK_SIZE] = { 0 } ;
+            Lane        lanes [MULTIBUFFER_LANES] ;
+            hash_t      scratch ;
+
+            for (size_t base = 0 ; base < count ; base += MULTIBUFFER_LANES) {
+                const size_t    n = std::min (MULTIBUFFER_LANES, count - base) ;
+                size_t          steps = 0 ;
+
+                for (size_t i = 0 ; i < n ; ++i) {
+                    size_t      idx = order [base + i] ;
+                    Lane &      L = lanes [i] ;
+                    Parameter   P { params [idx * param_stride] } ;
+                    if (0 < k_len) {
+                        P.SetKeyLength (static_cast<uint8_t> (k_len)) ;
+                    }
+                    InitializeChain (L.h, P.GetParameterBlock ()) ;
+                    L.t0 = 0 ;
+                    L.t1 = 0 ;
+                    L.src = static_cast<const uint8_t *> (data [idx]) ;
+                    L.dst = (dst == nullptr) ? nullptr : static_cast<uint8_t *> (dst [idx]) ;
+                    L.length = data_length [idx] ;
+                    L.cnt_blocks = count_blocks (L.length, 0 < k_len) ;
+                    steps = std::max (steps, L.cnt_blocks) ;
+                }
+                for (size_t s = 0 ; s < steps ; ++s) {
+                    hash_t *        chain [MULTIBUFFER_LANES] ;
+                    const void *    msg [MULTIBUFFER_LANES] ;
+                    uint64_t        t0 [MULTIBUFFER_LANES] ;
+                    uint64_t        t1 [MULTIBUFFER_LANES] ;
+                    uint64_t        f0 [MULTIBUFFER_LANES] ;
+                    uint64_t        f1 [MULTIBUFFER_LANES] ;
+                    size_t          active = 0 ;
+
+                    for (size_t i = 0 ; i < MULTIBUFFER_LANES ; ++i) {
+                        Lane &  L = lanes [i] ;
+                        if (n <= i || L.cnt_blocks <= s) {
+                            // Idle lane.
+                            chain [i] = &scratch ;
+                            msg [i] = zero_block ;
+                            t0 [i] = t1 [i] = f0 [i] = f1 [i] = 0 ;
+                            continue ;
+                        }
+                        size_t  bytes = BLOCK_SIZE ;
+                        if (0 < k_len && s == 0) {
+                            msg [i] = key_block ;
+                        }
+                        else {
+                            size_t  off = (s - (0 < k_len ? 1 : 0)) * BLOCK_SIZE ;
+                            if (L.dst != nullptr && (off % COPY_SLICE_SIZE) == 0 && off < L.length) {
+                                // The slice stays in L1 until the lane has hashed it.
+                                memcpy (L.dst + off, L.src + off, std::min (COPY_SLICE_SIZE, L.length - off)) ;
+                            }
+                            bytes = std::min (BLOCK_SIZE, L.length - off) ;
+                            if (bytes == BLOCK_SIZE) {
+                                msg [i] = L.src + off ;
+                            }
+                            else {
+                                memset (L.last, 0, BLOCK_SIZE) ;
+                                if (0 < bytes) {
+                                    memcpy (L.last, L.src + off, bytes) ;
+                                }
+                                msg [i] = L.last ;
+                            }
+                        }
+                        inc_counter (L.t0, L.t1, bytes) ;
+                        chain [i] = &L.h ;
+                        t0 [i] = L.t0 ;
+                        t1 [i] = L.t1 ;
+                        f0 [i] = (s + 1 == L.cnt_blocks) ? ~0uLL : 0 ;
+                        f1 [i] = 0 ;
+                        ++active ;
+                    }
+                    if (multibuffer_is_vectorized () && 1 < active) {
+                        CompressLanes (chain, msg, t0, t1, f0, f1) ;
+                    }
+                    else {
+                        for (size_t i = 0 ; i < n ; ++i) {
+                            if (s < lanes [i].cnt_blocks) {
+                                Compress (*chain [i], msg [i], t0 [i], t1 [i], f0 [i], f1 [i]) ;
+                            }
+                        }
+                    }
+                }
+                for (size_t i = 0 ; i < n ; ++i) {
+                    digests [order [base + i]] = Digest { lanes [i].h } ;
+                }
+            }
+        }
+    }
+
+    void    ApplyBatch ( const parameter_block_t &param
+                       , const void *key, size_t key_length
+                       , size_t count
+                       , const void * const *data, const size_t *data_length
+                       , Digest *digests) {
+        apply_batch (&param, 0, key, key_length, count, nullptr, data, data_length, digests) ;
+    }
+
+    void    ApplyBatch ( const parameter_block_t *params
+                       , const void *key, size_t key_length
+                       , size_t count
+                       , const void * const *data, const size_t *data_length
+                       , Digest *digests) {
+        apply_batch (params, 1, key, key_length, count, nullptr, data, data_length, digests) ;
+    }
+
+    void    CopyAndApplyBatch ( const parameter_block_t &param
+                              , const void *key, size_t key_length
+                              , size_t count
+                              , void * const *dst
+                              , const void * const *data, const size_t *data_length
+                              , Digest *digests) {
+        apply_batch (&param, 0, key, key_length, count, dst, data, data_length, digests) ;
+    }
+
+    void    CopyAndApplyBatch ( const parameter_block_t *params
+                              , const void *key, size_t key_length
+                              , size_t count
+                              , void * const *dst
+                              , const void * const *data, const size_t *data_length
+                              , Digest *digests) {
+        apply_batch (params, 1, key, key_length, count, dst, data, data_length, digests) ;
+    }
+}       /* end of [namespace BLAKE2] */
+/*
+ * [END OF FILE]
+ */
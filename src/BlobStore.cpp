@@ -0,0 +1,433 @@
+/*
+ * BlobStore.cpp: Content-addressed blob store keyed by BLAKE2 digests.
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <mutex>
+#include <utility>
+#include "BLAKE2/BlobStore.hpp"
+#include "Support.h"
+
+#ifdef HAVE_CONFIG_H
+#   include "config.h"
+#endif
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+namespace BLAKE2 {
+
+    namespace {
+        const char      STORE_MAGIC [8] = { 'B', '2', 'S', 'T', 'O', 'R', 'E', 1 } ;
+        const char      INDEX_MAGIC [8] = { 'B', '2', 'I', 'N', 'D', 'E', 'X', 1 } ;
+        const uint32_t  RECORD_MAGIC = 0x4c423242u ;        // "B2BL"
+
+        const size_t    INDEX_HEADER_SIZE = 64 ;
+        const size_t    SLOT_SIZE = 64 ;
+        const size_t    OFF_SLOT_OFFSET = 32 ;
+        const size_t    OFF_SLOT_LENGTH = 40 ;
+        const size_t    OFF_SLOT_PACK   = 48 ;
+        const size_t    OFF_SLOT_FLAGS  = 52 ;
+        const size_t    OFF_INDEX_SLOTS = 8 ;
+        const size_t    OFF_INDEX_USED  = 16 ;
+        const uint64_t  INITIAL_SLOT_COUNT = 1024 ;
+        const size_t    MAX_SHARD_COUNT = 256 ;             // Shards are selected by a byte.
+        const size_t    RECORD_HEADER_SIZE = 16 + BlobStore::KEY_LENGTH ;
+
+        void    make_directory (const std::string &path) {
+            if (::mkdir (path.c_str (), 0777) != 0 && errno != EEXIST) {
+                raise_errno ("mkdir " + path) ;
+            }
+        }
+
+        void    write_all (int fd, const void *data, size_t size, uint64_t offset, const std::string &path) {
+            auto const *    p = static_cast<const uint8_t *> (data) ;
+            while (0 < size) {
+                ssize_t n = ::pwrite (fd, p, size, static_cast<off_t> (offset)) ;
+                if (n < 0) {
+                    if (errno == EINTR) {
+                        continue ;
+                    }
+                    raise_errno ("write " + path) ;
+                }
+                p += n ;
+                size -= static_cast<size_t> (n) ;
+                offset += static_cast<uint64_t> (n) ;
+            }
+        }
+
+        bool    read_all (int fd, void *data, size_t size, uint64_t offset) {
+            auto *  p = static_cast<uint8_t *> (data) ;
+            while (0 < size) {
+                ssize_t n = ::pread (fd, p, size, static_cast<off_t> (offset)) ;
+                if (n < 0) {
+                    if (errno == EINTR) {
+                        continue ;
+                    }
+                    raise_errno ("read") ;
+                }
+                if (n == 0) {
+                    return false ;
+                }
+                p += n ;
+                size -= static_cast<size_t> (n) ;
+                offset += static_cast<uint64_t> (n) ;
+            }
+            return true ;
+        }
+
+        std::string pack_name (const std::string &dir, size_t idx) {
+            char    tmp [32] ;
+            snprintf (tmp, sizeof (tmp), "/pack-%06zu", idx) ;
+            return dir + tmp ;
+        }
+
+        /**
+         * Memory mapped index file.
+         */
+        class Index {
+        private:
+            std::string path_ ;
+            int         fd_ = -1 ;
+            uint8_t *   base_ = nullptr ;
+            size_t      size_ = 0 ;
+        public:
+            Index () = default ;
+
+            Index (const Index &) = delete ;
+
+            Index &     operator = (const Index &) = delete ;
+
+            ~Index () {
+                Close () ;
+            }
+
+            void    Open (const std::string &path) {
+                path_ = path ;
+                fd_ = ::open (path.c_str (), O_RDWR) ;
+                if (fd_ < 0) {
+                    if (errno != ENOENT) {
+                        raise_errno ("open " + path) ;
+                    }
+                    Create (path, INITIAL_SLOT_COUNT) ;
+                    return ;
+                }
+                Map () ;
+                if (memcmp (base_, INDEX_MAGIC, sizeof (INDEX_MAGIC)) != 0) {
+                    throw BlobStore::CorruptionError { "Bad index: " + path } ;
+                }
+                // Probe () trusts the geometry.
+                const uint64_t  slots = GetSlotCount () ;
+                if (slots == 0 || (slots & (slots - 1)) != 0
+                    || (size_ - INDEX_HEADER_SIZE) / SLOT_SIZE != slots
+                    || (size_ - INDEX_HEADER_SIZE) % SLOT_SIZE != 0
+                    || slots <= GetUsed ()) {
+                    throw BlobStore::CorruptionError { "Bad index geometry: " + path } ;
+                }
+            }
+
+            void    Close () {
+                if (base_ != nullptr) {
+                    ::munmap (base_, size_) ;
+                    base_ = nullptr ;
+                }
+                if (0 <= fd_) {
+                    ::close (fd_) ;
+                    fd_ = -1 ;
+                }
+            }
+
+            uint64_t    GetSlotCount () const {
+                return load64le (base_ + OFF_INDEX_SLOTS) ;
+            }
+
+            uint64_t    GetUsed () const {
+                return load64le (base_ + OFF_INDEX_USED) ;
+            }
+
+            uint8_t *   Slot (uint64_t idx) const {
+                return base_ + INDEX_HEADER_SIZE + SLOT_SIZE * idx ;
+            }
+
+            /**
+             * Finds the slot of KEY, or the empty slot where KEY goes.
+             */
+            uint8_t *   Probe (const uint8_t *key) const {
+                const uint64_t  mask = GetSlotCount () - 1 ;
+                // Byte 0 selects the shard, the home slot comes from the others.
+                for (uint64_t i = load64le (key + 8) & mask ; ; i = (i + 1) & mask) {
+                    uint8_t *   S = Slot (i) ;
+                    if (load32le (S + OFF_SLOT_FLAGS) == 0 || memcmp (S, key, BlobStore::KEY_LENGTH) == 0) {
+                        return S ;
+                    }
+                }
+            }
+
+            void    Insert (const uint8_t *key, uint32_t pack, uint64_t offset, uint64_t length) {
+                // Keep the load factor below 0.7.
+                if (10 * (GetUsed () + 1) > 7 * GetSlotCount ()) {
+                    Grow () ;
+                }
+                uint8_t *   S = Probe (key) ;
+                memcpy (S, key, BlobStore::KEY_LENGTH) ;
+                store64le (S + OFF_SLOT_OFFSET, offset) ;
+                store64le (S + OFF_SLOT_LENGTH, length) ;
+                store32le (S + OFF_SLOT_PACK, pack) ;
+                store32le (S + OFF_SLOT_FLAGS, 1) ;
+                store64le (base_ + OFF_INDEX_USED, GetUsed () + 1) ;
+            }
+
+            void    Sync () {
+                if (base_ != nullptr && ::msync (base_, size_, MS_SYNC) != 0) {
+                    raise_errno ("msync " + path_) ;
+                }
+            }
+        private:
+            void    Map () {
+                struct stat st ;
+                if (::fstat (fd_, &st) != 0) {
+                    raise_errno ("stat " + path_) ;
+                }
+                size_ = static_cast<size_t> (st.st_size) ;
+                if (size_ < INDEX_HEADER_SIZE) {
+                    throw BlobStore::CorruptionError { "Bad index: " + path_ } ;
+                }
+                void *  p = ::mmap (nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0) ;
+                if (p == MAP_FAILED) {
+                    raise_errno ("mmap " + path_) ;
+                }
+                base_ = static_cast<uint8_t *> (p) ;
+            }
+
+            void    Create (const std::string &path, uint64_t slots) {
+                path_ = path ;
+                fd_ = ::open (path.c_str (), O_RDWR | O_CREAT | O_TRUNC, 0666) ;
+                if (fd_ < 0) {
+                    raise_errno ("open " + path) ;
+                }
+                if (::ftruncate (fd_, static_cast<off_t> (INDEX_HEADER_SIZE + SLOT_SIZE * slots)) != 0) {
+                    raise_errno ("truncate " + path) ;
+                }
+                Map () ;
+                memcpy (base_, INDEX_MAGIC, sizeof (INDEX_MAGIC)) ;
+                store64le (base_ + OFF_INDEX_SLOTS, slots) ;
+                store64le (base_ + OFF_INDEX_USED, 0) ;
+            }
+
+            /**
+             * Doubles the table, the new table replaces the old one with an atomic rename.
+             */
+            void    Grow () {
+                Index   next ;
+                next.Create (path_ + ".tmp", 2 * GetSlotCount ()) ;
+                for (uint64_t i = 0 ; i < GetSlotCount () ; ++i) {
+                    const uint8_t * S = Slot (i) ;
+                    if (load32le (S + OFF_SLOT_FLAGS) != 0) {
+                        memcpy (next.Probe (S), S, SLOT_SIZE) ;
+                    }
+                }
+                store64le (next.base_ + OFF_INDEX_USED, GetUsed ()) ;
+                next.Sync () ;
+                if (::rename (next.path_.c_str (), path_.c_str ()) != 0) {
+                    raise_errno ("rename " + next.path_) ;
+                }
+                next.path_ = path_ ;
+                Close () ;
+                std::swap (fd_, next.fd_) ;
+                std::swap (base_, next.base_) ;
+                std::swap (size_, next.size_) ;
+            }
+        } ;
+    }
+
+    struct BlobStore::Shard {
+        std::mutex          mutex ;
+        std::string         dir ;
+        Index               index ;
+        std::vector<int>    packs ;     // File descriptors, indexed by the pack number.
+        uint64_t            tail = 0 ;  // Size of the last pack.
+
+        explicit Shard (const std::string &d) : dir { d } {
+            make_directory (dir) ;
+            index.Open (dir + "/index") ;
+            while (true) {
+                auto    path = pack_name (dir, packs.size ()) ;
+                int     fd = ::open (path.c_str (), O_RDWR) ;
+                if (fd < 0) {
+                    break ;
+                }
+                packs.push_back (fd) ;
+            }
+            if (packs.empty ()) {
+                AddPack () ;
+            }
+            struct stat st ;
+            if (::fstat (packs.back (), &st) != 0) {
+                raise_errno ("stat " + pack_name (dir, packs.size () - 1)) ;
+            }
+            tail = static_cast<uint64_t> (st.st_size) ;
+        }
+
+        ~Shard () {
+            for (int fd : packs) {
+                ::close (fd) ;
+            }
+        }
+
+        void    AddPack () {
+            auto    path = pack_name (dir, packs.size ()) ;
+            int     fd = ::open (path.c_str (), O_RDWR | O_CREAT | O_EXCL, 0666) ;
+            if (fd < 0) {
+                raise_errno ("open " + path) ;
+            }
+            packs.push_back (fd) ;
+            tail = 0 ;
+        }
+    } ;
+
+    const size_t    BlobStore::KEY_LENGTH ;
+    const size_t    BlobStore::DEFAULT_SHARD_COUNT ;
+    const uint64_t  BlobStore::DEFAULT_MAX_PACK_SIZE ;
+
+    BlobStore::BlobStore (const std::string &root, size_t shard_count, uint64_t max_pack_size)
+            : root_ { root }
+            , max_pack_size_ { max_pack_size } {
+        make_directory (root_) ;
+
+        // The shard count of an existing store wins.
+        auto    path = root_ + "/STORE" ;
+        uint8_t header [16] ;
+        int     fd = ::open (path.c_str (), O_RDONLY) ;
+        if (0 <= fd) {
+            bool    ok = read_all (fd, header, sizeof (header), 0) ;
+            ::close (fd) ;
+            if (! ok || memcmp (header, STORE_MAGIC, sizeof (STORE_MAGIC)) != 0) {
+                throw CorruptionError { "Bad store header: " + path } ;
+            }
+            const uint64_t  cnt = load64le (header + 8) ;
+            if (cnt == 0 || MAX_SHARD_COUNT < cnt) {
+                throw CorruptionError { "Bad shard count: " + path } ;
+            }
+            shard_count = static_cast<size_t> (cnt) ;
+        }
+        else {
+            shard_count = std::max<size_t> (1, std::min<size_t> (shard_count, MAX_SHARD_COUNT)) ;
+            memcpy (header, STORE_MAGIC, sizeof (STORE_MAGIC)) ;
+            store64le (header + 8, shard_count) ;
+            fd = ::open (path.c_str (), O_WRONLY | O_CREAT | O_TRUNC, 0666) ;
+            if (fd < 0) {
+                raise_errno ("open " + path) ;
+            }
+            write_all (fd, header, sizeof (header), 0, path) ;
+            ::close (fd) ;
+        }
+        for (size_t i = 0 ; i < shard_count ; ++i) {
+            char    name [16] ;
+            snprintf (name, sizeof (name), "/%02x", static_cast<unsigned> (i)) ;
+            shards_.emplace_back (std::make_unique<Shard> (root_ + name)) ;
+        }
+    }
+
+    BlobStore::~BlobStore () = default ;
+
+    BlobStore::Shard &  BlobStore::SelectShard (const Digest &digest) const {
+        return *shards_ [digest [0] % shards_.size ()] ;
+    }
+
+    Digest  BlobStore::Put (const void *data, size_t size, bool *inserted) {
+        Digest  D { Apply (nullptr, 0, data, size) } ;
+        Shard & S = SelectShard (D) ;
+        std::lock_guard<std::mutex> lock { S.mutex } ;
+
+        if (load32le (S.index.Probe (D.data ()) + OFF_SLOT_FLAGS) != 0) {
+            if (inserted != nullptr) {
+                *inserted = false ;
+            }
+            return D ;
+        }
+        if (0 < S.tail && max_pack_size_ < S.tail + RECORD_HEADER_SIZE + size) {
+            S.AddPack () ;
+        }
+        uint8_t header [RECORD_HEADER_SIZE] ;
+        store32le (header + 0, RECORD_MAGIC) ;
+        store32le (header + 4, 0) ;
+        store64le (header + 8, size) ;
+        memcpy (header + 16, D.data (), KEY_LENGTH) ;
+
+        const uint32_t  pack = static_cast<uint32_t> (S.packs.size () - 1) ;
+        const auto      path = pack_name (S.dir, pack) ;
+        write_all (S.packs.back (), header, sizeof (header), S.tail, path) ;
+        write_all (S.packs.back (), data, size, S.tail + sizeof (header), path) ;
+        S.index.Insert (D.data (), pack, S.tail + sizeof (header), size) ;
+        S.tail += sizeof (header) + size ;
+        if (inserted != nullptr) {
+            *inserted = true ;
+        }
+        return D ;
+    }
+
+    bool    BlobStore::Contains (const Digest &digest) const {
+        Shard & S = SelectShard (digest) ;
+        std::lock_guard<std::mutex> lock { S.mutex } ;
+        return load32le (S.index.Probe (digest.data ()) + OFF_SLOT_FLAGS) != 0 ;
+    }
+
+    bool    BlobStore::Get (const Digest &digest, std::vector<uint8_t> &data) const {
+        Shard &     S = SelectShard (digest) ;
+        int         fd ;
+        uint64_t    offset ;
+        uint64_t    length ;
+        {
+            std::lock_guard<std::mutex> lock { S.mutex } ;
+            const uint8_t * slot = S.index.Probe (digest.data ()) ;
+            if (load32le (slot + OFF_SLOT_FLAGS) == 0) {
+                return false ;
+            }
+            uint32_t    pack = load32le (slot + OFF_SLOT_PACK) ;
+            if (S.packs.size () <= pack) {
+                throw CorruptionError { "Missing pack in " + S.dir } ;
+            }
+            fd = S.packs [pack] ;
+            offset = load64le (slot + OFF_SLOT_OFFSET) ;
+            length = load64le (slot + OFF_SLOT_LENGTH) ;
+        }
+        data.resize (static_cast<size_t> (length)) ;
+        if (! read_all (fd, data.data (), data.size (), offset)) {
+            throw CorruptionError { "Truncated pack in " + S.dir } ;
+        }
+        if (! Digest::IsEqual (digest, Apply (nullptr, 0, data.data (), data.size ()))) {
+            throw CorruptionError { "Digest mismatch in " + S.dir } ;
+        }
+        return true ;
+    }
+
+    size_t  BlobStore::GetCount () const {
+        size_t  result = 0 ;
+        for (auto const &S : shards_) {
+            std::lock_guard<std::mutex> lock { S->mutex } ;
+            result += static_cast<size_t> (S->index.GetUsed ()) ;
+        }
+        return result ;
+    }
+
+    void    BlobStore::Sync () {
+        for (auto &S : shards_) {
+            std::lock_guard<std::mutex> lock { S->mutex } ;
+            for (int fd : S->packs) {
+                if (::fsync (fd) != 0) {
+                    raise_errno ("fsync " + S->dir) ;
+                }
+            }
+            S->index.Sync () ;
+        }
+    }
+}       /* end of [namespace BLAKE2] */
+/*
+ * [END OF FILE]
+ */
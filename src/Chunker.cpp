@@ -0,0 +1,192 @@
+/*
+ * Chunker.cpp: Content-defined chunking with BLAKE2 fingerprints.
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#include <algorithm>
+#include <array>
+#include "BLAKE2/Chunker.hpp"
+#include "BLAKE2/Batch.hpp"
+
+#ifdef HAVE_CONFIG_H
+#   include "config.h"
+#endif
+
+namespace BLAKE2 {
+
+    namespace {
+        const size_t    MAX_PENDING_SPANS = 16 ;    // Hash while the chunks are still cached.
+
+        /**
+         * Gear table, fixed forever (boundaries must be stable across releases).
+         */
+        const uint64_t *    gear_table () {
+            static const std::array<uint64_t, 256>  table = [] {
+                std::array<uint64_t, 256>   result ;
+                uint64_t    x = 0x424c414b45324344ULL ;     // splitmix64 seeded with "BLAKE2CD".
+                for (auto &v : result) {
+                    x += 0x9e3779b97f4a7c15ULL ;
+                    uint64_t    z = x ;
+                    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL ;
+                    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL ;
+                    v = z ^ (z >> 31) ;
+                }
+                return result ;
+            } () ;
+            return table.data () ;
+        }
+
+        /** Mask with the COUNT most significant bits set.  */
+        uint64_t    top_bits (size_t count) {
+            if (count == 0) {
+                return 0 ;
+            }
+            if (64 <= count) {
+                return ~0uLL ;
+            }
+            return ~0uLL << (64 - count) ;
+        }
+    }
+
+    const size_t    Chunker::DEFAULT_MIN_SIZE ;
+    const size_t    Chunker::DEFAULT_AVERAGE_SIZE ;
+    const size_t    Chunker::DEFAULT_MAX_SIZE ;
+
+    Chunker::Chunker ( const parameter_block_t &param
+                     , callback_t callback
+                     , size_t min_size
+                     , size_t avg_size
+                     , size_t max_size)
+            : param_ { param }
+            , callback_ { std::move (callback) }
+            , fp_ { 0 }
+            , offset_ { 0 }
+            , size_ { 0 } {
+        size_t  bits = 0 ;
+        while ((2uLL << bits) <= avg_size) {
+            ++bits ;
+        }
+        avg_size_ = size_t { 1 } << bits ;
+        min_size_ = std::min (min_size, avg_size_) ;
+        max_size_ = std::max (max_size, avg_size_) ;
+        // Normalized chunking (level 2).
+        mask_small_ = top_bits (bits + 2) ;
+        mask_large_ = top_bits (2 < bits ? bits - 2 : 1) ;
+        spans_.reserve (MAX_PENDING_SPANS) ;
+    }
+
+    size_t  Chunker::FindBoundary (const uint8_t *p, size_t size, bool &found) {
+        const uint64_t *    G = gear_table () ;
+        size_t  i = 0 ;
+
+        found = false ;
+        if (size_ < min_size_) {
+            // Boundaries never appear below the minimal size.
+            i = std::min (min_size_ - size_, size) ;
+            size_ += i ;
+            if (size_ < min_size_) {
+                return i ;
+            }
+        }
+        uint64_t    fp = fp_ ;
+        if (size_ < avg_size_) {
+            size_t  start = i ;
+            size_t  end = i + std::min (size - i, avg_size_ - size_) ;
+            while (i < end) {
+                fp = (fp << 1) + G [p [i++]] ;
+                if ((fp & mask_small_) == 0) {
+                    found = true ;
+                    break ;
+                }
+            }
+            size_ += i - start ;
+        }
+        if (! found && avg_size_ <= size_) {
+            size_t  start = i ;
+            size_t  end = i + std::min (size - i, max_size_ - size_) ;
+            while (i < end) {
+                fp = (fp << 1) + G [p [i++]] ;
+                if ((fp & mask_large_) == 0) {
+                    found = true ;
+                    break ;
+                }
+            }
+            size_ += i - start ;
+            if (max_size_ <= size_) {
+                found = true ;
+            }
+        }
+        fp_ = fp ;
+        return i ;
+    }
+
+    Chunker &   Chunker::Update (const void *data, size_t size) {
+        auto const *    p = static_cast<const uint8_t *> (data) ;
+        size_t  pos = 0 ;
+        size_t  chunk_begin = 0 ;
+
+        while (pos < size) {
+            bool    found ;
+            pos += FindBoundary (p + pos, size - pos, found) ;
+            if (! found) {
+                break ;
+            }
+            if (carry_) {
+                // Spans are empty here, the carried chunk is the first one in this buffer.
+                carry_->Update (p + chunk_begin, pos - chunk_begin) ;
+                callback_ (Chunk { offset_, size_, carry_->Finalize () }) ;
+                carry_.reset () ;
+            }
+            else {
+                spans_.push_back (Span { offset_, p + chunk_begin, size_ }) ;
+                if (MAX_PENDING_SPANS <= spans_.size ()) {
+                    Flush () ;
+                }
+            }
+            offset_ += size_ ;
+            size_ = 0 ;
+            fp_ = 0 ;
+            chunk_begin = pos ;
+        }
+        if (chunk_begin < size) {
+            if (! carry_) {
+                carry_ = std::make_unique<Generator> (param_.GetParameterBlock ()) ;
+            }
+            carry_->Update (p + chunk_begin, size - chunk_begin) ;
+        }
+        Flush () ;
+        return *this ;
+    }
+
+    void    Chunker::Finish () {
+        if (carry_) {
+            callback_ (Chunk { offset_, size_, carry_->Finalize () }) ;
+            carry_.reset () ;
+        }
+        offset_ += size_ ;
+        size_ = 0 ;
+        fp_ = 0 ;
+    }
+
+    void    Chunker::Flush () {
+        if (spans_.empty ()) {
+            return ;
+        }
+        const size_t    n = spans_.size () ;
+        const void *    data [MAX_PENDING_SPANS] ;
+        size_t          length [MAX_PENDING_SPANS] ;
+        Digest          digests [MAX_PENDING_SPANS] ;
+        for (size_t i = 0 ; i < n ; ++i) {
+            data [i] = spans_ [i].data ;
+            length [i] = spans_ [i].length ;
+        }
+        ApplyBatch (param_.GetParameterBlock (), nullptr, 0, n, data, length, digests) ;
+        for (size_t i = 0 ; i < n ; ++i) {
+            callback_ (Chunk { spans_ [i].offset, spans_ [i].length, digests [i] }) ;
+        }
+        spans_.clear () ;
+    }
+}       /* end of [namespace BLAKE2] */
+/*
+ * [END OF FILE]
+ */
@@ -0,0 +1,129 @@
+/*
+ * DRBG.cpp: Deterministic random bit generator in counter mode.
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#include <algorithm>
+#include <cstring>
+#include "BLAKE2/DRBG.hpp"
+#include "BLAKE2/ThreadPool.hpp"
+#include "MultiBuffer.h"
+#include "Support.h"
+
+#ifdef HAVE_CONFIG_H
+#   include "config.h"
+#endif
+
+namespace BLAKE2 {
+
+    namespace {
+        const size_t    MAX_KEY_LENGTH = 64 ;
+        const size_t    JOB_BLOCKS = 1024 ;             // # of output blocks per job (64 KiB).
+        const uint64_t  NO_BLOCK = ~0uLL ;
+    }
+
+    const size_t    DRBG::OUTPUT_BLOCK_SIZE ;
+
+    DRBG::DRBG (const void *seed, size_t seed_length)
+            : DRBG { Parameter ().GetParameterBlock (), seed, seed_length } {
+        /* NO-OP */
+    }
+
+    DRBG::DRBG (const parameter_block_t &param, const void *seed, size_t seed_length)
+            : position_ { 0 }
+            , cached_block_ { NO_BLOCK } {
+        Parameter   P { param } ;
+        P.SetDigestLength (static_cast<uint8_t> (OUTPUT_BLOCK_SIZE)) ;
+
+        auto k_len = (seed == nullptr) ? 0 : std::min (seed_length, MAX_KEY_LENGTH) ;
+        P.SetKeyLength (static_cast<uint8_t> (k_len)) ;
+        InitializeChain (keyed_, P.GetParameterBlock ()) ;
+        t0_ = BLOCK_SIZE ;
+        if (0 < k_len) {
+            uint8_t     block [BLOCK_SIZE] = { 0 } ;
+            memcpy (block, seed, k_len) ;
+            Compress (keyed_, block, BLOCK_SIZE, 0, 0, 0) ;
+            memset (block, 0, sizeof (block)) ;
+            t0_ += BLOCK_SIZE ;
+        }
+    }
+
+    void    DRBG::Generate (uint64_t first, size_t count, uint8_t *output) const {
+        uint8_t     message [MULTIBUFFER_LANES][BLOCK_SIZE] ;
+        hash_t      h [MULTIBUFFER_LANES] ;
+        memset (message, 0, sizeof (message)) ;
+
+        for (size_t i = 0 ; i < count ; i += MULTIBUFFER_LANES) {
+            const size_t    n = std::min (MULTIBUFFER_LANES, count - i) ;
+            for (size_t k = 0 ; k < MULTIBUFFER_LANES ; ++k) {
+                h [k] = keyed_ ;
+                store64le (message [k], first + i + k) ;
+            }
+            if (multibuffer_is_vectorized () && 1 < n) {
+                // Lanes beyond N compute blocks nobody asked for, cheaper than a branch per lane.
+                hash_t * const      chain [MULTIBUFFER_LANES] = { &h [0], &h [1], &h [2], &h [3] } ;
+                const void * const  msg [MULTIBUFFER_LANES] = { message [0], message [1], message [2], message [3] } ;
+                const uint64_t      t0 [MULTIBUFFER_LANES] = { t0_, t0_, t0_, t0_ } ;
+                const uint64_t      zero [MULTIBUFFER_LANES] = { 0, 0, 0, 0 } ;
+                const uint64_t      f0 [MULTIBUFFER_LANES] = { ~0uLL, ~0uLL, ~0uLL, ~0uLL } ;
+                CompressLanes (chain, msg, t0, zero, f0, zero) ;
+            }
+            else {
+                for (size_t k = 0 ; k < n ; ++k) {
+                    Compress (h [k], message [k], t0_, 0, ~0uLL, 0) ;
+                }
+            }
+            for (size_t k = 0 ; k < n ; ++k) {
+                for (size_t j = 0 ; j < 8 ; ++j) {
+                    store64le (output + OUTPUT_BLOCK_SIZE * (i + k) + 8 * j, h [k][j]) ;
+                }
+            }
+        }
+    }
+
+    void    DRBG::Fill (void *buffer, size_t size) {
+        static SequentialExecutor   sequential ;
+        Fill (buffer, size, &sequential) ;
+    }
+
+    void    DRBG::Fill (void *buffer, size_t size, Executor *executor) {
+        auto *  out = static_cast<uint8_t *> (buffer) ;
+
+        // Bytes of a partial block go through the cache.
+        auto partial = [this, &out, &size]() {
+            const uint64_t  block = position_ / OUTPUT_BLOCK_SIZE ;
+            const size_t    offset = static_cast<size_t> (position_ % OUTPUT_BLOCK_SIZE) ;
+            if (cached_block_ != block) {
+                Generate (block, 1, cache_) ;
+                cached_block_ = block ;
+            }
+            size_t  n = std::min (OUTPUT_BLOCK_SIZE - offset, size) ;
+            memcpy (out, cache_ + offset, n) ;
+            out += n ;
+            size -= n ;
+            position_ += n ;
+        } ;
+
+        if (0 < size && position_ % OUTPUT_BLOCK_SIZE != 0) {
+            partial () ;
+        }
+        const size_t    count = size / OUTPUT_BLOCK_SIZE ;
+        if (0 < count) {
+            const uint64_t  first = position_ / OUTPUT_BLOCK_SIZE ;
+            const size_t    jobs = (count + JOB_BLOCKS - 1) / JOB_BLOCKS ;
+            select_executor (executor, count <= JOB_BLOCKS).Run (jobs, [this, first, count, out](size_t i) {
+                const size_t    start = i * JOB_BLOCKS ;
+                Generate (first + start, std::min (JOB_BLOCKS, count - start), out + OUTPUT_BLOCK_SIZE * start) ;
+            }) ;
+            out += OUTPUT_BLOCK_SIZE * count ;
+            size -= OUTPUT_BLOCK_SIZE * count ;
+            position_ += OUTPUT_BLOCK_SIZE * count ;
+        }
+        if (0 < size) {
+            partial () ;
+        }
+    }
+}       /* end of [namespace BLAKE2] */
+/*
+ * [END OF FILE]
+ */
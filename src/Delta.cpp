@@ -0,0 +1,290 @@
+/*
+ * Delta.cpp: rsync style delta transfer (rolling weak checksum + truncated BLAKE2 signatures).
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#include <algorithm>
+#include <cstring>
+#include "BLAKE2/Delta.hpp"
+#include "BLAKE2/Batch.hpp"
+#include "BLAKE2/ThreadPool.hpp"
+#include "Support.h"
+
+#ifdef HAVE_CONFIG_H
+#   include "config.h"
+#endif
+
+namespace BLAKE2 {
+
+    namespace {
+        const size_t    JOB_BLOCKS = 1024 ;             // # of blocks signed per job.
+        const uint32_t  MIN_STRONG_LENGTH = 4 ;
+        const uint32_t  MAX_BLOCK_SIZE = 1u << 30 ;
+        const uint64_t  NO_BLOCK = ~0uLL ;
+        const uint32_t  NO_ENTRY = ~0u ;
+
+        /** The signature comes from the receiver, everything MakePatch indexes with is checked.  */
+        void    check_signature (const DeltaSync::Signature &sig) {
+            if (sig.block_size == 0 || MAX_BLOCK_SIZE < sig.block_size) {
+                throw std::invalid_argument { "DeltaSync::MakePatch: block size is out of range" } ;
+            }
+            if (sig.strong_length < MIN_STRONG_LENGTH || Digest::SIZE < sig.strong_length
+                || Parameter { sig.param }.GetDigestLength () != sig.strong_length) {
+                throw std::invalid_argument { "DeltaSync::MakePatch: strong hash length is out of range" } ;
+            }
+            const uint64_t  count = sig.basis_length / sig.block_size + ((sig.basis_length % sig.block_size) != 0 ? 1 : 0) ;
+            if (NO_ENTRY <= count || sig.weak.size () != count || sig.strong.size () != sig.weak.size () * sig.strong_length) {
+                throw std::invalid_argument { "DeltaSync::MakePatch: signature does not cover the basis" } ;
+            }
+        }
+
+        /** rsync's checksum: A = sum (x_i), B = sum ((n - i) x_i), both mod 2^16.  */
+        class RollingChecksum {
+        private:
+            uint32_t    a_ ;
+            uint32_t    b_ ;
+            uint32_t    length_ ;
+        public:
+            RollingChecksum (const uint8_t *p, size_t n) : a_ { 0 }, b_ { 0 }, length_ { static_cast<uint32_t> (n) } {
+                for (size_t i = 0 ; i < n ; ++i) {
+                    a_ += p [i] ;
+                    b_ += static_cast<uint32_t> (n - i) * p [i] ;
+                }
+            }
+
+            uint32_t    GetValue () const {
+                return (a_ & 0xFFFFu) | (b_ << 16) ;
+            }
+
+            /** Slides the window by a byte.  */
+            void    Roll (uint8_t out, uint8_t in) {
+                a_ = a_ - out + in ;
+                b_ = b_ - length_ * out + a_ ;
+            }
+        } ;
+
+        /** Chained hash table of the full blocks, keyed by the weak checksums.  */
+        class BlockIndex {
+        private:
+            const DeltaSync::Signature &    sig_ ;
+            std::vector<uint32_t>           heads_ ;
+            std::vector<uint32_t>           next_ ;
+            uint32_t                        shift_ ;
+        public:
+            BlockIndex (const DeltaSync::Signature &sig, uint64_t count) : sig_ (sig), shift_ { 32 } {
+                uint32_t    bits = 1 ;
+                while ((1uLL << bits) < 2 * count) {
+                    ++bits ;
+                }
+                shift_ = 32 - bits ;
+                heads_.assign (static_cast<size_t> (1u << bits), NO_ENTRY) ;
+                next_.assign (static_cast<size_t> (count), NO_ENTRY) ;
+                // Inserted backward so that chains are in the ascending block order.
+                for (uint64_t i = count ; 0 < i ; --i) {
+                    const auto  idx = static_cast<uint32_t> (i - 1) ;
+                    uint32_t &  head = heads_ [Slot (sig.weak [idx])] ;
+                    next_ [idx] = head ;
+                    head = idx ;
+                }
+            }
+
+            uint32_t    First (uint32_t weak) const {
+                return heads_ [Slot (weak)] ;
+            }
+
+            uint32_t    Next (uint32_t idx) const {
+                return next_ [idx] ;
+            }
+        private:
+            size_t  Slot (uint32_t weak) const {
+                return static_cast<size_t> ((weak * 0x9E3779B1u) >> shift_) ;
+            }
+        } ;
+
+        /** Appends ops, merging a copy or a literal with the previous one when contiguous.  */
+        class PatchWriter {
+        private:
+            DeltaSync::Patch &  patch_ ;
+        public:
+            explicit PatchWriter (DeltaSync::Patch &patch) : patch_ (patch) {
+                /* NO-OP */
+            }
+
+            void    Copy (uint64_t offset, uint64_t length) {
+                if (! patch_.ops.empty ()) {
+                    auto &  last = patch_.ops.back () ;
+                    if (last.kind == DeltaSync::Op::Kind::COPY && last.offset + last.length == offset) {
+                        last.length += length ;
+                        return ;
+                    }
+                }
+                patch_.ops.push_back ({ DeltaSync::Op::Kind::COPY, offset, length }) ;
+            }
+
+            void    Literal (const uint8_t *data, size_t length) {
+                if (length == 0) {
+                    return ;
+                }
+                const uint64_t  offset = patch_.literals.size () ;
+                patch_.literals.insert (patch_.literals.end (), data, data + length) ;
+                if (! patch_.ops.empty () && patch_.ops.back ().kind == DeltaSync::Op::Kind::LITERAL) {
+                    patch_.ops.back ().length += length ;
+                    return ;
+                }
+                patch_.ops.push_back ({ DeltaSync::Op::Kind::LITERAL, offset, length }) ;
+            }
+        } ;
+    }
+
+    const uint32_t  DeltaSync::DEFAULT_BLOCK_SIZE ;
+    const uint32_t  DeltaSync::DEFAULT_STRONG_LENGTH ;
+
+    uint32_t    DeltaSync::WeakChecksum (const void *data, size_t size) {
+        return RollingChecksum { static_cast<const uint8_t *> (data), size }.GetValue () ;
+    }
+
+    DeltaSync::Signature    DeltaSync::MakeSignature (const void *data, size_t size, uint32_t block_size, uint32_t strong_length) {
+        return MakeSignature (Parameter ().GetParameterBlock (), data, size, block_size, strong_length) ;
+    }
+
+    DeltaSync::Signature    DeltaSync::MakeSignature ( const parameter_block_t &param
+                                                     , const void *data, size_t size
+                                                     , uint32_t block_size, uint32_t strong_length
+                                                     , Executor *executor) {
+        if (block_size == 0 || MAX_BLOCK_SIZE < block_size) {
+            throw std::invalid_argument { "DeltaSync: block size is out of range" } ;
+        }
+        if (strong_length < MIN_STRONG_LENGTH || Digest::SIZE < strong_length) {
+            throw std::invalid_argument { "DeltaSync: strong hash length is out of range" } ;
+        }
+        Signature   sig ;
+        Parameter   P { param } ;
+        P.SetDigestLength (static_cast<uint8_t> (strong_length)) ;
+        P.CopyTo (sig.param) ;
+        sig.block_size = block_size ;
+        sig.strong_length = strong_length ;
+        sig.basis_length = size ;
+
+        const size_t    count = (size + block_size - 1) / block_size ;
+        sig.weak.resize (count) ;
+        sig.strong.resize (count * strong_length) ;
+        if (count == 0) {
+            return sig ;
+        }
+        auto const *    src = static_cast<const uint8_t *> (data) ;
+        const size_t    jobs = (count + JOB_BLOCKS - 1) / JOB_BLOCKS ;
+        select_executor (executor, count <= JOB_BLOCKS).Run (jobs, [&sig, src, size, count](size_t job) {
+            const size_t    first = job * JOB_BLOCKS ;
+            const size_t    n = std::min (JOB_BLOCKS, count - first) ;
+            std::vector<const void *>   ptrs (n) ;
+            std::vector<size_t>         lengths (n) ;
+            std::vector<Digest>         digests (n) ;
+            for (size_t i = 0 ; i < n ; ++i) {
+                const size_t    off = (first + i) * sig.block_size ;
+                ptrs [i] = src + off ;
+                lengths [i] = std::min<size_t> (sig.block_size, size - off) ;
+                sig.weak [first + i] = RollingChecksum { src + off, lengths [i] }.GetValue () ;
+            }
+            ApplyBatch (sig.param, nullptr, 0, n, ptrs.data (), lengths.data (), digests.data ()) ;
+            for (size_t i = 0 ; i < n ; ++i) {
+                memcpy (&sig.strong [(first + i) * sig.strong_length], digests [i].data (), sig.strong_length) ;
+            }
+        }) ;
+        return sig ;
+    }
+
+    DeltaSync::Patch    DeltaSync::MakePatch (const Signature &signature, const void *data, size_t size) {
+        check_signature (signature) ;
+        auto const *    src = static_cast<const uint8_t *> (data) ;
+        const size_t    L = signature.block_size ;
+        const size_t    SL = signature.strong_length ;
+        const uint64_t  full_blocks = signature.basis_length / L ;
+        const size_t    last_length = static_cast<size_t> (signature.basis_length % L) ;
+
+        Patch       patch ;
+        patch.target_length = size ;
+        patch.target_digest = Apply (nullptr, 0, data, size) ;
+        PatchWriter W { patch } ;
+
+        auto strong_matches = [&signature, SL](const Digest &d, uint64_t block) {
+            return memcmp (d.data (), &signature.strong [static_cast<size_t> (block * SL)], SL) == 0 ;
+        } ;
+
+        BlockIndex  index { signature, full_blocks } ;
+        size_t      pos = 0 ;
+        size_t      literal = 0 ;           // Start of the pending literal.
+        uint64_t    expected = NO_BLOCK ;   // Block following the last match.
+        while (0 < full_blocks && pos + L <= size) {
+            RollingChecksum     weak { src + pos, L } ;
+            for (;;) {
+                const uint32_t  w = weak.GetValue () ;
+                uint64_t        found = NO_BLOCK ;
+                bool            hashed = false ;
+                Digest          strong ;
+                for (uint32_t i = index.First (w) ; i != NO_ENTRY ; i = index.Next (i)) {
+                    if (signature.weak [i] != w) {
+                        continue ;
+                    }
+                    if (! hashed) {
+                        strong = Apply (signature.param, nullptr, 0, src + pos, L) ;
+                        hashed = true ;
+                    }
+                    if (strong_matches (strong, i)) {
+                        found = i ;
+                        if (i == expected) {
+                            break ;
+                        }
+                    }
+                }
+                if (found != NO_BLOCK) {
+                    W.Literal (src + literal, pos - literal) ;
+                    W.Copy (found * L, L) ;
+                    pos += L ;
+                    literal = pos ;
+                    expected = found + 1 ;
+                    break ;
+                }
+                if (size <= pos + L) {
+                    pos = size ;
+                    break ;
+                }
+                weak.Roll (src [pos], src [pos + L]) ;
+                ++pos ;
+            }
+        }
+        // The short last block of the basis can only match the tail.
+        if (0 < last_length && last_length <= size - literal) {
+            const uint8_t * tail = src + size - last_length ;
+            if (RollingChecksum { tail, last_length }.GetValue () == signature.weak [static_cast<size_t> (full_blocks)]
+                && strong_matches (Apply (signature.param, nullptr, 0, tail, last_length), full_blocks)) {
+                W.Literal (src + literal, size - last_length - literal) ;
+                W.Copy (full_blocks * L, last_length) ;
+                literal = size ;
+            }
+        }
+        W.Literal (src + literal, size - literal) ;
+        return patch ;
+    }
+
+    std::vector<uint8_t>    DeltaSync::ApplyPatch (const void *basis, size_t basis_size, const Patch &patch) {
+        auto const *    src = static_cast<const uint8_t *> (basis) ;
+        std::vector<uint8_t>    result ;
+        result.reserve (static_cast<size_t> (patch.target_length)) ;
+        for (auto const &op : patch.ops) {
+            const uint64_t  limit = (op.kind == Op::Kind::COPY) ? basis_size : patch.literals.size () ;
+            if (limit < op.offset || limit - op.offset < op.length) {
+                throw std::invalid_argument { "DeltaSync::ApplyPatch: op refers out of range" } ;
+            }
+            const uint8_t * p = (op.kind == Op::Kind::COPY) ? src + op.offset : patch.literals.data () + op.offset ;
+            result.insert (result.end (), p, p + op.length) ;
+        }
+        if (result.size () != patch.target_length
+            || ! Digest::IsEqual (Apply (nullptr, 0, result.data (), result.size ()), patch.target_digest)) {
+            throw MismatchError { "DeltaSync::ApplyPatch: result does not match the target" } ;
+        }
+        return result ;
+    }
+}       /* end of [namespace BLAKE2] */
+/*
+ * [END OF FILE]
+ */
@@ -0,0 +1,361 @@
+/*
+ * DigestSet.cpp: Immutable set of truncated digests.
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#include <algorithm>
+#include <fstream>
+#include <vector>
+#include "BLAKE2/DigestSet.hpp"
+#include "Support.h"
+
+#ifdef HAVE_CONFIG_H
+#   include "config.h"
+#endif
+
+#if defined (TARGET_HAVE_AVX2) && defined (__AVX2__)
+#   include <immintrin.h>
+#   define USE_AVX2_SCAN    1
+#elif defined (__SSE2__)
+#   include <emmintrin.h>
+#   define USE_SSE2_SCAN    1
+#endif
+
+#ifndef _WIN32
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+#endif
+
+#if defined (__GNUC__)
+#   define PREFETCH(P_)     __builtin_prefetch ((P_))
+#else
+#   define PREFETCH(P_)     do { /* NO-OP */ } while (0)
+#endif
+
+namespace BLAKE2 {
+
+    namespace {
+        const char      MAGIC [8] = { 'B', 'L', 'A', 'K', 'E', '2', 'D', 'S' } ;
+        const uint32_t  VERSION = 1 ;
+        const size_t    HEADER_SIZE = 64 ;
+        const uint32_t  MAX_BUCKET_BITS = 40 ;
+        const size_t    PREFETCH_DISTANCE = 8 ;
+
+        /** Numeric comparison of big-endian loaded halves equals the byte order.  */
+        struct Key {
+            uint64_t    hi ;
+            uint64_t    lo ;
+
+            bool    operator < (const Key &other) const {
+                return hi < other.hi || (hi == other.hi && lo < other.lo) ;
+            }
+
+            bool    operator == (const Key &other) const {
+                return hi == other.hi && lo == other.lo ;
+            }
+        } ;
+
+        inline uint64_t bucket_of (uint64_t hi, uint32_t bits) {
+            return (bits == 0) ? 0 : (hi >> (64 - bits)) ;
+        }
+
+        size_t  offsets_size (uint32_t bits) {
+            return 8 * ((size_t { 1 } << bits) + 1) ;
+        }
+
+        size_t  keys_offset (uint32_t bits) {
+            return (HEADER_SIZE + offsets_size (bits) + 63) & ~size_t { 63 } ;
+        }
+
+        /**
+         * Scans COUNT keys from P for NEEDLE.
+         */
+        bool    scan (const uint8_t *p, uint64_t count, const uint8_t *needle) {
+#if defined (USE_AVX2_SCAN)
+            const __m128i   n128 = _mm_loadu_si128 ((const __m128i *)needle) ;
+            const __m256i   n256 = _mm256_broadcastsi128_si256 (n128) ;
+            uint64_t    i = 0 ;
+            for ( ; i + 2 <= count ; i += 2) {
+                __m256i     x = _mm256_loadu_si256 ((const __m256i *)(p + DigestSet::KEY_LENGTH * i)) ;
+                uint32_t    m = static_cast<uint32_t> (_mm256_movemask_epi8 (_mm256_cmpeq_epi8 (x, n256))) ;
+                if ((m & 0xFFFFu) == 0xFFFFu || (m >> 16) == 0xFFFFu) {
+                    return true ;
+                }
+            }
+            if (i < count) {
+                __m128i x = _mm_loadu_si128 ((const __m128i *)(p + DigestSet::KEY_LENGTH * i)) ;
+                return _mm_movemask_epi8 (_mm_cmpeq_epi8 (x, n128)) == 0xFFFF ;
+            }
+            return false ;
+#elif defined (USE_SSE2_SCAN)
+            const __m128i   n128 = _mm_loadu_si128 ((const __m128i *)needle) ;
+            for (uint64_t i = 0 ; i < count ; ++i) {
+                __m128i x = _mm_loadu_si128 ((const __m128i *)(p + DigestSet::KEY_LENGTH * i)) ;
+                if (_mm_movemask_epi8 (_mm_cmpeq_epi8 (x, n128)) == 0xFFFF) {
+                    return true ;
+                }
+            }
+            return false ;
+#else
+            for (uint64_t i = 0 ; i < count ; ++i) {
+                if (memcmp (p + DigestSet::KEY_LENGTH * i, needle, DigestSet::KEY_LENGTH) == 0) {
+                    return true ;
+                }
+            }
+            return false ;
+#endif
+        }
+    }
+
+    /**
+     * Backing bytes, owned or mapped.
+     */
+    class DigestSet::Image {
+    private:
+        std::vector<uint8_t>    owned_ ;
+        const uint8_t *         data_ ;
+        size_t                  size_ ;
+        bool                    mapped_ ;
+    public:
+        explicit Image (std::vector<uint8_t> &&bytes)
+                : owned_ { std::move (bytes) }
+                , data_ { owned_.data () }
+                , size_ { owned_.size () }
+                , mapped_ { false } {
+            /* NO-OP */
+        }
+
+        Image (const uint8_t *data, size_t size)
+                : data_ { data }
+                , size_ { size }
+                , mapped_ { true } {
+            /* NO-OP */
+        }
+
+        ~Image () {
+#ifndef _WIN32
+            if (mapped_) {
+                ::munmap (const_cast<uint8_t *> (data_), size_) ;
+            }
+#endif
+        }
+
+        Image (const Image &) = delete ;
+
+        Image &     operator = (const Image &) = delete ;
+
+        const uint8_t *     data () const {
+            return data_ ;
+        }
+
+        size_t  size () const {
+            return size_ ;
+        }
+    } ;
+
+    const size_t    DigestSet::KEY_LENGTH ;
+
+    DigestSet::DigestSet () : DigestSet { nullptr, 0 } {
+        /* NO-OP */
+    }
+
+    DigestSet::DigestSet (const Digest *digests, size_t count) {
+        uint32_t    bits = 0 ;
+        while ((uint64_t { 4 } << bits) < count && bits < MAX_BUCKET_BITS) {
+            ++bits ;
+        }
+        const uint64_t  bucket_count = uint64_t { 1 } << bits ;
+
+        // Radix pass on the leading bits, then the buckets are sorted one by one.
+        std::vector<uint64_t>   offsets (bucket_count + 1, 0) ;
+        for (size_t i = 0 ; i < count ; ++i) {
+            ++offsets [bucket_of (load64be (digests [i].data ()), bits) + 1] ;
+        }
+        for (uint64_t b = 0 ; b < bucket_count ; ++b) {
+            offsets [b + 1] += offsets [b] ;
+        }
+        std::vector<Key>    keys (count) ;
+        {
+            std::vector<uint64_t>   pos (offsets.begin (), offsets.end () - 1) ;
+            for (size_t i = 0 ; i < count ; ++i) {
+                Key k { load64be (digests [i].data ()), load64be (digests [i].data () + 8) } ;
+                keys [pos [bucket_of (k.hi, bits)]++] = k ;
+            }
+        }
+        uint64_t    out = 0 ;
+        for (uint64_t b = 0 ; b < bucket_count ; ++b) {
+            auto    first = keys.begin () + static_cast<ptrdiff_t> (offsets [b]) ;
+            auto    last = keys.begin () + static_cast<ptrdiff_t> (offsets [b + 1]) ;
+            std::sort (first, last) ;
+            last = std::unique (first, last) ;
+            offsets [b] = out ;
+            for (auto it = first ; it != last ; ++it) {
+                keys [out++] = *it ;
+            }
+        }
+        offsets [bucket_count] = out ;
+
+        const size_t    key_base = keys_offset (bits) ;
+        std::vector<uint8_t>    bytes (key_base + KEY_LENGTH * out, 0) ;
+        memcpy (&bytes [0], MAGIC, sizeof (MAGIC)) ;
+        store32le (&bytes [ 8], VERSION) ;
+        store32le (&bytes [12], static_cast<uint32_t> (KEY_LENGTH)) ;
+        store64le (&bytes [16], out) ;
+        store32le (&bytes [24], bits) ;
+        for (uint64_t b = 0 ; b <= bucket_count ; ++b) {
+            store64le (&bytes [HEADER_SIZE + 8 * b], offsets [b]) ;
+        }
+        for (uint64_t i = 0 ; i < out ; ++i) {
+            store64be (&bytes [key_base + KEY_LENGTH * i + 0], keys [i].hi) ;
+            store64be (&bytes [key_base + KEY_LENGTH * i + 8], keys [i].lo) ;
+        }
+        Attach (std::make_unique<Image> (std::move (bytes))) ;
+    }
+
+    DigestSet::DigestSet (DigestSet &&src)
+            : image_ { std::move (src.image_) }
+            , offsets_ { src.offsets_ }
+            , keys_ { src.keys_ }
+            , count_ { src.count_ }
+            , bucket_bits_ { src.bucket_bits_ } {
+        src.count_ = 0 ;
+    }
+
+    DigestSet &     DigestSet::operator = (DigestSet &&src) {
+        if (this != &src) {
+            image_ = std::move (src.image_) ;
+            offsets_ = src.offsets_ ;
+            keys_ = src.keys_ ;
+            count_ = src.count_ ;
+            bucket_bits_ = src.bucket_bits_ ;
+            src.count_ = 0 ;
+        }
+        return *this ;
+    }
+
+    DigestSet::~DigestSet () = default ;
+
+    void    DigestSet::Attach (std::unique_ptr<Image> &&image) {
+        const uint8_t * p = image->data () ;
+        const size_t    size = image->size () ;
+        if (size < HEADER_SIZE || memcmp (p, MAGIC, sizeof (MAGIC)) != 0) {
+            throw FormatError { "Not a digest set" } ;
+        }
+        if (load32le (p + 8) != VERSION || load32le (p + 12) != KEY_LENGTH) {
+            throw FormatError { "Unsupported digest set version" } ;
+        }
+        const uint64_t  count = load64le (p + 16) ;
+        const uint32_t  bits = load32le (p + 24) ;
+        if (MAX_BUCKET_BITS < bits || size < keys_offset (bits)
+            || (size - keys_offset (bits)) / KEY_LENGTH < count
+            || load64le (p + HEADER_SIZE + 8 * (uint64_t { 1 } << bits)) != count) {
+            throw FormatError { "Truncated digest set" } ;
+        }
+        // Lookups index the keys with these unchecked.
+        uint64_t    prev = 0 ;
+        for (uint64_t b = 0 ; b <= (uint64_t { 1 } << bits) ; ++b) {
+            const uint64_t  off = load64le (p + HEADER_SIZE + 8 * b) ;
+            if (off < prev || count < off) {
+                throw FormatError { "Corrupted digest set offsets" } ;
+            }
+            prev = off ;
+        }
+        offsets_ = p + HEADER_SIZE ;
+        keys_ = p + keys_offset (bits) ;
+        count_ = count ;
+        bucket_bits_ = bits ;
+        image_ = std::move (image) ;
+    }
+
+    DigestSet   DigestSet::Open (const std::string &path) {
+        DigestSet   result ;
+#ifdef _WIN32
+        std::ifstream   in { path, std::ios::binary } ;
+        if (! in) {
+            raise_errno ("open " + path) ;
+        }
+        std::vector<uint8_t>    bytes { std::istreambuf_iterator<char> { in }, std::istreambuf_iterator<char> {} } ;
+        result.Attach (std::make_unique<Image> (std::move (bytes))) ;
+#else
+        int     fd = ::open (path.c_str (), O_RDONLY) ;
+        if (fd < 0) {
+            raise_errno ("open " + path) ;
+        }
+        struct stat st ;
+        if (::fstat (fd, &st) != 0) {
+            int     err = errno ;
+            ::close (fd) ;
+            errno = err ;
+            raise_errno ("fstat " + path) ;
+        }
+        const auto  size = static_cast<size_t> (st.st_size) ;
+        if (size < HEADER_SIZE) {
+            ::close (fd) ;
+            throw FormatError { "Not a digest set: " + path } ;
+        }
+        void *  p = ::mmap (nullptr, size, PROT_READ, MAP_SHARED, fd, 0) ;
+        int     err = errno ;
+        ::close (fd) ;
+        if (p == MAP_FAILED) {
+            errno = err ;
+            raise_errno ("mmap " + path) ;
+        }
+        result.Attach (std::make_unique<Image> (static_cast<const uint8_t *> (p), size)) ;
+#endif
+        return result ;
+    }
+
+    void    DigestSet::Save (const std::string &path) const {
+        if (! image_) {
+            // Moved from.
+            DigestSet {}.Save (path) ;
+            return ;
+        }
+        std::ofstream   out { path, std::ios::binary | std::ios::trunc } ;
+        if (! out) {
+            raise_errno ("open " + path) ;
+        }
+        out.write (reinterpret_cast<const char *> (image_->data ()), static_cast<std::streamsize> (image_->size ())) ;
+        out.close () ;
+        if (! out) {
+            raise_errno ("write " + path) ;
+        }
+    }
+
+    uint64_t    DigestSet::BucketOf (const uint8_t *key) const {
+        return bucket_of (load64be (key), bucket_bits_) ;
+    }
+
+    bool    DigestSet::Contains (const Digest &digest) const {
+        if (count_ == 0) {
+            return false ;
+        }
+        const uint64_t  b = BucketOf (digest.data ()) ;
+        const uint64_t  begin = load64le (offsets_ + 8 * b) ;
+        const uint64_t  end = load64le (offsets_ + 8 * (b + 1)) ;
+        return scan (keys_ + KEY_LENGTH * begin, end - begin, digest.data ()) ;
+    }
+
+    void    DigestSet::Contains (const Digest *digests, size_t count, bool *result) const {
+        if (count_ == 0) {
+            std::fill (result, result + count, false) ;
+            return ;
+        }
+        // Offsets are prefetched 2 x PREFETCH_DISTANCE ahead, keys PREFETCH_DISTANCE ahead.
+        for (size_t i = 0 ; i < count ; ++i) {
+            if (i + 2 * PREFETCH_DISTANCE < count) {
+                PREFETCH (offsets_ + 8 * BucketOf (digests [i + 2 * PREFETCH_DISTANCE].data ())) ;
+            }
+            if (i + PREFETCH_DISTANCE < count) {
+                const uint64_t  b = BucketOf (digests [i + PREFETCH_DISTANCE].data ()) ;
+                PREFETCH (keys_ + KEY_LENGTH * load64le (offsets_ + 8 * b)) ;
+            }
+            result [i] = Contains (digests [i]) ;
+        }
+    }
+}       /* end of [namespace BLAKE2] */
+/*
+ * [END OF FILE]
+ */
@@ -0,0 +1,459 @@
+/*
+ * DirectoryHasher.cpp: Incremental directory tree hashing with a persistent stat cache.
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include "BLAKE2/DirectoryHasher.hpp"
+#include "BLAKE2/ThreadPool.hpp"
+#include "Support.h"
+
+#ifdef HAVE_CONFIG_H
+#   include "config.h"
+#endif
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace BLAKE2 {
+
+    namespace {
+        const char      CACHE_MAGIC [8] = { 'B', '2', 'D', 'I', 'R', 'C', 'H', 1 } ;
+        const size_t    CACHE_HEADER_SIZE = 128 ;
+        const size_t    OFF_CACHE_COUNT = 8 ;
+        const size_t    OFF_CACHE_PARAM = 64 ;
+        const size_t    ENTRY_FIXED_SIZE = 5 * 8 + Digest::SIZE + 4 ;     // + path
+        const size_t    READ_BUFFER_SIZE = 256 * 1024 ;
+        const size_t    SEQUENTIAL_LIMIT = 4 ;      // Fewer jobs run on the calling thread.
+        const size_t    NO_INDEX = ~static_cast<size_t> (0) ;
+
+        enum Kind : uint8_t {
+            KIND_FILE       = 0,
+            KIND_EXECUTABLE = 1,
+            KIND_DIRECTORY  = 2,
+            KIND_SYMLINK    = 3,
+        } ;
+
+        void    write_all (int fd, const void *data, size_t size, const std::string &path) {
+            auto const *    p = static_cast<const uint8_t *> (data) ;
+            while (0 < size) {
+                ssize_t n = ::write (fd, p, size) ;
+                if (n < 0) {
+                    if (errno == EINTR) {
+                        continue ;
+                    }
+                    raise_errno ("write " + path) ;
+                }
+                p += n ;
+                size -= static_cast<size_t> (n) ;
+            }
+        }
+
+        int64_t     to_ns (const struct timespec &ts) {
+            return static_cast<int64_t> (ts.tv_sec) * 1000000000 + ts.tv_nsec ;
+        }
+
+        int64_t     mtime_ns (const struct stat &st) {
+#if defined (__APPLE__)
+            return to_ns (st.st_mtimespec) ;
+#else
+            return to_ns (st.st_mtim) ;
+#endif
+        }
+
+        int64_t     ctime_ns (const struct stat &st) {
+#if defined (__APPLE__)
+            return to_ns (st.st_ctimespec) ;
+#else
+            return to_ns (st.st_ctim) ;
+#endif
+        }
+
+        int64_t     now_ns () {
+            struct timespec ts ;
+            ::clock_gettime (CLOCK_REALTIME, &ts) ;
+            return to_ns (ts) ;
+        }
+
+        std::string     join (const std::string &dir, const std::string &name) {
+            return dir.empty () ? name : dir + "/" + name ;
+        }
+
+        parameter_block_t   directory_parameter (const parameter_block_t &param) {
+            Parameter   P { param } ;
+            P.SetNodeDepth (1) ;
+            return P.GetParameterBlock () ;
+        }
+    }
+
+    const int64_t   DirectoryHasher::RACY_WINDOW_NS ;
+
+    /**
+     * State of a `Hash` call.
+     * Directories are kept level by level, so a level is scanned (and later combined) in parallel.
+     */
+    struct DirectoryHasher::Walk {
+        struct Item {
+            std::string name ;
+            uint8_t     kind ;
+            size_t      index ;         // Into `files` of the directory, or into `dirs`.
+            Digest      digest ;        // Target of a symbolic link.
+        } ;
+
+        struct File {
+            std::string path ;          // Relative to the root.
+            CacheEntry  entry ;
+            bool        cached ;
+            bool        cacheable ;
+        } ;
+
+        struct Directory {
+            std::string         path ;
+            std::vector<Item>   items ;
+            std::vector<File>   files ;
+            Digest              digest ;
+        } ;
+
+        std::string             root ;
+        int64_t                 start_ns ;
+        uint64_t                skip_device ;   // The cache file is not a part of the tree.
+        uint64_t                skip_inode ;
+        std::vector<Directory>  dirs ;
+    } ;
+
+    DirectoryHasher::DirectoryHasher (const std::string &cache_path)
+            : DirectoryHasher { Parameter ().GetParameterBlock (), cache_path } {
+        /* NO-OP */
+    }
+
+    DirectoryHasher::DirectoryHasher (const parameter_block_t &param, const std::string &cache_path, Executor *executor)
+            : cache_path_ { cache_path }
+            , executor_ { executor }
+            , stats_ { 0, 0, 0, 0 } {
+        Parameter   P { param } ;
+        P.SetDigestLength (static_cast<uint8_t> (Digest::SIZE))
+         .SetKeyLength (0)
+         .SetFanoutCount (0)
+         .SetDepth (255)
+         .SetLeafLength (0)
+         .SetNodeOffset (0)
+         .SetNodeDepth (0)
+         .SetInnerLength (static_cast<uint8_t> (Digest::SIZE)) ;
+        P.CopyTo (param_) ;
+        if (! cache_path_.empty ()) {
+            Load () ;
+        }
+    }
+
+    Digest  DirectoryHasher::Hash (const std::string &root) {
+        Walk    W ;
+        W.root = root ;
+        W.start_ns = now_ns () ;
+        W.skip_device = 0 ;
+        W.skip_inode = 0 ;
+        struct stat st ;
+        if (! cache_path_.empty () && ::stat (cache_path_.c_str (), &st) == 0) {
+            W.skip_device = static_cast<uint64_t> (st.st_dev) ;
+            W.skip_inode = static_cast<uint64_t> (st.st_ino) ;
+        }
+        if (::stat (root.c_str (), &st) != 0) {
+            raise_errno ("stat " + root) ;
+        }
+        if (! S_ISDIR (st.st_mode)) {
+            errno = ENOTDIR ;
+            raise_errno (root) ;
+        }
+        const parameter_block_t     leaf_param = param_ ;
+
+        // Scans a directory, files are looked up in the cache (read only, so jobs share it).
+        auto scan = [this, &W, &leaf_param](Walk::Directory &D) {
+            const std::string   path = join (W.root, D.path) ;
+            std::unique_ptr<DIR, int (*)(DIR *)>    dir { ::opendir (path.c_str ()), ::closedir } ;
+            if (! dir) {
+                raise_errno ("opendir " + path) ;
+            }
+            const int   fd = ::dirfd (dir.get ()) ;
+            for (;;) {
+                errno = 0 ;
+                const struct dirent *   e = ::readdir (dir.get ()) ;
+                if (e == nullptr) {
+                    if (errno != 0) {
+                        raise_errno ("readdir " + path) ;
+                    }
+                    break ;
+                }
+                const std::string   name { e->d_name } ;
+                if (name == "." || name == "..") {
+                    continue ;
+                }
+                struct stat st ;
+                if (::fstatat (fd, name.c_str (), &st, AT_SYMLINK_NOFOLLOW) != 0) {
+                    if (errno == ENOENT) {
+                        continue ;      // Removed while scanning.
+                    }
+                    raise_errno ("stat " + join (path, name)) ;
+                }
+                if (static_cast<uint64_t> (st.st_dev) == W.skip_device && static_cast<uint64_t> (st.st_ino) == W.skip_inode) {
+                    continue ;
+                }
+                Walk::Item  item { name, KIND_FILE, NO_INDEX, Digest {} } ;
+                if (S_ISREG (st.st_mode)) {
+                    Walk::File  F ;
+                    F.path = join (D.path, name) ;
+                    F.entry.device = static_cast<uint64_t> (st.st_dev) ;
+                    F.entry.inode = static_cast<uint64_t> (st.st_ino) ;
+                    F.entry.size = static_cast<uint64_t> (st.st_size) ;
+                    F.entry.mtime_ns = mtime_ns (st) ;
+                    F.entry.ctime_ns = ctime_ns (st) ;
+                    F.cached = false ;
+                    F.cacheable = F.entry.mtime_ns + RACY_WINDOW_NS < W.start_ns ;
+                    auto it = cache_.find (F.path) ;
+                    if (it != cache_.end ()) {
+                        auto const &    C = it->second ;
+                        if (C.device == F.entry.device && C.inode == F.entry.inode && C.size == F.entry.size
+                            && C.mtime_ns == F.entry.mtime_ns && C.ctime_ns == F.entry.ctime_ns) {
+                            F.entry.digest = C.digest ;
+                            F.cached = true ;
+                        }
+                    }
+                    item.kind = (st.st_mode & (S_IXUSR | S_IXGRP | S_IXOTH)) != 0 ? KIND_EXECUTABLE : KIND_FILE ;
+                    item.index = D.files.size () ;
+                    D.files.push_back (std::move (F)) ;
+                }
+                else if (S_ISDIR (st.st_mode)) {
+                    item.kind = KIND_DIRECTORY ;
+                }
+                else if (S_ISLNK (st.st_mode)) {
+                    std::vector<char>   target (static_cast<size_t> (st.st_size) + 1) ;
+                    ssize_t n = ::readlinkat (fd, name.c_str (), target.data (), target.size ()) ;
+                    if (n < 0) {
+                        raise_errno ("readlink " + join (path, name)) ;
+                    }
+                    item.kind = KIND_SYMLINK ;
+                    item.digest = Apply (leaf_param, nullptr, 0, target.data (), static_cast<size_t> (n)) ;
+                }
+                else {
+                    continue ;
+                }
+                D.items.push_back (std::move (item)) ;
+            }
+            std::sort (D.items.begin (), D.items.end (), [](const Walk::Item &a, const Walk::Item &b) {
+                return a.name < b.name ;
+            }) ;
+        } ;
+
+        // Scans level by level, subdirectories are numbered after each level.
+        std::vector<size_t>     levels ;
+        W.dirs.push_back (Walk::Directory {}) ;
+        for (size_t begin = 0 ; begin < W.dirs.size () ; ) {
+            const size_t    end = W.dirs.size () ;
+            levels.push_back (begin) ;
+            select_executor (executor_, end - begin <= SEQUENTIAL_LIMIT).Run (end - begin, [&W, &scan, begin](size_t i) {
+                scan (W.dirs [begin + i]) ;
+            }) ;
+            for (size_t i = begin ; i < end ; ++i) {
+                for (auto &item : W.dirs [i].items) {
+                    if (item.kind == KIND_DIRECTORY) {
+                        item.index = W.dirs.size () ;
+                        W.dirs.push_back (Walk::Directory {}) ;
+                        W.dirs.back ().path = join (W.dirs [i].path, item.name) ;
+                    }
+                }
+            }
+            begin = end ;
+        }
+
+        // Reads the files missing in the cache.
+        std::vector<Walk::File *>   pending ;
+        Statistics  stats { W.dirs.size (), 0, 0, 0 } ;
+        for (auto &D : W.dirs) {
+            stats.files += D.files.size () ;
+            for (auto &F : D.files) {
+                if (! F.cached) {
+                    pending.push_back (&F) ;
+                    stats.hashed_bytes += F.entry.size ;
+                }
+            }
+        }
+        stats.hashed_files = pending.size () ;
+        select_executor (executor_, pending.size () <= SEQUENTIAL_LIMIT).Run (pending.size (), [&W, &pending, &leaf_param](size_t i) {
+            Walk::File &    F = *pending [i] ;
+            const std::string   path = join (W.root, F.path) ;
+            int fd = ::open (path.c_str (), O_RDONLY | O_NOFOLLOW | O_CLOEXEC) ;
+            if (fd < 0) {
+                raise_errno ("open " + path) ;
+            }
+            std::unique_ptr<int, void (*)(int *)>   guard { &fd, [](int *p) { ::close (*p) ; } } ;
+            Generator               g { leaf_param } ;
+            std::vector<uint8_t>    buffer (READ_BUFFER_SIZE) ;
+            for (;;) {
+                ssize_t n = ::read (fd, buffer.data (), buffer.size ()) ;
+                if (n < 0) {
+                    if (errno == EINTR) {
+                        continue ;
+                    }
+                    raise_errno ("read " + path) ;
+                }
+                if (n == 0) {
+                    break ;
+                }
+                g.Update (buffer.data (), static_cast<size_t> (n)) ;
+            }
+            F.entry.digest = g.Finalize () ;
+            // Modified while reading: the digest is used once, but not cached.
+            struct stat st ;
+            if (::fstat (fd, &st) != 0) {
+                raise_errno ("stat " + path) ;
+            }
+            if (static_cast<uint64_t> (st.st_size) != F.entry.size
+                || mtime_ns (st) != F.entry.mtime_ns || ctime_ns (st) != F.entry.ctime_ns) {
+                F.cacheable = false ;
+            }
+        }) ;
+
+        // Combines the deepest level first.
+        const parameter_block_t     dir_param = directory_parameter (param_) ;
+        for (size_t l = levels.size () ; 0 < l ; --l) {
+            const size_t    begin = levels [l - 1] ;
+            const size_t    end = (l < levels.size ()) ? levels [l] : W.dirs.size () ;
+            select_executor (executor_, end - begin <= SEQUENTIAL_LIMIT).Run (end - begin, [&W, &dir_param, begin](size_t i) {
+                Walk::Directory &   D = W.dirs [begin + i] ;
+                Generator   g { dir_param } ;
+                for (auto const &item : D.items) {
+                    const Digest &  digest = (item.kind == KIND_DIRECTORY) ? W.dirs [item.index].digest
+                                           : (item.kind == KIND_SYMLINK)   ? item.digest
+                                           :                                 D.files [item.index].entry.digest ;
+                    uint8_t tmp [9] ;
+                    tmp [0] = item.kind ;
+                    store64le (tmp + 1, item.name.size ()) ;
+                    g.Update (tmp, sizeof (tmp))
+                     .Update (item.name.data (), item.name.size ())
+                     .Update (digest.data (), digest.size ()) ;
+                }
+                if (begin + i == 0) {
+                    g.SetLastNode () ;
+                }
+                D.digest = g.Finalize () ;
+            }) ;
+        }
+
+        std::unordered_map<std::string, CacheEntry>     next ;
+        next.reserve (static_cast<size_t> (stats.files)) ;
+        for (auto &D : W.dirs) {
+            for (auto &F : D.files) {
+                if (F.cacheable) {
+                    next.emplace (std::move (F.path), F.entry) ;
+                }
+            }
+        }
+        cache_.swap (next) ;
+        stats_ = stats ;
+        return W.dirs [0].digest ;
+    }
+
+    void    DirectoryHasher::Load () {
+        int fd = ::open (cache_path_.c_str (), O_RDONLY | O_CLOEXEC) ;
+        if (fd < 0) {
+            if (errno == ENOENT) {
+                return ;
+            }
+            raise_errno ("open " + cache_path_) ;
+        }
+        std::unique_ptr<int, void (*)(int *)>   guard { &fd, [](int *p) { ::close (*p) ; } } ;
+        std::vector<uint8_t>    image ;
+        uint8_t                 tmp [64 * 1024] ;
+        for (;;) {
+            ssize_t n = ::read (fd, tmp, sizeof (tmp)) ;
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue ;
+                }
+                raise_errno ("read " + cache_path_) ;
+            }
+            if (n == 0) {
+                break ;
+            }
+            image.insert (image.end (), tmp, tmp + n) ;
+        }
+        if (image.size () < CACHE_HEADER_SIZE || memcmp (image.data (), CACHE_MAGIC, sizeof (CACHE_MAGIC)) != 0) {
+            throw FormatError { "Bad cache: " + cache_path_ } ;
+        }
+        if (memcmp (image.data () + OFF_CACHE_PARAM, param_.data (), param_.size ()) != 0) {
+            return ;    // Made with other parameters, every digest differs.
+        }
+        const uint64_t  count = load64le (image.data () + OFF_CACHE_COUNT) ;
+        std::unordered_map<std::string, CacheEntry>     cache ;
+        size_t  off = CACHE_HEADER_SIZE ;
+        for (uint64_t i = 0 ; i < count ; ++i) {
+            if (image.size () - off < ENTRY_FIXED_SIZE) {
+                throw FormatError { "Truncated cache: " + cache_path_ } ;
+            }
+            const uint8_t * p = image.data () + off ;
+            CacheEntry  E ;
+            E.device = load64le (p + 0) ;
+            E.inode = load64le (p + 8) ;
+            E.size = load64le (p + 16) ;
+            E.mtime_ns = static_cast<int64_t> (load64le (p + 24)) ;
+            E.ctime_ns = static_cast<int64_t> (load64le (p + 32)) ;
+            E.digest = load_digest (p + 40) ;
+            const size_t    length = load32le (p + 40 + Digest::SIZE) ;
+            off += ENTRY_FIXED_SIZE ;
+            if (image.size () - off < length) {
+                throw FormatError { "Truncated cache: " + cache_path_ } ;
+            }
+            cache.emplace (std::string { reinterpret_cast<const char *> (image.data () + off), length }, E) ;
+            off += length ;
+        }
+        cache_.swap (cache) ;
+    }
+
+    void    DirectoryHasher::Save () const {
+        if (cache_path_.empty ()) {
+            return ;
+        }
+        std::vector<uint8_t>    image (CACHE_HEADER_SIZE) ;
+        memcpy (image.data (), CACHE_MAGIC, sizeof (CACHE_MAGIC)) ;
+        store64le (image.data () + OFF_CACHE_COUNT, cache_.size ()) ;
+        memcpy (image.data () + OFF_CACHE_PARAM, param_.data (), param_.size ()) ;
+        for (auto const &kv : cache_) {
+            auto const &    E = kv.second ;
+            uint8_t tmp [ENTRY_FIXED_SIZE] ;
+            store64le (tmp + 0, E.device) ;
+            store64le (tmp + 8, E.inode) ;
+            store64le (tmp + 16, E.size) ;
+            store64le (tmp + 24, static_cast<uint64_t> (E.mtime_ns)) ;
+            store64le (tmp + 32, static_cast<uint64_t> (E.ctime_ns)) ;
+            memcpy (tmp + 40, E.digest.data (), Digest::SIZE) ;
+            store32le (tmp + 40 + Digest::SIZE, static_cast<uint32_t> (kv.first.size ())) ;
+            image.insert (image.end (), tmp, tmp + sizeof (tmp)) ;
+            image.insert (image.end (), kv.first.begin (), kv.first.end ()) ;
+        }
+        const std::string   tmp_path = cache_path_ + ".tmp" ;
+        int fd = ::open (tmp_path.c_str (), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666) ;
+        if (fd < 0) {
+            raise_errno ("open " + tmp_path) ;
+        }
+        {
+            std::unique_ptr<int, void (*)(int *)>   guard { &fd, [](int *p) { ::close (*p) ; } } ;
+            write_all (fd, image.data (), image.size (), tmp_path) ;
+            if (::fsync (fd) != 0) {
+                raise_errno ("fsync " + tmp_path) ;
+            }
+        }
+        if (::rename (tmp_path.c_str (), cache_path_.c_str ()) != 0) {
+            raise_errno ("rename " + tmp_path) ;
+        }
+    }
+}       /* end of [namespace BLAKE2] */
+/*
+ * [END OF FILE]
+ */
@@ -0,0 +1,599 @@
+/*
+ * Encoding.cpp: Hex and base64 conversion of digests.
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#include <array>
+#include <atomic>
+#include "BLAKE2/Encoding.hpp"
+
+#ifdef HAVE_CONFIG_H
+#   include "config.h"
+#endif
+
+#if defined (TARGET_HAVE_AVX2) || defined (TARGET_HAVE_SSSE3)
+    // The x86 kernels are compiled with target attributes and chosen at runtime by CPUID.
+#   include <immintrin.h>
+#endif
+#ifdef TARGET_HAVE_AVX2
+#   define TARGET_AVX2  __attribute__ ((target ("avx2")))
+#endif
+#ifdef TARGET_HAVE_SSSE3
+#   define TARGET_SSSE3 __attribute__ ((target ("ssse3")))
+#endif
+#if defined (__ARM_NEON) && defined (__aarch64__)
+    // NEON is a part of the AArch64 baseline.
+#   include <arm_neon.h>
+#   define USE_NEON_CODEC   1
+#endif
+
+namespace BLAKE2 {
+
+    namespace {
+        const char  HEX_DIGITS [] = "0123456789abcdef" ;
+        const char  BASE64_ALPHABET [] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/" ;
+        const uint8_t   INVALID = 0xFF ;
+
+        /** Character --> value, INVALID for the others.  */
+        const uint8_t *     base64_table () {
+            static const std::array<uint8_t, 256>   table = [] {
+                std::array<uint8_t, 256>    result ;
+                result.fill (INVALID) ;
+                for (size_t i = 0 ; i < 64 ; ++i) {
+                    result [static_cast<uint8_t> (BASE64_ALPHABET [i])] = static_cast<uint8_t> (i) ;
+                }
+                return result ;
+            } () ;
+            return table.data () ;
+        }
+
+        inline uint8_t  hex_value (char ch) {
+            if ('0' <= ch && ch <= '9') {
+                return static_cast<uint8_t> (ch - '0') ;
+            }
+            if ('a' <= ch && ch <= 'f') {
+                return static_cast<uint8_t> (ch - 'a' + 10) ;
+            }
+            if ('A' <= ch && ch <= 'F') {
+                return static_cast<uint8_t> (ch - 'A' + 10) ;
+            }
+            return INVALID ;
+        }
+
+        /*
+         * SIMD kernels process whole chunks and return # of input units consumed,
+         * the scalar code finishes the rest (and reports errors).
+         */
+
+#ifdef TARGET_HAVE_AVX2
+        TARGET_AVX2 size_t  encode_hex_avx2 (const uint8_t *src, size_t size, char *out) {
+            const __m256i   digits = _mm256_setr_epi8 ( '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f'
+                                                      , '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f') ;
+            const __m256i   mask = _mm256_set1_epi8 (0x0F) ;
+            size_t  i = 0 ;
+            for ( ; i + 32 <= size ; i += 32) {
+                __m256i x = _mm256_loadu_si256 ((const __m256i *)(src + i)) ;
+                __m256i hi = _mm256_shuffle_epi8 (digits, _mm256_and_si256 (_mm256_srli_epi16 (x, 4), mask)) ;
+                __m256i lo = _mm256_shuffle_epi8 (digits, _mm256_and_si256 (x, mask)) ;
+                __m256i a = _mm256_unpacklo_epi8 (hi, lo) ;     // Bytes 0 ... 7 | 16 ... 23
+                __m256i b = _mm256_unpackhi_epi8 (hi, lo) ;     // Bytes 8 ... 15 | 24 ... 31
+                _mm256_storeu_si256 ((__m256i *)(out + 2 * i +  0), _mm256_permute2x128_si256 (a, b, 0x20)) ;
+                _mm256_storeu_si256 ((__m256i *)(out + 2 * i + 32), _mm256_permute2x128_si256 (a, b, 0x31)) ;
+            }
+            return i ;
+        }
+
+        TARGET_AVX2 inline __m256i  hex_nibbles_avx2 (__m256i x, __m256i &valid) {
+            __m256i lower = _mm256_or_si256 (x, _mm256_set1_epi8 (0x20)) ;
+            __m256i is_digit = _mm256_and_si256 ( _mm256_cmpgt_epi8 (x, _mm256_set1_epi8 ('0' - 1))
+                                                , _mm256_cmpgt_epi8 (_mm256_set1_epi8 ('9' + 1), x)) ;
+            __m256i is_alpha = _mm256_and_si256 ( _mm256_cmpgt_epi8 (lower, _mm256_set1_epi8 ('a' - 1))
+                                                , _mm256_cmpgt_epi8 (_mm256_set1_epi8 ('f' + 1), lower)) ;
+            valid = _mm256_and_si256 (valid, _mm256_or_si256 (is_digit, is_alpha)) ;
+            __m256i d = _mm256_sub_epi8 (x, _mm256_set1_epi8 ('0')) ;
+            __m256i a = _mm256_sub_epi8 (lower, _mm256_set1_epi8 ('a' - 10)) ;
+            return _mm256_or_si256 (_mm256_and_si256 (is_digit, d), _mm256_andnot_si256 (is_digit, a)) ;
+        }
+
+        TARGET_AVX2 size_t  decode_hex_avx2 (const char *src, size_t size, uint8_t *out) {
+            const __m256i   weights = _mm256_set1_epi16 (0x0110) ;
+            size_t  i = 0 ;
+            for ( ; i + 32 <= size ; i += 32) {
+                __m256i valid = _mm256_set1_epi8 (-1) ;
+                __m256i x0 = hex_nibbles_avx2 (_mm256_loadu_si256 ((const __m256i *)(src + 2 * i +  0)), valid) ;
+                __m256i x1 = hex_nibbles_avx2 (_mm256_loadu_si256 ((const __m256i *)(src + 2 * i + 32)), valid) ;
+                if (_mm256_movemask_epi8 (valid) != -1) {
+                    break ;
+                }
+                __m256i r = _mm256_packus_epi16 (_mm256_maddubs_epi16 (x0, weights), _mm256_maddubs_epi16 (x1, weights)) ;
+                _mm256_storeu_si256 ((__m256i *)(out + i), _mm256_permute4x64_epi64 (r, 0xD8)) ;
+            }
+            return i ;
+        }
+
+        /** Spreads 12 bytes into 16 x 6bits indices (Mula's method).  */
+        TARGET_AVX2 inline __m256i  base64_indices_avx2 (__m256i in) {
+            in = _mm256_shuffle_epi8 (in, _mm256_set_epi8 ( 10, 11,  9, 10,  7,  8,  6,  7,  4,  5,  3,  4,  1,  2,  0,  1
+                                                          , 10, 11,  9, 10,  7,  8,  6,  7,  4,  5,  3,  4,  1,  2,  0,  1)) ;
+            __m256i t0 = _mm256_and_si256 (in, _mm256_set1_epi32 (0x0FC0FC00)) ;
+            __m256i t1 = _mm256_mulhi_epu16 (t0, _mm256_set1_epi32 (0x04000040)) ;
+            __m256i t2 = _mm256_and_si256 (in, _mm256_set1_epi32 (0x003F03F0)) ;
+            __m256i t3 = _mm256_mullo_epi16 (t2, _mm256_set1_epi32 (0x01000010)) ;
+            return _mm256_or_si256 (t1, t3) ;
+        }
+
+        TARGET_AVX2 inline __m256i  base64_translate_avx2 (__m256i in) {
+            const __m256i   lut = _mm256_setr_epi8 ( 65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0
+                                                   , 65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0) ;
+            __m256i idx = _mm256_subs_epu8 (in, _mm256_set1_epi8 (51)) ;
+            idx = _mm256_sub_epi8 (idx, _mm256_cmpgt_epi8 (in, _mm256_set1_epi8 (25))) ;
+            return _mm256_add_epi8 (in, _mm256_shuffle_epi8 (lut, idx)) ;
+        }
+
+        TARGET_AVX2 size_t  encode_base64_avx2 (const uint8_t *src, size_t size, char *out) {
+            size_t  i = 0 ;
+            size_t  j = 0 ;
+            // Reads 16 bytes per 128bits lane, uses 12.
+            for ( ; i + 28 <= size ; i += 24, j += 32) {
+                __m256i in = _mm256_inserti128_si256 ( _mm256_castsi128_si256 (_mm_loadu_si128 ((const __m128i *)(src + i)))
+                                                     , _mm_loadu_si128 ((const __m128i *)(src + i + 12)), 1) ;
+                _mm256_storeu_si256 ((__m256i *)(out + j), base64_translate_avx2 (base64_indices_avx2 (in))) ;
+            }
+            return i ;
+        }
+
+        TARGET_AVX2 size_t  decode_base64_avx2 (const char *src, size_t size, uint8_t *out, size_t out_size) {
+            const __m256i   lut_lo = _mm256_setr_epi8 ( 0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A
+                                                      , 0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A) ;
+            const __m256i   lut_hi = _mm256_setr_epi8 ( 0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10
+                                                      , 0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10) ;
+            const __m256i   lut_roll = _mm256_setr_epi8 ( 0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0
+                                                        , 0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0) ;
+            const __m256i   mask_2F = _mm256_set1_epi8 (0x2F) ;
+            size_t  i = 0 ;
+            size_t  j = 0 ;
+            // Writes 16 bytes per 128bits lane, 12 of them are meaningful.
+            for ( ; i + 32 <= size && j + 28 <= out_size ; i += 32, j += 24) {
+                __m256i str = _mm256_loadu_si256 ((const __m256i *)(src + i)) ;
+                __m256i hi_nibbles = _mm256_and_si256 (_mm256_srli_epi32 (str, 4), mask_2F) ;
+                __m256i lo_nibbles = _mm256_and_si256 (str, mask_2F) ;
+                __m256i hi = _mm256_shuffle_epi8 (lut_hi, hi_nibbles) ;
+                __m256i lo = _mm256_shuffle_epi8 (lut_lo, lo_nibbles) ;
+                if (! _mm256_testz_si256 (lo, hi)) {
+                    break ;
+                }
+                __m256i eq_2F = _mm256_cmpeq_epi8 (str, mask_2F) ;
+                __m256i roll = _mm256_shuffle_epi8 (lut_roll, _mm256_add_epi8 (eq_2F, hi_nibbles)) ;
+                str = _mm256_add_epi8 (str, roll) ;
+                // Merges 4 x 6bits into 3 bytes.
+                __m256i merged = _mm256_maddubs_epi16 (str, _mm256_set1_epi32 (0x01400140)) ;
+                merged = _mm256_madd_epi16 (merged, _mm256_set1_epi32 (0x00011000)) ;
+                merged = _mm256_shuffle_epi8 (merged, _mm256_setr_epi8 ( 2,  1,  0,  6,  5,  4, 10,  9,  8, 14, 13, 12, -1, -1, -1, -1
+                                                                       , 2,  1,  0,  6,  5,  4, 10,  9,  8, 14, 13, 12, -1, -1, -1, -1)) ;
+                _mm_storeu_si128 ((__m128i *)(out + j +  0), _mm256_castsi256_si128 (merged)) ;
+                _mm_storeu_si128 ((__m128i *)(out + j + 12), _mm256_extracti128_si256 (merged, 1)) ;
+            }
+            return i ;
+        }
+#endif
+
+#ifdef TARGET_HAVE_SSSE3
+        TARGET_SSSE3 size_t  encode_hex_ssse3 (const uint8_t *src, size_t size, char *out) {
+            const __m128i   digits = _mm_setr_epi8 ('0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f') ;
+            const __m128i   mask = _mm_set1_epi8 (0x0F) ;
+            size_t  i = 0 ;
+            for ( ; i + 16 <= size ; i += 16) {
+                __m128i x = _mm_loadu_si128 ((const __m128i *)(src + i)) ;
+                __m128i hi = _mm_shuffle_epi8 (digits, _mm_and_si128 (_mm_srli_epi16 (x, 4), mask)) ;
+                __m128i lo = _mm_shuffle_epi8 (digits, _mm_and_si128 (x, mask)) ;
+                _mm_storeu_si128 ((__m128i *)(out + 2 * i +  0), _mm_unpacklo_epi8 (hi, lo)) ;
+                _mm_storeu_si128 ((__m128i *)(out + 2 * i + 16), _mm_unpackhi_epi8 (hi, lo)) ;
+            }
+            return i ;
+        }
+
+        TARGET_SSSE3 inline __m128i  hex_nibbles_ssse3 (__m128i x, __m128i &valid) {
+            __m128i lower = _mm_or_si128 (x, _mm_set1_epi8 (0x20)) ;
+            __m128i is_digit = _mm_and_si128 ( _mm_cmpgt_epi8 (x, _mm_set1_epi8 ('0' - 1))
+                                             , _mm_cmpgt_epi8 (_mm_set1_epi8 ('9' + 1), x)) ;
+            __m128i is_alpha = _mm_and_si128 ( _mm_cmpgt_epi8 (lower, _mm_set1_epi8 ('a' - 1))
+                                             , _mm_cmpgt_epi8 (_mm_set1_epi8 ('f' + 1), lower)) ;
+            valid = _mm_and_si128 (valid, _mm_or_si128 (is_digit, is_alpha)) ;
+            __m128i d = _mm_sub_epi8 (x, _mm_set1_epi8 ('0')) ;
+            __m128i a = _mm_sub_epi8 (lower, _mm_set1_epi8 ('a' - 10)) ;
+            return _mm_or_si128 (_mm_and_si128 (is_digit, d), _mm_andnot_si128 (is_digit, a)) ;
+        }
+
+        TARGET_SSSE3 size_t  decode_hex_ssse3 (const char *src, size_t size, uint8_t *out) {
+            const __m128i   weights = _mm_set1_epi16 (0x0110) ;
+            size_t  i = 0 ;
+            for ( ; i + 16 <= size ; i += 16) {
+                __m128i valid = _mm_set1_epi8 (-1) ;
+                __m128i x0 = hex_nibbles_ssse3 (_mm_loadu_si128 ((const __m128i *)(src + 2 * i +  0)), valid) ;
+                __m128i x1 = hex_nibbles_ssse3 (_mm_loadu_si128 ((const __m128i *)(src + 2 * i + 16)), valid) ;
+                if (_mm_movemask_epi8 (valid) != 0xFFFF) {
+                    break ;
+                }
+                __m128i r = _mm_packus_epi16 (_mm_maddubs_epi16 (x0, weights), _mm_maddubs_epi16 (x1, weights)) ;
+                _mm_storeu_si128 ((__m128i *)(out + i), r) ;
+            }
+            return i ;
+        }
+
+        TARGET_SSSE3 size_t  encode_base64_ssse3 (const uint8_t *src, size_t size, char *out) {
+            const __m128i   lut = _mm_setr_epi8 (65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0) ;
+            size_t  i = 0 ;
+            size_t  j = 0 ;
+            // Reads 16 bytes, uses 12.
+            for ( ; i + 16 <= size ; i += 12, j += 16) {
+                __m128i in = _mm_loadu_si128 ((const __m128i *)(src + i)) ;
+                in = _mm_shuffle_epi8 (in, _mm_set_epi8 (10, 11,  9, 10,  7,  8,  6,  7,  4,  5,  3,  4,  1,  2,  0,  1)) ;
+                __m128i t0 = _mm_and_si128 (in, _mm_set1_epi32 (0x0FC0FC00)) ;
+                __m128i t1 = _mm_mulhi_epu16 (t0, _mm_set1_epi32 (0x04000040)) ;
+                __m128i t2 = _mm_and_si128 (in, _mm_set1_epi32 (0x003F03F0)) ;
+                __m128i t3 = _mm_mullo_epi16 (t2, _mm_set1_epi32 (0x01000010)) ;
+                __m128i indices = _mm_or_si128 (t1, t3) ;
+                __m128i idx = _mm_subs_epu8 (indices, _mm_set1_epi8 (51)) ;
+                idx = _mm_sub_epi8 (idx, _mm_cmpgt_epi8 (indices, _mm_set1_epi8 (25))) ;
+                _mm_storeu_si128 ((__m128i *)(out + j), _mm_add_epi8 (indices, _mm_shuffle_epi8 (lut, idx))) ;
+            }
+            return i ;
+        }
+
+        TARGET_SSSE3 size_t  decode_base64_ssse3 (const char *src, size_t size, uint8_t *out, size_t out_size) {
+            const __m128i   lut_lo = _mm_setr_epi8 (0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A) ;
+            const __m128i   lut_hi = _mm_setr_epi8 (0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10) ;
+            const __m128i   lut_roll = _mm_setr_epi8 (0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0) ;
+            const __m128i   mask_2F = _mm_set1_epi8 (0x2F) ;
+            size_t  i = 0 ;
+            size_t  j = 0 ;
+            // Writes 16 bytes, 12 of them are meaningful.
+            for ( ; i + 16 <= size && j + 16 <= out_size ; i += 16, j += 12) {
+                __m128i str = _mm_loadu_si128 ((const __m128i *)(src + i)) ;
+                __m128i hi_nibbles = _mm_and_si128 (_mm_srli_epi32 (str, 4), mask_2F) ;
+                __m128i lo_nibbles = _mm_and_si128 (str, mask_2F) ;
+                __m128i hi = _mm_shuffle_epi8 (lut_hi, hi_nibbles) ;
+                __m128i lo = _mm_shuffle_epi8 (lut_lo, lo_nibbles) ;
+                if (_mm_movemask_epi8 (_mm_cmpeq_epi8 (_mm_and_si128 (lo, hi), _mm_setzero_si128 ())) != 0xFFFF) {
+                    break ;
+                }
+                __m128i eq_2F = _mm_cmpeq_epi8 (str, mask_2F) ;
+                __m128i roll = _mm_shuffle_epi8 (lut_roll, _mm_add_epi8 (eq_2F, hi_nibbles)) ;
+                str = _mm_add_epi8 (str, roll) ;
+                // Merges 4 x 6bits into 3 bytes.
+                __m128i merged = _mm_maddubs_epi16 (str, _mm_set1_epi32 (0x01400140)) ;
+                merged = _mm_madd_epi16 (merged, _mm_set1_epi32 (0x00011000)) ;
+                merged = _mm_shuffle_epi8 (merged, _mm_setr_epi8 (2,  1,  0,  6,  5,  4, 10,  9,  8, 14, 13, 12, -1, -1, -1, -1)) ;
+                _mm_storeu_si128 ((__m128i *)(out + j), merged) ;
+            }
+            return i ;
+        }
+#endif
+
+#ifdef USE_NEON_CODEC
+        size_t  encode_hex_neon (const uint8_t *src, size_t size, char *out) {
+            const uint8x16_t    digits = vld1q_u8 (reinterpret_cast<const uint8_t *> (HEX_DIGITS)) ;
+            const uint8x16_t    mask = vdupq_n_u8 (0x0F) ;
+            size_t  i = 0 ;
+            for ( ; i + 16 <= size ; i += 16) {
+                uint8x16_t      x = vld1q_u8 (src + i) ;
+                uint8x16x2_t    r ;
+                r.val [0] = vqtbl1q_u8 (digits, vshrq_n_u8 (x, 4)) ;
+                r.val [1] = vqtbl1q_u8 (digits, vandq_u8 (x, mask)) ;
+                vst2q_u8 (reinterpret_cast<uint8_t *> (out + 2 * i), r) ;     // Interleaves.
+            }
+            return i ;
+        }
+
+        inline uint8x16_t   hex_nibbles_neon (uint8x16_t x, uint8x16_t &valid) {
+            uint8x16_t  d = vsubq_u8 (x, vdupq_n_u8 ('0')) ;
+            uint8x16_t  a = vsubq_u8 (vorrq_u8 (x, vdupq_n_u8 (0x20)), vdupq_n_u8 ('a')) ;
+            uint8x16_t  is_digit = vcltq_u8 (d, vdupq_n_u8 (10)) ;
+            uint8x16_t  is_alpha = vcltq_u8 (a, vdupq_n_u8 (6)) ;
+            valid = vandq_u8 (valid, vorrq_u8 (is_digit, is_alpha)) ;
+            return vbslq_u8 (is_digit, d, vaddq_u8 (a, vdupq_n_u8 (10))) ;
+        }
+
+        size_t  decode_hex_neon (const char *src, size_t size, uint8_t *out) {
+            size_t  i = 0 ;
+            for ( ; i + 16 <= size ; i += 16) {
+                uint8x16x2_t    x = vld2q_u8 (reinterpret_cast<const uint8_t *> (src + 2 * i)) ;  // Deinterleaves.
+                uint8x16_t      valid = vdupq_n_u8 (0xFF) ;
+                uint8x16_t      hi = hex_nibbles_neon (x.val [0], valid) ;
+                uint8x16_t      lo = hex_nibbles_neon (x.val [1], valid) ;
+                if (vminvq_u8 (valid) != 0xFF) {
+                    break ;
+                }
+                vst1q_u8 (out + i, vorrq_u8 (vshlq_n_u8 (hi, 4), lo)) ;
+            }
+            return i ;
+        }
+
+        size_t  encode_base64_neon (const uint8_t *src, size_t size, char *out) {
+            auto const *    alphabet = reinterpret_cast<const uint8_t *> (BASE64_ALPHABET) ;
+            uint8x16x4_t    table ;
+            table.val [0] = vld1q_u8 (alphabet +  0) ;
+            table.val [1] = vld1q_u8 (alphabet + 16) ;
+            table.val [2] = vld1q_u8 (alphabet + 32) ;
+            table.val [3] = vld1q_u8 (alphabet + 48) ;
+            size_t  i = 0 ;
+            size_t  j = 0 ;
+            for ( ; i + 48 <= size ; i += 48, j += 64) {
+                uint8x16x3_t    in = vld3q_u8 (src + i) ;
+                uint8x16x4_t    r ;
+                r.val [0] = vshrq_n_u8 (in.val [0], 2) ;
+                r.val [1] = vorrq_u8 (vandq_u8 (vshlq_n_u8 (in.val [0], 4), vdupq_n_u8 (0x30)), vshrq_n_u8 (in.val [1], 4)) ;
+                r.val [2] = vorrq_u8 (vandq_u8 (vshlq_n_u8 (in.val [1], 2), vdupq_n_u8 (0x3C)), vshrq_n_u8 (in.val [2], 6)) ;
+                r.val [3] = vandq_u8 (in.val [2], vdupq_n_u8 (0x3F)) ;
+                for (int k = 0 ; k < 4 ; ++k) {
+                    r.val [k] = vqtbl4q_u8 (table, r.val [k]) ;
+                }
+                vst4q_u8 (reinterpret_cast<uint8_t *> (out + j), r) ;
+            }
+            return i ;
+        }
+
+        size_t  decode_base64_neon (const char *, size_t, uint8_t *, size_t) {
+            return 0 ;
+        }
+#endif
+
+        // The scalar code does everything.
+        size_t  encode_hex_generic (const uint8_t *, size_t, char *) {
+            return 0 ;
+        }
+
+        size_t  decode_hex_generic (const char *, size_t, uint8_t *) {
+            return 0 ;
+        }
+
+        size_t  encode_base64_generic (const uint8_t *, size_t, char *) {
+            return 0 ;
+        }
+
+        size_t  decode_base64_generic (const char *, size_t, uint8_t *, size_t) {
+            return 0 ;
+        }
+
+        bool    always () {
+            return true ;
+        }
+
+#ifdef TARGET_HAVE_AVX2
+        bool    has_avx2 () {
+            return __builtin_cpu_supports ("avx2") ;
+        }
+#endif
+
+#ifdef TARGET_HAVE_SSSE3
+        bool    has_ssse3 () {
+            return __builtin_cpu_supports ("ssse3") ;
+        }
+#endif
+
+        struct Codec {
+            const char *    name ;
+            size_t  (*encode_hex) (const uint8_t *src, size_t size, char *out) ;
+            size_t  (*decode_hex) (const char *src, size_t size, uint8_t *out) ;
+            size_t  (*encode_base64) (const uint8_t *src, size_t size, char *out) ;
+            size_t  (*decode_base64) (const char *src, size_t size, uint8_t *out, size_t out_size) ;
+            bool    (*is_supported) () ;        // Runs on this CPU.
+        } ;
+
+        /** In the order of preference, the first supported one is the default.  */
+        const Codec     codecs [] = {
+#ifdef TARGET_HAVE_AVX2
+            { "avx2",    encode_hex_avx2,    decode_hex_avx2,    encode_base64_avx2,    decode_base64_avx2,    has_avx2 },
+#endif
+#ifdef TARGET_HAVE_SSSE3
+            { "ssse3",   encode_hex_ssse3,   decode_hex_ssse3,   encode_base64_ssse3,   decode_base64_ssse3,   has_ssse3 },
+#endif
+#ifdef USE_NEON_CODEC
+            { "neon",    encode_hex_neon,    decode_hex_neon,    encode_base64_neon,    decode_base64_neon,    always },
+#endif
+            { "generic", encode_hex_generic, decode_hex_generic, encode_base64_generic, decode_base64_generic, always },
+        } ;
+
+        std::atomic<const Codec *>  active_codec { nullptr } ;
+
+        /** The active kernel, the default one is chosen on the first use (unless selected before).  */
+        const Codec &   codec () {
+            const Codec *   result = active_codec.load (std::memory_order_relaxed) ;
+            if (result != nullptr) {
+                return *result ;
+            }
+            const Codec *   preferred = codecs ;
+            while (! preferred->is_supported ()) {
+                ++preferred ;       // The generic kernel is always supported.
+            }
+            if (! active_codec.compare_exchange_strong (result, preferred, std::memory_order_relaxed)) {
+                return *result ;    // Selected meanwhile.
+            }
+            return *preferred ;
+        }
+
+        Digest  to_digest (const uint8_t *bytes) {
+            hash_t  h ;
+            for (size_t i = 0 ; i < h.size () ; ++i) {
+                uint64_t    v = 0 ;
+                for (size_t k = 8 ; 0 < k ; --k) {
+                    v = (v << 8) | bytes [8 * i + k - 1] ;
+                }
+                h [i] = v ;
+            }
+            return Digest { h } ;
+        }
+    }
+
+    size_t  EncodeHex (const void *data, size_t size, char *output) {
+        auto const *    src = static_cast<const uint8_t *> (data) ;
+        for (size_t i = codec ().encode_hex (src, size, output) ; i < size ; ++i) {
+            output [2 * i + 0] = HEX_DIGITS [src [i] >> 4] ;
+            output [2 * i + 1] = HEX_DIGITS [src [i] & 0xF] ;
+        }
+        return HexLength (size) ;
+    }
+
+    bool    DecodeHex (const char *input, size_t length, void *output) {
+        if (length % 2 != 0) {
+            return false ;
+        }
+        auto *          out = static_cast<uint8_t *> (output) ;
+        const size_t    size = length / 2 ;
+        for (size_t i = codec ().decode_hex (input, size, out) ; i < size ; ++i) {
+            uint8_t hi = hex_value (input [2 * i + 0]) ;
+            uint8_t lo = hex_value (input [2 * i + 1]) ;
+            if (hi == INVALID || lo == INVALID) {
+                return false ;
+            }
+            out [i] = static_cast<uint8_t> ((hi << 4) | lo) ;
+        }
+        return true ;
+    }
+
+    size_t  EncodeBase64 (const void *data, size_t size, char *output) {
+        auto const *    src = static_cast<const uint8_t *> (data) ;
+        size_t  i = codec ().encode_base64 (src, size, output) ;
+        char *  out = output + 4 * (i / 3) ;
+        for ( ; i + 3 <= size ; i += 3) {
+            uint32_t    v = (uint32_t { src [i] } << 16) | (uint32_t { src [i + 1] } << 8) | src [i + 2] ;
+            *out++ = BASE64_ALPHABET [(v >> 18) & 0x3F] ;
+            *out++ = BASE64_ALPHABET [(v >> 12) & 0x3F] ;
+            *out++ = BASE64_ALPHABET [(v >>  6) & 0x3F] ;
+            *out++ = BASE64_ALPHABET [(v >>  0) & 0x3F] ;
+        }
+        if (i < size) {
+            uint32_t    v = uint32_t { src [i] } << 16 ;
+            if (i + 1 < size) {
+                v |= uint32_t { src [i + 1] } << 8 ;
+            }
+            *out++ = BASE64_ALPHABET [(v >> 18) & 0x3F] ;
+            *out++ = BASE64_ALPHABET [(v >> 12) & 0x3F] ;
+            *out++ = (i + 1 < size) ? BASE64_ALPHABET [(v >> 6) & 0x3F] : '=' ;
+            *out++ = '=' ;
+        }
+        return Base64Length (size) ;
+    }
+
+    bool    DecodeBase64 (const char *input, size_t length, void *output, size_t *output_length) {
+        if (length % 4 != 0) {
+            return false ;
+        }
+        size_t  padding = 0 ;
+        if (0 < length && input [length - 1] == '=') {
+            padding = (input [length - 2] == '=') ? 2 : 1 ;
+        }
+        auto *          out = static_cast<uint8_t *> (output) ;
+        const size_t    out_size = length / 4 * 3 - padding ;
+        const size_t    body = (0 < padding) ? length - 4 : length ;     // Characters without padded quad.
+        const uint8_t * T = base64_table () ;
+
+        size_t  i = codec ().decode_base64 (input, body, out, out_size) ;
+        size_t  j = i / 4 * 3 ;
+        for ( ; i < body ; i += 4, j += 3) {
+            uint8_t a = T [static_cast<uint8_t> (input [i + 0])] ;
+            uint8_t b = T [static_cast<uint8_t> (input [i + 1])] ;
+            uint8_t c = T [static_cast<uint8_t> (input [i + 2])] ;
+            uint8_t d = T [static_cast<uint8_t> (input [i + 3])] ;
+            if (((a | b | c | d) & 0xC0) != 0) {
+                return false ;
+            }
+            uint32_t    v = (uint32_t { a } << 18) | (uint32_t { b } << 12) | (uint32_t { c } << 6) | d ;
+            out [j + 0] = static_cast<uint8_t> (v >> 16) ;
+            out [j + 1] = static_cast<uint8_t> (v >>  8) ;
+            out [j + 2] = static_cast<uint8_t> (v >>  0) ;
+        }
+        if (0 < padding) {
+            uint8_t a = T [static_cast<uint8_t> (input [i + 0])] ;
+            uint8_t b = T [static_cast<uint8_t> (input [i + 1])] ;
+            uint8_t c = (padding == 1) ? T [static_cast<uint8_t> (input [i + 2])] : 0 ;
+            if (((a | b | c) & 0xC0) != 0) {
+                return false ;
+            }
+            uint32_t    v = (uint32_t { a } << 18) | (uint32_t { b } << 12) | (uint32_t { c } << 6) ;
+            out [j + 0] = static_cast<uint8_t> (v >> 16) ;
+            if (padding == 1) {
+                out [j + 1] = static_cast<uint8_t> (v >> 8) ;
+            }
+        }
+        if (output_length != nullptr) {
+            *output_length = out_size ;
+        }
+        return true ;
+    }
+
+    std::vector<std::string>    CodecKernel::GetNames () {
+        std::vector<std::string>    result ;
+        for (auto const &C : codecs) {
+            result.emplace_back (C.name) ;
+        }
+        return result ;
+    }
+
+    std::string     CodecKernel::GetActiveName () {
+        return codec ().name ;
+    }
+
+    bool    CodecKernel::Select (const std::string &name) {
+        for (auto const &C : codecs) {
+            if (name == C.name) {
+                if (! C.is_supported ()) {
+                    return false ;
+                }
+                active_codec.store (&C, std::memory_order_relaxed) ;
+                return true ;
+            }
+        }
+        return false ;
+    }
+
+    bool    DecodeHex (const char *input, size_t length, Digest &digest) {
+        uint8_t bytes [Digest::SIZE] = { 0 } ;
+        if (HexLength (Digest::SIZE) < length || ! DecodeHex (input, length, bytes)) {
+            return false ;
+        }
+        digest = to_digest (bytes) ;
+        return true ;
+    }
+
+    bool    DecodeBase64 (const char *input, size_t length, Digest &digest) {
+        uint8_t bytes [Base64Length (Digest::SIZE) / 4 * 3] = { 0 } ;
+        size_t  size ;
+        if (Base64Length (Digest::SIZE) < length || ! DecodeBase64 (input, length, bytes, &size) || Digest::SIZE < size) {
+            return false ;
+        }
+        digest = to_digest (bytes) ;
+        return true ;
+    }
+
+    void    EncodeHex (const Digest *digests, size_t count, char *output, size_t stride, size_t length) {
+        for (size_t i = 0 ; i < count ; ++i) {
+            EncodeHex (digests [i], output + i * stride, length) ;
+        }
+    }
+
+    bool    DecodeHex (const char *input, size_t stride, size_t length, size_t count, Digest *digests) {
+        bool    result = true ;
+        for (size_t i = 0 ; i < count ; ++i) {
+            result = DecodeHex (input + i * stride, length, digests [i]) && result ;
+        }
+        return result ;
+    }
+
+    void    EncodeBase64 (const Digest *digests, size_t count, char *output, size_t stride, size_t length) {
+        for (size_t i = 0 ; i < count ; ++i) {
+            EncodeBase64 (digests [i], output + i * stride, length) ;
+        }
+    }
+
+    bool    DecodeBase64 (const char *input, size_t stride, size_t length, size_t count, Digest *digests) {
+        bool    result = true ;
+        for (size_t i = 0 ; i < count ; ++i) {
+            result = DecodeBase64 (input + i * stride, length, digests [i]) && result ;
+        }
+        return result ;
+    }
+}       /* end of [namespace BLAKE2] */
+/*
+ * [END OF FILE]
+ */
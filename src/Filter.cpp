@@ -0,0 +1,554 @@
+/*
+ * Filter.cpp: Approximate membership filters driven by a single digest per key.
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include "BLAKE2/Filter.hpp"
+#include "MultiBuffer.h"
+
+#ifdef HAVE_CONFIG_H
+#   include "config.h"
+#endif
+
+#if defined (__GNUC__)
+#   define PREFETCH(P_)     __builtin_prefetch ((P_))
+#   define PREFETCH_W(P_)   __builtin_prefetch ((P_), 1)
+#else
+#   define PREFETCH(P_)     do { /* NO-OP */ } while (0)
+#   define PREFETCH_W(P_)   do { /* NO-OP */ } while (0)
+#endif
+
+namespace BLAKE2 {
+
+    namespace {
+        const size_t    MAX_KEY_LENGTH = 64 ;
+        const size_t    BATCH_SIZE = 64 ;               // # of keys hashed before probing.
+        const size_t    BLOCK_WORDS = 8 ;               // # of 64bits words in a blocked Bloom filter block.
+        const size_t    FIELDS_PER_WORD = 7 ;           // # of 9bits fields taken from a word.
+        const uint64_t  FINGERPRINT_MULTIPLIER = 0x5BD1E995u ;
+
+        /** Maps X (uniform in 64bits) to [0, N) without a division.  */
+        inline uint64_t reduce (uint64_t x, uint64_t n) {
+#if defined (__SIZEOF_INT128__)
+            return static_cast<uint64_t> ((static_cast<unsigned __int128> (x) * n) >> 64) ;
+#else
+            const uint64_t  x_lo = x & 0xFFFFFFFFu ;
+            const uint64_t  x_hi = x >> 32 ;
+            const uint64_t  n_lo = n & 0xFFFFFFFFu ;
+            const uint64_t  n_hi = n >> 32 ;
+            const uint64_t  lo_lo = x_lo * n_lo ;
+            const uint64_t  hi_lo = x_hi * n_lo ;
+            const uint64_t  lo_hi = x_lo * n_hi ;
+            const uint64_t  mid = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFFu) + (lo_hi & 0xFFFFFFFFu) ;
+            return x_hi * n_hi + (hi_lo >> 32) + (lo_hi >> 32) + (mid >> 32) ;
+#endif
+        }
+
+        inline uint64_t xorshift (uint64_t &state) {
+            state ^= state << 13 ;
+            state ^= state >> 7 ;
+            state ^= state << 17 ;
+            return state ;
+        }
+
+        inline uint16_t fingerprint_of (const hash_t &h) {
+            auto fp = static_cast<uint16_t> (h [1]) ;
+            return (fp == 0) ? 1 : fp ;         // 0 marks an empty slot.
+        }
+
+        /**
+         * Hashes the keys BATCH_SIZE at a time and hands each batch to FN (base, n, hashes).
+         */
+        template <typename Fn_>
+            void    for_each_batch ( const FilterHash &H
+                                   , size_t count, const void * const *data, const size_t *size
+                                   , Fn_ fn) {
+                hash_t  hashes [BATCH_SIZE] ;
+                for (size_t base = 0 ; base < count ; base += BATCH_SIZE) {
+                    const size_t    n = std::min (BATCH_SIZE, count - base) ;
+                    H.Apply (n, data + base, size + base, hashes) ;
+                    fn (base, n, hashes) ;
+                }
+            }
+    }
+
+    FilterHash::FilterHash (const void *key, size_t key_length)
+            : FilterHash { Parameter ().GetParameterBlock (), key, key_length } {
+        /* NO-OP */
+    }
+
+    FilterHash::FilterHash (const parameter_block_t &param, const void *key, size_t key_length) {
+        Parameter   P { param } ;
+        P.SetDigestLength (static_cast<uint8_t> (sizeof (hash_t))) ;
+
+        has_key_ = key != nullptr && 0 < key_length ;
+        uint8_t     block [BLOCK_SIZE] = { 0 } ;
+        if (! has_key_) {
+            P.SetKeyLength (0) ;
+            InitializeChain (keyed_, P.GetParameterBlock ()) ;
+            empty_ = keyed_ ;
+            Compress (empty_, block, 0, 0, ~0uLL, 0) ;
+            return ;
+        }
+        auto k_len = std::min (key_length, MAX_KEY_LENGTH) ;
+        P.SetKeyLength (static_cast<uint8_t> (k_len)) ;
+        InitializeChain (keyed_, P.GetParameterBlock ()) ;
+
+        memcpy (block, key, k_len) ;
+        empty_ = keyed_ ;
+        // The key block is the last one for the empty message.
+        Compress (empty_, block, BLOCK_SIZE, 0, ~0uLL, 0) ;
+        Compress (keyed_, block, BLOCK_SIZE, 0, 0, 0) ;
+        memset (block, 0, sizeof (block)) ;
+    }
+
+    void    FilterHash::Apply (const void *data, size_t size, hash_t &result) const {
+        if (size == 0) {
+            result = empty_ ;
+            return ;
+        }
+        auto const *    p = static_cast<const uint8_t *> (data) ;
+        result = keyed_ ;
+        uint64_t    t0 = has_key_ ? BLOCK_SIZE : 0 ;
+        uint64_t    t1 = 0 ;
+
+        while (BLOCK_SIZE < size) {
+            t0 += BLOCK_SIZE ;
+            t1 += (t0 < BLOCK_SIZE) ? 1 : 0 ;
+            Compress (result, p, t0, t1, 0, 0) ;
+            p += BLOCK_SIZE ;
+            size -= BLOCK_SIZE ;
+        }
+        t0 += size ;
+        t1 += (t0 < size) ? 1 : 0 ;
+        if (size == BLOCK_SIZE) {
+            Compress (result, p, t0, t1, ~0uLL, 0) ;
+        }
+        else {
+            uint8_t     block [BLOCK_SIZE] = { 0 } ;
+            memcpy (block, p, size) ;
+            Compress (result, block, t0, t1, ~0uLL, 0) ;
+        }
+    }
+
+    void    FilterHash::Apply (size_t count, const void * const *data, const size_t *size, hash_t *result) const {
+        if (! multibuffer_is_vectorized ()) {
+            for (size_t i = 0 ; i < count ; ++i) {
+                Apply (data [i], size [i], result [i]) ;
+            }
+            return ;
+        }
+        const uint64_t  base = has_key_ ? BLOCK_SIZE : 0 ;
+        uint8_t         message [MULTIBUFFER_LANES][BLOCK_SIZE] ;
+        hash_t          scratch ;
+        size_t          i = 0 ;
+        while (i < count) {
+            // Gathers single block keys into the lanes, the others are hashed on the spot.
+            size_t  lane [MULTIBUFFER_LANES] ;
+            size_t  n = 0 ;
+            for ( ; n < MULTIBUFFER_LANES && i < count ; ++i) {
+                if (size [i] == 0 || BLOCK_SIZE < size [i]) {
+                    Apply (data [i], size [i], result [i]) ;
+                }
+                else {
+                    lane [n++] = i ;
+                }
+            }
+            if (n == 0) {
+                continue ;
+            }
+            if (n == 1) {
+                Apply (data [lane [0]], size [lane [0]], result [lane [0]]) ;
+                continue ;
+            }
+            hash_t *        chain [MULTIBUFFER_LANES] ;
+            const void *    msg [MULTIBUFFER_LANES] ;
+            uint64_t        t0 [MULTIBUFFER_LANES] ;
+            const uint64_t  zero [MULTIBUFFER_LANES] = { 0, 0, 0, 0 } ;
+            const uint64_t  f0 [MULTIBUFFER_LANES] = { ~0uLL, ~0uLL, ~0uLL, ~0uLL } ;
+            for (size_t k = 0 ; k < MULTIBUFFER_LANES ; ++k) {
+                if (k < n) {
+                    const size_t    idx = lane [k] ;
+                    const size_t    len = size [idx] ;
+                    memcpy (message [k], data [idx], len) ;
+                    memset (message [k] + len, 0, BLOCK_SIZE - len) ;
+                    result [idx] = keyed_ ;
+                    chain [k] = &result [idx] ;
+                    msg [k] = message [k] ;
+                    t0 [k] = base + len ;
+                }
+                else {
+                    // Unused lanes recompute lane 0 into the scratch.
+                    scratch = keyed_ ;
+                    chain [k] = &scratch ;
+                    msg [k] = message [0] ;
+                    t0 [k] = t0 [0] ;
+                }
+            }
+            CompressLanes (chain, msg, t0, zero, f0, zero) ;
+        }
+    }
+
+    const uint32_t  BloomFilter::MAX_HASHES ;
+
+    BloomFilter::BloomFilter (uint64_t bits, uint32_t hashes, const void *key, size_t key_length)
+            : BloomFilter { bits, hashes, Parameter ().GetParameterBlock (), key, key_length } {
+        /* NO-OP */
+    }
+
+    BloomFilter::BloomFilter (uint64_t bits, uint32_t hashes, const parameter_block_t &param, const void *key, size_t key_length)
+            : hash_ { param, key, key_length }
+            , bits_ { bits }
+            , hashes_ { hashes } {
+        if (bits == 0) {
+            throw std::invalid_argument { "BloomFilter: # of bits should be positive" } ;
+        }
+        if (hashes == 0 || MAX_HASHES < hashes) {
+            throw std::invalid_argument { "BloomFilter: # of hashes is out of range" } ;
+        }
+        words_.resize (static_cast<size_t> ((bits + 63) / 64)) ;
+    }
+
+    void    BloomFilter::Clear () {
+        std::fill (words_.begin (), words_.end (), 0) ;
+    }
+
+    void    BloomFilter::InsertHash (const hash_t &h) {
+        for (uint32_t i = 0 ; i < hashes_ ; ++i) {
+            const uint64_t  pos = reduce (h [i], bits_) ;
+            words_ [pos / 64] |= 1uLL << (pos % 64) ;
+        }
+    }
+
+    bool    BloomFilter::ContainsHash (const hash_t &h) const {
+        for (uint32_t i = 0 ; i < hashes_ ; ++i) {
+            const uint64_t  pos = reduce (h [i], bits_) ;
+            if ((words_ [pos / 64] & (1uLL << (pos % 64))) == 0) {
+                return false ;
+            }
+        }
+        return true ;
+    }
+
+    void    BloomFilter::PrefetchHash (const hash_t &h) const {
+        for (uint32_t i = 0 ; i < hashes_ ; ++i) {
+            PREFETCH (&words_ [reduce (h [i], bits_) / 64]) ;
+        }
+    }
+
+    void    BloomFilter::Insert (const void *data, size_t size) {
+        hash_t  h ;
+        hash_.Apply (data, size, h) ;
+        InsertHash (h) ;
+    }
+
+    void    BloomFilter::Insert (size_t count, const void * const *data, const size_t *size) {
+        for_each_batch (hash_, count, data, size, [this](size_t, size_t n, const hash_t *hashes) {
+            for (size_t i = 0 ; i < n ; ++i) {
+                PrefetchHash (hashes [i]) ;
+            }
+            for (size_t i = 0 ; i < n ; ++i) {
+                InsertHash (hashes [i]) ;
+            }
+        }) ;
+    }
+
+    bool    BloomFilter::Contains (const void *data, size_t size) const {
+        hash_t  h ;
+        hash_.Apply (data, size, h) ;
+        return ContainsHash (h) ;
+    }
+
+    void    BloomFilter::Contains (size_t count, const void * const *data, const size_t *size, bool *result) const {
+        for_each_batch (hash_, count, data, size, [this, result](size_t base, size_t n, const hash_t *hashes) {
+            for (size_t i = 0 ; i < n ; ++i) {
+                PrefetchHash (hashes [i]) ;
+            }
+            for (size_t i = 0 ; i < n ; ++i) {
+                result [base + i] = ContainsHash (hashes [i]) ;
+            }
+        }) ;
+    }
+
+    const uint32_t  BlockedBloomFilter::MAX_HASHES ;
+    const size_t    BlockedBloomFilter::BLOCK_BITS ;
+
+    BlockedBloomFilter::BlockedBloomFilter (uint64_t bits, uint32_t hashes, const void *key, size_t key_length)
+            : BlockedBloomFilter { bits, hashes, Parameter ().GetParameterBlock (), key, key_length } {
+        /* NO-OP */
+    }
+
+    BlockedBloomFilter::BlockedBloomFilter (uint64_t bits, uint32_t hashes, const parameter_block_t &param, const void *key, size_t key_length)
+            : hash_ { param, key, key_length }
+            , base_ { 0 }
+            , blocks_ { (bits + BLOCK_BITS - 1) / BLOCK_BITS }
+            , hashes_ { hashes } {
+        if (bits == 0) {
+            throw std::invalid_argument { "BlockedBloomFilter: # of bits should be positive" } ;
+        }
+        if (hashes == 0 || MAX_HASHES < hashes) {
+            throw std::invalid_argument { "BlockedBloomFilter: # of hashes is out of range" } ;
+        }
+        // Extra words let the blocks start at a 64 bytes boundary.
+        storage_.resize (static_cast<size_t> (BLOCK_WORDS * blocks_ + BLOCK_WORDS - 1)) ;
+        const auto  addr = reinterpret_cast<uintptr_t> (storage_.data ()) ;
+        base_ = static_cast<size_t> (((64 - (addr % 64)) % 64) / sizeof (uint64_t)) ;
+    }
+
+    void    BlockedBloomFilter::Clear () {
+        std::fill (storage_.begin (), storage_.end (), 0) ;
+    }
+
+    uint64_t *  BlockedBloomFilter::BlockOf (const hash_t &h) {
+        return &storage_ [base_ + BLOCK_WORDS * static_cast<size_t> (reduce (h [0], blocks_))] ;
+    }
+
+    const uint64_t *    BlockedBloomFilter::BlockOf (const hash_t &h) const {
+        return &storage_ [base_ + BLOCK_WORDS * static_cast<size_t> (reduce (h [0], blocks_))] ;
+    }
+
+    namespace {
+        /** Bit position of the probe I in a block.  */
+        inline uint32_t block_probe (const hash_t &h, uint32_t i) {
+            return static_cast<uint32_t> (h [1 + i / FIELDS_PER_WORD] >> (9 * (i % FIELDS_PER_WORD))) & 0x1FFu ;
+        }
+    }
+
+    void    BlockedBloomFilter::InsertHash (const hash_t &h) {
+        uint64_t *  block = BlockOf (h) ;
+        for (uint32_t i = 0 ; i < hashes_ ; ++i) {
+            const uint32_t  pos = block_probe (h, i) ;
+            block [pos / 64] |= 1uLL << (pos % 64) ;
+        }
+    }
+
+    bool    BlockedBloomFilter::ContainsHash (const hash_t &h) const {
+        const uint64_t *    block = BlockOf (h) ;
+        uint64_t    mask [BLOCK_WORDS] = { 0 } ;
+        for (uint32_t i = 0 ; i < hashes_ ; ++i) {
+            const uint32_t  pos = block_probe (h, i) ;
+            mask [pos / 64] |= 1uLL << (pos % 64) ;
+        }
+        // Branch free over the block, compilers turn this into a few vector ops.
+        uint64_t    miss = 0 ;
+        for (size_t i = 0 ; i < BLOCK_WORDS ; ++i) {
+            miss |= mask [i] & ~block [i] ;
+        }
+        return miss == 0 ;
+    }
+
+    void    BlockedBloomFilter::PrefetchHash (const hash_t &h) const {
+        PREFETCH (BlockOf (h)) ;
+    }
+
+    void    BlockedBloomFilter::Insert (const void *data, size_t size) {
+        hash_t  h ;
+        hash_.Apply (data, size, h) ;
+        InsertHash (h) ;
+    }
+
+    void    BlockedBloomFilter::Insert (size_t count, const void * const *data, const size_t *size) {
+        for_each_batch (hash_, count, data, size, [this](size_t, size_t n, const hash_t *hashes) {
+            for (size_t i = 0 ; i < n ; ++i) {
+                PREFETCH_W (BlockOf (hashes [i])) ;
+            }
+            for (size_t i = 0 ; i < n ; ++i) {
+                InsertHash (hashes [i]) ;
+            }
+        }) ;
+    }
+
+    bool    BlockedBloomFilter::Contains (const void *data, size_t size) const {
+        hash_t  h ;
+        hash_.Apply (data, size, h) ;
+        return ContainsHash (h) ;
+    }
+
+    void    BlockedBloomFilter::Contains (size_t count, const void * const *data, const size_t *size, bool *result) const {
+        for_each_batch (hash_, count, data, size, [this, result](size_t base, size_t n, const hash_t *hashes) {
+            for (size_t i = 0 ; i < n ; ++i) {
+                PrefetchHash (hashes [i]) ;
+            }
+            for (size_t i = 0 ; i < n ; ++i) {
+                result [base + i] = ContainsHash (hashes [i]) ;
+            }
+        }) ;
+    }
+
+    const size_t    CuckooFilter::SLOTS_PER_BUCKET ;
+    const size_t    CuckooFilter::MAX_KICKS ;
+
+    CuckooFilter::CuckooFilter (uint64_t capacity, const void *key, size_t key_length)
+            : CuckooFilter { capacity, Parameter ().GetParameterBlock (), key, key_length } {
+        /* NO-OP */
+    }
+
+    CuckooFilter::CuckooFilter (uint64_t capacity, const parameter_block_t &param, const void *key, size_t key_length)
+            : hash_ { param, key, key_length }
+            , count_ { 0 }
+            , victim_index_ { 0 }
+            , victim_ { 0 } {
+        if (capacity == 0) {
+            throw std::invalid_argument { "CuckooFilter: capacity should be positive" } ;
+        }
+        const uint64_t  wanted = (capacity * 100 / 95 + SLOTS_PER_BUCKET - 1) / SLOTS_PER_BUCKET ;
+        uint64_t    buckets = 1 ;
+        while (buckets < wanted) {
+            buckets <<= 1 ;
+        }
+        mask_ = buckets - 1 ;
+        slots_.resize (static_cast<size_t> (SLOTS_PER_BUCKET * buckets)) ;
+    }
+
+    void    CuckooFilter::Clear () {
+        std::fill (slots_.begin (), slots_.end (), 0) ;
+        count_ = 0 ;
+        victim_ = 0 ;
+    }
+
+    uint64_t    CuckooFilter::Alternate (uint64_t index, uint16_t fp) const {
+        return (index ^ (fp * FINGERPRINT_MULTIPLIER)) & mask_ ;
+    }
+
+    bool    CuckooFilter::InsertFingerprint (uint64_t index, uint16_t fp) {
+        uint16_t *  bucket = &slots_ [static_cast<size_t> (SLOTS_PER_BUCKET * index)] ;
+        for (size_t i = 0 ; i < SLOTS_PER_BUCKET ; ++i) {
+            if (bucket [i] == 0) {
+                bucket [i] = fp ;
+                return true ;
+            }
+        }
+        return false ;
+    }
+
+    void    CuckooFilter::Relocate (uint64_t index, uint16_t fp, uint64_t seed) {
+        uint64_t    state = seed | 1 ;
+        for (size_t n = 0 ; n < MAX_KICKS ; ++n) {
+            const size_t    slot = static_cast<size_t> (xorshift (state) % SLOTS_PER_BUCKET) ;
+            std::swap (fp, slots_ [static_cast<size_t> (SLOTS_PER_BUCKET * index) + slot]) ;
+            index = Alternate (index, fp) ;
+            if (InsertFingerprint (index, fp)) {
+                return ;
+            }
+        }
+        victim_ = fp ;
+        victim_index_ = index ;
+    }
+
+    bool    CuckooFilter::InsertHash (const hash_t &h) {
+        if (victim_ != 0) {
+            return false ;
+        }
+        const uint16_t  fp = fingerprint_of (h) ;
+        const uint64_t  i1 = h [0] & mask_ ;
+        const uint64_t  i2 = Alternate (i1, fp) ;
+        ++count_ ;
+        if (InsertFingerprint (i1, fp) || InsertFingerprint (i2, fp)) {
+            return true ;
+        }
+        // The key is in (possibly as the victim), later insertions fail.
+        Relocate ((h [2] & 1) ? i1 : i2, fp, h [3]) ;
+        return true ;
+    }
+
+    bool    CuckooFilter::ContainsHash (const hash_t &h) const {
+        const uint16_t  fp = fingerprint_of (h) ;
+        const uint64_t  i1 = h [0] & mask_ ;
+        const uint64_t  i2 = Alternate (i1, fp) ;
+        const uint16_t *    b1 = &slots_ [static_cast<size_t> (SLOTS_PER_BUCKET * i1)] ;
+        const uint16_t *    b2 = &slots_ [static_cast<size_t> (SLOTS_PER_BUCKET * i2)] ;
+        bool    found = false ;
+        for (size_t i = 0 ; i < SLOTS_PER_BUCKET ; ++i) {
+            found |= (b1 [i] == fp) | (b2 [i] == fp) ;
+        }
+        return found || (victim_ == fp && (victim_index_ == i1 || victim_index_ == i2)) ;
+    }
+
+    void    CuckooFilter::PrefetchHash (const hash_t &h) const {
+        const uint16_t  fp = fingerprint_of (h) ;
+        const uint64_t  i1 = h [0] & mask_ ;
+        PREFETCH (&slots_ [static_cast<size_t> (SLOTS_PER_BUCKET * i1)]) ;
+        PREFETCH (&slots_ [static_cast<size_t> (SLOTS_PER_BUCKET * Alternate (i1, fp))]) ;
+    }
+
+    bool    CuckooFilter::Insert (const void *data, size_t size) {
+        hash_t  h ;
+        hash_.Apply (data, size, h) ;
+        return InsertHash (h) ;
+    }
+
+    size_t  CuckooFilter::Insert (size_t count, const void * const *data, const size_t *size) {
+        size_t  inserted = 0 ;
+        for (size_t base = 0 ; base < count && victim_ == 0 ; base += BATCH_SIZE) {
+            const size_t    n = std::min (BATCH_SIZE, count - base) ;
+            hash_t  hashes [BATCH_SIZE] ;
+            hash_.Apply (n, data + base, size + base, hashes) ;
+            for (size_t i = 0 ; i < n ; ++i) {
+                PrefetchHash (hashes [i]) ;
+            }
+            for (size_t i = 0 ; i < n ; ++i) {
+                if (! InsertHash (hashes [i])) {
+                    return inserted ;
+                }
+                ++inserted ;
+            }
+        }
+        return inserted ;
+    }
+
+    bool    CuckooFilter::Contains (const void *data, size_t size) const {
+        hash_t  h ;
+        hash_.Apply (data, size, h) ;
+        return ContainsHash (h) ;
+    }
+
+    void    CuckooFilter::Contains (size_t count, const void * const *data, const size_t *size, bool *result) const {
+        for_each_batch (hash_, count, data, size, [this, result](size_t base, size_t n, const hash_t *hashes) {
+            for (size_t i = 0 ; i < n ; ++i) {
+                PrefetchHash (hashes [i]) ;
+            }
+            for (size_t i = 0 ; i < n ; ++i) {
+                result [base + i] = ContainsHash (hashes [i]) ;
+            }
+        }) ;
+    }
+
+    bool    CuckooFilter::Remove (const void *data, size_t size) {
+        hash_t  h ;
+        hash_.Apply (data, size, h) ;
+        const uint16_t  fp = fingerprint_of (h) ;
+        const uint64_t  i1 = h [0] & mask_ ;
+        const uint64_t  i2 = Alternate (i1, fp) ;
+
+        if (victim_ == fp && (victim_index_ == i1 || victim_index_ == i2)) {
+            victim_ = 0 ;
+            --count_ ;
+            return true ;
+        }
+        for (auto index : { i1, i2 }) {
+            uint16_t *  bucket = &slots_ [static_cast<size_t> (SLOTS_PER_BUCKET * index)] ;
+            for (size_t i = 0 ; i < SLOTS_PER_BUCKET ; ++i) {
+                if (bucket [i] == fp) {
+                    bucket [i] = 0 ;
+                    --count_ ;
+                    if (victim_ != 0) {
+                        // Room is made, gives the victim another chance.
+                        const uint16_t  v = victim_ ;
+                        victim_ = 0 ;
+                        if (! InsertFingerprint (victim_index_, v)) {
+                            Relocate (victim_index_, v, h [3]) ;
+                        }
+                    }
+                    return true ;
+                }
+            }
+        }
+        return false ;
+    }
+}       /* end of [namespace BLAKE2] */
+/*
+ * [END OF FILE]
+ */
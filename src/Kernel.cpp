@@ -0,0 +1,157 @@
+/*
+ * Kernel.cpp: Self-test and selection of the `Compress` kernels.
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#include <chrono>
+#include <limits>
+#include <mutex>
+#include "BLAKE2/Kernel.hpp"
+#include "Kernel.h"
+
+#ifdef HAVE_CONFIG_H
+#   include "config.h"
+#endif
+
+namespace BLAKE2 {
+
+    namespace {
+        const size_t    NO_KERNEL = ~static_cast<size_t> (0) ;
+        const size_t    ROUND_BLOCKS = 16 ;         // # of blocks per timed round.
+
+        /** Compress (IV, all 0 block, 0, 0, 0, 0) and Compress (IV, 0, 1, ..., 127, 0, 0, 0, 0).  */
+        const uint64_t  KNOWN_ANSWERS [2][8] = {
+            { 0xf1328a1c44f7815eULL, 0xe74854a9ee8dec9cULL, 0x45680670cfd760afULL, 0x72b4b75c361f952eULL
+            , 0xbf991808bb1a78d5ULL, 0x4c5e16e9e8953d52ULL, 0xdcd05c126f1b89f8ULL, 0x641fbc18b236fef4ULL }
+          , { 0x2a097e2ae10e82f0ULL, 0xab2851c5c554f980ULL, 0x8dbdc34bf0ce0684ULL, 0x13a21e79fc146b71ULL
+            , 0xe7acaa395c23cd9fULL, 0x33d34266df5d3f1dULL, 0x7b79d5db78ca092dULL, 0xd60484e4b41d6ab6ULL }
+        } ;
+
+        size_t  find_kernel (const std::string &name) {
+            for (size_t i = 0 ; i < compress_kernel_count () ; ++i) {
+                if (name == compress_kernel (i).name) {
+                    return i ;
+                }
+            }
+            return NO_KERNEL ;
+        }
+
+        bool    self_test (size_t idx) {
+            const CompressKernel &  K = compress_kernel (idx) ;
+            if (! K.is_supported ()) {
+                return false ;
+            }
+            uint8_t block [BLOCK_SIZE] ;
+            for (size_t v = 0 ; v < 2 ; ++v) {
+                for (size_t i = 0 ; i < BLOCK_SIZE ; ++i) {
+                    block [i] = (v == 0) ? 0 : static_cast<uint8_t> (i) ;
+                }
+                hash_t  h ;
+                InitializeChain (h) ;
+                K.compress (h, block, 0, 0, 0, 0) ;
+                for (size_t i = 0 ; i < 8 ; ++i) {
+                    if (h [i] != KNOWN_ANSWERS [v][i]) {
+                        return false ;
+                    }
+                }
+            }
+            // Counters and flags, the generic kernel (index 0) is the reference.
+            for (size_t i = 0 ; i < BLOCK_SIZE ; ++i) {
+                block [i] = static_cast<uint8_t> (i * 131 + 7) ;
+            }
+            hash_t  expected ;
+            hash_t  actual ;
+            InitializeChain (expected) ;
+            InitializeChain (actual) ;
+            compress_kernel (0).compress (expected, block, 0x0123456789ABCDEFuLL, 0xFEDCBA9876543210uLL, ~0uLL, ~0uLL) ;
+            K.compress (actual, block, 0x0123456789ABCDEFuLL, 0xFEDCBA9876543210uLL, ~0uLL, ~0uLL) ;
+            return actual == expected ;
+        }
+
+        /** Best ns per block over the rounds run within BUDGET_NS.  */
+        double  time_kernel (const CompressKernel &K, uint64_t budget_ns) {
+            using clock = std::chrono::steady_clock ;
+            uint8_t block [BLOCK_SIZE] = { 0 } ;
+            hash_t  h ;
+            InitializeChain (h) ;
+            for (size_t i = 0 ; i < ROUND_BLOCKS ; ++i) {
+                K.compress (h, block, i, 0, 0, 0) ;      // Warms up.
+            }
+            double          best = std::numeric_limits<double>::max () ;
+            const auto      start = clock::now () ;
+            const auto      budget = std::chrono::nanoseconds { budget_ns } ;
+            uint64_t        t0 = 0 ;
+            do {
+                const auto  t = clock::now () ;
+                for (size_t i = 0 ; i < ROUND_BLOCKS ; ++i) {
+                    K.compress (h, block, ++t0, 0, 0, 0) ;
+                }
+                const auto  elapsed = std::chrono::duration_cast<std::chrono::nanoseconds> (clock::now () - t) ;
+                const double    ns = static_cast<double> (elapsed.count ()) / ROUND_BLOCKS ;
+                if (ns < best) {
+                    best = ns ;
+                }
+            } while (clock::now () - start < budget) ;
+            // Keeps the chain alive.
+            block [0] = static_cast<uint8_t> (h [0]) ;
+            volatile uint8_t    sink = block [0] ;
+            (void)sink ;
+            return best ;
+        }
+    }
+
+    const uint64_t  Kernel::DEFAULT_TUNING_NS ;
+
+    std::vector<std::string>    Kernel::GetNames () {
+        std::vector<std::string>    result ;
+        for (size_t i = 0 ; i < compress_kernel_count () ; ++i) {
+            result.emplace_back (compress_kernel (i).name) ;
+        }
+        return result ;
+    }
+
+    std::string     Kernel::GetActiveName () {
+        return compress_kernel (active_compress_kernel ()).name ;
+    }
+
+    bool    Kernel::SelfTest (const std::string &name) {
+        const size_t    idx = find_kernel (name) ;
+        return idx != NO_KERNEL && self_test (idx) ;
+    }
+
+    bool    Kernel::Select (const std::string &name) {
+        const size_t    idx = find_kernel (name) ;
+        if (idx == NO_KERNEL || ! self_test (idx)) {
+            return false ;
+        }
+        select_compress_kernel (idx) ;
+        return true ;
+    }
+
+    const std::vector<Kernel::Result> &     Kernel::AutoTune (uint64_t budget_ns) {
+        static std::once_flag       once ;
+        static std::vector<Result>  results ;
+        std::call_once (once, [budget_ns]() {
+            size_t  fastest = NO_KERNEL ;
+            for (size_t i = 0 ; i < compress_kernel_count () ; ++i) {
+                const CompressKernel &  K = compress_kernel (i) ;
+                Result  R { K.name, K.is_supported (), false, 0.0 } ;
+                R.passed = R.supported && self_test (i) ;
+                if (R.passed) {
+                    R.ns_per_block = time_kernel (K, budget_ns) ;
+                    if (fastest == NO_KERNEL || R.ns_per_block < results [fastest].ns_per_block) {
+                        fastest = i ;
+                    }
+                }
+                results.push_back (R) ;
+            }
+            if (fastest != NO_KERNEL) {
+                select_compress_kernel (fastest) ;
+            }
+        }) ;
+        return results ;
+    }
+}       /* end of [namespace BLAKE2] */
+/*
+ * [END OF FILE]
+ */
@@ -0,0 +1,36 @@
+/*
+ * Kernel.h: Runtime selection of the `Compress` kernels.
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#pragma once
+#ifndef kernel_h__4c9e2a7f1b3d4e6a9f8c5b0d7e2a1c63
+#define kernel_h__4c9e2a7f1b3d4e6a9f8c5b0d7e2a1c63    1
+
+#include "BLAKE2.hpp"
+
+namespace BLAKE2 {
+
+    using compress_t = void (*) (hash_t &, const void *, uint64_t, uint64_t, uint64_t, uint64_t) ;
+
+    struct CompressKernel {
+        const char *    name ;
+        compress_t      compress ;
+        bool            (*is_supported) () ;    // Runs on this CPU.
+    } ;
+
+    /** # of kernels compiled in (defined next to the kernels).  */
+    size_t  compress_kernel_count () ;
+
+    const CompressKernel &  compress_kernel (size_t idx) ;
+
+    size_t  active_compress_kernel () ;
+
+    /** Routes `Compress` to kernel IDX.  */
+    void    select_compress_kernel (size_t idx) ;
+}
+
+#endif  /* kernel_h__4c9e2a7f1b3d4e6a9f8c5b0d7e2a1c63 */
+/*
+ * [END OF FILE]
+ */
@@ -0,0 +1,499 @@
+/*
+ * MMR.cpp: Merkle mountain range (append only authenticated log).
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#include <algorithm>
+#include <cstring>
+#include "BLAKE2/MMR.hpp"
+#include "BLAKE2/Batch.hpp"
+#include "Support.h"
+#include "Tree.h"
+
+#ifdef HAVE_CONFIG_H
+#   include "config.h"
+#endif
+
+#ifndef _WIN32
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+#endif
+
+namespace BLAKE2 {
+
+    namespace {
+        const char      MAGIC [8] = { 'B', 'L', 'A', 'K', 'E', '2', 'M', 'R' } ;
+        const uint32_t  VERSION = 1 ;
+        const size_t    HEADER_SIZE = 128 ;             // Header (64 bytes) + parameter block.
+        const size_t    OFF_LEAF_COUNT = 16 ;
+        const size_t    OFF_PARAMETER = 64 ;
+        const size_t    NODE_SIZE = Digest::SIZE ;
+        const uint64_t  INITIAL_CAPACITY = 1024 ;       // # of nodes.
+        const size_t    APPEND_BATCH_SIZE = 256 ;
+
+        uint32_t    popcount64 (uint64_t x) {
+            uint32_t    result = 0 ;
+            for ( ; x != 0 ; x &= x - 1) {
+                ++result ;
+            }
+            return result ;
+        }
+
+        /** # of nodes in the range of LEAF_COUNT leaves (also the position of the leaf LEAF_COUNT).  */
+        uint64_t    node_count (uint64_t leaf_count) {
+            return 2 * leaf_count - popcount64 (leaf_count) ;
+        }
+
+        uint32_t    height_of (uint64_t position) {
+            uint64_t    p = position + 1 ;
+            // Strips the left perfect trees until P is a whole one (all bits set).
+            while ((p & (p + 1)) != 0) {
+                p -= (1uLL << (bit_length (p) - 1)) - 1 ;
+            }
+            return bit_length (p) - 1 ;
+        }
+
+        /** Positions of the peaks for LEAF_COUNT leaves, left to right.  */
+        std::vector<uint64_t>   peak_positions (uint64_t leaf_count) {
+            std::vector<uint64_t>   result ;
+            uint64_t    offset = 0 ;
+            for (int k = 63 ; 0 <= k ; --k) {
+                if ((leaf_count & (1uLL << k)) != 0) {
+                    const uint64_t  size = (2uLL << k) - 1 ;
+                    result.emplace_back (offset + size - 1) ;
+                    offset += size ;
+                }
+            }
+            return result ;
+        }
+
+        /**
+         * Climbs from the node at POSITION to its peak in the range of NODES nodes.
+         * FN (sibling, parent, parent_height, is_right) is called at every step.
+         *
+         * @return Position of the peak
+         */
+        template <typename Fn_>
+            uint64_t    climb (uint64_t position, uint64_t nodes, Fn_ fn) {
+                uint32_t    h = height_of (position) ;
+                for (;;) {
+                    const uint64_t  span = (2uLL << h) - 1 ;
+                    const bool      is_right = h < height_of (position + 1) ;
+                    const uint64_t  sibling = is_right ? position - span : position + span ;
+                    const uint64_t  parent = is_right ? position + 1 : sibling + 1 ;
+                    if (nodes <= parent) {
+                        return position ;
+                    }
+                    fn (sibling, parent, h + 1, is_right) ;
+                    position = parent ;
+                    ++h ;
+                }
+            }
+
+        /** The root bags the peaks in a single node.  */
+        Digest  hash_root (const BinaryNodeHasher &H, uint64_t leaf_count, const std::vector<Digest> &peaks) {
+            Generator   g { H.NodeParameter (MerkleMountainRange::ROOT_DEPTH, leaf_count) } ;
+            for (auto const &peak : peaks) {
+                g.Update (peak.data (), peak.size ()) ;
+            }
+            return g.SetLastNode ().Finalize () ;
+        }
+    }
+
+    /**
+     * Node storage, in memory or in a memory mapped file.
+     */
+    class MerkleMountainRange::Store {
+    private:
+        std::vector<uint8_t>    memory_ ;
+        int                     fd_ ;
+        uint8_t *               map_ ;
+        size_t                  map_size_ ;
+        uint8_t *               nodes_ ;
+        uint64_t                count_ ;
+        uint64_t                capacity_ ;
+    public:
+        Store () : fd_ { -1 }, map_ { nullptr }, map_size_ { 0 }, nodes_ { nullptr }, count_ { 0 }, capacity_ { 0 } {
+            /* NO-OP */
+        }
+
+        ~Store () {
+#ifndef _WIN32
+            if (map_ != nullptr) {
+                munmap (map_, map_size_) ;
+            }
+            if (0 <= fd_) {
+                close (fd_) ;
+            }
+#endif
+        }
+
+        Store (const Store &) = delete ;
+
+        Store &     operator = (const Store &) = delete ;
+
+        /**
+         * Maps PATH, LEAF_COUNT receives # of leaves recorded in the file.
+         */
+        static std::unique_ptr<Store>   Open (const std::string &path, const parameter_block_t &param, uint64_t &leaf_count) {
+#ifdef _WIN32
+            (void)path ;
+            (void)param ;
+            (void)leaf_count ;
+            throw std::system_error { std::make_error_code (std::errc::function_not_supported), "MerkleMountainRange::Open" } ;
+#else
+            std::unique_ptr<Store>  S { new Store {} } ;
+            S->fd_ = open (path.c_str (), O_RDWR | O_CREAT | O_CLOEXEC, 0644) ;
+            if (S->fd_ < 0) {
+                raise_errno ("MerkleMountainRange::Open: " + path) ;
+            }
+            struct stat st ;
+            if (fstat (S->fd_, &st) != 0) {
+                raise_errno ("MerkleMountainRange::Open: " + path) ;
+            }
+            if (st.st_size == 0) {
+                S->Map (INITIAL_CAPACITY) ;
+                memcpy (S->map_, MAGIC, sizeof (MAGIC)) ;
+                store32le (S->map_ + 8, VERSION) ;
+                memcpy (S->map_ + OFF_PARAMETER, param.data (), param.size ()) ;
+                leaf_count = 0 ;
+                return S ;
+            }
+            if (static_cast<uint64_t> (st.st_size) < HEADER_SIZE) {
+                throw FormatError { "MerkleMountainRange: " + path + " is too short" } ;
+            }
+            S->Map ((static_cast<uint64_t> (st.st_size) - HEADER_SIZE) / NODE_SIZE) ;
+            const uint8_t * hdr = S->map_ ;
+            if (memcmp (hdr, MAGIC, sizeof (MAGIC)) != 0 || load32le (hdr + 8) != VERSION) {
+                throw FormatError { "MerkleMountainRange: " + path + " is not a mountain range" } ;
+            }
+            if (memcmp (hdr + OFF_PARAMETER, param.data (), param.size ()) != 0) {
+                throw FormatError { "MerkleMountainRange: " + path + " was made with another parameter" } ;
+            }
+            leaf_count = load64le (hdr + OFF_LEAF_COUNT) ;
+            if (S->capacity_ < leaf_count || S->capacity_ < node_count (leaf_count)) {
+                throw FormatError { "MerkleMountainRange: " + path + " is truncated" } ;
+            }
+            S->count_ = node_count (leaf_count) ;
+            return S ;
+#endif
+        }
+
+        uint64_t    GetCount () const {
+            return count_ ;
+        }
+
+        const uint8_t *     At (uint64_t position) const {
+            return nodes_ + NODE_SIZE * position ;
+        }
+
+        void    Push (const Digest &node) {
+            if (capacity_ <= count_) {
+                Grow (std::max (INITIAL_CAPACITY, 2 * capacity_)) ;
+            }
+            memcpy (nodes_ + NODE_SIZE * count_, node.data (), NODE_SIZE) ;
+            ++count_ ;
+        }
+
+        /** Records LEAF_COUNT once all of its nodes are pushed.  */
+        void    Commit (uint64_t leaf_count) {
+            if (map_ != nullptr) {
+                store64le (map_ + OFF_LEAF_COUNT, leaf_count) ;
+            }
+        }
+
+        void    Sync () {
+#ifndef _WIN32
+            if (map_ != nullptr && msync (map_, map_size_, MS_SYNC) != 0) {
+                raise_errno ("MerkleMountainRange::Sync") ;
+            }
+#endif
+        }
+    private:
+        void    Grow (uint64_t capacity) {
+            if (fd_ < 0) {
+                memory_.resize (static_cast<size_t> (NODE_SIZE * capacity)) ;
+                nodes_ = memory_.data () ;
+                capacity_ = capacity ;
+                return ;
+            }
+#ifndef _WIN32
+            Map (capacity) ;
+#endif
+        }
+
+#ifndef _WIN32
+        /**
+         * Maps the file holding CAPACITY nodes (extends the file if needed).
+         * The old mapping is released only once the new one is in place, so a failure keeps it usable.
+         */
+        void    Map (uint64_t capacity) {
+            const size_t    size = static_cast<size_t> (HEADER_SIZE + NODE_SIZE * capacity) ;
+            struct stat st ;
+            if (fstat (fd_, &st) != 0) {
+                raise_errno ("MerkleMountainRange: fstat") ;
+            }
+            if (static_cast<uint64_t> (st.st_size) < size && ftruncate (fd_, static_cast<off_t> (size)) != 0) {
+                raise_errno ("MerkleMountainRange: ftruncate") ;
+            }
+            void *  p = mmap (nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0) ;
+            if (p == MAP_FAILED) {
+                raise_errno ("MerkleMountainRange: mmap") ;
+            }
+            if (map_ != nullptr) {
+                munmap (map_, map_size_) ;
+            }
+            map_ = static_cast<uint8_t *> (p) ;
+            map_size_ = size ;
+            nodes_ = map_ + HEADER_SIZE ;
+            capacity_ = capacity ;
+        }
+#endif
+    } ;
+
+    const uint8_t   MerkleMountainRange::ROOT_DEPTH ;
+
+    MerkleMountainRange::MerkleMountainRange ()
+            : MerkleMountainRange { Parameter ().GetParameterBlock () } {
+        /* NO-OP */
+    }
+
+    MerkleMountainRange::MerkleMountainRange (const parameter_block_t &param)
+            : MerkleMountainRange { param, std::unique_ptr<Store> { new Store {} } } {
+        /* NO-OP */
+    }
+
+    MerkleMountainRange::MerkleMountainRange (const parameter_block_t &param, std::unique_ptr<Store> &&store)
+            : param_ (BinaryNodeHasher { param, 0 }.GetParameterBlock ())
+            , store_ { std::move (store) }
+            , leaf_count_ { 0 } {
+        /* NO-OP */
+    }
+
+    MerkleMountainRange::MerkleMountainRange (MerkleMountainRange &&src)
+            : param_ (src.param_)
+            , store_ { std::move (src.store_) }
+            , leaf_count_ { src.leaf_count_ } {
+        src.store_.reset (new Store {}) ;
+        src.leaf_count_ = 0 ;
+    }
+
+    MerkleMountainRange &   MerkleMountainRange::operator = (MerkleMountainRange &&src) {
+        if (this != &src) {
+            param_ = src.param_ ;
+            store_ = std::move (src.store_) ;
+            leaf_count_ = src.leaf_count_ ;
+            src.store_.reset (new Store {}) ;
+            src.leaf_count_ = 0 ;
+        }
+        return *this ;
+    }
+
+    MerkleMountainRange::~MerkleMountainRange () = default ;
+
+    MerkleMountainRange     MerkleMountainRange::Open (const std::string &path) {
+        return Open (path, Parameter ().GetParameterBlock ()) ;
+    }
+
+    MerkleMountainRange     MerkleMountainRange::Open (const std::string &path, const parameter_block_t &param) {
+        BinaryNodeHasher    H { param, 0 } ;
+        uint64_t            leaf_count = 0 ;
+        auto                store = Store::Open (path, H.GetParameterBlock (), leaf_count) ;
+        MerkleMountainRange     result { param, std::move (store) } ;
+        result.leaf_count_ = leaf_count ;
+        return result ;
+    }
+
+    uint64_t    MerkleMountainRange::GetNodeCount () const {
+        return store_->GetCount () ;
+    }
+
+    Digest  MerkleMountainRange::GetNode (uint64_t position) const {
+        if (store_->GetCount () <= position) {
+            throw std::out_of_range { "MerkleMountainRange::GetNode" } ;
+        }
+        return load_digest (store_->At (position)) ;
+    }
+
+    Digest  MerkleMountainRange::GetLeaf (uint64_t leaf_index) const {
+        if (leaf_count_ <= leaf_index) {
+            throw std::out_of_range { "MerkleMountainRange::GetLeaf" } ;
+        }
+        return load_digest (store_->At (node_count (leaf_index))) ;
+    }
+
+    void    MerkleMountainRange::Merge () {
+        // The new leaf completes a perfect tree for every trailing 1 of the old leaf count.
+        BinaryNodeHasher    H { param_, 0 } ;
+        uint32_t            h = 0 ;
+        for (uint64_t carry = leaf_count_ ; (carry & 1) != 0 ; carry >>= 1) {
+            const uint64_t  right = store_->GetCount () - 1 ;
+            const uint64_t  left = right - ((2uLL << h) - 1) ;
+            ++h ;
+            store_->Push (H.Inner (h, right + 1, load_digest (store_->At (left)), load_digest (store_->At (right)))) ;
+        }
+        ++leaf_count_ ;
+        store_->Commit (leaf_count_) ;
+    }
+
+    uint64_t    MerkleMountainRange::Append (const void *data, size_t size) {
+        const uint64_t  index = leaf_count_ ;
+        store_->Push (BinaryNodeHasher { param_, 0 }.Leaf (store_->GetCount (), data, size)) ;
+        Merge () ;
+        return index ;
+    }
+
+    uint64_t    MerkleMountainRange::Append (size_t count, const void * const *data, const size_t *size) {
+        const uint64_t  first = leaf_count_ ;
+        BinaryNodeHasher    H { param_, 0 } ;
+        std::vector<parameter_block_t>  params ;
+        std::vector<Digest>             leaves ;
+        for (size_t base = 0 ; base < count ; base += APPEND_BATCH_SIZE) {
+            const size_t    n = std::min (APPEND_BATCH_SIZE, count - base) ;
+            params.resize (n) ;
+            leaves.resize (n) ;
+            for (size_t i = 0 ; i < n ; ++i) {
+                params [i] = H.NodeParameter (0, node_count (leaf_count_ + i)) ;
+            }
+            ApplyBatch (params.data (), nullptr, 0, n, data + base, size + base, leaves.data ()) ;
+            for (size_t i = 0 ; i < n ; ++i) {
+                store_->Push (leaves [i]) ;
+                Merge () ;
+            }
+        }
+        return first ;
+    }
+
+    std::vector<Digest>     MerkleMountainRange::GetPeaks (uint64_t leaf_count) const {
+        std::vector<Digest>     result ;
+        for (auto pos : peak_positions (leaf_count)) {
+            result.emplace_back (load_digest (store_->At (pos))) ;
+        }
+        return result ;
+    }
+
+    Digest  MerkleMountainRange::GetRoot (uint64_t leaf_count) const {
+        if (leaf_count_ < leaf_count) {
+            throw std::out_of_range { "MerkleMountainRange::GetRoot" } ;
+        }
+        return hash_root (BinaryNodeHasher { param_, 0 }, leaf_count, GetPeaks (leaf_count)) ;
+    }
+
+    void    MerkleMountainRange::Sync () {
+        store_->Sync () ;
+    }
+
+    MerkleMountainRange::InclusionProof     MerkleMountainRange::ProveInclusion (uint64_t leaf_index, uint64_t leaf_count) const {
+        if (leaf_count_ < leaf_count || leaf_count <= leaf_index) {
+            throw std::out_of_range { "MerkleMountainRange::ProveInclusion" } ;
+        }
+        InclusionProof  result ;
+        result.leaf_index = leaf_index ;
+        result.leaf_count = leaf_count ;
+        climb (node_count (leaf_index), node_count (leaf_count), [this, &result](uint64_t sibling, uint64_t, uint32_t, bool) {
+            result.path.emplace_back (load_digest (store_->At (sibling))) ;
+        }) ;
+        result.peaks = GetPeaks (leaf_count) ;
+        return result ;
+    }
+
+    MerkleMountainRange::ConsistencyProof   MerkleMountainRange::ProveConsistency (uint64_t old_leaf_count, uint64_t new_leaf_count) const {
+        if (leaf_count_ < new_leaf_count || new_leaf_count < old_leaf_count) {
+            throw std::out_of_range { "MerkleMountainRange::ProveConsistency" } ;
+        }
+        ConsistencyProof    result ;
+        result.old_leaf_count = old_leaf_count ;
+        result.new_leaf_count = new_leaf_count ;
+        result.old_peaks = GetPeaks (old_leaf_count) ;
+        for (auto pos : peak_positions (old_leaf_count)) {
+            climb (pos, node_count (new_leaf_count), [this, &result](uint64_t sibling, uint64_t, uint32_t, bool) {
+                result.path.emplace_back (load_digest (store_->At (sibling))) ;
+            }) ;
+        }
+        result.new_peaks = GetPeaks (new_leaf_count) ;
+        return result ;
+    }
+
+    namespace {
+        /**
+         * Climbs from NODE at POSITION with the siblings in PATH (from CURSOR).
+         *
+         * @return The index of the peak reached in PEAKS, or PEAKS.size () if the path does not fit
+         */
+        size_t  climb_with ( const BinaryNodeHasher &H
+                           , uint64_t position, Digest &node, uint64_t nodes
+                           , const std::vector<Digest> &path, size_t &cursor
+                           , const std::vector<uint64_t> &peaks) {
+            bool    ok = true ;
+            auto peak = climb (position, nodes, [&H, &node, &path, &cursor, &ok](uint64_t, uint64_t parent, uint32_t height, bool is_right) {
+                if (path.size () <= cursor) {
+                    ok = false ;
+                    return ;
+                }
+                const Digest &  sibling = path [cursor++] ;
+                node = is_right ? H.Inner (height, parent, sibling, node) : H.Inner (height, parent, node, sibling) ;
+            }) ;
+            if (! ok) {
+                return peaks.size () ;
+            }
+            return static_cast<size_t> (std::find (peaks.cbegin (), peaks.cend (), peak) - peaks.cbegin ()) ;
+        }
+    }
+
+    bool    MerkleMountainRange::VerifyInclusion ( const parameter_block_t &param
+                                                 , const Digest &root
+                                                 , const void *data, size_t size
+                                                 , const InclusionProof &proof) {
+        if (proof.leaf_count <= proof.leaf_index) {
+            return false ;
+        }
+        BinaryNodeHasher    H { param, 0 } ;
+        const auto  peaks = peak_positions (proof.leaf_count) ;
+        if (proof.peaks.size () != peaks.size ()) {
+            return false ;
+        }
+        const uint64_t  position = node_count (proof.leaf_index) ;
+        Digest      node = H.Leaf (position, data, size) ;
+        size_t      cursor = 0 ;
+        size_t      k = climb_with (H, position, node, node_count (proof.leaf_count), proof.path, cursor, peaks) ;
+        if (k == peaks.size () || cursor != proof.path.size ()) {
+            return false ;
+        }
+        return Digest::IsEqual (node, proof.peaks [k])
+            && Digest::IsEqual (hash_root (H, proof.leaf_count, proof.peaks), root) ;
+    }
+
+    bool    MerkleMountainRange::VerifyConsistency ( const parameter_block_t &param
+                                                   , const Digest &old_root
+                                                   , const Digest &new_root
+                                                   , const ConsistencyProof &proof) {
+        if (proof.new_leaf_count < proof.old_leaf_count) {
+            return false ;
+        }
+        BinaryNodeHasher    H { param, 0 } ;
+        const auto  old_peaks = peak_positions (proof.old_leaf_count) ;
+        const auto  new_peaks = peak_positions (proof.new_leaf_count) ;
+        if (proof.old_peaks.size () != old_peaks.size () || proof.new_peaks.size () != new_peaks.size ()) {
+            return false ;
+        }
+        if (! Digest::IsEqual (hash_root (H, proof.old_leaf_count, proof.old_peaks), old_root)
+            || ! Digest::IsEqual (hash_root (H, proof.new_leaf_count, proof.new_peaks), new_root)) {
+            return false ;
+        }
+        const uint64_t  nodes = node_count (proof.new_leaf_count) ;
+        size_t  cursor = 0 ;
+        for (size_t i = 0 ; i < old_peaks.size () ; ++i) {
+            Digest  node = proof.old_peaks [i] ;
+            size_t  k = climb_with (H, old_peaks [i], node, nodes, proof.path, cursor, new_peaks) ;
+            if (k == new_peaks.size () || ! Digest::IsEqual (node, proof.new_peaks [k])) {
+                return false ;
+            }
+        }
+        return cursor == proof.path.size () ;
+    }
+}       /* end of [namespace BLAKE2] */
+/*
+ * [END OF FILE]
+ */
@@ -0,0 +1,173 @@
+/*
+ * MultiBuffer.cpp: Compresses independent messages simultaneously.
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#include "MultiBuffer.h"
+
+#ifdef HAVE_CONFIG_H
+#   include "config.h"
+#endif
+
+#if defined (TARGET_HAVE_AVX2) && defined (TARGET_IS_LITTLE_ENDIAN)
+#   include "RoundAVX2.h"
+#   define USE_AVX2_LANES   1
+#endif
+
+namespace BLAKE2 {
+#ifdef USE_AVX2_LANES
+    namespace {
+        using namespace AVX2 ;
+
+        const uint8_t   sigma [12][16] = {
+            {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 } ,
+            { 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 } ,
+            { 11,  8, 12,  0,  5,  2, 15, 13, 10, 14,  3,  6,  7,  1,  9,  4 } ,
+            {  7,  9,  3,  1, 13, 12, 11, 14,  2,  6,  5, 10,  4,  0, 15,  8 } ,
+            {  9,  0,  5,  7,  2,  4, 10, 15, 14,  1, 11, 12,  6,  8,  3, 13 } ,
+            {  2, 12,  6, 10,  0, 11,  8,  3,  4, 13,  7,  5, 15, 14,  1,  9 } ,
+            { 12,  5,  1, 15, 14, 13,  4, 10,  0,  7,  6,  3,  9,  2,  8, 11 } ,
+            { 13, 11,  7, 14, 12,  1,  3,  9,  5,  0, 15,  4,  8,  6,  2, 10 } ,
+            {  6, 15, 14,  9, 11,  3,  0,  8, 12,  2, 13,  7,  1,  4, 10,  5 } ,
+            { 10,  2,  8,  4,  7,  6,  1,  5, 15, 11,  9, 14,  3, 12, 13 , 0 } ,
+
+            {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 } ,        // Same as sigma [0]
+            { 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 }
+        } ;
+
+        /**
+         * Transposes 4 x 4 64bits words, row I is R [I] (in/out).
+         */
+        TARGET_AVX2 inline void     transpose (__m256i R [4]) {
+            __m256i t0 = _mm256_unpacklo_epi64 (R [0], R [1]) ;
+            __m256i t1 = _mm256_unpackhi_epi64 (R [0], R [1]) ;
+            __m256i t2 = _mm256_unpacklo_epi64 (R [2], R [3]) ;
+            __m256i t3 = _mm256_unpackhi_epi64 (R [2], R [3]) ;
+            R [0] = _mm256_permute2x128_si256 (t0, t2, 0x20) ;
+            R [1] = _mm256_permute2x128_si256 (t1, t3, 0x20) ;
+            R [2] = _mm256_permute2x128_si256 (t0, t2, 0x31) ;
+            R [3] = _mm256_permute2x128_si256 (t1, t3, 0x31) ;
+        }
+
+        /**
+         * Loads COUNT words from every lane, OUT [J] holds the word J of the 4 lanes.
+         */
+        TARGET_AVX2 inline void     load_lanes (__m256i *out, const void * const src [4], size_t count) {
+            for (size_t j = 0 ; j < count ; j += 4) {
+                __m256i R [4] ;
+                for (size_t i = 0 ; i < 4 ; ++i) {
+                    R [i] = _mm256_loadu_si256 ((const __m256i *)(static_cast<const uint8_t *> (src [i]) + 8 * j)) ;
+                }
+                transpose (R) ;
+                out [j + 0] = R [0] ;
+                out [j + 1] = R [1] ;
+                out [j + 2] = R [2] ;
+                out [j + 3] = R [3] ;
+            }
+        }
+
+        const hash_t &  initial_chain () {
+            static const hash_t IV = [] {
+                hash_t  h ;
+                InitializeChain (h) ;
+                return h ;
+            } () ;
+            return IV ;
+        }
+
+        TARGET_AVX2
+        void    compress_lanes_avx2 ( hash_t * const  chain [MULTIBUFFER_LANES]
+                                    , const void * const message [MULTIBUFFER_LANES]
+                                    , const uint64_t  t0 [MULTIBUFFER_LANES]
+                                    , const uint64_t  t1 [MULTIBUFFER_LANES]
+                                    , const uint64_t  f0 [MULTIBUFFER_LANES]
+                                    , const uint64_t  f1 [MULTIBUFFER_LANES]) {
+            const hash_t &  IV = initial_chain () ;
+            __m256i m [16] ;
+            __m256i h [8] ;
+            __m256i v [16] ;
+
+            load_lanes (m, message, 16) ;
+            {
+                const void *    c [4] = { chain [0]->data (), chain [1]->data (), chain [2]->data (), chain [3]->data () } ;
+                load_lanes (h, c, 8) ;
+            }
+            for (size_t i = 0 ; i < 8 ; ++i) {
+                v [i] = h [i] ;
+            }
+            v [ 8] = _mm256_set1_epi64x (static_cast<long long> (IV [0])) ;
+            v [ 9] = _mm256_set1_epi64x (static_cast<long long> (IV [1])) ;
+            v [10] = _mm256_set1_epi64x (static_cast<long long> (IV [2])) ;
+            v [11] = _mm256_set1_epi64x (static_cast<long long> (IV [3])) ;
+            v [12] = _mm256_xor_si256 (_mm256_set1_epi64x (static_cast<long long> (IV [4])), _mm256_loadu_si256 ((const __m256i *)t0)) ;
+            v [13] = _mm256_xor_si256 (_mm256_set1_epi64x (static_cast<long long> (IV [5])), _mm256_loadu_si256 ((const __m256i *)t1)) ;
+            v [14] = _mm256_xor_si256 (_mm256_set1_epi64x (static_cast<long long> (IV [6])), _mm256_loadu_si256 ((const __m256i *)f0)) ;
+            v [15] = _mm256_xor_si256 (_mm256_set1_epi64x (static_cast<long long> (IV [7])), _mm256_loadu_si256 ((const __m256i *)f1)) ;
+
+#define G4(A_, B_, C_, D_, X_, Y_)      do {                                            \
+            v [A_] = _mm256_add_epi64 (_mm256_add_epi64 (v [A_], v [B_]), (X_)) ;       \
+            v [D_] = rotr32 (_mm256_xor_si256 (v [D_], v [A_])) ;                       \
+            v [C_] = _mm256_add_epi64 (v [C_], v [D_]) ;                                \
+            v [B_] = rotr24 (_mm256_xor_si256 (v [B_], v [C_])) ;                       \
+            v [A_] = _mm256_add_epi64 (_mm256_add_epi64 (v [A_], v [B_]), (Y_)) ;       \
+            v [D_] = rotr16 (_mm256_xor_si256 (v [D_], v [A_])) ;                       \
+            v [C_] = _mm256_add_epi64 (v [C_], v [D_]) ;                                \
+            v [B_] = rotr63 (_mm256_xor_si256 (v [B_], v [C_])) ;                       \
+        } while (0)
+
+            for (size_t r = 0 ; r < 12 ; ++r) {
+                const uint8_t * s = sigma [r] ;
+                G4 (0, 4,  8, 12, m [s [ 0]], m [s [ 1]]) ;
+                G4 (1, 5,  9, 13, m [s [ 2]], m [s [ 3]]) ;
+                G4 (2, 6, 10, 14, m [s [ 4]], m [s [ 5]]) ;
+                G4 (3, 7, 11, 15, m [s [ 6]], m [s [ 7]]) ;
+                G4 (0, 5, 10, 15, m [s [ 8]], m [s [ 9]]) ;
+                G4 (1, 6, 11, 12, m [s [10]], m [s [11]]) ;
+                G4 (2, 7,  8, 13, m [s [12]], m [s [13]]) ;
+                G4 (3, 4,  9, 14, m [s [14]], m [s [15]]) ;
+            }
+#undef  G4
+
+            for (size_t i = 0 ; i < 8 ; i += 4) {
+                __m256i R [4] ;
+                for (size_t j = 0 ; j < 4 ; ++j) {
+                    R [j] = _mm256_xor_si256 (h [i + j], _mm256_xor_si256 (v [i + j], v [i + j + 8])) ;
+                }
+                transpose (R) ;
+                for (size_t k = 0 ; k < 4 ; ++k) {
+                    _mm256_storeu_si256 ((__m256i *)(chain [k]->data () + i), R [k]) ;
+                }
+            }
+        }
+    }
+#endif  /* USE_AVX2_LANES */
+
+    bool    multibuffer_is_vectorized () {
+#ifdef USE_AVX2_LANES
+        static const bool   result = __builtin_cpu_supports ("avx2") ;
+        return result ;
+#else
+        return false ;
+#endif
+    }
+
+    void    CompressLanes ( hash_t * const  chain [MULTIBUFFER_LANES]
+                          , const void * const message [MULTIBUFFER_LANES]
+                          , const uint64_t  t0 [MULTIBUFFER_LANES]
+                          , const uint64_t  t1 [MULTIBUFFER_LANES]
+                          , const uint64_t  f0 [MULTIBUFFER_LANES]
+                          , const uint64_t  f1 [MULTIBUFFER_LANES]) {
+#ifdef USE_AVX2_LANES
+        if (multibuffer_is_vectorized ()) {
+            compress_lanes_avx2 (chain, message, t0, t1, f0, f1) ;
+            return ;
+        }
+#endif
+        for (size_t i = 0 ; i < MULTIBUFFER_LANES ; ++i) {
+            Compress (*chain [i], message [i], t0 [i], t1 [i], f0 [i], f1 [i]) ;
+        }
+    }
+}       /* end of [namespace BLAKE2] */
+/*
+ * [END OF FILE]
+ */
@@ -0,0 +1,36 @@
+/*
+ * MultiBuffer.h: Compresses independent messages simultaneously.
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#pragma once
+#ifndef multibuffer_h__3f8a2d6c1e9b4a7d9c5e0b2f4a6d8c1e
+#define multibuffer_h__3f8a2d6c1e9b4a7d9c5e0b2f4a6d8c1e    1
+
+#include "BLAKE2.hpp"
+
+namespace BLAKE2 {
+
+    const size_t    MULTIBUFFER_LANES = 4 ;
+
+    /** true if `CompressLanes` runs the lanes in SIMD on this CPU (otherwise, lanes are compressed one by one).  */
+    bool    multibuffer_is_vectorized () ;
+
+    /**
+     * Runs `Compress` on MULTIBUFFER_LANES independent chains.
+     *
+     * Lane I computes Compress (*chain [I], message [I], t0 [I], t1 [I], f0 [I], f1 [I]).
+     * Uses the 4 x 64bits lanes of AVX2 when the CPU has it.
+     */
+    void    CompressLanes ( hash_t * const  chain [MULTIBUFFER_LANES]
+                          , const void * const message [MULTIBUFFER_LANES]
+                          , const uint64_t  t0 [MULTIBUFFER_LANES]
+                          , const uint64_t  t1 [MULTIBUFFER_LANES]
+                          , const uint64_t  f0 [MULTIBUFFER_LANES]
+                          , const uint64_t  f1 [MULTIBUFFER_LANES]) ;
+}
+
+#endif  /* multibuffer_h__3f8a2d6c1e9b4a7d9c5e0b2f4a6d8c1e */
+/*
+ * [END OF FILE]
+ */
@@ -0,0 +1,283 @@
+/*
+ * Numa.cpp: NUMA aware tree hashing of large memory regions.
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#include <algorithm>
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include "BLAKE2/Numa.hpp"
+#include "BLAKE2/Parallel.hpp"
+#include "BLAKE2/ThreadPool.hpp"
+#include "Tree.h"
+
+#ifdef HAVE_CONFIG_H
+#   include "config.h"
+#endif
+
+#if defined (__linux__)
+#   include <pthread.h>
+#   include <sched.h>
+#   include <sys/syscall.h>
+#   include <unistd.h>
+#endif
+
+namespace BLAKE2 {
+
+    namespace {
+        const size_t    MAX_KEY_LENGTH = 64 ;
+        const size_t    MIN_JOB_LENGTH = 64 * 1024 ;    // Approximate # of bytes hashed by a job.
+#if defined (__linux__)
+        const int       MPOL_F_NODE = 1 << 0 ;          // From <numaif.h> (libnuma is not required).
+        const int       MPOL_F_ADDR = 1 << 1 ;
+        const char      NODE_DIRECTORY [] = "/sys/devices/system/node/" ;
+
+        std::string     read_first_line (const std::string &path) {
+            std::ifstream   in { path } ;
+            std::string     line ;
+            std::getline (in, line) ;
+            return line ;
+        }
+
+        /** Parses a cpulist ("0-3,8,10-11").  */
+        std::vector<int>    parse_cpu_list (const std::string &s) {
+            std::vector<int>    result ;
+            std::istringstream  in { s } ;
+            std::string         item ;
+            while (std::getline (in, item, ',')) {
+                int     first = 0 ;
+                int     last = 0 ;
+                const int   n = sscanf (item.c_str (), "%d-%d", &first, &last) ;
+                if (n <= 0) {
+                    continue ;
+                }
+                for (int c = first ; c <= ((n == 2) ? last : first) ; ++c) {
+                    result.push_back (c) ;
+                }
+            }
+            return result ;
+        }
+
+        std::vector<NumaTopology::Node>     read_nodes () {
+            cpu_set_t   allowed ;
+            CPU_ZERO (&allowed) ;
+            const bool  has_mask = sched_getaffinity (0, sizeof (allowed), &allowed) == 0 ;
+
+            std::vector<NumaTopology::Node>     result ;
+            for (int id : parse_cpu_list (read_first_line (std::string { NODE_DIRECTORY } + "online"))) {
+                const std::string   cpulist = read_first_line (std::string { NODE_DIRECTORY } + "node" + std::to_string (id) + "/cpulist") ;
+                NumaTopology::Node  node { id, {} } ;
+                for (int c : parse_cpu_list (cpulist)) {
+                    if (! has_mask || (c < CPU_SETSIZE && CPU_ISSET (c, &allowed))) {
+                        node.cpus.push_back (c) ;
+                    }
+                }
+                if (! node.cpus.empty ()) {     // Memory only nodes are read from the others.
+                    result.push_back (std::move (node)) ;
+                }
+            }
+            return result ;
+        }
+
+        void    pin_current_thread (const std::vector<int> &cpus) {
+            cpu_set_t   set ;
+            CPU_ZERO (&set) ;
+            for (int c : cpus) {
+                CPU_SET (c, &set) ;
+            }
+            pthread_setaffinity_np (pthread_self (), sizeof (set), &set) ;
+        }
+#else
+        std::vector<NumaTopology::Node>     read_nodes () {
+            return {} ;
+        }
+
+        void    pin_current_thread (const std::vector<int> &cpus) {
+            (void)cpus ;
+        }
+#endif
+
+        /**
+         * Runs NODE (i) for every i on the node OWNERS [i], the nodes in parallel.
+         * Cheap nodes are packed into a job as `ApplyTree` does.
+         */
+        void    run_on_owners ( NumaThreadPools &pools, const std::vector<size_t> &owners, size_t node_length
+                              , const std::function<void (size_t)> &node) {
+            const NumaTopology &    T = pools.GetTopology () ;
+            std::vector<std::vector<size_t>>    groups (T.GetNodeCount ()) ;
+            for (size_t i = 0 ; i < owners.size () ; ++i) {
+                groups [owners [i]].push_back (i) ;
+            }
+            const size_t    per_job = std::max<size_t> (1, MIN_JOB_LENGTH / std::max<size_t> (1, node_length)) ;
+            std::vector<std::exception_ptr>     errors (groups.size ()) ;
+            std::vector<std::thread>            threads ;
+            for (size_t k = 0 ; k < groups.size () ; ++k) {
+                if (groups [k].empty ()) {
+                    continue ;
+                }
+                threads.emplace_back ([&, k]() {
+                    auto const &    items = groups [k] ;
+                    try {
+                        pin_current_thread (T.GetNode (k).cpus) ;
+                        pools.GetExecutor (k).Run ((items.size () + per_job - 1) / per_job, [&](size_t job) {
+                            const size_t    end = std::min (items.size (), (job + 1) * per_job) ;
+                            for (size_t i = job * per_job ; i < end ; ++i) {
+                                node (items [i]) ;
+                            }
+                        }) ;
+                    }
+                    catch (...) {
+                        errors [k] = std::current_exception () ;
+                    }
+                }) ;
+            }
+            for (auto &t : threads) {
+                t.join () ;
+            }
+            for (auto const &e : errors) {
+                if (e) {
+                    std::rethrow_exception (e) ;
+                }
+            }
+        }
+    }
+
+    const int   NumaTopology::UNKNOWN_NODE ;
+
+    const NumaTopology &    NumaTopology::System () {
+        static const NumaTopology   topology = []() {
+            auto    nodes = read_nodes () ;
+            if (nodes.empty ()) {
+                NumaTopology::Node  node { 0, {} } ;
+                const size_t    cnt = std::max<size_t> (1, std::thread::hardware_concurrency ()) ;
+                for (size_t c = 0 ; c < cnt ; ++c) {
+                    node.cpus.push_back (static_cast<int> (c)) ;
+                }
+                nodes.push_back (node) ;
+            }
+            return NumaTopology { nodes } ;
+        } () ;
+        return topology ;
+    }
+
+    NumaTopology::NumaTopology (const std::vector<Node> &nodes) : nodes_ (nodes) {
+        if (nodes_.empty ()) {
+            throw std::invalid_argument { "NumaTopology: no node" } ;
+        }
+        for (auto const &node : nodes_) {
+            if (node.cpus.empty ()) {
+                throw std::invalid_argument { "NumaTopology: node without CPU" } ;
+            }
+        }
+    }
+
+    size_t  NumaTopology::FindNode (int id) const {
+        for (size_t i = 0 ; i < nodes_.size () ; ++i) {
+            if (nodes_ [i].id == id) {
+                return i ;
+            }
+        }
+        return nodes_.size () ;
+    }
+
+    void    NumaTopology::QueryPageNodes (const void * const *pages, size_t count, int *nodes) {
+        std::fill (nodes, nodes + count, UNKNOWN_NODE) ;
+#if defined (__linux__) && defined (SYS_move_pages) && defined (SYS_get_mempolicy)
+        if (count == 0) {
+            return ;
+        }
+        // NODES == nullptr: only queries, status receives the node or -errno.
+        std::vector<int>    status (count) ;
+        if (syscall (SYS_move_pages, 0, count, pages, nullptr, status.data (), 0) == 0) {
+            for (size_t i = 0 ; i < count ; ++i) {
+                nodes [i] = (0 <= status [i]) ? status [i] : UNKNOWN_NODE ;
+            }
+            return ;
+        }
+        // move_pages is not permitted (e.g. seccomp), asks the policy of every page.
+        for (size_t i = 0 ; i < count ; ++i) {
+            int     node = UNKNOWN_NODE ;
+            if (syscall (SYS_get_mempolicy, &node, nullptr, 0, pages [i], MPOL_F_NODE | MPOL_F_ADDR) == 0) {
+                nodes [i] = node ;
+            }
+        }
+#else
+        (void)pages ;
+#endif
+    }
+
+    NumaThreadPools::NumaThreadPools (const NumaTopology &topology) : topology_ (topology) {
+        for (size_t k = 0 ; k < topology_.GetNodeCount () ; ++k) {
+            auto const &    cpus = topology_.GetNode (k).cpus ;
+            // The pinned thread calling `Run` is the last one.
+            if (cpus.size () < 2) {
+                executors_.emplace_back (new SequentialExecutor {}) ;
+            }
+            else {
+                executors_.emplace_back (new ThreadPool { cpus.size () - 1, cpus }) ;
+            }
+        }
+    }
+
+    NumaThreadPools::~NumaThreadPools () = default ;
+
+    Digest  ApplyTreeNuma ( const parameter_block_t &param
+                          , const void *key, size_t key_length
+                          , const void *data, size_t data_length
+                          , NumaThreadPools *pools) {
+        if (pools == nullptr) {
+            static NumaThreadPools  system_pools ;
+            pools = &system_pools ;
+        }
+        const size_t    k_len = (key == nullptr) ? 0 : std::min (key_length, MAX_KEY_LENGTH) ;
+        const Parameter P { tree_parameter (param, k_len) } ;
+        const size_t    inner = P.GetInnerLength () ;
+        const size_t    leaf_len = P.GetLeafLength () ;
+        const size_t    nodes = pools->GetTopology ().GetNodeCount () ;
+        if (P.GetDepth () == 1 || leaf_len == 0 || data_length <= leaf_len || nodes < 2) {
+            return ApplyTree (param, key, key_length, data, data_length, &pools->GetExecutor (0)) ;
+        }
+        auto const *    src = static_cast<const uint8_t *> (data) ;
+        size_t          count = (data_length + leaf_len - 1) / leaf_len ;
+
+        // A leaf belongs to the node of its first page, the unknown ones are spread.
+        std::vector<size_t> owners (count) ;
+        {
+            std::vector<const void *>   pages (count) ;
+            std::vector<int>            ids (count) ;
+            for (size_t i = 0 ; i < count ; ++i) {
+                pages [i] = src + i * leaf_len ;
+            }
+            NumaTopology::QueryPageNodes (pages.data (), count, ids.data ()) ;
+            for (size_t i = 0 ; i < count ; ++i) {
+                const size_t    k = pools->GetTopology ().FindNode (ids [i]) ;
+                owners [i] = (k < nodes) ? k : i % nodes ;
+            }
+        }
+        std::vector<uint8_t>    level (count * inner) ;
+        run_on_owners (*pools, owners, leaf_len, [&](size_t i) {
+            const size_t    off = i * leaf_len ;
+            Digest  D { hash_tree_node ( P, 0, i, i == count - 1, key, k_len
+                                       , src + off, std::min (leaf_len, data_length - off)) } ;
+            D.CopyTo (&level [i * inner], inner) ;
+        }) ;
+        // An inner node runs where its first child did.
+        return combine_tree_levels (P, level, count, [&](size_t n, size_t node_length, const std::function<void (size_t)> &node) {
+            const size_t        per_node = node_length / inner ;
+            std::vector<size_t> upper (n) ;
+            for (size_t j = 0 ; j < n ; ++j) {
+                upper [j] = owners [j * per_node] ;
+            }
+            owners.swap (upper) ;
+            run_on_owners (*pools, owners, node_length, node) ;
+        }) ;
+    }
+}       /* end of [namespace BLAKE2] */
+/*
+ * [END OF FILE]
+ */
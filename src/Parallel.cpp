@@ -0,0 +1,206 @@
+/*
+ * Parallel.cpp: Parallel (BLAKE2bp) and tree hashing modes.
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <vector>
+#include "BLAKE2/Parallel.hpp"
+#include "Support.h"
+#include "Tree.h"
+
+#ifdef HAVE_CONFIG_H
+#   include "config.h"
+#endif
+
+namespace BLAKE2 {
+
+    namespace {
+        const size_t    MAX_KEY_LENGTH = 64 ;
+        const size_t    MIN_PARALLEL_LENGTH = 256 * 1024 ;  // Smaller inputs are hashed on the calling thread.
+        const size_t    MIN_JOB_LENGTH = 64 * 1024 ;        // Approximate # of bytes hashed by a job.
+
+        /**
+         * Runs node (0) ... node (count - 1), packing cheap nodes into a job.
+         */
+        template <typename F_>
+            void    run_nodes (Executor &executor, size_t count, size_t node_length, F_ &&node) {
+                size_t  per_job = std::max<size_t> (1, MIN_JOB_LENGTH / std::max<size_t> (1, node_length)) ;
+                size_t  cnt_jobs = (count + per_job - 1) / per_job ;
+                executor.Run (cnt_jobs, [count, per_job, &node](size_t job) {
+                    size_t  end = std::min (count, (job + 1) * per_job) ;
+                    for (size_t i = job * per_job ; i < end ; ++i) {
+                        node (i) ;
+                    }
+                }) ;
+            }
+    }
+
+    Digest  ApplyParallel ( const void *key, size_t key_length
+                          , const void *data, size_t data_length
+                          , Executor *executor) {
+        Parameter   param ;
+        return ApplyParallel (param.GetParameterBlock (), key, key_length, data, data_length, executor) ;
+    }
+
+    Digest  ApplyParallel ( const parameter_block_t &param
+                          , const void *key, size_t key_length
+                          , const void *data, size_t data_length
+                          , Executor *executor) {
+        size_t      k_len = (key == nullptr) ? 0 : std::min (key_length, MAX_KEY_LENGTH) ;
+        Parameter   P { param } ;
+        P.SetKeyLength (static_cast<uint8_t> (k_len))
+         .SetFanoutCount (PARALLELISM_DEGREE)
+         .SetDepth (2)
+         .SetLeafLength (0)
+         .SetInnerLength (P.GetDigestLength ()) ;
+
+        auto const *    src = static_cast<const uint8_t *> (data) ;
+        std::array<Digest, PARALLELISM_DEGREE>  leaves ;
+
+        // Leaf I processes the blocks I, I + 4, I + 8 ...
+        select_executor (executor, data_length < MIN_PARALLEL_LENGTH).Run (PARALLELISM_DEGREE, [&](size_t i) {
+            Parameter   leaf { P } ;
+            leaf.SetNodeOffset (i).SetNodeDepth (0) ;
+            Generator   g { leaf.GetParameterBlock (), key, k_len } ;
+            if (i == PARALLELISM_DEGREE - 1) {
+                g.SetLastNode () ;
+            }
+            for (size_t off = i * BLOCK_SIZE ; off < data_length ; off += PARALLELISM_DEGREE * BLOCK_SIZE) {
+                g.Update (src + off, std::min (BLOCK_SIZE, data_length - off)) ;
+            }
+            leaves [i] = g.Finalize () ;
+        }) ;
+
+        return hash_tree_node (P, 1, 0, true, nullptr, 0, leaves.data (), leaves.size () * Digest::SIZE) ;
+    }
+
+    Digest  ApplyTree ( const parameter_block_t &param
+                      , const void *key, size_t key_length
+                      , const void *data, size_t data_length
+                      , Executor *executor) {
+        size_t      k_len = (key == nullptr) ? 0 : std::min (key_length, MAX_KEY_LENGTH) ;
+        Parameter   P { tree_parameter (param, k_len) } ;
+        const size_t    depth = P.GetDepth () ;
+        const size_t    inner = P.GetInnerLength () ;
+        const size_t    leaf_len = P.GetLeafLength () ;
+
+        auto const *    src = static_cast<const uint8_t *> (data) ;
+
+        if (depth == 1) {
+            // Plain sequential mode.
+            return hash_tree_node (P, 0, 0, false, key, k_len, src, data_length) ;
+        }
+        if (leaf_len == 0 || data_length <= leaf_len) {
+            return hash_tree_node (P, 0, 0, true, key, k_len, src, data_length) ;
+        }
+        Executor &  exec = select_executor (executor, data_length < MIN_PARALLEL_LENGTH) ;
+
+        size_t  count = (data_length + leaf_len - 1) / leaf_len ;
+        std::vector<uint8_t>    level (count * inner) ;
+
+        run_nodes (exec, count, leaf_len, [&](size_t i) {
+            size_t  off = i * leaf_len ;
+            Digest  D { hash_tree_node ( P, 0, i, i == count - 1, key, k_len
+                                       , src + off, std::min (leaf_len, data_length - off)) } ;
+            D.CopyTo (&level [i * inner], inner) ;
+        }) ;
+        return combine_tree_levels (P, level, count, [&exec](size_t n, size_t node_length, const std::function<void (size_t)> &node) {
+            run_nodes (exec, n, node_length, node) ;
+        }) ;
+    }
+
+    Parameter   tree_parameter (const parameter_block_t &param, size_t key_length) {
+        Parameter   P { param } ;
+        P.SetKeyLength (static_cast<uint8_t> (key_length)) ;
+        if (P.GetDepth () == 0) {
+            P.SetDepth (1) ;
+        }
+        if (1 < P.GetDepth () && P.GetInnerLength () == 0) {
+            P.SetInnerLength (Digest::SIZE) ;
+        }
+        return P ;
+    }
+
+    Digest  hash_tree_node ( const Parameter &base
+                           , uint8_t node_depth, uint64_t node_offset, bool is_last
+                           , const void *key, size_t key_length
+                           , const void *data, size_t data_length) {
+        Parameter   P { base } ;
+        P.SetNodeDepth (node_depth).SetNodeOffset (node_offset) ;
+        Generator   g { P.GetParameterBlock (), key, key_length } ;
+        if (is_last) {
+            g.SetLastNode () ;
+        }
+        return g.Update (data, data_length).Finalize () ;
+    }
+
+    Digest  combine_tree_levels (const Parameter &P, std::vector<uint8_t> &level, size_t count, const tree_level_runner_t &run) {
+        const size_t    depth = P.GetDepth () ;
+        const size_t    fanout = P.GetFanoutCount () ;
+        const size_t    inner = P.GetInnerLength () ;
+        for (size_t d = 1 ; ; ++d) {
+            // The node at the maximal depth absorbs everything.
+            size_t  per_node = (fanout == 0 || d + 1 == depth) ? count : fanout ;
+            size_t  n = (count + per_node - 1) / per_node ;
+            if (n == 1) {
+                return hash_tree_node (P, static_cast<uint8_t> (d), 0, true, nullptr, 0, level.data (), count * inner) ;
+            }
+            std::vector<uint8_t>    upper (n * inner) ;
+            run (n, per_node * inner, [&](size_t j) {
+                size_t  first = j * per_node ;
+                size_t  last = std::min (count, first + per_node) ;
+                Digest  D { hash_tree_node ( P, static_cast<uint8_t> (d), j, j == n - 1, nullptr, 0
+                                           , &level [first * inner], (last - first) * inner) } ;
+                D.CopyTo (&upper [j * inner], inner) ;
+            }) ;
+            level.swap (upper) ;
+            count = n ;
+        }
+    }
+
+    BinaryNodeHasher::BinaryNodeHasher (const parameter_block_t &param, uint32_t leaf_length) : base_ { param } {
+        base_.SetDigestLength (static_cast<uint8_t> (Digest::SIZE))
+             .SetKeyLength (0)
+             .SetFanoutCount (2)
+             .SetDepth (255)
+             .SetLeafLength (leaf_length)
+             .SetNodeOffset (0)
+             .SetNodeDepth (0)
+             .SetInnerLength (static_cast<uint8_t> (Digest::SIZE)) ;
+    }
+
+    parameter_block_t   BinaryNodeHasher::NodeParameter (uint32_t depth, uint64_t offset) const {
+        Parameter   P { base_ } ;
+        P.SetNodeDepth (static_cast<uint8_t> (depth)).SetNodeOffset (offset) ;
+        return P.GetParameterBlock () ;
+    }
+
+    Digest  BinaryNodeHasher::Leaf (uint64_t offset, const void *data, size_t size, bool is_last) const {
+        if (! is_last) {
+            return Apply (NodeParameter (0, offset), nullptr, 0, data, size) ;
+        }
+        Generator   g { NodeParameter (0, offset) } ;
+        g.Update (data, size) ;
+        return g.SetLastNode ().Finalize () ;
+    }
+
+    Digest  BinaryNodeHasher::Inner (uint32_t depth, uint64_t offset, const uint8_t *children, bool is_last) const {
+        hash_t      h ;
+        InitializeChain (h, NodeParameter (depth, offset)) ;
+        Compress (h, children, BLOCK_SIZE, 0, ~0uLL, is_last ? ~0uLL : 0) ;
+        return Digest { h } ;
+    }
+
+    Digest  BinaryNodeHasher::Inner (uint32_t depth, uint64_t offset, const Digest &left, const Digest &right) const {
+        uint8_t     block [BLOCK_SIZE] ;
+        memcpy (block, left.data (), Digest::SIZE) ;
+        memcpy (block + Digest::SIZE, right.data (), Digest::SIZE) ;
+        return Inner (depth, offset, block) ;
+    }
+}       /* end of [namespace BLAKE2] */
+/*
+ * [END OF FILE]
+ */
@@ -0,0 +1,44 @@
+/*
+ * Probes.h: USDT (statically defined tracing) probes.
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#pragma once
+#ifndef probes_h__6d1f3a8c9e2b4f7a8b5c0e4d2a9f6b38
+#define probes_h__6d1f3a8c9e2b4f7a8b5c0e4d2a9f6b38    1
+
+#ifdef HAVE_CONFIG_H
+#   include "config.h"
+#endif
+
+/*
+ * Probes of the provider "blake2" (a disabled probe is a single NOP, the arguments
+ * are only read by the tracer):
+ *
+ *     generator__init     (generator, keyed)
+ *     update__entry       (generator, size)
+ *     update__return      (generator, size)
+ *     finalize            (generator, # of hashed bytes)
+ *     apply__entry        (data, size)
+ *     apply__return       (data, size)
+ *     kernel__select      (kernel name)
+ *
+ * e.g.
+ *     bpftrace -e 'usdt:./libBLAKE2.so:blake2:apply__entry { @sizes = hist (arg1) ; }'
+ *
+ * Built only when <sys/sdt.h> is found (USE_USDT build option), a header only
+ * facility: nothing is linked.
+ */
+#ifdef ENABLE_USDT
+#   include <sys/sdt.h>
+#   define PROBE1(NAME_, A1_)           DTRACE_PROBE1 (blake2, NAME_, (A1_))
+#   define PROBE2(NAME_, A1_, A2_)      DTRACE_PROBE2 (blake2, NAME_, (A1_), (A2_))
+#else
+#   define PROBE1(NAME_, A1_)           do { /* NO-OP */ } while (0)
+#   define PROBE2(NAME_, A1_, A2_)      do { /* NO-OP */ } while (0)
+#endif
+
+#endif  /* probes_h__6d1f3a8c9e2b4f7a8b5c0e4d2a9f6b38 */
+/*
+ * [END OF FILE]
+ */
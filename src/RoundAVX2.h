@@ -0,0 +1,64 @@
+/*
+ * RoundAVX2.h: Building blocks of the AVX2 round functions.
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#pragma once
+#ifndef roundavx2_h__8e1c4a7f2b5d4e9a8c3f6b0d1a7e5c92
+#define roundavx2_h__8e1c4a7f2b5d4e9a8c3f6b0d1a7e5c92    1
+
+#include <immintrin.h>
+
+#ifndef TARGET_AVX2
+    // Callers are compiled for AVX2 the same way, and chosen at runtime by CPUID.
+#   define TARGET_AVX2  __attribute__ ((target ("avx2")))
+#endif
+
+namespace BLAKE2 { namespace AVX2 {
+
+    /*
+     * Rotations used by the G function, applied to every 64bits lane.
+     * Byte granular rotations are done with a shuffle.
+     */
+
+    TARGET_AVX2 inline __m256i  rotr32 (__m256i x) {
+        return _mm256_shuffle_epi32 (x, 0xB1) ;
+    }
+
+    TARGET_AVX2 inline __m256i  rotr24 (__m256i x) {
+        const __m256i   mask = _mm256_setr_epi8 ( 3,  4,  5,  6,  7,  0,  1,  2, 11, 12, 13, 14, 15,  8,  9, 10
+                                                , 3,  4,  5,  6,  7,  0,  1,  2, 11, 12, 13, 14, 15,  8,  9, 10) ;
+        return _mm256_shuffle_epi8 (x, mask) ;
+    }
+
+    TARGET_AVX2 inline __m256i  rotr16 (__m256i x) {
+        const __m256i   mask = _mm256_setr_epi8 ( 2,  3,  4,  5,  6,  7,  0,  1, 10, 11, 12, 13, 14, 15,  8,  9
+                                                , 2,  3,  4,  5,  6,  7,  0,  1, 10, 11, 12, 13, 14, 15,  8,  9) ;
+        return _mm256_shuffle_epi8 (x, mask) ;
+    }
+
+    TARGET_AVX2 inline __m256i  rotr63 (__m256i x) {
+        return _mm256_or_si256 (_mm256_srli_epi64 (x, 63), _mm256_add_epi64 (x, x)) ;
+    }
+
+    /*
+     * Moves the word I + N into the lane I, used for (un)diagonalizing the rows.
+     */
+
+    TARGET_AVX2 inline __m256i  rotate_lanes1 (__m256i x) {
+        return _mm256_permute4x64_epi64 (x, 0x39) ;
+    }
+
+    TARGET_AVX2 inline __m256i  rotate_lanes2 (__m256i x) {
+        return _mm256_permute4x64_epi64 (x, 0x4E) ;
+    }
+
+    TARGET_AVX2 inline __m256i  rotate_lanes3 (__m256i x) {
+        return _mm256_permute4x64_epi64 (x, 0x93) ;
+    }
+}}      /* end of [namespace BLAKE2::AVX2] */
+
+#endif  /* roundavx2_h__8e1c4a7f2b5d4e9a8c3f6b0d1a7e5c92 */
+/*
+ * [END OF FILE]
+ */
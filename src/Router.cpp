@@ -0,0 +1,245 @@
+/*
+ * Router.cpp: Rendezvous and jump consistent hashing.
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+#include "BLAKE2/Router.hpp"
+#include "MultiBuffer.h"
+
+#ifdef HAVE_CONFIG_H
+#   include "config.h"
+#endif
+
+namespace BLAKE2 {
+
+    namespace {
+        const size_t    DIGEST_LENGTH = 8 ;
+        const size_t    JUMP_BATCH_SIZE = 64 ;
+
+        /** Maps SCORE to (0, 1).  */
+        inline double   to_unit (uint64_t score) {
+            return (static_cast<double> (score >> 11) + 0.5) * (1.0 / 9007199254740992.0) ;
+        }
+    }
+
+    const size_t    RendezvousRouter::NO_NODE ;
+    const size_t    RendezvousRouter::MAX_NAME_LENGTH ;
+
+    RendezvousRouter::RendezvousRouter () : RendezvousRouter { Parameter ().GetParameterBlock () } {
+        /* NO-OP */
+    }
+
+    RendezvousRouter::RendezvousRouter (const parameter_block_t &param) : weighted_ { false } {
+        Parameter   P { param } ;
+        P.SetDigestLength (static_cast<uint8_t> (DIGEST_LENGTH)) ;
+        P.CopyTo (param_) ;
+    }
+
+    size_t  RendezvousRouter::AddNode (const std::string &name, double weight) {
+        if (name.empty () || MAX_NAME_LENGTH < name.size ()) {
+            throw std::invalid_argument { "RendezvousRouter: node name should be 1 to 64 bytes" } ;
+        }
+        if (! (0.0 < weight) || std::isinf (weight)) {
+            throw std::invalid_argument { "RendezvousRouter: weight should be positive" } ;
+        }
+        if (std::find (names_.cbegin (), names_.cend (), name) != names_.cend ()) {
+            throw std::invalid_argument { "RendezvousRouter: duplicated node name" } ;
+        }
+        Parameter   P { param_ } ;
+        P.SetKeyLength (static_cast<uint8_t> (name.size ())) ;
+
+        hash_t      h ;
+        InitializeChain (h, P.GetParameterBlock ()) ;
+        uint8_t     block [BLOCK_SIZE] = { 0 } ;
+        memcpy (block, name.data (), name.size ()) ;
+        hash_t      empty = h ;
+        // The name block is the last one for the empty key.
+        Compress (empty, block, BLOCK_SIZE, 0, ~0uLL, 0) ;
+        Compress (h, block, BLOCK_SIZE, 0, 0, 0) ;
+
+        names_.emplace_back (name) ;
+        weights_.emplace_back (weight) ;
+        chains_.emplace_back (h) ;
+        empty_scores_.emplace_back (empty [0]) ;
+        UpdateWeighted () ;
+        return names_.size () - 1 ;
+    }
+
+    bool    RendezvousRouter::RemoveNode (const std::string &name) {
+        auto it = std::find (names_.cbegin (), names_.cend (), name) ;
+        if (it == names_.cend ()) {
+            return false ;
+        }
+        auto idx = static_cast<size_t> (it - names_.cbegin ()) ;
+        names_.erase (names_.begin () + idx) ;
+        weights_.erase (weights_.begin () + idx) ;
+        chains_.erase (chains_.begin () + idx) ;
+        empty_scores_.erase (empty_scores_.begin () + idx) ;
+        UpdateWeighted () ;
+        return true ;
+    }
+
+    void    RendezvousRouter::UpdateWeighted () {
+        weighted_ = false ;
+        for (auto w : weights_) {
+            if (w != weights_.front ()) {
+                weighted_ = true ;
+                break ;
+            }
+        }
+    }
+
+    double  RendezvousRouter::Weigh (size_t index, uint64_t score) const {
+        return weights_ [index] / -std::log (to_unit (score)) ;
+    }
+
+    void    RendezvousRouter::Score (const void *key, size_t size, uint64_t *scores) const {
+        if (size == 0) {
+            std::copy (empty_scores_.cbegin (), empty_scores_.cend (), scores) ;
+            return ;
+        }
+        // Blocks of the key are shared by the lanes, only the last one needs a copy.
+        const size_t    cnt_blocks = std::max<size_t> (1, (size + BLOCK_SIZE - 1) / BLOCK_SIZE) ;
+        const size_t    last_length = size - BLOCK_SIZE * (cnt_blocks - 1) ;
+        auto const *    p = static_cast<const uint8_t *> (key) ;
+        uint8_t         last [BLOCK_SIZE] = { 0 } ;
+        if (0 < last_length) {
+            memcpy (last, p + BLOCK_SIZE * (cnt_blocks - 1), last_length) ;
+        }
+        auto message = [p, &last, cnt_blocks](size_t b) -> const void * {
+            return (b + 1 < cnt_blocks) ? static_cast<const void *> (p + BLOCK_SIZE * b) : static_cast<const void *> (last) ;
+        } ;
+        auto counter = [cnt_blocks, last_length](size_t b) -> uint64_t {
+            return BLOCK_SIZE * (b + 1) + ((b + 1 < cnt_blocks) ? BLOCK_SIZE : last_length) ;
+        } ;
+
+        const size_t    count = chains_.size () ;
+        size_t          i = 0 ;
+        if (multibuffer_is_vectorized ()) {
+            const uint64_t  zero [MULTIBUFFER_LANES] = { 0, 0, 0, 0 } ;
+            for ( ; i + MULTIBUFFER_LANES <= count ; i += MULTIBUFFER_LANES) {
+                hash_t      h [MULTIBUFFER_LANES] = { chains_ [i + 0], chains_ [i + 1], chains_ [i + 2], chains_ [i + 3] } ;
+                hash_t * const  chain [MULTIBUFFER_LANES] = { &h [0], &h [1], &h [2], &h [3] } ;
+                for (size_t b = 0 ; b < cnt_blocks ; ++b) {
+                    const void *    m = message (b) ;
+                    const uint64_t  c = counter (b) ;
+                    const uint64_t  f = (b + 1 < cnt_blocks) ? 0 : ~0uLL ;
+                    const void * const  msg [MULTIBUFFER_LANES] = { m, m, m, m } ;
+                    const uint64_t  t0 [MULTIBUFFER_LANES] = { c, c, c, c } ;
+                    const uint64_t  f0 [MULTIBUFFER_LANES] = { f, f, f, f } ;
+                    CompressLanes (chain, msg, t0, zero, f0, zero) ;
+                }
+                for (size_t k = 0 ; k < MULTIBUFFER_LANES ; ++k) {
+                    scores [i + k] = h [k][0] ;
+                }
+            }
+        }
+        for ( ; i < count ; ++i) {
+            hash_t  h = chains_ [i] ;
+            for (size_t b = 0 ; b < cnt_blocks ; ++b) {
+                Compress (h, message (b), counter (b), 0, (b + 1 < cnt_blocks) ? 0 : ~0uLL, 0) ;
+            }
+            scores [i] = h [0] ;
+        }
+    }
+
+    size_t  RendezvousRouter::Route (const void *key, size_t size) const {
+        const size_t    count = names_.size () ;
+        if (count == 0) {
+            return NO_NODE ;
+        }
+        std::vector<uint64_t>   scores (count) ;
+        Score (key, size, scores.data ()) ;
+        if (! weighted_) {
+            return static_cast<size_t> (std::max_element (scores.cbegin (), scores.cend ()) - scores.cbegin ()) ;
+        }
+        size_t  best = 0 ;
+        double  best_score = Weigh (0, scores [0]) ;
+        for (size_t i = 1 ; i < count ; ++i) {
+            double  s = Weigh (i, scores [i]) ;
+            if (best_score < s) {
+                best = i ;
+                best_score = s ;
+            }
+        }
+        return best ;
+    }
+
+    void    RendezvousRouter::Rank (const void *key, size_t size, size_t count, size_t *result) const {
+        const size_t    n = names_.size () ;
+        count = std::min (count, n) ;
+        if (count == 0) {
+            return ;
+        }
+        std::vector<uint64_t>   scores (n) ;
+        Score (key, size, scores.data ()) ;
+        std::vector<double>     weighted (n) ;
+        for (size_t i = 0 ; i < n ; ++i) {
+            weighted [i] = weighted_ ? Weigh (i, scores [i]) : to_unit (scores [i]) ;
+        }
+        std::vector<size_t>     order (n) ;
+        std::iota (order.begin (), order.end (), 0) ;
+        std::partial_sort (order.begin (), order.begin () + count, order.end (), [&scores, &weighted](size_t a, size_t b) {
+            if (weighted [a] != weighted [b]) {
+                return weighted [b] < weighted [a] ;
+            }
+            return scores [b] < scores [a] ;
+        }) ;
+        std::copy (order.cbegin (), order.cbegin () + count, result) ;
+    }
+
+    JumpRouter::JumpRouter (uint32_t buckets, const void *key, size_t key_length)
+            : JumpRouter { buckets, Parameter ().GetParameterBlock (), key, key_length } {
+        /* NO-OP */
+    }
+
+    JumpRouter::JumpRouter (uint32_t buckets, const parameter_block_t &param, const void *key, size_t key_length)
+            : hash_ { param, key, key_length }
+            , buckets_ { 0 } {
+        SetBucketCount (buckets) ;
+    }
+
+    JumpRouter &    JumpRouter::SetBucketCount (uint32_t buckets) {
+        if (buckets == 0) {
+            throw std::invalid_argument { "JumpRouter: # of buckets should be positive" } ;
+        }
+        buckets_ = buckets ;
+        return *this ;
+    }
+
+    uint32_t    JumpRouter::Jump (uint64_t key, uint32_t buckets) {
+        int64_t     b = -1 ;
+        int64_t     j = 0 ;
+        while (j < static_cast<int64_t> (buckets)) {
+            b = j ;
+            key = key * 2862933555777941757uLL + 1 ;
+            j = static_cast<int64_t> (static_cast<double> (b + 1) * (static_cast<double> (1LL << 31) / static_cast<double> ((key >> 33) + 1))) ;
+        }
+        return static_cast<uint32_t> (b) ;
+    }
+
+    uint32_t    JumpRouter::Route (const void *data, size_t size) const {
+        hash_t  h ;
+        hash_.Apply (data, size, h) ;
+        return Jump (h [0], buckets_) ;
+    }
+
+    void    JumpRouter::Route (size_t count, const void * const *data, const size_t *size, uint32_t *result) const {
+        hash_t  hashes [JUMP_BATCH_SIZE] ;
+        for (size_t base = 0 ; base < count ; base += JUMP_BATCH_SIZE) {
+            const size_t    n = std::min (JUMP_BATCH_SIZE, count - base) ;
+            hash_.Apply (n, data + base, size + base, hashes) ;
+            for (size_t i = 0 ; i < n ; ++i) {
+                result [base + i] = Jump (hashes [i][0], buckets_) ;
+            }
+        }
+    }
+}       /* end of [namespace BLAKE2] */
+/*
+ * [END OF FILE]
+ */
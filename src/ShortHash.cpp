@@ -0,0 +1,109 @@
+/*
+ * ShortHash.cpp: Keyed 64bits hash for hash tables.
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <random>
+#include "BLAKE2/ShortHash.hpp"
+
+#ifdef HAVE_CONFIG_H
+#   include "config.h"
+#endif
+
+namespace BLAKE2 {
+
+    namespace {
+        const size_t    MAX_KEY_LENGTH = 64 ;
+        const size_t    DEFAULT_KEY_LENGTH = 16 ;
+
+        /** Process wide random key for the default constructed hashes.  */
+        const std::array<uint8_t, DEFAULT_KEY_LENGTH> &     default_key () {
+            static const std::array<uint8_t, DEFAULT_KEY_LENGTH>    key = [] {
+                std::array<uint8_t, DEFAULT_KEY_LENGTH> result ;
+                std::random_device  rd ;
+                for (size_t i = 0 ; i < result.size () ; i += 4) {
+                    uint32_t    v = rd () ;
+                    memcpy (&result [i], &v, 4) ;
+                }
+                return result ;
+            } () ;
+            return key ;
+        }
+    }
+
+    const size_t    ShortHash::DIGEST_LENGTH ;
+
+    ShortHash::ShortHash ()
+            : ShortHash { default_key ().data (), default_key ().size () } {
+        /* NO-OP */
+    }
+
+    ShortHash::ShortHash (const void *key, size_t key_length)
+            : ShortHash { Parameter ().GetParameterBlock (), key, key_length } {
+        /* NO-OP */
+    }
+
+    ShortHash::ShortHash (const parameter_block_t &param, const void *key, size_t key_length) {
+        Parameter   P { param } ;
+        P.SetDigestLength (static_cast<uint8_t> (DIGEST_LENGTH)) ;
+
+        has_key_ = key != nullptr && 0 < key_length ;
+        if (! has_key_) {
+            P.SetKeyLength (0) ;
+            InitializeChain (keyed_, P.GetParameterBlock ()) ;
+
+            uint8_t     block [BLOCK_SIZE] = { 0 } ;
+            hash_t      h = keyed_ ;
+            Compress (h, block, 0, 0, ~0uLL, 0) ;
+            empty_ = h [0] ;
+            return ;
+        }
+        auto k_len = std::min (key_length, MAX_KEY_LENGTH) ;
+        P.SetKeyLength (static_cast<uint8_t> (k_len)) ;
+        InitializeChain (keyed_, P.GetParameterBlock ()) ;
+
+        uint8_t     block [BLOCK_SIZE] = { 0 } ;
+        memcpy (block, key, k_len) ;
+        hash_t      h = keyed_ ;
+        // The key block is the last one for the empty message.
+        Compress (h, block, BLOCK_SIZE, 0, ~0uLL, 0) ;
+        empty_ = h [0] ;
+        Compress (keyed_, block, BLOCK_SIZE, 0, 0, 0) ;
+        memset (block, 0, sizeof (block)) ;
+    }
+
+    uint64_t    ShortHash::Apply (const void *data, size_t size) const {
+        if (size == 0) {
+            return empty_ ;
+        }
+        auto const *    p = static_cast<const uint8_t *> (data) ;
+        hash_t      h = keyed_ ;
+        uint64_t    t0 = has_key_ ? BLOCK_SIZE : 0 ;
+        uint64_t    t1 = 0 ;
+
+        while (BLOCK_SIZE < size) {
+            t0 += BLOCK_SIZE ;
+            t1 += (t0 < BLOCK_SIZE) ? 1 : 0 ;
+            Compress (h, p, t0, t1, 0, 0) ;
+            p += BLOCK_SIZE ;
+            size -= BLOCK_SIZE ;
+        }
+        t0 += size ;
+        t1 += (t0 < size) ? 1 : 0 ;
+        if (size == BLOCK_SIZE) {
+            Compress (h, p, t0, t1, ~0uLL, 0) ;
+        }
+        else {
+            uint8_t     block [BLOCK_SIZE] = { 0 } ;
+            memcpy (block, p, size) ;
+            Compress (h, block, t0, t1, ~0uLL, 0) ;
+        }
+        return h [0] ;
+    }
+}       /* end of [namespace BLAKE2] */
+/*
+ * [END OF FILE]
+ */
@@ -0,0 +1,168 @@
+/*
+ * Stream.cpp: std::streambuf adapters hashing the data passing through them.
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#include <cstring>
+#include "BLAKE2/Stream.hpp"
+
+#ifdef HAVE_CONFIG_H
+#   include "config.h"
+#endif
+
+namespace BLAKE2 {
+
+    HashOutputBuffer::HashOutputBuffer ( std::streambuf *sink
+                                       , const parameter_block_t &param
+                                       , const void *key, size_t key_len
+                                       , size_t buffer_size)
+            : gen_ { param, key, key_len }
+            , sink_ { sink }
+            , buffer_ (buffer_size == 0 ? DEFAULT_STREAM_BUFFER_SIZE : buffer_size)
+            , finalized_ { false } {
+        setp (buffer_.data (), buffer_.data () + buffer_.size ()) ;
+    }
+
+    HashOutputBuffer::~HashOutputBuffer () {
+        if (! finalized_) {
+            Flush () ;
+        }
+    }
+
+    Digest  HashOutputBuffer::Finalize () {
+        sync () ;
+        finalized_ = true ;
+        setp (nullptr, nullptr) ;
+        return gen_.Finalize () ;
+    }
+
+    HashOutputBuffer::int_type  HashOutputBuffer::overflow (int_type ch) {
+        if (finalized_ || ! Flush ()) {
+            return traits_type::eof () ;
+        }
+        if (! traits_type::eq_int_type (ch, traits_type::eof ())) {
+            *pptr () = traits_type::to_char_type (ch) ;
+            pbump (1) ;
+        }
+        return traits_type::not_eof (ch) ;
+    }
+
+    int     HashOutputBuffer::sync () {
+        if (finalized_ || ! Flush ()) {
+            return -1 ;
+        }
+        return (sink_ == nullptr || sink_->pubsync () == 0) ? 0 : -1 ;
+    }
+
+    std::streamsize     HashOutputBuffer::xsputn (const char *s, std::streamsize n) {
+        if (finalized_) {
+            return 0 ;
+        }
+        if (n <= epptr () - pptr ()) {
+            memcpy (pptr (), s, static_cast<size_t> (n)) ;
+            pbump (static_cast<int> (n)) ;
+            return n ;
+        }
+        if (! Flush ()) {
+            return 0 ;
+        }
+        if (static_cast<size_t> (n) < buffer_.size ()) {
+            memcpy (pptr (), s, static_cast<size_t> (n)) ;
+            pbump (static_cast<int> (n)) ;
+            return n ;
+        }
+        return Forward (s, n) ;
+    }
+
+    bool    HashOutputBuffer::Flush () {
+        const std::streamsize   n = pptr () - pbase () ;
+        if (n == 0) {
+            return true ;
+        }
+        const std::streamsize   done = Forward (pbase (), n) ;
+        if (done != n) {
+            // Keeps the rejected tail for the next attempt.
+            memmove (pbase (), pbase () + done, static_cast<size_t> (n - done)) ;
+            setp (buffer_.data (), buffer_.data () + buffer_.size ()) ;
+            pbump (static_cast<int> (n - done)) ;
+            return false ;
+        }
+        setp (buffer_.data (), buffer_.data () + buffer_.size ()) ;
+        return true ;
+    }
+
+    std::streamsize     HashOutputBuffer::Forward (const char *data, std::streamsize size) {
+        const std::streamsize   done = (sink_ == nullptr) ? size : sink_->sputn (data, size) ;
+        gen_.Update (data, static_cast<size_t> (done)) ;
+        return done ;
+    }
+
+    HashInputBuffer::HashInputBuffer ( std::streambuf *source
+                                     , const parameter_block_t &param
+                                     , const void *key, size_t key_len
+                                     , size_t buffer_size)
+            : gen_ { param, key, key_len }
+            , source_ { source }
+            , buffer_ (buffer_size == 0 ? DEFAULT_STREAM_BUFFER_SIZE : buffer_size) {
+        setg (buffer_.data (), buffer_.data (), buffer_.data ()) ;
+    }
+
+    Digest  HashInputBuffer::Finalize () {
+        Consume () ;
+        source_ = nullptr ;
+        return gen_.Finalize () ;
+    }
+
+    HashInputBuffer::int_type   HashInputBuffer::underflow () {
+        if (gptr () < egptr ()) {
+            return traits_type::to_int_type (*gptr ()) ;
+        }
+        Consume () ;
+        if (source_ == nullptr) {
+            return traits_type::eof () ;
+        }
+        const std::streamsize   n = source_->sgetn (buffer_.data (), static_cast<std::streamsize> (buffer_.size ())) ;
+        if (n <= 0) {
+            return traits_type::eof () ;
+        }
+        setg (buffer_.data (), buffer_.data (), buffer_.data () + n) ;
+        return traits_type::to_int_type (*gptr ()) ;
+    }
+
+    std::streamsize     HashInputBuffer::xsgetn (char *s, std::streamsize n) {
+        std::streamsize     done = 0 ;
+        while (done < n) {
+            const std::streamsize   avail = egptr () - gptr () ;
+            if (0 < avail) {
+                const std::streamsize   k = (n - done < avail) ? n - done : avail ;
+                memcpy (s + done, gptr (), static_cast<size_t> (k)) ;
+                gbump (static_cast<int> (k)) ;
+                done += k ;
+                continue ;
+            }
+            if (source_ != nullptr && static_cast<size_t> (n - done) >= buffer_.size ()) {
+                // Straight to the caller, hashed in place.
+                Consume () ;
+                const std::streamsize   k = source_->sgetn (s + done, n - done) ;
+                if (k <= 0) {
+                    break ;
+                }
+                gen_.Update (s + done, static_cast<size_t> (k)) ;
+                done += k ;
+                continue ;
+            }
+            if (traits_type::eq_int_type (underflow (), traits_type::eof ())) {
+                break ;
+            }
+        }
+        return done ;
+    }
+
+    void    HashInputBuffer::Consume () {
+        gen_.Update (eback (), static_cast<size_t> (gptr () - eback ())) ;
+        setg (buffer_.data (), buffer_.data (), buffer_.data ()) ;
+    }
+}       /* end of [namespace BLAKE2] */
+/*
+ * [END OF FILE]
+ */
@@ -0,0 +1,104 @@
+/*
+ * Support.h: Byte order, error and executor helpers shared by the modules.
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#pragma once
+#ifndef support_h__5c2e8a7f1b3d4e69a0f4b8d2c6e1a937
+#define support_h__5c2e8a7f1b3d4e69a0f4b8d2c6e1a937    1
+
+#include <cerrno>
+#include <string>
+#include <system_error>
+#include "BLAKE2.hpp"
+#include "BLAKE2/ThreadPool.hpp"
+
+namespace BLAKE2 {
+
+    inline uint32_t     load32le (const void *src) {
+        auto const *    p = static_cast<const uint8_t *> (src) ;
+        return ( (static_cast<uint32_t> (p [0]) <<  0)
+               | (static_cast<uint32_t> (p [1]) <<  8)
+               | (static_cast<uint32_t> (p [2]) << 16)
+               | (static_cast<uint32_t> (p [3]) << 24)) ;
+    }
+
+    inline void     store32le (void *dst, uint32_t value) {
+        auto *  p = static_cast<uint8_t *> (dst) ;
+        for (size_t i = 0 ; i < 4 ; ++i) {
+            p [i] = static_cast<uint8_t> (value >> (8 * i)) ;
+        }
+    }
+
+    inline uint64_t     load64le (const void *src) {
+        auto const *    p = static_cast<const uint8_t *> (src) ;
+        uint64_t    result = 0 ;
+        for (size_t i = 8 ; 0 < i ; --i) {
+            result = (result << 8) | p [i - 1] ;
+        }
+        return result ;
+    }
+
+    inline void     store64le (void *dst, uint64_t value) {
+        auto *  p = static_cast<uint8_t *> (dst) ;
+        for (size_t i = 0 ; i < 8 ; ++i) {
+            p [i] = static_cast<uint8_t> (value >> (8 * i)) ;
+        }
+    }
+
+    inline uint64_t     load64be (const void *src) {
+        auto const *    p = static_cast<const uint8_t *> (src) ;
+        uint64_t    result = 0 ;
+        for (size_t i = 0 ; i < 8 ; ++i) {
+            result = (result << 8) | p [i] ;
+        }
+        return result ;
+    }
+
+    inline void     store64be (void *dst, uint64_t value) {
+        auto *  p = static_cast<uint8_t *> (dst) ;
+        for (size_t i = 0 ; i < 8 ; ++i) {
+            p [i] = static_cast<uint8_t> (value >> (56 - 8 * i)) ;
+        }
+    }
+
+    /** A digest stored as 8 little-endian words.  */
+    inline Digest   load_digest (const void *src) {
+        auto const *    p = static_cast<const uint8_t *> (src) ;
+        return Digest { load64le (p +  0), load64le (p +  8), load64le (p + 16), load64le (p + 24)
+                      , load64le (p + 32), load64le (p + 40), load64le (p + 48), load64le (p + 56) } ;
+    }
+
+    /** # of bits needed to represent X (0 for 0).  */
+    inline uint32_t     bit_length (uint64_t x) {
+        uint32_t    result = 0 ;
+        for ( ; x != 0 ; x >>= 1) {
+            ++result ;
+        }
+        return result ;
+    }
+
+    [[noreturn]] inline void    raise_errno (const std::string &what) {
+        throw std::system_error { errno, std::generic_category (), what } ;
+    }
+
+    /**
+     * EXECUTOR if given, otherwise the calling thread for small works (IS_SMALL)
+     * and DefaultExecutor () for the others.
+     */
+    inline Executor &   select_executor (Executor *executor, bool is_small) {
+        static SequentialExecutor   sequential ;
+        if (executor != nullptr) {
+            return *executor ;
+        }
+        if (is_small) {
+            return sequential ;
+        }
+        return DefaultExecutor () ;
+    }
+}
+
+#endif  /* support_h__5c2e8a7f1b3d4e69a0f4b8d2c6e1a937 */
+/*
+ * [END OF FILE]
+ */
@@ -0,0 +1,265 @@
+/*
+ * Telemetry.cpp: Per-thread counters of the hashing entry points.
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#include <mutex>
+#include <vector>
+#include "Telemetry.h"
+#include "MultiBuffer.h"
+
+#ifdef HAVE_CONFIG_H
+#   include "config.h"
+#endif
+
+namespace BLAKE2 {
+
+    std::atomic<bool>   telemetry_enabled { false } ;
+
+    namespace {
+        const char * const  ENTRY_POINT_NAMES [Telemetry::ENTRY_POINT_COUNT] = { "apply", "generator", "batch" } ;
+
+        /** Written by the owner thread only (load + store, no RMW), read by the snapshots.  */
+        struct Slot {
+            std::atomic<uint64_t>   calls ;
+            std::atomic<uint64_t>   bytes ;
+            std::atomic<uint64_t>   blocks ;
+            std::atomic<uint64_t>   finalizations ;
+            std::atomic<uint64_t>   sizes [Telemetry::HISTOGRAM_BINS] ;
+        } ;
+
+        struct ThreadCounters {
+            Slot    slots [Telemetry::ENTRY_POINT_COUNT] ;
+
+            ThreadCounters () {
+                for (auto &S : slots) {
+                    S.calls = 0 ;
+                    S.bytes = 0 ;
+                    S.blocks = 0 ;
+                    S.finalizations = 0 ;
+                    for (auto &v : S.sizes) {
+                        v = 0 ;
+                    }
+                }
+            }
+        } ;
+
+        inline void add (std::atomic<uint64_t> &counter, uint64_t value) {
+            counter.store (counter.load (std::memory_order_relaxed) + value, std::memory_order_relaxed) ;
+        }
+
+        Telemetry::Snapshot     make_empty () {
+            Telemetry::Snapshot result ;
+            for (auto &C : result.entries) {
+                C.calls = C.bytes = C.blocks = C.finalizations = 0 ;
+                C.sizes.fill (0) ;
+            }
+            return result ;
+        }
+
+        void    accumulate (Telemetry::Snapshot &result, const ThreadCounters &T) {
+            for (size_t i = 0 ; i < Telemetry::ENTRY_POINT_COUNT ; ++i) {
+                auto const &    S = T.slots [i] ;
+                auto &          C = result.entries [i] ;
+                C.calls += S.calls.load (std::memory_order_relaxed) ;
+                C.bytes += S.bytes.load (std::memory_order_relaxed) ;
+                C.blocks += S.blocks.load (std::memory_order_relaxed) ;
+                C.finalizations += S.finalizations.load (std::memory_order_relaxed) ;
+                for (size_t k = 0 ; k < Telemetry::HISTOGRAM_BINS ; ++k) {
+                    C.sizes [k] += S.sizes [k].load (std::memory_order_relaxed) ;
+                }
+            }
+        }
+
+        /**
+         * Counters of the live threads, the exited ones are folded into `retired_`.
+         * `Reset` records a baseline instead of clearing, so the owners never race with it.
+         */
+        class Registry {
+        private:
+            std::mutex                      lock_ ;
+            std::vector<ThreadCounters *>   live_ ;
+            Telemetry::Snapshot             retired_ ;
+            Telemetry::Snapshot             baseline_ ;
+        public:
+            Registry () : retired_ (make_empty ()), baseline_ (make_empty ()) {
+                /* NO-OP */
+            }
+
+            void    Register (ThreadCounters *T) {
+                std::lock_guard<std::mutex>     L { lock_ } ;
+                live_.push_back (T) ;
+            }
+
+            void    Unregister (ThreadCounters *T) {
+                std::lock_guard<std::mutex>     L { lock_ } ;
+                accumulate (retired_, *T) ;
+                for (size_t i = 0 ; i < live_.size () ; ++i) {
+                    if (live_ [i] == T) {
+                        live_ [i] = live_.back () ;
+                        live_.pop_back () ;
+                        break ;
+                    }
+                }
+            }
+
+            Telemetry::Snapshot     Collect () {
+                std::lock_guard<std::mutex>     L { lock_ } ;
+                auto    result = CollectTotal () ;
+                for (size_t i = 0 ; i < Telemetry::ENTRY_POINT_COUNT ; ++i) {
+                    auto &          C = result.entries [i] ;
+                    auto const &    B = baseline_.entries [i] ;
+                    C.calls -= B.calls ;
+                    C.bytes -= B.bytes ;
+                    C.blocks -= B.blocks ;
+                    C.finalizations -= B.finalizations ;
+                    for (size_t k = 0 ; k < Telemetry::HISTOGRAM_BINS ; ++k) {
+                        C.sizes [k] -= B.sizes [k] ;
+                    }
+                }
+                return result ;
+            }
+
+            void    Reset () {
+                std::lock_guard<std::mutex>     L { lock_ } ;
+                baseline_ = CollectTotal () ;
+            }
+        private:
+            Telemetry::Snapshot     CollectTotal () const {
+                auto    result = retired_ ;
+                for (auto const *T : live_) {
+                    accumulate (result, *T) ;
+                }
+                return result ;
+            }
+        } ;
+
+        Registry &  registry () {
+            // Never destroyed: threads may exit after the static destructors.
+            static Registry *   instance = new Registry {} ;
+            return *instance ;
+        }
+
+        struct Owner {
+            ThreadCounters  counters ;
+
+            Owner () {
+                registry ().Register (&counters) ;
+            }
+
+            ~Owner () {
+                registry ().Unregister (&counters) ;
+            }
+        } ;
+
+        Slot &  local_slot (Telemetry::EntryPoint ep) {
+            thread_local Owner  owner ;
+            return owner.counters.slots [static_cast<size_t> (ep)] ;
+        }
+
+        size_t  size_bin (uint64_t size) {
+            size_t  bin = 0 ;
+            while (size != 0) {
+                ++bin ;
+                size >>= 1 ;
+            }
+            return bin ;
+        }
+
+        void    append_json (std::string &out, const char *name, uint64_t value) {
+            out += "\"" ;
+            out += name ;
+            out += "\": " ;
+            out += std::to_string (value) ;
+        }
+    }
+
+    const size_t    Telemetry::ENTRY_POINT_COUNT ;
+    const size_t    Telemetry::HISTOGRAM_BINS ;
+
+    void    telemetry_record ( Telemetry::EntryPoint ep
+                             , uint64_t calls, uint64_t bytes, uint64_t blocks, uint64_t finalizations) {
+        Slot &  S = local_slot (ep) ;
+        add (S.calls, calls) ;
+        add (S.bytes, bytes) ;
+        add (S.blocks, blocks) ;
+        add (S.finalizations, finalizations) ;
+    }
+
+    void    telemetry_record_size (Telemetry::EntryPoint ep, uint64_t size) {
+        add (local_slot (ep).sizes [size_bin (size)], 1) ;
+    }
+
+    bool    Telemetry::IsAvailable () {
+#ifdef ENABLE_TELEMETRY
+        return true ;
+#else
+        return false ;
+#endif
+    }
+
+    bool    Telemetry::IsEnabled () {
+        return telemetry_enabled.load (std::memory_order_relaxed) ;
+    }
+
+    void    Telemetry::SetEnabled (bool enable) {
+        telemetry_enabled.store (enable && IsAvailable (), std::memory_order_relaxed) ;
+    }
+
+    Telemetry::Snapshot     Telemetry::GetSnapshot () {
+        return registry ().Collect () ;
+    }
+
+    void    Telemetry::Reset () {
+        registry ().Reset () ;
+    }
+
+    const char *    Telemetry::GetEntryPointName (EntryPoint ep) {
+        return ENTRY_POINT_NAMES [static_cast<size_t> (ep)] ;
+    }
+
+    const char *    Telemetry::GetKernelName () {
+        return compress_kernel_name () ;
+    }
+
+    const char *    Telemetry::GetBatchKernelName () {
+        return multibuffer_is_vectorized () ? "avx2x4" : "scalar" ;
+    }
+
+    std::string     Telemetry::ToJSON (const Snapshot &snapshot) {
+        std::string     out ;
+        out += "{ \"kernel\": \"" ;
+        out += GetKernelName () ;
+        out += "\", \"batch_kernel\": \"" ;
+        out += GetBatchKernelName () ;
+        out += "\"" ;
+        for (size_t i = 0 ; i < ENTRY_POINT_COUNT ; ++i) {
+            auto const &    C = snapshot.entries [i] ;
+            out += ", \"" ;
+            out += ENTRY_POINT_NAMES [i] ;
+            out += "\": { " ;
+            append_json (out, "calls", C.calls) ;
+            out += ", " ;
+            append_json (out, "bytes", C.bytes) ;
+            out += ", " ;
+            append_json (out, "blocks", C.blocks) ;
+            out += ", " ;
+            append_json (out, "finalizations", C.finalizations) ;
+            out += ", \"sizes\": [" ;
+            size_t  used = HISTOGRAM_BINS ;
+            while (0 < used && C.sizes [used - 1] == 0) {
+                --used ;
+            }
+            for (size_t k = 0 ; k < used ; ++k) {
+                out += (k == 0) ? " " : ", " ;
+                out += std::to_string (C.sizes [k]) ;
+            }
+            out += (0 < used) ? " ] }" : "] }" ;
+        }
+        out += " }" ;
+        return out ;
+    }
+}       /* end of [namespace BLAKE2] */
+/*
+ * [END OF FILE]
+ */
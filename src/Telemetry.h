@@ -0,0 +1,45 @@
+/*
+ * Telemetry.h: Recording hooks of the hashing telemetry.
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#pragma once
+#ifndef telemetry_h__2f7b9d4e6a1c4d8b8e3f5a0c9b7d2e61
+#define telemetry_h__2f7b9d4e6a1c4d8b8e3f5a0c9b7d2e61    1
+
+#include <atomic>
+#include "BLAKE2/Telemetry.hpp"
+
+#ifdef HAVE_CONFIG_H
+#   include "config.h"
+#endif
+
+namespace BLAKE2 {
+
+    extern std::atomic<bool>    telemetry_enabled ;
+
+    /** Adds to the slots of the calling thread.  */
+    void    telemetry_record ( Telemetry::EntryPoint ep
+                             , uint64_t calls, uint64_t bytes, uint64_t blocks, uint64_t finalizations) ;
+
+    /** Counts a message of SIZE bytes in the histogram.  */
+    void    telemetry_record_size (Telemetry::EntryPoint ep, uint64_t size) ;
+
+    /** Name of the `Compress` kernel (defined next to the kernels).  */
+    const char *    compress_kernel_name () ;
+}
+
+#ifdef ENABLE_TELEMETRY
+#   define TELEMETRY(X_)    do {                                                        \
+        if (BLAKE2::telemetry_enabled.load (std::memory_order_relaxed)) {               \
+            X_ ;                                                                        \
+        }                                                                               \
+    } while (0)
+#else
+#   define TELEMETRY(X_)    do { /* NO-OP */ } while (0)
+#endif
+
+#endif  /* telemetry_h__2f7b9d4e6a1c4d8b8e3f5a0c9b7d2e61 */
+/*
+ * [END OF FILE]
+ */
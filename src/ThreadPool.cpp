@@ -0,0 +1,322 @@
+/*
+ * ThreadPool.cpp: Executors for the parallel hashing modes.
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include "BLAKE2/ThreadPool.hpp"
+
+#ifdef HAVE_CONFIG_H
+#   include "config.h"
+#endif
+
+#if defined (__linux__)
+#   include <pthread.h>
+#   include <sched.h>
+#endif
+
+namespace BLAKE2 {
+
+    namespace {
+        /**
+         * Jobs submitted by a single `Run` call.
+         */
+        struct Batch {
+            const Executor::job_t * job ;
+            size_t                  remain ;    // Guarded by mutex.
+            std::exception_ptr      error ;     // Guarded by mutex.
+            std::mutex              mutex ;
+            std::condition_variable done ;
+
+            Batch (const Executor::job_t &j, size_t count) : job { &j }, remain { count } {
+                /* NO-OP */
+            }
+
+            void    Execute (size_t idx) {
+                try {
+                    (*job) (idx) ;
+                }
+                catch (...) {
+                    std::lock_guard<std::mutex>     lock { mutex } ;
+                    if (! error) {
+                        error = std::current_exception () ;
+                    }
+                }
+            }
+
+            void    Complete (size_t count) {
+                std::lock_guard<std::mutex>     lock { mutex } ;
+                remain -= count ;
+                if (remain == 0) {
+                    done.notify_all () ;
+                }
+            }
+
+            bool    IsCompleted () {
+                std::lock_guard<std::mutex>     lock { mutex } ;
+                return remain == 0 ;
+            }
+        } ;
+
+        /**
+         * Job range [begin, end) of a batch.
+         */
+        struct Task {
+            Batch * batch ;
+            size_t  begin ;
+            size_t  end ;
+        } ;
+
+        struct WorkQueue {
+            std::mutex          mutex ;
+            std::deque<Task>    tasks ;
+        } ;
+    }
+
+    struct ThreadPool::Impl {
+        std::vector<std::unique_ptr<WorkQueue>> queues ;    // queues [nworkers] is shared by external threads.
+        std::vector<std::thread>    threads ;
+        std::vector<int>            affinity ;
+        std::atomic<size_t>         pending { 0 } ;         // # of queued tasks.
+        std::mutex                  mutex ;
+        std::condition_variable     wakeup ;
+        bool                        stop = false ;          // Guarded by mutex.
+
+        Impl (size_t thread_count, const std::vector<int> &cpus) ;
+
+        ~Impl () ;
+
+        size_t  GetWorkerCount () const {
+            return threads.size () ;
+        }
+
+        size_t  GetQueueIndex () const ;
+
+        void    Push (size_t q, const Task &task) ;
+
+        bool    Pop (size_t q, Task &task) ;
+
+        bool    Steal (size_t thief, Task &task) ;
+
+        void    Execute (size_t q, Task task) ;
+
+        void    WorkerMain (size_t idx) ;
+    } ;
+
+    namespace {
+        /** The pool and worker index of the current thread.  */
+        thread_local const void *  current_pool = nullptr ;
+        thread_local size_t        current_worker = 0 ;
+
+        void    pin_current_thread (int cpu) {
+#if defined (__linux__)
+            cpu_set_t   cpus ;
+            CPU_ZERO (&cpus) ;
+            CPU_SET (cpu, &cpus) ;
+            pthread_setaffinity_np (pthread_self (), sizeof (cpus), &cpus) ;
+#else
+            (void)cpu ;
+#endif
+        }
+    }
+
+    ThreadPool::Impl::Impl (size_t thread_count, const std::vector<int> &cpus) : affinity { cpus } {
+        if (thread_count == 0) {
+            thread_count = std::max<size_t> (1, std::thread::hardware_concurrency ()) ;
+        }
+        for (size_t i = 0 ; i <= thread_count ; ++i) {
+            queues.emplace_back (std::make_unique<WorkQueue> ()) ;
+        }
+        threads.reserve (thread_count) ;
+        for (size_t i = 0 ; i < thread_count ; ++i) {
+            threads.emplace_back ([this, i] { WorkerMain (i) ; }) ;
+        }
+    }
+
+    ThreadPool::Impl::~Impl () {
+        {
+            std::lock_guard<std::mutex>     lock { mutex } ;
+            stop = true ;
+        }
+        wakeup.notify_all () ;
+        for (auto &t : threads) {
+            t.join () ;
+        }
+    }
+
+    size_t  ThreadPool::Impl::GetQueueIndex () const {
+        if (current_pool == this) {
+            return current_worker ;
+        }
+        return GetWorkerCount () ;
+    }
+
+    void    ThreadPool::Impl::Push (size_t q, const Task &task) {
+        {
+            std::lock_guard<std::mutex>     lock { queues [q]->mutex } ;
+            queues [q]->tasks.push_back (task) ;
+        }
+        pending.fetch_add (1) ;
+        {
+            // Pairs with the predicate check in WorkerMain, so that no wakeup is lost.
+            std::lock_guard<std::mutex>     lock { mutex } ;
+        }
+        wakeup.notify_one () ;
+    }
+
+    bool    ThreadPool::Impl::Pop (size_t q, Task &task) {
+        std::lock_guard<std::mutex>     lock { queues [q]->mutex } ;
+        auto &  tasks = queues [q]->tasks ;
+        if (tasks.empty ()) {
+            return false ;
+        }
+        task = tasks.back () ;
+        tasks.pop_back () ;
+        pending.fetch_sub (1) ;
+        return true ;
+    }
+
+    bool    ThreadPool::Impl::Steal (size_t thief, Task &task) {
+        const size_t    cnt = queues.size () ;
+        for (size_t i = 1 ; i < cnt ; ++i) {
+            auto &  victim = *queues [(thief + i) % cnt] ;
+            std::lock_guard<std::mutex>     lock { victim.mutex } ;
+            if (! victim.tasks.empty ()) {
+                task = victim.tasks.front () ;
+                victim.tasks.pop_front () ;
+                pending.fetch_sub (1) ;
+                return true ;
+            }
+        }
+        return false ;
+    }
+
+    void    ThreadPool::Impl::Execute (size_t q, Task task) {
+        // Keep the lower half and publish the upper half for thieves.
+        while (1 < task.end - task.begin) {
+            size_t  mid = task.begin + (task.end - task.begin) / 2 ;
+            Push (q, Task { task.batch, mid, task.end }) ;
+            task.end = mid ;
+        }
+        task.batch->Execute (task.begin) ;
+        task.batch->Complete (1) ;
+    }
+
+    void    ThreadPool::Impl::WorkerMain (size_t idx) {
+        current_pool = this ;
+        current_worker = idx ;
+        if (! affinity.empty ()) {
+            pin_current_thread (affinity [idx % affinity.size ()]) ;
+        }
+        while (true) {
+            Task    task ;
+            if (Pop (idx, task) || Steal (idx, task)) {
+                Execute (idx, task) ;
+                continue ;
+            }
+            std::unique_lock<std::mutex>    lock { mutex } ;
+            wakeup.wait (lock, [this] { return stop || 0 < pending.load () ; }) ;
+            if (stop && pending.load () == 0) {
+                break ;
+            }
+        }
+    }
+
+    ThreadPool::ThreadPool (size_t thread_count) : ThreadPool { thread_count, std::vector<int> {} } {
+        /* NO-OP */
+    }
+
+    ThreadPool::ThreadPool (size_t thread_count, const std::vector<int> &affinity)
+            : impl_ { std::make_unique<Impl> (thread_count, affinity) } {
+        /* NO-OP */
+    }
+
+    ThreadPool::~ThreadPool () = default ;
+
+    size_t  ThreadPool::GetConcurrency () const {
+        return impl_->GetWorkerCount () ;
+    }
+
+    void    ThreadPool::Run (size_t count, const job_t &job) {
+        if (count == 0) {
+            return ;
+        }
+        Batch   batch { job, count } ;
+        auto &  I = *impl_ ;
+        size_t  self = I.GetQueueIndex () ;
+        {
+            // Seed every queue with a slice, stealing balances the rest.
+            size_t  nparts = std::min (count, I.queues.size ()) ;
+            for (size_t i = 0 ; i < nparts ; ++i) {
+                size_t  q = (self + i) % I.queues.size () ;
+                I.Push (q, Task { &batch, count * i / nparts, count * (i + 1) / nparts }) ;
+            }
+        }
+        while (! batch.IsCompleted ()) {
+            Task    task ;
+            if (I.Pop (self, task) || I.Steal (self, task)) {
+                I.Execute (self, task) ;
+                continue ;
+            }
+            std::unique_lock<std::mutex>    lock { batch.mutex } ;
+            batch.done.wait (lock, [&batch] { return batch.remain == 0 ; }) ;
+        }
+        std::lock_guard<std::mutex>     lock { batch.mutex } ;
+        if (batch.error) {
+            std::rethrow_exception (batch.error) ;
+        }
+    }
+
+    void    FunctionExecutor::Run (size_t count, const job_t &job) {
+        if (count == 0) {
+            return ;
+        }
+        struct State {
+            std::atomic<size_t>     next { 0 } ;
+            size_t                  count ;
+            const job_t *           job ;
+            Batch                   batch ;
+
+            State (const job_t &j, size_t cnt) : count { cnt }, job { &j }, batch { j, cnt } {
+                /* NO-OP */
+            }
+
+            void    Drain () {
+                while (true) {
+                    size_t  idx = next.fetch_add (1) ;
+                    if (count <= idx) {
+                        break ;
+                    }
+                    batch.Execute (idx) ;
+                    batch.Complete (1) ;
+                }
+            }
+        } ;
+        // Helpers may start after the batch is completed, they must not see a dangling state.
+        auto    state = std::make_shared<State> (job, count) ;
+        size_t  helpers = std::min (count, concurrency_) - 1 ;
+        for (size_t i = 0 ; i < helpers ; ++i) {
+            submit_ ([state] { state->Drain () ; }) ;
+        }
+        state->Drain () ;
+        std::unique_lock<std::mutex>    lock { state->batch.mutex } ;
+        state->batch.done.wait (lock, [&state] { return state->batch.remain == 0 ; }) ;
+        if (state->batch.error) {
+            std::rethrow_exception (state->batch.error) ;
+        }
+    }
+
+    Executor &  DefaultExecutor () {
+        static ThreadPool   pool ;
+        return pool ;
+    }
+}       /* end of [namespace BLAKE2] */
+/*
+ * [END OF FILE]
+ */
@@ -0,0 +1,66 @@
+/*
+ * Tree.h: Node hashing shared by the tree hashing modes.
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#pragma once
+#ifndef tree_h__8d3f6b1a9c2e4f7a8b5d0e6c3a9f1b24
+#define tree_h__8d3f6b1a9c2e4f7a8b5d0e6c3a9f1b24    1
+
+#include <functional>
+#include <vector>
+#include "BLAKE2.hpp"
+
+namespace BLAKE2 {
+
+    /** Runs NODE (0) ... NODE (COUNT - 1), every node hashing about NODE_LENGTH bytes.  */
+    using tree_level_runner_t = std::function<void (size_t count, size_t node_length, const std::function<void (size_t)> &node)> ;
+
+    /** PARAM with the key length and the defaults of `ApplyTree` applied.  */
+    Parameter   tree_parameter (const parameter_block_t &param, size_t key_length) ;
+
+    Digest  hash_tree_node ( const Parameter &base
+                           , uint8_t node_depth, uint64_t node_offset, bool is_last
+                           , const void *key, size_t key_length
+                           , const void *data, size_t data_length) ;
+
+    /**
+     * Hashes the levels above the leaves up to the root.
+     *
+     * @param P Tree parameters (from `tree_parameter`)
+     * @param level Inner length bytes per leaf digest (destroyed)
+     * @param count # of leaves
+     * @param run Runs the nodes of a level
+     */
+    Digest  combine_tree_levels (const Parameter &P, std::vector<uint8_t> &level, size_t count, const tree_level_runner_t &run) ;
+
+    /**
+     * Hashes the nodes of a binary tree (fanout 2, unlimited depth, full length digests),
+     * an inner node being a single block of its two children.
+     */
+    class BinaryNodeHasher {
+    private:
+        Parameter   base_ ;
+    public:
+        BinaryNodeHasher (const parameter_block_t &param, uint32_t leaf_length) ;
+
+        const parameter_block_t &   GetParameterBlock () const {
+            return base_.GetParameterBlock () ;
+        }
+
+        /** Parameter of the node at DEPTH and OFFSET.  */
+        parameter_block_t   NodeParameter (uint32_t depth, uint64_t offset) const ;
+
+        Digest  Leaf (uint64_t offset, const void *data, size_t size, bool is_last = false) const ;
+
+        /** Hashes CHILDREN (the left and the right digests, a block).  */
+        Digest  Inner (uint32_t depth, uint64_t offset, const uint8_t *children, bool is_last = false) const ;
+
+        Digest  Inner (uint32_t depth, uint64_t offset, const Digest &left, const Digest &right) const ;
+    } ;
+}
+
+#endif  /* tree_h__8d3f6b1a9c2e4f7a8b5d0e6c3a9f1b24 */
+/*
+ * [END OF FILE]
+ */
@@ -0,0 +1,296 @@
+/*
+ * VerifiedStream.cpp: Encoding verified while streaming (chaining values interleaved with the data).
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#include <algorithm>
+#include <cstring>
+#include "BLAKE2/VerifiedStream.hpp"
+#include "BLAKE2/Batch.hpp"
+#include "Support.h"
+#include "Tree.h"
+
+#ifdef HAVE_CONFIG_H
+#   include "config.h"
+#endif
+
+namespace BLAKE2 {
+
+    namespace {
+        const size_t    CHUNK_SIZE = VerifiedStream::CHUNK_SIZE ;
+        const size_t    PARENT_SIZE = VerifiedStream::PARENT_SIZE ;
+        const size_t    CV_SIZE = Digest::SIZE ;
+        const uint32_t  LEAF_LENGTH = static_cast<uint32_t> (CHUNK_SIZE) ;
+        const size_t    HASH_BATCH_SIZE = 256 ;         // # of chunks hashed at once.
+
+        uint64_t    count_chunks (uint64_t length) {
+            return (length == 0) ? 1 : (length + CHUNK_SIZE - 1) / CHUNK_SIZE ;
+        }
+
+        /** Height of a subtree of LENGTH bytes.  */
+        uint32_t    height_of (uint64_t length) {
+            return bit_length (count_chunks (length) - 1) ;
+        }
+
+        /** Content length of the left subtree (LENGTH > CHUNK_SIZE).  */
+        uint64_t    left_length (uint64_t length) {
+            return (1uLL << (height_of (length) - 1)) * CHUNK_SIZE ;
+        }
+
+        /** # of bytes of the encoded subtree of LENGTH bytes.  */
+        uint64_t    subtree_length (uint64_t length) {
+            return length + PARENT_SIZE * (count_chunks (length) - 1) ;
+        }
+
+        /** The byte range [BEGIN, END) kept by a slice (at least a byte of a chunk).  */
+        void    slice_range (uint64_t content_length, uint64_t offset, uint64_t length, uint64_t &begin, uint64_t &end) {
+            const uint64_t  last = (count_chunks (content_length) - 1) * CHUNK_SIZE ;
+            const uint64_t  limit = (length < ~offset) ? offset + length : ~0uLL ;
+            begin = std::min (offset, last) ;
+            end = std::max (begin + 1, std::min (limit, content_length)) ;
+        }
+
+        bool    overlaps (uint64_t begin, uint64_t length, uint64_t range_begin, uint64_t range_end) {
+            return begin < range_end && range_begin < begin + length ;
+        }
+
+        /** Parent of the subtree of LENGTH bytes at BEGIN.  */
+        Digest  hash_parent (const BinaryNodeHasher &H, uint64_t begin, uint64_t length, const uint8_t *children, bool is_root) {
+            const uint32_t  height = height_of (length) ;
+            return H.Inner (height, (begin / CHUNK_SIZE) >> height, children, is_root) ;
+        }
+
+        /** Chaining values of all the (non root) chunks of DATA.  */
+        std::vector<Digest>     hash_chunks (const BinaryNodeHasher &H, const uint8_t *data, uint64_t size) {
+            const uint64_t  n = count_chunks (size) ;
+            std::vector<Digest>     result (static_cast<size_t> (n)) ;
+            std::vector<parameter_block_t>  params ;
+            std::vector<const void *>       ptrs ;
+            std::vector<size_t>             lengths ;
+            for (uint64_t base = 0 ; base < n ; base += HASH_BATCH_SIZE) {
+                const size_t    cnt = static_cast<size_t> (std::min<uint64_t> (HASH_BATCH_SIZE, n - base)) ;
+                params.resize (cnt) ;
+                ptrs.resize (cnt) ;
+                lengths.resize (cnt) ;
+                for (size_t i = 0 ; i < cnt ; ++i) {
+                    const uint64_t  off = CHUNK_SIZE * (base + i) ;
+                    params [i] = H.NodeParameter (0, base + i) ;
+                    ptrs [i] = data + off ;
+                    lengths [i] = static_cast<size_t> (std::min<uint64_t> (CHUNK_SIZE, size - off)) ;
+                }
+                ApplyBatch (params.data (), nullptr, 0, cnt, ptrs.data (), lengths.data (), &result [static_cast<size_t> (base)]) ;
+            }
+            return result ;
+        }
+
+        /**
+         * Reduces the subtree [BEGIN, BEGIN + LENGTH) (of more than one chunk),
+         * writes it in pre-order to OUTPUT + CURSOR unless OUTPUT is nullptr.
+         */
+        Digest  reduce ( const BinaryNodeHasher &H, const std::vector<Digest> &cvs
+                       , const uint8_t *data, uint64_t begin, uint64_t length, bool is_root
+                       , uint8_t *output, size_t &cursor) {
+            if (length <= CHUNK_SIZE) {
+                if (output != nullptr) {
+                    memcpy (output + cursor, data + begin, static_cast<size_t> (length)) ;
+                    cursor += static_cast<size_t> (length) ;
+                }
+                return cvs [static_cast<size_t> (begin / CHUNK_SIZE)] ;
+            }
+            const uint64_t  left = left_length (length) ;
+            const size_t    at = cursor ;
+            if (output != nullptr) {
+                cursor += PARENT_SIZE ;
+            }
+            uint8_t     children [PARENT_SIZE] ;
+            auto l = reduce (H, cvs, data, begin, left, false, output, cursor) ;
+            auto r = reduce (H, cvs, data, begin + left, length - left, false, output, cursor) ;
+            l.CopyTo (children, CV_SIZE) ;
+            r.CopyTo (children + CV_SIZE, CV_SIZE) ;
+            if (output != nullptr) {
+                memcpy (output + at, children, PARENT_SIZE) ;
+            }
+            return hash_parent (H, begin, length, children, is_root) ;
+        }
+
+        Digest  encode (const parameter_block_t &param, const void *data, size_t size, uint8_t *output) {
+            BinaryNodeHasher    H { param, LEAF_LENGTH } ;
+            auto const *        p = static_cast<const uint8_t *> (data) ;
+            size_t              cursor = 0 ;
+            if (output != nullptr) {
+                store64le (output, size) ;
+                cursor = VerifiedStream::HEADER_SIZE ;
+            }
+            if (size <= CHUNK_SIZE) {
+                if (output != nullptr && 0 < size) {
+                    memcpy (output + cursor, p, size) ;
+                }
+                return H.Leaf (0, p, size, true) ;
+            }
+            auto cvs = hash_chunks (H, p, size) ;
+            return reduce (H, cvs, p, 0, size, true, output, cursor) ;
+        }
+    }
+
+    const size_t    VerifiedStream::CHUNK_SIZE ;
+    const size_t    VerifiedStream::HEADER_SIZE ;
+    const size_t    VerifiedStream::PARENT_SIZE ;
+
+    uint64_t    VerifiedStream::EncodedLength (uint64_t size) {
+        return HEADER_SIZE + subtree_length (size) ;
+    }
+
+    Digest  VerifiedStream::Hash (const parameter_block_t &param, const void *data, size_t size) {
+        return encode (param, data, size, nullptr) ;
+    }
+
+    Digest  VerifiedStream::Encode (const parameter_block_t &param, const void *data, size_t size, std::vector<uint8_t> &encoded) {
+        encoded.resize (static_cast<size_t> (EncodedLength (size))) ;
+        return encode (param, data, size, encoded.data ()) ;
+    }
+
+    std::vector<uint8_t>    VerifiedStream::ExtractSlice (const void *encoded, size_t encoded_length, uint64_t offset, uint64_t length) {
+        auto const *    src = static_cast<const uint8_t *> (encoded) ;
+        if (encoded_length < HEADER_SIZE) {
+            throw std::invalid_argument { "VerifiedStream::ExtractSlice: truncated encoding" } ;
+        }
+        const uint64_t  content_length = load64le (src) ;
+        uint64_t    range_begin ;
+        uint64_t    range_end ;
+        slice_range (content_length, offset, length, range_begin, range_end) ;
+
+        std::vector<uint8_t>    result (src, src + HEADER_SIZE) ;
+        uint64_t    cursor = HEADER_SIZE ;
+        auto take = [src, encoded_length, &cursor, &result](uint64_t n) {
+            if (encoded_length < cursor + n) {
+                throw std::invalid_argument { "VerifiedStream::ExtractSlice: truncated encoding" } ;
+            }
+            result.insert (result.end (), src + cursor, src + cursor + n) ;
+            cursor += n ;
+        } ;
+        struct Range {
+            uint64_t    begin ;
+            uint64_t    length ;
+        } ;
+        std::vector<Range>  stack { { 0, content_length } } ;
+        bool    is_root = true ;
+        while (! stack.empty ()) {
+            const Range     R = stack.back () ;
+            stack.pop_back () ;
+            if (! is_root && ! overlaps (R.begin, R.length, range_begin, range_end)) {
+                cursor += subtree_length (R.length) ;
+                continue ;
+            }
+            is_root = false ;
+            if (R.length <= CHUNK_SIZE) {
+                take (R.length) ;
+                continue ;
+            }
+            take (PARENT_SIZE) ;
+            const uint64_t  left = left_length (R.length) ;
+            stack.push_back ({ R.begin + left, R.length - left }) ;
+            stack.push_back ({ R.begin, left }) ;
+        }
+        return result ;
+    }
+
+    VerifiedDecoder::VerifiedDecoder (const parameter_block_t &param, const Digest &root)
+            : VerifiedDecoder { param, root, 0, ~0uLL } {
+        /* NO-OP */
+    }
+
+    VerifiedDecoder::VerifiedDecoder (const parameter_block_t &param, const Digest &root, uint64_t offset, uint64_t length)
+            : param_ (BinaryNodeHasher { param, LEAF_LENGTH }.GetParameterBlock ())
+            , root_ { root }
+            , slice_begin_ { offset }
+            , slice_end_ { (length < ~offset) ? offset + length : ~0uLL }
+            , content_length_ { 0 }
+            , has_header_ { false } {
+        /* NO-OP */
+    }
+
+    size_t  VerifiedDecoder::Next () {
+        uint64_t    range_begin ;
+        uint64_t    range_end ;
+        slice_range (content_length_, slice_begin_, slice_end_ - slice_begin_, range_begin, range_end) ;
+        while (! stack_.empty ()) {
+            const Frame &   F = stack_.back () ;
+            if (F.is_root || overlaps (F.begin, F.length, range_begin, range_end)) {
+                return (CHUNK_SIZE < F.length) ? PARENT_SIZE : static_cast<size_t> (F.length) ;
+            }
+            stack_.pop_back () ;
+        }
+        return 0 ;
+    }
+
+    void    VerifiedDecoder::Consume (const uint8_t *node, std::vector<uint8_t> &output) {
+        BinaryNodeHasher    H { param_, LEAF_LENGTH } ;
+        const Frame         F = stack_.back () ;
+        if (CHUNK_SIZE < F.length) {
+            auto cv = hash_parent (H, F.begin, F.length, node, F.is_root) ;
+            if (! Digest::IsEqual (cv, F.expected)) {
+                throw VerifiedStream::VerificationError { "VerifiedDecoder: parent node at " + std::to_string (F.begin) + " does not match" } ;
+            }
+            const uint64_t  left = left_length (F.length) ;
+            stack_.pop_back () ;
+            stack_.push_back ({ load_digest (node + CV_SIZE), F.begin + left, F.length - left, false }) ;
+            stack_.push_back ({ load_digest (node), F.begin, left, false }) ;
+            return ;
+        }
+        auto cv = H.Leaf (F.begin / CHUNK_SIZE, node, static_cast<size_t> (F.length), F.is_root) ;
+        if (! Digest::IsEqual (cv, F.expected)) {
+            throw VerifiedStream::VerificationError { "VerifiedDecoder: chunk at " + std::to_string (F.begin) + " does not match" } ;
+        }
+        stack_.pop_back () ;
+        const uint64_t  first = std::max (F.begin, slice_begin_) ;
+        const uint64_t  last = std::min (F.begin + F.length, slice_end_) ;
+        if (first < last) {
+            output.insert (output.end (), node + (first - F.begin), node + (last - F.begin)) ;
+        }
+    }
+
+    void    VerifiedDecoder::Update (const void *data, size_t size, std::vector<uint8_t> &output) {
+        auto const *    p = static_cast<const uint8_t *> (data) ;
+        for (;;) {
+            size_t  need = VerifiedStream::HEADER_SIZE ;
+            if (has_header_) {
+                need = Next () ;
+                if (stack_.empty ()) {
+                    if (0 < size) {
+                        throw VerifiedStream::VerificationError { "VerifiedDecoder: trailing data" } ;
+                    }
+                    return ;
+                }
+            }
+            const uint8_t * node ;
+            if (pending_.empty () && need <= size) {
+                // Whole node in the input, no copy.
+                node = p ;
+                p += need ;
+                size -= need ;
+            }
+            else {
+                const size_t    n = std::min (need - pending_.size (), size) ;
+                pending_.insert (pending_.end (), p, p + n) ;
+                p += n ;
+                size -= n ;
+                if (pending_.size () < need) {
+                    return ;
+                }
+                node = pending_.data () ;
+            }
+            if (! has_header_) {
+                content_length_ = load64le (node) ;
+                has_header_ = true ;
+                stack_.push_back ({ root_, 0, content_length_, true }) ;
+            }
+            else {
+                Consume (node, output) ;
+            }
+            pending_.clear () ;
+        }
+    }
+}       /* end of [namespace BLAKE2] */
+/*
+ * [END OF FILE]
+ */
@@ -2569,6 +2569,2569 @@ namespace TestVector {
         0xEE, 0x2D, 0x46, 0xD6, 0x2E, 0xF2, 0xA4, 0x61
       }
     } ;
+
+    const uint8_t       BLAKE2BP [NUM_BLAKE2_TEST][DIGEST_SIZE] = {
+      {
+        0x9D, 0x94, 0x61, 0x07, 0x3E, 0x4E, 0xB6, 0x40,
+        0xA2, 0x55, 0x35, 0x7B, 0x83, 0x9F, 0x39, 0x4B,
+        0x83, 0x8C, 0x6F, 0xF5, 0x7C, 0x9B, 0x68, 0x6A,
+        0x3F, 0x76, 0x10, 0x7C, 0x10, 0x66, 0x72, 0x8F,
+        0x3C, 0x99, 0x56, 0xBD, 0x78, 0x5C, 0xBC, 0x3B,
+        0xF7, 0x9D, 0xC2, 0xAB, 0x57, 0x8C, 0x5A, 0x0C,
+        0x06, 0x3B, 0x9D, 0x9C, 0x40, 0x58, 0x48, 0xDE,
+        0x1D, 0xBE, 0x82, 0x1C, 0xD0, 0x5C, 0x94, 0x0A
+      },
+      {
+        0xFF, 0x8E, 0x90, 0xA3, 0x7B, 0x94, 0x62, 0x39,
+        0x32, 0xC5, 0x9F, 0x75, 0x59, 0xF2, 0x60, 0x35,
+        0x02, 0x9C, 0x37, 0x67, 0x32, 0xCB, 0x14, 0xD4,
+        0x16, 0x02, 0x00, 0x1C, 0xBB, 0x73, 0xAD, 0xB7,
+        0x92, 0x93, 0xA2, 0xDB, 0xDA, 0x5F, 0x60, 0x70,
+        0x30, 0x25, 0x14, 0x4D, 0x15, 0x8E, 0x27, 0x35,
+        0x52, 0x95, 0x96, 0x25, 0x1C, 0x73, 0xC0, 0x34,
+        0x5C, 0xA6, 0xFC, 0xCB, 0x1F, 0xB1, 0xE9, 0x7E
+      },
+      {
+        0xD6, 0x22, 0x0C, 0xA1, 0x95, 0xA0, 0xF3, 0x56,
+        0xA4, 0x79, 0x5E, 0x07, 0x1C, 0xEE, 0x1F, 0x54,
+        0x12, 0xEC, 0xD9, 0x5D, 0x8A, 0x5E, 0x01, 0xD7,
+        0xC2, 0xB8, 0x67, 0x50, 0xCA, 0x53, 0xD7, 0xF6,
+        0x4C, 0x29, 0xCB, 0xB3, 0xD2, 0x89, 0xC6, 0xF4,
+        0xEC, 0xC6, 0xC0, 0x1E, 0x3C, 0xA9, 0x33, 0x89,
+        0x71, 0x17, 0x03, 0x88, 0xE3, 0xE4, 0x02, 0x28,
+        0x47, 0x90, 0x06, 0xD1, 0xBB, 0xEB, 0xAD, 0x51
+      },
+      {
+        0x30, 0x30, 0x2C, 0x3F, 0xC9, 0x99, 0x06, 0x5D,
+        0x10, 0xDC, 0x98, 0x2C, 0x8F, 0xEE, 0xF4, 0x1B,
+        0xBB, 0x66, 0x42, 0x71, 0x8F, 0x62, 0x4A, 0xF6,
+        0xE3, 0xEA, 0xBE, 0xA0, 0x83, 0xE7, 0xFE, 0x78,
+        0x53, 0x40, 0xDB, 0x4B, 0x08, 0x97, 0xEF, 0xFF,
+        0x39, 0xCE, 0xE1, 0xDC, 0x1E, 0xB7, 0x37, 0xCD,
+        0x1E, 0xEA, 0x0F, 0xE7, 0x53, 0x84, 0x98, 0x4E,
+        0x7D, 0x8F, 0x44, 0x6F, 0xAA, 0x68, 0x3B, 0x80
+      },
+      {
+        0x32, 0xF3, 0x98, 0xA6, 0x0C, 0x1E, 0x53, 0xF1,
+        0xF8, 0x1D, 0x6D, 0x8D, 0xA2, 0xEC, 0x11, 0x75,
+        0x42, 0x2D, 0x6B, 0x2C, 0xFA, 0x0C, 0x0E, 0x66,
+        0xD8, 0xC4, 0xE7, 0x30, 0xB2, 0x96, 0xA4, 0xB5,
+        0x3E, 0x39, 0x2E, 0x39, 0x85, 0x98, 0x22, 0xA1,
+        0x45, 0xAE, 0x5F, 0x1A, 0x24, 0xC2, 0x7F, 0x55,
+        0x33, 0x9E, 0x2B, 0x4B, 0x44, 0x58, 0xE8, 0xC5,
+        0xEB, 0x19, 0xAA, 0x14, 0x20, 0x64, 0x27, 0xAA
+      },
+      {
+        0x23, 0x6D, 0xB9, 0x33, 0xF1, 0x8A, 0x9D, 0xBD,
+        0x4E, 0x50, 0xB7, 0x29, 0x53, 0x90, 0x65, 0xBD,
+        0xA4, 0x20, 0xDF, 0x97, 0xAC, 0x78, 0x0B, 0xE4,
+        0x3F, 0x59, 0x10, 0x3C, 0x47, 0x2E, 0x0B, 0xCC,
+        0xA6, 0xD4, 0x97, 0x38, 0x97, 0x86, 0xAF, 0x22,
+        0xBA, 0x94, 0x30, 0xB7, 0x4D, 0x6F, 0x74, 0xB1,
+        0x3F, 0x6F, 0x94, 0x9E, 0x25, 0x6A, 0x14, 0x0A,
+        0xA3, 0x4B, 0x47, 0x70, 0x0B, 0x10, 0x03, 0x43
+      },
+      {
+        0x23, 0x8C, 0x9D, 0x08, 0x02, 0x85, 0xE3, 0x54,
+        0x35, 0xCB, 0x53, 0x15, 0x5D, 0x9F, 0x79, 0x2C,
+        0xA1, 0xBB, 0x27, 0xDE, 0x4F, 0x9B, 0x6C, 0x87,
+        0x26, 0xE1, 0x1C, 0x02, 0x8E, 0x7B, 0x87, 0x87,
+        0x33, 0x54, 0x91, 0x12, 0xA3, 0x28, 0xB5, 0x0E,
+        0x8C, 0xD8, 0xBA, 0x27, 0x87, 0x21, 0x7E, 0x46,
+        0xB8, 0x16, 0x8D, 0x57, 0x11, 0x3D, 0xD4, 0x04,
+        0xD9, 0x14, 0xE2, 0x9A, 0x6A, 0x54, 0x70, 0xE6
+      },
+      {
+        0x9A, 0x02, 0x1E, 0xBD, 0x50, 0x4A, 0x97, 0x59,
+        0x6D, 0x0E, 0x85, 0x04, 0x8A, 0xE1, 0xDA, 0x89,
+        0x99, 0xE3, 0xA0, 0x47, 0x01, 0x6F, 0x17, 0xC6,
+        0xC5, 0x55, 0x6C, 0x27, 0x31, 0xE9, 0xB1, 0x39,
+        0x26, 0x1F, 0x84, 0x3F, 0xAD, 0x6B, 0xD4, 0x3F,
+        0x7C, 0x7C, 0x58, 0x7F, 0x69, 0x8D, 0x69, 0xB6,
+        0x82, 0xE5, 0x68, 0xB4, 0x42, 0xAC, 0x45, 0x88,
+        0x98, 0x57, 0xB7, 0x69, 0x07, 0x34, 0xCD, 0xBB
+      },
+      {
+        0x3A, 0xBA, 0x07, 0xAE, 0x98, 0x0E, 0x33, 0x86,
+        0x37, 0x47, 0x9D, 0xCA, 0x1E, 0x35, 0x28, 0x00,
+        0xF4, 0x58, 0x8E, 0x62, 0xD8, 0x23, 0x36, 0x5A,
+        0xA6, 0x9C, 0x5B, 0x25, 0xFC, 0xE1, 0x29, 0x68,
+        0xD2, 0x6C, 0x9B, 0xDB, 0xEE, 0x9A, 0x32, 0xBF,
+        0xFD, 0x42, 0xE6, 0xB2, 0x2C, 0x81, 0x38, 0xA6,
+        0x1C, 0x1F, 0xCE, 0x49, 0xFF, 0xBC, 0x19, 0x0E,
+        0x1E, 0x15, 0x16, 0x01, 0x53, 0xCC, 0xB6, 0xB4
+      },
+      {
+        0x77, 0x4C, 0xDF, 0x9A, 0xBB, 0x50, 0x81, 0xFE,
+        0x07, 0xEB, 0x57, 0x25, 0xE6, 0x06, 0x9B, 0x8D,
+        0x6C, 0x7E, 0x60, 0x04, 0xA2, 0x4D, 0x70, 0xF7,
+        0xDF, 0xAB, 0xFC, 0x03, 0x82, 0x5B, 0xBC, 0x3B,
+        0x30, 0xE6, 0x20, 0xB6, 0x04, 0x1F, 0x3C, 0xC2,
+        0x89, 0x6B, 0x14, 0xAB, 0x66, 0x0A, 0xF7, 0x2E,
+        0x24, 0x95, 0x10, 0xAC, 0x2F, 0xE8, 0x10, 0xCC,
+        0x77, 0x63, 0xA2, 0xE5, 0xC3, 0xFC, 0xA7, 0xFC
+      },
+      {
+        0x9E, 0x08, 0x9F, 0x51, 0x65, 0x7B, 0x29, 0xC2,
+        0x66, 0x8E, 0x28, 0x50, 0x52, 0x4E, 0x53, 0xAE,
+        0xAA, 0xA7, 0x30, 0x6F, 0x2A, 0xD5, 0xA2, 0x32,
+        0xB5, 0xF0, 0x7F, 0x68, 0x8D, 0x8A, 0xB2, 0xB4,
+        0x25, 0xDF, 0x7E, 0xA5, 0xBD, 0x3E, 0x9F, 0xFD,
+        0x61, 0x68, 0x38, 0x90, 0x15, 0x1D, 0x78, 0xBB,
+        0x94, 0x03, 0x11, 0x85, 0xAC, 0xA4, 0x81, 0xE2,
+        0x14, 0x0F, 0xE3, 0x79, 0x85, 0x36, 0x76, 0x43
+      },
+      {
+        0xB3, 0x5B, 0xD5, 0x4E, 0x4F, 0x81, 0x69, 0x6B,
+        0x4F, 0x22, 0x31, 0x6A, 0x1E, 0x33, 0x7D, 0x98,
+        0xD1, 0xC6, 0xB0, 0x61, 0x10, 0x99, 0x87, 0x63,
+        0xB5, 0x91, 0x33, 0x35, 0x92, 0x3A, 0x40, 0x76,
+        0xCB, 0x80, 0xD6, 0xD8, 0xA5, 0x18, 0x62, 0x91,
+        0x13, 0x47, 0x7B, 0x30, 0xA1, 0x32, 0xA6, 0xB2,
+        0x7F, 0xC1, 0xEE, 0x79, 0xF6, 0xB2, 0xE0, 0xD3,
+        0x5D, 0x5B, 0xC2, 0x97, 0x27, 0x46, 0x3D, 0xB5
+      },
+      {
+        0x12, 0x39, 0x30, 0xD5, 0xA4, 0xB7, 0x3B, 0x49,
+        0x1F, 0x50, 0xE5, 0x6E, 0x2B, 0x73, 0x97, 0xA4,
+        0x3D, 0x2E, 0x47, 0x87, 0x23, 0x76, 0x02, 0xB6,
+        0x6F, 0xE0, 0xA8, 0x47, 0xBD, 0x13, 0xCB, 0xE8,
+        0xB3, 0x7D, 0xC7, 0x03, 0xD7, 0xB2, 0xB4, 0xEA,
+        0xA8, 0xBF, 0xB9, 0xA5, 0x8A, 0x7D, 0x71, 0x9C,
+        0x90, 0x8F, 0x19, 0x66, 0xA2, 0xF1, 0x9F, 0xE6,
+        0xEB, 0x1A, 0x78, 0x96, 0x2A, 0xFA, 0x5B, 0xF9
+      },
+      {
+        0x08, 0x9C, 0xBC, 0x7E, 0xE1, 0xB1, 0x2C, 0x0C,
+        0xC9, 0xC8, 0x3F, 0xF6, 0x66, 0xFE, 0xC8, 0x02,
+        0x6B, 0xB7, 0x1B, 0x90, 0x84, 0x97, 0x9B, 0x0E,
+        0xA8, 0xB7, 0x23, 0xBB, 0xBE, 0x8B, 0x00, 0xD4,
+        0x10, 0x08, 0xB6, 0x04, 0x99, 0xF2, 0x4F, 0x24,
+        0x1B, 0x63, 0x28, 0x1F, 0xE5, 0xB4, 0xD8, 0x89,
+        0x66, 0x30, 0x9C, 0x0D, 0x7E, 0x64, 0x66, 0x91,
+        0x05, 0xE5, 0x1E, 0x69, 0xD7, 0xAF, 0x8C, 0xE5
+      },
+      {
+        0x6B, 0x3C, 0x67, 0x89, 0x47, 0xF6, 0x12, 0x52,
+        0x65, 0x7C, 0x35, 0x49, 0x78, 0xC1, 0x01, 0xB2,
+        0xFD, 0xD2, 0x72, 0x9E, 0xC3, 0x49, 0x27, 0xDD,
+        0x5E, 0xFF, 0x0A, 0x7C, 0x0A, 0x86, 0x58, 0x26,
+        0xE8, 0x33, 0xC3, 0x63, 0x23, 0x21, 0x31, 0xB1,
+        0x05, 0x93, 0xBE, 0x1C, 0xCF, 0x6B, 0xA5, 0x4E,
+        0xCC, 0x14, 0x31, 0x2F, 0x45, 0xBF, 0xFC, 0x24,
+        0x04, 0x62, 0x9F, 0xF8, 0x02, 0x67, 0xF0, 0x94
+      },
+      {
+        0xAA, 0x0C, 0x23, 0xEA, 0x1C, 0x6F, 0xE2, 0xE9,
+        0x0A, 0x77, 0x18, 0xEF, 0x4A, 0xA4, 0x75, 0x1F,
+        0xF6, 0xBE, 0xB9, 0xD4, 0x61, 0x63, 0x59, 0x5B,
+        0x5D, 0x4F, 0xB8, 0x96, 0x00, 0x52, 0x5C, 0x5B,
+        0x6C, 0xF1, 0x9E, 0xCD, 0xB2, 0x47, 0x78, 0x72,
+        0xA7, 0xA1, 0x2D, 0x40, 0xE5, 0x06, 0x36, 0x08,
+        0xE5, 0xF0, 0x00, 0x8E, 0x79, 0x72, 0xA9, 0xC0,
+        0x1A, 0x4B, 0xE2, 0xAF, 0xE9, 0x53, 0x2F, 0x9C
+      },
+      {
+        0x63, 0x34, 0x7A, 0xB4, 0xCB, 0xB6, 0xF2, 0x89,
+        0x52, 0x99, 0x2C, 0x07, 0x9D, 0x18, 0xD4, 0x20,
+        0x01, 0xB7, 0xF3, 0xA9, 0xD0, 0xFD, 0x90, 0xB0,
+        0xA4, 0x77, 0x1F, 0x69, 0x72, 0xF0, 0xC5, 0x32,
+        0x89, 0xC8, 0xAE, 0xE1, 0x43, 0x29, 0x4B, 0x50,
+        0xC6, 0x34, 0x12, 0x58, 0x5C, 0xDC, 0xE4, 0xFF,
+        0x7B, 0xED, 0x11, 0x2C, 0xD0, 0x3C, 0x9B, 0x1D,
+        0xF3, 0xDE, 0xF0, 0xCC, 0x32, 0x0D, 0x6B, 0x70
+      },
+      {
+        0x23, 0x96, 0xC0, 0xCB, 0x9E, 0xDA, 0xAC, 0xA9,
+        0xD8, 0xB1, 0x04, 0x65, 0x2C, 0xB7, 0xF1, 0x25,
+        0xF1, 0x93, 0x55, 0x1A, 0xE5, 0xD7, 0xBC, 0x94,
+        0x63, 0x30, 0x7C, 0x9E, 0x69, 0xCA, 0x7D, 0xA2,
+        0x3A, 0x9F, 0xBC, 0xBC, 0xB8, 0x66, 0x69, 0xD5,
+        0xBA, 0x63, 0x43, 0x85, 0x93, 0xE1, 0x32, 0xF9,
+        0x92, 0xB5, 0x7C, 0x00, 0x17, 0xC8, 0x6D, 0xDB,
+        0x9B, 0x47, 0x28, 0x6E, 0xF5, 0xB6, 0x87, 0x18
+      },
+      {
+        0xA9, 0x4B, 0x80, 0x22, 0x57, 0xFD, 0x03, 0x1E,
+        0xE6, 0x0F, 0x1B, 0xE1, 0x84, 0x38, 0x3A, 0x76,
+        0x32, 0x85, 0x39, 0xF9, 0xD8, 0x06, 0x08, 0x72,
+        0xEF, 0x35, 0x73, 0xBE, 0xB6, 0xF2, 0x73, 0x68,
+        0x08, 0x95, 0x90, 0xED, 0xBB, 0x21, 0xF4, 0xD8,
+        0xF1, 0x81, 0xBA, 0x66, 0x20, 0x75, 0xF9, 0x19,
+        0x05, 0x97, 0x4B, 0xEE, 0xEF, 0x1F, 0xC5, 0xCB,
+        0x9B, 0xCF, 0xB2, 0x8A, 0xAE, 0x1E, 0x4D, 0xE3
+      },
+      {
+        0x52, 0xC7, 0xD3, 0x39, 0x9A, 0x03, 0x80, 0x04,
+        0xBE, 0xA5, 0x2D, 0x3E, 0xA9, 0xE9, 0x1E, 0x25,
+        0x44, 0xC8, 0x65, 0x2A, 0xB8, 0xF5, 0x28, 0x5C,
+        0x9D, 0x32, 0x18, 0x63, 0x7A, 0x6D, 0x9F, 0xCA,
+        0xF0, 0xD9, 0x65, 0xB3, 0x58, 0x8E, 0xE6, 0xD7,
+        0x3F, 0xA5, 0x99, 0xDE, 0xCA, 0x1F, 0x41, 0xDE,
+        0xD8, 0x02, 0x5B, 0xF7, 0x76, 0x8E, 0x0E, 0x20,
+        0x0E, 0x8C, 0xD3, 0xFF, 0x86, 0x8C, 0x38, 0x00
+      },
+      {
+        0xB6, 0x29, 0xF5, 0x71, 0x62, 0x87, 0x6A, 0xDB,
+        0x8F, 0xA9, 0x57, 0x2E, 0xBA, 0x4E, 0x1E, 0xCD,
+        0x75, 0xA6, 0x56, 0x73, 0x08, 0xDE, 0x90, 0xDB,
+        0xB8, 0xFF, 0xDE, 0x77, 0xDE, 0x82, 0x13, 0xA4,
+        0xD7, 0xF7, 0xCB, 0x85, 0xAE, 0x1B, 0x71, 0xE6,
+        0x45, 0x7B, 0xC4, 0xE8, 0x9C, 0x0D, 0x9D, 0xE2,
+        0x41, 0xB6, 0xB9, 0xF3, 0x74, 0xB7, 0x34, 0x19,
+        0x4D, 0xB2, 0xB2, 0x67, 0x02, 0xD7, 0xCB, 0x7C
+      },
+      {
+        0x72, 0x28, 0x46, 0xDD, 0xAC, 0xAA, 0x94, 0xFD,
+        0xE6, 0x63, 0x2A, 0x2D, 0xC7, 0xDC, 0x70, 0x8B,
+        0xDF, 0x98, 0x31, 0x1C, 0x9F, 0xB6, 0x3C, 0x61,
+        0xE5, 0x25, 0xFD, 0x4B, 0x0D, 0x87, 0xB6, 0x38,
+        0x8B, 0x5A, 0xF7, 0x04, 0x20, 0x18, 0xDD, 0xCA,
+        0x06, 0x5E, 0x8A, 0x55, 0xBB, 0xFD, 0x68, 0xEE,
+        0x61, 0xFC, 0xD3, 0xC6, 0x87, 0x8F, 0x5B, 0x09,
+        0xBC, 0xC2, 0x7B, 0xED, 0x61, 0xDD, 0x93, 0xED
+      },
+      {
+        0x1C, 0xED, 0x6A, 0x0C, 0x78, 0x9D, 0xDB, 0x29,
+        0x56, 0x78, 0xAD, 0x43, 0xA3, 0x22, 0xD8, 0x96,
+        0x61, 0x7F, 0xDE, 0x27, 0x5F, 0x13, 0x8C, 0xCC,
+        0xFB, 0x13, 0x26, 0xCD, 0x3F, 0x76, 0x09, 0xC2,
+        0xAA, 0xA5, 0xEC, 0x10, 0x26, 0x97, 0x17, 0x3E,
+        0x12, 0x1A, 0xE1, 0x63, 0x02, 0x4F, 0x42, 0x8C,
+        0x98, 0x28, 0x35, 0xB4, 0xFA, 0x6D, 0xA6, 0xD6,
+        0x78, 0xAE, 0xB9, 0xEE, 0x10, 0x6A, 0x3F, 0x6C
+      },
+      {
+        0xE8, 0x69, 0x14, 0x8C, 0x05, 0x45, 0xB3, 0x58,
+        0x0E, 0x39, 0x5A, 0xFD, 0xC7, 0x45, 0xCD, 0x24,
+        0x3B, 0x6B, 0x5F, 0xE3, 0xB6, 0x7E, 0x29, 0x43,
+        0xF6, 0xF8, 0xD9, 0xF2, 0x4F, 0xFA, 0x40, 0xE8,
+        0x81, 0x75, 0x6E, 0x1C, 0x18, 0xD9, 0x2F, 0x3E,
+        0xBE, 0x84, 0x55, 0x9B, 0x57, 0xE2, 0xEE, 0x3A,
+        0x65, 0xD9, 0xEC, 0xE0, 0x49, 0x72, 0xB3, 0x5D,
+        0x4C, 0x4E, 0xBE, 0x78, 0x6C, 0x88, 0xDA, 0x62
+      },
+      {
+        0xDA, 0xDA, 0x15, 0x5E, 0x55, 0x42, 0x32, 0xB1,
+        0x6E, 0xCA, 0xD9, 0x31, 0xCB, 0x42, 0xE3, 0x25,
+        0xB5, 0x86, 0xDB, 0xF1, 0xCB, 0xD0, 0xCE, 0x38,
+        0x14, 0x45, 0x16, 0x6B, 0xD1, 0xBF, 0xA3, 0x32,
+        0x49, 0x85, 0xE7, 0x7C, 0x6F, 0x0D, 0x51, 0x2A,
+        0x02, 0x6E, 0x09, 0xD4, 0x86, 0x1C, 0x3B, 0xB8,
+        0x52, 0x9D, 0x72, 0x02, 0xEA, 0xC1, 0xC0, 0x44,
+        0x27, 0x44, 0xD3, 0x7C, 0x7F, 0x5A, 0xB8, 0xAF
+      },
+      {
+        0x2D, 0x14, 0x8C, 0x8E, 0x8F, 0x76, 0xFA, 0xAC,
+        0x6F, 0x7F, 0x01, 0xF2, 0x03, 0x9E, 0xA0, 0x2A,
+        0x42, 0xD9, 0x32, 0x57, 0x94, 0xC2, 0xC7, 0xA0,
+        0x0F, 0x83, 0xF4, 0xA7, 0x79, 0x8A, 0xFB, 0xA9,
+        0x93, 0xFF, 0x94, 0x91, 0x1E, 0x09, 0x8B, 0x00,
+        0x1A, 0x0B, 0xDF, 0xF4, 0xC8, 0x5A, 0x2A, 0x61,
+        0x31, 0xE0, 0xCF, 0xE7, 0x0F, 0x1D, 0x2E, 0x07,
+        0xAF, 0x02, 0x09, 0xDA, 0x77, 0x96, 0x09, 0x1F
+      },
+      {
+        0x99, 0x98, 0x3A, 0x75, 0x9C, 0xCF, 0x9C, 0xAC,
+        0xAE, 0x70, 0x2D, 0xCB, 0xFC, 0xDF, 0x72, 0x04,
+        0xDD, 0xF0, 0x33, 0x4B, 0xC6, 0x5D, 0xAD, 0x84,
+        0x6F, 0x83, 0x1F, 0x9F, 0x9D, 0x8A, 0x45, 0x3F,
+        0x0D, 0x24, 0x93, 0x5C, 0x4C, 0x65, 0x7F, 0xFF,
+        0x2E, 0xBB, 0xDB, 0xAF, 0x7B, 0xCE, 0x6A, 0xAC,
+        0xDB, 0xB8, 0x87, 0x6F, 0x16, 0x04, 0x59, 0xB1,
+        0xA4, 0xAA, 0xC9, 0x56, 0x97, 0xE0, 0x0D, 0x98
+      },
+      {
+        0x7E, 0x4A, 0x02, 0x12, 0x6D, 0x75, 0x52, 0xF4,
+        0xC9, 0xB9, 0x4D, 0x80, 0xE3, 0xCF, 0x7B, 0x89,
+        0x7E, 0x09, 0x84, 0xE4, 0x06, 0xF0, 0x78, 0x13,
+        0x5C, 0xF4, 0x56, 0xC0, 0xD5, 0x1E, 0x13, 0x91,
+        0xFF, 0x18, 0xA8, 0x8F, 0x93, 0x12, 0x2C, 0x83,
+        0x2C, 0xAC, 0x7D, 0x79, 0x6A, 0x6B, 0x42, 0x51,
+        0x9B, 0x1D, 0xB4, 0xEA, 0xD8, 0xF4, 0x98, 0x40,
+        0xCE, 0xB5, 0x52, 0x33, 0x6B, 0x29, 0xDE, 0x44
+      },
+      {
+        0xD7, 0xE1, 0x6F, 0xD1, 0x59, 0x65, 0x8A, 0xD7,
+        0xEE, 0x25, 0x1E, 0x51, 0x7D, 0xCE, 0x5A, 0x29,
+        0xF4, 0x6F, 0xD4, 0xB8, 0xD3, 0x19, 0xDB, 0x80,
+        0x5F, 0xC2, 0x5A, 0xA6, 0x20, 0x35, 0x0F, 0xF4,
+        0x23, 0xAD, 0x8D, 0x05, 0x37, 0xCD, 0x20, 0x69,
+        0x43, 0x2E, 0xBF, 0xF2, 0x92, 0x36, 0xF8, 0xC2,
+        0xA8, 0xA0, 0x4D, 0x04, 0xB3, 0xB4, 0x8C, 0x59,
+        0xA3, 0x55, 0xFC, 0xC6, 0x2D, 0x27, 0xF8, 0xEE
+      },
+      {
+        0x0D, 0x45, 0x17, 0xD4, 0xF1, 0xD0, 0x47, 0x30,
+        0xC6, 0x91, 0x69, 0x18, 0xA0, 0x4C, 0x9E, 0x90,
+        0xCC, 0xA3, 0xAC, 0x1C, 0x63, 0xD6, 0x45, 0x97,
+        0x8A, 0x7F, 0x07, 0x03, 0x9F, 0x92, 0x20, 0x64,
+        0x7C, 0x25, 0xC0, 0x4E, 0x85, 0xF6, 0xE2, 0x28,
+        0x6D, 0x2E, 0x35, 0x46, 0x0D, 0x0B, 0x2C, 0x1E,
+        0x25, 0xAF, 0x9D, 0x35, 0x37, 0xEF, 0x33, 0xFD,
+        0x7F, 0xE5, 0x1E, 0x2B, 0xA8, 0x76, 0x4B, 0x36
+      },
+      {
+        0x56, 0xB7, 0x2E, 0x51, 0x37, 0xC6, 0x89, 0xB2,
+        0x73, 0x66, 0xFB, 0x22, 0xC7, 0xC6, 0x75, 0x44,
+        0xF6, 0xBC, 0xE5, 0x76, 0x19, 0x41, 0x31, 0xC5,
+        0xBF, 0xAB, 0x1C, 0xF9, 0x3C, 0x2B, 0x51, 0xAA,
+        0xA3, 0x03, 0x36, 0x8A, 0xA8, 0x44, 0xD5, 0x8D,
+        0xF0, 0xEE, 0x5D, 0x4E, 0x31, 0x9F, 0xCD, 0x8E,
+        0xFF, 0xC6, 0x02, 0xCE, 0xE4, 0x35, 0x1B, 0xD2,
+        0xF5, 0x51, 0x43, 0x0B, 0x92, 0x11, 0xE7, 0x3C
+      },
+      {
+        0xF3, 0x35, 0xCC, 0x22, 0xFF, 0xEA, 0x5A, 0xA5,
+        0x9C, 0xDF, 0xC8, 0xF5, 0x02, 0x89, 0xCC, 0x92,
+        0x31, 0x9B, 0x8B, 0x14, 0x40, 0x8D, 0x7A, 0x5A,
+        0xA1, 0x23, 0x2A, 0xE2, 0x3A, 0xA1, 0xEA, 0x7F,
+        0x77, 0x48, 0xCF, 0xEF, 0x03, 0x20, 0x10, 0xF8,
+        0x62, 0x6D, 0x93, 0x18, 0xED, 0xBA, 0x98, 0xD4,
+        0x16, 0x62, 0x03, 0x35, 0xC9, 0x01, 0xED, 0x02,
+        0xEA, 0xBD, 0x27, 0x6A, 0x1B, 0x82, 0x9C, 0x9D
+      },
+      {
+        0xA9, 0x9A, 0x3D, 0x10, 0xF9, 0x5B, 0x44, 0x2F,
+        0xFF, 0xF7, 0xC4, 0x18, 0xFA, 0x94, 0x9D, 0x48,
+        0x30, 0x86, 0x9B, 0x0E, 0x60, 0xEC, 0x8B, 0x97,
+        0x2C, 0x30, 0xA3, 0x16, 0x9C, 0x27, 0xBE, 0xB5,
+        0xCF, 0x33, 0x05, 0x94, 0xF0, 0x14, 0xB6, 0x6B,
+        0x22, 0x00, 0xA7, 0xF0, 0x86, 0xD2, 0xC2, 0xF3,
+        0xF9, 0xFD, 0x85, 0x32, 0xA5, 0x71, 0x88, 0x76,
+        0xDF, 0xCA, 0x66, 0x1B, 0xA0, 0xF7, 0xB3, 0x6D
+      },
+      {
+        0x15, 0x8E, 0x25, 0x70, 0xD0, 0x84, 0xA4, 0x86,
+        0x9D, 0x96, 0x93, 0x43, 0xC0, 0x10, 0x86, 0x07,
+        0x17, 0xFF, 0x74, 0x11, 0x61, 0x88, 0x17, 0x5F,
+        0x2E, 0xD7, 0x4C, 0xD5, 0x78, 0xFA, 0x0D, 0x80,
+        0x91, 0xB0, 0x3F, 0xAD, 0x0C, 0x65, 0xCF, 0x59,
+        0xAB, 0x91, 0xDD, 0x73, 0xB3, 0x7F, 0xE3, 0xF5,
+        0x8A, 0x58, 0xE7, 0xB4, 0x47, 0x9C, 0x87, 0x5A,
+        0xCD, 0x63, 0xEC, 0x52, 0x58, 0x12, 0x35, 0x3F
+      },
+      {
+        0x7C, 0x49, 0x50, 0x1C, 0x58, 0x08, 0xB1, 0x5C,
+        0x0D, 0x31, 0xBD, 0xD5, 0xBB, 0x56, 0x31, 0xD5,
+        0x3A, 0xE0, 0x0D, 0xF4, 0x31, 0x02, 0x5F, 0xEA,
+        0x51, 0xEB, 0x47, 0x62, 0x54, 0x4E, 0xFD, 0xEE,
+        0x97, 0x8A, 0x83, 0x50, 0x8D, 0xEA, 0x6B, 0xFD,
+        0x3B, 0x93, 0x1A, 0x0E, 0x95, 0x83, 0xCC, 0xFC,
+        0x04, 0x9E, 0xA8, 0x46, 0x44, 0x70, 0x5D, 0x31,
+        0x9F, 0xDC, 0x5C, 0x16, 0x3B, 0xF4, 0x82, 0x24
+      },
+      {
+        0xFE, 0xF4, 0x36, 0xB3, 0x5F, 0x71, 0x7D, 0x59,
+        0xAC, 0xA1, 0x7E, 0x9B, 0xF5, 0xFF, 0xDA, 0x28,
+        0xF5, 0xF4, 0x01, 0x94, 0x3E, 0xFE, 0x93, 0xEB,
+        0x58, 0x0F, 0xFB, 0x98, 0xF1, 0x3B, 0xEA, 0x80,
+        0x94, 0x69, 0xA3, 0x44, 0xE7, 0x82, 0xA4, 0x43,
+        0xC6, 0x4E, 0xB2, 0x5A, 0xD0, 0x9D, 0x8D, 0xE2,
+        0x05, 0xFE, 0xE7, 0xD5, 0x63, 0x96, 0x86, 0xA1,
+        0x9E, 0x7C, 0x42, 0xB4, 0x0F, 0x70, 0x6A, 0x08
+      },
+      {
+        0x4D, 0x47, 0xA6, 0x7A, 0x5F, 0x8E, 0x17, 0xB7,
+        0x22, 0xDF, 0x98, 0x58, 0xAE, 0xB6, 0x7B, 0x99,
+        0x56, 0xB4, 0x59, 0x62, 0xEC, 0x35, 0x3D, 0xC2,
+        0xE2, 0x7F, 0x0F, 0x50, 0x1C, 0x39, 0x8E, 0x34,
+        0x39, 0x7B, 0xEB, 0xE0, 0x2B, 0x54, 0x92, 0x7E,
+        0x2D, 0x31, 0xF1, 0x2E, 0xCF, 0x55, 0xE8, 0x82,
+        0x69, 0xFA, 0xB5, 0x37, 0x0E, 0x7F, 0xA5, 0x70,
+        0x35, 0x26, 0x6F, 0x89, 0xD5, 0xC2, 0x64, 0x41
+      },
+      {
+        0x1B, 0x58, 0xDC, 0x7A, 0xAC, 0x36, 0x3B, 0x00,
+        0x44, 0x6E, 0xA8, 0x03, 0xBC, 0xD7, 0x49, 0xC3,
+        0xF5, 0xCA, 0xBE, 0xAA, 0xF2, 0x23, 0x99, 0x4C,
+        0x0C, 0x3E, 0xCC, 0x1B, 0x28, 0x47, 0x73, 0x44,
+        0xD7, 0xBF, 0x97, 0xC0, 0x8A, 0x95, 0x9D, 0x1A,
+        0xC2, 0x06, 0x0B, 0x47, 0x27, 0x89, 0x86, 0x92,
+        0x91, 0x88, 0xAD, 0x73, 0xDE, 0x67, 0x07, 0x8B,
+        0xA6, 0x80, 0x96, 0x3B, 0x9D, 0x3B, 0x12, 0xA4
+      },
+      {
+        0x3C, 0x52, 0x2C, 0x84, 0x3E, 0x69, 0x74, 0xEC,
+        0x75, 0x0D, 0xF2, 0x20, 0xD4, 0x1A, 0x00, 0x4A,
+        0xC2, 0xAD, 0xF0, 0x94, 0x56, 0xFA, 0x78, 0x7F,
+        0x7C, 0x65, 0x43, 0xAB, 0x17, 0x97, 0x9C, 0x77,
+        0x7B, 0x3E, 0x79, 0xD1, 0x78, 0x7D, 0xA5, 0xA8,
+        0x3F, 0x17, 0x8D, 0xA9, 0xF0, 0x4C, 0xF6, 0xF5,
+        0xB2, 0x55, 0xDD, 0xCB, 0x18, 0x74, 0x84, 0x1B,
+        0xBF, 0x70, 0x16, 0xE6, 0x13, 0x2B, 0x99, 0x8A
+      },
+      {
+        0x5A, 0x4F, 0xEB, 0x8F, 0x70, 0x75, 0xB4, 0xDC,
+        0x9C, 0xA1, 0x6C, 0x6F, 0x05, 0xCD, 0x6B, 0x70,
+        0x27, 0x48, 0x5F, 0xFE, 0xD9, 0x15, 0x7D, 0x82,
+        0x4D, 0x9D, 0x1A, 0x17, 0x20, 0xEE, 0xEE, 0xEA,
+        0x3F, 0x6C, 0x12, 0x5F, 0xDA, 0x4B, 0xA4, 0x40,
+        0x9D, 0x79, 0x80, 0x49, 0xFD, 0x18, 0x82, 0xC6,
+        0x90, 0x28, 0x8F, 0x33, 0x54, 0x7A, 0x3D, 0x8D,
+        0x62, 0x60, 0xB6, 0x54, 0x54, 0x88, 0x53, 0xD7
+      },
+      {
+        0xBC, 0xAA, 0x79, 0x36, 0x32, 0x56, 0x9E, 0x2F,
+        0x84, 0x17, 0xCC, 0x60, 0x32, 0x53, 0x53, 0x5B,
+        0xD7, 0xD8, 0x5F, 0x38, 0x53, 0x19, 0x92, 0x59,
+        0x1E, 0x56, 0xC1, 0xA4, 0xB6, 0xF5, 0x8E, 0xE7,
+        0xF8, 0x18, 0xFA, 0xE0, 0x27, 0x88, 0x8A, 0x86,
+        0x28, 0x43, 0x05, 0x10, 0x1E, 0xC0, 0x46, 0x61,
+        0xF5, 0x99, 0x53, 0x47, 0xA4, 0x67, 0xED, 0x8B,
+        0x92, 0x79, 0xF1, 0xAC, 0xC2, 0xB4, 0xBB, 0x1F
+      },
+      {
+        0x34, 0xAF, 0x91, 0xCC, 0x22, 0xA6, 0x9B, 0xCB,
+        0x55, 0xDD, 0xBF, 0x7F, 0x0F, 0x43, 0xEC, 0x56,
+        0x48, 0x40, 0x43, 0x32, 0x13, 0xEA, 0x55, 0xD9,
+        0xF8, 0x1A, 0xC4, 0x75, 0x20, 0x8D, 0x74, 0x85,
+        0x1D, 0xB7, 0x0F, 0xE4, 0x96, 0xAF, 0x9D, 0xA1,
+        0xD3, 0x93, 0xEC, 0xF8, 0x78, 0x69, 0x5D, 0xD3,
+        0x3F, 0xD5, 0x43, 0x49, 0xA6, 0xF8, 0x24, 0xAE,
+        0xED, 0x18, 0x3C, 0xB1, 0xB0, 0x8C, 0x54, 0x85
+      },
+      {
+        0xB8, 0xB7, 0xAD, 0x2E, 0xA2, 0xB6, 0xFA, 0x06,
+        0xD0, 0x0B, 0xCD, 0x59, 0x9C, 0x99, 0x71, 0xC5,
+        0xB4, 0xE1, 0x65, 0x58, 0xE1, 0x52, 0x12, 0xC9,
+        0xBF, 0xD3, 0x73, 0xE4, 0xBC, 0x79, 0x17, 0x05,
+        0x26, 0x01, 0xFF, 0xDB, 0x68, 0x01, 0xBE, 0x80,
+        0xBA, 0x50, 0x9D, 0xB8, 0x2A, 0x0B, 0x71, 0x95,
+        0x92, 0x91, 0x33, 0xAD, 0x53, 0x99, 0x56, 0x06,
+        0x52, 0x33, 0xF4, 0x9D, 0x07, 0x1C, 0x84, 0xE4
+      },
+      {
+        0xDC, 0xEE, 0x9C, 0x45, 0xBC, 0x5D, 0x1F, 0xE6,
+        0x30, 0xB1, 0x8B, 0x06, 0x3C, 0xE8, 0x2C, 0x38,
+        0x57, 0xE3, 0x0D, 0x20, 0xC6, 0x4B, 0x5C, 0xC2,
+        0x58, 0x84, 0x94, 0x3E, 0x7A, 0xE9, 0x4E, 0xDF,
+        0xF8, 0x50, 0xEB, 0x0E, 0x82, 0x44, 0x02, 0x3D,
+        0x3D, 0x07, 0xA8, 0xA0, 0x07, 0x06, 0xF0, 0x58,
+        0x2C, 0xC1, 0x02, 0xB6, 0x6C, 0x6D, 0xDA, 0x86,
+        0xE8, 0xF2, 0xDF, 0x32, 0x56, 0x59, 0x88, 0x6F
+      },
+      {
+        0x04, 0xF6, 0xE8, 0x22, 0xF1, 0x7C, 0xC7, 0xA5,
+        0x94, 0x6D, 0xF8, 0x0D, 0x95, 0x8A, 0xEF, 0x06,
+        0x5D, 0x87, 0x49, 0x16, 0xE1, 0x03, 0xA6, 0x83,
+        0x0C, 0x6E, 0x46, 0xB6, 0x05, 0x59, 0x18, 0x18,
+        0x0D, 0x14, 0x52, 0x29, 0x3C, 0x58, 0xA9, 0x74,
+        0x9C, 0xBC, 0x8F, 0x0A, 0xC4, 0x08, 0xA9, 0xCA,
+        0x89, 0x57, 0x61, 0xCF, 0xC4, 0x51, 0x16, 0x46,
+        0x41, 0xA1, 0x79, 0xFB, 0x5C, 0xD8, 0xFE, 0xBC
+      },
+      {
+        0x51, 0x1F, 0xDB, 0x7C, 0x88, 0x26, 0x85, 0x35,
+        0xE9, 0x7E, 0x4E, 0xD8, 0x92, 0xF3, 0xC0, 0x65,
+        0x83, 0x2B, 0x26, 0x59, 0x14, 0xFC, 0x61, 0x07,
+        0xA1, 0xD2, 0x7D, 0xBB, 0x7D, 0x51, 0xC3, 0x7E,
+        0x95, 0x98, 0x15, 0x06, 0xC1, 0x14, 0x72, 0x44,
+        0xD5, 0xBA, 0xE9, 0x0E, 0xE9, 0x0D, 0x08, 0x49,
+        0x84, 0xBA, 0xA7, 0x58, 0x7F, 0x41, 0xFF, 0x6F,
+        0x4B, 0xA7, 0x22, 0xC8, 0xB9, 0x2A, 0xEB, 0x99
+      },
+      {
+        0x2B, 0xA2, 0xBD, 0x17, 0xE9, 0x26, 0x27, 0x5B,
+        0x06, 0x83, 0xB2, 0x36, 0xBF, 0xE3, 0x76, 0x30,
+        0x26, 0x6E, 0x37, 0xF4, 0x18, 0x2F, 0x53, 0xA9,
+        0x82, 0x34, 0xE9, 0x15, 0xAB, 0x64, 0xC9, 0x59,
+        0x96, 0xC6, 0xCB, 0x7A, 0xE8, 0x80, 0xC3, 0xDF,
+        0xCB, 0x47, 0xD0, 0x5A, 0xAD, 0xD2, 0x1A, 0xBF,
+        0x8E, 0x40, 0xB7, 0x3F, 0x40, 0xF3, 0x98, 0xDC,
+        0x5B, 0x02, 0x14, 0x14, 0x57, 0x45, 0x6A, 0x09
+      },
+      {
+        0x9B, 0x66, 0x8D, 0x9B, 0x44, 0x47, 0xE3, 0x76,
+        0xF6, 0xC6, 0xCF, 0xA6, 0x8D, 0xBC, 0x79, 0x19,
+        0x83, 0x81, 0xAB, 0x60, 0x5F, 0x55, 0xD5, 0xA7,
+        0xEF, 0x68, 0x3B, 0xCE, 0xD4, 0x6F, 0x9A, 0xFD,
+        0x36, 0x85, 0x41, 0x1A, 0x66, 0xE2, 0x34, 0x6F,
+        0x96, 0x07, 0x77, 0xD0, 0xC9, 0x22, 0x71, 0x24,
+        0x30, 0xE0, 0x18, 0xBF, 0xAE, 0x86, 0x53, 0x01,
+        0x7E, 0xA2, 0x0E, 0xCD, 0x5F, 0x1F, 0x95, 0x6C
+      },
+      {
+        0x56, 0x81, 0x02, 0x4F, 0x53, 0x85, 0x88, 0xA0,
+        0x1B, 0x2C, 0x83, 0x94, 0xCA, 0xE8, 0x73, 0xC6,
+        0xD8, 0x5D, 0x6A, 0xA0, 0x6E, 0xDD, 0xB3, 0xA5,
+        0x02, 0x09, 0x6F, 0xC0, 0x82, 0xBB, 0x89, 0xCB,
+        0x24, 0x15, 0x31, 0xB3, 0x15, 0x75, 0x0D, 0x31,
+        0xBB, 0x0B, 0x63, 0x01, 0x28, 0xD1, 0x9D, 0x11,
+        0x39, 0x2B, 0xCF, 0x4B, 0x34, 0x78, 0xD5, 0x23,
+        0xD7, 0xD2, 0x13, 0xE4, 0x75, 0x0F, 0x55, 0x92
+      },
+      {
+        0x2A, 0xA9, 0x1B, 0xA6, 0xDE, 0x60, 0x17, 0xF1,
+        0x93, 0x0F, 0xC7, 0xD9, 0x6D, 0xCC, 0xD6, 0x70,
+        0x74, 0x8B, 0x7E, 0xB1, 0xD0, 0x94, 0xDF, 0xB4,
+        0xB3, 0xB1, 0x47, 0x8A, 0x61, 0x2E, 0xBF, 0x03,
+        0xDD, 0xD7, 0x21, 0x27, 0x9A, 0x26, 0x6D, 0xE3,
+        0x88, 0x45, 0xE6, 0x12, 0xC9, 0x30, 0x98, 0xC2,
+        0xEF, 0xFF, 0x34, 0xFE, 0x50, 0x06, 0x17, 0x20,
+        0x5B, 0x1D, 0xE2, 0xFE, 0xA1, 0xD8, 0x02, 0x46
+      },
+      {
+        0x82, 0x4D, 0x89, 0xC0, 0x63, 0x7C, 0xE1, 0x78,
+        0xB6, 0x30, 0x68, 0x4C, 0x72, 0x9E, 0x26, 0x65,
+        0x3F, 0x34, 0xEA, 0xC7, 0xE9, 0x04, 0x12, 0xE9,
+        0x63, 0xD3, 0xF1, 0x9D, 0x64, 0x51, 0xE8, 0x25,
+        0x85, 0x21, 0x67, 0xC4, 0x8D, 0xF7, 0xCC, 0x55,
+        0xB2, 0x57, 0xB2, 0x50, 0xA7, 0x0C, 0x7B, 0xCC,
+        0xFA, 0x9A, 0xA1, 0x5C, 0x18, 0x8A, 0xC4, 0x63,
+        0x7A, 0x52, 0x22, 0x89, 0xC0, 0x87, 0x6A, 0xD4
+      },
+      {
+        0x87, 0xE4, 0xAE, 0x11, 0xDA, 0x1A, 0x2C, 0xA8,
+        0x82, 0x2A, 0xE3, 0x30, 0xDC, 0x97, 0xAB, 0x2E,
+        0x47, 0xFF, 0x62, 0x32, 0x30, 0x93, 0xC2, 0xB7,
+        0xA6, 0xC0, 0xE2, 0xC1, 0x68, 0x21, 0xCD, 0x7C,
+        0xEC, 0x92, 0x18, 0x4D, 0xF4, 0xBB, 0x6E, 0x2B,
+        0x62, 0x6A, 0x44, 0x78, 0x03, 0x90, 0x63, 0xAF,
+        0xEE, 0xB0, 0xD2, 0x87, 0xF2, 0x42, 0x19, 0x20,
+        0x78, 0x98, 0xCC, 0xE7, 0xAD, 0xE0, 0x63, 0x9C
+      },
+      {
+        0xDD, 0x7F, 0x2F, 0x44, 0xA4, 0x02, 0xA0, 0x1E,
+        0x82, 0x16, 0xB1, 0x03, 0xA4, 0xE7, 0x23, 0x5C,
+        0x28, 0x30, 0x31, 0x9D, 0x56, 0xAF, 0x63, 0x9F,
+        0x23, 0xC4, 0x8C, 0x27, 0x59, 0xAB, 0xA6, 0xEB,
+        0x5E, 0xEE, 0xE3, 0x8C, 0x29, 0x8E, 0xBE, 0x41,
+        0x98, 0x26, 0x7A, 0x00, 0xEB, 0x2A, 0x08, 0xD9,
+        0x3A, 0x50, 0x37, 0x03, 0x17, 0x1C, 0x77, 0x33,
+        0x38, 0x62, 0x10, 0x10, 0x55, 0xBD, 0x7A, 0xD2
+      },
+      {
+        0x4C, 0xB8, 0x46, 0x59, 0x61, 0x93, 0xF7, 0xF2,
+        0x78, 0xAA, 0xAA, 0xC5, 0xCC, 0xFF, 0xD5, 0x35,
+        0x7A, 0xB0, 0xD1, 0x24, 0x5F, 0x69, 0x79, 0xD1,
+        0x41, 0xA4, 0x71, 0xBD, 0xAB, 0x55, 0xE2, 0x38,
+        0xB1, 0xAE, 0xD6, 0x7B, 0x73, 0x39, 0x95, 0x04,
+        0xB9, 0x7D, 0xF1, 0xA2, 0x5E, 0xB6, 0xFE, 0x27,
+        0x2B, 0x5C, 0xD4, 0x96, 0xA7, 0xC8, 0xA0, 0x60,
+        0x92, 0x6E, 0x74, 0x04, 0xFD, 0xA0, 0x79, 0x0D
+      },
+      {
+        0x6F, 0x44, 0xEC, 0xDA, 0xE1, 0x4E, 0x3B, 0x81,
+        0xA1, 0x91, 0x22, 0x03, 0x01, 0x5F, 0x59, 0x18,
+        0xEA, 0xC6, 0xFB, 0xF4, 0x96, 0x60, 0x10, 0xF4,
+        0x9D, 0x2B, 0xC2, 0xBC, 0xEF, 0xE7, 0xB1, 0xDF,
+        0xEC, 0x5C, 0x83, 0x5D, 0x7D, 0x87, 0xA4, 0x43,
+        0x71, 0xF1, 0x5A, 0x6C, 0x08, 0x42, 0x52, 0xB9,
+        0x34, 0x65, 0x26, 0x42, 0x72, 0xA4, 0x10, 0xD5,
+        0x0F, 0x89, 0xA1, 0x17, 0xF3, 0x1A, 0xF4, 0x63
+      },
+      {
+        0x1F, 0x70, 0x5F, 0x6E, 0x9F, 0x07, 0x0D, 0x87,
+        0xFD, 0xE8, 0xE2, 0x77, 0x46, 0x74, 0xFA, 0x9B,
+        0xF1, 0x20, 0xD2, 0x88, 0xEB, 0x0B, 0xE7, 0xAA,
+        0x12, 0x8D, 0xFB, 0x5D, 0x10, 0x11, 0xCE, 0x1F,
+        0xDA, 0x99, 0xB2, 0x55, 0x22, 0x66, 0x65, 0xD8,
+        0x3F, 0x63, 0x4E, 0x8F, 0xCA, 0xBD, 0xA9, 0xA2,
+        0x3C, 0x03, 0x51, 0x5E, 0x9C, 0xFE, 0xCE, 0x6E,
+        0x94, 0xA8, 0xEC, 0x92, 0xE4, 0xED, 0xEC, 0xB7
+      },
+      {
+        0x2D, 0x96, 0xC5, 0xB0, 0x15, 0x74, 0x72, 0x2B,
+        0x81, 0x7F, 0xEB, 0x48, 0x6C, 0x5F, 0xC9, 0x8F,
+        0x5F, 0x84, 0x61, 0xF4, 0xCE, 0xE9, 0x90, 0x5A,
+        0xF2, 0x06, 0xD4, 0x72, 0x33, 0x86, 0xD1, 0xC4,
+        0xC7, 0xCA, 0xC5, 0x84, 0x00, 0x28, 0xD7, 0xAF,
+        0xED, 0x0E, 0x38, 0xAD, 0x13, 0x96, 0x28, 0xEB,
+        0x6A, 0xF9, 0x2B, 0x4B, 0x88, 0xEB, 0xF0, 0x9B,
+        0x1F, 0xA0, 0x47, 0xFB, 0xE1, 0x0B, 0xC3, 0x1D
+      },
+      {
+        0x65, 0xDA, 0x78, 0x0A, 0x0A, 0x37, 0x47, 0x9D,
+        0xD8, 0xF4, 0xD6, 0x55, 0x64, 0xF9, 0xA7, 0x08,
+        0x9E, 0x42, 0x07, 0xEB, 0x16, 0xAC, 0xA3, 0xF6,
+        0x55, 0x31, 0xCF, 0xEE, 0x76, 0x25, 0xBA, 0x13,
+        0x80, 0xA4, 0x97, 0xB6, 0x24, 0x72, 0xFC, 0x7E,
+        0x00, 0x07, 0xA6, 0xB0, 0x35, 0x61, 0x04, 0x16,
+        0xA5, 0xF8, 0x2C, 0x10, 0x82, 0xFA, 0x06, 0x5C,
+        0x46, 0xDD, 0xEE, 0x49, 0x40, 0xD1, 0xFC, 0x46
+      },
+      {
+        0x1C, 0x09, 0xA3, 0xB3, 0x80, 0xB8, 0xA7, 0xFC,
+        0x33, 0x3F, 0xD2, 0x71, 0x4D, 0xF7, 0x12, 0x9B,
+        0x44, 0xA4, 0x67, 0x68, 0xBA, 0xCF, 0x0A, 0x67,
+        0xA3, 0x8A, 0x47, 0xB3, 0xAB, 0x31, 0xF5, 0x1B,
+        0x05, 0x33, 0xC2, 0xAA, 0x2B, 0x4B, 0x7B, 0xBB,
+        0x6A, 0xE5, 0xED, 0xF3, 0xDC, 0xB0, 0xEC, 0xC1,
+        0xA2, 0x83, 0xE8, 0x43, 0xF2, 0x90, 0x7B, 0x34,
+        0x1F, 0x17, 0x9A, 0xFD, 0x8B, 0x67, 0xDA, 0x90
+      },
+      {
+        0x67, 0x88, 0x8B, 0x83, 0xFA, 0xAF, 0xBB, 0x62,
+        0x29, 0x34, 0xB8, 0xD5, 0x59, 0x63, 0xE1, 0x86,
+        0x15, 0x3E, 0x59, 0x51, 0x88, 0x7C, 0x7F, 0x4A,
+        0x76, 0x35, 0xC7, 0x98, 0xD9, 0xA5, 0x82, 0x94,
+        0xBE, 0x26, 0xA3, 0xC5, 0x49, 0xC9, 0xFD, 0x59,
+        0x86, 0xAB, 0xD1, 0x9F, 0x40, 0x1E, 0xE2, 0x4E,
+        0xDA, 0x36, 0x02, 0x04, 0x2A, 0xD3, 0x83, 0x35,
+        0x7A, 0x31, 0x7D, 0x38, 0x07, 0x3B, 0x38, 0xCE
+      },
+      {
+        0xB4, 0xF7, 0x99, 0x63, 0xCA, 0x31, 0xBB, 0x62,
+        0x26, 0x5D, 0xD9, 0x29, 0xAF, 0x7D, 0x51, 0x27,
+        0x2F, 0xA6, 0x63, 0x1D, 0xE7, 0xFA, 0x35, 0xF7,
+        0xA6, 0xB0, 0x3F, 0x9F, 0xCF, 0xDB, 0x8E, 0x3B,
+        0x5B, 0xAC, 0xE3, 0x35, 0x91, 0xB7, 0xEC, 0x2C,
+        0xFA, 0xB4, 0x9C, 0x91, 0xA6, 0xDB, 0x1F, 0xF8,
+        0xF6, 0x78, 0x6D, 0x08, 0xF4, 0x4E, 0x80, 0x62,
+        0xD2, 0xFF, 0x69, 0x6A, 0x7D, 0x98, 0x41, 0x42
+      },
+      {
+        0x40, 0x84, 0x83, 0x69, 0x7B, 0xB6, 0xF9, 0xD0,
+        0x11, 0xA1, 0xF2, 0x9A, 0x23, 0xC2, 0x78, 0xA8,
+        0x1D, 0x37, 0x57, 0x8D, 0xCC, 0xCF, 0x42, 0x3B,
+        0xDF, 0x48, 0x93, 0x37, 0xF1, 0x82, 0xEA, 0xB7,
+        0x9A, 0x50, 0xB0, 0x5F, 0x3D, 0x2C, 0xCC, 0x49,
+        0x13, 0x37, 0xC7, 0xE4, 0x1F, 0x30, 0x79, 0x3B,
+        0xD2, 0x7D, 0x76, 0x61, 0xC2, 0xE3, 0x04, 0xC9,
+        0x46, 0xA5, 0xA4, 0x01, 0xAF, 0x8D, 0x94, 0x6F
+      },
+      {
+        0xEE, 0xB5, 0xAD, 0xE1, 0xAB, 0x97, 0xE7, 0x15,
+        0x43, 0x43, 0xA4, 0x6E, 0xB4, 0xCD, 0xD2, 0xA7,
+        0x73, 0xF3, 0x63, 0x01, 0xED, 0xC6, 0xA1, 0xBC,
+        0x1D, 0xD6, 0x48, 0x0E, 0x08, 0xF5, 0x87, 0x65,
+        0xCB, 0x93, 0x87, 0x82, 0x92, 0x3B, 0xC0, 0x1F,
+        0x8E, 0x0C, 0x61, 0xC6, 0xBE, 0x0D, 0xD1, 0xAB,
+        0x4C, 0x18, 0xCB, 0x15, 0xED, 0x52, 0x10, 0x11,
+        0x24, 0x05, 0xF1, 0xEA, 0x8F, 0x2E, 0x8C, 0x4E
+      },
+      {
+        0x71, 0x4A, 0xD1, 0x85, 0xF1, 0xEE, 0xC4, 0x3F,
+        0x46, 0xB6, 0x7E, 0x99, 0x2D, 0x2D, 0x38, 0xBC,
+        0x31, 0x49, 0xE3, 0x7D, 0xA7, 0xB4, 0x47, 0x48,
+        0xD4, 0xD1, 0x4C, 0x16, 0x1E, 0x08, 0x78, 0x02,
+        0x04, 0x42, 0x14, 0x95, 0x79, 0xA8, 0x65, 0xD8,
+        0x04, 0xB0, 0x49, 0xCD, 0x01, 0x55, 0xBA, 0x98,
+        0x33, 0x78, 0x75, 0x7A, 0x13, 0x88, 0x30, 0x1B,
+        0xDC, 0x0F, 0xAE, 0x2C, 0xEA, 0xEA, 0x07, 0xDD
+      },
+      {
+        0x22, 0xB8, 0x24, 0x9E, 0xAF, 0x72, 0x29, 0x64,
+        0xCE, 0x42, 0x4F, 0x71, 0xA7, 0x4D, 0x03, 0x8F,
+        0xF9, 0xB6, 0x15, 0xFB, 0xA5, 0xC7, 0xC2, 0x2C,
+        0xB6, 0x27, 0x97, 0xF5, 0x39, 0x82, 0x24, 0xC3,
+        0xF0, 0x72, 0xEB, 0xC1, 0xDA, 0xCB, 0xA3, 0x2F,
+        0xC6, 0xF6, 0x63, 0x60, 0xB3, 0xE1, 0x65, 0x8D,
+        0x0F, 0xA0, 0xDA, 0x1E, 0xD1, 0xC1, 0xDA, 0x66,
+        0x2A, 0x20, 0x37, 0xDA, 0x82, 0x3A, 0x33, 0x83
+      },
+      {
+        0xB8, 0xE9, 0x03, 0xE6, 0x91, 0xB9, 0x92, 0x78,
+        0x25, 0x28, 0xF8, 0xDB, 0x96, 0x4D, 0x08, 0xE3,
+        0xBA, 0xAF, 0xBD, 0x08, 0xBA, 0x60, 0xC7, 0x2A,
+        0xEC, 0x0C, 0x28, 0xEC, 0x6B, 0xFE, 0xCA, 0x4B,
+        0x2E, 0xC4, 0xC4, 0x6F, 0x22, 0xBF, 0x62, 0x1A,
+        0x5D, 0x74, 0xF7, 0x5C, 0x0D, 0x29, 0x69, 0x3E,
+        0x56, 0xC5, 0xC5, 0x84, 0xF4, 0x39, 0x9E, 0x94,
+        0x2F, 0x3B, 0xD8, 0xD3, 0x86, 0x13, 0xE6, 0x39
+      },
+      {
+        0xD5, 0xB4, 0x66, 0xFF, 0x1F, 0xD6, 0x8C, 0xFA,
+        0x8E, 0xDF, 0x0B, 0x68, 0x02, 0x44, 0x8F, 0x30,
+        0x2D, 0xCC, 0xDA, 0xF5, 0x66, 0x28, 0x78, 0x6B,
+        0x9D, 0xA0, 0xF6, 0x62, 0xFD, 0xA6, 0x90, 0x26,
+        0x6B, 0xD4, 0x0A, 0xB6, 0xF0, 0xBE, 0xC0, 0x43,
+        0xF1, 0x01, 0x28, 0xB3, 0x3D, 0x05, 0xDB, 0x82,
+        0xD4, 0xAB, 0x26, 0x8A, 0x4F, 0x91, 0xAC, 0x42,
+        0x86, 0x79, 0x5F, 0xC0, 0xF7, 0xCB, 0x48, 0x5C
+      },
+      {
+        0x0A, 0x1E, 0x8C, 0x0A, 0x8C, 0x48, 0xB8, 0x4B,
+        0x71, 0xBA, 0x0F, 0xE5, 0x6F, 0xA0, 0x56, 0x09,
+        0x8C, 0xA6, 0x92, 0xE9, 0x2F, 0x27, 0x6E, 0x85,
+        0xB3, 0x38, 0x26, 0xCD, 0x78, 0x75, 0xFC, 0xF8,
+        0x83, 0x85, 0x13, 0x1B, 0x43, 0xDF, 0x74, 0x53,
+        0x2E, 0xAA, 0x86, 0xCF, 0x17, 0x1F, 0x50, 0x76,
+        0xE6, 0xD1, 0x7B, 0x1C, 0x75, 0xFB, 0xA1, 0xDB,
+        0x00, 0x1B, 0x6E, 0x66, 0x97, 0x7C, 0xB8, 0xD7
+      },
+      {
+        0x65, 0xAA, 0x17, 0x99, 0x14, 0x36, 0x93, 0xAB,
+        0xD9, 0xCB, 0x21, 0x8D, 0x9B, 0x5E, 0xC6, 0x0C,
+        0x0E, 0xDD, 0xB0, 0x67, 0xE6, 0xA3, 0x2F, 0x76,
+        0x79, 0x60, 0x10, 0xAC, 0xB1, 0x1A, 0xD0, 0x13,
+        0x6C, 0xE4, 0x9F, 0x97, 0x6E, 0x74, 0xF8, 0x95,
+        0x04, 0x2F, 0x7C, 0xBF, 0x13, 0xFB, 0x73, 0xD1,
+        0x9D, 0xC8, 0x89, 0xD7, 0xE9, 0x03, 0x46, 0x9D,
+        0xEB, 0x33, 0x73, 0x1F, 0x24, 0x06, 0xB6, 0x63
+      },
+      {
+        0xDE, 0xB7, 0x12, 0xB9, 0xCC, 0x64, 0xF5, 0x88,
+        0x14, 0x86, 0x0B, 0x51, 0xFA, 0x89, 0xAD, 0x8A,
+        0x92, 0x6A, 0x69, 0x08, 0xC7, 0x96, 0xDE, 0x55,
+        0x7F, 0x90, 0xCF, 0xAD, 0xB0, 0xC6, 0x2C, 0x07,
+        0x87, 0x2F, 0x33, 0xFE, 0x18, 0x4E, 0x5E, 0x21,
+        0x2A, 0x3C, 0x5C, 0x37, 0x31, 0x74, 0x18, 0x44,
+        0x6E, 0xFD, 0x95, 0x61, 0x3F, 0x61, 0x8A, 0x35,
+        0xF7, 0xD2, 0x78, 0x9E, 0xFE, 0x0D, 0x96, 0x60
+      },
+      {
+        0xB4, 0x2F, 0x4A, 0x40, 0xB3, 0xC8, 0x8B, 0xCE,
+        0xCF, 0xE3, 0x28, 0xC8, 0x46, 0xBF, 0x06, 0x48,
+        0xA1, 0x69, 0x90, 0xCA, 0x53, 0x91, 0x95, 0xC0,
+        0xC1, 0xDC, 0x8D, 0x70, 0x30, 0x80, 0x67, 0x68,
+        0x5A, 0xF6, 0x77, 0xAD, 0x65, 0xAC, 0x0C, 0x7A,
+        0x9B, 0xCF, 0xA8, 0xF7, 0xAC, 0xC0, 0xAA, 0xCF,
+        0x45, 0xCA, 0x18, 0xAC, 0x83, 0x1F, 0xED, 0x64,
+        0x4E, 0xC3, 0xD9, 0x28, 0x31, 0x01, 0xFF, 0xEF
+      },
+      {
+        0xED, 0xCF, 0x6C, 0x81, 0xCC, 0xF1, 0x6E, 0x11,
+        0xDD, 0xF7, 0x19, 0xA3, 0x3D, 0xD0, 0xE5, 0x34,
+        0x9C, 0xAB, 0xAC, 0x5C, 0xFA, 0xE5, 0x97, 0x00,
+        0x98, 0x40, 0xE1, 0xC3, 0x93, 0x62, 0xC0, 0xF1,
+        0x19, 0x82, 0xFE, 0x2C, 0x27, 0x65, 0x85, 0x9A,
+        0x94, 0x26, 0x2D, 0xA2, 0x8D, 0xD3, 0x37, 0x3D,
+        0x52, 0x26, 0x93, 0x89, 0x75, 0x11, 0xEB, 0xA5,
+        0xE0, 0x7B, 0x8B, 0xC6, 0xB6, 0x06, 0x4D, 0xC0
+      },
+      {
+        0x46, 0xB9, 0x62, 0xD2, 0x28, 0x36, 0x94, 0xD2,
+        0x79, 0x75, 0xDC, 0xBF, 0x32, 0x56, 0x4C, 0x9B,
+        0x04, 0x03, 0x2B, 0x30, 0xA9, 0x3E, 0x05, 0x8F,
+        0xB7, 0x7B, 0x2B, 0x71, 0x8B, 0x4A, 0xD5, 0xFB,
+        0x78, 0x9A, 0xB7, 0xD7, 0xAA, 0x90, 0x85, 0x2D,
+        0xA2, 0xBF, 0xB6, 0xB3, 0x93, 0xB0, 0x9F, 0x98,
+        0xE8, 0x69, 0xB1, 0x6E, 0x41, 0x0E, 0x7D, 0xE2,
+        0x30, 0xB1, 0x79, 0xF6, 0x2E, 0xB5, 0x74, 0x71
+      },
+      {
+        0x29, 0x03, 0x6C, 0x3F, 0x53, 0x82, 0xE3, 0x5D,
+        0xE7, 0xA6, 0x9F, 0xA7, 0xA6, 0x3E, 0xC7, 0xBD,
+        0xCB, 0xC4, 0xE0, 0xCC, 0x5A, 0x7B, 0x64, 0x14,
+        0xCF, 0x44, 0xBF, 0x9A, 0x83, 0x83, 0xEF, 0xB5,
+        0x97, 0x23, 0x50, 0x6F, 0x0D, 0x51, 0xAD, 0x50,
+        0xAC, 0x1E, 0xAC, 0xF7, 0x04, 0x30, 0x8E, 0x8A,
+        0xEC, 0xB9, 0x66, 0xF6, 0xAC, 0x94, 0x1D, 0xB1,
+        0xCD, 0xE4, 0xB5, 0x9E, 0x84, 0xC1, 0xEB, 0xBA
+      },
+      {
+        0x17, 0x3F, 0x8A, 0xB8, 0x93, 0x3E, 0xB0, 0x7C,
+        0xC5, 0xFD, 0x6E, 0x4B, 0xCE, 0xBA, 0xE1, 0xFF,
+        0x35, 0xC7, 0x87, 0x9B, 0x93, 0x8A, 0x5A, 0x15,
+        0x79, 0xEA, 0x02, 0xF3, 0x83, 0x32, 0x48, 0x86,
+        0xC7, 0x0E, 0xD9, 0x10, 0x9D, 0xE1, 0x69, 0x0B,
+        0x8E, 0xE8, 0x01, 0xBC, 0x95, 0x9B, 0x21, 0xD3,
+        0x81, 0x17, 0xEB, 0xB8, 0x4A, 0xB5, 0x6F, 0x88,
+        0xF8, 0xA3, 0x72, 0x62, 0x00, 0x2D, 0xD9, 0x8E
+      },
+      {
+        0xC6, 0xAF, 0xA6, 0xA1, 0x91, 0x93, 0x1F, 0xD4,
+        0x5C, 0x3B, 0xAD, 0xBA, 0x72, 0x6E, 0x68, 0xA9,
+        0xBC, 0x73, 0x88, 0xC8, 0xCF, 0x37, 0xAD, 0xEC,
+        0x7C, 0x64, 0x56, 0x1C, 0xF4, 0x81, 0xFD, 0x25,
+        0x9A, 0x64, 0x6C, 0x8B, 0xD8, 0x43, 0xE7, 0x70,
+        0x9E, 0x11, 0xE6, 0x4D, 0xCF, 0xD5, 0xDF, 0xFF,
+        0xED, 0x79, 0x23, 0x5C, 0x68, 0x9B, 0x42, 0x00,
+        0xFE, 0x7A, 0xC8, 0xDF, 0xDA, 0xDD, 0xEC, 0xE0
+      },
+      {
+        0xA6, 0xDC, 0xCD, 0x8C, 0x19, 0x26, 0x64, 0x88,
+        0xBF, 0x77, 0xB9, 0xF2, 0x4B, 0x91, 0x43, 0xDE,
+        0xF1, 0xFE, 0xD6, 0x1D, 0x0C, 0x60, 0xB5, 0x00,
+        0x0A, 0x52, 0x3F, 0x45, 0x0D, 0xA2, 0x3D, 0x74,
+        0xE4, 0xE3, 0xF6, 0xEF, 0x04, 0x09, 0x0D, 0x10,
+        0x66, 0xB6, 0xAC, 0xE8, 0x5A, 0xBC, 0x0F, 0x03,
+        0x01, 0x73, 0xF5, 0x28, 0x17, 0x72, 0x7C, 0x4E,
+        0x40, 0x43, 0x2D, 0xD3, 0x4C, 0x6E, 0xF9, 0xF0
+      },
+      {
+        0xAA, 0xF8, 0x90, 0x8D, 0x54, 0x6E, 0x4F, 0x1E,
+        0x31, 0x4C, 0x00, 0xE9, 0xD2, 0xE8, 0x85, 0x5C,
+        0xB2, 0x56, 0x44, 0x5A, 0xAE, 0x3E, 0xCA, 0x44,
+        0x23, 0x83, 0x22, 0xAE, 0xC7, 0x40, 0x34, 0xA1,
+        0x45, 0x8A, 0x29, 0x36, 0x75, 0xDA, 0xD9, 0x49,
+        0x40, 0x8D, 0xE5, 0x55, 0x4F, 0x22, 0xD7, 0x34,
+        0x54, 0xF3, 0xF0, 0x70, 0x9C, 0xBC, 0xCC, 0x85,
+        0xCB, 0x05, 0x3A, 0x6F, 0x50, 0x38, 0x91, 0xA1
+      },
+      {
+        0x52, 0x5F, 0x4A, 0xAB, 0x9C, 0x32, 0x7D, 0x2A,
+        0x6A, 0x3C, 0x9D, 0xF8, 0x1F, 0xB7, 0xBE, 0x97,
+        0xEE, 0x03, 0xE3, 0xF7, 0xCE, 0x33, 0x21, 0x1C,
+        0x47, 0x78, 0x8A, 0xCD, 0x13, 0x46, 0x40, 0xDD,
+        0x90, 0xAD, 0x74, 0x99, 0x2D, 0x3D, 0xD6, 0xAC,
+        0x80, 0x63, 0x50, 0xF3, 0xBA, 0xBC, 0x7F, 0xE1,
+        0x98, 0xA6, 0x1D, 0xB3, 0x2D, 0x4A, 0xD1, 0xD6,
+        0x56, 0x9A, 0xE8, 0x41, 0x31, 0x04, 0xDE, 0xA4
+      },
+      {
+        0x2D, 0xAC, 0xCD, 0x88, 0x71, 0x9D, 0x0A, 0x00,
+        0xB5, 0x2C, 0x6E, 0xB7, 0x9E, 0x1C, 0xA8, 0xB4,
+        0xA1, 0xB4, 0xB4, 0x4F, 0xFA, 0x20, 0x88, 0x9F,
+        0x23, 0x63, 0xEF, 0x5C, 0x0D, 0x73, 0x7F, 0x1F,
+        0x81, 0xF5, 0x0D, 0xA1, 0xCA, 0xAC, 0x23, 0x1D,
+        0x6F, 0xCB, 0x48, 0x89, 0x5E, 0x72, 0x99, 0xB7,
+        0x7A, 0xF8, 0x1F, 0x0A, 0xA4, 0xA7, 0x61, 0x8A,
+        0xD2, 0x4B, 0x7A, 0xAF, 0xC8, 0xE3, 0xA2, 0xBE
+      },
+      {
+        0x7D, 0x28, 0x6F, 0x1F, 0x72, 0x1E, 0xC2, 0xD2,
+        0x11, 0x5E, 0xF4, 0xCC, 0xD8, 0x28, 0x58, 0xA4,
+        0xD5, 0x12, 0x21, 0x13, 0x55, 0xD4, 0xFC, 0x58,
+        0xE5, 0x34, 0xBF, 0xA5, 0x9C, 0x2E, 0x1B, 0xF5,
+        0x52, 0xA9, 0x6D, 0xC4, 0xB3, 0xE4, 0x6B, 0x01,
+        0x28, 0x65, 0xDA, 0x88, 0x13, 0x4C, 0xF0, 0x4E,
+        0x73, 0x1B, 0x19, 0x30, 0x75, 0x9E, 0x15, 0x8F,
+        0xF6, 0x20, 0xB6, 0xEC, 0x5A, 0xAF, 0xD0, 0x12
+      },
+      {
+        0x21, 0x82, 0x6B, 0x95, 0x29, 0xC4, 0xBC, 0x51,
+        0x91, 0x47, 0xF5, 0xF9, 0xFE, 0x6D, 0xB8, 0x78,
+        0x34, 0x52, 0x15, 0xE5, 0x09, 0x4F, 0x4E, 0x99,
+        0xB1, 0x31, 0xED, 0x54, 0xE2, 0x49, 0x53, 0xCE,
+        0xE9, 0xAD, 0xB7, 0x18, 0xD1, 0x74, 0x3E, 0x6C,
+        0x27, 0xFC, 0x94, 0x51, 0x6A, 0x99, 0x22, 0xFB,
+        0x97, 0x5A, 0x78, 0x16, 0xB8, 0xAA, 0xB0, 0x21,
+        0x12, 0x60, 0x8C, 0x03, 0x2B, 0xF1, 0x38, 0xE3
+      },
+      {
+        0xC1, 0x68, 0x9C, 0x69, 0x8A, 0xB0, 0x65, 0xF6,
+        0x2E, 0xEE, 0x65, 0xDD, 0xCA, 0x67, 0x6B, 0xAA,
+        0x45, 0xB5, 0x2F, 0x30, 0x8A, 0xFA, 0x80, 0x4A,
+        0xB4, 0xAA, 0x6A, 0xB8, 0x4B, 0x7A, 0xC1, 0xAA,
+        0x1D, 0xFF, 0x07, 0x17, 0x56, 0x10, 0xB1, 0x2A,
+        0xE1, 0x1F, 0x27, 0xB7, 0xC4, 0x30, 0xAF, 0xD5,
+        0x75, 0x56, 0xBD, 0x18, 0x1D, 0x02, 0x83, 0x2C,
+        0xD8, 0xD0, 0xA5, 0xFD, 0xC3, 0x02, 0x01, 0x24
+      },
+      {
+        0xA1, 0xA6, 0x28, 0x17, 0x47, 0xE3, 0x4D, 0x3E,
+        0xDE, 0x5E, 0x93, 0x34, 0x01, 0x74, 0x7C, 0xA7,
+        0xF7, 0x66, 0x28, 0xB6, 0x14, 0xC8, 0xA3, 0x94,
+        0xF5, 0x02, 0x56, 0x2B, 0xFE, 0xE0, 0xB9, 0x94,
+        0xEC, 0xB6, 0x5F, 0xBF, 0xE1, 0xFF, 0x70, 0x67,
+        0xDC, 0xB0, 0x1D, 0x02, 0xA9, 0x2B, 0xA4, 0x62,
+        0x20, 0x75, 0x87, 0xCE, 0xF7, 0xDC, 0x2C, 0xFD,
+        0xB4, 0x58, 0x48, 0x48, 0xAD, 0x55, 0x91, 0x4A
+      },
+      {
+        0x00, 0x70, 0xA0, 0x19, 0x0A, 0xA6, 0x96, 0x57,
+        0x2D, 0x85, 0x3F, 0x1D, 0x24, 0xAB, 0x63, 0x08,
+        0x48, 0xAC, 0x56, 0xAD, 0x5C, 0x2E, 0xBF, 0xCF,
+        0xDE, 0x27, 0xD1, 0x11, 0xCD, 0x55, 0x93, 0x9C,
+        0x1E, 0x4D, 0x07, 0x87, 0x2D, 0xDE, 0x7C, 0xE7,
+        0x8B, 0x53, 0x4B, 0x53, 0x0F, 0x0A, 0x39, 0x6E,
+        0x86, 0xAF, 0x9D, 0x57, 0x53, 0x54, 0xB5, 0xD7,
+        0xE3, 0x4A, 0xCD, 0xE1, 0x8C, 0xC7, 0x67, 0xAE
+      },
+      {
+        0x51, 0xB9, 0xB5, 0xED, 0x19, 0x3F, 0xD4, 0xB1,
+        0xA3, 0xA9, 0x2B, 0x46, 0xBD, 0x4B, 0xD1, 0xF6,
+        0xEC, 0x6B, 0x38, 0xA6, 0x0F, 0x2D, 0x02, 0x61,
+        0xD7, 0x2A, 0xBF, 0xD1, 0x64, 0x36, 0x12, 0x8D,
+        0xCB, 0xF2, 0x2C, 0x25, 0xE3, 0xE3, 0xC4, 0x3F,
+        0xE4, 0xD2, 0x9D, 0xB9, 0x12, 0x4D, 0x03, 0x33,
+        0x30, 0x18, 0x45, 0x92, 0xD2, 0x0C, 0x5B, 0x08,
+        0x2C, 0x23, 0x20, 0x64, 0x54, 0xCB, 0x3D, 0xD7
+      },
+      {
+        0x57, 0x8F, 0x24, 0x27, 0x46, 0x91, 0x4E, 0x36,
+        0xD0, 0xD9, 0xD4, 0x80, 0x96, 0x89, 0x57, 0x12,
+        0x16, 0xA4, 0x3E, 0x47, 0x33, 0x32, 0x39, 0x51,
+        0x62, 0x0F, 0x5E, 0xE7, 0x8C, 0xCF, 0xEE, 0x91,
+        0x9B, 0xF5, 0x5F, 0x28, 0x7B, 0x45, 0xA7, 0x3D,
+        0x44, 0x85, 0xAC, 0x74, 0x22, 0x87, 0x92, 0x39,
+        0x65, 0x3B, 0x05, 0x91, 0xC3, 0x6C, 0x86, 0x69,
+        0x41, 0xF8, 0xAF, 0xFE, 0x4A, 0xE5, 0x6E, 0x9E
+      },
+      {
+        0x94, 0x71, 0x30, 0xEF, 0x0B, 0x94, 0x8E, 0xE0,
+        0x45, 0x81, 0xAB, 0xA3, 0xE2, 0xCC, 0x4C, 0xEF,
+        0xC3, 0x8C, 0xCE, 0xDC, 0x86, 0x17, 0x92, 0xB7,
+        0xB5, 0xDC, 0xD9, 0xD9, 0x36, 0x1C, 0x72, 0x4A,
+        0x12, 0x20, 0x03, 0xBF, 0x79, 0x6C, 0xE0, 0x97,
+        0x98, 0x00, 0xAD, 0xAB, 0xC7, 0x45, 0x6F, 0x17,
+        0x3A, 0xE5, 0x26, 0x93, 0x15, 0xAF, 0xC0, 0x1B,
+        0x60, 0x6D, 0xB2, 0x9C, 0x75, 0x50, 0xE8, 0xCA
+      },
+      {
+        0xC8, 0x52, 0xE6, 0x77, 0xF7, 0x7B, 0x14, 0xB5,
+        0x85, 0xBD, 0x10, 0x2A, 0x0F, 0x14, 0x42, 0x43,
+        0x05, 0x9D, 0xAB, 0xEC, 0x7C, 0xB0, 0x1F, 0xFA,
+        0x61, 0xDF, 0x19, 0xFC, 0xE8, 0xAB, 0x43, 0x6B,
+        0xF5, 0xE2, 0xD5, 0xC7, 0x9A, 0xA2, 0xD7, 0xB6,
+        0x77, 0xF6, 0xC3, 0x75, 0xE9, 0x34, 0x3D, 0x34,
+        0x2E, 0x4F, 0xF4, 0xE3, 0xAB, 0x00, 0x1B, 0xC7,
+        0x98, 0x8C, 0x3C, 0x7A, 0x83, 0xCC, 0xB6, 0x9F
+      },
+      {
+        0x01, 0x19, 0x75, 0x26, 0x91, 0x7A, 0xC2, 0xC7,
+        0xBC, 0x53, 0x95, 0x19, 0xE6, 0x8B, 0xB2, 0x79,
+        0x81, 0x35, 0xF6, 0x03, 0x3E, 0xD5, 0x8F, 0x5C,
+        0x45, 0x1E, 0x0C, 0xE9, 0x46, 0xAF, 0xF0, 0xF9,
+        0x8D, 0xFD, 0xD1, 0x51, 0x01, 0x73, 0x1A, 0xC1,
+        0x66, 0x12, 0x6E, 0xAF, 0xB5, 0xE7, 0xCB, 0xE2,
+        0xE2, 0x72, 0xEE, 0x23, 0x3F, 0x34, 0xE5, 0xF3,
+        0xF8, 0xEA, 0x3D, 0x2D, 0x12, 0x24, 0x82, 0xFB
+      },
+      {
+        0x05, 0x9C, 0x90, 0x85, 0x89, 0x5E, 0xB7, 0x18,
+        0x30, 0x4E, 0x2D, 0xDA, 0x78, 0x68, 0x6B, 0xD9,
+        0x57, 0x49, 0x81, 0x5A, 0x5E, 0xE9, 0x02, 0x51,
+        0x0B, 0x00, 0x9A, 0xF6, 0x92, 0x48, 0xB6, 0xA7,
+        0xA7, 0x2F, 0xF8, 0xA6, 0x28, 0xD8, 0x17, 0x73,
+        0xE1, 0x1D, 0x5A, 0x1E, 0x7F, 0x69, 0x7A, 0x44,
+        0x9B, 0x7A, 0x1E, 0x27, 0x12, 0xD5, 0xCF, 0xAE,
+        0x7A, 0xB2, 0x65, 0x07, 0xD1, 0x11, 0x29, 0x18
+      },
+      {
+        0x29, 0x52, 0x43, 0xBD, 0x75, 0x8C, 0xF2, 0x1C,
+        0x80, 0x31, 0x25, 0xFC, 0xF3, 0x21, 0xDE, 0x5F,
+        0x97, 0x98, 0x7C, 0x8D, 0xB3, 0xBB, 0x3C, 0xB5,
+        0x1F, 0xF9, 0x7C, 0x4C, 0xDA, 0xC9, 0xD3, 0xBF,
+        0x0A, 0x67, 0xCE, 0xE7, 0xED, 0x35, 0x0A, 0x41,
+        0xFD, 0xE6, 0xAB, 0xCC, 0x25, 0x4F, 0xBC, 0x9F,
+        0x8E, 0x6B, 0x3E, 0x3C, 0xCE, 0xCB, 0xD0, 0xE4,
+        0xA6, 0x40, 0xA2, 0x0F, 0x36, 0x2B, 0xA3, 0xA0
+      },
+      {
+        0xDD, 0x82, 0x32, 0xD2, 0x41, 0x2C, 0xCE, 0xEC,
+        0xB5, 0x12, 0x31, 0x91, 0xF6, 0xE9, 0x22, 0x1E,
+        0x85, 0x1E, 0xCC, 0xE0, 0xFA, 0xEB, 0xF0, 0x50,
+        0x5F, 0x2A, 0xEE, 0xFF, 0x8A, 0x8C, 0x92, 0xD4,
+        0x1D, 0xAC, 0xF1, 0x77, 0xBD, 0xAE, 0x27, 0x76,
+        0x3E, 0xA4, 0xA8, 0x62, 0x05, 0xEF, 0x76, 0x34,
+        0xF7, 0xA6, 0x87, 0xCC, 0x44, 0xBB, 0xBB, 0xDE,
+        0xEE, 0x5E, 0x11, 0xE6, 0x5F, 0x9F, 0xBD, 0x69
+      },
+      {
+        0xB0, 0x46, 0xB6, 0x83, 0x71, 0x6D, 0x31, 0xC9,
+        0x14, 0xC7, 0x0B, 0x10, 0xF7, 0x64, 0x6D, 0xA3,
+        0x1E, 0xFA, 0xB2, 0x23, 0x63, 0x47, 0x45, 0x9C,
+        0xF8, 0xFA, 0x2C, 0x09, 0x12, 0x34, 0x31, 0xF7,
+        0x28, 0x07, 0xF1, 0x1D, 0x86, 0x7C, 0x37, 0x70,
+        0xB1, 0xF0, 0x61, 0xD5, 0x6C, 0xA0, 0xE5, 0xB1,
+        0xE8, 0x8A, 0x6B, 0x44, 0xA3, 0x3C, 0xF9, 0x3E,
+        0x18, 0xBC, 0xC9, 0xCE, 0xBB, 0xA5, 0xAD, 0xE7
+      },
+      {
+        0x20, 0xE5, 0xA2, 0x55, 0x05, 0x8B, 0xE5, 0x1E,
+        0x1A, 0x62, 0x9B, 0x4E, 0xBF, 0x81, 0xE5, 0xCB,
+        0xE0, 0x78, 0x1C, 0xB6, 0x7C, 0xA4, 0xE5, 0x7B,
+        0xA8, 0x6B, 0x30, 0x88, 0x96, 0xBC, 0xE7, 0x38,
+        0x20, 0xEB, 0x08, 0x43, 0x1C, 0xE8, 0xC9, 0xBC,
+        0x58, 0x10, 0xCC, 0x8D, 0x8B, 0x9C, 0x9D, 0x6F,
+        0xCF, 0x83, 0x4E, 0x42, 0xEA, 0x33, 0xEF, 0x73,
+        0xCE, 0xC4, 0x7D, 0x71, 0x3B, 0x6D, 0x8D, 0xFD
+      },
+      {
+        0x1E, 0x48, 0x04, 0xF9, 0xC0, 0xB1, 0xE8, 0x2B,
+        0x9E, 0xD3, 0x63, 0xBD, 0xE4, 0x47, 0x28, 0xAC,
+        0xF7, 0xD0, 0x90, 0xA1, 0xBF, 0xE2, 0xDD, 0xF8,
+        0x81, 0x9D, 0x65, 0x92, 0xEF, 0x45, 0x3B, 0x83,
+        0x5B, 0xD2, 0xEF, 0xE8, 0xB0, 0x20, 0x6E, 0x29,
+        0x25, 0x5B, 0x07, 0xFB, 0x90, 0xC7, 0xD3, 0x0D,
+        0x2C, 0x11, 0x48, 0x00, 0xB8, 0x6C, 0xB0, 0xE3,
+        0xE0, 0x7D, 0x38, 0x7E, 0x98, 0xCE, 0x95, 0x37
+      },
+      {
+        0x41, 0xC9, 0x53, 0xD8, 0xD2, 0x2A, 0x86, 0xC3,
+        0x63, 0x4D, 0xF4, 0x22, 0xB6, 0xDE, 0x4A, 0x4F,
+        0x14, 0x96, 0x66, 0xBE, 0x8C, 0x4F, 0x58, 0x1B,
+        0x26, 0x23, 0xEE, 0x65, 0xC3, 0x92, 0xA5, 0xC3,
+        0x28, 0x36, 0x63, 0x9E, 0xF5, 0x6B, 0x93, 0x68,
+        0x62, 0x20, 0xF4, 0x5C, 0xE6, 0x5B, 0x4F, 0xA8,
+        0x58, 0x9C, 0x91, 0x25, 0x64, 0x17, 0x90, 0xB6,
+        0x92, 0x5F, 0xAA, 0xD9, 0x48, 0xB8, 0xBE, 0x04
+      },
+      {
+        0x8B, 0xFC, 0xA4, 0xC8, 0xDF, 0xE3, 0xFD, 0xE4,
+        0x25, 0x7B, 0x75, 0xC3, 0xDB, 0x01, 0x86, 0x2E,
+        0xD3, 0x11, 0x67, 0xDE, 0x66, 0xC2, 0xE0, 0x3A,
+        0x25, 0x56, 0xC4, 0xF4, 0x6C, 0x9D, 0xFF, 0xC1,
+        0xAC, 0x45, 0xF7, 0xBC, 0x59, 0xA6, 0x7A, 0xB9,
+        0x36, 0x24, 0xBE, 0xB8, 0x6D, 0xDD, 0x0D, 0x02,
+        0x60, 0x3F, 0x0D, 0xCD, 0x03, 0x64, 0xF0, 0xF8,
+        0x08, 0x81, 0x9B, 0xE9, 0x6C, 0xD8, 0xD3, 0xB6
+      },
+      {
+        0xF6, 0xBF, 0x59, 0xD8, 0xD4, 0x5A, 0x55, 0x71,
+        0x11, 0xA2, 0x36, 0xCB, 0xBA, 0x52, 0x61, 0x9A,
+        0xE3, 0xDF, 0xCC, 0x43, 0x16, 0x94, 0x38, 0x43,
+        0xAF, 0xD1, 0x28, 0x1B, 0x28, 0x21, 0x4A, 0x4A,
+        0x5E, 0x85, 0x1E, 0xF8, 0xC5, 0x4F, 0x50, 0x5E,
+        0x3C, 0x4B, 0x60, 0x0E, 0xFF, 0xBE, 0xBB, 0x3E,
+        0xAC, 0x17, 0x08, 0x7F, 0x22, 0x27, 0x58, 0x12,
+        0x63, 0xF1, 0x7D, 0x7E, 0x5F, 0x68, 0xEA, 0x83
+      },
+      {
+        0x1B, 0xC9, 0xED, 0xE4, 0xD4, 0x1A, 0x4D, 0xF6,
+        0xE8, 0xE6, 0xF4, 0x7C, 0x2F, 0x4A, 0xD8, 0x73,
+        0x37, 0xB6, 0x9B, 0x19, 0xF7, 0x10, 0xF7, 0x66,
+        0xE1, 0xFA, 0xF5, 0xAA, 0x05, 0xA4, 0x3B, 0x66,
+        0x45, 0x39, 0x6E, 0x7F, 0xBE, 0xF4, 0x3B, 0xB7,
+        0x79, 0x5D, 0x39, 0x40, 0x7B, 0x58, 0x15, 0xB9,
+        0x2E, 0xCC, 0x23, 0xA6, 0xC1, 0x24, 0x14, 0x21,
+        0x15, 0x3A, 0x55, 0xD5, 0x1F, 0x12, 0xBF, 0xD8
+      },
+      {
+        0x76, 0xB3, 0x8B, 0x36, 0x31, 0x55, 0x5D, 0xBC,
+        0xFB, 0x21, 0x21, 0x8F, 0xF9, 0xE4, 0x12, 0xA2,
+        0x29, 0x88, 0x9E, 0xF2, 0xCE, 0x8A, 0xD7, 0x05,
+        0xE9, 0x0F, 0x96, 0xAA, 0xBB, 0xD5, 0xBE, 0x7E,
+        0x53, 0x29, 0xA4, 0x26, 0x53, 0x4C, 0x81, 0x5A,
+        0x56, 0x53, 0x77, 0x13, 0x18, 0x72, 0x66, 0x41,
+        0x42, 0x4E, 0x3B, 0x88, 0x29, 0x2F, 0xB1, 0xD8,
+        0x95, 0x44, 0x40, 0x6A, 0xDE, 0x9B, 0xCC, 0xB5
+      },
+      {
+        0xE5, 0x3F, 0x60, 0x07, 0x40, 0x22, 0x4E, 0x4D,
+        0x10, 0xD3, 0x1D, 0x24, 0x38, 0x00, 0x31, 0x43,
+        0xAF, 0xDB, 0x43, 0x6E, 0xB1, 0x79, 0x1B, 0x15,
+        0x0D, 0xE3, 0x56, 0x76, 0xF0, 0xE3, 0x2F, 0x80,
+        0xB0, 0xB6, 0x5F, 0x0A, 0xCF, 0x48, 0x1A, 0x5F,
+        0xBF, 0x95, 0x96, 0xC0, 0xCB, 0x0A, 0x27, 0xC7,
+        0xAF, 0xC1, 0x1D, 0x1E, 0x2C, 0x4D, 0x54, 0x02,
+        0x47, 0x5E, 0x4F, 0xFC, 0xC1, 0xCD, 0xA8, 0x11
+      },
+      {
+        0x62, 0x06, 0xB9, 0x1F, 0xC0, 0xB6, 0xF1, 0x21,
+        0x1E, 0x9F, 0xDE, 0xCD, 0xC9, 0xD5, 0x1A, 0x6F,
+        0x1E, 0xEE, 0x65, 0x54, 0xB1, 0x38, 0xAD, 0xCD,
+        0x4A, 0x82, 0x3D, 0xF0, 0x0D, 0xDE, 0xF6, 0x75,
+        0x9A, 0x9B, 0xFD, 0x7A, 0x4E, 0x98, 0x1E, 0x04,
+        0x52, 0x36, 0x83, 0x8F, 0x4A, 0xF6, 0x93, 0xF6,
+        0x93, 0x77, 0x93, 0x14, 0x84, 0xB3, 0xE8, 0x1E,
+        0x3E, 0x3B, 0xC2, 0xCB, 0x7E, 0xF7, 0x9F, 0xE9
+      },
+      {
+        0x76, 0xFD, 0x02, 0xDA, 0xDD, 0x96, 0x3B, 0xC0,
+        0x35, 0x39, 0x91, 0x46, 0xCE, 0x42, 0x98, 0x8C,
+        0xC0, 0x99, 0xD3, 0xCF, 0x4D, 0x32, 0xDF, 0x5C,
+        0x0B, 0xBF, 0x64, 0x10, 0x12, 0x46, 0xB1, 0xC7,
+        0x08, 0xD1, 0x67, 0xE2, 0x95, 0x95, 0xD1, 0x1D,
+        0x09, 0xB3, 0xF6, 0x34, 0x86, 0xB4, 0x05, 0x26,
+        0xAC, 0x1D, 0xFE, 0x31, 0xBC, 0x22, 0xDE, 0xC7,
+        0x0B, 0x74, 0x5E, 0x90, 0xE2, 0xEA, 0xAF, 0x5A
+      },
+      {
+        0xF0, 0xA1, 0xFB, 0xE3, 0x11, 0x63, 0xE4, 0x21,
+        0x01, 0x50, 0x72, 0x18, 0x3D, 0x68, 0xEE, 0x51,
+        0x91, 0xA9, 0x9C, 0xFD, 0xA1, 0x69, 0xBA, 0x5A,
+        0x19, 0x54, 0xC9, 0xF3, 0x10, 0x7D, 0x4E, 0xCA,
+        0x06, 0x3E, 0x13, 0x7A, 0x71, 0x14, 0xD3, 0x97,
+        0xC9, 0xDB, 0x67, 0x2B, 0x9F, 0x47, 0x8D, 0x41,
+        0xC3, 0x4E, 0x99, 0x1B, 0x06, 0x69, 0xA9, 0x51,
+        0x53, 0x92, 0x90, 0xC8, 0xED, 0x65, 0xE4, 0x6A
+      },
+      {
+        0x13, 0xC7, 0x2A, 0x6A, 0xA5, 0x71, 0xB1, 0x43,
+        0xDC, 0xCF, 0x45, 0xAD, 0xCD, 0x98, 0xEA, 0xE6,
+        0x99, 0xA1, 0x54, 0xB1, 0x10, 0xF2, 0x5E, 0x7E,
+        0x9E, 0x82, 0xB7, 0x65, 0xB9, 0xA0, 0x89, 0x23,
+        0x68, 0x8E, 0x8E, 0x0F, 0xF3, 0x11, 0xA6, 0x8A,
+        0x77, 0x1E, 0x14, 0x50, 0x96, 0xD6, 0x07, 0x76,
+        0xC6, 0xD6, 0xEE, 0x70, 0xAD, 0x6F, 0x69, 0xFA,
+        0x2B, 0x76, 0x77, 0x63, 0x40, 0x55, 0xA0, 0x0E
+      },
+      {
+        0x0E, 0x06, 0x2B, 0xFE, 0x81, 0x8E, 0xE1, 0x0F,
+        0x33, 0x48, 0x1D, 0xEA, 0x43, 0x02, 0x8B, 0x2C,
+        0xFB, 0xB4, 0x9E, 0xC9, 0x5E, 0x0F, 0x75, 0xA9,
+        0xE1, 0x6D, 0x40, 0x4B, 0xC5, 0x19, 0xB9, 0xAD,
+        0x50, 0xB4, 0xA7, 0x33, 0x69, 0x2C, 0xA5, 0x4E,
+        0xFB, 0x68, 0x04, 0x69, 0xED, 0x83, 0xDD, 0xEF,
+        0xBD, 0xDD, 0xB1, 0x39, 0x04, 0x2E, 0x0E, 0x1C,
+        0x09, 0xC3, 0xEB, 0x79, 0x03, 0xFA, 0x08, 0xDF
+      },
+      {
+        0x45, 0x3B, 0xE4, 0xAA, 0xB9, 0xF4, 0x23, 0xB3,
+        0x36, 0x52, 0xA0, 0xB5, 0xD0, 0x2A, 0x9A, 0xF8,
+        0x55, 0xDD, 0x0D, 0x42, 0xDD, 0x83, 0x11, 0x0B,
+        0xA3, 0xBC, 0x4B, 0x39, 0x94, 0xEA, 0x3F, 0x88,
+        0x5A, 0x71, 0x30, 0x89, 0x75, 0x08, 0x9B, 0x49,
+        0x03, 0xE2, 0xE4, 0xD6, 0xBA, 0x6D, 0xC2, 0xE8,
+        0x40, 0x31, 0xFF, 0xE9, 0xC8, 0x56, 0x39, 0x75,
+        0xC8, 0x61, 0x6A, 0xCA, 0x07, 0x42, 0xE8, 0x29
+      },
+      {
+        0x53, 0x61, 0xE3, 0xE8, 0x93, 0xDD, 0x36, 0x0B,
+        0xCB, 0xF5, 0x1C, 0x79, 0x3E, 0xC0, 0x92, 0xA6,
+        0xB0, 0x52, 0x05, 0x4F, 0x5F, 0x00, 0x0B, 0x9F,
+        0xCE, 0x50, 0x7B, 0x66, 0x45, 0xF8, 0xD4, 0x70,
+        0x13, 0xA8, 0x70, 0x6A, 0x58, 0xD4, 0xB1, 0x06,
+        0x29, 0xCC, 0x82, 0xB8, 0xD2, 0xD7, 0x96, 0xFD,
+        0xD3, 0x7B, 0x60, 0x8A, 0x58, 0x79, 0x52, 0xD6,
+        0x55, 0x3E, 0x01, 0xD1, 0xAF, 0x0E, 0x04, 0xB8
+      },
+      {
+        0x74, 0xB5, 0x67, 0x39, 0xF0, 0x1F, 0x82, 0x09,
+        0xA4, 0x04, 0x44, 0xDF, 0x4C, 0xCD, 0xEE, 0xEA,
+        0x8F, 0x97, 0xE8, 0xE7, 0x6E, 0xFA, 0x3C, 0x04,
+        0x33, 0x7F, 0x69, 0x94, 0x5C, 0x4D, 0x44, 0xC0,
+        0x85, 0xF1, 0xF4, 0x78, 0x96, 0x96, 0x36, 0x1E,
+        0x3C, 0x97, 0x77, 0x4A, 0x93, 0x5F, 0x86, 0x0D,
+        0x67, 0x46, 0x86, 0xDC, 0xBA, 0x3D, 0x45, 0xEC,
+        0xD8, 0x63, 0x9A, 0x64, 0xAE, 0xA0, 0x62, 0x1B
+      },
+      {
+        0xB4, 0xD3, 0x15, 0x87, 0xB9, 0x2B, 0x53, 0x61,
+        0xCD, 0xC2, 0xD3, 0xC4, 0x10, 0x86, 0xC1, 0x55,
+        0x3E, 0x7B, 0x55, 0xA1, 0xF6, 0x1E, 0x94, 0xD2,
+        0xBC, 0x30, 0xBC, 0x25, 0x1D, 0xAF, 0x8A, 0x5E,
+        0xBF, 0xC5, 0x07, 0x09, 0xCC, 0x04, 0xCB, 0xAF,
+        0x4B, 0x3B, 0x4D, 0xA2, 0xD2, 0x6B, 0x81, 0x23,
+        0x8F, 0xBA, 0x71, 0x8F, 0xA9, 0x17, 0x59, 0xB8,
+        0x0B, 0xD3, 0x10, 0x3A, 0xEC, 0x11, 0xE0, 0x6F
+      },
+      {
+        0xAA, 0xF6, 0x12, 0x7F, 0x00, 0xA0, 0x3D, 0x96,
+        0x40, 0x6B, 0x9F, 0xB4, 0xAC, 0x70, 0x16, 0x0D,
+        0xB5, 0x22, 0x42, 0x9B, 0x5C, 0xD9, 0x4E, 0x7F,
+        0xA0, 0x30, 0x3A, 0x74, 0x94, 0x78, 0xFE, 0x31,
+        0x89, 0xC8, 0xEA, 0x23, 0x93, 0x0A, 0x66, 0x25,
+        0x2A, 0x80, 0x26, 0x74, 0xDC, 0xAF, 0x77, 0x00,
+        0x46, 0x82, 0x0D, 0xD9, 0x64, 0xC6, 0x6F, 0x0F,
+        0x54, 0x75, 0x1A, 0x72, 0xF9, 0x7D, 0x9C, 0x35
+      },
+      {
+        0x2C, 0x30, 0xD4, 0x8D, 0xF9, 0x98, 0x4E, 0x02,
+        0xF7, 0x5A, 0x94, 0x54, 0x92, 0x17, 0x18, 0x4D,
+        0xD0, 0x2A, 0xAD, 0x3B, 0x57, 0x68, 0x3D, 0x09,
+        0xB5, 0xA8, 0xC2, 0xEF, 0x53, 0xA9, 0x6A, 0xFB,
+        0x73, 0xFE, 0xB6, 0xF9, 0x14, 0xE2, 0xD8, 0x15,
+        0xBB, 0x3B, 0x08, 0x65, 0x43, 0x32, 0xFC, 0xFE,
+        0x79, 0xF8, 0x0E, 0xC5, 0xF0, 0x51, 0xDA, 0x10,
+        0xD7, 0x21, 0x41, 0x3D, 0xDD, 0xE8, 0xFA, 0x60
+      },
+      {
+        0x92, 0xE2, 0xC5, 0xF7, 0x5D, 0x0C, 0xEA, 0xFC,
+        0x81, 0x8F, 0xA7, 0x93, 0x59, 0x39, 0xE4, 0x8B,
+        0x91, 0x59, 0x41, 0xEF, 0x73, 0x4D, 0x75, 0x27,
+        0x0E, 0xB3, 0x21, 0xBA, 0x20, 0x80, 0xEF, 0x6D,
+        0x25, 0x5E, 0x90, 0xEF, 0x96, 0xC6, 0x4C, 0xFF,
+        0x1D, 0x8C, 0x18, 0xF3, 0x3C, 0x2E, 0xAB, 0x10,
+        0x7F, 0xEF, 0x53, 0xE0, 0xD8, 0xBB, 0x16, 0x05,
+        0x16, 0x80, 0x74, 0x80, 0xFC, 0xBA, 0x53, 0x73
+      },
+      {
+        0x6E, 0x03, 0xA9, 0x1E, 0x20, 0x44, 0x46, 0x27,
+        0xE3, 0xD2, 0xE2, 0x22, 0x26, 0xCF, 0x47, 0x00,
+        0x26, 0x69, 0x44, 0x34, 0xED, 0x64, 0x79, 0x82,
+        0x8C, 0xB6, 0xDC, 0x8F, 0x27, 0x96, 0x0A, 0xEE,
+        0xE2, 0xF4, 0xAB, 0x87, 0x2A, 0x5C, 0xA2, 0xF7,
+        0xF6, 0x52, 0xF7, 0xDC, 0x77, 0xD5, 0xF9, 0x6D,
+        0x85, 0x82, 0x8B, 0x8F, 0x9C, 0x2D, 0x6C, 0x23,
+        0x9E, 0x79, 0x77, 0x24, 0xA1, 0x31, 0x31, 0xB1
+      },
+      {
+        0xBA, 0x43, 0x2D, 0xB0, 0xA3, 0x31, 0xBB, 0x8C,
+        0x39, 0xB1, 0x7B, 0xEE, 0x34, 0x46, 0x2B, 0x26,
+        0xDD, 0xB7, 0xAD, 0x91, 0xB6, 0xC7, 0x5A, 0xEC,
+        0x27, 0x65, 0xFB, 0xAE, 0x3A, 0x0E, 0x60, 0xEC,
+        0x54, 0x6D, 0x45, 0xF8, 0xE5, 0x84, 0x37, 0xB9,
+        0xD7, 0x7C, 0x3D, 0x2E, 0x8D, 0x7C, 0xE0, 0x69,
+        0x73, 0x15, 0x66, 0x51, 0xD4, 0x08, 0x22, 0x2A,
+        0xA2, 0x90, 0xCB, 0x58, 0xCA, 0xBC, 0x0A, 0xE5
+      },
+      {
+        0x83, 0xA0, 0x1E, 0x23, 0xAB, 0x27, 0x7B, 0x1F,
+        0xC2, 0x8C, 0xD8, 0xBB, 0x8D, 0xA7, 0xE9, 0x4C,
+        0x70, 0xF1, 0xDE, 0xE3, 0x2D, 0x19, 0x55, 0xCE,
+        0xE2, 0x50, 0xEE, 0x58, 0x41, 0x9A, 0x1F, 0xEE,
+        0x10, 0xA8, 0x99, 0x17, 0x97, 0xCE, 0x3D, 0x20,
+        0x93, 0x80, 0xCA, 0x9F, 0x98, 0x93, 0x39, 0xE2,
+        0xD8, 0xA8, 0x1C, 0x67, 0xD7, 0x37, 0xD8, 0x28,
+        0x8C, 0x7F, 0xAE, 0x46, 0x02, 0x83, 0x4A, 0x8B
+      },
+      {
+        0x0E, 0xA3, 0x21, 0x72, 0xCC, 0x19, 0x1D, 0xFC,
+        0x13, 0x1C, 0xD8, 0x8A, 0xA0, 0x3F, 0xF4, 0x18,
+        0x5C, 0x0B, 0xFA, 0x7B, 0x19, 0x11, 0x12, 0x19,
+        0xEE, 0xCB, 0x45, 0xB0, 0xFF, 0x60, 0x4D, 0x3E,
+        0xDB, 0x00, 0x55, 0x0A, 0xBB, 0xA1, 0x11, 0x52,
+        0x2B, 0x77, 0xAE, 0x61, 0xC9, 0xA8, 0xD6, 0xE9,
+        0x4F, 0xCA, 0x9D, 0x96, 0xC3, 0x8D, 0x6B, 0x7C,
+        0xCE, 0x27, 0x52, 0xF0, 0xD0, 0xC3, 0x7E, 0x78
+      },
+      {
+        0x54, 0xAD, 0xD6, 0x55, 0x2B, 0x08, 0x85, 0x8B,
+        0x23, 0xD6, 0x64, 0x5F, 0x6C, 0xE7, 0x9E, 0x92,
+        0xF3, 0x8B, 0x66, 0xAE, 0x91, 0x86, 0x77, 0xE6,
+        0xD9, 0x1F, 0x71, 0x87, 0xC4, 0x16, 0x05, 0x24,
+        0xDF, 0xA8, 0xD0, 0x1F, 0x00, 0xEA, 0x93, 0xDD,
+        0x29, 0x9F, 0x3C, 0xC4, 0x09, 0x01, 0xBD, 0x33,
+        0x27, 0xA0, 0xF1, 0x8C, 0xCD, 0x7B, 0x6B, 0x8E,
+        0x4E, 0x47, 0xCD, 0x28, 0xCF, 0x83, 0x8F, 0xAB
+      },
+      {
+        0xEF, 0x84, 0x74, 0x6D, 0xC2, 0x01, 0x56, 0xB6,
+        0x6B, 0xA5, 0xC7, 0x8A, 0x50, 0x83, 0x0A, 0xBD,
+        0x2A, 0xEF, 0x90, 0xE6, 0x67, 0xB9, 0x7E, 0xB5,
+        0x22, 0x91, 0xBC, 0x86, 0x9D, 0x8A, 0xA2, 0x45,
+        0x59, 0xA1, 0x42, 0xC6, 0x8F, 0xEA, 0x2E, 0xF3,
+        0x2A, 0xF2, 0x2D, 0xFC, 0xEA, 0x4C, 0x90, 0xB3,
+        0xD4, 0x90, 0x8C, 0xC9, 0xEA, 0x5C, 0xFC, 0x4E,
+        0x91, 0xBF, 0x11, 0xCE, 0x6A, 0x7E, 0x57, 0x61
+      },
+      {
+        0x5A, 0x1B, 0xF3, 0x81, 0xA0, 0x41, 0x19, 0xF9,
+        0x42, 0xE4, 0x63, 0xAB, 0xA2, 0xB1, 0x64, 0x38,
+        0x82, 0x46, 0x8A, 0xEC, 0xC1, 0xB1, 0xAA, 0x1E,
+        0x7B, 0xCA, 0xAB, 0x3B, 0x47, 0x8F, 0xC5, 0xF0,
+        0x56, 0xF1, 0x0D, 0xA9, 0x03, 0x7D, 0x40, 0xFA,
+        0x7F, 0x55, 0x70, 0x8E, 0x10, 0x3B, 0xDA, 0x96,
+        0x5E, 0x92, 0x0C, 0xF6, 0x7C, 0xE3, 0xAD, 0xF7,
+        0xE2, 0x00, 0xE8, 0x61, 0x01, 0x4D, 0xEC, 0xC6
+      },
+      {
+        0xAC, 0xF7, 0x8A, 0xA3, 0x28, 0x45, 0x96, 0xF3,
+        0x30, 0xB7, 0xE8, 0x47, 0x51, 0xB9, 0x4C, 0x31,
+        0x4C, 0xD8, 0x36, 0x36, 0x27, 0xBA, 0x99, 0x78,
+        0x81, 0x30, 0x85, 0x78, 0x87, 0x37, 0x59, 0x89,
+        0x5D, 0x13, 0xDF, 0xFF, 0xA5, 0xE5, 0x74, 0x50,
+        0x13, 0x61, 0xF0, 0x43, 0xC7, 0x4F, 0x57, 0xD2,
+        0xD0, 0xF1, 0x5C, 0x7A, 0x41, 0xC7, 0xC4, 0x5E,
+        0x3C, 0x09, 0xAD, 0x89, 0xD6, 0x99, 0xA9, 0x77
+      },
+      {
+        0x18, 0xB3, 0xE9, 0x04, 0x38, 0x44, 0xD4, 0xF3,
+        0xA2, 0xD0, 0x21, 0xF5, 0x4C, 0x38, 0xFA, 0xCC,
+        0x36, 0x4F, 0x84, 0xBA, 0x10, 0x58, 0xF2, 0x10,
+        0x09, 0xFC, 0x37, 0x1D, 0x2E, 0x4F, 0x38, 0xC7,
+        0x27, 0x51, 0x8A, 0xAB, 0xA6, 0xA2, 0x9E, 0x0F,
+        0xDA, 0xE6, 0xE7, 0x60, 0xA4, 0xF1, 0xA6, 0xD7,
+        0x58, 0xEB, 0xE4, 0x2C, 0x2A, 0xFC, 0x9D, 0x2C,
+        0xDC, 0x6D, 0xD5, 0x80, 0x77, 0x8C, 0x4B, 0x32
+      },
+      {
+        0x18, 0x96, 0xB2, 0x31, 0x70, 0x33, 0xCF, 0x31,
+        0x04, 0x68, 0x73, 0xD8, 0x7F, 0x26, 0xE6, 0xA4,
+        0x2A, 0x9D, 0x77, 0x0B, 0xBA, 0xF6, 0xE0, 0x62,
+        0xDF, 0x11, 0xF9, 0xB4, 0xA0, 0xEA, 0xB2, 0x75,
+        0xAA, 0xB1, 0x2C, 0xAA, 0xC2, 0xD3, 0xF5, 0x29,
+        0xEB, 0x20, 0xD0, 0x70, 0xFD, 0x84, 0x4D, 0x86,
+        0xD0, 0xA5, 0x71, 0xCD, 0xF6, 0x28, 0x5F, 0x80,
+        0xE2, 0x30, 0x8B, 0xB8, 0x2C, 0x6C, 0x5B, 0x3B
+      },
+      {
+        0x8C, 0x3D, 0xC4, 0x01, 0x94, 0xAA, 0x02, 0x1F,
+        0x3C, 0x4A, 0x1F, 0x9A, 0x05, 0x5E, 0x4D, 0x41,
+        0x9E, 0xB3, 0xA2, 0x6D, 0x4C, 0x2F, 0x1A, 0x8C,
+        0x7E, 0x18, 0x8B, 0x73, 0x48, 0x13, 0x40, 0x80,
+        0xB6, 0x3F, 0x6E, 0x57, 0x0A, 0xD1, 0x1C, 0x28,
+        0x78, 0x66, 0x53, 0x55, 0x41, 0x9C, 0x10, 0x20,
+        0xDE, 0x4B, 0x65, 0x5E, 0x7A, 0x6C, 0x2C, 0xCD,
+        0xE9, 0x07, 0x2C, 0xD4, 0x27, 0xFE, 0x8C, 0x4E
+      },
+      {
+        0x70, 0xAE, 0x04, 0x30, 0xD5, 0x45, 0xEC, 0x42,
+        0x7F, 0x85, 0x41, 0x21, 0x1D, 0x4F, 0xE0, 0x42,
+        0xB9, 0x82, 0x3A, 0xCE, 0xC0, 0x4B, 0x15, 0xC9,
+        0x0B, 0x7F, 0x4B, 0x8B, 0xDD, 0x3D, 0xC7, 0x85,
+        0x19, 0x90, 0xF3, 0x70, 0xE7, 0x14, 0x16, 0x75,
+        0x10, 0x66, 0x49, 0xD3, 0x91, 0x51, 0x09, 0x03,
+        0x18, 0x23, 0x1E, 0x4D, 0xED, 0x51, 0x22, 0x5D,
+        0x9A, 0x6F, 0xA6, 0xC4, 0x24, 0x69, 0x5D, 0xE2
+      },
+      {
+        0x07, 0x33, 0x6C, 0x42, 0xBD, 0x51, 0x49, 0x0E,
+        0xF8, 0x4D, 0xFB, 0xDF, 0xAB, 0x74, 0x66, 0xF6,
+        0xB6, 0x39, 0x99, 0xA5, 0xC0, 0x88, 0x72, 0xDF,
+        0xED, 0xA0, 0x20, 0x6F, 0xDA, 0x80, 0xB9, 0xA6,
+        0x2D, 0xE7, 0x28, 0xE3, 0xE3, 0xC3, 0xFD, 0x6B,
+        0x7D, 0x21, 0xA4, 0x38, 0xAA, 0xD1, 0xB8, 0xDD,
+        0x22, 0x38, 0x63, 0xC0, 0xD2, 0x6A, 0xCA, 0x27,
+        0x79, 0x01, 0x74, 0xD9, 0xD4, 0x42, 0xA6, 0x4C
+      },
+      {
+        0x79, 0x26, 0x70, 0x88, 0x59, 0xE6, 0xE2, 0xAB,
+        0x68, 0xF6, 0x04, 0xDA, 0x69, 0xA9, 0xFB, 0x50,
+        0x87, 0xBB, 0x33, 0xF4, 0xE8, 0xD8, 0x95, 0x73,
+        0x0E, 0x30, 0x1A, 0xB2, 0xD7, 0xDF, 0x74, 0x8B,
+        0x67, 0xDF, 0x0B, 0x6B, 0x86, 0x22, 0xE5, 0x2D,
+        0xD5, 0x7D, 0x8D, 0x3A, 0xD8, 0x7D, 0x58, 0x20,
+        0xD4, 0xEC, 0xFD, 0x24, 0x17, 0x8B, 0x2D, 0x2B,
+        0x78, 0xD6, 0x4F, 0x4F, 0xBD, 0x38, 0x75, 0x82
+      },
+      {
+        0x92, 0x80, 0xF4, 0xD1, 0x15, 0x70, 0x32, 0xAB,
+        0x31, 0x5C, 0x10, 0x0D, 0x63, 0x62, 0x83, 0xFB,
+        0xF4, 0xFB, 0xA2, 0xFB, 0xAD, 0x0F, 0x8B, 0xC0,
+        0x20, 0x72, 0x1D, 0x76, 0xBC, 0x1C, 0x89, 0x73,
+        0xCE, 0xD2, 0x88, 0x71, 0xCC, 0x90, 0x7D, 0xAB,
+        0x60, 0xE5, 0x97, 0x56, 0x98, 0x7B, 0x0E, 0x0F,
+        0x86, 0x7F, 0xA2, 0xFE, 0x9D, 0x90, 0x41, 0xF2,
+        0xC9, 0x61, 0x80, 0x74, 0xE4, 0x4F, 0xE5, 0xE9
+      },
+      {
+        0x55, 0x30, 0xC2, 0xD5, 0x9F, 0x14, 0x48, 0x72,
+        0xE9, 0x87, 0xE4, 0xE2, 0x58, 0xA7, 0xD8, 0xC3,
+        0x8C, 0xE8, 0x44, 0xE2, 0xCC, 0x2E, 0xED, 0x94,
+        0x0F, 0xFC, 0x68, 0x3B, 0x49, 0x88, 0x15, 0xE5,
+        0x3A, 0xDB, 0x1F, 0xAA, 0xF5, 0x68, 0x94, 0x61,
+        0x22, 0x80, 0x5A, 0xC3, 0xB8, 0xE2, 0xFE, 0xD4,
+        0x35, 0xFE, 0xD6, 0x16, 0x2E, 0x76, 0xF5, 0x64,
+        0xE5, 0x86, 0xBA, 0x46, 0x44, 0x24, 0xE8, 0x85
+      },
+      {
+        0xDA, 0x85, 0x0A, 0x2F, 0x54, 0xE9, 0x44, 0x89,
+        0x17, 0xD0, 0xDC, 0xAA, 0x63, 0x93, 0x7B, 0x95,
+        0xA4, 0xDA, 0x1E, 0xAC, 0x8A, 0xF4, 0xDD, 0xF2,
+        0x11, 0x3E, 0x5C, 0x8B, 0x0D, 0x4D, 0xB2, 0x66,
+        0x9A, 0xF3, 0xC2, 0xAC, 0xB0, 0x80, 0x3D, 0x05,
+        0x32, 0x3F, 0x3E, 0xC5, 0x5A, 0xBD, 0x33, 0xBD,
+        0xF9, 0xB2, 0xBE, 0x89, 0x0E, 0xE7, 0x9E, 0x7F,
+        0x3F, 0xCE, 0x4E, 0x19, 0x86, 0x96, 0xA7, 0xA3
+      },
+      {
+        0xF1, 0x60, 0x95, 0xDD, 0x9F, 0x1E, 0xEB, 0x77,
+        0xD5, 0xB9, 0x2F, 0x4B, 0x1F, 0xAC, 0x3A, 0x2C,
+        0x5D, 0xA6, 0xAE, 0x5D, 0x0A, 0xB3, 0xF2, 0x54,
+        0xE2, 0xA7, 0xFE, 0x52, 0x67, 0x24, 0x11, 0xD0,
+        0x1C, 0xFA, 0x6A, 0xC0, 0x5B, 0xF3, 0x9E, 0xF6,
+        0x5F, 0x4B, 0x22, 0x26, 0x4B, 0x41, 0xC3, 0xF3,
+        0x63, 0x56, 0x3A, 0xBF, 0x0E, 0x92, 0x42, 0x90,
+        0xC1, 0xC6, 0x80, 0xB1, 0x8A, 0xA6, 0x5B, 0x44
+      },
+      {
+        0x76, 0xD0, 0x0A, 0x09, 0xC5, 0xBD, 0xD3, 0x9E,
+        0xD3, 0x28, 0x71, 0x72, 0x2C, 0xFA, 0x00, 0x47,
+        0x67, 0x4B, 0xEC, 0x8D, 0x35, 0x17, 0x5A, 0xF9,
+        0x0D, 0x7A, 0xE9, 0x10, 0x74, 0x40, 0xA2, 0xA0,
+        0x63, 0x88, 0x56, 0xD8, 0x38, 0x4C, 0x81, 0x7D,
+        0x77, 0x2A, 0x4A, 0x59, 0x7A, 0x89, 0x55, 0x49,
+        0xC8, 0x48, 0x66, 0x37, 0x56, 0x31, 0xCB, 0xA0,
+        0x42, 0xF0, 0xEF, 0x6F, 0xFE, 0xB8, 0x9D, 0x44
+      },
+      {
+        0xA6, 0x51, 0x13, 0x7B, 0x2C, 0x47, 0xFB, 0x79,
+        0x51, 0xE7, 0xBD, 0xA7, 0x15, 0x43, 0xA6, 0xEB,
+        0xC6, 0x24, 0x2A, 0xCA, 0xB4, 0x34, 0x7D, 0x38,
+        0x8B, 0xE8, 0x35, 0x0F, 0x0C, 0x3F, 0xA3, 0xDF,
+        0x8D, 0x95, 0x2C, 0x7C, 0x8A, 0x3D, 0xAF, 0x01,
+        0xE0, 0x6C, 0x1D, 0xA6, 0x94, 0x96, 0xBB, 0xA8,
+        0xDE, 0x62, 0xD8, 0x6B, 0x50, 0x93, 0x25, 0x6F,
+        0x77, 0xA1, 0x87, 0xB5, 0x3D, 0xB0, 0x39, 0x88
+      },
+      {
+        0xF3, 0x2F, 0x15, 0x0C, 0x2D, 0x67, 0xC0, 0xC4,
+        0x37, 0x40, 0x1B, 0x70, 0xF6, 0x0B, 0x38, 0xF0,
+        0xA3, 0xA4, 0x70, 0x59, 0x03, 0x3E, 0x75, 0x05,
+        0xE6, 0x9A, 0x1D, 0x30, 0x12, 0x96, 0x03, 0x0B,
+        0xC9, 0xB2, 0x95, 0x19, 0xC7, 0xF8, 0xB7, 0xD5,
+        0x9A, 0x71, 0xFA, 0xB9, 0x05, 0x57, 0xDC, 0x3D,
+        0xC8, 0x23, 0xFA, 0xC9, 0x5B, 0x9E, 0x85, 0xE6,
+        0x52, 0x52, 0x8C, 0xBF, 0xB0, 0x1B, 0x11, 0x78
+      },
+      {
+        0x27, 0x02, 0x56, 0x61, 0x36, 0xC4, 0x92, 0xF4,
+        0x10, 0x89, 0xB0, 0x60, 0x10, 0x84, 0x60, 0xFA,
+        0x30, 0x22, 0xC9, 0xC2, 0x5D, 0x34, 0x3B, 0xCB,
+        0xD8, 0xAF, 0x2A, 0xF1, 0x9C, 0x17, 0xEF, 0x4C,
+        0xA9, 0xF2, 0x22, 0x4F, 0xE7, 0xC4, 0x70, 0x0A,
+        0x10, 0x19, 0x8E, 0xE5, 0x24, 0x8F, 0x30, 0x0B,
+        0x54, 0x8E, 0xBF, 0x5C, 0x8E, 0x71, 0x16, 0x32,
+        0x0C, 0xC8, 0x93, 0xFF, 0x7E, 0x23, 0x1F, 0xFB
+      },
+      {
+        0xFF, 0xE6, 0x87, 0x9F, 0x46, 0xB6, 0x29, 0x2B,
+        0x21, 0x96, 0x97, 0x2E, 0x3F, 0xDF, 0x4F, 0xE9,
+        0xEA, 0x4A, 0x81, 0x6D, 0x18, 0x07, 0xA3, 0x1C,
+        0xAE, 0xAD, 0x6A, 0xAC, 0x5F, 0x06, 0x3C, 0x8F,
+        0xE8, 0x77, 0x79, 0x75, 0x59, 0xA7, 0x59, 0xA0,
+        0x0F, 0x8B, 0xA8, 0xF6, 0x68, 0xD8, 0x96, 0x8F,
+        0xB3, 0x1D, 0x8A, 0x3B, 0x84, 0x57, 0x35, 0x90,
+        0x2C, 0x5E, 0x42, 0xE2, 0x89, 0xEE, 0x0B, 0x62
+      },
+      {
+        0x14, 0x48, 0x84, 0x28, 0x68, 0x22, 0xC2, 0x51,
+        0x2D, 0x61, 0xB0, 0x46, 0xE6, 0x74, 0xD8, 0x6B,
+        0x26, 0x4E, 0x9C, 0xC6, 0x89, 0x3E, 0xFF, 0x36,
+        0x73, 0x11, 0x24, 0xF5, 0x9D, 0x1A, 0x82, 0x00,
+        0x1E, 0x63, 0xF3, 0xE8, 0x05, 0x1C, 0xFE, 0x52,
+        0xE7, 0x59, 0x7E, 0x28, 0x73, 0x8E, 0x3C, 0x3A,
+        0x70, 0xF1, 0xBE, 0xD9, 0x68, 0x0E, 0x2C, 0x0E,
+        0xF3, 0x72, 0x8B, 0x10, 0xA5, 0x6E, 0xD9, 0x87
+      },
+      {
+        0x17, 0xC3, 0xF1, 0x46, 0xEE, 0x8D, 0xEC, 0x3B,
+        0xAF, 0xCB, 0x51, 0xC0, 0xDA, 0x37, 0xF1, 0x78,
+        0x71, 0xF2, 0x34, 0xC4, 0xA0, 0xFB, 0x7F, 0xA6,
+        0xD0, 0x70, 0x7A, 0x54, 0x3E, 0x3C, 0xBF, 0x3A,
+        0xDB, 0x81, 0xE3, 0x0C, 0x1E, 0x0A, 0xE9, 0xE1,
+        0xAC, 0xE7, 0x22, 0x3B, 0xDA, 0x99, 0xBD, 0x59,
+        0x19, 0xA3, 0xCF, 0xCC, 0x92, 0xC6, 0xA7, 0x55,
+        0xE4, 0x56, 0xF0, 0x93, 0x82, 0x3B, 0xD3, 0x3E
+      },
+      {
+        0x1B, 0x83, 0x7A, 0xF2, 0x33, 0xA8, 0xA6, 0x8B,
+        0xE7, 0x09, 0x52, 0xF7, 0x83, 0xC4, 0x96, 0x1A,
+        0x81, 0x52, 0xD1, 0xE0, 0xB0, 0xFA, 0x32, 0x5F,
+        0xF0, 0x86, 0xEA, 0x5B, 0x5F, 0x13, 0x12, 0xB8,
+        0x9C, 0x42, 0xE0, 0x1B, 0x8C, 0x3A, 0x47, 0x7C,
+        0xB5, 0x40, 0xC0, 0x6B, 0x2F, 0x37, 0xEE, 0x0E,
+        0x39, 0x24, 0xD7, 0x45, 0xB4, 0xFF, 0x5C, 0x6A,
+        0xF7, 0xD6, 0x1E, 0x0E, 0x37, 0xAC, 0x19, 0x31
+      },
+      {
+        0x78, 0x97, 0x88, 0x0C, 0x1E, 0xB0, 0x0F, 0xD2,
+        0x56, 0x7A, 0xE8, 0xA5, 0x9E, 0x64, 0x82, 0xAF,
+        0xE1, 0x73, 0x49, 0xCF, 0x93, 0x92, 0x4A, 0x91,
+        0x5F, 0x8C, 0x59, 0x26, 0x93, 0xD4, 0x52, 0x07,
+        0x55, 0x19, 0x68, 0x9D, 0xFC, 0xD2, 0x93, 0xE3,
+        0x76, 0x89, 0x7B, 0x3B, 0x0E, 0x03, 0x6F, 0x11,
+        0x4F, 0xE8, 0x1E, 0xBC, 0xB3, 0x15, 0x36, 0x71,
+        0xBD, 0x23, 0xBC, 0x2B, 0xED, 0x46, 0xF9, 0xC2
+      },
+      {
+        0xCA, 0x7B, 0x6C, 0x77, 0x5D, 0x20, 0x1E, 0x5B,
+        0x5A, 0x77, 0x22, 0x61, 0xDE, 0x52, 0x8E, 0x47,
+        0x5F, 0x4B, 0xDE, 0x51, 0x76, 0x60, 0x52, 0x9F,
+        0x41, 0xBE, 0xEB, 0x15, 0x78, 0xB2, 0x4B, 0xCB,
+        0x94, 0xB9, 0x41, 0x0F, 0x9B, 0xF3, 0x36, 0xC1,
+        0x09, 0xF9, 0xD4, 0x70, 0x93, 0xA1, 0x0B, 0xA6,
+        0xDE, 0xBE, 0x50, 0x43, 0x80, 0xD9, 0xD1, 0x50,
+        0x73, 0xBD, 0xD1, 0x11, 0xC8, 0xD1, 0x29, 0xFA
+      },
+      {
+        0x57, 0x18, 0xE0, 0xD4, 0x5D, 0xEB, 0xC3, 0x00,
+        0x2D, 0x52, 0xB2, 0x2C, 0x52, 0x73, 0x29, 0xAE,
+        0x5E, 0xBF, 0x27, 0xE8, 0xFA, 0x9C, 0x8F, 0xEA,
+        0xB4, 0x6C, 0x40, 0xBC, 0x64, 0x22, 0xCA, 0x03,
+        0x35, 0x30, 0x4C, 0xF9, 0xE7, 0xF1, 0x41, 0xDE,
+        0x7F, 0xA6, 0xAD, 0xB6, 0x78, 0x9B, 0xDB, 0xF3,
+        0x8D, 0x14, 0xDA, 0xBA, 0x3E, 0x62, 0x97, 0xD2,
+        0x5B, 0xF1, 0x7D, 0xE1, 0x70, 0xD6, 0xE3, 0xC8
+      },
+      {
+        0x48, 0xD0, 0xED, 0x24, 0x9F, 0x90, 0x28, 0x41,
+        0x99, 0x7C, 0x25, 0x5D, 0xAF, 0x99, 0x08, 0x9C,
+        0x9A, 0x31, 0x24, 0x69, 0x8B, 0x16, 0x4A, 0x30,
+        0x28, 0x33, 0x0F, 0xDD, 0x4C, 0xEE, 0x41, 0xE1,
+        0x68, 0x3F, 0xA4, 0xD9, 0xDC, 0x66, 0xB2, 0xA7,
+        0x9C, 0x8A, 0xA4, 0xC8, 0x28, 0x4E, 0x27, 0xBE,
+        0xE2, 0xA4, 0x28, 0xA6, 0x71, 0x9D, 0x6E, 0xC6,
+        0x55, 0xED, 0x76, 0x9D, 0xCB, 0x62, 0x4E, 0x24
+      },
+      {
+        0x79, 0x4E, 0x0B, 0x64, 0xAC, 0xE1, 0xFE, 0x5A,
+        0xE3, 0x79, 0x93, 0x70, 0x68, 0xD8, 0x2D, 0xF0,
+        0x48, 0x68, 0x61, 0x6C, 0xAE, 0x0C, 0x17, 0xD3,
+        0x05, 0x72, 0xC2, 0x02, 0x4E, 0x77, 0x48, 0x94,
+        0xE0, 0x66, 0x8C, 0x47, 0x2D, 0x62, 0x3C, 0x90,
+        0x3C, 0xC5, 0x88, 0x5F, 0x17, 0x84, 0x94, 0x51,
+        0x10, 0x32, 0x9E, 0xB4, 0x98, 0xA8, 0x95, 0xA9,
+        0xE5, 0x9A, 0x75, 0xE5, 0x27, 0x15, 0x8A, 0x5C
+      },
+      {
+        0x21, 0x79, 0xAA, 0x82, 0x0E, 0x03, 0xFA, 0x33,
+        0xD9, 0xBD, 0xE5, 0x56, 0x8C, 0x26, 0x2E, 0x2D,
+        0x34, 0x17, 0xA4, 0x02, 0xE0, 0x7A, 0x59, 0x1F,
+        0x9D, 0x55, 0x70, 0x68, 0x2D, 0xB5, 0xF9, 0xBB,
+        0xA4, 0xBB, 0x9D, 0x5A, 0x82, 0xEE, 0x5E, 0xFD,
+        0xB4, 0xF6, 0x5B, 0xBB, 0xFE, 0xEE, 0x2F, 0x4A,
+        0xB9, 0xE4, 0x6C, 0xF2, 0xCE, 0x7E, 0x3B, 0x05,
+        0x43, 0x27, 0xA7, 0x18, 0xD3, 0xF1, 0x08, 0x06
+      },
+      {
+        0xB0, 0xA4, 0x8C, 0x6A, 0xDA, 0x54, 0x87, 0x25,
+        0x79, 0x9B, 0x59, 0x86, 0xBA, 0xB4, 0x32, 0x69,
+        0x79, 0x60, 0x92, 0x24, 0xD8, 0x97, 0x18, 0x4B,
+        0x89, 0x97, 0x10, 0x4E, 0x0C, 0x6A, 0x24, 0xB3,
+        0xAB, 0xE5, 0x62, 0x16, 0x54, 0x22, 0xA4, 0x5D,
+        0x8A, 0xC8, 0x19, 0xB9, 0x9D, 0x37, 0x56, 0xEB,
+        0xBB, 0x64, 0xF8, 0x43, 0xE3, 0xE0, 0x93, 0x4D,
+        0xEC, 0x48, 0x7A, 0xED, 0x12, 0x13, 0x72, 0x79
+      },
+      {
+        0x84, 0x8D, 0x7F, 0x2E, 0xAD, 0x41, 0x29, 0x1D,
+        0x05, 0x38, 0x68, 0x0C, 0x64, 0x9D, 0x07, 0x89,
+        0x7E, 0x45, 0xC7, 0x0A, 0x0A, 0xA4, 0xF9, 0x35,
+        0x3F, 0x82, 0xC3, 0xF6, 0xFB, 0xB8, 0xE8, 0x48,
+        0x9C, 0x75, 0x3E, 0x90, 0xDB, 0xE8, 0x89, 0x00,
+        0x41, 0xA1, 0xAE, 0xEF, 0x84, 0xCD, 0x31, 0x36,
+        0x43, 0x4F, 0x53, 0x0E, 0x9D, 0xD9, 0xC2, 0x3F,
+        0xA5, 0x4F, 0xE1, 0x24, 0xEA, 0xFB, 0x72, 0xAD
+      },
+      {
+        0x0E, 0xD1, 0x46, 0x26, 0xEE, 0x6D, 0x0C, 0x8E,
+        0xD3, 0xF0, 0xC2, 0x00, 0xC1, 0x29, 0x85, 0x0F,
+        0xFF, 0x76, 0x31, 0x8F, 0xFF, 0xA1, 0xDD, 0xD7,
+        0xDD, 0x56, 0x3A, 0x01, 0xB7, 0x77, 0x97, 0x06,
+        0x86, 0x2B, 0x23, 0x99, 0x59, 0xB6, 0x15, 0xAE,
+        0x2E, 0xBE, 0x27, 0xC4, 0x50, 0x37, 0xE6, 0xFF,
+        0xAF, 0x99, 0x14, 0xDA, 0x8F, 0xF2, 0x77, 0x2B,
+        0xA5, 0xEE, 0x08, 0x11, 0xCD, 0x9E, 0xD5, 0x32
+      },
+      {
+        0x52, 0x03, 0xC0, 0x76, 0x38, 0xC4, 0xB6, 0x5F,
+        0x78, 0x43, 0x1E, 0x8B, 0x02, 0xE2, 0x0F, 0x6D,
+        0x68, 0x3F, 0x19, 0xFA, 0x8F, 0x83, 0xB5, 0x13,
+        0x4C, 0xD0, 0xF4, 0xE4, 0x68, 0xC9, 0x7E, 0xAC,
+        0xB5, 0x26, 0x7C, 0x7D, 0x3E, 0xAB, 0x58, 0x3C,
+        0xCA, 0xAC, 0xD0, 0xDB, 0xA4, 0xD5, 0x8A, 0xCE,
+        0x52, 0x19, 0x3A, 0x51, 0x78, 0xA7, 0xB1, 0x2D,
+        0x27, 0x95, 0xF5, 0xFD, 0xE8, 0xA3, 0x7B, 0xB9
+      },
+      {
+        0x48, 0xBE, 0x43, 0xD5, 0xE0, 0x04, 0x36, 0x88,
+        0xDF, 0x35, 0x32, 0xF7, 0x12, 0x1A, 0xFF, 0xFA,
+        0x16, 0x7D, 0xAB, 0xE4, 0xA4, 0x84, 0xFB, 0x75,
+        0xA0, 0x3A, 0xF3, 0x04, 0xA5, 0xC6, 0xF8, 0x25,
+        0xF3, 0x6C, 0xEC, 0xCB, 0xBB, 0xC0, 0x75, 0xEE,
+        0xF3, 0x20, 0xC4, 0xCD, 0x8D, 0x7E, 0xF8, 0xCB,
+        0x49, 0xE6, 0xDD, 0x59, 0x73, 0x37, 0x9E, 0xEC,
+        0x4C, 0x23, 0x3C, 0x45, 0x43, 0xD1, 0x32, 0xCE
+      },
+      {
+        0xB5, 0x46, 0x4E, 0x6A, 0xBA, 0xF5, 0xD3, 0xD4,
+        0x08, 0x3D, 0x1D, 0x7D, 0x2A, 0x8B, 0x0B, 0xAB,
+        0x78, 0xB6, 0x17, 0x09, 0x50, 0x0B, 0xBF, 0x77,
+        0x82, 0x3F, 0x60, 0x2D, 0x57, 0xD5, 0x13, 0xCA,
+        0x9E, 0x9F, 0xFF, 0x65, 0xEF, 0xAA, 0x89, 0x9C,
+        0xFE, 0x7B, 0xF8, 0x8A, 0x01, 0x88, 0x82, 0x9C,
+        0x24, 0xE4, 0x98, 0xAD, 0x00, 0x23, 0x5A, 0xBE,
+        0x8E, 0xEF, 0xA7, 0x19, 0xFA, 0x6A, 0xE6, 0xF6
+      },
+      {
+        0xAF, 0xE5, 0xE5, 0xE8, 0x3F, 0x19, 0xAD, 0xAD,
+        0x9E, 0x95, 0x90, 0x3E, 0xA9, 0xB2, 0x98, 0x10,
+        0x7D, 0x37, 0xDD, 0x38, 0x63, 0x2C, 0x95, 0x90,
+        0xBB, 0xFF, 0xC6, 0x24, 0xD4, 0xDE, 0x95, 0x8C,
+        0xB6, 0xB6, 0x1A, 0xF0, 0x80, 0xF0, 0x37, 0xAD,
+        0x17, 0xD0, 0x35, 0xB6, 0xBF, 0x58, 0xF7, 0x80,
+        0xFA, 0xDF, 0x70, 0xF3, 0xC9, 0x59, 0x66, 0x8A,
+        0x1B, 0x47, 0x21, 0x98, 0xA5, 0x9A, 0x8A, 0x00
+      },
+      {
+        0xEF, 0xA2, 0xC7, 0xC8, 0x02, 0xE2, 0x10, 0xD2,
+        0xD8, 0x0F, 0xB3, 0x50, 0xB3, 0xC2, 0xCB, 0x31,
+        0x56, 0x13, 0x18, 0x11, 0xE7, 0x18, 0xEE, 0xE5,
+        0xC9, 0xC6, 0x64, 0x0F, 0x87, 0x68, 0x2A, 0x55,
+        0x81, 0x2B, 0x10, 0xF4, 0x03, 0x10, 0xBA, 0xA7,
+        0xB8, 0x2B, 0x27, 0x3E, 0xF3, 0xAC, 0xC5, 0x5F,
+        0xED, 0xE0, 0xB5, 0xF1, 0x94, 0x9D, 0xE4, 0x29,
+        0x3D, 0x91, 0xB5, 0x89, 0xA2, 0x17, 0x5F, 0xF7
+      },
+      {
+        0xD6, 0xC6, 0x2A, 0x61, 0x82, 0x71, 0xF3, 0xBC,
+        0xBE, 0x00, 0x79, 0x24, 0xA0, 0xC9, 0x81, 0x2F,
+        0x83, 0x17, 0x44, 0x5F, 0xB6, 0xFB, 0x19, 0xEB,
+        0x58, 0x9A, 0x62, 0x9F, 0x51, 0x2F, 0xB3, 0x8A,
+        0x0B, 0x4E, 0x24, 0x7D, 0xEA, 0x88, 0xC5, 0x6A,
+        0x1B, 0xAF, 0x17, 0x88, 0x33, 0x65, 0xB4, 0x36,
+        0xF2, 0x84, 0x46, 0xFF, 0x66, 0xEA, 0x43, 0x18,
+        0x0B, 0xD0, 0x1E, 0xB5, 0xA6, 0x50, 0x9B, 0xD5
+      },
+      {
+        0x0B, 0x41, 0x16, 0x6B, 0xE6, 0x2F, 0x65, 0xE1,
+        0x93, 0xB3, 0xB8, 0x65, 0xE6, 0xC4, 0x7A, 0xAD,
+        0x26, 0x0A, 0xF5, 0xFC, 0xEE, 0xC9, 0xAB, 0x44,
+        0xAB, 0xAA, 0x46, 0x0A, 0x0C, 0x02, 0x46, 0xB6,
+        0xC6, 0x9B, 0x67, 0xD7, 0x1D, 0x3A, 0xDF, 0xEC,
+        0x60, 0xDC, 0x8E, 0x77, 0x37, 0x2F, 0x09, 0x49,
+        0x52, 0x34, 0x4F, 0xE1, 0x0C, 0x0D, 0x59, 0xEF,
+        0xEC, 0x0E, 0x11, 0xC4, 0xA5, 0x16, 0x93, 0x6D
+      },
+      {
+        0x79, 0xD5, 0xF9, 0xFF, 0xC0, 0x5E, 0xCF, 0x33,
+        0x7D, 0xE9, 0xF1, 0xE0, 0xF1, 0xD8, 0x9B, 0x30,
+        0xAC, 0xFE, 0xBB, 0xB8, 0x8A, 0x69, 0x35, 0x86,
+        0x78, 0x18, 0xCD, 0x8D, 0x45, 0xDA, 0x3D, 0x25,
+        0x18, 0xDE, 0x61, 0xA7, 0xFE, 0x28, 0x75, 0x1B,
+        0x61, 0x8F, 0x7A, 0x87, 0x5E, 0x11, 0x89, 0x8F,
+        0xFF, 0x74, 0x15, 0x7A, 0xB9, 0x06, 0x81, 0xBD,
+        0x53, 0xFA, 0x69, 0x62, 0x67, 0x1E, 0xD9, 0x9D
+      },
+      {
+        0xBE, 0xA9, 0x83, 0xD7, 0x6F, 0x24, 0xB1, 0xEE,
+        0xDE, 0x1D, 0x06, 0x71, 0x48, 0x05, 0x76, 0x8F,
+        0xAA, 0xAD, 0x47, 0x08, 0xC9, 0xA4, 0xFF, 0x9C,
+        0xD2, 0x42, 0x2F, 0x70, 0x6B, 0x6F, 0x0C, 0x30,
+        0x6D, 0x8B, 0x67, 0xF3, 0x40, 0x89, 0xC6, 0x5E,
+        0xD3, 0x88, 0x0C, 0x75, 0xF6, 0x7B, 0xBC, 0x4D,
+        0x89, 0xAD, 0x87, 0x12, 0x0A, 0x77, 0xD0, 0xFF,
+        0xE4, 0x36, 0xFB, 0x7B, 0x58, 0xB2, 0xCA, 0x41
+      },
+      {
+        0x46, 0x6F, 0xD9, 0x15, 0xEF, 0xD9, 0x50, 0xBC,
+        0x96, 0x65, 0x78, 0xCD, 0x92, 0xC6, 0x85, 0x92,
+        0x9D, 0x7B, 0x51, 0xA6, 0x3D, 0xB1, 0x42, 0xC7,
+        0xB9, 0xA9, 0x3D, 0x16, 0x52, 0x04, 0x95, 0x31,
+        0x9B, 0x87, 0xF6, 0x58, 0xE6, 0xAF, 0xDA, 0x1B,
+        0x42, 0x77, 0x3E, 0x2D, 0x49, 0xDA, 0x81, 0x45,
+        0x94, 0xA5, 0x54, 0x90, 0x89, 0xEF, 0xB1, 0xF3,
+        0xAB, 0x5F, 0x15, 0x90, 0xCA, 0x0A, 0x02, 0xAF
+      },
+      {
+        0xF6, 0x46, 0x11, 0x13, 0x7A, 0xD2, 0x95, 0x46,
+        0x70, 0xEA, 0xEC, 0xD6, 0x26, 0xD2, 0x12, 0xCF,
+        0xC5, 0xB9, 0xF6, 0xBB, 0x41, 0xAA, 0xEB, 0xB1,
+        0xD7, 0x1E, 0x89, 0x79, 0x2E, 0xB1, 0x31, 0x7A,
+        0xED, 0xC6, 0x38, 0x13, 0xFE, 0x63, 0xDE, 0x40,
+        0x17, 0x98, 0xDF, 0x75, 0x6C, 0xA1, 0xF2, 0x20,
+        0x35, 0xA0, 0xFA, 0xBD, 0x37, 0xFB, 0x11, 0x03,
+        0x43, 0x7F, 0x89, 0x1E, 0xAD, 0x5E, 0x64, 0x29
+      },
+      {
+        0x32, 0xE1, 0xF9, 0x38, 0xA2, 0x7F, 0xAA, 0xD8,
+        0xAC, 0x4A, 0x13, 0xFD, 0x4F, 0x6A, 0x8B, 0xF3,
+        0xDA, 0xBE, 0x4B, 0xC7, 0x2A, 0xF1, 0x1C, 0x8F,
+        0x0E, 0x1A, 0x06, 0x56, 0x7E, 0xD7, 0x04, 0xB8,
+        0xE7, 0x8E, 0x11, 0x40, 0xA0, 0xC7, 0x72, 0x4E,
+        0x3E, 0xFB, 0x70, 0xD2, 0x38, 0x07, 0xCF, 0x38,
+        0xE6, 0x27, 0xE3, 0x26, 0xAF, 0xC1, 0x64, 0xCD,
+        0xED, 0x52, 0xB4, 0x41, 0x39, 0xFF, 0xB3, 0xF3
+      },
+      {
+        0x48, 0x33, 0xAC, 0x92, 0xE3, 0x02, 0xAC, 0x2B,
+        0x67, 0xB0, 0x2B, 0x88, 0x27, 0x14, 0x3B, 0xAD,
+        0xA1, 0x5C, 0xED, 0x22, 0x0E, 0x1D, 0x1F, 0x5B,
+        0x71, 0x12, 0x0C, 0x51, 0xEE, 0x54, 0xC1, 0x9D,
+        0x30, 0x1F, 0x29, 0x60, 0xBD, 0xB5, 0xA2, 0xCE,
+        0x27, 0xD4, 0x41, 0xD1, 0x4A, 0xF0, 0x80, 0xCB,
+        0x01, 0x0A, 0x8A, 0x23, 0xEE, 0xFF, 0x58, 0x11,
+        0xDF, 0xA4, 0x4D, 0x1D, 0x7B, 0x35, 0x8B, 0x48
+      },
+      {
+        0x9A, 0x03, 0x88, 0xCE, 0xE1, 0xAD, 0x01, 0x46,
+        0x17, 0x7C, 0x48, 0xB5, 0xA0, 0x8A, 0x2D, 0xB3,
+        0xC4, 0x89, 0xE8, 0x4C, 0xE2, 0xAB, 0xA8, 0xC6,
+        0x45, 0x11, 0x2A, 0x02, 0x1E, 0x41, 0x1C, 0xF8,
+        0x29, 0x12, 0x7F, 0xA2, 0xF1, 0xD1, 0xAE, 0x1B,
+        0xAF, 0x3A, 0x33, 0xEA, 0x53, 0x09, 0x84, 0x77,
+        0xA7, 0xD1, 0x2B, 0xA7, 0x48, 0xD2, 0xAF, 0x24,
+        0xD1, 0x66, 0x02, 0xE9, 0x19, 0x07, 0x76, 0x23
+      },
+      {
+        0xE3, 0xDF, 0x00, 0x74, 0xA9, 0x37, 0x35, 0x13,
+        0x0D, 0x99, 0x22, 0xD2, 0xBE, 0x91, 0x6F, 0x35,
+        0x34, 0x3D, 0x98, 0x8C, 0xE5, 0x9D, 0x76, 0x97,
+        0x15, 0xA9, 0x83, 0xB4, 0xBA, 0x80, 0x7C, 0xE1,
+        0xEE, 0x70, 0xA3, 0x13, 0xE5, 0x92, 0x31, 0x58,
+        0x4F, 0x55, 0x6E, 0xBB, 0xA1, 0xB9, 0x0B, 0x1B,
+        0xB6, 0xA6, 0xC5, 0x81, 0xA4, 0xB4, 0x7C, 0x3F,
+        0xF5, 0x21, 0x89, 0x65, 0x2A, 0xAB, 0x36, 0xF5
+      },
+      {
+        0x91, 0x91, 0xCF, 0x46, 0x1B, 0x69, 0x59, 0xBE,
+        0xC9, 0x3E, 0xAE, 0x7F, 0xB1, 0xC6, 0xE3, 0x70,
+        0x73, 0xD1, 0xA6, 0x15, 0x27, 0xAD, 0x75, 0xD1,
+        0x0B, 0x7F, 0x89, 0x49, 0xD9, 0xB8, 0xAF, 0x70,
+        0xA2, 0x3A, 0xD1, 0x31, 0x2E, 0xD5, 0x1F, 0x70,
+        0xF0, 0xE9, 0xDF, 0x60, 0x1D, 0xDA, 0xE2, 0x38,
+        0x90, 0x6C, 0x0F, 0xE3, 0xF7, 0x66, 0xB1, 0x4F,
+        0x11, 0x3B, 0x26, 0xBC, 0x85, 0x42, 0xD1, 0xD2
+      },
+      {
+        0x2A, 0x8B, 0xAD, 0xE2, 0x72, 0xEE, 0x7A, 0xC6,
+        0x43, 0xC5, 0xE3, 0x71, 0x47, 0xFA, 0xAC, 0x92,
+        0xC3, 0x97, 0x0B, 0xD3, 0x86, 0x2F, 0x53, 0x1E,
+        0x5D, 0xCE, 0xA5, 0xCE, 0xAC, 0xD1, 0x83, 0x74,
+        0x53, 0xAA, 0x49, 0x8D, 0x78, 0x5B, 0x4D, 0x1F,
+        0x89, 0xE1, 0xB2, 0xA7, 0x39, 0xCA, 0x4A, 0x38,
+        0x49, 0x87, 0x30, 0x27, 0x46, 0xB4, 0xF1, 0x13,
+        0x42, 0x43, 0x02, 0xC4, 0xA1, 0xE0, 0xF9, 0xDF
+      },
+      {
+        0x32, 0x3E, 0x67, 0x93, 0xC7, 0xDD, 0x9B, 0x4D,
+        0x7B, 0xB7, 0xFB, 0xF2, 0x15, 0x31, 0xD3, 0x7F,
+        0x72, 0x64, 0x53, 0x2C, 0x58, 0xF1, 0x22, 0x55,
+        0x48, 0xD0, 0x6E, 0x69, 0x40, 0xC6, 0x3E, 0x91,
+        0x27, 0x09, 0x90, 0xE7, 0xF5, 0x64, 0x32, 0x03,
+        0xC9, 0x87, 0x64, 0x7E, 0x5C, 0xF6, 0x61, 0x03,
+        0xE7, 0x9B, 0x71, 0x4C, 0x58, 0x1B, 0xD8, 0x77,
+        0x2E, 0x19, 0xD0, 0xF0, 0x05, 0xDC, 0x86, 0x33
+      },
+      {
+        0xF9, 0x22, 0x07, 0x6D, 0x29, 0x5D, 0x23, 0xE2,
+        0x98, 0x58, 0x30, 0xAA, 0xD2, 0xF2, 0x3F, 0x65,
+        0x2F, 0x7F, 0x4D, 0xB4, 0x2C, 0x11, 0x9E, 0xD2,
+        0x20, 0xA5, 0x45, 0x14, 0x88, 0xA4, 0x53, 0xF5,
+        0x9F, 0xA8, 0xA2, 0xDE, 0x23, 0x03, 0x00, 0x0D,
+        0x6B, 0xFD, 0x8C, 0x48, 0x23, 0xA8, 0x5F, 0xAD,
+        0xB4, 0xFB, 0x8E, 0x7E, 0xAC, 0x12, 0x2B, 0xF0,
+        0x12, 0x47, 0xD7, 0x6F, 0x65, 0x24, 0x7D, 0x45
+      },
+      {
+        0xDC, 0x40, 0x00, 0x95, 0x60, 0x95, 0x92, 0x91,
+        0x55, 0x8E, 0xBE, 0x07, 0x20, 0x64, 0xCE, 0x67,
+        0x12, 0xC9, 0x21, 0xB5, 0x40, 0x9B, 0x44, 0xE0,
+        0x4F, 0x9A, 0x56, 0x5E, 0xEA, 0xDD, 0x39, 0xA7,
+        0x71, 0x6E, 0x21, 0xB4, 0x6D, 0xD8, 0x61, 0x65,
+        0x17, 0xA2, 0x1A, 0x0C, 0x03, 0x41, 0x9E, 0x94,
+        0xDB, 0x82, 0x0A, 0x35, 0x3F, 0x15, 0x2D, 0x10,
+        0x83, 0x84, 0xBE, 0x94, 0x70, 0x09, 0x3F, 0x89
+      },
+      {
+        0x7F, 0xA4, 0xBE, 0x91, 0xCA, 0x52, 0x07, 0xFF,
+        0x08, 0x7D, 0xE9, 0x2F, 0x1D, 0xB0, 0x9B, 0xF7,
+        0x1A, 0x67, 0x87, 0x8B, 0xED, 0x19, 0x3A, 0x5C,
+        0x2C, 0xC4, 0xE3, 0x53, 0x23, 0xB8, 0xDF, 0x99,
+        0xA2, 0x6E, 0xCB, 0x98, 0x88, 0xD7, 0xB3, 0x4A,
+        0x73, 0x9D, 0x64, 0x1A, 0x0E, 0xCD, 0x0A, 0x66,
+        0x47, 0xA6, 0xA0, 0x64, 0x26, 0xF3, 0xCC, 0x1F,
+        0xEF, 0xDF, 0x90, 0x69, 0x92, 0x2F, 0xAE, 0x4C
+      },
+      {
+        0xBA, 0xD3, 0xCD, 0x75, 0x90, 0x5D, 0x7B, 0xFD,
+        0xA3, 0x32, 0x2B, 0x44, 0xA7, 0xD3, 0x58, 0x87,
+        0x14, 0xD3, 0x33, 0xEE, 0x86, 0x85, 0x5A, 0x87,
+        0x27, 0x47, 0xE7, 0x04, 0xF6, 0x11, 0x94, 0x84,
+        0xBD, 0xB7, 0xD0, 0x77, 0xFA, 0x08, 0xED, 0xC4,
+        0xA7, 0x9D, 0xE0, 0xF4, 0x3F, 0xCA, 0x8D, 0x43,
+        0x6E, 0x8A, 0x10, 0x08, 0x57, 0xF5, 0x9B, 0xC7,
+        0xB0, 0x55, 0xB9, 0x87, 0xF9, 0x7A, 0xC6, 0xB9
+      },
+      {
+        0xB7, 0xDE, 0xE8, 0xE8, 0x33, 0x9D, 0xB2, 0x97,
+        0xFD, 0xAA, 0x3C, 0xA5, 0xC1, 0xDC, 0x19, 0x88,
+        0xD9, 0x7F, 0x5F, 0xB6, 0x20, 0x8C, 0x64, 0xDE,
+        0xA9, 0x5E, 0x1C, 0x78, 0xF3, 0x37, 0xCE, 0x20,
+        0xA2, 0xB4, 0xDF, 0x17, 0xA7, 0xB8, 0x23, 0x6A,
+        0x90, 0xD6, 0x28, 0x67, 0x33, 0x16, 0x35, 0x72,
+        0xC8, 0x67, 0xD9, 0x3D, 0xE8, 0x9E, 0xF6, 0x2F,
+        0xA0, 0x5D, 0xAB, 0x70, 0x7E, 0xC3, 0xA7, 0x70
+      },
+      {
+        0xA0, 0xF7, 0xE9, 0x3C, 0xF3, 0x25, 0x02, 0xB9,
+        0xFD, 0x79, 0xEC, 0x20, 0x54, 0x62, 0x07, 0xF3,
+        0x31, 0xC5, 0x29, 0x9E, 0xCE, 0xF3, 0x50, 0xD6,
+        0x6E, 0xA8, 0x55, 0xC8, 0x7F, 0xBD, 0xDF, 0x18,
+        0xE6, 0x91, 0xC2, 0x0D, 0x04, 0x5A, 0x30, 0x8F,
+        0x83, 0xF6, 0xCB, 0x8F, 0xCA, 0x69, 0xD7, 0xE2,
+        0xB3, 0x9B, 0x34, 0xD2, 0xF8, 0x77, 0x27, 0x6C,
+        0x19, 0x6B, 0xF5, 0x14, 0xBA, 0xC6, 0x02, 0x70
+      },
+      {
+        0x6F, 0x50, 0x93, 0xCF, 0xC8, 0x83, 0x00, 0xBF,
+        0x68, 0x8E, 0x88, 0x4B, 0x4C, 0x5E, 0xC2, 0xC3,
+        0x1A, 0x8C, 0xC2, 0x8D, 0x63, 0x31, 0xAD, 0x7C,
+        0xA7, 0x1D, 0x97, 0x60, 0x21, 0x64, 0x82, 0x05,
+        0x28, 0x15, 0xD4, 0x4F, 0xC6, 0x9E, 0x18, 0xA8,
+        0xDC, 0x8B, 0xD7, 0x1B, 0x31, 0xF2, 0xB5, 0x89,
+        0xA7, 0xC0, 0x78, 0x0B, 0x61, 0x99, 0x38, 0x5F,
+        0x8D, 0xAE, 0x6C, 0x9B, 0x79, 0x74, 0xC4, 0xCB
+      },
+      {
+        0x3C, 0xFF, 0x46, 0xAC, 0x35, 0x46, 0xF6, 0x5A,
+        0xD7, 0xA7, 0x20, 0x87, 0x1A, 0xFA, 0x20, 0xA9,
+        0x21, 0x6D, 0xDA, 0x5C, 0x45, 0x18, 0x81, 0x56,
+        0xA5, 0xBB, 0xED, 0xF2, 0x15, 0x46, 0xD4, 0xBB,
+        0x39, 0x40, 0xB2, 0x1A, 0x41, 0xA3, 0x94, 0x03,
+        0xE3, 0xCF, 0xD5, 0xE7, 0xA0, 0xE7, 0x90, 0x4D,
+        0xA9, 0x5F, 0x4D, 0x8E, 0x0C, 0x5B, 0xF5, 0xB7,
+        0x0E, 0xB0, 0x29, 0x55, 0x6E, 0xFD, 0x49, 0x7E
+      },
+      {
+        0xAF, 0x66, 0x8A, 0x80, 0x5E, 0x6D, 0x70, 0x4B,
+        0x1E, 0x58, 0x1F, 0x1E, 0x8E, 0x3C, 0x00, 0xCF,
+        0x4C, 0xF3, 0xE5, 0x46, 0x14, 0x7C, 0x40, 0x6D,
+        0x17, 0xCA, 0x97, 0x4D, 0x19, 0xA0, 0x14, 0xC7,
+        0x8B, 0x44, 0xE7, 0x2D, 0xDE, 0xEB, 0x65, 0x26,
+        0x07, 0xE8, 0x6D, 0x69, 0x02, 0x59, 0xDC, 0xAB,
+        0x0D, 0xDA, 0x81, 0xC7, 0x7C, 0x7E, 0xE2, 0x72,
+        0x1E, 0x82, 0xBB, 0xB1, 0x39, 0x43, 0x07, 0x1D
+      },
+      {
+        0x79, 0xDD, 0xEB, 0x5C, 0x54, 0xDE, 0xD1, 0xE4,
+        0x48, 0x40, 0x71, 0xC4, 0x6B, 0xB4, 0x28, 0x02,
+        0xD2, 0x3B, 0x3A, 0x08, 0xC1, 0x23, 0x11, 0xBE,
+        0x36, 0x3C, 0x7C, 0x7A, 0x02, 0x5A, 0x17, 0x64,
+        0xC8, 0xD8, 0x50, 0x69, 0xFD, 0xA8, 0xD5, 0x17,
+        0x77, 0x7D, 0x8D, 0xD8, 0x09, 0xE3, 0xD4, 0xA9,
+        0x56, 0x04, 0x1A, 0x70, 0x79, 0xF9, 0x16, 0x7B,
+        0x0F, 0xE9, 0x71, 0x2E, 0x5F, 0x12, 0x29, 0xF5
+      },
+      {
+        0x99, 0x8E, 0x82, 0xF4, 0x26, 0x3D, 0x53, 0xAE,
+        0xDA, 0xC9, 0x39, 0xEB, 0xB6, 0xEB, 0x8B, 0x19,
+        0x69, 0x74, 0x6C, 0xB8, 0x15, 0xBD, 0x72, 0x1F,
+        0x17, 0xA4, 0x8B, 0xEE, 0x9E, 0xCF, 0xF2, 0xFE,
+        0x59, 0x8C, 0x53, 0x9C, 0x41, 0x9A, 0x60, 0xE0,
+        0xD5, 0xA0, 0x4F, 0x1C, 0xB5, 0x23, 0xA2, 0xFD,
+        0x05, 0x38, 0xBB, 0x17, 0x8E, 0x44, 0x75, 0x8D,
+        0x31, 0x59, 0xAB, 0x9E, 0x02, 0x84, 0x01, 0xA3
+      },
+      {
+        0x33, 0x96, 0xCF, 0xD5, 0xCD, 0xE1, 0x4A, 0xEC,
+        0x1A, 0xAE, 0xD3, 0xE1, 0x22, 0x52, 0xCF, 0xD6,
+        0xE3, 0x42, 0xED, 0x25, 0x5E, 0x8E, 0x9E, 0x1B,
+        0xE1, 0x0F, 0x1F, 0x27, 0x38, 0x77, 0xF3, 0x63,
+        0x33, 0x81, 0xE3, 0xC9, 0x61, 0xE6, 0x7E, 0xC4,
+        0x1E, 0x8F, 0x9E, 0x16, 0x11, 0x0F, 0xC0, 0x3D,
+        0xDE, 0x88, 0xBF, 0xC0, 0x96, 0xFC, 0x15, 0x14,
+        0x46, 0x1D, 0x70, 0xD0, 0xBE, 0xCE, 0x0A, 0xF6
+      },
+      {
+        0x77, 0x7D, 0x9D, 0xC5, 0x5A, 0x2F, 0x57, 0xA4,
+        0x6E, 0xA0, 0x6A, 0x2F, 0x4C, 0xB9, 0x76, 0x0D,
+        0x00, 0xD7, 0xA8, 0x62, 0xD0, 0xA2, 0xAA, 0x19,
+        0x46, 0x7B, 0x57, 0x0F, 0x7C, 0x7D, 0x5E, 0xA7,
+        0x62, 0x9A, 0x95, 0xEB, 0x20, 0x0E, 0x1F, 0x9D,
+        0xB0, 0x66, 0x10, 0xCF, 0x8E, 0x30, 0xD5, 0xE6,
+        0xAD, 0x0A, 0x7B, 0x63, 0x29, 0x77, 0xFC, 0x21,
+        0xBB, 0x17, 0x89, 0x67, 0xF3, 0xB0, 0xE0, 0x9B
+      },
+      {
+        0x32, 0xEE, 0x35, 0x7F, 0xC9, 0x16, 0x36, 0xA8,
+        0x55, 0xBA, 0x01, 0xA0, 0xB8, 0xDA, 0x6F, 0x35,
+        0x53, 0xB1, 0xD5, 0x20, 0xAD, 0xCF, 0xE8, 0xFE,
+        0x9D, 0xEB, 0xCC, 0xB2, 0x6C, 0x5C, 0x4C, 0xE8,
+        0x50, 0x5B, 0xB1, 0xEF, 0xB5, 0xED, 0x5B, 0xAA,
+        0x4C, 0x52, 0x45, 0xB5, 0x0D, 0x74, 0x46, 0x3F,
+        0x07, 0x67, 0xB2, 0xC7, 0x83, 0xC4, 0x7A, 0x93,
+        0xB0, 0xFD, 0xA6, 0x68, 0x95, 0x69, 0x3C, 0xE6
+      },
+      {
+        0x34, 0x0C, 0x0A, 0x7C, 0xE4, 0x96, 0xFE, 0xBD,
+        0xA1, 0x3F, 0xA2, 0x40, 0x7A, 0x21, 0xDC, 0x19,
+        0x83, 0x9B, 0xED, 0xAE, 0x1A, 0x08, 0x6A, 0xD0,
+        0xFE, 0xD3, 0x91, 0x7D, 0xF9, 0xBF, 0x40, 0x94,
+        0x4A, 0x78, 0x7F, 0x64, 0x1E, 0x90, 0xDD, 0xBA,
+        0xE0, 0x3A, 0x93, 0x37, 0x72, 0x3E, 0x51, 0x66,
+        0x8F, 0xB8, 0x93, 0x77, 0x2C, 0x0F, 0xBD, 0xB3,
+        0xEB, 0x7E, 0xF7, 0x90, 0xDF, 0xCB, 0xB9, 0xAB
+      },
+      {
+        0xD8, 0x6A, 0x5B, 0xAA, 0x33, 0x65, 0xAB, 0xD8,
+        0xF4, 0x42, 0xCD, 0x6E, 0xBB, 0x93, 0x11, 0x38,
+        0x19, 0xF0, 0xB4, 0x60, 0x61, 0xE1, 0x34, 0x04,
+        0xEF, 0xAA, 0x1A, 0x58, 0xE1, 0xFF, 0x27, 0x2A,
+        0xD4, 0xBF, 0xD3, 0x08, 0x15, 0xAD, 0xD8, 0x8A,
+        0xD9, 0x8F, 0xCE, 0x9A, 0xF0, 0x18, 0x37, 0x4C,
+        0xA6, 0x0D, 0x89, 0x79, 0x0F, 0x71, 0xA6, 0x07,
+        0x5F, 0x3D, 0x68, 0xD3, 0x20, 0x21, 0xA9, 0xEB
+      },
+      {
+        0xA6, 0x7E, 0x6E, 0xC6, 0x57, 0xC9, 0x5E, 0xAB,
+        0x3C, 0x3C, 0x32, 0xE4, 0x1F, 0xBF, 0x39, 0xCF,
+        0x20, 0x33, 0xAB, 0x4B, 0xE2, 0xE2, 0xB8, 0x21,
+        0x10, 0x4A, 0xDB, 0xE6, 0x9D, 0x16, 0xE9, 0x48,
+        0xDC, 0xE4, 0xC4, 0xC6, 0xA3, 0xCF, 0x22, 0x76,
+        0x90, 0x1F, 0x7D, 0x4F, 0xFD, 0x69, 0x65, 0x46,
+        0x49, 0x88, 0x2C, 0x01, 0x4D, 0x2C, 0x10, 0xA1,
+        0x30, 0x2B, 0x79, 0xC6, 0x15, 0x69, 0xCD, 0x36
+      },
+      {
+        0x55, 0xCE, 0x19, 0x2A, 0xE4, 0xB3, 0xEA, 0xF8,
+        0x55, 0x59, 0x0E, 0x2D, 0x44, 0xE6, 0x25, 0xD9,
+        0xBA, 0x14, 0x6E, 0xB7, 0x50, 0x48, 0xE6, 0xB5,
+        0x6E, 0x02, 0x50, 0x31, 0xEF, 0xBA, 0x0B, 0xDA,
+        0x8A, 0xAA, 0xFA, 0x04, 0x70, 0xB7, 0xAC, 0x3D,
+        0x40, 0x6E, 0x5A, 0xBA, 0x3E, 0x83, 0x2F, 0x27,
+        0xA5, 0x07, 0x24, 0x6D, 0x1B, 0x5F, 0x33, 0xDE,
+        0xA1, 0xF7, 0x24, 0xE2, 0xB8, 0x1B, 0x0C, 0x98
+      },
+      {
+        0xB3, 0xA2, 0x0C, 0x1F, 0xB0, 0xB4, 0xF0, 0xD3,
+        0x77, 0x26, 0xC2, 0x3B, 0x58, 0x77, 0xDD, 0x8E,
+        0x72, 0xF6, 0x98, 0x86, 0xE0, 0x9A, 0x8C, 0x68,
+        0xCF, 0xC3, 0x01, 0xD2, 0xA3, 0xF2, 0xF9, 0x5C,
+        0xEF, 0xCF, 0xAB, 0xB8, 0x88, 0x99, 0x03, 0xC7,
+        0x32, 0xF4, 0xE8, 0x14, 0x32, 0xD3, 0xF6, 0x78,
+        0xCC, 0xDF, 0xC3, 0x98, 0xAC, 0xD8, 0xA2, 0xF0,
+        0x66, 0x41, 0x10, 0x04, 0x50, 0xD8, 0x9F, 0x32
+      },
+      {
+        0xF7, 0x27, 0x2D, 0x93, 0xC7, 0x01, 0x2D, 0x38,
+        0xB2, 0x7F, 0x0C, 0x9A, 0xE2, 0x01, 0x79, 0x58,
+        0xBB, 0xA6, 0x66, 0xA9, 0xDE, 0x1E, 0x88, 0x12,
+        0xE9, 0x74, 0x37, 0xAE, 0xB2, 0xE0, 0x3C, 0x99,
+        0x94, 0x38, 0xF0, 0xBE, 0x33, 0x3D, 0x09, 0xAD,
+        0xDB, 0xCF, 0xAA, 0xC7, 0xAA, 0x73, 0xF7, 0xB6,
+        0xCC, 0xEC, 0x67, 0xDC, 0x07, 0x79, 0x98, 0xDE,
+        0xDB, 0x8C, 0x13, 0x32, 0xBA, 0xC0, 0xFB, 0xA8
+      },
+      {
+        0x1F, 0xE7, 0xB3, 0xDE, 0x34, 0xC0, 0x47, 0x9C,
+        0xA8, 0x40, 0x5F, 0x3C, 0xBC, 0xD2, 0xDB, 0x64,
+        0xBB, 0x18, 0xDB, 0xB2, 0x91, 0xA5, 0xFE, 0xAA,
+        0x16, 0xC5, 0x22, 0x8C, 0x93, 0xEE, 0x21, 0xC7,
+        0x11, 0xD6, 0x8A, 0x01, 0x0C, 0x2A, 0xE8, 0x80,
+        0x05, 0xEB, 0xAC, 0x95, 0x9E, 0x3A, 0x32, 0x24,
+        0x52, 0xF8, 0x62, 0xDD, 0xE9, 0x4B, 0xB9, 0x41,
+        0x81, 0x3E, 0x52, 0x4D, 0x23, 0x47, 0xFE, 0xEE
+      },
+      {
+        0x4E, 0xE1, 0xD3, 0x88, 0x05, 0xC3, 0x22, 0x84,
+        0xEC, 0xEB, 0xE9, 0x2E, 0x3D, 0xF6, 0xCD, 0x98,
+        0xC7, 0xD6, 0x68, 0x0E, 0xAB, 0x0D, 0x68, 0x66,
+        0x4F, 0x96, 0x70, 0x6C, 0x45, 0x63, 0x3B, 0x1E,
+        0x26, 0x82, 0x22, 0xAA, 0x5A, 0x52, 0x79, 0xEF,
+        0x01, 0xFC, 0x28, 0x54, 0x32, 0xAB, 0xEE, 0xD7,
+        0x4B, 0xA3, 0xDF, 0x18, 0x9F, 0x50, 0xA9, 0x89,
+        0xD5, 0x8E, 0x71, 0x30, 0x62, 0x2D, 0xAA, 0x59
+      },
+      {
+        0x0E, 0x14, 0x05, 0x87, 0x1C, 0x87, 0xA5, 0xEA,
+        0x40, 0x83, 0x42, 0xF3, 0x9D, 0x34, 0x94, 0xF9,
+        0x39, 0xF7, 0x3C, 0x22, 0x60, 0xC2, 0xA4, 0x3A,
+        0x5C, 0x9F, 0x1B, 0x57, 0x33, 0x0C, 0xCA, 0x40,
+        0x93, 0xFC, 0x1F, 0x42, 0xF9, 0x6D, 0x83, 0x00,
+        0x56, 0x77, 0x03, 0x7D, 0xB5, 0x1A, 0xEF, 0x26,
+        0xF0, 0x54, 0x38, 0x05, 0x7A, 0xE7, 0x9E, 0xD1,
+        0x44, 0x64, 0xFD, 0x8E, 0x57, 0xD1, 0x55, 0x86
+      },
+      {
+        0x17, 0xC5, 0xCA, 0xB4, 0x09, 0x10, 0x73, 0x62,
+        0x1B, 0x5C, 0x24, 0xC3, 0x36, 0x31, 0x6D, 0x0C,
+        0xF6, 0x49, 0xBA, 0x1E, 0xFF, 0xEB, 0xFC, 0x87,
+        0xE0, 0x43, 0x9C, 0xDF, 0x57, 0x88, 0x87, 0xB2,
+        0x21, 0x65, 0x6D, 0x33, 0x9A, 0x6F, 0xD1, 0x98,
+        0xAB, 0xAE, 0xE6, 0x7E, 0xA1, 0x88, 0xDD, 0x66,
+        0x56, 0x78, 0x23, 0xFC, 0x22, 0x0C, 0x52, 0xB5,
+        0x74, 0x90, 0x25, 0x14, 0x69, 0xD2, 0x5D, 0x8C
+      },
+      {
+        0x57, 0xDC, 0x27, 0x97, 0xD1, 0x42, 0x68, 0x1C,
+        0x94, 0xFE, 0x48, 0x86, 0x26, 0x98, 0x6E, 0xD4,
+        0xB2, 0x67, 0x03, 0xCB, 0xF6, 0xBF, 0xE5, 0x93,
+        0x91, 0x64, 0x36, 0x57, 0x06, 0x5B, 0x2D, 0x46,
+        0xE4, 0xB1, 0xDD, 0xB3, 0xAA, 0x83, 0x2C, 0x9B,
+        0xD4, 0x49, 0x75, 0x5A, 0xC8, 0xB1, 0xBF, 0x93,
+        0x68, 0x97, 0xFB, 0xC6, 0xAD, 0xE3, 0x78, 0xF2,
+        0xBD, 0x64, 0x93, 0xE4, 0x86, 0xF4, 0x20, 0x29
+      },
+      {
+        0x44, 0x12, 0xDD, 0x6B, 0xED, 0x6D, 0xB2, 0xA8,
+        0x03, 0xC2, 0xE0, 0xDF, 0x8F, 0x58, 0x29, 0xE7,
+        0xA4, 0xB0, 0x41, 0x78, 0x89, 0x51, 0x0D, 0xF7,
+        0xDF, 0xEE, 0x49, 0x57, 0x4A, 0x71, 0xEC, 0x0D,
+        0x9E, 0x0D, 0x46, 0x06, 0x50, 0x17, 0xC7, 0x2D,
+        0xD9, 0x74, 0x39, 0x33, 0xCA, 0x83, 0x9A, 0x76,
+        0x8D, 0xD1, 0x5A, 0xB0, 0xB7, 0xC1, 0x4C, 0x62,
+        0x6A, 0x35, 0x41, 0x09, 0x69, 0x01, 0x96, 0xAE
+      },
+      {
+        0xD0, 0xEB, 0xC7, 0x71, 0x03, 0x1B, 0x7C, 0x16,
+        0x00, 0x21, 0xC9, 0xB6, 0xFB, 0xB2, 0xB6, 0x70,
+        0xE3, 0xB4, 0x02, 0x70, 0x02, 0x69, 0x07, 0xA3,
+        0x91, 0x63, 0xDB, 0x18, 0x73, 0xEC, 0xC3, 0xB8,
+        0x00, 0x11, 0x1D, 0xD7, 0xBF, 0x13, 0x8F, 0x83,
+        0xA6, 0x10, 0xDC, 0x04, 0x6D, 0xA2, 0x68, 0xB7,
+        0x2B, 0x8C, 0x90, 0x86, 0x92, 0x23, 0x77, 0xDB,
+        0xED, 0x73, 0x94, 0x82, 0x43, 0xCA, 0x1E, 0x14
+      },
+      {
+        0x10, 0xC4, 0xBA, 0x31, 0x55, 0x91, 0x69, 0x8D,
+        0xFB, 0x91, 0xA5, 0x73, 0x37, 0x63, 0x18, 0x84,
+        0xB4, 0x73, 0x8D, 0x9F, 0x59, 0x80, 0x78, 0x51,
+        0xA6, 0x79, 0x84, 0x0C, 0xC2, 0x87, 0xAC, 0xE3,
+        0x01, 0x1C, 0xCD, 0xC8, 0xF4, 0xA4, 0x85, 0xBB,
+        0x19, 0x73, 0x40, 0x4E, 0xF9, 0xEE, 0x9B, 0x9C,
+        0xF1, 0xEA, 0xDB, 0xC5, 0x40, 0x74, 0xC6, 0xD1,
+        0x13, 0xDE, 0x8F, 0xC9, 0x1D, 0x07, 0x97, 0xEB
+      },
+      {
+        0x14, 0x64, 0x34, 0x7B, 0xE3, 0x2C, 0x79, 0x59,
+        0x17, 0x2B, 0x74, 0x72, 0xD1, 0x1F, 0xE0, 0x78,
+        0x44, 0xA5, 0x2E, 0x2D, 0x3B, 0x2D, 0x05, 0x8C,
+        0xC6, 0xBC, 0xC0, 0xA8, 0xA2, 0x75, 0xD6, 0xB8,
+        0x2B, 0x2D, 0x62, 0x63, 0x75, 0x5E, 0xAF, 0x2A,
+        0x65, 0x88, 0xB6, 0xA1, 0xEB, 0x79, 0x9A, 0xF8,
+        0x3A, 0x4C, 0xE7, 0x53, 0xF8, 0xC7, 0x5A, 0x22,
+        0x84, 0xD0, 0x28, 0x5B, 0xAB, 0x5F, 0x7C, 0x1C
+      },
+      {
+        0xF4, 0x09, 0x23, 0x1E, 0xD1, 0x87, 0xF5, 0xC4,
+        0xE8, 0x33, 0xFA, 0x9E, 0x30, 0x42, 0xAC, 0xA6,
+        0xC8, 0x58, 0xB0, 0x8B, 0x49, 0x6B, 0x25, 0x31,
+        0xF8, 0x4F, 0xD5, 0xCE, 0xA9, 0x3E, 0xCD, 0x06,
+        0xDA, 0xFE, 0x0A, 0x10, 0xC3, 0xFF, 0x23, 0x76,
+        0xC7, 0x4D, 0xC8, 0x0D, 0xA0, 0x7D, 0xA0, 0x18,
+        0x64, 0xFB, 0xF2, 0x68, 0x59, 0x60, 0xB5, 0x40,
+        0xB3, 0xA2, 0xE9, 0x42, 0xCB, 0x8D, 0x90, 0x9F
+      },
+      {
+        0x39, 0x51, 0x32, 0xC5, 0x80, 0xC3, 0x55, 0xB5,
+        0xB0, 0xE2, 0x35, 0x33, 0x6C, 0x8D, 0xC1, 0x08,
+        0x5E, 0x59, 0x59, 0x64, 0x04, 0x3D, 0x38, 0x9E,
+        0x08, 0x1E, 0xFE, 0x48, 0x5B, 0xA4, 0xC6, 0x37,
+        0x72, 0xDB, 0x8D, 0x7E, 0x0F, 0x18, 0x6C, 0x50,
+        0x98, 0x2E, 0x12, 0x23, 0xEA, 0x78, 0x5A, 0xDC,
+        0x74, 0x0B, 0x0C, 0xF2, 0x18, 0x70, 0x74, 0x58,
+        0xB8, 0xB8, 0x03, 0x40, 0x42, 0xF9, 0x23, 0xC2
+      },
+      {
+        0xF9, 0x2A, 0xBA, 0xCA, 0x21, 0x32, 0x29, 0x66,
+        0x06, 0x49, 0xEF, 0x2D, 0x8F, 0x88, 0x11, 0x5B,
+        0x5B, 0xED, 0x8A, 0xB5, 0xB9, 0xBC, 0xA9, 0xA1,
+        0xB4, 0xC5, 0x24, 0x57, 0x03, 0x53, 0x10, 0xC4,
+        0x1A, 0x6B, 0xEA, 0x2B, 0x23, 0xB7, 0x91, 0x8B,
+        0x5B, 0x8B, 0xF3, 0x8B, 0x52, 0xEA, 0xC6, 0xFF,
+        0x3B, 0x62, 0x13, 0xA5, 0x22, 0xF3, 0x81, 0xBE,
+        0x7F, 0xF0, 0x90, 0x6D, 0xBA, 0x7B, 0xD0, 0x0C
+      },
+      {
+        0xCB, 0xAD, 0xE7, 0xAD, 0x3B, 0x5D, 0xEE, 0x0F,
+        0xF1, 0xA4, 0x6B, 0x08, 0x2C, 0xF4, 0xE1, 0xE1,
+        0xDC, 0x21, 0x62, 0x0D, 0xD2, 0xCC, 0x0E, 0xDC,
+        0x2C, 0x70, 0x7A, 0x21, 0x62, 0xD2, 0x14, 0x99,
+        0x69, 0xAB, 0xBB, 0x29, 0xC5, 0x72, 0x0B, 0x04,
+        0xBD, 0x15, 0x68, 0xA9, 0x55, 0x61, 0x95, 0xE6,
+        0x7F, 0x24, 0x32, 0x2D, 0xD9, 0xAA, 0x4E, 0x83,
+        0x65, 0x19, 0x1A, 0xA5, 0xB6, 0xC4, 0x45, 0x79
+      },
+      {
+        0xF5, 0x1B, 0x4A, 0xE4, 0xD4, 0xC5, 0x4A, 0x29,
+        0xCF, 0x71, 0x35, 0xA8, 0xFE, 0x1E, 0xAB, 0xD5,
+        0xE1, 0xBC, 0xBF, 0x82, 0x08, 0x96, 0x96, 0x7D,
+        0xC4, 0x1E, 0x38, 0x49, 0xDA, 0xC2, 0x25, 0x07,
+        0x69, 0x42, 0x10, 0xCA, 0x11, 0xC4, 0xEB, 0xF1,
+        0xC2, 0x9A, 0x8D, 0x4F, 0x71, 0xB3, 0x0F, 0x76,
+        0xC9, 0xB6, 0x01, 0x0A, 0xD9, 0x5B, 0xDF, 0xB0,
+        0xDE, 0x83, 0x79, 0x25, 0xF0, 0x61, 0x25, 0x97
+      },
+      {
+        0xCE, 0x38, 0x72, 0x11, 0x5D, 0x83, 0x3B, 0x34,
+        0x56, 0xCA, 0x94, 0x2E, 0x6E, 0x38, 0x5F, 0x28,
+        0xA9, 0x03, 0xBE, 0xAB, 0xFB, 0x75, 0x3F, 0x8A,
+        0xFC, 0xCC, 0x12, 0xF2, 0x58, 0x2C, 0xE1, 0xF3,
+        0x62, 0x12, 0xBD, 0x05, 0xE0, 0x5A, 0x46, 0xFC,
+        0x88, 0xD3, 0x19, 0x50, 0xB4, 0x91, 0x1A, 0xE5,
+        0xDC, 0xD8, 0xFF, 0x7A, 0x0B, 0x50, 0x47, 0x4C,
+        0xB4, 0x88, 0xCC, 0xF2, 0xA8, 0x9C, 0xD0, 0xEB
+      },
+      {
+        0x9B, 0xB7, 0x4C, 0xBD, 0x47, 0xA6, 0x24, 0xCB,
+        0xEA, 0xFC, 0xC1, 0x6D, 0x46, 0x29, 0x47, 0xBB,
+        0xEA, 0x13, 0x70, 0xB8, 0x5C, 0x96, 0x1A, 0x40,
+        0x7D, 0xF9, 0x86, 0x3E, 0x54, 0xE6, 0xD9, 0xE6,
+        0xA8, 0xD2, 0xEF, 0x0C, 0x64, 0x97, 0x20, 0x5E,
+        0x5E, 0xB7, 0xC3, 0xE5, 0x9E, 0x69, 0x8D, 0x99,
+        0x24, 0x63, 0xCA, 0x9D, 0xD4, 0xCF, 0x28, 0xCF,
+        0x9A, 0x2D, 0x4E, 0x30, 0xC1, 0x33, 0xE8, 0x55
+      },
+      {
+        0x72, 0x96, 0x33, 0x82, 0x0B, 0xF0, 0x13, 0xD9,
+        0xD2, 0xBD, 0x37, 0x3C, 0xCA, 0xC7, 0xBC, 0x9F,
+        0x37, 0x16, 0xF6, 0x9E, 0x16, 0xA4, 0x4E, 0x94,
+        0x9C, 0x7A, 0x9A, 0x93, 0xDC, 0xA1, 0x26, 0xBB,
+        0x1A, 0xA5, 0x4E, 0x5E, 0x70, 0x40, 0x70, 0x7F,
+        0x02, 0x87, 0x6A, 0xFD, 0x02, 0x0A, 0xF4, 0x72,
+        0x63, 0x9D, 0x49, 0xF5, 0x42, 0x0D, 0x29, 0x4C,
+        0x3A, 0xA3, 0x1D, 0x06, 0x7E, 0x3E, 0x85, 0x75
+      },
+      {
+        0x06, 0x86, 0x1D, 0xB3, 0x07, 0xC6, 0x78, 0x08,
+        0x6E, 0x8B, 0x2A, 0xEC, 0xDF, 0x18, 0x29, 0xD2,
+        0x88, 0x3D, 0x28, 0xB7, 0x31, 0xAB, 0xD0, 0xF1,
+        0xE7, 0x2F, 0x1C, 0xED, 0x6C, 0x7A, 0xD4, 0x17,
+        0x2E, 0xCA, 0x63, 0x22, 0xA8, 0x3F, 0xB6, 0xA6,
+        0x5A, 0xFA, 0x37, 0xE9, 0x4A, 0x3E, 0x2B, 0xA2,
+        0x05, 0xB8, 0x7B, 0xF3, 0x82, 0xD9, 0x15, 0x88,
+        0x49, 0x7A, 0x46, 0x50, 0x88, 0x3B, 0xD8, 0x75
+      },
+      {
+        0x35, 0x6E, 0xCE, 0xAF, 0x17, 0x02, 0xB3, 0x70,
+        0xF4, 0xAA, 0xB8, 0xEA, 0x82, 0x84, 0x86, 0xF3,
+        0x30, 0x13, 0xF7, 0x44, 0xB3, 0x9E, 0x7E, 0xA2,
+        0x6C, 0x69, 0x18, 0xD6, 0x0E, 0x1A, 0xBC, 0xF4,
+        0x4F, 0xB1, 0x6E, 0xDC, 0xA7, 0x72, 0x0A, 0xCF,
+        0xC6, 0xA7, 0x01, 0xBF, 0x1E, 0x2C, 0x35, 0xDD,
+        0xBD, 0x69, 0x5A, 0x8D, 0x40, 0x8E, 0x8C, 0x96,
+        0x32, 0xE8, 0xCD, 0x27, 0x23, 0x0C, 0xAD, 0x8D
+      },
+      {
+        0x48, 0x9A, 0x39, 0xD0, 0xFC, 0x3C, 0xDE, 0xAF,
+        0x42, 0x89, 0x2E, 0xD8, 0x03, 0x85, 0xC1, 0x1C,
+        0xE2, 0x93, 0xC9, 0x32, 0x21, 0x5B, 0xB2, 0x31,
+        0x88, 0x69, 0x2A, 0x86, 0xE6, 0x1B, 0xCA, 0xD9,
+        0x2C, 0x2A, 0x1D, 0x11, 0x42, 0x60, 0x1B, 0x1B,
+        0xDF, 0x09, 0x82, 0xD1, 0xCD, 0x1E, 0x05, 0xC0,
+        0x52, 0xDE, 0x81, 0x9E, 0x64, 0xF2, 0x47, 0xDB,
+        0x35, 0x91, 0x5D, 0xD1, 0xDB, 0x79, 0xA3, 0xB5
+      },
+      {
+        0xC0, 0x2F, 0x46, 0x4B, 0x4D, 0xD1, 0x81, 0x17,
+        0xE3, 0x0A, 0x8D, 0xB8, 0xEF, 0x1D, 0xA0, 0x67,
+        0x13, 0x4B, 0x60, 0x4E, 0xFA, 0x19, 0x51, 0x76,
+        0x7E, 0xE6, 0x32, 0xDC, 0x02, 0x4D, 0x64, 0xC0,
+        0x0F, 0x24, 0x49, 0xF0, 0x42, 0xDB, 0x3A, 0xEA,
+        0x01, 0x74, 0xEB, 0xCD, 0xBB, 0x4F, 0xF5, 0x9D,
+        0xAE, 0x75, 0x4F, 0x72, 0x39, 0x46, 0xF1, 0xB9,
+        0x0A, 0x77, 0xFD, 0x95, 0x23, 0x69, 0x0B, 0x7B
+      },
+      {
+        0xFB, 0x31, 0xE6, 0xDD, 0xB8, 0x6D, 0xBF, 0xF3,
+        0x72, 0x64, 0x6D, 0x1E, 0x3A, 0x3F, 0x31, 0xDD,
+        0x61, 0x15, 0x9F, 0xC3, 0x93, 0x65, 0x8C, 0x2E,
+        0xE9, 0x57, 0x10, 0x3B, 0xF2, 0x11, 0x6B, 0xDE,
+        0xF8, 0x2C, 0x33, 0xE8, 0x69, 0xF3, 0xC8, 0x3A,
+        0xC3, 0xC2, 0xF6, 0x38, 0x0C, 0xF6, 0x92, 0xF7,
+        0xB1, 0xDC, 0xBA, 0xE0, 0xBB, 0x22, 0x7A, 0xD3,
+        0x47, 0xE7, 0x54, 0x13, 0x74, 0x66, 0xC6, 0x9F
+      },
+      {
+        0x00, 0x60, 0x62, 0xAB, 0xE1, 0x6C, 0x2F, 0xE7,
+        0x9A, 0xF8, 0x80, 0x85, 0xE0, 0xB5, 0x82, 0xB1,
+        0x06, 0xE7, 0xF7, 0x9F, 0x01, 0xA4, 0x39, 0x46,
+        0xC7, 0x8B, 0x19, 0xF9, 0xBD, 0xD7, 0x25, 0x99,
+        0x76, 0x36, 0xA3, 0x32, 0xEB, 0x9A, 0x3A, 0xAA,
+        0x6D, 0xE0, 0xD4, 0xA8, 0xE9, 0xE2, 0x8E, 0x8C,
+        0x77, 0x87, 0x74, 0x22, 0x4C, 0x66, 0x5B, 0xF7,
+        0xBC, 0x36, 0x44, 0xFC, 0xE4, 0x11, 0x22, 0x8C
+      },
+      {
+        0xD4, 0x4A, 0x6D, 0xB3, 0xDE, 0x9F, 0xD4, 0xE4,
+        0xA7, 0xEF, 0x15, 0x5A, 0x01, 0xBC, 0xCB, 0x91,
+        0xC1, 0xBC, 0xF1, 0xCB, 0x53, 0x22, 0x56, 0x89,
+        0xA7, 0x7A, 0x0D, 0x23, 0xB4, 0xD3, 0x9A, 0x89,
+        0xA1, 0x89, 0xF2, 0x89, 0x80, 0xF9, 0x1C, 0x56,
+        0xEA, 0xC5, 0x87, 0x9E, 0xAE, 0x93, 0x3C, 0xED,
+        0x7F, 0x26, 0x7E, 0x2F, 0x70, 0x40, 0xEB, 0x38,
+        0x0F, 0xDB, 0xBF, 0x34, 0xA6, 0xB7, 0xB6, 0x15
+      },
+      {
+        0x5A, 0xFB, 0xFE, 0xA1, 0xDE, 0xDA, 0x5A, 0xEA,
+        0xB9, 0x2E, 0x4D, 0x0C, 0x31, 0xD1, 0x6A, 0x9A,
+        0x86, 0xBF, 0x7C, 0x75, 0x23, 0x27, 0x4A, 0x05,
+        0xC5, 0x05, 0x29, 0xF5, 0xC1, 0x39, 0xDB, 0x10,
+        0x93, 0x3A, 0x52, 0xC6, 0x22, 0x9C, 0xD3, 0x11,
+        0x08, 0xF0, 0x83, 0xFB, 0x0C, 0x85, 0xCF, 0x52,
+        0x83, 0x1B, 0x5A, 0x05, 0xF2, 0x55, 0x0A, 0x77,
+        0xB5, 0x70, 0x3C, 0xC6, 0x68, 0x91, 0x2D, 0xBC
+      },
+      {
+        0xD1, 0x7F, 0xCA, 0xD4, 0xE0, 0xD8, 0xBD, 0xE2,
+        0xED, 0xFD, 0xA1, 0x68, 0xBA, 0x47, 0x10, 0x4B,
+        0xBC, 0xA4, 0xD2, 0x6D, 0xA2, 0xD3, 0x1A, 0x07,
+        0x0B, 0x0F, 0xBA, 0x0B, 0x26, 0xEE, 0xDD, 0x95,
+        0xEE, 0xC1, 0xFC, 0x34, 0xD7, 0x6C, 0xD4, 0xA1,
+        0xCB, 0x15, 0xF2, 0x62, 0x16, 0x88, 0xA9, 0xCC,
+        0x0E, 0x96, 0x35, 0x8D, 0xE9, 0x93, 0x22, 0x2B,
+        0xB3, 0xE3, 0xCD, 0x0B, 0xFD, 0xCB, 0x74, 0x6C
+      },
+      {
+        0xBD, 0x6A, 0x59, 0x21, 0x63, 0x37, 0xB4, 0x5D,
+        0x6B, 0x71, 0xAE, 0xAC, 0x01, 0x36, 0x6B, 0xFE,
+        0x96, 0x60, 0xE0, 0xFB, 0xC2, 0x95, 0x9A, 0xDB,
+        0xB6, 0x8D, 0x52, 0x6C, 0x43, 0xD4, 0x8F, 0xFF,
+        0xFE, 0x2F, 0xFC, 0x43, 0x05, 0x88, 0xE7, 0x8E,
+        0x66, 0x54, 0x6A, 0x3C, 0x70, 0x9B, 0x0A, 0xCE,
+        0xA1, 0x7C, 0xBC, 0x5A, 0x21, 0x8C, 0x53, 0xCD,
+        0x47, 0xAA, 0x48, 0x71, 0xC1, 0xDD, 0x98, 0x4A
+      },
+      {
+        0x83, 0xEA, 0x5A, 0xE1, 0x89, 0x11, 0x45, 0xC4,
+        0x1A, 0x7C, 0x6C, 0x87, 0xFE, 0x92, 0x24, 0x87,
+        0xF5, 0xD2, 0x82, 0x93, 0x35, 0x69, 0xB7, 0xAE,
+        0x0E, 0x34, 0x56, 0x53, 0x38, 0x1E, 0xDE, 0x6D,
+        0x4B, 0x16, 0xE1, 0x44, 0xD1, 0xC3, 0xE8, 0xF0,
+        0x60, 0x5D, 0xAA, 0x0D, 0xB5, 0x96, 0x5A, 0x7B,
+        0x79, 0xD9, 0x1A, 0x8A, 0xFE, 0x11, 0xF1, 0xE0,
+        0xBC, 0x54, 0x9A, 0xC0, 0x74, 0xA0, 0x1A, 0xB7
+      },
+      {
+        0x37, 0x50, 0x50, 0xCF, 0x2E, 0x43, 0x0D, 0x0E,
+        0x29, 0x87, 0x58, 0x35, 0x20, 0x8E, 0x89, 0x06,
+        0xD7, 0x05, 0x2E, 0x47, 0x29, 0x2C, 0x5A, 0x38,
+        0xA6, 0x30, 0x82, 0x87, 0x3D, 0x31, 0xD5, 0x83,
+        0x13, 0x5C, 0x07, 0xA2, 0x0C, 0x52, 0xD9, 0x5B,
+        0x2D, 0x5D, 0xC3, 0xEA, 0xDE, 0x6B, 0xE1, 0x43,
+        0xCA, 0x34, 0x38, 0xF4, 0x4D, 0x02, 0x0A, 0xAE,
+        0x16, 0x0E, 0xD7, 0x7A, 0xB9, 0x88, 0x4F, 0x7D
+      },
+      {
+        0x30, 0x28, 0xB0, 0xE8, 0x24, 0x95, 0x7F, 0xF3,
+        0xB3, 0x05, 0xE9, 0x7F, 0xF5, 0x92, 0xAA, 0x8E,
+        0xF2, 0x9B, 0x3B, 0xEC, 0x1D, 0xC4, 0x7B, 0x76,
+        0x13, 0x3D, 0x10, 0x3F, 0xFE, 0x38, 0x71, 0xBF,
+        0x05, 0x12, 0xA2, 0x31, 0xAF, 0xCB, 0x1D, 0xF8,
+        0x65, 0x97, 0xEC, 0x5E, 0x46, 0xE9, 0x23, 0xC8,
+        0xB9, 0x85, 0xC2, 0x85, 0x08, 0x57, 0xC6, 0x40,
+        0x01, 0xB2, 0xC5, 0x51, 0xEA, 0x83, 0x3D, 0x0E
+      },
+      {
+        0x08, 0x7C, 0xCB, 0x1E, 0x5B, 0xD1, 0x72, 0x22,
+        0xB8, 0xAF, 0x20, 0x6D, 0xD6, 0x39, 0x08, 0xF8,
+        0x91, 0x72, 0x97, 0x62, 0x1A, 0x8C, 0xB9, 0x33,
+        0x0A, 0xE0, 0xBA, 0x4A, 0xF3, 0xE9, 0xD6, 0x0C,
+        0x98, 0xFC, 0xF1, 0xEF, 0xFC, 0xEC, 0x20, 0x13,
+        0x6B, 0x4F, 0x91, 0x88, 0x12, 0x6D, 0xFA, 0x04,
+        0x4E, 0x1C, 0x1C, 0xCD, 0xA3, 0xCE, 0xD8, 0x73,
+        0x73, 0xD9, 0x37, 0x9C, 0xCB, 0xED, 0xBD, 0xB3
+      },
+      {
+        0x7F, 0x17, 0x06, 0x24, 0x98, 0xBF, 0xA2, 0xBB,
+        0x58, 0x56, 0xCD, 0x0A, 0x62, 0xC5, 0x68, 0xC5,
+        0xC6, 0xB8, 0x97, 0x43, 0x24, 0x74, 0xEF, 0xB2,
+        0xE6, 0xA2, 0xEE, 0x18, 0xCA, 0xFF, 0xD2, 0x1E,
+        0x1E, 0xF3, 0x0D, 0x06, 0x47, 0x23, 0x85, 0x0F,
+        0x79, 0x90, 0xD2, 0x1B, 0xA3, 0x4E, 0x8F, 0x2B,
+        0x3B, 0xB0, 0x67, 0x02, 0x3A, 0x77, 0x27, 0x82,
+        0x15, 0x8A, 0x27, 0xC6, 0xC4, 0x67, 0xC9, 0x28
+      },
+      {
+        0x6B, 0xA9, 0x86, 0xA9, 0x42, 0x49, 0x7F, 0xD3,
+        0x84, 0x62, 0x97, 0x2F, 0x50, 0xA6, 0x19, 0x68,
+        0xC0, 0x65, 0x2D, 0xAC, 0x56, 0xCE, 0x9B, 0x9A,
+        0xC1, 0xBC, 0x06, 0x1A, 0xB6, 0x34, 0xFE, 0x5A,
+        0x77, 0xAC, 0xD0, 0x27, 0x5F, 0x83, 0x96, 0xE3,
+        0xC0, 0xBE, 0xF0, 0x12, 0xAE, 0x93, 0xB7, 0x27,
+        0x58, 0xB8, 0xD7, 0x67, 0x9C, 0x87, 0xE8, 0x47,
+        0xE6, 0x30, 0x17, 0xB5, 0x5A, 0x69, 0xC5, 0xC6
+      },
+      {
+        0x96, 0x7C, 0x81, 0xF5, 0x61, 0x95, 0x18, 0x33,
+        0xFA, 0x56, 0x6F, 0x6B, 0x36, 0x07, 0x7E, 0xAD,
+        0xB2, 0xA6, 0x15, 0xCC, 0x15, 0xF0, 0xED, 0xBB,
+        0xAE, 0x4F, 0x84, 0x4D, 0xDC, 0x8E, 0x9C, 0x1F,
+        0xB8, 0x3D, 0x31, 0xA9, 0x3F, 0xCB, 0x17, 0x74,
+        0xD7, 0x40, 0xD6, 0x92, 0x08, 0xCA, 0x59, 0x30,
+        0xBC, 0xFA, 0xC4, 0xA1, 0xF9, 0x44, 0x46, 0x9F,
+        0xEF, 0xD1, 0x9B, 0x6E, 0x93, 0x75, 0xE0, 0xB5
+      },
+      {
+        0xE8, 0xAE, 0xF1, 0x78, 0xE6, 0xDA, 0x3E, 0xF5,
+        0xCA, 0xED, 0x65, 0x30, 0xF7, 0xEB, 0x25, 0x60,
+        0x82, 0x56, 0xC2, 0x37, 0x7C, 0x4C, 0xF9, 0x6B,
+        0x0C, 0xFD, 0x0D, 0x76, 0xEE, 0xB4, 0xBB, 0x86,
+        0xEE, 0xFF, 0x7B, 0x7D, 0xF1, 0x58, 0x5C, 0x8D,
+        0x7A, 0x20, 0xC0, 0x63, 0x3A, 0x67, 0x90, 0x7F,
+        0x6D, 0x28, 0x67, 0xC3, 0x26, 0x4A, 0x91, 0xC0,
+        0x51, 0xAB, 0xAE, 0x6E, 0xEA, 0x5A, 0x91, 0xD8
+      },
+      {
+        0x64, 0x81, 0xDC, 0xC8, 0x15, 0x7A, 0xE6, 0x28,
+        0xB5, 0xCD, 0x52, 0x6B, 0xAC, 0x8F, 0x93, 0x31,
+        0x56, 0xDE, 0xDA, 0xC9, 0x56, 0xA2, 0xB2, 0x2A,
+        0x97, 0x4B, 0xF5, 0xF7, 0xEC, 0x2D, 0xB5, 0x80,
+        0x6F, 0x53, 0xDD, 0x0E, 0x2D, 0xD5, 0x3D, 0xB8,
+        0x7C, 0xD8, 0xF5, 0x8A, 0x58, 0x6F, 0x9B, 0x3C,
+        0x5C, 0x52, 0x23, 0x31, 0xA3, 0x11, 0x74, 0xC4,
+        0xE7, 0xB9, 0xB6, 0xF7, 0xF0, 0x57, 0xC2, 0x8F
+      },
+      {
+        0xA7, 0x1E, 0xA4, 0x5C, 0xE6, 0x61, 0x6A, 0x3D,
+        0x2F, 0x0A, 0x59, 0x2D, 0x5D, 0x02, 0x86, 0x93,
+        0x2D, 0xA6, 0x3C, 0x6D, 0xB1, 0x1D, 0x59, 0xC6,
+        0x69, 0x1C, 0x35, 0xA5, 0x6F, 0x7E, 0xE4, 0xF8,
+        0x0B, 0x6F, 0xC3, 0x40, 0xB4, 0xDB, 0xC1, 0x84,
+        0x4C, 0x50, 0x40, 0xE6, 0x68, 0xD2, 0x89, 0x2F,
+        0x4A, 0x4A, 0xE8, 0x53, 0x3F, 0x1B, 0x67, 0x71,
+        0xBC, 0xFC, 0xE7, 0xC3, 0xA2, 0x3E, 0x0D, 0x97
+      },
+      {
+        0x96, 0x93, 0x44, 0x87, 0x70, 0xFE, 0xAE, 0x42,
+        0x17, 0x26, 0xEB, 0x20, 0x3B, 0x01, 0xC7, 0x08,
+        0x23, 0xD5, 0xF4, 0x4C, 0xC5, 0x21, 0x3E, 0x6A,
+        0x68, 0x28, 0x47, 0x29, 0xBD, 0x11, 0x7D, 0x9B,
+        0xD1, 0x8F, 0xEC, 0x4A, 0x0A, 0x82, 0x4A, 0x24,
+        0x08, 0x0F, 0x29, 0x8B, 0xAC, 0xD2, 0x96, 0xD7,
+        0xB4, 0x97, 0x83, 0x8F, 0xBD, 0x7B, 0x0D, 0x57,
+        0x5C, 0x52, 0x49, 0x2B, 0x3E, 0x6F, 0x92, 0x6B
+      },
+      {
+        0x37, 0xA1, 0x50, 0x66, 0xF2, 0xB9, 0xF9, 0x4C,
+        0x24, 0x61, 0x1B, 0xC4, 0x53, 0xED, 0x02, 0x74,
+        0x07, 0x8D, 0x1F, 0x70, 0xB2, 0xD3, 0x4C, 0x8B,
+        0x96, 0x36, 0x08, 0x48, 0x9D, 0xCB, 0xE8, 0xDF,
+        0x44, 0x8E, 0xDD, 0x9C, 0x73, 0x36, 0x2B, 0xB2,
+        0xB6, 0x6B, 0xEE, 0xF6, 0x1F, 0xCE, 0x60, 0x10,
+        0x6F, 0x70, 0x19, 0xED, 0x37, 0x3C, 0x69, 0x22,
+        0x59, 0xD9, 0x55, 0x6A, 0x94, 0x0B, 0x1A, 0x06
+      },
+      {
+        0xBD, 0x44, 0xE7, 0x39, 0xE1, 0xF9, 0xDB, 0x1C,
+        0x6B, 0xAF, 0x42, 0xCA, 0x4A, 0x12, 0xAC, 0x09,
+        0x9B, 0x96, 0xF6, 0xB3, 0x6C, 0x4B, 0xCB, 0x1B,
+        0x72, 0xEE, 0xFF, 0x08, 0xA6, 0x49, 0x68, 0x35,
+        0xEC, 0x65, 0x15, 0x0B, 0xE8, 0xFE, 0x16, 0xCB,
+        0xE3, 0x27, 0x07, 0xE3, 0x47, 0x54, 0x7D, 0xC5,
+        0xA5, 0x83, 0xD2, 0x65, 0x74, 0x6F, 0xA5, 0x95,
+        0xC5, 0xE7, 0x73, 0x0F, 0xCF, 0x24, 0x58, 0x1E
+      },
+      {
+        0xFA, 0xB2, 0x03, 0x8E, 0x94, 0x98, 0xA1, 0xC3,
+        0x9E, 0x05, 0x78, 0xA0, 0xA5, 0xEA, 0x6B, 0x44,
+        0xF3, 0xC1, 0xB4, 0x1A, 0xE5, 0x67, 0xF9, 0x91,
+        0x4A, 0x95, 0xB1, 0x31, 0xC4, 0x8D, 0x12, 0x1E,
+        0xCA, 0xCE, 0xA8, 0x95, 0xA0, 0x9B, 0x1D, 0x4E,
+        0x04, 0x42, 0xBE, 0xC9, 0xC5, 0x0C, 0x50, 0xE0,
+        0x0A, 0x9F, 0xAF, 0xEF, 0xFA, 0xE0, 0x70, 0x88,
+        0x4C, 0x26, 0x25, 0xA8, 0xB1, 0xA2, 0x17, 0x26
+      },
+      {
+        0x05, 0xA1, 0xB7, 0x6B, 0x2F, 0xD5, 0x62, 0x11,
+        0xE0, 0xF2, 0xD7, 0x5A, 0x25, 0x16, 0x54, 0xA7,
+        0x72, 0xF5, 0x5E, 0x18, 0xCA, 0x02, 0x2A, 0xF5,
+        0x2C, 0xB3, 0x30, 0x19, 0x1E, 0x98, 0xA3, 0xB8,
+        0xEB, 0x87, 0xE5, 0x11, 0x7B, 0xAE, 0x58, 0x04,
+        0x4D, 0x94, 0x4C, 0x1F, 0x18, 0x85, 0x45, 0x12,
+        0x25, 0x41, 0x77, 0x35, 0xFC, 0x72, 0xF7, 0x39,
+        0x36, 0x69, 0x3C, 0xFF, 0x45, 0x46, 0x9F, 0x8C
+      },
+      {
+        0x2A, 0x30, 0xC9, 0x6B, 0xDA, 0xC7, 0x8A, 0x39,
+        0x94, 0xEE, 0xCA, 0xA5, 0xA5, 0x3F, 0x82, 0x7F,
+        0x58, 0xE1, 0x32, 0x31, 0xA0, 0xD1, 0x13, 0x08,
+        0x6C, 0x06, 0xB1, 0xBD, 0xAB, 0xDA, 0x38, 0xD0,
+        0x8F, 0x1A, 0xE2, 0x7D, 0xE2, 0x5F, 0xD2, 0x2E,
+        0xEA, 0x70, 0xC0, 0x5F, 0x01, 0x32, 0xBF, 0x7A,
+        0x50, 0x1C, 0x82, 0xAE, 0x62, 0x15, 0xBF, 0xEF,
+        0x3C, 0x01, 0x63, 0x98, 0xBA, 0xF2, 0xCB, 0x62
+      },
+      {
+        0x48, 0xDB, 0x53, 0x76, 0x5B, 0x82, 0xBD, 0x6F,
+        0x25, 0x33, 0xEA, 0xE1, 0x7F, 0x67, 0x69, 0xD7,
+        0xA4, 0xE3, 0xB2, 0x43, 0x74, 0x60, 0x1C, 0xDD,
+        0x8E, 0xC0, 0xCA, 0x3A, 0xAB, 0x30, 0x93, 0xFD,
+        0x2B, 0x99, 0x24, 0x38, 0x46, 0x0B, 0xAF, 0x8D,
+        0xA5, 0x8F, 0xB9, 0xA8, 0x9B, 0x2C, 0x58, 0xF9,
+        0x68, 0xE6, 0x36, 0x17, 0xCB, 0xEB, 0x18, 0x44,
+        0xB0, 0x2D, 0x6A, 0x27, 0xC5, 0xB4, 0xAD, 0x41
+      },
+      {
+        0x5C, 0x8B, 0x2E, 0x0E, 0x1B, 0x5C, 0x8F, 0x45,
+        0x7D, 0x7F, 0x7B, 0xD9, 0xF0, 0x5A, 0x97, 0xE5,
+        0x8D, 0xDA, 0x1D, 0x28, 0xDB, 0x9F, 0x34, 0xD1,
+        0xCE, 0x73, 0x25, 0x28, 0xF9, 0x68, 0xBE, 0xDD,
+        0x9E, 0x1C, 0xC9, 0x35, 0x2D, 0x0A, 0x5D, 0xF6,
+        0x67, 0x29, 0x28, 0xBD, 0xD3, 0xEA, 0x6F, 0x5C,
+        0xB0, 0x60, 0x77, 0xCF, 0x3A, 0xD3, 0xA7, 0x6E,
+        0x29, 0xB2, 0x2E, 0x82, 0xBA, 0xC6, 0x7B, 0x61
+      },
+      {
+        0x5B, 0x73, 0x91, 0xAA, 0x52, 0xF2, 0x76, 0xFA,
+        0xB9, 0xC1, 0x38, 0x77, 0xF1, 0x22, 0x32, 0x70,
+        0x84, 0x97, 0xFC, 0x02, 0x8F, 0xAA, 0x17, 0x32,
+        0xA5, 0xDB, 0x07, 0x9E, 0x7F, 0xE0, 0x73, 0xED,
+        0x0C, 0xC9, 0x52, 0x9C, 0xFC, 0x86, 0x3A, 0x4E,
+        0xCB, 0xA4, 0xDC, 0x2F, 0x1E, 0xA9, 0xF6, 0xBD,
+        0x69, 0x04, 0xF3, 0xA0, 0xC1, 0x07, 0x19, 0x3C,
+        0x5E, 0x71, 0x1C, 0xB9, 0x11, 0xF3, 0x80, 0x25
+      },
+      {
+        0x1D, 0x5A, 0xF7, 0x0F, 0x09, 0xA5, 0xFC, 0x69,
+        0x16, 0xEF, 0x59, 0xA3, 0x8A, 0x86, 0x92, 0x6D,
+        0xCA, 0xAE, 0x39, 0xA8, 0x95, 0x4D, 0x73, 0xFC,
+        0x80, 0xA3, 0x50, 0x75, 0x1A, 0xDD, 0xA3, 0x8C,
+        0x9D, 0x59, 0x75, 0x06, 0xDC, 0x05, 0xE1, 0xED,
+        0x37, 0xBD, 0x2D, 0xB1, 0x59, 0x0F, 0x99, 0xAA,
+        0x29, 0x6A, 0xEA, 0x13, 0xAB, 0x84, 0x43, 0xD5,
+        0xA9, 0x23, 0x47, 0xFB, 0x85, 0xFC, 0x81, 0x6D
+      },
+      {
+        0x80, 0xE3, 0x70, 0x92, 0x97, 0xD4, 0x41, 0x14,
+        0xB9, 0xFB, 0xDF, 0x55, 0x67, 0xF0, 0x5F, 0x33,
+        0x00, 0x94, 0xCF, 0x09, 0xF4, 0xC0, 0xEF, 0xCF,
+        0xAC, 0x05, 0x09, 0x5C, 0x36, 0x08, 0x10, 0x77,
+        0x30, 0xC1, 0xAA, 0x07, 0xFF, 0x23, 0x00, 0x25,
+        0x62, 0xC7, 0xE8, 0x41, 0xA9, 0xF5, 0x66, 0x24,
+        0xFF, 0xE2, 0xAB, 0xEC, 0x61, 0x1E, 0xB9, 0xE7,
+        0x3E, 0x1C, 0xCB, 0xD8, 0xF6, 0x2B, 0x11, 0x49
+      },
+      {
+        0xF9, 0x94, 0x5C, 0x19, 0x06, 0x77, 0x84, 0x61,
+        0x94, 0x13, 0x2B, 0x49, 0x6E, 0xC6, 0x01, 0x2C,
+        0x08, 0x75, 0x0E, 0x02, 0x5F, 0xD5, 0x52, 0xED,
+        0x32, 0x4D, 0x3A, 0x49, 0xD8, 0x63, 0x66, 0xC0,
+        0x3D, 0xCC, 0xDE, 0x8D, 0x5B, 0x5A, 0xC9, 0xA4,
+        0xBC, 0xB7, 0x19, 0x5E, 0x63, 0xBC, 0xAA, 0x93,
+        0x9E, 0x8E, 0xDA, 0x18, 0xF1, 0x16, 0x94, 0xB6,
+        0xFA, 0x69, 0x37, 0x39, 0x3B, 0xFF, 0xDB, 0xF4
+      },
+      {
+        0x8D, 0x8F, 0x2E, 0xD9, 0xAE, 0x39, 0x80, 0x9A,
+        0xAC, 0xAD, 0x2F, 0xCE, 0xDB, 0xD2, 0xDC, 0xA7,
+        0x30, 0xC7, 0x83, 0xE6, 0x2F, 0xF7, 0x0B, 0x8D,
+        0x3C, 0x53, 0x62, 0xF0, 0x73, 0xF8, 0x34, 0x67,
+        0x19, 0x7D, 0x37, 0x56, 0xB4, 0x45, 0x19, 0x5F,
+        0xE7, 0x52, 0x11, 0x73, 0x64, 0xD9, 0x2C, 0xF4,
+        0x2C, 0x02, 0x6E, 0x40, 0x9D, 0x5F, 0xF7, 0xA9,
+        0x53, 0x3E, 0xAB, 0x78, 0xF1, 0x75, 0x4A, 0x2D
+      },
+      {
+        0x3A, 0xC9, 0x9A, 0xC5, 0x3A, 0xC4, 0x9A, 0x56,
+        0xFA, 0xA1, 0x86, 0x46, 0xB8, 0xE0, 0x8A, 0x2D,
+        0x35, 0xBE, 0x80, 0xDF, 0x3E, 0xFB, 0xBB, 0xA6,
+        0xBD, 0xA4, 0xAE, 0x90, 0x2B, 0x8D, 0x3E, 0x17,
+        0x0A, 0x7B, 0xE8, 0x60, 0x5C, 0x34, 0xA4, 0xDC,
+        0x9A, 0x73, 0x62, 0xB1, 0xC2, 0x01, 0xD7, 0x02,
+        0x39, 0x1B, 0xD7, 0xD5, 0x20, 0x7F, 0x95, 0xFA,
+        0x39, 0x0C, 0xE3, 0x3C, 0x43, 0x14, 0xD4, 0x11
+      },
+      {
+        0xE4, 0x69, 0x4B, 0xDB, 0x31, 0x01, 0x6F, 0x25,
+        0x53, 0x2C, 0x04, 0x3C, 0x5C, 0x63, 0x08, 0xCC,
+        0x61, 0x9B, 0x0F, 0x87, 0x16, 0xF0, 0xC2, 0x9E,
+        0xEB, 0x9F, 0x34, 0x0F, 0x47, 0xB0, 0x7B, 0x4A,
+        0x4C, 0xE0, 0x98, 0x4C, 0x47, 0x24, 0xB1, 0x2A,
+        0xB3, 0xD3, 0x2A, 0xF5, 0x16, 0xAD, 0xA2, 0x64,
+        0x4C, 0xA6, 0x55, 0x8C, 0x1C, 0xB5, 0x81, 0x5C,
+        0x12, 0x12, 0xA9, 0xB5, 0xFA, 0x83, 0x44, 0x12
+      },
+      {
+        0xC6, 0x3C, 0x70, 0x3E, 0x62, 0x10, 0x8A, 0xA0,
+        0xED, 0xC6, 0x83, 0xF3, 0x67, 0x8A, 0x00, 0x78,
+        0x8F, 0xB1, 0x00, 0xC0, 0x96, 0x0B, 0x4E, 0x98,
+        0xB7, 0x6A, 0x48, 0xE4, 0xE5, 0x92, 0x3D, 0x34,
+        0x13, 0x44, 0x8D, 0xB8, 0x87, 0x5E, 0x3B, 0xCE,
+        0xA7, 0xB6, 0xB8, 0x5D, 0x9E, 0x3E, 0xEA, 0xB7,
+        0x2C, 0xD1, 0x50, 0x96, 0xFB, 0xBB, 0x2C, 0xC4,
+        0x27, 0x03, 0x17, 0xFC, 0x34, 0xD4, 0x04, 0x71
+      },
+      {
+        0x90, 0x80, 0xB7, 0xE8, 0x41, 0xEF, 0x51, 0x9C,
+        0x54, 0x17, 0xE6, 0x90, 0xAA, 0xF4, 0x32, 0x79,
+        0x07, 0xA8, 0x3D, 0xBC, 0xB7, 0x38, 0xD0, 0xF7,
+        0x30, 0x8B, 0x1D, 0x61, 0x1D, 0xEF, 0x16, 0x9A,
+        0x4F, 0x47, 0x42, 0x3E, 0x69, 0x0F, 0x27, 0xA7,
+        0xE2, 0x74, 0x1A, 0xE7, 0x86, 0x5D, 0xA2, 0x3C,
+        0x5D, 0x3F, 0x13, 0xC3, 0x16, 0x06, 0x3C, 0x7A,
+        0xA1, 0xA9, 0x58, 0xE5, 0xBE, 0x83, 0x8F, 0x04
+      },
+      {
+        0x29, 0x8D, 0xF6, 0x46, 0x91, 0x5F, 0x04, 0xD6,
+        0x65, 0xE9, 0x67, 0x5E, 0x6A, 0x10, 0x31, 0x87,
+        0x0D, 0x28, 0xEB, 0x7A, 0x04, 0x05, 0x66, 0x3E,
+        0xAC, 0x3B, 0x10, 0xD1, 0xB4, 0xFA, 0x2E, 0x86,
+        0x8E, 0x63, 0x73, 0xA5, 0x86, 0xCD, 0x73, 0xE0,
+        0x6D, 0x8E, 0x7A, 0xD7, 0x71, 0xB4, 0xFB, 0x0A,
+        0x8B, 0x4F, 0xC2, 0xDC, 0x6C, 0xE0, 0x9C, 0x64,
+        0x2E, 0xE8, 0x99, 0x26, 0xFD, 0xC6, 0x52, 0x60
+      },
+      {
+        0x4F, 0x2D, 0xE9, 0xC4, 0xF4, 0x34, 0x8B, 0xDB,
+        0x32, 0x3A, 0x66, 0x83, 0x72, 0xE7, 0x71, 0x42,
+        0x99, 0xC7, 0x76, 0xF9, 0x60, 0x2F, 0x3A, 0xF8,
+        0xFB, 0x77, 0x46, 0xF1, 0x76, 0x86, 0x8D, 0xF3,
+        0x54, 0x2B, 0x2F, 0xA6, 0x9E, 0xAE, 0x38, 0xB6,
+        0xA2, 0x6A, 0x06, 0xCA, 0x89, 0x42, 0xF8, 0x82,
+        0x78, 0xC6, 0x4E, 0x3D, 0x01, 0x7F, 0xEE, 0x67,
+        0xA9, 0x4E, 0xA0, 0x23, 0xB2, 0xB5, 0xBE, 0x5F
+      },
+      {
+        0x40, 0x18, 0xC5, 0xEE, 0x90, 0x93, 0xA6, 0x81,
+        0x11, 0x2F, 0x4C, 0xE1, 0x93, 0xA1, 0xD6, 0x5E,
+        0x05, 0x48, 0x72, 0x5F, 0x96, 0xAE, 0x31, 0x53,
+        0x87, 0xCD, 0x76, 0x5C, 0x2B, 0x9C, 0x30, 0x68,
+        0xAE, 0x4C, 0xBE, 0x5C, 0xD5, 0x40, 0x2C, 0x11,
+        0xC5, 0x5A, 0x9D, 0x78, 0x5F, 0xFD, 0xFC, 0x2B,
+        0xDE, 0x6E, 0x7A, 0xCF, 0x19, 0x61, 0x74, 0x75,
+        0xDA, 0xE0, 0xEB, 0x01, 0x44, 0x56, 0xCE, 0x45
+      },
+      {
+        0x6F, 0xCE, 0x66, 0x75, 0xE8, 0x6D, 0x7E, 0x85,
+        0x70, 0x4C, 0x96, 0xC2, 0x95, 0x70, 0x3C, 0xD9,
+        0x54, 0x98, 0x59, 0x0E, 0x50, 0x76, 0x4D, 0x23,
+        0xD7, 0xA7, 0xA3, 0xA3, 0x22, 0x68, 0xA0, 0xB3,
+        0xC9, 0x91, 0xE8, 0xF7, 0x84, 0x87, 0x69, 0x9A,
+        0x55, 0x4B, 0x58, 0x1E, 0x33, 0x9C, 0x09, 0xAE,
+        0xC9, 0x82, 0xE0, 0xBA, 0xA4, 0x31, 0x87, 0x93,
+        0x62, 0x06, 0x35, 0xE1, 0xE2, 0xC8, 0xD9, 0xF2
+      },
+      {
+        0xEB, 0xA9, 0x37, 0x85, 0x91, 0x97, 0xC7, 0xFD,
+        0x41, 0x2D, 0xBC, 0x9A, 0xFC, 0x0D, 0x67, 0xCC,
+        0x19, 0x81, 0x60, 0xB5, 0xA9, 0xCC, 0xEE, 0x87,
+        0xC4, 0x1A, 0x86, 0x64, 0x85, 0x9F, 0x3E, 0xFD,
+        0x96, 0x13, 0x66, 0xA8, 0x09, 0xC7, 0xC6, 0xBC,
+        0x6F, 0xA8, 0x44, 0x92, 0x68, 0x14, 0xE0, 0xB4,
+        0xEF, 0xA3, 0x7E, 0xDE, 0x2C, 0x88, 0x44, 0x26,
+        0x8D, 0x7F, 0x35, 0x56, 0xE4, 0x46, 0x58, 0x1D
+      },
+      {
+        0x83, 0xF4, 0x33, 0xE4, 0xF1, 0xC5, 0x07, 0x97,
+        0x49, 0x3C, 0x58, 0xC2, 0x64, 0xCF, 0xFA, 0x70,
+        0xC4, 0xA7, 0xA2, 0x4C, 0x33, 0x4D, 0xBA, 0xA3,
+        0xC5, 0x74, 0x89, 0xD9, 0x70, 0xD4, 0x9D, 0x69,
+        0x49, 0xFE, 0x45, 0xB7, 0x04, 0xF2, 0x65, 0xEF,
+        0xD2, 0xAE, 0xE1, 0xAC, 0x1B, 0x46, 0xF4, 0xAA,
+        0x3E, 0x4F, 0xAD, 0x68, 0xB3, 0x79, 0x61, 0xD2,
+        0xC7, 0x28, 0x0A, 0xE1, 0x96, 0x72, 0xC8, 0x50
+      },
+      {
+        0xB5, 0x57, 0xEC, 0xE1, 0x22, 0x72, 0x49, 0x3D,
+        0xC2, 0x7E, 0x88, 0xA0, 0x5A, 0xDC, 0xD8, 0x61,
+        0x87, 0x5A, 0x0C, 0xD0, 0x0B, 0xD6, 0x8A, 0xDC,
+        0x3A, 0x30, 0x1D, 0x26, 0x3A, 0x9C, 0xD9, 0x93,
+        0xA9, 0x6A, 0xE1, 0x4C, 0xFC, 0xDD, 0xCB, 0x99,
+        0x7C, 0xC9, 0x86, 0x23, 0x93, 0x50, 0x50, 0xEA,
+        0x43, 0x55, 0x2A, 0x34, 0x11, 0x07, 0x18, 0x7D,
+        0xE7, 0x5C, 0x4E, 0xDE, 0xD7, 0xC7, 0x86, 0xBD
+      },
+      {
+        0x95, 0x89, 0xC0, 0x81, 0x3B, 0x73, 0x93, 0xDB,
+        0xAA, 0xAF, 0xE4, 0x7A, 0xF5, 0xB4, 0x08, 0xB2,
+        0x3C, 0x8A, 0x8C, 0x8B, 0xAC, 0x62, 0x55, 0x4B,
+        0x8F, 0xA1, 0x32, 0xA3, 0x58, 0xCE, 0x30, 0x83,
+        0xB1, 0xD4, 0xE3, 0x97, 0x07, 0xCD, 0x54, 0xA5,
+        0x5F, 0x67, 0x3D, 0x48, 0x11, 0x6E, 0xB1, 0xF9,
+        0xED, 0x8D, 0xE9, 0xC9, 0x43, 0xCD, 0x2D, 0xE4,
+        0x60, 0xA6, 0x8B, 0xDD, 0xF7, 0x1E, 0x98, 0x03
+      },
+      {
+        0xAE, 0x4C, 0xCF, 0x27, 0xAB, 0x00, 0xA4, 0x0C,
+        0x36, 0x37, 0xD3, 0xD2, 0xCE, 0x51, 0xA8, 0x3E,
+        0xFB, 0xA6, 0x2D, 0x4A, 0x6F, 0xDA, 0xD6, 0x95,
+        0x06, 0x3F, 0xBC, 0x60, 0xA2, 0xD8, 0x2E, 0xC5,
+        0xA5, 0x4A, 0xCB, 0xE0, 0x9B, 0xA9, 0x38, 0x8F,
+        0x49, 0xAA, 0xC2, 0x7C, 0x99, 0x2D, 0x84, 0x63,
+        0x20, 0x36, 0xE1, 0xBD, 0xD4, 0xC5, 0x29, 0xBB,
+        0xF1, 0x85, 0x1E, 0xAE, 0x0C, 0x6E, 0xA9, 0x02
+      },
+      {
+        0xA3, 0x94, 0x4B, 0x2C, 0x31, 0xCB, 0x49, 0x40,
+        0x80, 0xB7, 0xEE, 0x1D, 0xB0, 0x81, 0x68, 0x53,
+        0xE4, 0x25, 0xB5, 0x4C, 0x48, 0xD6, 0x31, 0x44,
+        0x7E, 0xA5, 0x2C, 0x1D, 0x29, 0x52, 0x07, 0x9B,
+        0xD8, 0x8F, 0xAB, 0x9E, 0xD0, 0xB7, 0xD8, 0xC0,
+        0xBA, 0xAF, 0x0C, 0x4E, 0xCA, 0x19, 0x10, 0xDB,
+        0x6F, 0x98, 0x53, 0x4F, 0x0D, 0x42, 0xE5, 0xEB,
+        0xB6, 0xC0, 0xA7, 0x5E, 0xF0, 0xD8, 0xB2, 0xC0
+      },
+      {
+        0xCF, 0xA1, 0xA2, 0x24, 0x68, 0x5A, 0x5F, 0xB2,
+        0x01, 0x04, 0x58, 0x20, 0x1C, 0xEB, 0x0C, 0xDA,
+        0x21, 0xC8, 0x2B, 0x16, 0x02, 0xDC, 0x41, 0x35,
+        0x85, 0xFB, 0xCE, 0x80, 0x97, 0x6F, 0x06, 0x1C,
+        0x23, 0x5B, 0x13, 0x67, 0x71, 0x24, 0x98, 0x14,
+        0x4A, 0xC1, 0x6A, 0x98, 0x54, 0xF6, 0xFB, 0x32,
+        0x3C, 0xBE, 0xB6, 0x23, 0x69, 0xCF, 0x9B, 0x75,
+        0x2B, 0x92, 0x52, 0xA2, 0xA7, 0xAC, 0xE1, 0xFD
+      },
+      {
+        0xFA, 0x62, 0xC6, 0xCF, 0xC8, 0xF0, 0x79, 0xE5,
+        0x8F, 0x3D, 0x3F, 0xEF, 0xD7, 0xC2, 0x24, 0xE7,
+        0x1E, 0xBC, 0x69, 0xA9, 0x5B, 0x18, 0x35, 0xCC,
+        0xC3, 0x2F, 0x35, 0x07, 0x77, 0x05, 0x11, 0x02,
+        0x61, 0x54, 0x92, 0xD6, 0x7F, 0xB6, 0xDE, 0x62,
+        0xCF, 0x2A, 0xD5, 0xB1, 0x84, 0x67, 0xFE, 0x87,
+        0x15, 0x74, 0x88, 0x82, 0xDB, 0x89, 0xFF, 0x86,
+        0xEF, 0xDF, 0x2F, 0x96, 0xF8, 0x13, 0x5E, 0xD2
+      },
+      {
+        0xCC, 0x63, 0x3F, 0xD4, 0xEA, 0x6A, 0xC4, 0x08,
+        0xC3, 0x87, 0x57, 0x56, 0xB9, 0x01, 0x28, 0x8A,
+        0x1D, 0xE1, 0x91, 0x89, 0x28, 0x32, 0xBE, 0x2E,
+        0x90, 0x26, 0xDC, 0x65, 0xC2, 0xFF, 0x00, 0x00,
+        0x9F, 0x14, 0x36, 0xDD, 0xFF, 0x42, 0x06, 0x26,
+        0x0A, 0x3D, 0x66, 0xEF, 0x61, 0x92, 0x14, 0x3E,
+        0x57, 0x2F, 0x1E, 0x4B, 0xB8, 0xE5, 0xA7, 0x4B,
+        0x12, 0x05, 0x5E, 0x42, 0x41, 0x1C, 0x18, 0xBC
+      },
+      {
+        0x44, 0xD2, 0xBF, 0x7F, 0x36, 0x96, 0xB8, 0x93,
+        0x3F, 0x25, 0x5B, 0x9B, 0xE1, 0xA4, 0xA6, 0xAE,
+        0x33, 0x16, 0xC2, 0x5D, 0x03, 0x95, 0xF5, 0x90,
+        0xB9, 0xB9, 0x89, 0x8F, 0x12, 0x7E, 0x40, 0xD3,
+        0xF4, 0x12, 0x4D, 0x7B, 0xDB, 0xC8, 0x72, 0x5F,
+        0x00, 0xB0, 0xD2, 0x81, 0x50, 0xFF, 0x05, 0xB4,
+        0xA7, 0x9E, 0x5E, 0x04, 0xE3, 0x4A, 0x47, 0xE9,
+        0x08, 0x7B, 0x3F, 0x79, 0xD4, 0x13, 0xAB, 0x7F
+      },
+      {
+        0x96, 0xFB, 0xCB, 0xB6, 0x0B, 0xD3, 0x13, 0xB8,
+        0x84, 0x50, 0x33, 0xE5, 0xBC, 0x05, 0x8A, 0x38,
+        0x02, 0x74, 0x38, 0x57, 0x2D, 0x7E, 0x79, 0x57,
+        0xF3, 0x68, 0x4F, 0x62, 0x68, 0xAA, 0xDD, 0x3A,
+        0xD0, 0x8D, 0x21, 0x76, 0x7E, 0xD6, 0x87, 0x86,
+        0x85, 0x33, 0x1B, 0xA9, 0x85, 0x71, 0x48, 0x7E,
+        0x12, 0x47, 0x0A, 0xAD, 0x66, 0x93, 0x26, 0x71,
+        0x6E, 0x46, 0x66, 0x7F, 0x69, 0xF8, 0xD7, 0xE8
+      }
+    } ;
 }       /* end of [namespace TestVector] */
 
 /*
@@ -12,6 +12,7 @@ namespace TestVector {
     const size_t	NUM_BLAKE2_TEST = 256 ;
     const size_t	DIGEST_SIZE = 64 ;
     extern const uint8_t	BLAKE2 [NUM_BLAKE2_TEST][DIGEST_SIZE] ;
+    extern const uint8_t	BLAKE2BP [NUM_BLAKE2_TEST][DIGEST_SIZE] ;
 }	/* end of [namespace TestVector] */
 
 #endif	/* testvector_h__618b59b34535a8a541907188170282ec */
@@ -0,0 +1,277 @@
+/*
+ * bench-scaling.cpp: Scaling of the parallel and tree modes with the # of threads (CSV output).
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "BLAKE2.hpp"
+#include "BLAKE2/Parallel.hpp"
+#include "BLAKE2/ThreadPool.hpp"
+
+/*
+ * Usage: bench-scaling [--threads LIST] [--sizes LIST] [--leaves LIST]
+ *                      [--budget-ms MS] [--saturation FRACTION] [--pin] [--output FILE]
+ *
+ * LIST is comma separated, sizes accept K, M and G suffixes.
+ * With --pin, the workers of T threads run on CPU 1 ... T - 1 (the calling thread is the T-th).
+ *
+ * Every (mode, size, leaf) series is run on thread pools of each thread count.
+ * Modes are "memory" (summing the input, the memory bandwidth reference),
+ * "parallel" (BLAKE2bp) and "tree" (depth 2, unlimited fanout, one row per leaf length).
+ *
+ *     mode,size,leaf,threads,ns,gbps,speedup,efficiency,saturated
+ *
+ * speedup is against the series on 1 thread and efficiency = speedup / threads.
+ * A series is saturated from the first thread count whose next one gains less than
+ * the saturation fraction (10% by default); saturated is 1 on these rows.
+ */
+
+namespace {
+    const uint64_t  DEFAULT_BUDGET_MS = 200 ;
+    const double    DEFAULT_SATURATION = 0.10 ;
+
+    struct Options {
+        std::vector<size_t>     threads ;
+        std::vector<size_t>     sizes { 1u << 20, 16u << 20, 256u << 20 } ;
+        std::vector<size_t>     leaves { 64u << 10, 1u << 20, 16u << 20 } ;
+        uint64_t                budget_ms = DEFAULT_BUDGET_MS ;
+        double                  saturation = DEFAULT_SATURATION ;
+        bool                    pin = false ;
+        std::string             output ;
+    } ;
+
+    struct Row {
+        size_t  threads ;
+        double  ns ;
+    } ;
+
+    bool    parse_size (const char *s, size_t &result) {
+        char *      end = nullptr ;
+        uint64_t    v = strtoull (s, &end, 10) ;
+        if (end == s) {
+            return false ;
+        }
+        switch (*end) {
+        case 'G': case 'g':
+            v <<= 10 ;
+            /* FALLTHROUGH */
+        case 'M': case 'm':
+            v <<= 10 ;
+            /* FALLTHROUGH */
+        case 'K': case 'k':
+            v <<= 10 ;
+            ++end ;
+            break ;
+        default:
+            break ;
+        }
+        result = static_cast<size_t> (v) ;
+        return *end == 0 && 0 < v ;
+    }
+
+    bool    parse_list (const char *s, std::vector<size_t> &result) {
+        result.clear () ;
+        std::string     item ;
+        for (const char *p = s ; ; ++p) {
+            if (*p != ',' && *p != 0) {
+                item += *p ;
+                continue ;
+            }
+            size_t  v ;
+            if (! parse_size (item.c_str (), v)) {
+                return false ;
+            }
+            result.push_back (v) ;
+            item.clear () ;
+            if (*p == 0) {
+                return true ;
+            }
+        }
+    }
+
+    /** 1, 2, 4, ... and the hardware concurrency.  */
+    std::vector<size_t>     default_threads () {
+        const size_t    hw = std::max<size_t> (1, std::thread::hardware_concurrency ()) ;
+        std::vector<size_t>     result ;
+        for (size_t t = 1 ; t < hw ; t *= 2) {
+            result.push_back (t) ;
+        }
+        result.push_back (hw) ;
+        return result ;
+    }
+
+    /** Best ns of OP within BUDGET (at least 2 rounds).  */
+    double  measure (const std::function<void ()> &op, std::chrono::milliseconds budget) {
+        using clock = std::chrono::steady_clock ;
+        op () ;     // Warms up.
+        double      best = std::numeric_limits<double>::max () ;
+        const auto  start = clock::now () ;
+        int         rounds = 0 ;
+        do {
+            const auto  t = clock::now () ;
+            op () ;
+            const auto  elapsed = std::chrono::duration_cast<std::chrono::nanoseconds> (clock::now () - t) ;
+            best = std::min (best, static_cast<double> (elapsed.count ())) ;
+        } while (++rounds < 2 || clock::now () - start < budget) ;
+        return best ;
+    }
+
+    void    write_series ( FILE *out, const Options &opt
+                         , const char *mode, size_t size, size_t leaf, const std::vector<Row> &rows) {
+        const double    base = rows.front ().ns ;   // On 1 thread.
+        size_t          saturated = rows.size () ;
+        for (size_t i = 0 ; i + 1 < rows.size () ; ++i) {
+            if (rows [i].ns / rows [i + 1].ns < 1.0 + opt.saturation) {
+                saturated = i ;
+                break ;
+            }
+        }
+        for (size_t i = 0 ; i < rows.size () ; ++i) {
+            const double    speedup = base / rows [i].ns ;
+            fprintf ( out, "%s,%zu,%zu,%zu,%.0f,%.3f,%.3f,%.3f,%d\n"
+                    , mode, size, leaf, rows [i].threads, rows [i].ns
+                    , static_cast<double> (size) / rows [i].ns
+                    , speedup, speedup / rows [i].threads
+                    , (saturated <= i) ? 1 : 0) ;
+        }
+        fflush (out) ;
+    }
+
+    int     usage () {
+        fprintf (stderr, "usage: bench-scaling [--threads LIST] [--sizes LIST] [--leaves LIST]"
+                         " [--budget-ms MS] [--saturation FRACTION] [--pin] [--output FILE]\n") ;
+        return 2 ;
+    }
+}
+
+int     main (int argc, char **argv) {
+    Options     opt ;
+    opt.threads = default_threads () ;
+    for (int i = 1 ; i < argc ; ++i) {
+        const std::string   arg { argv [i] } ;
+        bool    ok = true ;
+        if (arg == "--pin") {
+            opt.pin = true ;
+        }
+        else if (i + 1 < argc && arg == "--threads") {
+            ok = parse_list (argv [++i], opt.threads) ;
+        }
+        else if (i + 1 < argc && arg == "--sizes") {
+            ok = parse_list (argv [++i], opt.sizes) ;
+        }
+        else if (i + 1 < argc && arg == "--leaves") {
+            ok = parse_list (argv [++i], opt.leaves) ;
+        }
+        else if (i + 1 < argc && arg == "--budget-ms") {
+            opt.budget_ms = strtoull (argv [++i], nullptr, 10) ;
+        }
+        else if (i + 1 < argc && arg == "--saturation") {
+            opt.saturation = strtod (argv [++i], nullptr) ;
+        }
+        else if (i + 1 < argc && arg == "--output") {
+            opt.output = argv [++i] ;
+        }
+        else {
+            ok = false ;
+        }
+        if (! ok) {
+            return usage () ;
+        }
+    }
+    // Speedups are against 1 thread.
+    std::sort (opt.threads.begin (), opt.threads.end ()) ;
+    opt.threads.erase (std::unique (opt.threads.begin (), opt.threads.end ()), opt.threads.end ()) ;
+    for (size_t leaf : opt.leaves) {
+        if (std::numeric_limits<uint32_t>::max () < leaf) {
+            return usage () ;       // Leaf lengths are 32 bits.
+        }
+    }
+    if (opt.threads.front () != 1) {
+        opt.threads.insert (opt.threads.begin (), 1) ;
+    }
+    FILE *  out = stdout ;
+    std::unique_ptr<FILE, int (*)(FILE *)>  file { nullptr, fclose } ;
+    if (! opt.output.empty ()) {
+        file.reset (fopen (opt.output.c_str (), "w")) ;
+        if (! file) {
+            fprintf (stderr, "bench-scaling: %s: %s\n", opt.output.c_str (), strerror (errno)) ;
+            return 2 ;
+        }
+        out = file.get () ;
+    }
+    const size_t    max_size = *std::max_element (opt.sizes.begin (), opt.sizes.end ()) ;
+    std::vector<uint8_t>    data (max_size) ;
+    for (size_t i = 0 ; i < data.size () ; ++i) {
+        data [i] = static_cast<uint8_t> (i * 131 + (i >> 12)) ;     // Also faults the pages in.
+    }
+    const std::chrono::milliseconds     budget { opt.budget_ms } ;
+
+    // The calling thread joins the jobs, so T threads are T - 1 workers.
+    std::vector<std::unique_ptr<BLAKE2::Executor>>  executors ;
+    for (size_t t : opt.threads) {
+        if (t == 1) {
+            executors.emplace_back (new BLAKE2::SequentialExecutor {}) ;
+            continue ;
+        }
+        std::vector<int>    affinity ;
+        for (size_t c = 1 ; opt.pin && c < t ; ++c) {
+            affinity.push_back (static_cast<int> (c)) ;
+        }
+        executors.emplace_back (new BLAKE2::ThreadPool { t - 1, affinity }) ;
+    }
+    auto    sweep = [&](const std::function<void (BLAKE2::Executor &, size_t)> &op) {
+        std::vector<Row>    rows ;
+        for (size_t i = 0 ; i < executors.size () ; ++i) {
+            rows.push_back ({ opt.threads [i], measure ([&]() { op (*executors [i], opt.threads [i]) ; }, budget) }) ;
+        }
+        return rows ;
+    } ;
+
+    fprintf (out, "mode,size,leaf,threads,ns,gbps,speedup,efficiency,saturated\n") ;
+    volatile uint64_t   sink = 0 ;
+    for (size_t size : opt.sizes) {
+        write_series (out, opt, "memory", size, 0, sweep ([&](BLAKE2::Executor &exec, size_t jobs) {
+            const size_t    words = size / sizeof (uint64_t) ;
+            std::vector<uint64_t>   sums (jobs) ;
+            exec.Run (jobs, [&](size_t job) {
+                auto const *    p = reinterpret_cast<const uint64_t *> (data.data ()) ;
+                uint64_t        s = 0 ;
+                for (size_t k = words * job / jobs ; k < words * (job + 1) / jobs ; ++k) {
+                    s += p [k] ;
+                }
+                sums [job] = s ;
+            }) ;
+            for (auto s : sums) {
+                sink = sink + s ;
+            }
+        })) ;
+        write_series (out, opt, "parallel", size, 0, sweep ([&](BLAKE2::Executor &exec, size_t) {
+            sink = sink + BLAKE2::ApplyParallel (nullptr, 0, data.data (), size, &exec).data () [0] ;
+        })) ;
+        for (size_t leaf : opt.leaves) {
+            if (size <= leaf) {
+                continue ;      // A single leaf is the sequential mode.
+            }
+            BLAKE2::Parameter   P ;
+            P.SetFanoutCount (0).SetDepth (2).SetLeafLength (static_cast<uint32_t> (leaf)).SetInnerLength (BLAKE2::Digest::SIZE) ;
+            write_series (out, opt, "tree", size, leaf, sweep ([&](BLAKE2::Executor &exec, size_t) {
+                sink = sink + BLAKE2::ApplyTree (P.GetParameterBlock (), nullptr, 0, data.data (), size, &exec).data () [0] ;
+            })) ;
+        }
+    }
+    return 0 ;
+}
+/*
+ * [END OF FILE]
+ */
@@ -0,0 +1,381 @@
+/*
+ * perf-blake2.cpp: Performance regression gate (micro-benchmarks against a stored baseline).
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "BLAKE2.hpp"
+#include "BLAKE2/Kernel.hpp"
+
+/*
+ * Usage: perf-blake2 --baseline FILE [--tolerance FRACTION] [--budget-ms MS] [--retries N] [--update]
+ *
+ * Every benchmark reports the best ns per operation over the rounds run within the
+ * budget.  A benchmark regresses when it is slower than its baseline by more than
+ * its tolerance (the "tolerance" of its baseline entry, or --tolerance).
+ * Regressions are confirmed by up to N reruns.
+ * Only --update records the results as the baseline, without a baseline the gate is skipped.
+ *
+ * Exit status: 0 no regression, 1 regressed, 2 usage or I/O error, 77 no baseline.
+ */
+
+namespace {
+    const double    DEFAULT_TOLERANCE = 0.15 ;
+    const uint64_t  DEFAULT_BUDGET_MS = 100 ;
+    const uint64_t  DEFAULT_RETRIES = 2 ;         // # of reruns confirming a regression.
+    const size_t    COMPRESS_BLOCKS = 1024 ;    // # of blocks compressed per round.
+    const size_t    STREAM_LENGTH = 16 * 1024 * 1024 ;
+    const size_t    STREAM_CHUNK = 4096 ;
+    const int       EXIT_NO_BASELINE = 77 ;     // SKIP_RETURN_CODE of the test.
+
+    struct Entry {
+        double  ns ;
+        double  tolerance ;     // < 0: not specified.
+    } ;
+
+    using entries_t = std::map<std::string, Entry> ;
+
+    /**
+     * Reads the baseline: `{ "benchmarks": { NAME: { "ns": X, "tolerance": Y }, ... } }`.
+     * Other members are skipped.
+     */
+    class BaselineReader {
+    private:
+        const std::string &     s_ ;
+        size_t                  pos_ ;
+    public:
+        explicit BaselineReader (const std::string &s) : s_ (s), pos_ { 0 } {
+            /* NO-OP */
+        }
+
+        /** @return false on a syntax error  */
+        bool    Read (entries_t &result) {
+            std::map<std::string, double>   values ;
+            if (! Value ("", values)) {
+                return false ;
+            }
+            Skip () ;
+            if (pos_ != s_.size ()) {
+                return false ;
+            }
+            const std::string   prefix { "benchmarks." } ;
+            for (auto const &kv : values) {
+                if (kv.first.compare (0, prefix.size (), prefix) != 0) {
+                    continue ;
+                }
+                const size_t        dot = kv.first.rfind ('.') ;
+                const std::string   name = kv.first.substr (prefix.size (), dot - prefix.size ()) ;
+                const std::string   member = kv.first.substr (dot + 1) ;
+                auto    it = result.emplace (name, Entry { -1.0, -1.0 }).first ;
+                if (member == "ns") {
+                    it->second.ns = kv.second ;
+                }
+                else if (member == "tolerance") {
+                    it->second.tolerance = kv.second ;
+                }
+            }
+            for (auto it = result.begin () ; it != result.end () ;) {
+                it = (it->second.ns <= 0) ? result.erase (it) : std::next (it) ;
+            }
+            return true ;
+        }
+    private:
+        void    Skip () {
+            while (pos_ < s_.size () && isspace (static_cast<unsigned char> (s_ [pos_]))) {
+                ++pos_ ;
+            }
+        }
+
+        bool    Accept (char ch) {
+            Skip () ;
+            if (pos_ < s_.size () && s_ [pos_] == ch) {
+                ++pos_ ;
+                return true ;
+            }
+            return false ;
+        }
+
+        bool    String (std::string &result) {
+            if (! Accept ('"')) {
+                return false ;
+            }
+            result.clear () ;
+            while (pos_ < s_.size () && s_ [pos_] != '"') {
+                if (s_ [pos_] == '\\' && pos_ + 1 < s_.size ()) {
+                    ++pos_ ;
+                }
+                result += s_ [pos_++] ;
+            }
+            return Accept ('"') ;
+        }
+
+        /** Flattens numbers into VALUES as `PATH.MEMBER`.  */
+        bool    Value (const std::string &path, std::map<std::string, double> &values) {
+            Skip () ;
+            if (s_.size () <= pos_) {
+                return false ;
+            }
+            const char  ch = s_ [pos_] ;
+            if (ch == '{') {
+                ++pos_ ;
+                if (Accept ('}')) {
+                    return true ;
+                }
+                do {
+                    std::string     key ;
+                    if (! String (key) || ! Accept (':')) {
+                        return false ;
+                    }
+                    if (! Value (path.empty () ? key : path + "." + key, values)) {
+                        return false ;
+                    }
+                } while (Accept (',')) ;
+                return Accept ('}') ;
+            }
+            if (ch == '[') {
+                ++pos_ ;
+                if (Accept (']')) {
+                    return true ;
+                }
+                do {
+                    if (! Value (path + ".[]", values)) {
+                        return false ;
+                    }
+                } while (Accept (',')) ;
+                return Accept (']') ;
+            }
+            if (ch == '"') {
+                std::string     dummy ;
+                return String (dummy) ;
+            }
+            if (s_.compare (pos_, 4, "true") == 0 || s_.compare (pos_, 4, "null") == 0) {
+                pos_ += 4 ;
+                return true ;
+            }
+            if (s_.compare (pos_, 5, "false") == 0) {
+                pos_ += 5 ;
+                return true ;
+            }
+            const char *    start = s_.c_str () + pos_ ;
+            char *          end = nullptr ;
+            const double    v = strtod (start, &end) ;
+            if (end == start) {
+                return false ;
+            }
+            pos_ += static_cast<size_t> (end - start) ;
+            values [path] = v ;
+            return true ;
+        }
+    } ;
+
+    std::string     to_json (const entries_t &entries, double tolerance) {
+        std::string     out { "{\n    \"benchmarks\": {" } ;
+        const char *    sep = "\n" ;
+        for (auto const &kv : entries) {
+            char    buf [256] ;
+            snprintf ( buf, sizeof (buf), "%s        \"%s\": { \"ns\": %.3f, \"tolerance\": %.3f }"
+                     , sep, kv.first.c_str (), kv.second.ns
+                     , (0 <= kv.second.tolerance) ? kv.second.tolerance : tolerance) ;
+            out += buf ;
+            sep = ",\n" ;
+        }
+        out += "\n    }\n}\n" ;
+        return out ;
+    }
+
+    /** Best ns per operation of OP (running OPS_PER_ROUND operations) within BUDGET.  */
+    double  measure (const std::function<void ()> &op, size_t ops_per_round, std::chrono::milliseconds budget) {
+        using clock = std::chrono::steady_clock ;
+        op () ;     // Warms up.
+        double      best = std::numeric_limits<double>::max () ;
+        const auto  start = clock::now () ;
+        do {
+            const auto  t = clock::now () ;
+            op () ;
+            const auto  elapsed = std::chrono::duration_cast<std::chrono::nanoseconds> (clock::now () - t) ;
+            best = std::min (best, static_cast<double> (elapsed.count ()) / ops_per_round) ;
+        } while (clock::now () - start < budget) ;
+        return best ;
+    }
+
+    entries_t   run_benchmarks (std::chrono::milliseconds budget) {
+        entries_t   result ;
+        auto    record = [&result](const std::string &name, double ns) {
+            result [name] = Entry { ns, -1.0 } ;
+        } ;
+        std::vector<uint8_t>    data (STREAM_LENGTH) ;
+        for (size_t i = 0 ; i < data.size () ; ++i) {
+            data [i] = static_cast<uint8_t> (i * 131 + (i >> 12)) ;
+        }
+        volatile uint8_t    sink = 0 ;
+
+        // `Compress` per kernel (ns per block).
+        const std::string   active = BLAKE2::Kernel::GetActiveName () ;
+        for (auto const &name : BLAKE2::Kernel::GetNames ()) {
+            if (! BLAKE2::Kernel::Select (name)) {
+                continue ;      // Not supported by this CPU.
+            }
+            BLAKE2::hash_t  h ;
+            BLAKE2::InitializeChain (h) ;
+            uint64_t        t0 = 0 ;
+            record ("compress/" + name, measure ([&]() {
+                for (size_t i = 0 ; i < COMPRESS_BLOCKS ; ++i) {
+                    BLAKE2::Compress (h, data.data () + (i % 64) * BLAKE2::BLOCK_SIZE, t0 += BLAKE2::BLOCK_SIZE, 0, 0, 0) ;
+                }
+            }, COMPRESS_BLOCKS, budget)) ;
+            sink = sink + static_cast<uint8_t> (h [0]) ;
+        }
+        BLAKE2::Kernel::Select (active) ;
+
+        // `Apply` (ns per call).
+        for (size_t size : { size_t (64), size_t (1024), size_t (1024 * 1024) }) {
+            const size_t    rounds = std::max<size_t> (1, 64 * 1024 / size) ;
+            record ("apply/" + std::to_string (size), measure ([&]() {
+                for (size_t i = 0 ; i < rounds ; ++i) {
+                    sink = sink + BLAKE2::Apply (nullptr, 0, data.data () + i, size).data () [0] ;
+                }
+            }, rounds, budget)) ;
+        }
+
+        // `Generator` streaming STREAM_CHUNK bytes per `Update` (ns per MiB).
+        record ("generator/stream", measure ([&]() {
+            BLAKE2::Generator   g { BLAKE2::Parameter ().GetParameterBlock () } ;
+            for (size_t off = 0 ; off < data.size () ; off += STREAM_CHUNK) {
+                g.Update (data.data () + off, STREAM_CHUNK) ;
+            }
+            sink = sink + g.Finalize ().data () [0] ;
+        }, STREAM_LENGTH / (1024 * 1024), budget)) ;
+        return result ;
+    }
+
+    int     usage () {
+        fprintf (stderr, "usage: perf-blake2 --baseline FILE [--tolerance FRACTION] [--budget-ms MS] [--retries N] [--update]\n") ;
+        return 2 ;
+    }
+}
+
+int     main (int argc, char **argv) {
+    std::string     baseline_path ;
+    double          tolerance = DEFAULT_TOLERANCE ;
+    uint64_t        budget_ms = DEFAULT_BUDGET_MS ;
+    uint64_t        retries = DEFAULT_RETRIES ;
+    bool            update = false ;
+    for (int i = 1 ; i < argc ; ++i) {
+        const std::string   arg { argv [i] } ;
+        if (arg == "--update") {
+            update = true ;
+        }
+        else if (i + 1 < argc && arg == "--baseline") {
+            baseline_path = argv [++i] ;
+        }
+        else if (i + 1 < argc && arg == "--tolerance") {
+            tolerance = strtod (argv [++i], nullptr) ;
+        }
+        else if (i + 1 < argc && arg == "--budget-ms") {
+            budget_ms = strtoull (argv [++i], nullptr, 10) ;
+        }
+        else if (i + 1 < argc && arg == "--retries") {
+            retries = strtoull (argv [++i], nullptr, 10) ;
+        }
+        else {
+            return usage () ;
+        }
+    }
+    if (baseline_path.empty () || tolerance < 0) {
+        return usage () ;
+    }
+    entries_t   baseline ;
+    bool        has_baseline = false ;
+    {
+        std::ifstream   in { baseline_path } ;
+        if (in) {
+            std::stringstream   ss ;
+            ss << in.rdbuf () ;
+            if (! BaselineReader { ss.str () }.Read (baseline)) {
+                fprintf (stderr, "perf-blake2: %s: malformed baseline\n", baseline_path.c_str ()) ;
+                return 2 ;
+            }
+            has_baseline = true ;
+        }
+    }
+    if (! update && ! has_baseline) {
+        fprintf (stderr, "perf-blake2: %s: no baseline (record one with --update)\n", baseline_path.c_str ()) ;
+        return EXIT_NO_BASELINE ;
+    }
+    entries_t   results = run_benchmarks (std::chrono::milliseconds { budget_ms }) ;
+
+    if (update) {
+        entries_t   recorded = results ;
+        for (auto &kv : recorded) {
+            printf ("%-24s %12.3f ns\n", kv.first.c_str (), kv.second.ns) ;
+            auto    it = baseline.find (kv.first) ;
+            if (it != baseline.end ()) {
+                kv.second.tolerance = it->second.tolerance ;    // Keeps hand tuned tolerances.
+            }
+        }
+        std::ofstream   out { baseline_path, std::ios::out | std::ios::trunc } ;
+        out << to_json (recorded, tolerance) ;
+        if (! out) {
+            fprintf (stderr, "perf-blake2: %s: cannot write the baseline\n", baseline_path.c_str ()) ;
+            return 2 ;
+        }
+        printf ("Baseline recorded to %s\n", baseline_path.c_str ()) ;
+        return 0 ;
+    }
+    auto    tolerance_of = [tolerance](entries_t::const_iterator it) {
+        return (0 <= it->second.tolerance) ? it->second.tolerance : tolerance ;
+    } ;
+    auto    count_regressions = [&]() {
+        int     cnt = 0 ;
+        for (auto const &kv : results) {
+            auto    it = baseline.find (kv.first) ;
+            cnt += (it != baseline.end () && 1.0 + tolerance_of (it) < kv.second.ns / it->second.ns) ? 1 : 0 ;
+        }
+        return cnt ;
+    } ;
+    // A regression has to survive the reruns (the best time is kept), so a noisy neighbour does not fail the gate.
+    for (uint64_t i = 0 ; i < retries && 0 < count_regressions () ; ++i) {
+        for (auto const &kv : run_benchmarks (std::chrono::milliseconds { budget_ms })) {
+            results [kv.first].ns = std::min (results [kv.first].ns, kv.second.ns) ;
+        }
+    }
+    int     regressed = 0 ;
+    for (auto const &kv : results) {
+        auto    it = baseline.find (kv.first) ;
+        if (it == baseline.end ()) {
+            printf ("%-24s no baseline\n", kv.first.c_str ()) ;
+            continue ;
+        }
+        const double    tol = tolerance_of (it) ;
+        const double    ratio = kv.second.ns / it->second.ns ;
+        const bool      bad = 1.0 + tol < ratio ;
+        printf ( "%-24s %12.3f ns (baseline %12.3f ns, x%.3f, tolerance %.0f%%)%s\n"
+               , kv.first.c_str (), kv.second.ns, it->second.ns, ratio, 100 * tol, bad ? "  REGRESSED" : "") ;
+        regressed += bad ? 1 : 0 ;
+    }
+    for (auto const &kv : baseline) {
+        if (results.find (kv.first) == results.end ()) {
+            printf ("%-24s not run on this build\n", kv.first.c_str ()) ;
+        }
+    }
+    if (0 < regressed) {
+        printf ("%d benchmark(s) regressed\n", regressed) ;
+        return 1 ;
+    }
+    return 0 ;
+}
+/*
+ * [END OF FILE]
+ */
@@ -0,0 +1,78 @@
+/*
+ * test-adaptive.cpp:
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#include "common.h"
+#include "BLAKE2.hpp"
+#include "BLAKE2/Adaptive.hpp"
+#include "BLAKE2/Parallel.hpp"
+#include "BLAKE2/ThreadPool.hpp"
+
+using BLAKE2::AdaptiveHasher ;
+
+TEST_CASE ("Test AdaptiveHasher", "[adaptive]") {
+    using Mode = AdaptiveHasher::Mode ;
+
+    std::vector<uint8_t>    data (1024 * 1024) ;
+    for (size_t i = 0 ; i < data.size () ; ++i) {
+        data [i] = static_cast<uint8_t> (i * 13 + (i >> 11)) ;
+    }
+    SECTION ("Modes by the size and the concurrency") {
+        const AdaptiveHasher    eight { AdaptiveHasher::Profile { 8, 1.0, 20000.0 } } ;
+        REQUIRE (eight.Choose (100).mode == Mode::SEQUENTIAL) ;
+        REQUIRE (eight.Choose (4096).mode == Mode::SEQUENTIAL) ;
+
+        auto const  mib = eight.Choose (data.size ()) ;
+        REQUIRE (mib.mode == Mode::TREE) ;
+        REQUIRE (BLAKE2::Parameter { mib.param }.GetLeafLength () == AdaptiveHasher::MIN_LEAF_LENGTH) ;
+        REQUIRE (BLAKE2::Parameter { mib.param }.GetDepth () == 2) ;
+
+        auto const  huge = eight.Choose (100000000000uLL) ;
+        REQUIRE (huge.mode == Mode::TREE) ;
+        REQUIRE (BLAKE2::Parameter { huge.param }.GetLeafLength () == AdaptiveHasher::MAX_LEAF_LENGTH) ;
+
+        const AdaptiveHasher    four { AdaptiveHasher::Profile { 4, 1.0, 20000.0 } } ;
+        REQUIRE (four.Choose (data.size ()).mode == Mode::PARALLEL) ;
+
+        const AdaptiveHasher    one { AdaptiveHasher::Profile { 1, 1.0, 0.0 } } ;
+        REQUIRE (one.Choose (100000000000uLL).mode == Mode::SEQUENTIAL) ;
+    }
+    SECTION ("Results are verifiable") {
+        BLAKE2::ThreadPool  pool { 4 } ;
+        BLAKE2::Parameter   P ;
+        P.SetSalt ("adaptive", 8).SetDigestLength (48) ;
+        const std::string   key { "secret" } ;
+
+        const AdaptiveHasher::Profile   profiles [] = { { 1, 1.0, 0.0 }, { 4, 1.0, 20000.0 }, { 8, 1.0, 20000.0 } } ;
+        const Mode                      modes [] = { Mode::SEQUENTIAL, Mode::PARALLEL, Mode::TREE } ;
+        for (size_t i = 0 ; i < 3 ; ++i) {
+            const AdaptiveHasher    H { profiles [i], &pool } ;
+            auto const  R = H.Hash (P.GetParameterBlock (), key.data (), key.size (), data.data (), data.size ()) ;
+            REQUIRE (R.mode == modes [i]) ;
+            REQUIRE (BLAKE2::Parameter { R.param }.GetDigestLength () == 48) ;
+            REQUIRE (BLAKE2::Parameter { R.param }.GetKeyLength () == key.size ()) ;
+            REQUIRE (AdaptiveHasher::Verify (R, key.data (), key.size (), data.data (), data.size ())) ;
+            REQUIRE (! AdaptiveHasher::Verify (R, key.data (), key.size (), data.data (), data.size () - 1)) ;
+            REQUIRE (! AdaptiveHasher::Verify (R, nullptr, 0, data.data (), data.size ())) ;
+        }
+        const AdaptiveHasher    H { AdaptiveHasher::Profile { 4, 1.0, 20000.0 }, &pool } ;
+        auto const  R = H.Hash (data.data (), data.size ()) ;
+        REQUIRE (BLAKE2::Digest::IsEqual (R.digest, BLAKE2::ApplyParallel (nullptr, 0, data.data (), data.size ()))) ;
+        auto const  S = H.Hash (data.data (), 100) ;
+        REQUIRE (S.mode == Mode::SEQUENTIAL) ;
+        REQUIRE (BLAKE2::Digest::IsEqual (S.digest, BLAKE2::Apply (nullptr, 0, data.data (), 100))) ;
+    }
+    SECTION ("Measured profile") {
+        BLAKE2::ThreadPool  pool { 2 } ;
+        auto const  profile = AdaptiveHasher::Measure (pool, 20000) ;
+        REQUIRE (profile.concurrency == 2) ;
+        REQUIRE (0.0 < profile.bytes_per_ns) ;
+        REQUIRE (0.0 <= profile.dispatch_ns) ;
+
+        const AdaptiveHasher    H { &pool } ;
+        REQUIRE (H.Choose (100).mode == Mode::SEQUENTIAL) ;
+        auto const  R = H.Hash (data.data (), data.size ()) ;
+        REQUIRE (AdaptiveHasher::Verify (R, nullptr, 0, data.data (), data.size (), &pool)) ;
+    }
+}
@@ -0,0 +1,86 @@
+/*
+ * test-argon2.cpp:
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#include "common.h"
+#include <stdexcept>
+#include <string>
+#include "BLAKE2/Argon2.hpp"
+#include "BLAKE2/ThreadPool.hpp"
+
+namespace {
+    std::string     to_hex (const std::vector<uint8_t> &data) {
+        static const char   digits [] = "0123456789abcdef" ;
+        std::string result ;
+        for (auto v : data) {
+            result += digits [v >> 4] ;
+            result += digits [v & 0xF] ;
+        }
+        return result ;
+    }
+
+    /** Runs the RFC 9106 test vector parameters.  */
+    std::vector<uint8_t>    rfc9106 (BLAKE2::Argon2::Type type, BLAKE2::Executor *executor) {
+        std::vector<uint8_t>    password (32, 0x01) ;
+        std::vector<uint8_t>    salt (16, 0x02) ;
+        std::vector<uint8_t>    secret (8, 0x03) ;
+        std::vector<uint8_t>    ad (12, 0x04) ;
+
+        BLAKE2::Argon2  A { type } ;
+        A.SetIterations (3)
+         .SetMemoryCost (32)
+         .SetLanes (4)
+         .SetSecret (secret.data (), secret.size ())
+         .SetAssociatedData (ad.data (), ad.size ())
+         .SetExecutor (executor) ;
+        return A.Hash (password.data (), password.size (), salt.data (), salt.size (), 32) ;
+    }
+}
+
+TEST_CASE ("Test Argon2 (RFC 9106)", "[argon2]") {
+    BLAKE2::SequentialExecutor  sequential ;
+    BLAKE2::ThreadPool          pool { 3 } ;
+
+    SECTION ("Argon2d") {
+        const char *    expected = "512b391b6f1162975371d30919734294f868e3be3984f3c1a13a4db9fabe4acb" ;
+        REQUIRE (to_hex (rfc9106 (BLAKE2::Argon2::Type::D, &sequential)) == expected) ;
+        REQUIRE (to_hex (rfc9106 (BLAKE2::Argon2::Type::D, &pool)) == expected) ;
+    }
+    SECTION ("Argon2i") {
+        const char *    expected = "c814d9d1dc7f37aa13f0d77f2494bda1c8de6b016dd388d29952a4c4672b6ce8" ;
+        REQUIRE (to_hex (rfc9106 (BLAKE2::Argon2::Type::I, &sequential)) == expected) ;
+        REQUIRE (to_hex (rfc9106 (BLAKE2::Argon2::Type::I, &pool)) == expected) ;
+    }
+    SECTION ("Argon2id") {
+        const char *    expected = "0d640df58d78766c08c037a34a8b53c9d01ef0452d75b65eb52520e96b01e659" ;
+        REQUIRE (to_hex (rfc9106 (BLAKE2::Argon2::Type::ID, &sequential)) == expected) ;
+        REQUIRE (to_hex (rfc9106 (BLAKE2::Argon2::Type::ID, &pool)) == expected) ;
+    }
+}
+
+TEST_CASE ("Test Argon2 usage", "[argon2]") {
+    BLAKE2::Argon2  A ;
+    A.SetIterations (2).SetMemoryCost (4096).SetLanes (2) ;
+    const std::string   password { "correct horse battery staple" } ;
+    const std::string   salt { "NaCl-NaCl-NaCl" } ;
+
+    SECTION ("Verify") {
+        auto    tag = A.Hash (password.data (), password.size (), salt.data (), salt.size (), 100) ;
+        REQUIRE (tag.size () == 100) ;
+        // The arena is reused.
+        REQUIRE (A.Verify (password.data (), password.size (), salt.data (), salt.size (), tag.data (), tag.size ())) ;
+        tag [99] ^= 1 ;
+        REQUIRE_FALSE (A.Verify (password.data (), password.size (), salt.data (), salt.size (), tag.data (), tag.size ())) ;
+    }
+    SECTION ("Invalid parameters") {
+        REQUIRE_THROWS_AS (A.Hash (password.data (), password.size (), "short", 5), std::invalid_argument) ;
+        REQUIRE_THROWS_AS (A.Hash (password.data (), password.size (), salt.data (), salt.size (), 3), std::invalid_argument) ;
+        A.SetMemoryCost (8) ;
+        REQUIRE_THROWS_AS (A.Hash (password.data (), password.size (), salt.data (), salt.size ()), std::invalid_argument) ;
+    }
+}
+
+/*
+ * [END OF FILE]
+ */
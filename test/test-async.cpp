@@ -0,0 +1,91 @@
+/*
+ * test-async.cpp:
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#include "common.h"
+#include "BLAKE2.hpp"
+#include "BLAKE2/Async.hpp"
+
+#include <deque>
+#include <functional>
+#include <stdexcept>
+
+TEST_CASE ("Test AsyncGenerator", "[async]") {
+    std::vector<uint8_t>    src (300000) ;
+    for (size_t i = 0 ; i < src.size () ; ++i) {
+        src [i] = static_cast<uint8_t> ((i * 13) & 0xFF) ;
+    }
+    const char          key [] = "async-key" ;
+    BLAKE2::Parameter   param ;
+    BLAKE2::Digest      expected { BLAKE2::Apply (param, key, sizeof (key), src.data (), src.size ()) } ;
+
+    SECTION ("Stepping") {
+        BLAKE2::AsyncGenerator  gen { param, key, sizeof (key), 1000 } ;
+        gen.Enqueue (src.data (), 100).Enqueue (src.data () + 100, src.size () - 100) ;
+        REQUIRE (gen.GetPendingSize () == src.size ()) ;
+        size_t  steps = 1 ;
+        while (gen.Step ()) {
+            ++steps ;
+        }
+        REQUIRE (steps == (src.size () + 999) / 1000) ;
+        REQUIRE (gen.IsIdle ()) ;
+        bool    called = false ;
+        gen.Finalize ([](BLAKE2::AsyncGenerator::task_t &&task) { task () ; }, [&](const BLAKE2::Digest &D) {
+            called = true ;
+            REQUIRE (BLAKE2::Digest::IsEqual (D, expected)) ;
+        }) ;
+        REQUIRE (called) ;
+    }
+    SECTION ("Event loop") {
+        std::deque<BLAKE2::AsyncGenerator::task_t>  loop ;
+        auto    post = [&loop](BLAKE2::AsyncGenerator::task_t &&task) { loop.emplace_back (std::move (task)) ; } ;
+
+        BLAKE2::AsyncGenerator  gen { param, key, sizeof (key) } ;
+        bool            updated = false ;
+        bool            finalized = false ;
+        BLAKE2::Digest  actual ;
+
+        gen.Update (src.data (), src.size (), post, [&] {
+            updated = true ;
+            gen.Finalize (post, [&](const BLAKE2::Digest &D) {
+                actual = D ;
+                finalized = true ;
+            }) ;
+        }) ;
+        size_t  ticks = 0 ;
+        while (! loop.empty ()) {
+            auto    task = std::move (loop.front ()) ;
+            loop.pop_front () ;
+            task () ;
+            ++ticks ;
+        }
+        REQUIRE (updated) ;
+        REQUIRE (finalized) ;
+        REQUIRE ((src.size () + BLAKE2::DEFAULT_SLICE_SIZE - 1) / BLAKE2::DEFAULT_SLICE_SIZE < ticks) ;
+        REQUIRE (BLAKE2::Digest::IsEqual (actual, expected)) ;
+    }
+    SECTION ("One drive at a time") {
+        std::deque<BLAKE2::AsyncGenerator::task_t>  loop ;
+        auto    post = [&loop](BLAKE2::AsyncGenerator::task_t &&task) { loop.emplace_back (std::move (task)) ; } ;
+
+        BLAKE2::AsyncGenerator  gen { param, key, sizeof (key) } ;
+        bool    updated = false ;
+        gen.Update (src.data (), src.size (), post, [&] { updated = true ; }) ;
+        REQUIRE_THROWS_AS (gen.Update (src.data (), src.size (), post, [] {}), std::logic_error) ;
+        REQUIRE_THROWS_AS (gen.Finalize (post, [](const BLAKE2::Digest &) {}), std::logic_error) ;
+        while (! loop.empty ()) {
+            auto    task = std::move (loop.front ()) ;
+            loop.pop_front () ;
+            task () ;
+        }
+        REQUIRE (updated) ;
+        BLAKE2::Digest  actual ;
+        gen.Finalize ([](BLAKE2::AsyncGenerator::task_t &&task) { task () ; }, [&](const BLAKE2::Digest &D) { actual = D ; }) ;
+        REQUIRE (BLAKE2::Digest::IsEqual (actual, expected)) ;
+    }
+}
+
+/*
+ * [END OF FILE]
+ */
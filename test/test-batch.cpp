@@ -0,0 +1,130 @@
+/*
+ * test-batch.cpp:
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#include "common.h"
+#include "BLAKE2.hpp"
+#include "BLAKE2/Batch.hpp"
+#include "BLAKE2/Kernel.hpp"
+#include "BLAKE2/Telemetry.hpp"
+
+TEST_CASE ("Test ApplyBatch", "[batch]") {
+    std::vector<uint8_t>    src (2048) ;
+    for (size_t i = 0 ; i < src.size () ; ++i) {
+        src [i] = static_cast<uint8_t> ((i * 31 + 7) & 0xFF) ;
+    }
+    // Mixed lengths, including the empty message and block boundaries.
+    std::vector<size_t>         lengths { 0, 1, 127, 128, 129, 255, 256, 257, 1000, 2048, 64, 3, 128, 128, 128 } ;
+    std::vector<const void *>   data ;
+    for (size_t i = 0 ; i < lengths.size () ; ++i) {
+        data.emplace_back (&src [i]) ;
+        lengths [i] = std::min (lengths [i], src.size () - i) ;
+    }
+    std::vector<BLAKE2::Digest> actual (lengths.size ()) ;
+
+    SECTION ("Without key") {
+        BLAKE2::Parameter   P ;
+        P.SetDigestLength (20) ;
+        BLAKE2::ApplyBatch (P, nullptr, 0, lengths.size (), data.data (), lengths.data (), actual.data ()) ;
+        for (size_t i = 0 ; i < lengths.size () ; ++i) {
+            REQUIRE (BLAKE2::Digest::IsEqual (actual [i], BLAKE2::Apply (P, nullptr, 0, data [i], lengths [i]))) ;
+        }
+    }
+    SECTION ("With key") {
+        uint8_t key [64] ;
+        for (size_t i = 0 ; i < sizeof (key) ; ++i) {
+            key [i] = static_cast<uint8_t> (i) ;
+        }
+        BLAKE2::Parameter   P ;
+        BLAKE2::ApplyBatch (P, key, sizeof (key), lengths.size (), data.data (), lengths.data (), actual.data ()) ;
+        for (size_t i = 0 ; i < lengths.size () ; ++i) {
+            REQUIRE (BLAKE2::Digest::IsEqual (actual [i], BLAKE2::Apply (P, key, sizeof (key), data [i], lengths [i]))) ;
+        }
+    }
+    SECTION ("Parameter per message") {
+        std::vector<BLAKE2::parameter_block_t>  params ;
+        for (size_t i = 0 ; i < lengths.size () ; ++i) {
+            BLAKE2::Parameter   P ;
+            P.SetNodeOffset (i).SetDigestLength (static_cast<uint8_t> (1 + i)) ;
+            params.emplace_back (P.GetParameterBlock ()) ;
+        }
+        BLAKE2::ApplyBatch (params.data (), "k", 1, lengths.size (), data.data (), lengths.data (), actual.data ()) ;
+        for (size_t i = 0 ; i < lengths.size () ; ++i) {
+            REQUIRE (BLAKE2::Digest::IsEqual (actual [i], BLAKE2::Apply (params [i], "k", 1, data [i], lengths [i]))) ;
+        }
+    }
+}
+
+TEST_CASE ("Test ApplyBatch lanes", "[batch]") {
+    // The vector lanes are compiled and chosen like the AVX2 `Compress` kernel.
+    if (BLAKE2::Kernel::SelfTest ("avx2")) {
+        REQUIRE (std::string { BLAKE2::Telemetry::GetBatchKernelName () } == "avx2x4") ;
+    }
+    std::vector<uint8_t>    src (4096) ;
+    for (size_t i = 0 ; i < src.size () ; ++i) {
+        src [i] = static_cast<uint8_t> ((i * 131 + 17) ^ (i >> 5)) ;
+    }
+    // Full groups of equal lengths (every lane busy on every block), then lanes finishing one by one.
+    std::vector<size_t>         lengths { 1000, 1000, 1000, 1000, 128, 128, 128, 128, 1, 129, 257, 3000 } ;
+    std::vector<const void *>   data ;
+    for (size_t i = 0 ; i < lengths.size () ; ++i) {
+        data.emplace_back (&src [13 * i]) ;
+    }
+    std::vector<BLAKE2::Digest> actual (lengths.size ()) ;
+    for (size_t key_length : { 0, 1, 64 }) {
+        BLAKE2::Parameter   P ;
+        BLAKE2::ApplyBatch (P, src.data (), key_length, lengths.size (), data.data (), lengths.data (), actual.data ()) ;
+        for (size_t i = 0 ; i < lengths.size () ; ++i) {
+            REQUIRE (BLAKE2::Digest::IsEqual (actual [i], BLAKE2::Apply (P, src.data (), key_length, data [i], lengths [i]))) ;
+        }
+    }
+}
+
+TEST_CASE ("Test CopyAndApplyBatch", "[batch]") {
+    std::vector<uint8_t>    src (20000) ;
+    for (size_t i = 0 ; i < src.size () ; ++i) {
+        src [i] = static_cast<uint8_t> ((i * 31 + 7) & 0xFF) ;
+    }
+    // Lengths around the 4 KiB copy slices.
+    std::vector<size_t>         lengths { 0, 1, 128, 4095, 4096, 4097, 8192, 10000, 129, 19000 } ;
+    std::vector<const void *>   data ;
+    std::vector<std::vector<uint8_t>>   copies ;
+    std::vector<void *>         dst ;
+    for (size_t i = 0 ; i < lengths.size () ; ++i) {
+        data.emplace_back (&src [i]) ;
+        lengths [i] = std::min (lengths [i], src.size () - i) ;
+        copies.emplace_back (lengths [i] + 1, 0xAA) ;
+    }
+    for (auto &c : copies) {
+        dst.emplace_back (c.data ()) ;
+    }
+    std::vector<BLAKE2::Digest> actual (lengths.size ()) ;
+
+    SECTION ("Shared parameter") {
+        BLAKE2::Parameter   P ;
+        BLAKE2::CopyAndApplyBatch (P, "key", 3, lengths.size (), dst.data (), data.data (), lengths.data (), actual.data ()) ;
+        for (size_t i = 0 ; i < lengths.size () ; ++i) {
+            REQUIRE (memcmp (copies [i].data (), data [i], lengths [i]) == 0) ;
+            REQUIRE (copies [i][lengths [i]] == 0xAA) ;
+            REQUIRE (BLAKE2::Digest::IsEqual (actual [i], BLAKE2::Apply (P, "key", 3, data [i], lengths [i]))) ;
+        }
+    }
+    SECTION ("Parameter per message") {
+        std::vector<BLAKE2::parameter_block_t>  params ;
+        for (size_t i = 0 ; i < lengths.size () ; ++i) {
+            BLAKE2::Parameter   P ;
+            P.SetNodeOffset (i) ;
+            params.emplace_back (P.GetParameterBlock ()) ;
+        }
+        BLAKE2::CopyAndApplyBatch (params.data (), nullptr, 0, lengths.size (), dst.data (), data.data (), lengths.data (), actual.data ()) ;
+        for (size_t i = 0 ; i < lengths.size () ; ++i) {
+            REQUIRE (memcmp (copies [i].data (), data [i], lengths [i]) == 0) ;
+            REQUIRE (BLAKE2::Digest::IsEqual (actual [i], BLAKE2::Apply (params [i], nullptr, 0, data [i], lengths [i]))) ;
+        }
+    }
+}
+
+/*
+ * [END OF FILE]
+ */
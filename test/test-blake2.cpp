@@ -177,6 +177,67 @@ TEST_CASE ("Test BLAKE2", "[blake2]") {
     }
 }
 
+TEST_CASE ("Test CopyAndUpdate", "[blake2]") {
+    uint8_t     key [64] ;
+    for (size_t i = 0 ; i < sizeof (key) ; ++i) {
+        key [i] = static_cast<uint8_t> (i & 0xFF) ;
+    }
+    BLAKE2::Parameter   param ;
+    // Small, chunk crossing and non-temporal (with misaligned destinations) copies.
+    for (size_t size : { 0, 1, 127, 128, 129, 4095, 4097, 300000, 1000003 }) {
+        std::vector<uint8_t>    src (size + 7) ;
+        for (size_t i = 0 ; i < src.size () ; ++i) {
+            src [i] = static_cast<uint8_t> ((i * 7 + (i >> 8)) & 0xFF) ;
+        }
+        BLAKE2::Digest  expected { BLAKE2::Apply (param, key, sizeof (key), &src [3], size) } ;
+        for (size_t align : { 0, 5 }) {
+            std::vector<uint8_t>    dst (size + 16, 0xAA) ;
+            BLAKE2::Generator   gen { param, key, sizeof (key) } ;
+            const size_t    half = size / 3 ;
+            gen.CopyAndUpdate (&dst [align], &src [3], half).CopyAndUpdate (&dst [align + half], &src [3 + half], size - half) ;
+            REQUIRE (BLAKE2::Digest::IsEqual (gen.Finalize (), expected)) ;
+            REQUIRE (memcmp (&dst [align], &src [3], size) == 0) ;
+            REQUIRE (dst [align + size] == 0xAA) ;
+
+            std::fill (dst.begin (), dst.end (), 0) ;
+            REQUIRE (BLAKE2::Digest::IsEqual (BLAKE2::CopyAndApply (param, key, sizeof (key), &dst [align], &src [3], size), expected)) ;
+            REQUIRE (memcmp (&dst [align], &src [3], size) == 0) ;
+        }
+    }
+}
+
+#ifdef BLAKE2_HAVE_IOVEC
+TEST_CASE ("Test scatter-gather Update", "[blake2]") {
+    uint8_t     key [64] ;
+    for (size_t i = 0 ; i < sizeof (key) ; ++i) {
+        key [i] = static_cast<uint8_t> (i & 0xFF) ;
+    }
+    std::vector<uint8_t>    data (5000) ;
+    for (size_t i = 0 ; i < data.size () ; ++i) {
+        data [i] = static_cast<uint8_t> ((i * 13 + (i >> 7)) & 0xFF) ;
+    }
+    BLAKE2::Parameter   param ;
+    // Fragments straddling, ending at and spanning block boundaries (and empty ones).
+    for (const std::vector<size_t> &lengths : std::vector<std::vector<size_t>> {
+            {}, { 0 }, { 1 }, { 128 }, { 129 }, { 127, 1 }, { 128, 0, 128 }, { 1, 255, 0, 3 }
+          , { 64, 64, 64, 64 }, { 100, 1000, 1, 2, 3, 500 }, { 5000 }, { 1, 4999 } }) {
+        std::vector<struct iovec>   iov ;
+        size_t  total = 0 ;
+        for (size_t len : lengths) {
+            iov.push_back ({ &data [total], len }) ;
+            total += len ;
+        }
+        for (bool keyed : { false, true }) {
+            const size_t    klen = keyed ? sizeof (key) : 0 ;
+            BLAKE2::Digest  expected { BLAKE2::Apply (param, key, klen, data.data (), total) } ;
+            BLAKE2::Generator   gen { param, key, klen } ;
+            REQUIRE (BLAKE2::Digest::IsEqual (gen.Update (iov.data (), iov.size ()).Finalize (), expected)) ;
+            REQUIRE (BLAKE2::Digest::IsEqual (BLAKE2::Apply (param, key, klen, iov.data (), iov.size ()), expected)) ;
+        }
+    }
+}
+#endif
+
 TEST_CASE ("Test BLAKE2 property", "[PBT]") {
     rc::prop ("Incremental update should match to batch update", [] {
         auto const key = *rc::gen::arbitrary<std::vector<uint8_t>> () ;
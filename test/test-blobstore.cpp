@@ -0,0 +1,189 @@
+/*
+ * test-blobstore.cpp:
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#include "common.h"
+#include "BLAKE2.hpp"
+#include "BLAKE2/BlobStore.hpp"
+
+#include <cstdlib>
+#include <fcntl.h>
+#include <ftw.h>
+#include <unistd.h>
+
+namespace {
+    class TemporaryDirectory {
+    private:
+        std::string path_ ;
+    public:
+        TemporaryDirectory () {
+            char    tmpl [] = "/tmp/blake2-store-XXXXXX" ;
+            REQUIRE (mkdtemp (tmpl) != nullptr) ;
+            path_ = tmpl ;
+        }
+
+        ~TemporaryDirectory () {
+            nftw (path_.c_str (), [](const char *path, const struct stat *, int, struct FTW *) {
+                return ::remove (path) ;
+            }, 16, FTW_DEPTH | FTW_PHYS) ;
+        }
+
+        const std::string & GetPath () const {
+            return path_ ;
+        }
+    } ;
+
+    std::vector<uint8_t>    make_blob (size_t i) {
+        std::vector<uint8_t>    result (i % 3000) ;
+        for (size_t j = 0 ; j < result.size () ; ++j) {
+            result [j] = static_cast<uint8_t> ((i * 131 + j) & 0xFF) ;
+        }
+        result.push_back (static_cast<uint8_t> (i)) ;
+        result.push_back (static_cast<uint8_t> (i >> 8)) ;
+        return result ;
+    }
+
+    uint64_t    read_u64 (const std::string &path, off_t offset) {
+        uint8_t     buf [8] ;
+        int         fd = open (path.c_str (), O_RDONLY) ;
+        REQUIRE (0 <= fd) ;
+        REQUIRE (pread (fd, buf, sizeof (buf), offset) == sizeof (buf)) ;
+        close (fd) ;
+        uint64_t    result = 0 ;
+        for (int i = 7 ; 0 <= i ; --i) {
+            result = (result << 8) | buf [i] ;
+        }
+        return result ;
+    }
+
+    void    write_u64 (const std::string &path, off_t offset, uint64_t v) {
+        uint8_t     buf [8] ;
+        for (auto &b : buf) {
+            b = static_cast<uint8_t> (v) ;
+            v >>= 8 ;
+        }
+        int     fd = open (path.c_str (), O_RDWR) ;
+        REQUIRE (0 <= fd) ;
+        REQUIRE (pwrite (fd, buf, sizeof (buf), offset) == sizeof (buf)) ;
+        close (fd) ;
+    }
+}
+
+TEST_CASE ("Test BlobStore", "[store]") {
+    TemporaryDirectory  tmpdir ;
+    auto const &    root = tmpdir.GetPath () ;
+    const size_t    N = 3000 ;      // Forces index growth.
+    std::vector<BLAKE2::Digest> digests ;
+    {
+        BLAKE2::BlobStore   store { root, 4, 64 * 1024 } ;
+        for (size_t i = 0 ; i < N ; ++i) {
+            auto    blob = make_blob (i) ;
+            bool    inserted = false ;
+            digests.emplace_back (store.Put (blob.data (), blob.size (), &inserted)) ;
+            REQUIRE (inserted) ;
+            REQUIRE (BLAKE2::Digest::IsEqual (digests.back (), BLAKE2::Apply (nullptr, 0, blob.data (), blob.size ()))) ;
+        }
+        // Duplicates are not stored twice.
+        auto    blob = make_blob (7) ;
+        bool    inserted = true ;
+        store.Put (blob.data (), blob.size (), &inserted) ;
+        REQUIRE (! inserted) ;
+        REQUIRE (store.GetCount () == N) ;
+        store.Sync () ;
+    }
+    BLAKE2::BlobStore   store { root } ;
+    REQUIRE (store.GetCount () == N) ;
+
+    SECTION ("Blobs survive reopening") {
+        std::vector<uint8_t>    data ;
+        for (size_t i = 0 ; i < N ; i += 7) {
+            REQUIRE (store.Contains (digests [i])) ;
+            REQUIRE (store.Get (digests [i], data)) ;
+            REQUIRE (data == make_blob (i)) ;
+        }
+        auto    other = make_blob (N + 1) ;
+        BLAKE2::Digest  missing { BLAKE2::Apply (nullptr, 0, other.data (), other.size ()) } ;
+        REQUIRE (! store.Contains (missing)) ;
+        REQUIRE (! store.Get (missing, data)) ;
+    }
+    SECTION ("Corruption is detected") {
+        // Flip the last byte of the first pack of every shard.
+        for (const char *shard : { "/00", "/01", "/02", "/03" }) {
+            auto    path = root + shard + "/pack-000000" ;
+            int     fd = open (path.c_str (), O_RDWR) ;
+            REQUIRE (0 <= fd) ;
+            off_t   size = lseek (fd, 0, SEEK_END) ;
+            uint8_t v ;
+            REQUIRE (pread (fd, &v, 1, size - 1) == 1) ;
+            v ^= 0xFF ;
+            REQUIRE (pwrite (fd, &v, 1, size - 1) == 1) ;
+            close (fd) ;
+        }
+        size_t  corrupted = 0 ;
+        std::vector<uint8_t>    data ;
+        for (auto const &D : digests) {
+            try {
+                store.Get (D, data) ;
+            }
+            catch (const BLAKE2::BlobStore::CorruptionError &) {
+                ++corrupted ;
+            }
+        }
+        REQUIRE (corrupted == 4) ;
+    }
+}
+
+TEST_CASE ("Test BlobStore index", "[store]") {
+    TemporaryDirectory  tmpdir ;
+    auto const &    root = tmpdir.GetPath () ;
+    const size_t    SHARDS = 16 ;
+    const size_t    N = SHARDS * 400 ;      // Well below the growth of 1024 slots.
+    {
+        BLAKE2::BlobStore   store { root, SHARDS, 64 * 1024 } ;
+        for (size_t i = 0 ; i < N ; ++i) {
+            uint8_t     blob [8] ;
+            for (size_t j = 0 ; j < sizeof (blob) ; ++j) {
+                blob [j] = static_cast<uint8_t> (i >> (8 * j)) ;
+            }
+            store.Put (blob, sizeof (blob)) ;
+        }
+        store.Sync () ;
+    }
+    const std::string   index = root + "/00/index" ;    // 64 bytes header, 64 bytes slots.
+    const uint64_t      slots = read_u64 (index, 8) ;
+
+    SECTION ("Home slots spread within a shard") {
+        // Digests of a shard share the residue of byte 0, their home slots must not.
+        std::vector<size_t> occupied (SHARDS) ;
+        size_t  used = 0 ;
+        for (uint64_t i = 0 ; i < slots ; ++i) {
+            if ((read_u64 (index, static_cast<off_t> (64 + 64 * i + 48)) >> 32) != 0) {
+                ++occupied [i % SHARDS] ;
+                ++used ;
+            }
+        }
+        REQUIRE (0 < used) ;
+        for (auto cnt : occupied) {
+            REQUIRE (used / (4 * SHARDS) <= cnt) ;
+        }
+    }
+    SECTION ("Bad slot count is rejected") {
+        write_u64 (index, 8, slots - 1) ;
+        REQUIRE_THROWS_AS ((BLAKE2::BlobStore { root }), BLAKE2::BlobStore::CorruptionError) ;
+        write_u64 (index, 8, 2 * slots) ;
+        REQUIRE_THROWS_AS ((BLAKE2::BlobStore { root }), BLAKE2::BlobStore::CorruptionError) ;
+    }
+    SECTION ("Truncated index is rejected") {
+        REQUIRE (truncate (index.c_str (), static_cast<off_t> (64 + 64 * (slots / 2))) == 0) ;
+        REQUIRE_THROWS_AS ((BLAKE2::BlobStore { root }), BLAKE2::BlobStore::CorruptionError) ;
+    }
+    SECTION ("Bad shard count is rejected") {
+        write_u64 (root + "/STORE", 8, 0) ;
+        REQUIRE_THROWS_AS ((BLAKE2::BlobStore { root }), BLAKE2::BlobStore::CorruptionError) ;
+    }
+}
+
+/*
+ * [END OF FILE]
+ */
@@ -0,0 +1,84 @@
+/*
+ * test-chunker.cpp:
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#include "common.h"
+#include "BLAKE2.hpp"
+#include "BLAKE2/Chunker.hpp"
+
+#include <random>
+
+namespace {
+    std::vector<BLAKE2::Chunker::Chunk>   chunk_all ( const BLAKE2::Parameter &P
+                                                    , const std::vector<uint8_t> &src
+                                                    , size_t piece) {
+        std::vector<BLAKE2::Chunker::Chunk>   result ;
+        BLAKE2::Chunker c { P, [&result](const BLAKE2::Chunker::Chunk &chunk) { result.push_back (chunk) ; }
+                          , 1024, 4096, 16384 } ;
+        for (size_t off = 0 ; off < src.size () ; off += piece) {
+            c.Update (&src [off], std::min (piece, src.size () - off)) ;
+        }
+        c.Finish () ;
+        return result ;
+    }
+}
+
+TEST_CASE ("Test Chunker", "[chunker]") {
+    std::vector<uint8_t>    src (1000000) ;
+    std::mt19937            rng { 1 } ;
+    for (auto &v : src) {
+        v = static_cast<uint8_t> (rng ()) ;
+    }
+    BLAKE2::Parameter   P ;
+    P.SetDigestLength (16) ;
+
+    auto const  chunks = chunk_all (P, src, src.size ()) ;
+
+    SECTION ("Chunks cover the input and carry their fingerprints") {
+        uint64_t    off = 0 ;
+        for (size_t i = 0 ; i < chunks.size () ; ++i) {
+            auto const &    C = chunks [i] ;
+            REQUIRE (C.offset == off) ;
+            REQUIRE (C.length <= 16384) ;
+            if (i + 1 < chunks.size ()) {
+                REQUIRE (1024 <= C.length) ;
+            }
+            REQUIRE (BLAKE2::Digest::IsEqual (C.digest, BLAKE2::Apply (P, nullptr, 0, &src [C.offset], C.length))) ;
+            off += C.length ;
+        }
+        REQUIRE (off == src.size ()) ;
+        // Roughly the average size.
+        REQUIRE (src.size () / 8192 < chunks.size ()) ;
+        REQUIRE (chunks.size () < src.size () / 2048) ;
+    }
+    SECTION ("Boundaries do not depend on the buffering") {
+        for (size_t piece : { 1000, 4096, 77777 }) {
+            auto const  actual = chunk_all (P, src, piece) ;
+            REQUIRE (actual.size () == chunks.size ()) ;
+            for (size_t i = 0 ; i < chunks.size () ; ++i) {
+                REQUIRE (actual [i].offset == chunks [i].offset) ;
+                REQUIRE (BLAKE2::Digest::IsEqual (actual [i].digest, chunks [i].digest)) ;
+            }
+        }
+    }
+    SECTION ("Inserting a byte only affects nearby chunks") {
+        auto    modified = src ;
+        modified.insert (modified.begin () + 100, 0x55) ;
+        auto const  actual = chunk_all (P, modified, modified.size ()) ;
+        size_t  common = 0 ;
+        for (auto const &a : actual) {
+            for (auto const &c : chunks) {
+                if (BLAKE2::Digest::IsEqual (a.digest, c.digest)) {
+                    ++common ;
+                    break ;
+                }
+            }
+        }
+        REQUIRE (chunks.size () - 3 <= common) ;
+    }
+}
+
+/*
+ * [END OF FILE]
+ */
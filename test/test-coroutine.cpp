@@ -0,0 +1,93 @@
+/*
+ * test-coroutine.cpp: Awaiters of AsyncGenerator (built as C++20).
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#include <deque>
+#include <exception>
+#include <vector>
+#include <catch.hpp>
+#include "BLAKE2.hpp"
+#include "BLAKE2/Async.hpp"
+
+#ifdef BLAKE2_HAVE_COROUTINE
+
+namespace {
+    /** Starts eagerly, nothing to return.  */
+    struct Task {
+        struct promise_type {
+            Task    get_return_object () {
+                return {} ;
+            }
+
+            std::suspend_never  initial_suspend () noexcept {
+                return {} ;
+            }
+
+            std::suspend_never  final_suspend () noexcept {
+                return {} ;
+            }
+
+            void    return_void () {
+                /* NO-OP */
+            }
+
+            void    unhandled_exception () {
+                std::terminate () ;
+            }
+        } ;
+    } ;
+
+    Task    hash_async ( BLAKE2::AsyncGenerator &gen, const std::vector<uint8_t> &src
+                       , BLAKE2::AsyncGenerator::scheduler_t scheduler
+                       , BLAKE2::Digest &result, bool &done) {
+        co_await gen.UpdateAsync (src.data (), 100, scheduler) ;
+        co_await gen.UpdateAsync (nullptr, 0, scheduler) ;     // Ready without suspending.
+        co_await gen.UpdateAsync (src.data () + 100, src.size () - 100, scheduler) ;
+        result = co_await gen.FinalizeAsync (scheduler) ;
+        done = true ;
+    }
+}
+
+TEST_CASE ("Test AsyncGenerator awaiters", "[async]") {
+    std::vector<uint8_t>    src (300000) ;
+    for (size_t i = 0 ; i < src.size () ; ++i) {
+        src [i] = static_cast<uint8_t> ((i * 13) & 0xFF) ;
+    }
+    BLAKE2::Parameter   param ;
+    BLAKE2::Digest      expected { BLAKE2::Apply (param, nullptr, 0, src.data (), src.size ()) } ;
+
+    SECTION ("Event loop") {
+        std::deque<BLAKE2::AsyncGenerator::task_t>  loop ;
+        auto    post = [&loop](BLAKE2::AsyncGenerator::task_t &&task) { loop.emplace_back (std::move (task)) ; } ;
+
+        BLAKE2::AsyncGenerator  gen { param, 1000 } ;
+        BLAKE2::Digest  actual ;
+        bool            done = false ;
+        hash_async (gen, src, post, actual, done) ;
+        REQUIRE (! done) ;      // Suspended on the first slice.
+        size_t  ticks = 0 ;
+        while (! loop.empty ()) {
+            auto    task = std::move (loop.front ()) ;
+            loop.pop_front () ;
+            task () ;
+            ++ticks ;
+        }
+        REQUIRE (done) ;
+        REQUIRE ((src.size () + 999) / 1000 < ticks) ;
+        REQUIRE (BLAKE2::Digest::IsEqual (actual, expected)) ;
+    }
+    SECTION ("Inline scheduler") {
+        BLAKE2::AsyncGenerator  gen { param } ;
+        BLAKE2::Digest  actual ;
+        bool            done = false ;
+        hash_async (gen, src, [](BLAKE2::AsyncGenerator::task_t &&task) { task () ; }, actual, done) ;
+        REQUIRE (done) ;
+        REQUIRE (BLAKE2::Digest::IsEqual (actual, expected)) ;
+    }
+}
+
+#endif  /* BLAKE2_HAVE_COROUTINE */
+/*
+ * [END OF FILE]
+ */
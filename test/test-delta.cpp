@@ -0,0 +1,133 @@
+/*
+ * test-delta.cpp:
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#include "common.h"
+#include <vector>
+#include "BLAKE2.hpp"
+#include "BLAKE2/Delta.hpp"
+#include "BLAKE2/ThreadPool.hpp"
+
+namespace {
+    std::vector<uint8_t>    make_data (size_t size, uint32_t seed) {
+        std::vector<uint8_t>    result (size) ;
+        uint32_t    x = seed ;
+        for (auto &v : result) {
+            x = x * 1103515245u + 12345u ;
+            v = static_cast<uint8_t> (x >> 16) ;
+        }
+        return result ;
+    }
+
+    uint64_t    copied_bytes (const BLAKE2::DeltaSync::Patch &patch) {
+        uint64_t    result = 0 ;
+        for (auto const &op : patch.ops) {
+            if (op.kind == BLAKE2::DeltaSync::Op::Kind::COPY) {
+                result += op.length ;
+            }
+        }
+        return result ;
+    }
+}
+
+TEST_CASE ("Test DeltaSync", "[delta]") {
+    using BLAKE2::DeltaSync ;
+    const uint32_t  B = 512 ;
+    auto basis = make_data (100 * B + 77, 1) ;
+
+    SECTION ("Weak checksum") {
+        // Rolling over the data agrees with the direct computation.
+        REQUIRE (DeltaSync::WeakChecksum (basis.data (), 0) == 0) ;
+        auto sig = DeltaSync::MakeSignature (basis.data (), basis.size (), B) ;
+        REQUIRE (sig.weak.size () == 101) ;
+        REQUIRE (sig.weak [3] == DeltaSync::WeakChecksum (basis.data () + 3 * B, B)) ;
+        REQUIRE (sig.weak [100] == DeltaSync::WeakChecksum (basis.data () + 100 * B, 77)) ;
+    }
+    SECTION ("Signature") {
+        BLAKE2::Parameter   P ;
+        P.SetSalt ("sync", 4) ;
+        BLAKE2::ThreadPool  pool { 4 } ;
+        auto big = make_data (5000 * 64 + 3, 2) ;
+        auto sig = DeltaSync::MakeSignature (P.GetParameterBlock (), big.data (), big.size (), 64, 12, &pool) ;
+        auto seq = DeltaSync::MakeSignature (P.GetParameterBlock (), big.data (), big.size (), 64, 12) ;
+        REQUIRE (sig.strong == seq.strong) ;
+        REQUIRE (sig.weak == seq.weak) ;
+        P.SetDigestLength (12) ;
+        for (size_t i : { size_t (0), size_t (1234), size_t (5000) }) {
+            auto expected = BLAKE2::Apply (P, nullptr, 0, big.data () + 64 * i, std::min<size_t> (64, big.size () - 64 * i)) ;
+            REQUIRE (std::equal (expected.begin (), expected.begin () + 12, sig.strong.begin () + 12 * i)) ;
+        }
+        REQUIRE_THROWS_AS (DeltaSync::MakeSignature (big.data (), big.size (), 0), std::invalid_argument) ;
+        REQUIRE_THROWS_AS (DeltaSync::MakeSignature (big.data (), big.size (), 64, 3), std::invalid_argument) ;
+        REQUIRE_THROWS_AS (DeltaSync::MakeSignature (big.data (), big.size (), 64, 65), std::invalid_argument) ;
+    }
+    SECTION ("Patch") {
+        auto sig = DeltaSync::MakeSignature (basis.data (), basis.size (), B) ;
+
+        // Identical.
+        auto patch = DeltaSync::MakePatch (sig, basis.data (), basis.size ()) ;
+        REQUIRE (patch.ops.size () == 1) ;
+        REQUIRE (patch.literals.empty ()) ;
+        REQUIRE (DeltaSync::ApplyPatch (basis.data (), basis.size (), patch) == basis) ;
+
+        // Insertion, deletion and modification.
+        auto target = basis ;
+        auto noise = make_data (333, 3) ;
+        target.insert (target.begin () + 10 * B + 5, noise.begin (), noise.end ()) ;
+        target.erase (target.begin () + 40 * B, target.begin () + 43 * B + 100) ;
+        target [70 * B] ^= 0xFF ;
+        patch = DeltaSync::MakePatch (sig, target.data (), target.size ()) ;
+        REQUIRE (DeltaSync::ApplyPatch (basis.data (), basis.size (), patch) == target) ;
+        REQUIRE (target.size () - 6 * B < copied_bytes (patch)) ;
+        REQUIRE (patch.literals.size () < 6 * B) ;
+
+        // Unrelated target and the empty ones.
+        auto other = make_data (3 * B + 1, 4) ;
+        patch = DeltaSync::MakePatch (sig, other.data (), other.size ()) ;
+        REQUIRE (copied_bytes (patch) == 0) ;
+        REQUIRE (DeltaSync::ApplyPatch (basis.data (), basis.size (), patch) == other) ;
+        patch = DeltaSync::MakePatch (sig, nullptr, 0) ;
+        REQUIRE (DeltaSync::ApplyPatch (basis.data (), basis.size (), patch).empty ()) ;
+        auto empty_sig = DeltaSync::MakeSignature (nullptr, 0, B) ;
+        patch = DeltaSync::MakePatch (empty_sig, target.data (), target.size ()) ;
+        REQUIRE (DeltaSync::ApplyPatch (nullptr, 0, patch) == target) ;
+    }
+    SECTION ("Errors") {
+        auto sig = DeltaSync::MakeSignature (basis.data (), basis.size (), B) ;
+        auto target = basis ;
+        target [5] ^= 1 ;
+        auto patch = DeltaSync::MakePatch (sig, target.data (), target.size ()) ;
+        auto changed = basis ;
+        changed [B * 50] ^= 1 ;
+        REQUIRE_THROWS_AS (DeltaSync::ApplyPatch (changed.data (), changed.size (), patch), DeltaSync::MismatchError) ;
+        REQUIRE_THROWS_AS (DeltaSync::ApplyPatch (basis.data (), basis.size () / 2, patch), std::invalid_argument) ;
+    }
+    SECTION ("Malformed signatures") {
+        const auto  sig = DeltaSync::MakeSignature (basis.data (), basis.size (), B) ;
+        auto    check = [&basis](const DeltaSync::Signature &S) {
+            REQUIRE_THROWS_AS (DeltaSync::MakePatch (S, basis.data (), basis.size ()), std::invalid_argument) ;
+        } ;
+        auto    S = sig ;
+        S.block_size = 0 ;
+        check (S) ;
+        S = sig ;
+        S.block_size = B / 2 ;              // Twice the blocks.
+        check (S) ;
+        S = sig ;
+        S.basis_length += B ;
+        check (S) ;
+        S = sig ;
+        S.weak.pop_back () ;
+        check (S) ;
+        S = sig ;
+        S.strong.resize (S.strong.size () - 1) ;
+        check (S) ;
+        S = sig ;
+        S.strong_length = 3 ;
+        check (S) ;
+        S = sig ;
+        BLAKE2::Parameter { S.param }.SetDigestLength (32).CopyTo (S.param) ;
+        check (S) ;
+    }
+}
@@ -0,0 +1,92 @@
+/*
+ * test-digestset.cpp:
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#include "common.h"
+#include <cstdio>
+#include <fstream>
+#include "BLAKE2.hpp"
+#include "BLAKE2/DigestSet.hpp"
+
+namespace {
+    std::vector<BLAKE2::Digest>     make_digests (uint32_t first, size_t count) {
+        std::vector<BLAKE2::Digest> result ;
+        for (size_t i = 0 ; i < count ; ++i) {
+            uint32_t    v = first + static_cast<uint32_t> (i) ;
+            result.emplace_back (BLAKE2::Apply (nullptr, 0, &v, sizeof (v))) ;
+        }
+        return result ;
+    }
+}
+
+TEST_CASE ("Test DigestSet", "[digestset]") {
+    SECTION ("Membership") {
+        for (size_t n : { 0, 1, 5, 100, 20000 }) {
+            auto    members = make_digests (0, n) ;
+            auto    others = make_digests (1000000, 1000) ;
+            BLAKE2::DigestSet   S { members.data (), members.size () } ;
+            REQUIRE (S.GetCount () == n) ;
+            for (const auto &d : members) {
+                REQUIRE (S.Contains (d)) ;
+            }
+            for (const auto &d : others) {
+                REQUIRE_FALSE (S.Contains (d)) ;
+            }
+        }
+    }
+    SECTION ("Duplicates") {
+        auto    members = make_digests (0, 50) ;
+        auto    copy = members ;
+        members.insert (members.end (), copy.begin (), copy.end ()) ;
+        BLAKE2::DigestSet   S { members.data (), members.size () } ;
+        REQUIRE (S.GetCount () == 50) ;
+    }
+    SECTION ("Bulk query") {
+        auto    members = make_digests (0, 3000) ;
+        auto    queries = make_digests (2000, 2000) ;
+        BLAKE2::DigestSet   S { members.data (), members.size () } ;
+        std::unique_ptr<bool []>    result { new bool [queries.size ()] } ;
+        S.Contains (queries.data (), queries.size (), result.get ()) ;
+        for (size_t i = 0 ; i < queries.size () ; ++i) {
+            REQUIRE (result [i] == (i < 1000)) ;
+        }
+    }
+    SECTION ("Save and open") {
+        const std::string   path { "test-digestset.tmp" } ;
+        auto    members = make_digests (0, 777) ;
+        {
+            BLAKE2::DigestSet   S { members.data (), members.size () } ;
+            S.Save (path) ;
+        }
+        {
+            auto    S = BLAKE2::DigestSet::Open (path) ;
+            REQUIRE (S.GetCount () == members.size ()) ;
+            for (const auto &d : members) {
+                REQUIRE (S.Contains (d)) ;
+            }
+            REQUIRE_FALSE (S.Contains (make_digests (5000, 1) [0])) ;
+        }
+        {
+            std::ofstream   out { path, std::ios::binary | std::ios::trunc } ;
+            out << "This is not a digest set, but long enough to hold the header........" ;
+        }
+        REQUIRE_THROWS_AS (BLAKE2::DigestSet::Open (path), BLAKE2::DigestSet::FormatError) ;
+        {
+            BLAKE2::DigestSet   S { members.data (), members.size () } ;
+            S.Save (path) ;
+        }
+        {
+            // Bucket 1 offset (the table follows the 64 bytes header) past the key count.
+            std::fstream    io { path, std::ios::binary | std::ios::in | std::ios::out } ;
+            io.seekp (64 + 8) ;
+            io.write ("\xFF\xFF\xFF\xFF\xFF\xFF\xFF\x00", 8) ;
+        }
+        REQUIRE_THROWS_AS (BLAKE2::DigestSet::Open (path), BLAKE2::DigestSet::FormatError) ;
+        std::remove (path.c_str ()) ;
+    }
+}
+
+/*
+ * [END OF FILE]
+ */
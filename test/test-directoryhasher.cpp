@@ -0,0 +1,146 @@
+/*
+ * test-directoryhasher.cpp:
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#include "common.h"
+#include "BLAKE2.hpp"
+#include "BLAKE2/DirectoryHasher.hpp"
+
+#include <cstdlib>
+#include <fcntl.h>
+#include <ftw.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+    class TemporaryDirectory {
+    private:
+        std::string path_ ;
+    public:
+        TemporaryDirectory () {
+            char    tmpl [] = "/tmp/blake2-tree-XXXXXX" ;
+            REQUIRE (mkdtemp (tmpl) != nullptr) ;
+            path_ = tmpl ;
+        }
+
+        ~TemporaryDirectory () {
+            nftw (path_.c_str (), [](const char *path, const struct stat *, int, struct FTW *) {
+                return ::remove (path) ;
+            }, 16, FTW_DEPTH | FTW_PHYS) ;
+        }
+
+        const std::string & GetPath () const {
+            return path_ ;
+        }
+    } ;
+
+    /** Writes CONTENT to PATH, the mtime is set AGE seconds in the past (0: left as is).  */
+    void    write_file (const std::string &path, const std::string &content, int age = 60) {
+        int     fd = open (path.c_str (), O_WRONLY | O_CREAT | O_TRUNC, 0644) ;
+        REQUIRE (0 <= fd) ;
+        REQUIRE (write (fd, content.data (), content.size ()) == static_cast<ssize_t> (content.size ())) ;
+        if (0 < age) {
+            struct timespec times [2] ;
+            times [0].tv_sec = times [1].tv_sec = time (nullptr) - age ;
+            times [0].tv_nsec = times [1].tv_nsec = 0 ;
+            REQUIRE (futimens (fd, times) == 0) ;
+        }
+        close (fd) ;
+    }
+}
+
+TEST_CASE ("Test DirectoryHasher", "[directory]") {
+    TemporaryDirectory  tmpdir ;
+    const std::string   tree = tmpdir.GetPath () + "/tree" ;
+    const std::string   cache = tmpdir.GetPath () + "/cache" ;
+    REQUIRE (mkdir (tree.c_str (), 0755) == 0) ;
+    REQUIRE (mkdir ((tree + "/sub").c_str (), 0755) == 0) ;
+    REQUIRE (mkdir ((tree + "/sub/deep").c_str (), 0755) == 0) ;
+    REQUIRE (mkdir ((tree + "/empty").c_str (), 0755) == 0) ;
+    write_file (tree + "/a.txt", "alpha") ;
+    write_file (tree + "/sub/b.bin", std::string (300000, 'b')) ;
+    write_file (tree + "/sub/deep/c", "gamma") ;
+    REQUIRE (symlink ("a.txt", (tree + "/link").c_str ()) == 0) ;
+
+    BLAKE2::Digest  expected ;
+    {
+        BLAKE2::DirectoryHasher hasher { cache } ;
+        expected = hasher.Hash (tree) ;
+        auto const &    stats = hasher.GetStatistics () ;
+        REQUIRE (stats.directories == 4) ;
+        REQUIRE (stats.files == 3) ;
+        REQUIRE (stats.hashed_files == 3) ;
+        REQUIRE (stats.hashed_bytes == 300010) ;
+        REQUIRE (hasher.GetCacheSize () == 3) ;
+        hasher.Save () ;
+    }
+    BLAKE2::DirectoryHasher hasher { cache } ;
+    REQUIRE (hasher.GetCacheSize () == 3) ;
+
+    SECTION ("Unchanged trees are served from the cache") {
+        REQUIRE (BLAKE2::Digest::IsEqual (hasher.Hash (tree), expected)) ;
+        REQUIRE (hasher.GetStatistics ().hashed_files == 0) ;
+        // The digest does not depend on the cache.
+        BLAKE2::DirectoryHasher uncached ;
+        REQUIRE (BLAKE2::Digest::IsEqual (uncached.Hash (tree), expected)) ;
+    }
+    SECTION ("Only the changed files are read") {
+        // Same size and mtime, the ctime tells.
+        write_file (tree + "/sub/b.bin", std::string (299999, 'b') + "B") ;
+        auto    changed = hasher.Hash (tree) ;
+        REQUIRE (hasher.GetStatistics ().hashed_files == 1) ;
+        REQUIRE (! BLAKE2::Digest::IsEqual (changed, expected)) ;
+        write_file (tree + "/sub/b.bin", std::string (300000, 'b')) ;
+        REQUIRE (BLAKE2::Digest::IsEqual (hasher.Hash (tree), expected)) ;
+        REQUIRE (hasher.GetStatistics ().hashed_files == 1) ;
+    }
+    SECTION ("Names, links and modes are hashed") {
+        REQUIRE (rename ((tree + "/sub/deep/c").c_str (), (tree + "/sub/deep/d").c_str ()) == 0) ;
+        REQUIRE (! BLAKE2::Digest::IsEqual (hasher.Hash (tree), expected)) ;
+        REQUIRE (rename ((tree + "/sub/deep/d").c_str (), (tree + "/sub/deep/c").c_str ()) == 0) ;
+        REQUIRE (BLAKE2::Digest::IsEqual (hasher.Hash (tree), expected)) ;
+
+        REQUIRE (chmod ((tree + "/a.txt").c_str (), 0755) == 0) ;
+        REQUIRE (! BLAKE2::Digest::IsEqual (hasher.Hash (tree), expected)) ;
+        REQUIRE (chmod ((tree + "/a.txt").c_str (), 0644) == 0) ;
+
+        REQUIRE (unlink ((tree + "/link").c_str ()) == 0) ;
+        REQUIRE (symlink ("sub", (tree + "/link").c_str ()) == 0) ;
+        REQUIRE (! BLAKE2::Digest::IsEqual (hasher.Hash (tree), expected)) ;
+    }
+    SECTION ("Recently modified files are not cached") {
+        write_file (tree + "/new", "fresh", 0) ;
+        auto    D = hasher.Hash (tree) ;
+        REQUIRE (hasher.GetStatistics ().hashed_files == 1) ;
+        REQUIRE (BLAKE2::Digest::IsEqual (hasher.Hash (tree), D)) ;
+        REQUIRE (hasher.GetStatistics ().hashed_files == 1) ;
+        REQUIRE (hasher.GetCacheSize () == 3) ;
+    }
+    SECTION ("Parameters change the digest and drop the cache") {
+        auto    P = BLAKE2::Parameter ().SetPersonalization ("tree", 4).GetParameterBlock () ;
+        BLAKE2::DirectoryHasher other { P, cache } ;
+        REQUIRE (other.GetCacheSize () == 0) ;
+        REQUIRE (! BLAKE2::Digest::IsEqual (other.Hash (tree), expected)) ;
+    }
+}
+
+TEST_CASE ("Test DirectoryHasher layout", "[directory]") {
+    TemporaryDirectory  tmpdir ;
+    write_file (tmpdir.GetPath () + "/x", "abc") ;
+
+    BLAKE2::Parameter   P ;
+    P.SetFanoutCount (0).SetDepth (255).SetInnerLength (64) ;
+    auto    leaf = BLAKE2::Apply (P.GetParameterBlock (), nullptr, 0, "abc", 3) ;
+    P.SetNodeDepth (1) ;
+    BLAKE2::Generator   g { P.GetParameterBlock () } ;
+    const uint8_t   hdr [9] = { 0, 1, 0, 0, 0, 0, 0, 0, 0 } ;
+    g.Update (hdr, sizeof (hdr)).Update ("x", 1).Update (leaf.data (), leaf.size ()) ;
+
+    BLAKE2::DirectoryHasher hasher ;
+    REQUIRE (BLAKE2::Digest::IsEqual (hasher.Hash (tmpdir.GetPath ()), g.SetLastNode ().Finalize ())) ;
+}
+
+/*
+ * [END OF FILE]
+ */
@@ -0,0 +1,91 @@
+/*
+ * test-drbg.cpp:
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#include "common.h"
+#include <random>
+#include "BLAKE2.hpp"
+#include "BLAKE2/DRBG.hpp"
+#include "BLAKE2/ThreadPool.hpp"
+
+namespace {
+    std::vector<uint8_t>    expected_block (const BLAKE2::Parameter &P, const std::string &seed, uint64_t index) {
+        uint8_t counter [BLAKE2::BLOCK_SIZE] = { 0 } ;
+        for (size_t i = 0 ; i < 8 ; ++i) {
+            counter [i] = static_cast<uint8_t> (index >> (8 * i)) ;
+        }
+        auto    D = BLAKE2::Apply (P, seed.data (), seed.size (), counter, sizeof (counter)) ;
+        return std::vector<uint8_t> (D.begin (), D.end ()) ;
+    }
+}
+
+TEST_CASE ("Test DRBG", "[drbg]") {
+    const std::string   seed { "simulation seed" } ;
+    BLAKE2::Parameter   P ;
+    P.SetPersonalization ("shard-0", 7) ;
+
+    SECTION ("Output blocks") {
+        BLAKE2::DRBG    rng { P.GetParameterBlock (), seed.data (), seed.size () } ;
+        std::vector<uint8_t>    out (BLAKE2::DRBG::OUTPUT_BLOCK_SIZE * 11) ;
+        rng.Fill (out.data (), out.size ()) ;
+        for (uint64_t j = 0 ; j < 11 ; ++j) {
+            auto    E = expected_block (P, seed, j) ;
+            REQUIRE (std::equal (E.begin (), E.end (), out.begin () + BLAKE2::DRBG::OUTPUT_BLOCK_SIZE * j)) ;
+        }
+        REQUIRE (rng.GetPosition () == out.size ()) ;
+    }
+    SECTION ("Split fills and jumps") {
+        BLAKE2::DRBG    whole { P.GetParameterBlock (), seed.data (), seed.size () } ;
+        std::vector<uint8_t>    expected (5000) ;
+        whole.Fill (expected.data (), expected.size ()) ;
+
+        BLAKE2::DRBG    split { P.GetParameterBlock (), seed.data (), seed.size () } ;
+        std::vector<uint8_t>    actual (expected.size ()) ;
+        size_t  pos = 0 ;
+        for (size_t n : { 1, 63, 64, 65, 130, 7, 1000, 3 }) {
+            split.Fill (&actual [pos], n) ;
+            pos += n ;
+        }
+        split.Jump (1000) ;
+        pos += 1000 ;
+        split.Fill (&actual [pos], actual.size () - pos) ;
+        REQUIRE (std::equal (expected.begin (), expected.begin () + pos - 1000, actual.begin ())) ;
+        REQUIRE (std::equal (expected.begin () + pos, expected.end (), actual.begin () + pos)) ;
+
+        BLAKE2::DRBG    seek { P.GetParameterBlock (), seed.data (), seed.size () } ;
+        uint8_t tmp [100] ;
+        seek.Seek (4321).Fill (tmp, sizeof (tmp)) ;
+        REQUIRE (std::equal (tmp, tmp + sizeof (tmp), expected.begin () + 4321)) ;
+    }
+    SECTION ("Executors") {
+        BLAKE2::ThreadPool  pool { 3 } ;
+        std::vector<uint8_t>    a (300000 + 17) ;
+        std::vector<uint8_t>    b (a.size ()) ;
+        BLAKE2::DRBG    r0 { seed.data (), seed.size () } ;
+        BLAKE2::DRBG    r1 { seed.data (), seed.size () } ;
+        r0.Jump (5).Fill (a.data (), a.size ()) ;
+        r1.Jump (5).Fill (b.data (), b.size (), &pool) ;
+        REQUIRE (a == b) ;
+    }
+    SECTION ("Streams are separated") {
+        BLAKE2::Parameter   Q ;
+        Q.SetPersonalization ("shard-1", 7) ;
+        BLAKE2::DRBG    r0 { P.GetParameterBlock (), seed.data (), seed.size () } ;
+        BLAKE2::DRBG    r1 { Q.GetParameterBlock (), seed.data (), seed.size () } ;
+        REQUIRE (r0 () != r1 ()) ;
+    }
+    SECTION ("UniformRandomBitGenerator") {
+        BLAKE2::DRBG    rng { seed.data (), seed.size () } ;
+        std::uniform_int_distribution<int>  dist { 1, 6 } ;
+        for (int i = 0 ; i < 100 ; ++i) {
+            auto    v = dist (rng) ;
+            REQUIRE (1 <= v) ;
+            REQUIRE (v <= 6) ;
+        }
+    }
+}
+
+/*
+ * [END OF FILE]
+ */
@@ -0,0 +1,222 @@
+/*
+ * test-encoding.cpp:
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#include "common.h"
+#include <algorithm>
+#include <string>
+#include "BLAKE2.hpp"
+#include "BLAKE2/Encoding.hpp"
+
+namespace {
+    std::string     naive_hex (const std::vector<uint8_t> &data) {
+        static const char   digits [] = "0123456789abcdef" ;
+        std::string result ;
+        for (auto v : data) {
+            result += digits [v >> 4] ;
+            result += digits [v & 0xF] ;
+        }
+        return result ;
+    }
+
+    std::string     encode_base64 (const std::string &s) {
+        std::string result (BLAKE2::Base64Length (s.size ()), ' ') ;
+        BLAKE2::EncodeBase64 (s.data (), s.size (), &result [0]) ;
+        return result ;
+    }
+
+    std::vector<uint8_t>    make_data (size_t size) {
+        std::vector<uint8_t>    result (size) ;
+        for (size_t i = 0 ; i < size ; ++i) {
+            result [i] = static_cast<uint8_t> ((i * 167 + 13) ^ (i >> 3)) ;
+        }
+        return result ;
+    }
+}
+
+TEST_CASE ("Test hex encoding", "[encoding]") {
+    SECTION ("Round trip") {
+        for (size_t size = 0 ; size < 200 ; ++size) {
+            auto    data = make_data (size) ;
+            std::string hex (BLAKE2::HexLength (size), ' ') ;
+            REQUIRE (BLAKE2::EncodeHex (data.data (), size, &hex [0]) == hex.size ()) ;
+            REQUIRE (hex == naive_hex (data)) ;
+
+            std::vector<uint8_t>    decoded (size) ;
+            REQUIRE (BLAKE2::DecodeHex (hex.data (), hex.size (), decoded.data ())) ;
+            REQUIRE (decoded == data) ;
+        }
+    }
+    SECTION ("Upper case") {
+        std::string hex { "00FFaB9c0123456789ABCDEFabcdef0123456789ABCDEFabcdef0123456789aBcDeF" } ;
+        std::vector<uint8_t>    decoded (hex.size () / 2) ;
+        REQUIRE (BLAKE2::DecodeHex (hex.data (), hex.size (), decoded.data ())) ;
+        REQUIRE (decoded [0] == 0x00) ;
+        REQUIRE (decoded [1] == 0xFF) ;
+        REQUIRE (decoded [2] == 0xAB) ;
+        REQUIRE (decoded [3] == 0x9C) ;
+        REQUIRE (decoded.back () == 0xEF) ;
+    }
+    SECTION ("Malformed") {
+        auto    data = make_data (64) ;
+        auto    hex = naive_hex (data) ;
+        std::vector<uint8_t>    decoded (64) ;
+        REQUIRE_FALSE (BLAKE2::DecodeHex (hex.data (), hex.size () - 1, decoded.data ())) ;
+        for (size_t i = 0 ; i < hex.size () ; ++i) {
+            for (char ch : { 'g', 'G', '/', ':', '@', '`', ' ', '\x80', '\xB0' }) {
+                auto    bad = hex ;
+                bad [i] = ch ;
+                REQUIRE_FALSE (BLAKE2::DecodeHex (bad.data (), bad.size (), decoded.data ())) ;
+            }
+        }
+    }
+}
+
+TEST_CASE ("Test base64 encoding", "[encoding]") {
+    SECTION ("RFC 4648 vectors") {
+        REQUIRE (encode_base64 ("") == "") ;
+        REQUIRE (encode_base64 ("f") == "Zg==") ;
+        REQUIRE (encode_base64 ("fo") == "Zm8=") ;
+        REQUIRE (encode_base64 ("foo") == "Zm9v") ;
+        REQUIRE (encode_base64 ("foob") == "Zm9vYg==") ;
+        REQUIRE (encode_base64 ("fooba") == "Zm9vYmE=") ;
+        REQUIRE (encode_base64 ("foobar") == "Zm9vYmFy") ;
+    }
+    SECTION ("Round trip") {
+        for (size_t size = 0 ; size < 200 ; ++size) {
+            auto    data = make_data (size) ;
+            std::string s (BLAKE2::Base64Length (size), ' ') ;
+            REQUIRE (BLAKE2::EncodeBase64 (data.data (), size, &s [0]) == s.size ()) ;
+            // Compare with the scalar code path of a shorter prefix.
+            for (size_t k = 0 ; k + 3 <= size ; k += 3) {
+                std::string t (4, ' ') ;
+                BLAKE2::EncodeBase64 (&data [k], 3, &t [0]) ;
+                REQUIRE (s.substr (k / 3 * 4, 4) == t) ;
+            }
+            std::vector<uint8_t>    decoded (size + 2) ;
+            size_t  length = 0 ;
+            REQUIRE (BLAKE2::DecodeBase64 (s.data (), s.size (), decoded.data (), &length)) ;
+            REQUIRE (length == size) ;
+            decoded.resize (length) ;
+            REQUIRE (decoded == data) ;
+        }
+    }
+    SECTION ("Malformed") {
+        auto    data = make_data (96) ;
+        std::string s (BLAKE2::Base64Length (data.size ()), ' ') ;
+        BLAKE2::EncodeBase64 (data.data (), data.size (), &s [0]) ;
+        std::vector<uint8_t>    decoded (data.size ()) ;
+        REQUIRE_FALSE (BLAKE2::DecodeBase64 (s.data (), s.size () - 1, decoded.data (), nullptr)) ;
+        for (size_t i = 0 ; i < s.size () ; ++i) {
+            for (char ch : { '-', '_', '*', ':', '@', '[', '`', '{', ' ', '=', '\x80', '\xAF' }) {
+                auto    bad = s ;
+                bad [i] = ch ;
+                if (ch == '=' && s.size () - 2 <= i) {
+                    continue ;  // Valid padding position.
+                }
+                REQUIRE_FALSE (BLAKE2::DecodeBase64 (bad.data (), bad.size (), decoded.data (), nullptr)) ;
+            }
+        }
+    }
+}
+
+TEST_CASE ("Test digest encoding", "[encoding]") {
+    std::vector<BLAKE2::Digest> digests ;
+    for (int i = 0 ; i < 5 ; ++i) {
+        digests.emplace_back (BLAKE2::Apply (nullptr, 0, &i, sizeof (i))) ;
+    }
+    SECTION ("Hex") {
+        char    hex [BLAKE2::HexLength (BLAKE2::Digest::SIZE)] ;
+        REQUIRE (BLAKE2::EncodeHex (digests [0], hex) == sizeof (hex)) ;
+        REQUIRE (std::string (hex, sizeof (hex)) == naive_hex (std::vector<uint8_t> (digests [0].begin (), digests [0].end ()))) ;
+        BLAKE2::Digest  D ;
+        REQUIRE (BLAKE2::DecodeHex (hex, sizeof (hex), D)) ;
+        REQUIRE (BLAKE2::Digest::IsEqual (D, digests [0])) ;
+        // Truncated.
+        REQUIRE (BLAKE2::DecodeHex (hex, 64, D)) ;
+        REQUIRE (D.GetUInt64 (3) == digests [0].GetUInt64 (3)) ;
+        REQUIRE (D.GetUInt64 (4) == 0) ;
+    }
+    SECTION ("Batch") {
+        const size_t    stride = BLAKE2::HexLength (BLAKE2::Digest::SIZE) + 1 ;
+        std::string     text (stride * digests.size (), '\n') ;
+        BLAKE2::EncodeHex (digests.data (), digests.size (), &text [0], stride) ;
+        REQUIRE (text [stride - 1] == '\n') ;
+        std::vector<BLAKE2::Digest> decoded (digests.size ()) ;
+        REQUIRE (BLAKE2::DecodeHex (text.data (), stride, stride - 1, decoded.size (), decoded.data ())) ;
+        for (size_t i = 0 ; i < digests.size () ; ++i) {
+            REQUIRE (BLAKE2::Digest::IsEqual (decoded [i], digests [i])) ;
+        }
+
+        const size_t    stride64 = BLAKE2::Base64Length (BLAKE2::Digest::SIZE) ;
+        std::string     text64 (stride64 * digests.size (), ' ') ;
+        BLAKE2::EncodeBase64 (digests.data (), digests.size (), &text64 [0], stride64) ;
+        REQUIRE (BLAKE2::DecodeBase64 (text64.data (), stride64, stride64, decoded.size (), decoded.data ())) ;
+        for (size_t i = 0 ; i < digests.size () ; ++i) {
+            REQUIRE (BLAKE2::Digest::IsEqual (decoded [i], digests [i])) ;
+        }
+    }
+}
+TEST_CASE ("Test codec kernels", "[encoding]") {
+    auto const      names = BLAKE2::CodecKernel::GetNames () ;
+    const auto      original = BLAKE2::CodecKernel::GetActiveName () ;
+    REQUIRE (std::find (names.begin (), names.end (), "generic") != names.end ()) ;
+    REQUIRE (std::find (names.begin (), names.end (), original) != names.end ()) ;
+    REQUIRE (! BLAKE2::CodecKernel::Select ("no-such-kernel")) ;
+    REQUIRE (BLAKE2::CodecKernel::GetActiveName () == original) ;
+
+    // Results of the scalar code.
+    const size_t                MAX_SIZE = 300 ;
+    std::vector<std::string>    hex ;
+    std::vector<std::string>    base64 ;
+    REQUIRE (BLAKE2::CodecKernel::Select ("generic")) ;
+    for (size_t size = 0 ; size < MAX_SIZE ; ++size) {
+        auto    data = make_data (size) ;
+        hex.emplace_back (BLAKE2::HexLength (size), ' ') ;
+        BLAKE2::EncodeHex (data.data (), size, &hex.back () [0]) ;
+        base64.emplace_back (BLAKE2::Base64Length (size), ' ') ;
+        BLAKE2::EncodeBase64 (data.data (), size, &base64.back () [0]) ;
+    }
+    for (auto const &name : names) {
+        if (! BLAKE2::CodecKernel::Select (name)) {
+            continue ;      // Not supported by this CPU.
+        }
+        INFO ("Kernel: " << name) ;
+        REQUIRE (BLAKE2::CodecKernel::GetActiveName () == name) ;
+        for (size_t size = 0 ; size < MAX_SIZE ; ++size) {
+            auto    data = make_data (size) ;
+            std::string s (BLAKE2::HexLength (size), ' ') ;
+            BLAKE2::EncodeHex (data.data (), size, &s [0]) ;
+            REQUIRE (s == hex [size]) ;
+            std::vector<uint8_t>    decoded (size + 2) ;
+            REQUIRE (BLAKE2::DecodeHex (s.data (), s.size (), decoded.data ())) ;
+            REQUIRE (std::equal (data.begin (), data.end (), decoded.begin ())) ;
+
+            s.assign (BLAKE2::Base64Length (size), ' ') ;
+            BLAKE2::EncodeBase64 (data.data (), size, &s [0]) ;
+            REQUIRE (s == base64 [size]) ;
+            size_t  length = 0 ;
+            REQUIRE (BLAKE2::DecodeBase64 (s.data (), s.size (), decoded.data (), &length)) ;
+            REQUIRE (length == size) ;
+            REQUIRE (std::equal (data.begin (), data.end (), decoded.begin ())) ;
+        }
+        // Errors inside the SIMD chunks.
+        std::vector<uint8_t>    decoded (MAX_SIZE) ;
+        for (size_t i = 0 ; i < hex.back ().size () ; i += 7) {
+            auto    bad = hex.back () ;
+            bad [i] = 'g' ;
+            REQUIRE_FALSE (BLAKE2::DecodeHex (bad.data (), bad.size (), decoded.data ())) ;
+        }
+        for (size_t i = 0 ; i + 4 < base64.back ().size () ; i += 7) {
+            auto    bad = base64.back () ;
+            bad [i] = '*' ;
+            REQUIRE_FALSE (BLAKE2::DecodeBase64 (bad.data (), bad.size (), decoded.data (), nullptr)) ;
+        }
+    }
+    BLAKE2::CodecKernel::Select (original) ;
+}
+
+/*
+ * [END OF FILE]
+ */
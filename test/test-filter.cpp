@@ -0,0 +1,184 @@
+/*
+ * test-filter.cpp:
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#include "common.h"
+#include <string>
+#include <vector>
+#include "BLAKE2.hpp"
+#include "BLAKE2/Filter.hpp"
+
+namespace {
+    struct Keys {
+        std::vector<std::string>    keys ;
+        std::vector<const void *>   data ;
+        std::vector<size_t>         size ;
+
+        Keys (const std::string &prefix, size_t count) {
+            keys.reserve (count) ;
+            for (size_t i = 0 ; i < count ; ++i) {
+                keys.emplace_back (prefix + std::to_string (i)) ;
+            }
+            for (auto const &k : keys) {
+                data.emplace_back (k.data ()) ;
+                size.emplace_back (k.size ()) ;
+            }
+        }
+    } ;
+}
+
+TEST_CASE ("Test FilterHash", "[filter]") {
+    std::vector<size_t> lengths { 0, 1, 8, 127, 128, 129, 256, 300, 5, 64, 100, 33, 2 } ;
+    // Message i starts at offset i (misaligned).
+    std::vector<uint8_t>    src (300 + lengths.size ()) ;
+    for (size_t i = 0 ; i < src.size () ; ++i) {
+        src [i] = static_cast<uint8_t> ((i * 7 + 3) & 0xFF) ;
+    }
+    auto check = [&src, &lengths](const BLAKE2::FilterHash &H, const BLAKE2::Parameter &P, const void *key, size_t key_length) {
+        std::vector<const void *>   data ;
+        std::vector<BLAKE2::hash_t> batch (lengths.size ()) ;
+        for (size_t i = 0 ; i < lengths.size () ; ++i) {
+            data.emplace_back (src.data () + i) ;
+        }
+        H.Apply (lengths.size (), data.data (), lengths.data (), batch.data ()) ;
+        for (size_t i = 0 ; i < lengths.size () ; ++i) {
+            auto expected = BLAKE2::Apply (P, key, key_length, data [i], lengths [i]) ;
+            BLAKE2::hash_t  h ;
+            H.Apply (data [i], lengths [i], h) ;
+            for (size_t j = 0 ; j < 8 ; ++j) {
+                REQUIRE (h [j] == expected.GetUInt64 (j)) ;
+                REQUIRE (batch [i][j] == h [j]) ;
+            }
+        }
+    } ;
+    SECTION ("With key") {
+        BLAKE2::FilterHash  H { "0123456789abcdef", 16 } ;
+        check (H, BLAKE2::Parameter (), "0123456789abcdef", 16) ;
+    }
+    SECTION ("Without key") {
+        BLAKE2::FilterHash  H { nullptr, 0 } ;
+        check (H, BLAKE2::Parameter (), nullptr, 0) ;
+    }
+    SECTION ("With personalization") {
+        BLAKE2::Parameter   P ;
+        P.SetPersonalization ("bloom", 5) ;
+        BLAKE2::FilterHash  H { P.GetParameterBlock (), "key", 3 } ;
+        check (H, P, "key", 3) ;
+    }
+}
+
+TEST_CASE ("Test BloomFilter", "[filter]") {
+    Keys    in { "in-", 20000 } ;
+    Keys    out { "out-", 20000 } ;
+    std::vector<char>   result (in.keys.size ()) ;
+    auto *  r = reinterpret_cast<bool *> (result.data ()) ;
+
+    SECTION ("Classic") {
+        BLAKE2::BloomFilter     F { 1u << 18, 7, "key", 3 } ;
+        F.Insert (in.keys.size (), in.data.data (), in.size.data ()) ;
+        for (size_t i = 0 ; i < in.keys.size () ; ++i) {
+            REQUIRE (F.Contains (in.data [i], in.size [i])) ;
+        }
+        F.Contains (out.keys.size (), out.data.data (), out.size.data (), r) ;
+        size_t  fp = 0 ;
+        for (size_t i = 0 ; i < out.keys.size () ; ++i) {
+            REQUIRE (r [i] == F.Contains (out.data [i], out.size [i])) ;
+            fp += r [i] ? 1 : 0 ;
+        }
+        REQUIRE (fp < out.keys.size () / 50) ;
+        F.Clear () ;
+        REQUIRE_FALSE (F.Contains (in.data [0], in.size [0])) ;
+    }
+    SECTION ("Blocked") {
+        BLAKE2::BlockedBloomFilter  F { 1u << 18, 8, "key", 3 } ;
+        REQUIRE (F.GetBitCount () == (1u << 18)) ;
+        for (size_t i = 0 ; i < in.keys.size () ; i += 2) {
+            F.Insert (in.data [i], in.size [i]) ;
+        }
+        std::vector<const void *>   odd_data ;
+        std::vector<size_t>         odd_size ;
+        for (size_t i = 1 ; i < in.keys.size () ; i += 2) {
+            odd_data.emplace_back (in.data [i]) ;
+            odd_size.emplace_back (in.size [i]) ;
+        }
+        F.Insert (odd_data.size (), odd_data.data (), odd_size.data ()) ;
+        F.Contains (in.keys.size (), in.data.data (), in.size.data (), r) ;
+        for (size_t i = 0 ; i < in.keys.size () ; ++i) {
+            REQUIRE (r [i]) ;
+        }
+        F.Contains (out.keys.size (), out.data.data (), out.size.data (), r) ;
+        size_t  fp = 0 ;
+        for (size_t i = 0 ; i < out.keys.size () ; ++i) {
+            fp += r [i] ? 1 : 0 ;
+        }
+        REQUIRE (fp < out.keys.size () / 30) ;
+    }
+    SECTION ("Keys change the probes") {
+        BLAKE2::BloomFilter     F1 { 1u << 16, 4, "key-1", 5 } ;
+        BLAKE2::BloomFilter     F2 { 1u << 16, 4, "key-2", 5 } ;
+        F1.Insert (in.keys.size () / 20, in.data.data (), in.size.data ()) ;
+        F2.Insert (in.keys.size () / 20, in.data.data (), in.size.data ()) ;
+        size_t  hit = 0 ;
+        for (size_t i = 0 ; i < out.keys.size () ; ++i) {
+            hit += (F1.Contains (out.data [i], out.size [i]) && F2.Contains (out.data [i], out.size [i])) ? 1 : 0 ;
+        }
+        REQUIRE (hit < out.keys.size () / 1000) ;
+    }
+    SECTION ("Invalid parameters") {
+        REQUIRE_THROWS_AS (BLAKE2::BloomFilter (0, 4, nullptr, 0), std::invalid_argument) ;
+        REQUIRE_THROWS_AS (BLAKE2::BloomFilter (1024, 0, nullptr, 0), std::invalid_argument) ;
+        REQUIRE_THROWS_AS (BLAKE2::BloomFilter (1024, 9, nullptr, 0), std::invalid_argument) ;
+        REQUIRE_THROWS_AS (BLAKE2::BlockedBloomFilter (1024, 17, nullptr, 0), std::invalid_argument) ;
+    }
+}
+
+TEST_CASE ("Test CuckooFilter", "[filter]") {
+    Keys    in { "in-", 20000 } ;
+    Keys    out { "out-", 20000 } ;
+    std::vector<char>   result (in.keys.size ()) ;
+    auto *  r = reinterpret_cast<bool *> (result.data ()) ;
+
+    BLAKE2::CuckooFilter    F { in.keys.size (), "key", 3 } ;
+    REQUIRE (F.Insert (in.keys.size (), in.data.data (), in.size.data ()) == in.keys.size ()) ;
+    REQUIRE (F.GetCount () == in.keys.size ()) ;
+    F.Contains (in.keys.size (), in.data.data (), in.size.data (), r) ;
+    for (size_t i = 0 ; i < in.keys.size () ; ++i) {
+        REQUIRE (r [i]) ;
+    }
+    F.Contains (out.keys.size (), out.data.data (), out.size.data (), r) ;
+    size_t  fp = 0 ;
+    for (size_t i = 0 ; i < out.keys.size () ; ++i) {
+        fp += r [i] ? 1 : 0 ;
+    }
+    REQUIRE (fp < out.keys.size () / 200) ;
+
+    SECTION ("Remove") {
+        for (size_t i = 0 ; i < in.keys.size () ; i += 2) {
+            REQUIRE (F.Remove (in.data [i], in.size [i])) ;
+        }
+        REQUIRE (F.GetCount () == in.keys.size () / 2) ;
+        for (size_t i = 1 ; i < in.keys.size () ; i += 2) {
+            REQUIRE (F.Contains (in.data [i], in.size [i])) ;
+        }
+        size_t  remains = 0 ;
+        for (size_t i = 0 ; i < in.keys.size () ; i += 2) {
+            remains += F.Contains (in.data [i], in.size [i]) ? 1 : 0 ;
+        }
+        REQUIRE (remains < in.keys.size () / 200) ;
+    }
+    SECTION ("Full") {
+        BLAKE2::CuckooFilter    S { 16, "key", 3 } ;
+        size_t  inserted = S.Insert (in.keys.size (), in.data.data (), in.size.data ()) ;
+        REQUIRE (inserted < in.keys.size ()) ;
+        REQUIRE (S.GetCount () == inserted) ;
+        REQUIRE (S.GetCount () <= S.GetBucketCount () * BLAKE2::CuckooFilter::SLOTS_PER_BUCKET + 1) ;
+        for (size_t i = 0 ; i < inserted ; ++i) {
+            REQUIRE (S.Contains (in.data [i], in.size [i])) ;
+        }
+        REQUIRE_FALSE (S.Insert (in.data [inserted], in.size [inserted])) ;
+        S.Clear () ;
+        REQUIRE (S.GetCount () == 0) ;
+        REQUIRE (S.Insert (in.data [0], in.size [0])) ;
+    }
+}
@@ -0,0 +1,61 @@
+/*
+ * test-kernel.cpp:
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#include "common.h"
+#include "BLAKE2.hpp"
+#include "BLAKE2/Kernel.hpp"
+
+#include <algorithm>
+
+TEST_CASE ("Test Kernel", "[kernel]") {
+    auto const      names = BLAKE2::Kernel::GetNames () ;
+    const auto      original = BLAKE2::Kernel::GetActiveName () ;
+    REQUIRE (std::find (names.begin (), names.end (), "generic") != names.end ()) ;
+    REQUIRE (std::find (names.begin (), names.end (), original) != names.end ()) ;
+    REQUIRE (BLAKE2::Kernel::SelfTest (original)) ;         // The default is supported.
+    REQUIRE (! BLAKE2::Kernel::SelfTest ("no-such-kernel")) ;
+    REQUIRE (! BLAKE2::Kernel::Select ("no-such-kernel")) ;
+    REQUIRE (BLAKE2::Kernel::GetActiveName () == original) ;
+
+    std::vector<uint8_t>    data (1000) ;
+    for (size_t i = 0 ; i < data.size () ; ++i) {
+        data [i] = static_cast<uint8_t> (i * 7) ;
+    }
+    const BLAKE2::Digest    expected { BLAKE2::Apply (nullptr, 0, data.data (), data.size ()) } ;
+
+    SECTION ("Every supported kernel computes the same digests") {
+        for (auto const &name : names) {
+            if (! BLAKE2::Kernel::SelfTest (name)) {
+                continue ;
+            }
+            REQUIRE (BLAKE2::Kernel::Select (name)) ;
+            REQUIRE (BLAKE2::Kernel::GetActiveName () == name) ;
+            REQUIRE (BLAKE2::Digest::IsEqual (BLAKE2::Apply (nullptr, 0, data.data (), data.size ()), expected)) ;
+        }
+        REQUIRE (BLAKE2::Kernel::SelfTest ("generic")) ;
+    }
+    SECTION ("AutoTune selects the fastest passing kernel, once") {
+        auto const &    results = BLAKE2::Kernel::AutoTune () ;
+        REQUIRE (results.size () == names.size ()) ;
+        const BLAKE2::Kernel::Result *  fastest = nullptr ;
+        for (auto const &R : results) {
+            if (R.passed) {
+                REQUIRE (0 < R.ns_per_block) ;
+                if (fastest == nullptr || R.ns_per_block < fastest->ns_per_block) {
+                    fastest = &R ;
+                }
+            }
+        }
+        REQUIRE (fastest != nullptr) ;
+        REQUIRE (BLAKE2::Kernel::GetActiveName () == fastest->name) ;
+        REQUIRE (&BLAKE2::Kernel::AutoTune () == &results) ;
+        REQUIRE (BLAKE2::Digest::IsEqual (BLAKE2::Apply (nullptr, 0, data.data (), data.size ()), expected)) ;
+    }
+    BLAKE2::Kernel::Select (original) ;
+}
+
+/*
+ * [END OF FILE]
+ */
@@ -0,0 +1,126 @@
+/*
+ * test-mmr.cpp:
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#include "common.h"
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "BLAKE2.hpp"
+#include "BLAKE2/MMR.hpp"
+
+namespace {
+    std::string     leaf_data (uint64_t i) {
+        return "entry-" + std::to_string (i) ;
+    }
+
+    void    append (BLAKE2::MerkleMountainRange &M, uint64_t first, uint64_t count) {
+        for (uint64_t i = first ; i < first + count ; ++i) {
+            auto s = leaf_data (i) ;
+            REQUIRE (M.Append (s.data (), s.size ()) == i) ;
+        }
+    }
+}
+
+TEST_CASE ("Test MerkleMountainRange", "[mmr]") {
+    BLAKE2::Parameter   P ;
+    P.SetSalt ("audit-log", 9) ;
+    const auto &    param = P.GetParameterBlock () ;
+    BLAKE2::MerkleMountainRange M { param } ;
+    REQUIRE (M.GetLeafCount () == 0) ;
+    REQUIRE (M.GetNodeCount () == 0) ;
+
+    SECTION ("Nodes") {
+        append (M, 0, 3) ;
+        REQUIRE (M.GetNodeCount () == 4) ;
+        BLAKE2::Parameter   T { param } ;
+        T.SetFanoutCount (2).SetDepth (255).SetInnerLength (64) ;
+        auto s = leaf_data (1) ;
+        REQUIRE (BLAKE2::Digest::IsEqual (M.GetLeaf (1), BLAKE2::Apply (BLAKE2::Parameter (T).SetNodeOffset (1), nullptr, 0, s.data (), s.size ()))) ;
+        uint8_t     pair [128] ;
+        M.GetNode (0).CopyTo (pair, 64) ;
+        M.GetNode (1).CopyTo (pair + 64, 64) ;
+        auto expected = BLAKE2::Apply (BLAKE2::Parameter (T).SetNodeDepth (1).SetNodeOffset (2), nullptr, 0, pair, sizeof (pair)) ;
+        REQUIRE (BLAKE2::Digest::IsEqual (M.GetNode (2), expected)) ;
+        REQUIRE_THROWS_AS (M.GetNode (4), std::out_of_range) ;
+    }
+    SECTION ("Batched append") {
+        std::vector<std::string>    leaves ;
+        for (uint64_t i = 0 ; i < 1000 ; ++i) {
+            leaves.emplace_back (leaf_data (i)) ;
+        }
+        std::vector<const void *>   data ;
+        std::vector<size_t>         size ;
+        for (auto const &s : leaves) {
+            data.emplace_back (s.data ()) ;
+            size.emplace_back (s.size ()) ;
+        }
+        REQUIRE (M.Append (10, data.data (), size.data ()) == 0) ;
+        REQUIRE (M.Append (leaves.size () - 10, data.data () + 10, size.data () + 10) == 10) ;
+
+        BLAKE2::MerkleMountainRange S { param } ;
+        append (S, 0, leaves.size ()) ;
+        REQUIRE (M.GetNodeCount () == 2 * 1000 - 6) ;
+        REQUIRE (S.GetNodeCount () == M.GetNodeCount ()) ;
+        REQUIRE (BLAKE2::Digest::IsEqual (M.GetRoot (), S.GetRoot ())) ;
+        REQUIRE (BLAKE2::Digest::IsEqual (M.GetRoot (999), S.GetRoot (999))) ;
+        REQUIRE_FALSE (BLAKE2::Digest::IsEqual (M.GetRoot (999), M.GetRoot ())) ;
+    }
+    SECTION ("Inclusion proofs") {
+        append (M, 0, 37) ;
+        for (uint64_t n = 1 ; n <= 37 ; ++n) {
+            auto root = M.GetRoot (n) ;
+            for (uint64_t i = 0 ; i < n ; ++i) {
+                auto proof = M.ProveInclusion (i, n) ;
+                auto s = leaf_data (i) ;
+                REQUIRE (BLAKE2::MerkleMountainRange::VerifyInclusion (param, root, s.data (), s.size (), proof)) ;
+                auto t = leaf_data (i + 1) ;
+                REQUIRE_FALSE (BLAKE2::MerkleMountainRange::VerifyInclusion (param, root, t.data (), t.size (), proof)) ;
+                if (! proof.path.empty ()) {
+                    proof.path.pop_back () ;
+                    REQUIRE_FALSE (BLAKE2::MerkleMountainRange::VerifyInclusion (param, root, s.data (), s.size (), proof)) ;
+                }
+            }
+        }
+        auto s = leaf_data (3) ;
+        auto proof = M.ProveInclusion (3) ;
+        REQUIRE_FALSE (BLAKE2::MerkleMountainRange::VerifyInclusion (BLAKE2::Parameter ().GetParameterBlock (), M.GetRoot (), s.data (), s.size (), proof)) ;
+        REQUIRE_THROWS_AS (M.ProveInclusion (37), std::out_of_range) ;
+    }
+    SECTION ("Consistency proofs") {
+        append (M, 0, 33) ;
+        for (uint64_t n = 0 ; n <= 33 ; ++n) {
+            for (uint64_t m = 0 ; m <= n ; ++m) {
+                auto proof = M.ProveConsistency (m, n) ;
+                REQUIRE (BLAKE2::MerkleMountainRange::VerifyConsistency (param, M.GetRoot (m), M.GetRoot (n), proof)) ;
+                if (0 < m && m < n) {
+                    REQUIRE_FALSE (BLAKE2::MerkleMountainRange::VerifyConsistency (param, M.GetRoot (m - 1), M.GetRoot (n), proof)) ;
+                    if (! proof.path.empty ()) {
+                        proof.path [0] = M.GetLeaf (0) ;
+                        REQUIRE_FALSE (BLAKE2::MerkleMountainRange::VerifyConsistency (param, M.GetRoot (m), M.GetRoot (n), proof)) ;
+                    }
+                }
+            }
+        }
+    }
+    SECTION ("File") {
+        const std::string   path { "test-mmr.tmp" } ;
+        std::remove (path.c_str ()) ;
+        {
+            auto F = BLAKE2::MerkleMountainRange::Open (path, param) ;
+            append (F, 0, 3000) ;
+            F.Sync () ;
+        }
+        append (M, 0, 5000) ;
+        {
+            auto F = BLAKE2::MerkleMountainRange::Open (path, param) ;
+            REQUIRE (F.GetLeafCount () == 3000) ;
+            REQUIRE (BLAKE2::Digest::IsEqual (F.GetRoot (), M.GetRoot (3000))) ;
+            append (F, 3000, 2000) ;
+            REQUIRE (BLAKE2::Digest::IsEqual (F.GetRoot (), M.GetRoot ())) ;
+        }
+        REQUIRE_THROWS_AS (BLAKE2::MerkleMountainRange::Open (path), BLAKE2::MerkleMountainRange::FormatError) ;
+        std::remove (path.c_str ()) ;
+    }
+}
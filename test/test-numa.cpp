@@ -0,0 +1,56 @@
+/*
+ * test-numa.cpp:
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#include "common.h"
+#include "BLAKE2.hpp"
+#include "BLAKE2/Numa.hpp"
+#include "BLAKE2/Parallel.hpp"
+
+using BLAKE2::NumaTopology ;
+
+TEST_CASE ("Test NUMA aware tree hashing", "[numa]") {
+    std::vector<uint8_t>    data (3 * 1024 * 1024 + 777) ;
+    for (size_t i = 0 ; i < data.size () ; ++i) {
+        data [i] = static_cast<uint8_t> (i * 29 + (i >> 13)) ;
+    }
+    SECTION ("Topology of this machine") {
+        auto const &    T = NumaTopology::System () ;
+        REQUIRE (0 < T.GetNodeCount ()) ;
+        for (size_t k = 0 ; k < T.GetNodeCount () ; ++k) {
+            REQUIRE (! T.GetNode (k).cpus.empty ()) ;
+            REQUIRE (T.FindNode (T.GetNode (k).id) == k) ;
+        }
+        REQUIRE (T.FindNode (NumaTopology::UNKNOWN_NODE) == T.GetNodeCount ()) ;
+        REQUIRE_THROWS_AS (NumaTopology { {} }, std::invalid_argument) ;
+        REQUIRE_THROWS_AS ((NumaTopology { { { 0, {} } } }), std::invalid_argument) ;
+
+        const void *    pages [] = { data.data (), data.data () + data.size () / 2 } ;
+        int             nodes [2] ;
+        NumaTopology::QueryPageNodes (pages, 2, nodes) ;
+        for (int id : nodes) {
+            REQUIRE ((id == NumaTopology::UNKNOWN_NODE || 0 <= id)) ;
+        }
+    }
+    SECTION ("Same digests as ApplyTree") {
+        // Node 0 matches the pages of a single node machine, node 1000 never does.
+        BLAKE2::NumaThreadPools     fake { NumaTopology { { { 0, { 0, 0 } }, { 1000, { 0 } }, { 1001, { 0, 0, 0 } } } } } ;
+        BLAKE2::NumaThreadPools     unknown { NumaTopology { { { 1000, { 0 } }, { 1001, { 0 } } } } } ;
+        const std::string   key { "numa" } ;
+
+        struct Shape {
+            uint8_t     fanout ;
+            uint8_t     depth ;
+            uint32_t    leaf_length ;
+        } ;
+        for (auto const &S : { Shape { 0, 2, 64 * 1024 }, Shape { 4, 3, 4096 }, Shape { 2, 255, 100000 }, Shape { 1, 1, 0 } }) {
+            BLAKE2::Parameter   P ;
+            P.SetFanoutCount (S.fanout).SetDepth (S.depth).SetLeafLength (S.leaf_length) ;
+            auto const  expected = BLAKE2::ApplyTree (P.GetParameterBlock (), key.data (), key.size (), data.data (), data.size ()) ;
+            REQUIRE (BLAKE2::Digest::IsEqual (BLAKE2::ApplyTreeNuma (P.GetParameterBlock (), key.data (), key.size (), data.data (), data.size ()), expected)) ;
+            REQUIRE (BLAKE2::Digest::IsEqual (BLAKE2::ApplyTreeNuma (P.GetParameterBlock (), key.data (), key.size (), data.data (), data.size (), &fake), expected)) ;
+            REQUIRE (BLAKE2::Digest::IsEqual (BLAKE2::ApplyTreeNuma (P.GetParameterBlock (), key.data (), key.size (), data.data (), data.size (), &unknown), expected)) ;
+        }
+    }
+}
@@ -0,0 +1,152 @@
+/*
+ * test-parallel.cpp:
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#include "common.h"
+#include "TestVector.h"
+#include "BLAKE2.hpp"
+#include "BLAKE2/Parallel.hpp"
+
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+
+TEST_CASE ("Test ThreadPool", "[ThreadPool]") {
+    BLAKE2::ThreadPool  pool { 3 } ;
+
+    SECTION ("Every job runs exactly once") {
+        std::vector<std::atomic<int>>   hits (1000) ;
+        pool.Run (hits.size (), [&hits](size_t i) { hits [i].fetch_add (1) ; }) ;
+        for (auto &h : hits) {
+            REQUIRE (h.load () == 1) ;
+        }
+    }
+    SECTION ("Nested batches") {
+        std::atomic<int>    total { 0 } ;
+        pool.Run (8, [&pool, &total](size_t) {
+            pool.Run (16, [&total](size_t) { total.fetch_add (1) ; }) ;
+        }) ;
+        REQUIRE (total.load () == 8 * 16) ;
+    }
+    SECTION ("Exceptions are propagated") {
+        std::atomic<int>    done { 0 } ;
+        REQUIRE_THROWS_AS (pool.Run (100, [&done](size_t i) {
+            done.fetch_add (1) ;
+            if (i == 42) {
+                throw std::runtime_error { "42" } ;
+            }
+        }), std::runtime_error) ;
+        REQUIRE (done.load () == 100) ;
+    }
+    SECTION ("Caller supplied executor") {
+        std::vector<std::thread>    threads ;
+        BLAKE2::FunctionExecutor    exec { [&threads](BLAKE2::FunctionExecutor::task_t &&task) {
+            threads.emplace_back (std::move (task)) ;
+        }, 4 } ;
+        std::vector<std::atomic<int>>   hits (100) ;
+        exec.Run (hits.size (), [&hits](size_t i) { hits [i].fetch_add (1) ; }) ;
+        for (auto &t : threads) {
+            t.join () ;
+        }
+        for (auto &h : hits) {
+            REQUIRE (h.load () == 1) ;
+        }
+    }
+}
+
+TEST_CASE ("Test BLAKE2bp", "[parallel]") {
+    uint8_t     key [64] ;
+    uint8_t     buf [256] ;
+
+    for (size_t i = 0 ; i < sizeof (key) ; ++i) {
+        key [i] = static_cast<uint8_t> (i & 0xFF) ;
+    }
+    for (size_t i = 0 ; i < sizeof (buf) ; ++i) {
+        buf [i] = static_cast<uint8_t> (i & 0xFF) ;
+    }
+    BLAKE2::ThreadPool  pool { 2 } ;
+
+    for (size_t i = 0 ; i < TestVector::NUM_BLAKE2_TEST ; ++i) {
+        BLAKE2::Digest  D { BLAKE2::ApplyParallel (key, sizeof (key), buf, i) } ;
+        for (size_t j = 0 ; j < 64 ; ++j) {
+            REQUIRE (D [j] == TestVector::BLAKE2BP [i][j]) ;
+        }
+        REQUIRE (BLAKE2::Digest::IsEqual (D, BLAKE2::ApplyParallel (key, sizeof (key), buf, i, &pool))) ;
+    }
+}
+
+TEST_CASE ("Test tree hashing", "[tree]") {
+    std::vector<uint8_t>    src (100000) ;
+    for (size_t i = 0 ; i < src.size () ; ++i) {
+        src [i] = static_cast<uint8_t> ((i * 7) & 0xFF) ;
+    }
+    BLAKE2::ThreadPool  pool { 3 } ;
+
+    SECTION ("Depth 1 is the sequential mode") {
+        BLAKE2::Parameter   P ;
+        BLAKE2::Digest  expected { BLAKE2::Apply (P, nullptr, 0, src.data (), src.size ()) } ;
+        REQUIRE (BLAKE2::Digest::IsEqual (expected, BLAKE2::ApplyTree (P, nullptr, 0, src.data (), src.size (), &pool))) ;
+    }
+    SECTION ("Compare with the manually built tree") {
+        const size_t        leaf_len = 4096 ;
+        BLAKE2::Parameter   P ;
+        P.SetFanoutCount (4).SetDepth (3).SetLeafLength (leaf_len).SetInnerLength (64) ;
+
+        auto    node = [&P](uint8_t depth, uint64_t offset, bool last, const void *p, size_t len) {
+            BLAKE2::Parameter   N { P } ;
+            N.SetNodeDepth (depth).SetNodeOffset (offset) ;
+            BLAKE2::Generator   g { N } ;
+            if (last) {
+                g.SetLastNode () ;
+            }
+            return g.Update (p, len).Finalize () ;
+        } ;
+        // 25 leaves --> 7 nodes --> root (depth limit).
+        const size_t    cnt_leaves = (src.size () + leaf_len - 1) / leaf_len ;
+        std::vector<BLAKE2::Digest>     leaves ;
+        for (size_t i = 0 ; i < cnt_leaves ; ++i) {
+            size_t  off = i * leaf_len ;
+            leaves.emplace_back (node (0, i, i + 1 == cnt_leaves, &src [off], std::min (leaf_len, src.size () - off))) ;
+        }
+        std::vector<BLAKE2::Digest>     inner ;
+        for (size_t i = 0 ; i < cnt_leaves ; i += 4) {
+            BLAKE2::Parameter   N { P } ;
+            N.SetNodeDepth (1).SetNodeOffset (i / 4) ;
+            BLAKE2::Generator   g { N } ;
+            if (cnt_leaves <= i + 4) {
+                g.SetLastNode () ;
+            }
+            for (size_t j = i ; j < std::min (cnt_leaves, i + 4) ; ++j) {
+                g.Update (leaves [j].data (), leaves [j].size ()) ;
+            }
+            inner.emplace_back (g.Finalize ()) ;
+        }
+        BLAKE2::Parameter   R { P } ;
+        R.SetNodeDepth (2).SetNodeOffset (0) ;
+        BLAKE2::Generator   root { R } ;
+        root.SetLastNode () ;
+        for (auto const &d : inner) {
+            root.Update (d.data (), d.size ()) ;
+        }
+        BLAKE2::Digest  expected { root.Finalize () } ;
+
+        BLAKE2::SequentialExecutor  seq ;
+        REQUIRE (BLAKE2::Digest::IsEqual (expected, BLAKE2::ApplyTree (P, nullptr, 0, src.data (), src.size (), &seq))) ;
+        REQUIRE (BLAKE2::Digest::IsEqual (expected, BLAKE2::ApplyTree (P, nullptr, 0, src.data (), src.size (), &pool))) ;
+    }
+    SECTION ("Digest does not depend on the executor") {
+        BLAKE2::Parameter   P ;
+        P.SetFanoutCount (2).SetDepth (255).SetLeafLength (1024).SetInnerLength (32) ;
+        BLAKE2::SequentialExecutor  seq ;
+        for (size_t len : { 0, 1, 1024, 1025, 4096, 77777 }) {
+            BLAKE2::Digest  a { BLAKE2::ApplyTree (P, "key", 3, src.data (), len, &seq) } ;
+            BLAKE2::Digest  b { BLAKE2::ApplyTree (P, "key", 3, src.data (), len, &pool) } ;
+            REQUIRE (BLAKE2::Digest::IsEqual (a, b)) ;
+        }
+    }
+}
+
+/*
+ * [END OF FILE]
+ */
@@ -0,0 +1,122 @@
+/*
+ * test-router.cpp:
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#include "common.h"
+#include <string>
+#include <vector>
+#include "BLAKE2.hpp"
+#include "BLAKE2/Router.hpp"
+
+TEST_CASE ("Test RendezvousRouter", "[router]") {
+    BLAKE2::Parameter   P ;
+    P.SetSalt ("deployment-1", 12) ;
+    BLAKE2::RendezvousRouter    R { P.GetParameterBlock () } ;
+    REQUIRE (R.Route ("key", 3) == BLAKE2::RendezvousRouter::NO_NODE) ;
+    for (int i = 0 ; i < 11 ; ++i) {
+        REQUIRE (R.AddNode ("node-" + std::to_string (i)) == static_cast<size_t> (i)) ;
+    }
+    const size_t    N = R.GetNodeCount () ;
+
+    SECTION ("Scores") {
+        P.SetDigestLength (8) ;
+        std::vector<uint8_t>    key (300) ;
+        for (size_t i = 0 ; i < key.size () ; ++i) {
+            key [i] = static_cast<uint8_t> (i * 3 + 1) ;
+        }
+        std::vector<uint64_t>   scores (N) ;
+        for (auto len : { 0, 1, 127, 128, 129, 256, 300 }) {
+            R.Score (key.data (), len, scores.data ()) ;
+            for (size_t i = 0 ; i < N ; ++i) {
+                auto const &    name = R.GetNodeName (i) ;
+                auto expected = BLAKE2::Apply (P, name.data (), name.size (), key.data (), len) ;
+                REQUIRE (scores [i] == expected.GetUInt64 (0)) ;
+            }
+        }
+    }
+    SECTION ("Stability") {
+        const size_t    cnt_keys = 5000 ;
+        std::vector<size_t>     before (cnt_keys) ;
+        std::vector<size_t>     hits (N) ;
+        for (size_t i = 0 ; i < cnt_keys ; ++i) {
+            auto k = std::to_string (i) ;
+            before [i] = R.Route (k.data (), k.size ()) ;
+            ++hits [before [i]] ;
+            size_t  rank [3] ;
+            R.Rank (k.data (), k.size (), 3, rank) ;
+            REQUIRE (rank [0] == before [i]) ;
+            REQUIRE (rank [1] != rank [0]) ;
+        }
+        for (auto h : hits) {
+            REQUIRE (cnt_keys / N / 2 < h) ;
+        }
+        REQUIRE (R.RemoveNode ("node-3")) ;
+        REQUIRE_FALSE (R.RemoveNode ("node-3")) ;
+        for (size_t i = 0 ; i < cnt_keys ; ++i) {
+            auto k = std::to_string (i) ;
+            auto idx = R.Route (k.data (), k.size ()) ;
+            if (before [i] < 3) {
+                REQUIRE (idx == before [i]) ;
+            }
+            else if (3 < before [i]) {
+                REQUIRE (idx == before [i] - 1) ;
+            }
+        }
+    }
+    SECTION ("Weights") {
+        R.AddNode ("heavy", 10.0) ;
+        const size_t    cnt_keys = 20000 ;
+        size_t  heavy = 0 ;
+        for (size_t i = 0 ; i < cnt_keys ; ++i) {
+            auto k = std::to_string (i) ;
+            heavy += (R.Route (k.data (), k.size ()) == N) ? 1 : 0 ;
+        }
+        // Expects 10 / 21 of the keys.
+        REQUIRE (cnt_keys * 4 / 10 < heavy) ;
+        REQUIRE (heavy < cnt_keys * 6 / 10) ;
+    }
+    SECTION ("Invalid nodes") {
+        REQUIRE_THROWS_AS (R.AddNode ("node-0"), std::invalid_argument) ;
+        REQUIRE_THROWS_AS (R.AddNode (""), std::invalid_argument) ;
+        REQUIRE_THROWS_AS (R.AddNode (std::string (65, 'x')), std::invalid_argument) ;
+        REQUIRE_THROWS_AS (R.AddNode ("zero", 0.0), std::invalid_argument) ;
+    }
+}
+
+TEST_CASE ("Test JumpRouter", "[router]") {
+    BLAKE2::JumpRouter  J { 10, "key", 3 } ;
+    const size_t    cnt_keys = 10000 ;
+    std::vector<std::string>    keys ;
+    std::vector<const void *>   data ;
+    std::vector<size_t>         size ;
+    for (size_t i = 0 ; i < cnt_keys ; ++i) {
+        keys.emplace_back (std::to_string (i)) ;
+    }
+    for (auto const &k : keys) {
+        data.emplace_back (k.data ()) ;
+        size.emplace_back (k.size ()) ;
+    }
+    std::vector<uint32_t>   before (cnt_keys) ;
+    J.Route (cnt_keys, data.data (), size.data (), before.data ()) ;
+    std::vector<size_t>     hits (10) ;
+    for (size_t i = 0 ; i < cnt_keys ; ++i) {
+        REQUIRE (before [i] == J.Route (data [i], size [i])) ;
+        ++hits [before [i]] ;
+    }
+    for (auto h : hits) {
+        REQUIRE (cnt_keys / 20 < h) ;
+    }
+    J.SetBucketCount (11) ;
+    size_t  moved = 0 ;
+    for (size_t i = 0 ; i < cnt_keys ; ++i) {
+        auto b = J.Route (data [i], size [i]) ;
+        if (b != before [i]) {
+            REQUIRE (b == 10) ;
+            ++moved ;
+        }
+    }
+    REQUIRE (moved < cnt_keys / 5) ;
+    REQUIRE (BLAKE2::JumpRouter::Jump (12345, 1) == 0) ;
+    REQUIRE_THROWS_AS (J.SetBucketCount (0), std::invalid_argument) ;
+}
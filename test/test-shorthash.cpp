@@ -0,0 +1,76 @@
+/*
+ * test-shorthash.cpp:
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#include "common.h"
+#include <string>
+#include <unordered_set>
+#include "BLAKE2.hpp"
+#include "BLAKE2/ShortHash.hpp"
+
+TEST_CASE ("Test ShortHash", "[shorthash]") {
+    std::vector<uint8_t>    src (600) ;
+    for (size_t i = 0 ; i < src.size () ; ++i) {
+        src [i] = static_cast<uint8_t> ((i * 13 + 5) & 0xFF) ;
+    }
+    std::vector<size_t> lengths { 0, 1, 7, 8, 127, 128, 129, 255, 256, 257, 600 } ;
+
+    SECTION ("With key") {
+        uint8_t key [16] ;
+        for (size_t i = 0 ; i < sizeof (key) ; ++i) {
+            key [i] = static_cast<uint8_t> (i) ;
+        }
+        BLAKE2::ShortHash   H { key, sizeof (key) } ;
+        BLAKE2::Parameter   P ;
+        P.SetDigestLength (8) ;
+        for (auto len : lengths) {
+            auto expected = BLAKE2::Apply (P, key, sizeof (key), src.data (), len) ;
+            REQUIRE (H.Apply (src.data (), len) == expected.GetUInt64 (0)) ;
+        }
+    }
+    SECTION ("Without key") {
+        BLAKE2::ShortHash   H { nullptr, 0 } ;
+        BLAKE2::Parameter   P ;
+        P.SetDigestLength (8) ;
+        for (auto len : lengths) {
+            auto expected = BLAKE2::Apply (P, nullptr, 0, src.data (), len) ;
+            REQUIRE (H.Apply (src.data (), len) == expected.GetUInt64 (0)) ;
+        }
+    }
+    SECTION ("With personalization") {
+        BLAKE2::Parameter   P ;
+        P.SetPersonalization ("hashtable", 9) ;
+        BLAKE2::ShortHash   H { P.GetParameterBlock (), "key", 3 } ;
+        P.SetDigestLength (8) ;
+        auto expected = BLAKE2::Apply (P, "key", 3, "abc", 3) ;
+        REQUIRE (H ("abc", 3) == expected.GetUInt64 (0)) ;
+    }
+}
+
+TEST_CASE ("Test ShortHasher", "[shorthash]") {
+    BLAKE2::ShortHash   H { "0123456789abcdef", 16 } ;
+    SECTION ("Strings") {
+        BLAKE2::ShortHasher<std::string>    hasher { H } ;
+        std::string s { "The quick brown fox" } ;
+        REQUIRE (hasher (s) == static_cast<size_t> (H.Apply (s.data (), s.size ()))) ;
+
+        std::unordered_set<std::string, BLAKE2::ShortHasher<std::string>>   set ;
+        for (int i = 0 ; i < 1000 ; ++i) {
+            set.insert (std::to_string (i)) ;
+        }
+        REQUIRE (set.size () == 1000) ;
+        REQUIRE (set.count ("999") == 1) ;
+        REQUIRE (set.count ("1000") == 0) ;
+    }
+    SECTION ("Trivially copyable keys") {
+        BLAKE2::ShortHasher<uint64_t>   hasher { H } ;
+        uint64_t    v = 0x0123456789ABCDEFuLL ;
+        REQUIRE (hasher (v) == static_cast<size_t> (H.Apply (&v, sizeof (v)))) ;
+        REQUIRE (hasher (v) != hasher (v + 1)) ;
+    }
+}
+
+/*
+ * [END OF FILE]
+ */
@@ -0,0 +1,98 @@
+/*
+ * test-stream.cpp:
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#include "common.h"
+#include "BLAKE2.hpp"
+#include "BLAKE2/Stream.hpp"
+
+#include <istream>
+#include <ostream>
+#include <sstream>
+
+namespace {
+    std::string make_text (size_t size) {
+        std::string result ;
+        for (size_t i = 0 ; result.size () < size ; ++i) {
+            result += "line " + std::to_string (i) + "\n" ;
+        }
+        result.resize (size) ;
+        return result ;
+    }
+
+    BLAKE2::Digest  digest_of (const std::string &s) {
+        return BLAKE2::Apply (nullptr, 0, s.data (), s.size ()) ;
+    }
+}
+
+TEST_CASE ("Test HashOutputBuffer", "[stream]") {
+    const auto  param = BLAKE2::Parameter ().GetParameterBlock () ;
+    const auto  text = make_text (100000) ;
+    for (size_t buffer_size : { 1, 16, 4096, 1000000 }) {
+        std::stringbuf  sink ;
+        std::string     written ;
+        BLAKE2::HashOutputBuffer    buf { &sink, param, buffer_size } ;
+        std::ostream    out { &buf } ;
+        out << "header " << 12345 << '\n' ;
+        written += "header 12345\n" ;
+        out.put ('x') ;
+        written += 'x' ;
+        out.write (text.data (), static_cast<std::streamsize> (text.size ())) ;
+        written += text ;
+        out << std::flush ;
+        REQUIRE (sink.str () == written) ;
+        out << "trailer" ;
+        written += "trailer" ;
+        REQUIRE (BLAKE2::Digest::IsEqual (buf.Finalize (), digest_of (written))) ;
+        REQUIRE (sink.str () == written) ;
+    }
+    SECTION ("Hashes without a sink") {
+        BLAKE2::HashOutputBuffer    buf { nullptr, param, 64 } ;
+        std::ostream    out { &buf } ;
+        out << text ;
+        REQUIRE (BLAKE2::Digest::IsEqual (buf.Finalize (), digest_of (text))) ;
+    }
+    SECTION ("Keyed") {
+        const char  key [] = "secret" ;
+        BLAKE2::HashOutputBuffer    buf { nullptr, param, key, 6, 64 } ;
+        std::ostream    out { &buf } ;
+        out << text ;
+        REQUIRE (BLAKE2::Digest::IsEqual (buf.Finalize (), BLAKE2::Apply (key, 6, text.data (), text.size ()))) ;
+    }
+}
+
+TEST_CASE ("Test HashInputBuffer", "[stream]") {
+    const auto  param = BLAKE2::Parameter ().GetParameterBlock () ;
+    const auto  text = make_text (100000) ;
+    for (size_t buffer_size : { 1, 16, 4096, 1000000 }) {
+        for (bool whole : { false, true }) {
+            std::stringbuf  source { text } ;
+            BLAKE2::HashInputBuffer     buf { &source, param, buffer_size } ;
+            std::istream    in { &buf } ;
+            std::string     line ;
+            std::string     consumed ;
+            REQUIRE (std::getline (in, line)) ;
+            consumed += line + "\n" ;
+            const int   c = in.get () ;
+            REQUIRE (c == 'l') ;
+            in.unget () ;
+            std::vector<char>   chunk (50000) ;
+            REQUIRE (in.read (chunk.data (), static_cast<std::streamsize> (chunk.size ()))) ;
+            consumed.append (chunk.data (), chunk.size ()) ;
+            REQUIRE (consumed == text.substr (0, consumed.size ())) ;
+            if (whole) {
+                std::ostringstream  rest ;
+                rest << in.rdbuf () ;
+                consumed += rest.str () ;
+                REQUIRE (consumed == text) ;
+            }
+            // Bytes buffered but not read are not hashed.
+            REQUIRE (BLAKE2::Digest::IsEqual (buf.Finalize (), digest_of (consumed))) ;
+        }
+    }
+}
+
+/*
+ * [END OF FILE]
+ */
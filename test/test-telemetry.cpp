@@ -0,0 +1,79 @@
+/*
+ * test-telemetry.cpp:
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#include "common.h"
+#include "BLAKE2.hpp"
+#include "BLAKE2/Batch.hpp"
+#include "BLAKE2/Telemetry.hpp"
+
+#include <thread>
+
+TEST_CASE ("Test Telemetry", "[telemetry]") {
+    using EP = BLAKE2::Telemetry::EntryPoint ;
+    if (! BLAKE2::Telemetry::IsAvailable ()) {
+        BLAKE2::Telemetry::SetEnabled (true) ;
+        REQUIRE (! BLAKE2::Telemetry::IsEnabled ()) ;
+        return ;
+    }
+    std::vector<uint8_t>    data (1000, 0x5A) ;
+    const uint8_t           key [] = { 1, 2, 3 } ;
+    BLAKE2::Parameter       param ;
+
+    BLAKE2::Telemetry::SetEnabled (true) ;
+    BLAKE2::Telemetry::Reset () ;
+    BLAKE2::Apply (nullptr, 0, data.data (), 0) ;                       // 1 block
+    BLAKE2::Apply (nullptr, 0, data.data (), 100) ;                     // 1 block
+    BLAKE2::Apply (key, sizeof (key), data.data (), 1000) ;             // 1 + 8 blocks
+    {
+        BLAKE2::Generator   gen { param, key, sizeof (key) } ;
+        gen.Update (data.data (), 100).Update (data.data (), 200).Finalize () ;    // 1 + 3 blocks
+    }
+    {
+        const void *    ptrs [] = { data.data (), data.data (), data.data () } ;
+        const size_t    lengths [] = { 0, 128, 129 } ;
+        BLAKE2::Digest  digests [3] ;
+        BLAKE2::ApplyBatch (param, nullptr, 0, 3, ptrs, lengths, digests) ;     // 1 + 1 + 2 blocks
+    }
+    // Threads are counted after they exit.
+    std::thread { [&data]() { BLAKE2::Apply (nullptr, 0, data.data (), 64) ; } }.join () ;
+
+    BLAKE2::Telemetry::SetEnabled (false) ;
+    BLAKE2::Apply (nullptr, 0, data.data (), 100) ;                     // Not counted.
+
+    auto const  S = BLAKE2::Telemetry::GetSnapshot () ;
+    auto const &    A = S [EP::APPLY] ;
+    REQUIRE (A.calls == 4) ;
+    REQUIRE (A.bytes == 1164) ;
+    REQUIRE (A.blocks == 12) ;
+    REQUIRE (A.finalizations == 4) ;
+    REQUIRE (A.sizes [0] == 1) ;        // 0
+    REQUIRE (A.sizes [7] == 2) ;        // 64, 100
+    REQUIRE (A.sizes [10] == 1) ;       // 1000
+
+    auto const &    G = S [EP::GENERATOR] ;
+    REQUIRE (G.calls == 2) ;
+    REQUIRE (G.bytes == 300) ;
+    REQUIRE (G.blocks == 4) ;
+    REQUIRE (G.finalizations == 1) ;
+    REQUIRE (G.sizes [9] == 1) ;        // 300
+
+    auto const &    B = S [EP::BATCH] ;
+    REQUIRE (B.calls == 1) ;
+    REQUIRE (B.bytes == 257) ;
+    REQUIRE (B.blocks == 4) ;
+    REQUIRE (B.finalizations == 3) ;
+    REQUIRE (B.sizes [8] == 2) ;        // 128, 129
+
+    auto const  json = BLAKE2::Telemetry::ToJSON (S) ;
+    REQUIRE (json.find ("\"kernel\": \"") != std::string::npos) ;
+    REQUIRE (json.find ("\"apply\": { \"calls\": 4, \"bytes\": 1164, \"blocks\": 12, \"finalizations\": 4, \"sizes\": [ 1, 0, 0, 0, 0, 0, 0, 2, 0, 0, 1 ] }") != std::string::npos) ;
+
+    BLAKE2::Telemetry::Reset () ;
+    REQUIRE (BLAKE2::Telemetry::GetSnapshot () [EP::APPLY].calls == 0) ;
+}
+
+/*
+ * [END OF FILE]
+ */
@@ -0,0 +1,108 @@
+/*
+ * test-verifiedstream.cpp:
+ *
+ * Copyright (c) 2015-2016 Masashi Fujita
+ */
+#include "common.h"
+#include <vector>
+#include "BLAKE2.hpp"
+#include "BLAKE2/VerifiedStream.hpp"
+
+namespace {
+    const size_t    CHUNK = BLAKE2::VerifiedStream::CHUNK_SIZE ;
+
+    std::vector<uint8_t>    make_data (size_t size) {
+        std::vector<uint8_t>    result (size) ;
+        for (size_t i = 0 ; i < size ; ++i) {
+            result [i] = static_cast<uint8_t> ((i * 31 + (i >> 8)) & 0xFF) ;
+        }
+        return result ;
+    }
+
+    /** Feeds ENCODED in PIECE bytes pieces.  */
+    std::vector<uint8_t>    decode (BLAKE2::VerifiedDecoder &D, const std::vector<uint8_t> &encoded, size_t piece) {
+        std::vector<uint8_t>    output ;
+        for (size_t off = 0 ; off < encoded.size () ; off += piece) {
+            D.Update (encoded.data () + off, std::min (piece, encoded.size () - off), output) ;
+        }
+        return output ;
+    }
+}
+
+TEST_CASE ("Test VerifiedStream", "[verifiedstream]") {
+    BLAKE2::Parameter   P ;
+    P.SetPersonalization ("download", 8) ;
+    const auto &    param = P.GetParameterBlock () ;
+
+    SECTION ("Round trip") {
+        for (size_t size : { size_t (0), size_t (1), CHUNK, CHUNK + 1, 3 * CHUNK + 5, 8 * CHUNK, 13 * CHUNK - 7 }) {
+            auto data = make_data (size) ;
+            std::vector<uint8_t>    encoded ;
+            auto root = BLAKE2::VerifiedStream::Encode (param, data.data (), data.size (), encoded) ;
+            REQUIRE (encoded.size () == BLAKE2::VerifiedStream::EncodedLength (size)) ;
+            REQUIRE (BLAKE2::Digest::IsEqual (root, BLAKE2::VerifiedStream::Hash (param, data.data (), data.size ()))) ;
+            REQUIRE_FALSE (BLAKE2::Digest::IsEqual (root, BLAKE2::VerifiedStream::Hash (BLAKE2::Parameter (), data.data (), data.size ()))) ;
+            for (size_t piece : { size_t (1000), encoded.size () + 1 }) {
+                BLAKE2::VerifiedDecoder     D { param, root } ;
+                auto output = decode (D, encoded, piece) ;
+                REQUIRE (D.IsComplete ()) ;
+                REQUIRE (D.GetContentLength () == size) ;
+                REQUIRE (output == data) ;
+            }
+        }
+    }
+    SECTION ("Corruption") {
+        auto data = make_data (6 * CHUNK) ;
+        std::vector<uint8_t>    encoded ;
+        auto root = BLAKE2::VerifiedStream::Encode (param, data.data (), data.size (), encoded) ;
+
+        // Flips a byte of the 4th chunk (followed by the parent of the last 2 chunks),
+        // the first 3 chunks are delivered.
+        auto bad = encoded ;
+        bad [bad.size () - 2 * CHUNK - BLAKE2::VerifiedStream::PARENT_SIZE - 10] ^= 1 ;
+        BLAKE2::VerifiedDecoder     D { param, root } ;
+        std::vector<uint8_t>        output ;
+        REQUIRE_THROWS_AS (D.Update (bad.data (), bad.size (), output), BLAKE2::VerifiedStream::VerificationError) ;
+        REQUIRE (output.size () == 3 * CHUNK) ;
+        REQUIRE (std::equal (output.begin (), output.end (), data.begin ())) ;
+
+        // Tampered length.
+        bad = encoded ;
+        bad [0] ^= 1 ;
+        BLAKE2::VerifiedDecoder     L { param, root } ;
+        REQUIRE_THROWS_AS (L.Update (bad.data (), bad.size (), output), BLAKE2::VerifiedStream::VerificationError) ;
+
+        // Trailing data.
+        bad = encoded ;
+        bad.push_back (0) ;
+        BLAKE2::VerifiedDecoder     T { param, root } ;
+        REQUIRE_THROWS_AS (T.Update (bad.data (), bad.size (), output), BLAKE2::VerifiedStream::VerificationError) ;
+    }
+    SECTION ("Slices") {
+        const size_t    size = 11 * CHUNK + 123 ;
+        auto data = make_data (size) ;
+        std::vector<uint8_t>    encoded ;
+        auto root = BLAKE2::VerifiedStream::Encode (param, data.data (), data.size (), encoded) ;
+        struct {
+            uint64_t    offset ;
+            uint64_t    length ;
+        } cases [] = { { 0, 1 }, { 0, size }, { 5 * CHUNK - 1, 2 }, { 7 * CHUNK, CHUNK }, { size - 1, 100 }, { size + 100, 10 }, { 3 * CHUNK, 0 } } ;
+        for (auto const &c : cases) {
+            auto slice = BLAKE2::VerifiedStream::ExtractSlice (encoded.data (), encoded.size (), c.offset, c.length) ;
+            if (c.length < 2 * CHUNK) {
+                REQUIRE (slice.size () < encoded.size () / 2) ;
+            }
+            BLAKE2::VerifiedDecoder     D { param, root, c.offset, c.length } ;
+            auto output = decode (D, slice, 777) ;
+            REQUIRE (D.IsComplete ()) ;
+            const size_t    first = static_cast<size_t> (std::min<uint64_t> (c.offset, size)) ;
+            const size_t    last = static_cast<size_t> (std::min<uint64_t> (c.offset + c.length, size)) ;
+            REQUIRE (output == std::vector<uint8_t> (data.begin () + first, data.begin () + last)) ;
+
+            BLAKE2::VerifiedDecoder     W { BLAKE2::Parameter ().GetParameterBlock (), root, c.offset, c.length } ;
+            std::vector<uint8_t>    dummy ;
+            REQUIRE_THROWS_AS (W.Update (slice.data (), slice.size (), dummy), BLAKE2::VerifiedStream::VerificationError) ;
+        }
+        REQUIRE_THROWS_AS (BLAKE2::VerifiedStream::ExtractSlice (encoded.data (), encoded.size () - 1, size - 1, 1), std::invalid_argument) ;
+    }
+}